@@ -20,6 +20,7 @@
 #include <fcntl.h>
 #include <getopt.h>
 #include <inttypes.h>
+#include <poll.h>
 #include <signal.h>
 #include <stdarg.h>
 #include <stdbool.h>
@@ -30,8 +31,13 @@
 #include <unistd.h>
 #include <zlib.h>
 
+#include <chrono>
+#include <condition_variable>
+#include <deque>
 #include <fstream>
 #include <memory>
+#include <mutex>
+#include <thread>
 
 #include <binder/IBinder.h>
 #include <binder/IServiceManager.h>
@@ -60,6 +66,8 @@ using std::string;
 const char* k_traceTagsProperty = "debug.atrace.tags.enableflags";
 const char* k_userInitiatedTraceProperty = "debug.atrace.user_initiated";
 
+const char* k_flightTriggerProperty = "debug.atrace.flight.trigger";
+
 const char* k_traceAppsNumberProperty = "debug.atrace.app_number";
 const char* k_traceAppsPropertyTemplate = "debug.atrace.app_%d";
 const char* k_coreServiceCategory = "core_services";
@@ -238,6 +246,10 @@ static bool g_traceAborted = false;
 static bool g_categoryEnables[arraysize(k_categories)] = {};
 static std::string g_traceFolder;
 
+/* Flight-recorder state */
+static bool g_flightRecorder = false;
+static volatile sig_atomic_t g_flightSnapshotRequested = 0;
+
 /* Sys file paths */
 static const char* k_traceClockPath =
     "trace_clock";
@@ -281,6 +293,9 @@ static const char* k_tracingOnPath =
 static const char* k_tracePath =
     "trace";
 
+static const char* k_traceSnapshotPath =
+    "snapshot";
+
 static const char* k_traceStreamPath =
     "trace_pipe";
 
@@ -940,13 +955,178 @@ static void streamTrace()
     }
 }
 
-// Read the current kernel trace and write it to stdout.
-static void dumpTrace(int outFd)
+/* Streaming compressed capture */
+
+// Size of each read from the trace pipe.
+static const size_t k_streamChunkSize = 64 * 1024;
+
+// Upper bound on trace data buffered in userspace while the compressor
+// catches up; the reader thread stalls once this is reached, which is
+// preferable to growing without bound when the output is slow.
+static const size_t k_streamBufferCapacity = 8 * 1024 * 1024;
+
+// How long the compressor waits for new data before syncing the deflate
+// stream, so the output is decodable up to roughly this far behind the
+// capture if atrace is killed.
+static const int k_streamFlushIntervalMs = 500;
+
+// Chunks of trace data handed from the reader thread to the compressor,
+// bounded by k_streamBufferCapacity.
+struct StreamChunkQueue {
+    std::mutex lock;
+    std::condition_variable dataAvailable;
+    std::condition_variable spaceAvailable;
+    std::deque<std::string> chunks;
+    size_t bytesQueued = 0;
+    bool done = false;
+};
+
+// Drain the trace pipe into the chunk queue on a dedicated thread, so the
+// kernel ring buffer keeps getting consumed even while the compressor is
+// busy. Polls with a timeout so an abort is noticed promptly.
+static void streamReaderThread(int traceFD, StreamChunkQueue* queue)
+{
+    std::string chunk(k_streamChunkSize, '\0');
+    while (!g_traceAborted) {
+        struct pollfd pfd = {traceFD, POLLIN, 0};
+        int n = poll(&pfd, 1, k_streamFlushIntervalMs);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            fprintf(stderr, "error polling trace pipe: %s (%d)\n", strerror(errno), errno);
+            break;
+        } else if (n == 0) {
+            continue;
+        }
+        ssize_t bytes = TEMP_FAILURE_RETRY(read(traceFD, &chunk[0], k_streamChunkSize));
+        if (bytes < 0) {
+            if (errno == EAGAIN) continue;
+            fprintf(stderr, "error reading trace pipe: %s (%d)\n", strerror(errno), errno);
+            break;
+        } else if (bytes == 0) {
+            break;
+        }
+        std::unique_lock<std::mutex> lock(queue->lock);
+        queue->spaceAvailable.wait(lock, [queue] {
+            return queue->bytesQueued < k_streamBufferCapacity || g_traceAborted;
+        });
+        if (g_traceAborted) break;
+        queue->chunks.emplace_back(chunk.data(), bytes);
+        queue->bytesQueued += bytes;
+        queue->dataAvailable.notify_one();
+    }
+    std::lock_guard<std::mutex> lock(queue->lock);
+    queue->done = true;
+    queue->dataAvailable.notify_one();
+}
+
+// Read data from the tracing pipe and forward it, zlib-compressed, to outFd
+// until the trace is aborted. Compared to dumping at the end of the trace,
+// this keeps working with small kernel buffers and bounded userspace memory
+// no matter how long the capture runs.
+static void streamCompressedTrace(int outFd)
+{
+    int traceFD = open((g_traceFolder + k_traceStreamPath).c_str(), O_RDONLY | O_NONBLOCK);
+    if (traceFD == -1) {
+        fprintf(stderr, "error opening %s: %s (%d)\n", k_traceStreamPath,
+                strerror(errno), errno);
+        return;
+    }
+
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+
+    int result = deflateInit(&zs, Z_DEFAULT_COMPRESSION);
+    if (result != Z_OK) {
+        fprintf(stderr, "error initializing zlib: %d\n", result);
+        close(traceFD);
+        return;
+    }
+
+    constexpr size_t bufSize = 64*1024;
+    std::unique_ptr<uint8_t[]> out(new uint8_t[bufSize]);
+
+    StreamChunkQueue queue;
+    std::thread reader(streamReaderThread, traceFD, &queue);
+
+    std::string chunk;
+    size_t inputSinceSync = 0;
+    bool finished = false;
+    while (!finished) {
+        bool timedOut = false;
+        chunk.clear();
+        {
+            std::unique_lock<std::mutex> lock(queue.lock);
+            if (!queue.dataAvailable.wait_for(
+                    lock, std::chrono::milliseconds(k_streamFlushIntervalMs),
+                    [&queue] { return !queue.chunks.empty() || queue.done; })) {
+                timedOut = true;
+            } else if (!queue.chunks.empty()) {
+                chunk = std::move(queue.chunks.front());
+                queue.chunks.pop_front();
+                queue.bytesQueued -= chunk.size();
+                queue.spaceAvailable.notify_one();
+            } else {
+                finished = true;
+            }
+        }
+
+        int flush = Z_NO_FLUSH;
+        if (finished) {
+            flush = Z_FINISH;
+        } else if (timedOut) {
+            if (inputSinceSync == 0) {
+                // Nothing new to sync; keep waiting.
+                continue;
+            }
+            // No data for a while; sync the deflate stream so the output is
+            // decodable up to this point.
+            flush = Z_SYNC_FLUSH;
+            inputSinceSync = 0;
+        } else {
+            inputSinceSync += chunk.size();
+        }
+
+        zs.next_in = reinterpret_cast<Bytef*>(&chunk[0]);
+        zs.avail_in = chunk.size();
+        do {
+            zs.next_out = reinterpret_cast<Bytef*>(out.get());
+            zs.avail_out = bufSize;
+            result = deflate(&zs, flush);
+            if (result == Z_STREAM_ERROR) break;
+            size_t bytes = bufSize - zs.avail_out;
+            if (bytes > 0 && !android::base::WriteFully(outFd, out.get(), bytes)) {
+                fprintf(stderr, "error writing deflated trace: %s (%d)\n",
+                        strerror(errno), errno);
+                result = Z_STREAM_ERROR;
+                break;
+            }
+        } while (zs.avail_out == 0);
+
+        if (result == Z_STREAM_ERROR) {
+            fprintf(stderr, "error deflating trace: %s\n", zs.msg);
+            // Unblock and stop the reader; there is nowhere to put its data.
+            g_traceAborted = true;
+            queue.spaceAvailable.notify_one();
+            break;
+        }
+    }
+
+    reader.join();
+    close(traceFD);
+
+    result = deflateEnd(&zs);
+    if (result != Z_OK) {
+        fprintf(stderr, "error cleaning up zlib: %d\n", result);
+    }
+}
+
+// Read the kernel trace from tracePath and write it to outFd.
+static void dumpTrace(int outFd, const char* tracePath = k_tracePath)
 {
     ALOGI("Dumping trace");
-    int traceFD = open((g_traceFolder + k_tracePath).c_str(), O_RDWR);
+    int traceFD = open((g_traceFolder + tracePath).c_str(), O_RDWR);
     if (traceFD == -1) {
-        fprintf(stderr, "error opening %s: %s (%d)\n", k_tracePath,
+        fprintf(stderr, "error opening %s: %s (%d)\n", tracePath,
                 strerror(errno), errno);
         return;
     }
@@ -1044,6 +1224,95 @@ static void dumpTrace(int outFd)
     close(traceFD);
 }
 
+/* Flight-recorder capture */
+
+// How often the flight-recorder loop checks for a pending trigger.
+static const int k_flightPollIntervalMs = 500;
+
+// Write one flight-recorder snapshot to a file named after g_outputFile,
+// tagged with a sequence number and the wall-clock time so fleet tooling can
+// correlate it with the jank/ANR report that pulled the trigger.
+//
+// If the kernel has the ftrace snapshot buffer, writing "1" to it swaps the
+// live per-CPU buffers with the (initially empty) spare ones atomically, so
+// the running trace is never paused and the snapshot is a consistent view of
+// the moments leading up to the trigger. Without it we fall back to reading
+// the trace file directly, which briefly pauses recording on each buffer as
+// it is read and leaves the events in place, so consecutive snapshots can
+// overlap.
+static bool takeFlightSnapshot(int sequence)
+{
+    bool haveSnapshotBuffer = fileIsWritable(k_traceSnapshotPath);
+    if (haveSnapshotBuffer) {
+        if (!writeStr(k_traceSnapshotPath, "1")) {
+            return false;
+        }
+    }
+
+    int64_t realtime_in_ms = systemTime(CLOCK_REALTIME) / 1000000;
+    std::string fileName = android::base::StringPrintf("%s.%03d-%" PRId64, g_outputFile,
+            sequence, realtime_in_ms);
+    int outFd = open(fileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (outFd == -1) {
+        fprintf(stderr, "error opening %s: %s (%d)\n", fileName.c_str(),
+                strerror(errno), errno);
+        return false;
+    }
+
+    dprintf(outFd, "TRACE:\n");
+    dumpTrace(outFd, haveSnapshotBuffer ? k_traceSnapshotPath : k_tracePath);
+    close(outFd);
+
+    printf("flight snapshot written to %s\n", fileName.c_str());
+    fflush(stdout);
+    return true;
+}
+
+// Run until aborted, snapshotting the circular trace buffers whenever SIGUSR1
+// arrives or the trigger property is set, without halting tracing. Userspace
+// categories stay enabled for the whole run and land in the same buffers via
+// trace_marker, so they are part of every snapshot.
+static void flightRecorderLoop()
+{
+    int sequence = 0;
+    std::string lastTrigger;
+    while (!g_traceAborted) {
+        bool triggered = false;
+        if (g_flightSnapshotRequested) {
+            g_flightSnapshotRequested = 0;
+            triggered = true;
+        }
+
+        // The property trigger is edge-sensitive: any new non-empty value
+        // requests one snapshot, and we clear it so the next setprop fires
+        // again even with the same value.
+        std::string trigger = android::base::GetProperty(k_flightTriggerProperty, "");
+        if (!trigger.empty() && trigger != lastTrigger) {
+            android::base::SetProperty(k_flightTriggerProperty, "");
+            triggered = true;
+        }
+        lastTrigger = trigger;
+
+        if (triggered) {
+            takeFlightSnapshot(sequence++);
+        }
+
+        struct timespec timeLeft;
+        timeLeft.tv_sec = 0;
+        timeLeft.tv_nsec = k_flightPollIntervalMs * 1000000;
+        while (nanosleep(&timeLeft, &timeLeft) == -1 && errno == EINTR) {
+            if (g_traceAborted || g_flightSnapshotRequested) {
+                break;
+            }
+        }
+    }
+
+    // Free the spare buffer pages if we allocated them.
+    if (sequence > 0 && fileIsWritable(k_traceSnapshotPath)) {
+        writeStr(k_traceSnapshotPath, "0");
+    }
+}
+
 static void handleSignal(int /*signo*/)
 {
     if (!g_nohup) {
@@ -1051,6 +1320,11 @@ static void handleSignal(int /*signo*/)
     }
 }
 
+static void handleFlightSignal(int /*signo*/)
+{
+    g_flightSnapshotRequested = 1;
+}
+
 static void registerSigHandler()
 {
     struct sigaction sa;
@@ -1061,6 +1335,8 @@ static void registerSigHandler()
     sigaction(SIGINT, &sa, NULL);
     sigaction(SIGQUIT, &sa, NULL);
     sigaction(SIGTERM, &sa, NULL);
+    sa.sa_handler = handleFlightSignal;
+    sigaction(SIGUSR1, &sa, NULL);
 }
 
 static void listSupportedCategories()
@@ -1088,12 +1364,22 @@ static void showHelp(const char *cmd)
                     "  -n              ignore signals\n"
                     "  -s N            sleep for N seconds before tracing [default 0]\n"
                     "  -t N            trace for N seconds [default 5]\n"
-                    "  -z              compress the trace dump\n"
+                    "  -z              compress the trace dump (or the --stream output)\n"
                     "  --async_start   start circular trace and return immediately\n"
                     "  --async_dump    dump the current contents of circular trace buffer\n"
                     "  --async_stop    stop tracing and dump the current contents of circular\n"
                     "                    trace buffer\n"
+                    "  --flight_recorder\n"
+                    "                  trace continuously into circular buffers and write a\n"
+                    "                    snapshot of the recent past (bounded by -b) to a file\n"
+                    "                    on each trigger, without halting tracing. Triggers are\n"
+                    "                    SIGUSR1 or setting debug.atrace.flight.trigger to any\n"
+                    "                    new non-empty value. Requires -o; each snapshot goes\n"
+                    "                    to <file>.<seq>-<realtime ms>. Runs until killed.\n"
                     "  --stream        stream trace to stdout as it enters the trace buffer\n"
+                    "                    With -z, the stream is deflated on the fly (honoring\n"
+                    "                    -o), so long captures run with small kernel buffers\n"
+                    "                    and bounded memory.\n"
                     "                    Note: this can take significant CPU time, and is best\n"
                     "                    used for measuring things that are not affected by\n"
                     "                    CPU performance, like pagecache usage.\n"
@@ -1153,6 +1439,7 @@ int main(int argc, char **argv)
             {"async_start",       no_argument, 0,  0 },
             {"async_stop",        no_argument, 0,  0 },
             {"async_dump",        no_argument, 0,  0 },
+            {"flight_recorder",   no_argument, 0,  0 },
             {"only_userspace",    no_argument, 0,  0 },
             {"list_categories",   no_argument, 0,  0 },
             {"stream",            no_argument, 0,  0 },
@@ -1226,6 +1513,10 @@ int main(int argc, char **argv)
                     async = true;
                     traceStart = false;
                     traceStop = false;
+                } else if (!strcmp(long_options[option_index].name, "flight_recorder")) {
+                    g_flightRecorder = true;
+                    traceDump = false;
+                    g_traceOverwrite = true;
                 } else if (!strcmp(long_options[option_index].name, "only_userspace")) {
                     onlyUserspace = true;
                 } else if (!strcmp(long_options[option_index].name, "stream")) {
@@ -1253,6 +1544,18 @@ int main(int argc, char **argv)
         }
     }
 
+    if (g_flightRecorder) {
+        if (async || traceStream || onlyUserspace) {
+            fprintf(stderr, "--flight_recorder cannot be combined with --async_*, "
+                    "--stream or --only_userspace\n");
+            exit(1);
+        }
+        if (g_outputFile == nullptr) {
+            fprintf(stderr, "--flight_recorder requires -o to name the snapshot files\n");
+            exit(1);
+        }
+    }
+
     registerSigHandler();
 
     if (g_initialSleepSecs > 0) {
@@ -1288,7 +1591,12 @@ int main(int argc, char **argv)
         if (!onlyUserspace)
             writeClockSyncMarker();
 
-        if (ok && !async && !traceStream) {
+        if (g_flightRecorder) {
+            printf("flight recorder armed; snapshot with SIGUSR1 or "
+                    "setprop %s <id>\n", k_flightTriggerProperty);
+            fflush(stdout);
+            flightRecorderLoop();
+        } else if (ok && !async && !traceStream) {
             // Sleep to allow the trace to be captured.
             struct timespec timeLeft;
             timeLeft.tv_sec = g_traceDurationSeconds;
@@ -1301,7 +1609,22 @@ int main(int argc, char **argv)
         }
 
         if (traceStream) {
-            streamTrace();
+            if (g_compress) {
+                int outFd = STDOUT_FILENO;
+                if (g_outputFile) {
+                    outFd = open(g_outputFile, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+                }
+                if (outFd == -1) {
+                    printf("Failed to open '%s', err=%d", g_outputFile, errno);
+                } else {
+                    streamCompressedTrace(outFd);
+                    if (g_outputFile) {
+                        close(outFd);
+                    }
+                }
+            } else {
+                streamTrace();
+            }
         }
     }
 
@@ -1342,5 +1665,6 @@ int main(int argc, char **argv)
             cleanUpKernelTracing();
     }
 
-    return g_traceAborted ? 1 : 0;
+    // Stopping the flight recorder with a signal is its normal shutdown.
+    return (g_traceAborted && !g_flightRecorder) ? 1 : 0;
 }
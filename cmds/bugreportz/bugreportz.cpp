@@ -15,6 +15,7 @@
  */
 
 #include <errno.h>
+#include <fcntl.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -30,19 +31,70 @@
 static constexpr char BEGIN_PREFIX[] = "BEGIN:";
 static constexpr char PROGRESS_PREFIX[] = "PROGRESS:";
 
+// Control lines interleaved in the stream by dumpstate. These must be
+// dropped unless invoked with the -p option, otherwise they will break adb
+// (which is expecting either OK or FAIL).
+static bool is_control_line(const char* line, size_t len) {
+    return (len >= strlen(BEGIN_PREFIX) && memcmp(line, BEGIN_PREFIX, strlen(BEGIN_PREFIX)) == 0) ||
+           (len >= strlen(PROGRESS_PREFIX) &&
+            memcmp(line, PROGRESS_PREFIX, strlen(PROGRESS_PREFIX)) == 0);
+}
+
+static void write_chunk(const char* data, size_t len) {
+    if (len == 0) return;
+
+    android::base::WriteFully(STDOUT_FILENO, data, len);
+}
+
 static void write_line(const std::string& line, bool show_progress) {
     if (line.empty()) return;
 
-    // When not invoked with the -p option, it must skip BEGIN and PROGRESS lines otherwise it
-    // will break adb (which is expecting either OK or FAIL).
-    if (!show_progress && (android::base::StartsWith(line, PROGRESS_PREFIX) ||
-                           android::base::StartsWith(line, BEGIN_PREFIX)))
-        return;
+    if (!show_progress && is_control_line(line.data(), line.size())) return;
 
     android::base::WriteStringToFd(line, STDOUT_FILENO);
 }
 
+// Forwards the stream to stdout entirely kernel-side with splice(), which
+// needs a pipe on one end; under adb stdout is one. Returns false without
+// having consumed anything if this fd pair cannot be spliced, so the caller
+// can fall back to copying through userspace.
+static bool splice_stream(int s) {
+    bool spliced = false;
+    while (1) {
+        ssize_t n =
+            TEMP_FAILURE_RETRY(splice(s, nullptr, STDOUT_FILENO, nullptr, 1 << 20, SPLICE_F_MORE));
+        if (n > 0) {
+            spliced = true;
+            continue;
+        }
+        if (n == 0) {
+            return true;
+        }
+        if (!spliced && (errno == EINVAL || errno == ENOSYS)) {
+            return false;
+        }
+        // EAGAIN really means time out, so change the errno.
+        if (errno == EAGAIN) {
+            errno = ETIMEDOUT;
+        }
+        printf("FAIL:Bugreport read terminated abnormally (%s)\n", strerror(errno));
+        return true;
+    }
+}
+
 int bugreportz(int s, bool show_progress) {
+    // With -p every line is forwarded verbatim, so nothing needs to look at
+    // the bytes and the whole report can stay in the kernel.
+    if (show_progress && splice_stream(s)) {
+        if (close(s) == -1) {
+            fprintf(stderr, "WARNING: error closing socket: %s\n", strerror(errno));
+        }
+        return EXIT_SUCCESS;
+    }
+
+    // Otherwise scan for line boundaries in bulk, writing runs of kept lines
+    // straight from the read buffer in single writes; only a line spanning
+    // two reads is ever assembled in |line|.
     std::string line;
     while (1) {
         char buffer[65536];
@@ -58,15 +110,27 @@ int bugreportz(int s, bool show_progress) {
             break;
         }
 
-        // Writes line by line.
-        for (int i = 0; i < bytes_read; i++) {
-            char c = buffer[i];
-            line.append(1, c);
-            if (c == '\n') {
+        const char* end = buffer + bytes_read;
+        const char* line_start = buffer;
+        const char* run_start = buffer;  // first kept byte not yet written
+        const char* nl;
+        while (line_start < end &&
+               (nl = static_cast<const char*>(memchr(line_start, '\n', end - line_start)))) {
+            if (!line.empty()) {
+                // This read completes a line carried over from the last one.
+                line.append(line_start, nl + 1 - line_start);
                 write_line(line, show_progress);
                 line.clear();
+                run_start = nl + 1;
+            } else if (!show_progress && is_control_line(line_start, nl + 1 - line_start)) {
+                write_chunk(run_start, line_start - run_start);
+                run_start = nl + 1;
             }
+            line_start = nl + 1;
         }
+        write_chunk(run_start, line_start - run_start);
+        // Hold a trailing partial line over to the next read.
+        line.append(line_start, end - line_start);
     }
     // Process final line, in case it didn't finish with newline
     write_line(line, show_progress);
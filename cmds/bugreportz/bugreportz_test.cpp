@@ -107,6 +107,17 @@ TEST_F(BugreportzTest, NoArgument) {
         "But PROGRESS IN THE MIDDLE is accepted\n");
 }
 
+// Tests 'bugreportz' with a control line that is the last line and has no
+// trailing newline - it must still be omitted.
+TEST_F(BugreportzTest, UnterminatedControlLine) {
+    WriteToSocket("OK:/some/path\n");
+    WriteToSocket("PROGRESS:NOT DONE AND NOT NEWLINE TERMINATED");
+
+    Bugreportz(false);
+
+    AssertStdoutEquals("OK:/some/path\n");
+}
+
 // Tests 'bugreportz -p' - it will just echo dumpstate's output to stdout
 TEST_F(BugreportzTest, WithProgress) {
     WriteToSocket("BEGIN:I AM YOUR PATH\n");
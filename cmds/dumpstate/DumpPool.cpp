@@ -0,0 +1,175 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "dumpstate"
+
+#include "DumpPool.h"
+
+#include <algorithm>
+#include <cctype>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <android-base/file.h>
+#include <android-base/stringprintf.h>
+#include <android-base/unique_fd.h>
+#include <log/log.h>
+
+#include "DumpstateInternal.h"
+#include "dumpstate.h"
+
+namespace android {
+namespace os {
+namespace dumpstate {
+
+const int DumpPool::kDefaultThreadCount;
+
+DumpPool::DumpPool(const std::string& tmp_root) : tmp_root_(tmp_root), shutdown_(false) {
+}
+
+DumpPool::~DumpPool() {
+    Shutdown();
+}
+
+void DumpPool::Start(int thread_count) {
+    std::lock_guard<std::mutex> lock(lock_);
+    if (!threads_.empty()) {
+        return;
+    }
+    MYLOGI("Starting %d dump pool thread(s)\n", thread_count);
+    for (int i = 0; i < thread_count; i++) {
+        threads_.emplace_back(&DumpPool::Worker, this);
+    }
+}
+
+void DumpPool::Enqueue(const std::string& task_name, std::function<void(int)> dump_func) {
+    auto task = std::make_shared<Task>();
+    task->name = task_name;
+    task->dump_func = std::move(dump_func);
+
+    // Task names are section titles and may contain characters that don't
+    // belong in a path; keep the temporary file names conservative.
+    std::string file_name = task_name;
+    std::replace_if(file_name.begin(), file_name.end(),
+                    [](char c) { return !isalnum(c) && c != '-' && c != '_'; }, '_');
+    task->tmp_path = android::base::StringPrintf("%s/dump-%s.tmp", tmp_root_.c_str(),
+                                                 file_name.c_str());
+
+    std::lock_guard<std::mutex> lock(lock_);
+    if (tasks_.count(task_name) != 0) {
+        MYLOGE("Duplicate dump pool task name: %s\n", task_name.c_str());
+        return;
+    }
+    tasks_[task_name] = task;
+    queue_.push(task);
+    task_available_.notify_one();
+}
+
+bool DumpPool::WaitForTask(const std::string& task_name, int out_fd) {
+    std::shared_ptr<Task> task;
+    {
+        std::unique_lock<std::mutex> lock(lock_);
+        auto it = tasks_.find(task_name);
+        if (it == tasks_.end()) {
+            return false;
+        }
+        task = it->second;
+        task_done_.wait(lock, [&task] { return task->done; });
+        tasks_.erase(it);
+    }
+
+    android::base::unique_fd fd(
+        TEMP_FAILURE_RETRY(open(task->tmp_path.c_str(), O_RDONLY | O_CLOEXEC)));
+    if (fd == -1) {
+        MYLOGE("open(%s): %s\n", task->tmp_path.c_str(), strerror(errno));
+        return false;
+    }
+    std::vector<char> buffer(65536);
+    while (true) {
+        ssize_t bytes_read = TEMP_FAILURE_RETRY(read(fd.get(), buffer.data(), buffer.size()));
+        if (bytes_read == 0) {
+            break;
+        } else if (bytes_read == -1) {
+            MYLOGE("read(%s): %s\n", task->tmp_path.c_str(), strerror(errno));
+            break;
+        }
+        if (!android::base::WriteFully(out_fd, buffer.data(), bytes_read)) {
+            MYLOGE("write: %s\n", strerror(errno));
+            break;
+        }
+    }
+    unlink(task->tmp_path.c_str());
+    return true;
+}
+
+void DumpPool::Shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(lock_);
+        if (shutdown_ || threads_.empty()) {
+            return;
+        }
+        shutdown_ = true;
+        task_available_.notify_all();
+    }
+    for (auto& thread : threads_) {
+        thread.join();
+    }
+    threads_.clear();
+    for (const auto& entry : tasks_) {
+        unlink(entry.second->tmp_path.c_str());
+    }
+    tasks_.clear();
+}
+
+void DumpPool::Worker() {
+    while (true) {
+        std::shared_ptr<Task> task;
+        {
+            std::unique_lock<std::mutex> lock(lock_);
+            task_available_.wait(lock, [this] { return shutdown_ || !queue_.empty(); });
+            if (queue_.empty()) {
+                return;
+            }
+            task = queue_.front();
+            queue_.pop();
+        }
+        RunTask(task);
+    }
+}
+
+void DumpPool::RunTask(const std::shared_ptr<Task>& task) {
+    DurationReporter duration_reporter(task->name, true /* log_only */);
+    {
+        android::base::unique_fd fd(TEMP_FAILURE_RETRY(
+            open(task->tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC | O_NOFOLLOW,
+                 S_IRUSR | S_IWUSR)));
+        if (fd == -1) {
+            MYLOGE("open(%s): %s\n", task->tmp_path.c_str(), strerror(errno));
+        } else {
+            task->dump_func(fd.get());
+        }
+    }
+    std::lock_guard<std::mutex> lock(lock_);
+    task->done = true;
+    task_done_.notify_all();
+}
+
+}  // namespace dumpstate
+}  // namespace os
+}  // namespace android
@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FRAMEWORK_NATIVE_CMD_DUMPPOOL_H_
+#define FRAMEWORK_NATIVE_CMD_DUMPPOOL_H_
+
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <android-base/macros.h>
+
+namespace android {
+namespace os {
+namespace dumpstate {
+
+/*
+ * A fixed-size pool of worker threads used to run independent bugreport
+ * sections concurrently. Each task writes into its own temporary file, so
+ * the main thread can keep streaming serial sections to the report and
+ * later splice a task's buffered output back in at the section's original
+ * position.
+ *
+ * Typical usage:
+ *
+ *    DumpPool pool(tmp_root);
+ *    pool.Start();
+ *    pool.Enqueue("DUMP FOO", DumpFooToFd);
+ *    ... main thread keeps dumping serial sections ...
+ *    pool.WaitForTask("DUMP FOO", STDOUT_FILENO);
+ *
+ * Tasks must be independent: a queued function may only write to the file
+ * descriptor it is given (plus the log), and must not rely on the output of
+ * another queued task. Report order is defined by the order of the
+ * WaitForTask() calls, not by the order in which tasks happen to finish.
+ */
+class DumpPool {
+  public:
+    /* Number of worker threads started by default. */
+    static const int kDefaultThreadCount = 4;
+
+    /* |tmp_root| directory where the per-task temporary files are created. */
+    explicit DumpPool(const std::string& tmp_root);
+
+    ~DumpPool();
+
+    /* Starts |thread_count| worker threads; no-op if already started. */
+    void Start(int thread_count = kDefaultThreadCount);
+
+    /*
+     * Queues a task for execution on a worker thread. |task_name| must be
+     * unique among queued tasks; |dump_func| is invoked with the file
+     * descriptor of the task's temporary output file.
+     */
+    void Enqueue(const std::string& task_name, std::function<void(int)> dump_func);
+
+    /*
+     * Blocks until the named task has finished, then copies its buffered
+     * output to |out_fd| and removes the temporary file. Returns false if no
+     * task with that name was enqueued.
+     */
+    bool WaitForTask(const std::string& task_name, int out_fd);
+
+    /* Joins all worker threads, discarding the output of unfinished tasks. */
+    void Shutdown();
+
+  private:
+    struct Task {
+        std::string name;
+        std::function<void(int)> dump_func;
+        std::string tmp_path;
+        bool done = false;
+    };
+
+    void Worker();
+
+    /* Runs a single task, writing its output to |tmp_path|. */
+    void RunTask(const std::shared_ptr<Task>& task);
+
+    std::string tmp_root_;
+    bool shutdown_;
+    std::mutex lock_;
+    std::condition_variable task_available_;
+    std::condition_variable task_done_;
+    std::vector<std::thread> threads_;
+    std::queue<std::shared_ptr<Task>> queue_;
+    std::map<std::string, std::shared_ptr<Task>> tasks_;
+
+    friend class DumpPoolTest;
+
+    DISALLOW_COPY_AND_ASSIGN(DumpPool);
+};
+
+}  // namespace dumpstate
+}  // namespace os
+}  // namespace android
+
+#endif  // FRAMEWORK_NATIVE_CMD_DUMPPOOL_H_
@@ -60,6 +60,7 @@
 #include <private/android_logger.h>
 #include <serviceutils/PriorityDumper.h>
 #include <utils/StrongPointer.h>
+#include "DumpPool.h"
 #include "DumpstateInternal.h"
 #include "DumpstateSectionReporter.h"
 #include "DumpstateService.h"
@@ -84,6 +85,7 @@ using android::UNKNOWN_ERROR;
 using android::Vector;
 using android::os::dumpstate::CommandOptions;
 using android::os::dumpstate::DumpFileToFd;
+using android::os::dumpstate::DumpPool;
 using android::os::dumpstate::DumpstateSectionReporter;
 using android::os::dumpstate::GetPidByName;
 using android::os::dumpstate::PropertiesHelper;
@@ -134,6 +136,17 @@ static void RunDumpsys(const std::string& title, const std::vector<std::string>&
 static int DumpFile(const std::string& title, const std::string& path) {
     return ds.DumpFile(title, path);
 }
+// Runs `dumpsys` with output to the given fd, mirroring Dumpstate::RunDumpsys.
+// Used by sections executed on the dump pool, which buffer their output into a
+// task-private fd instead of `stdout` and must not update progress themselves.
+static int RunDumpsysToFd(int out_fd, const std::string& title,
+                          const std::vector<std::string>& dumpsysArgs,
+                          const CommandOptions& options = Dumpstate::DEFAULT_DUMPSYS) {
+    std::vector<std::string> dumpsys = {"/system/bin/dumpsys", "-T",
+                                        std::to_string(options.TimeoutInMs())};
+    dumpsys.insert(dumpsys.end(), dumpsysArgs.begin(), dumpsysArgs.end());
+    return RunCommandToFd(out_fd, title, dumpsys, options);
+}
 
 // Relative directory (inside the zip) for all files copied as-is into the bugreport.
 static const std::string ZIP_ROOT_DIR = "FS";
@@ -153,9 +166,17 @@ static constexpr char PROPERTY_LAST_ID[] = "dumpstate.last_id";
 static constexpr char PROPERTY_VERSION[] = "dumpstate.version";
 static constexpr char PROPERTY_EXTRA_TITLE[] = "dumpstate.options.title";
 static constexpr char PROPERTY_EXTRA_DESCRIPTION[] = "dumpstate.options.description";
+// When set to false, the heavy independent sections run serially on the main
+// thread instead of on the dump pool.
+static constexpr char PROPERTY_PARALLEL_RUN[] = "dumpstate.parallel_run";
 
 static const CommandOptions AS_ROOT_20 = CommandOptions::WithTimeout(20).AsRoot().Build();
 
+// Names of the sections executed on the dump pool (see dumpstate()).
+static const std::string DUMP_HALS_TASK = "DUMP HALS";
+static const std::string DUMP_CHECKINS_TASK = "DUMP CHECKINS";
+static const std::string DUMP_APP_INFOS_TASK = "DUMP APP INFOS";
+
 /*
  * Returns a vector of dump fds under |dir_path| with a given |file_prefix|.
  * The returned vector is sorted by the mtimes of the dumps. If |limit_by_mtime|
@@ -736,6 +757,9 @@ status_t Dumpstate::AddZipEntryFromFd(const std::string& entry_name, int fd,
                entry_name.c_str());
         return INVALID_OPERATION;
     }
+    // Sections running on the dump pool add their own zip entries, so the
+    // writer must be protected against concurrent use.
+    std::lock_guard<std::mutex> lock(zip_entry_lock_);
     std::string valid_name = entry_name;
 
     // Rename extension if necessary.
@@ -839,6 +863,7 @@ bool Dumpstate::AddTextZipEntry(const std::string& entry_name, const std::string
                entry_name.c_str());
         return false;
     }
+    std::lock_guard<std::mutex> lock(zip_entry_lock_);
     MYLOGD("Adding zip text entry %s\n", entry_name.c_str());
     int32_t err = zip_writer_->StartEntryWithTime(entry_name.c_str(), ZipWriter::kCompress, ds.now_);
     if (err != 0) {
@@ -1236,10 +1261,13 @@ static void RunDumpsysNormal() {
                     /* timeout= */ 90s, /* service_timeout= */ 10s);
 }
 
-static void DumpHals() {
+static void DumpHals(int out_fd) {
     using android::hidl::manager::V1_0::IServiceManager;
     using android::hardware::defaultServiceManager;
 
+    RunCommandToFd(out_fd, "HARDWARE HALS", {"lshal"},
+                   CommandOptions::WithTimeout(2).AsRootIfAvailable().Build());
+
     sp<IServiceManager> sm = defaultServiceManager();
     if (sm == nullptr) {
         MYLOGE("Could not retrieve hwservicemanager to dump hals.\n");
@@ -1286,9 +1314,79 @@ static void DumpHals() {
     }
 }
 
+static void DumpCheckins(int out_fd) {
+    dprintf(out_fd, "========================================================\n");
+    dprintf(out_fd, "== Checkins\n");
+    dprintf(out_fd, "========================================================\n");
+
+    RunDumpsysToFd(out_fd, "CHECKIN BATTERYSTATS", {"batterystats", "-c"});
+    RunDumpsysToFd(out_fd, "CHECKIN MEMINFO", {"meminfo", "--checkin"});
+    RunDumpsysToFd(out_fd, "CHECKIN NETSTATS", {"netstats", "--checkin"});
+    RunDumpsysToFd(out_fd, "CHECKIN PROCSTATS", {"procstats", "-c"});
+    RunDumpsysToFd(out_fd, "CHECKIN USAGESTATS", {"usagestats", "-c"});
+    RunDumpsysToFd(out_fd, "CHECKIN PACKAGE", {"package", "--checkin"});
+}
+
+static void DumpAppInfos(int out_fd) {
+    // The following dumpsys internally collects output from running apps, so it can take a long
+    // time. So let's extend the timeout.
+    const CommandOptions DUMPSYS_COMPONENTS_OPTIONS = CommandOptions::WithTimeout(60).Build();
+
+    dprintf(out_fd, "========================================================\n");
+    dprintf(out_fd, "== Running Application Activities\n");
+    dprintf(out_fd, "========================================================\n");
+
+    RunDumpsysToFd(out_fd, "APP ACTIVITIES", {"activity", "-v", "all"},
+                   DUMPSYS_COMPONENTS_OPTIONS);
+
+    dprintf(out_fd, "========================================================\n");
+    dprintf(out_fd, "== Running Application Services (platform)\n");
+    dprintf(out_fd, "========================================================\n");
+
+    RunDumpsysToFd(out_fd, "APP SERVICES PLATFORM", {"activity", "service", "all-platform"},
+                   DUMPSYS_COMPONENTS_OPTIONS);
+
+    dprintf(out_fd, "========================================================\n");
+    dprintf(out_fd, "== Running Application Services (non-platform)\n");
+    dprintf(out_fd, "========================================================\n");
+
+    RunDumpsysToFd(out_fd, "APP SERVICES NON-PLATFORM", {"activity", "service", "all-non-platform"},
+                   DUMPSYS_COMPONENTS_OPTIONS);
+
+    dprintf(out_fd, "========================================================\n");
+    dprintf(out_fd, "== Running Application Providers (platform)\n");
+    dprintf(out_fd, "========================================================\n");
+
+    RunDumpsysToFd(out_fd, "APP PROVIDERS PLATFORM", {"activity", "provider", "all-platform"},
+                   DUMPSYS_COMPONENTS_OPTIONS);
+
+    dprintf(out_fd, "========================================================\n");
+    dprintf(out_fd, "== Running Application Providers (non-platform)\n");
+    dprintf(out_fd, "========================================================\n");
+
+    RunDumpsysToFd(out_fd, "APP PROVIDERS NON-PLATFORM", {"activity", "provider", "all-non-platform"},
+                   DUMPSYS_COMPONENTS_OPTIONS);
+}
+
 static void dumpstate() {
     DurationReporter duration_reporter("DUMPSTATE");
 
+    // The most expensive sections are independent of the rest of the report,
+    // so farm them out to a bounded pool of worker threads and merge their
+    // buffered output back in at the sections' original positions below,
+    // while this thread keeps running the serial sections.
+    std::unique_ptr<DumpPool> dump_pool;
+    if (android::base::GetBoolProperty(PROPERTY_PARALLEL_RUN, true)) {
+        dump_pool = std::make_unique<DumpPool>(
+            ds.bugreport_dir_.empty() ? kDumpstateBoardPath : ds.bugreport_dir_);
+        dump_pool->Start();
+        if (ds.IsZipping()) {
+            dump_pool->Enqueue(DUMP_HALS_TASK, DumpHals);
+        }
+        dump_pool->Enqueue(DUMP_CHECKINS_TASK, DumpCheckins);
+        dump_pool->Enqueue(DUMP_APP_INFOS_TASK, DumpAppInfos);
+    }
+
     dump_dev_files("TRUSTY VERSION", "/sys/bus/platform/drivers/trusty", "trusty_version");
     RunCommand("UPTIME", {"uptime"});
     DumpBlockStatFiles();
@@ -1314,8 +1412,13 @@ static void dumpstate() {
     RunCommand("LIBRANK", {"librank"}, CommandOptions::AS_ROOT);
 
     if (ds.IsZipping()) {
-        RunCommand("HARDWARE HALS", {"lshal"}, CommandOptions::WithTimeout(2).AsRootIfAvailable().Build());
-        DumpHals();
+        if (dump_pool != nullptr) {
+            dump_pool->WaitForTask(DUMP_HALS_TASK, STDOUT_FILENO);
+        } else {
+            DumpHals(STDOUT_FILENO);
+        }
+        // Matches the lshal timeout used inside DumpHals.
+        ds.UpdateProgress(2);
     } else {
         RunCommand("HARDWARE HALS", {"lshal", "--debug"}, CommandOptions::WithTimeout(10).AsRootIfAvailable().Build());
     }
@@ -1417,55 +1520,21 @@ static void dumpstate() {
 
     RunDumpsysNormal();
 
-    printf("========================================================\n");
-    printf("== Checkins\n");
-    printf("========================================================\n");
-
-    RunDumpsys("CHECKIN BATTERYSTATS", {"batterystats", "-c"});
-    RunDumpsys("CHECKIN MEMINFO", {"meminfo", "--checkin"});
-    RunDumpsys("CHECKIN NETSTATS", {"netstats", "--checkin"});
-    RunDumpsys("CHECKIN PROCSTATS", {"procstats", "-c"});
-    RunDumpsys("CHECKIN USAGESTATS", {"usagestats", "-c"});
-    RunDumpsys("CHECKIN PACKAGE", {"package", "--checkin"});
-
-    printf("========================================================\n");
-    printf("== Running Application Activities\n");
-    printf("========================================================\n");
-
-    // The following dumpsys internally collects output from running apps, so it can take a long
-    // time. So let's extend the timeout.
-
-    const CommandOptions DUMPSYS_COMPONENTS_OPTIONS = CommandOptions::WithTimeout(60).Build();
-
-    RunDumpsys("APP ACTIVITIES", {"activity", "-v", "all"}, DUMPSYS_COMPONENTS_OPTIONS);
-
-    printf("========================================================\n");
-    printf("== Running Application Services (platform)\n");
-    printf("========================================================\n");
-
-    RunDumpsys("APP SERVICES PLATFORM", {"activity", "service", "all-platform"},
-            DUMPSYS_COMPONENTS_OPTIONS);
-
-    printf("========================================================\n");
-    printf("== Running Application Services (non-platform)\n");
-    printf("========================================================\n");
-
-    RunDumpsys("APP SERVICES NON-PLATFORM", {"activity", "service", "all-non-platform"},
-            DUMPSYS_COMPONENTS_OPTIONS);
-
-    printf("========================================================\n");
-    printf("== Running Application Providers (platform)\n");
-    printf("========================================================\n");
-
-    RunDumpsys("APP PROVIDERS PLATFORM", {"activity", "provider", "all-platform"},
-            DUMPSYS_COMPONENTS_OPTIONS);
-
-    printf("========================================================\n");
-    printf("== Running Application Providers (non-platform)\n");
-    printf("========================================================\n");
+    if (dump_pool != nullptr) {
+        dump_pool->WaitForTask(DUMP_CHECKINS_TASK, STDOUT_FILENO);
+    } else {
+        DumpCheckins(STDOUT_FILENO);
+    }
+    // Matches the six checkin dumpsys calls with the default 30s timeout each.
+    ds.UpdateProgress(6 * 30);
 
-    RunDumpsys("APP PROVIDERS NON-PLATFORM", {"activity", "provider", "all-non-platform"},
-            DUMPSYS_COMPONENTS_OPTIONS);
+    if (dump_pool != nullptr) {
+        dump_pool->WaitForTask(DUMP_APP_INFOS_TASK, STDOUT_FILENO);
+    } else {
+        DumpAppInfos(STDOUT_FILENO);
+    }
+    // Matches the five app dumpsys calls with a 60s timeout each.
+    ds.UpdateProgress(5 * 60);
 
     printf("========================================================\n");
     printf("== Dropbox crashes\n");
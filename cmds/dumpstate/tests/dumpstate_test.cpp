@@ -17,6 +17,7 @@
 #define LOG_TAG "dumpstate"
 #include <cutils/log.h>
 
+#include "DumpPool.h"
 #include "DumpstateInternal.h"
 #include "DumpstateService.h"
 #include "android/os/BnDumpstate.h"
@@ -1268,6 +1269,55 @@ TEST_F(DumpstateUtilTest, FindingPidWithNotExistingProcess) {
     EXPECT_THAT(err, StrEq("can't find the pid\n"));
 }
 
+class DumpPoolTest : public DumpstateBaseTest {
+  public:
+    void SetUp() override {
+        DumpstateBaseTest::SetUp();
+        out_path_ = kTestDataPath + "DumpPoolTest.txt";
+        out_fd_ = TEMP_FAILURE_RETRY(open(out_path_.c_str(),
+                                          O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC | O_NOFOLLOW,
+                                          S_IRUSR | S_IWUSR));
+        ASSERT_GE(out_fd_, 0) << "could not create FD for path " << out_path_;
+    }
+
+    void TearDown() override {
+        close(out_fd_);
+        android::base::RemoveFileIfExists(out_path_);
+    }
+
+    std::string out_path_;
+    int out_fd_ = -1;
+};
+
+TEST_F(DumpPoolTest, MergesOutputInWaitOrder) {
+    DumpPool pool(kTestDataPath);
+    pool.Start(2);
+    pool.Enqueue("task1", [](int fd) { dprintf(fd, "one"); });
+    pool.Enqueue("task2", [](int fd) { dprintf(fd, "two"); });
+
+    // The merge order is defined by the waits, not by completion order.
+    EXPECT_TRUE(pool.WaitForTask("task2", out_fd_));
+    EXPECT_TRUE(pool.WaitForTask("task1", out_fd_));
+
+    std::string out;
+    ReadFileToString(out_path_, &out);
+    EXPECT_THAT(out, StrEq("twoone"));
+}
+
+TEST_F(DumpPoolTest, WaitForUnknownTask) {
+    DumpPool pool(kTestDataPath);
+    pool.Start(1);
+    EXPECT_FALSE(pool.WaitForTask("no such task", out_fd_));
+}
+
+TEST_F(DumpPoolTest, RemovesTemporaryFileAfterMerge) {
+    DumpPool pool(kTestDataPath);
+    pool.Start(1);
+    pool.Enqueue("cleanup task", [](int fd) { dprintf(fd, "data"); });
+    EXPECT_TRUE(pool.WaitForTask("cleanup task", out_fd_));
+    EXPECT_EQ(-1, access((kTestDataPath + "dump-cleanup_task.tmp").c_str(), F_OK));
+}
+
 }  // namespace dumpstate
 }  // namespace os
 }  // namespace android
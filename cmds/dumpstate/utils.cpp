@@ -38,6 +38,7 @@
 #include <time.h>
 #include <unistd.h>
 
+#include <atomic>
 #include <memory>
 #include <set>
 #include <string>
@@ -55,6 +56,7 @@
 #include <log/log.h>
 #include <private/android_filesystem_config.h>
 
+#include "DumpPool.h"
 #include "DumpstateInternal.h"
 
 // TODO: remove once moved to namespace
@@ -833,9 +835,13 @@ const char* DumpTracesTombstoned(const std::string& traces_dir) {
         return nullptr;
     }
 
-    // Number of times process dumping has timed out. If we encounter too many
-    // failures, we'll give up.
-    int timeout_failures = 0;
+    // First pass: decide which processes to dump. Scanning /proc is cheap;
+    // the expensive part is collecting the backtraces below.
+    struct ProcessToDump {
+        int pid;
+        bool is_java_process;
+    };
+    std::vector<ProcessToDump> processes;
     bool dalvik_found = false;
 
     const std::set<int> hal_pids = get_interesting_hal_pids();
@@ -869,31 +875,49 @@ const char* DumpTracesTombstoned(const std::string& traces_dir) {
             continue;
         }
 
-        // If 3 backtrace dumps fail in a row, consider debuggerd dead.
-        if (timeout_failures == 3) {
-            dprintf(fd, "ERROR: Too many stack dump failures, exiting.\n");
-            break;
-        }
+        processes.push_back({pid, is_java_process});
+    }
 
-        const uint64_t start = Nanotime();
-        const int ret = dump_backtrace_to_file_timeout(
-            pid, is_java_process ? kDebuggerdJavaBacktrace : kDebuggerdNativeBacktrace,
-            is_java_process ? 5 : 20, fd);
+    // Second pass: collect the backtraces concurrently, each process into its
+    // own temporary file, then splice them into the trace file in scan order
+    // so the section stays deterministic. Each dump keeps its own timeout, so
+    // the section completes in roughly the time of the slowest batch rather
+    // than the sum of all processes.
+    //
+    // Failures are counted across all workers. If 3 backtrace dumps fail,
+    // consider debuggerd dead and skip the remaining processes.
+    std::atomic<int> timeout_failures(0);
+    android::os::dumpstate::DumpPool pool(traces_dir);
+    pool.Start();
+    for (const auto& process : processes) {
+        const int pid = process.pid;
+        const bool is_java_process = process.is_java_process;
+        pool.Enqueue(std::to_string(pid), [pid, is_java_process, &timeout_failures](int out_fd) {
+            if (timeout_failures.load() >= 3) {
+                dprintf(out_fd, "ERROR: Too many stack dump failures, skipping pid %d.\n", pid);
+                return;
+            }
 
-        if (ret == -1) {
-            dprintf(fd, "dumping failed, likely due to a timeout\n");
-            timeout_failures++;
-            continue;
-        }
+            const uint64_t start = Nanotime();
+            const int ret = dump_backtrace_to_file_timeout(
+                pid, is_java_process ? kDebuggerdJavaBacktrace : kDebuggerdNativeBacktrace,
+                is_java_process ? 5 : 20, out_fd);
 
-        // We've successfully dumped stack traces, reset the failure count
-        // and write a summary of the elapsed time to the file and continue with the
-        // next process.
-        timeout_failures = 0;
+            if (ret == -1) {
+                dprintf(out_fd, "dumping failed, likely due to a timeout\n");
+                timeout_failures++;
+                return;
+            }
 
-        dprintf(fd, "[dump %s stack %d: %.3fs elapsed]\n", is_java_process ? "dalvik" : "native",
-                pid, (float)(Nanotime() - start) / NANOS_PER_SEC);
+            dprintf(out_fd, "[dump %s stack %d: %.3fs elapsed]\n",
+                    is_java_process ? "dalvik" : "native", pid,
+                    (float)(Nanotime() - start) / NANOS_PER_SEC);
+        });
+    }
+    for (const auto& process : processes) {
+        pool.WaitForTask(std::to_string(process.pid), fd);
     }
+    pool.Shutdown();
 
     if (!dalvik_found) {
         MYLOGE("Warning: no Dalvik processes found to dump stacks\n");
@@ -15,9 +15,11 @@
  */
 
 #include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <iomanip>
 #include <thread>
+#include <vector>
 
 #include <android-base/file.h>
 #include <android-base/stringprintf.h>
@@ -54,6 +56,10 @@ static int sort_func(const String16* lhs, const String16* rhs)
     return lhs->compare(*rhs);
 }
 
+// Upper bound on --pool; more threads than this mostly just pile up behind
+// the services' own binder thread pools.
+static const int kMaxPoolSize = 16;
+
 static void usage() {
     fprintf(stderr,
             "usage: dumpsys\n"
@@ -69,6 +75,8 @@ static void usage() {
             "               will be in proto format.\n"
             "         --priority LEVEL: filter services based on specified priority\n"
             "               LEVEL must be one of CRITICAL | HIGH | NORMAL\n"
+            "         --pool THREADS: dump services concurrently on up to THREADS threads\n"
+            "               (max 16), assembling the output in service order\n"
             "         --skip SERVICES: dumps all services but SERVICES (comma-separated list)\n"
             "         SERVICE [ARGS]: dumps only service SERVICE, optionally passing ARGS to it\n");
 }
@@ -121,9 +129,11 @@ int Dumpsys::main(int argc, char* const argv[]) {
     bool skipServices = false;
     bool asProto = false;
     int timeoutArgMs = 10000;
+    int poolSize = 1;
     int priorityFlags = IServiceManager::DUMP_FLAG_PRIORITY_ALL;
     static struct option longOptions[] = {{"priority", required_argument, 0, 0},
                                           {"proto", no_argument, 0, 0},
+                                          {"pool", required_argument, 0, 0},
                                           {"skip", no_argument, 0, 0},
                                           {"help", no_argument, 0, 0},
                                           {0, 0, 0, 0}};
@@ -150,6 +160,13 @@ int Dumpsys::main(int argc, char* const argv[]) {
             } else if (!strcmp(longOptions[optionIndex].name, "help")) {
                 usage();
                 return 0;
+            } else if (!strcmp(longOptions[optionIndex].name, "pool")) {
+                char* endptr;
+                poolSize = strtol(optarg, &endptr, 10);
+                if (*endptr != '\0' || poolSize <= 0 || poolSize > kMaxPoolSize) {
+                    fprintf(stderr, "Error: invalid pool size: '%s'\n", optarg);
+                    return -1;
+                }
             } else if (!strcmp(longOptions[optionIndex].name, "priority")) {
                 priorityType = String16(String8(optarg));
                 if (!ConvertPriorityTypeToBitmask(priorityType, priorityFlags)) {
@@ -236,6 +253,11 @@ int Dumpsys::main(int argc, char* const argv[]) {
         return 0;
     }
 
+    if (poolSize > 1 && N > 1) {
+        return dumpServicesInParallel(services, args, skippedServices, priorityFlags, asProto,
+                                      std::chrono::milliseconds(timeoutArgMs), poolSize);
+    }
+
     for (size_t i = 0; i < N; i++) {
         const String16& serviceName = services[i];
         if (IsSkipped(skippedServices, serviceName)) continue;
@@ -269,6 +291,161 @@ int Dumpsys::main(int argc, char* const argv[]) {
     return 0;
 }
 
+// Drains a service dump pipe |serviceFd| into |outFd|, mirroring
+// Dumpsys::writeDump except that only time spent waiting on the service is
+// charged against |timeout|. Workers write into bounded assembly pipes and
+// may block until the main thread catches up; that back-pressure must not
+// make a healthy service look timed out.
+static status_t drainServiceDump(int serviceFd, int outFd, const String16& serviceName,
+                                 std::chrono::milliseconds timeout, bool asProto,
+                                 std::chrono::duration<double>& elapsedDuration,
+                                 size_t& bytesWritten) {
+    status_t status = OK;
+    size_t totalBytes = 0;
+    auto start = std::chrono::steady_clock::now();
+    std::chrono::milliseconds waited(0);
+
+    struct pollfd pfd = {.fd = serviceFd, .events = POLLIN};
+
+    while (true) {
+        auto remainingMs = (timeout - waited).count();
+        if (remainingMs <= 0) {
+            status = TIMED_OUT;
+            break;
+        }
+
+        auto pollStart = std::chrono::steady_clock::now();
+        int rc = TEMP_FAILURE_RETRY(poll(&pfd, 1, static_cast<int>(remainingMs)));
+        waited += std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - pollStart);
+        if (rc < 0) {
+            aerr << "Error in poll while dumping service " << serviceName << " : "
+                 << strerror(errno) << endl;
+            status = -errno;
+            break;
+        } else if (rc == 0) {
+            status = TIMED_OUT;
+            break;
+        }
+
+        char buf[4096];
+        rc = TEMP_FAILURE_RETRY(read(serviceFd, buf, sizeof(buf)));
+        if (rc < 0) {
+            aerr << "Failed to read while dumping service " << serviceName << ": "
+                 << strerror(errno) << endl;
+            status = -errno;
+            break;
+        } else if (rc == 0) {
+            // EOF.
+            break;
+        }
+
+        if (!WriteFully(outFd, buf, rc)) {
+            aerr << "Failed to write while dumping service " << serviceName << ": "
+                 << strerror(errno) << endl;
+            status = -errno;
+            break;
+        }
+        totalBytes += rc;
+    }
+
+    if ((status == TIMED_OUT) && (!asProto)) {
+        std::string msg = StringPrintf("\n*** SERVICE '%s' DUMP TIMEOUT (%llums) EXPIRED ***\n\n",
+                                       String8(serviceName).string(), timeout.count());
+        WriteStringToFd(msg, outFd);
+    }
+
+    elapsedDuration = std::chrono::steady_clock::now() - start;
+    bytesWritten = totalBytes;
+    return status;
+}
+
+int Dumpsys::dumpServicesInParallel(const Vector<String16>& services, const Vector<String16>& args,
+                                    const Vector<String16>& skippedServices, int priorityFlags,
+                                    bool asProto, std::chrono::milliseconds timeout, int poolSize) {
+    const size_t N = services.size();
+
+    // One assembly pipe per service. A worker claims the next undumped
+    // service, runs the usual header/dump/footer sequence into the pipe's
+    // write end, and closes it when done; the main thread splices the read
+    // ends to stdout in service order, so the report is identical to a
+    // serial run. Pipe capacity bounds the memory a worker can run ahead by.
+    std::vector<unique_fd> readFds(N);
+    std::vector<unique_fd> writeFds(N);
+    for (size_t i = 0; i < N; i++) {
+        int sfd[2];
+        if (pipe(sfd) != 0) {
+            aerr << "Failed to create assembly pipe: " << strerror(errno) << endl;
+            return -1;
+        }
+        readFds[i] = unique_fd(sfd[0]);
+        writeFds[i] = unique_fd(sfd[1]);
+    }
+
+    std::atomic<size_t> nextService(0);
+    auto worker = [&]() {
+        // Each worker needs its own dump thread and redirect pipe state.
+        Dumpsys dumpsys(sm_);
+        while (true) {
+            const size_t i = nextService.fetch_add(1);
+            if (i >= N) break;
+            unique_fd& out = writeFds[i];
+            const String16& serviceName = services[i];
+            if (IsSkipped(skippedServices, serviceName) ||
+                dumpsys.startDumpThread(serviceName, args) != OK) {
+                out.reset();
+                continue;
+            }
+
+            writeDumpHeader(out.get(), serviceName, priorityFlags);
+            std::chrono::duration<double> elapsedDuration;
+            size_t bytesWritten = 0;
+            status_t status = drainServiceDump(dumpsys.getDumpFd(), out.get(), serviceName,
+                                               timeout, asProto, elapsedDuration, bytesWritten);
+            if (status == TIMED_OUT) {
+                // The serial path prints this a second time on stdout.
+                std::string msg =
+                    StringPrintf("\n*** SERVICE '%s' DUMP TIMEOUT (%llums) EXPIRED ***\n\n",
+                                 String8(serviceName).string(), timeout.count());
+                WriteStringToFd(msg, out.get());
+            }
+            writeDumpFooter(out.get(), serviceName, elapsedDuration);
+            dumpsys.stopDumpThread(/* dumpComplete = */ status == OK);
+            out.reset();
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < std::min(static_cast<size_t>(poolSize), N); i++) {
+        workers.emplace_back(worker);
+    }
+
+    for (size_t i = 0; i < N; i++) {
+        char buf[4096];
+        while (true) {
+            ssize_t rc = TEMP_FAILURE_RETRY(read(readFds[i].get(), buf, sizeof(buf)));
+            if (rc <= 0) {
+                if (rc < 0) {
+                    aerr << "Failed to read dump of service " << services[i] << ": "
+                         << strerror(errno) << endl;
+                }
+                break;
+            }
+            if (!WriteFully(STDOUT_FILENO, buf, rc)) {
+                aerr << "Failed to write dump of service " << services[i] << ": "
+                     << strerror(errno) << endl;
+                break;
+            }
+        }
+        readFds[i].reset();
+    }
+
+    for (auto& thread : workers) {
+        thread.join();
+    }
+    return 0;
+}
+
 Vector<String16> Dumpsys::listServices(int priorityFilterFlags, bool filterByProto) const {
     Vector<String16> services = sm_->listServices(priorityFilterFlags);
     services.sort(sort_func);
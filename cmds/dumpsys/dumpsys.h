@@ -116,6 +116,23 @@ class Dumpsys {
     }
 
   private:
+    /**
+     * Dumps the non-skipped services on a bounded pool of threads, writing each
+     * dump into its own pipe and splicing the pipes to stdout in service order
+     * so the output matches a sequential run.
+     * @param services full list of services to dump
+     * @param args list of arguments to pass to each service dump method.
+     * @param skippedServices services to skip
+     * @param priorityFlags dump priority specified
+     * @param asProto dump services in proto format
+     * @param timeout per-service timeout
+     * @param poolSize maximum number of dump threads
+     * @return {@code 0} on success
+     */
+    int dumpServicesInParallel(const Vector<String16>& services, const Vector<String16>& args,
+                               const Vector<String16>& skippedServices, int priorityFlags,
+                               bool asProto, std::chrono::milliseconds timeout, int poolSize);
+
     android::IServiceManager* sm_;
     std::thread activeThread_;
     mutable android::base::unique_fd redirectFd_;
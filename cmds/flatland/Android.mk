@@ -6,6 +6,7 @@ LOCAL_SRC_FILES:=   \
     Composers.cpp   \
     GLHelper.cpp    \
     Renderers.cpp   \
+    SurfaceFlingerScenario.cpp \
     Main.cpp        \
 
 LOCAL_CFLAGS := -Wall -Werror
@@ -21,6 +22,7 @@ LOCAL_MODULE_STEM_64 := flatland64
 LOCAL_SHARED_LIBRARIES := \
     libEGL      \
     libGLESv2   \
+    libbinder   \
     libcutils   \
     libgui      \
     libui       \
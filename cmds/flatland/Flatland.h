@@ -68,4 +68,8 @@ public:
 
 Renderer* staticGradient();
 
+// Run the SurfaceFlinger composition scenario (--sf) instead of the GLES
+// microbenchmarks. Defined in SurfaceFlingerScenario.cpp.
+bool runSurfaceFlingerScenario(size_t numLayers, uint32_t frames);
+
 } // namespace android
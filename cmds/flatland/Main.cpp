@@ -37,6 +37,8 @@ using namespace ::android;
 static uint32_t g_SleepBetweenSamplesMs = 0;
 static bool     g_PresentToWindow       = false;
 static size_t   g_BenchmarkNameLen      = 0;
+static size_t   g_SfLayers              = 0;
+static uint32_t g_SfFrames              = 600;
 
 struct BenchmarkDesc {
     // The name of the test.
@@ -723,6 +725,10 @@ static void showHelp(const char *cmd) {
     fprintf(stderr, "options include:\n"
                     "  -s N            sleep for N ms between samples\n"
                     "  -d              display the test frame to a window\n"
+                    "  --sf N          instead of the GLES microbenchmarks, drive the real\n"
+                    "                  SurfaceFlinger path with N scripted layers and report\n"
+                    "                  present latency and SurfaceFlinger TimeStats\n"
+                    "  --frames M      number of frames to run in --sf mode (default 600)\n"
                     "  --help          print this helpful message and exit\n"
             );
 }
@@ -737,8 +743,10 @@ int main(int argc, char** argv) {
         int ret;
         int option_index = 0;
         static struct option long_options[] = {
-            {"help",     no_argument, 0,  0 },
-            {     0,               0, 0,  0 }
+            {"help",     no_argument,       0,  0 },
+            {"sf",       required_argument, 0,  0 },
+            {"frames",   required_argument, 0,  0 },
+            {     0,               0,       0,  0 }
         };
 
         ret = getopt_long(argc, argv, "ds:",
@@ -758,9 +766,22 @@ int main(int argc, char** argv) {
             break;
 
             case 0:
-                if (strcmp(long_options[option_index].name, "help")) {
+                if (strcmp(long_options[option_index].name, "help") == 0) {
                     showHelp(argv[0]);
                     exit(0);
+                } else if (strcmp(long_options[option_index].name, "sf") == 0) {
+                    g_SfLayers = atoi(optarg);
+                    if (g_SfLayers == 0) {
+                        fprintf(stderr, "invalid layer count: %s\n", optarg);
+                        exit(2);
+                    }
+                } else if (strcmp(long_options[option_index].name,
+                        "frames") == 0) {
+                    g_SfFrames = atoi(optarg);
+                    if (g_SfFrames == 0) {
+                        fprintf(stderr, "invalid frame count: %s\n", optarg);
+                        exit(2);
+                    }
                 }
             break;
 
@@ -778,6 +799,14 @@ int main(int argc, char** argv) {
     }
     printf("\n");
 
+    if (g_SfLayers > 0) {
+        if (!runSurfaceFlingerScenario(g_SfLayers, g_SfFrames)) {
+            fprintf(stderr, "exiting due to error.\n");
+            return 1;
+        }
+        return 0;
+    }
+
     if (!runTests()) {
         fprintf(stderr, "exiting due to error.\n");
         return 1;
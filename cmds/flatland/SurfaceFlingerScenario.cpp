@@ -0,0 +1,263 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <vector>
+
+#include <binder/IServiceManager.h>
+#include <gui/ISurfaceComposer.h>
+#include <gui/Surface.h>
+#include <gui/SurfaceComposerClient.h>
+#include <gui/SurfaceControl.h>
+#include <system/window.h>
+#include <ui/DisplayInfo.h>
+#include <ui/PixelFormat.h>
+#include <utils/String16.h>
+#include <utils/String8.h>
+
+#include "Flatland.h"
+
+namespace android {
+
+// Present timestamps only become available a few frames after a buffer is
+// queued, once SurfaceFlinger has latched and presented it and the producer
+// has pulled the consumer-side events back.
+enum { FRAME_TIMESTAMP_DELAY = 3 };
+
+// Send a single --timestats command to SurfaceFlinger, writing whatever it
+// prints to outFd.
+static bool timeStatsCommand(const char* command, int outFd) {
+    sp<IBinder> flinger = defaultServiceManager()->checkService(
+            String16("SurfaceFlinger"));
+    if (flinger == NULL) {
+        fprintf(stderr, "error: could not find the SurfaceFlinger service.\n");
+        return false;
+    }
+
+    Vector<String16> args;
+    args.add(String16("--timestats"));
+    args.add(String16(command));
+    status_t err = flinger->dump(outFd, args);
+    if (err != NO_ERROR) {
+        fprintf(stderr, "error sending --timestats %s to SurfaceFlinger: %d\n",
+                command, err);
+        return false;
+    }
+    return true;
+}
+
+static bool fillSurface(const sp<Surface>& surface, uint32_t frame,
+        size_t layerIndex) {
+    ANativeWindow_Buffer buffer;
+    status_t err = surface->lock(&buffer, NULL);
+    if (err != NO_ERROR) {
+        fprintf(stderr, "error locking layer %zu: %d\n", layerIndex, err);
+        return false;
+    }
+
+    // A solid color that changes every frame, so every queued buffer carries
+    // new content and SurfaceFlinger cannot trivially skip the layer.
+    uint32_t color = 0xff000000 |
+            ((frame * 7 + layerIndex * 61) & 0xff) |
+            (((frame * 3 + layerIndex * 29) & 0xff) << 8) |
+            (((frame * 5 + layerIndex * 83) & 0xff) << 16);
+
+    uint32_t* pixels = reinterpret_cast<uint32_t*>(buffer.bits);
+    for (int32_t y = 0; y < buffer.height; y++) {
+        uint32_t* row = pixels + y * buffer.stride;
+        for (int32_t x = 0; x < buffer.width; x++) {
+            row[x] = color;
+        }
+    }
+
+    err = surface->unlockAndPost();
+    if (err != NO_ERROR) {
+        fprintf(stderr, "error posting layer %zu: %d\n", layerIndex, err);
+        return false;
+    }
+    return true;
+}
+
+static double toMs(nsecs_t ns) {
+    return double(ns) / 1e6;
+}
+
+// Drive the real SurfaceFlinger composition path: create numLayers windows,
+// post a new buffer and a scripted position update to each of them every
+// frame, and measure per-frame present latency from the frame timestamps of
+// the first layer. SurfaceFlinger's own per-layer timing is captured with
+// TimeStats around the run.
+bool runSurfaceFlingerScenario(size_t numLayers, uint32_t frames) {
+    sp<SurfaceComposerClient> session = new SurfaceComposerClient();
+    status_t err = session->initCheck();
+    if (err != NO_ERROR) {
+        fprintf(stderr, "error initializing SurfaceComposerClient: %d\n", err);
+        return false;
+    }
+
+    sp<IBinder> display = SurfaceComposerClient::getBuiltInDisplay(
+            ISurfaceComposer::eDisplayIdMain);
+    DisplayInfo info;
+    err = SurfaceComposerClient::getDisplayInfo(display, &info);
+    if (err != NO_ERROR) {
+        fprintf(stderr, "error getting display info: %d\n", err);
+        return false;
+    }
+
+    uint32_t layerSize = std::min(info.w, info.h) / 4;
+    if (layerSize == 0) {
+        fprintf(stderr, "error: bad display size %ux%u\n", info.w, info.h);
+        return false;
+    }
+
+    std::vector<sp<SurfaceControl> > controls;
+    std::vector<sp<Surface> > surfaces;
+    for (size_t i = 0; i < numLayers; i++) {
+        char name[64];
+        snprintf(name, sizeof(name), "flatland-sf-%zu", i);
+        sp<SurfaceControl> control = session->createSurface(String8(name),
+                layerSize, layerSize, PIXEL_FORMAT_RGBA_8888, 0);
+        if (control == NULL || !control->isValid()) {
+            fprintf(stderr, "error creating layer %zu.\n", i);
+            return false;
+        }
+        controls.push_back(control);
+        surfaces.push_back(control->getSurface());
+    }
+
+    // Spread the layers' home positions around the center of the display.
+    std::vector<float> homeX(numLayers);
+    std::vector<float> homeY(numLayers);
+    float radius = float(layerSize) / 2.0f;
+    for (size_t i = 0; i < numLayers; i++) {
+        float angle = 2.0f * M_PI * float(i) / float(numLayers);
+        homeX[i] = float(info.w - layerSize) *
+                (0.5f + 0.25f * cosf(angle));
+        homeY[i] = float(info.h - layerSize) *
+                (0.5f + 0.25f * sinf(angle));
+    }
+
+    SurfaceComposerClient::Transaction t;
+    for (size_t i = 0; i < numLayers; i++) {
+        t.setLayer(controls[i], 0x40000000 + int32_t(i))
+                .setPosition(controls[i], homeX[i], homeY[i])
+                .show(controls[i]);
+    }
+    t.apply(true /* synchronous */);
+
+    // Present latency is read back from the first layer.
+    native_window_enable_frame_timestamps(surfaces[0].get(), true);
+
+    int devNullFd = open("/dev/null", O_WRONLY | O_CLOEXEC);
+    if (devNullFd < 0) {
+        fprintf(stderr, "error opening /dev/null: %d\n", errno);
+        return false;
+    }
+    bool timeStats = timeStatsCommand("-clear", devNullFd) &&
+            timeStatsCommand("-enable", devNullFd);
+
+    std::vector<double> acquireToPresentMs;
+    std::vector<double> latchToPresentMs;
+    std::vector<uint64_t> pendingFrames;
+    size_t nextPending = 0;
+    bool success = true;
+
+    for (uint32_t frame = 0; frame < frames && success; frame++) {
+        // Scripted update: every frame each layer moves along a small circle
+        // around its home position, so composition sees both geometry and
+        // content changes.
+        SurfaceComposerClient::Transaction t2;
+        float phase = float(frame) * 0.1f;
+        for (size_t i = 0; i < numLayers; i++) {
+            float angle = phase + 2.0f * M_PI * float(i) / float(numLayers);
+            t2.setPosition(controls[i],
+                    homeX[i] + radius * cosf(angle),
+                    homeY[i] + radius * sinf(angle));
+        }
+        t2.apply();
+
+        for (size_t i = 0; i < numLayers && success; i++) {
+            success = fillSurface(surfaces[i], frame, i);
+        }
+        if (!success) {
+            break;
+        }
+        pendingFrames.push_back(surfaces[0]->getNextFrameNumber() - 1);
+
+        // Collect timestamps for frames that are old enough to have been
+        // presented.
+        while (nextPending + FRAME_TIMESTAMP_DELAY < pendingFrames.size()) {
+            nsecs_t acquire = -1, latch = -1, present = -1;
+            err = surfaces[0]->getFrameTimestamps(pendingFrames[nextPending],
+                    NULL /* requestedPresent */, &acquire, &latch,
+                    NULL /* firstRefreshStart */, NULL /* lastRefreshStart */,
+                    NULL /* gpuCompositionDone */, &present,
+                    NULL /* dequeueReady */, NULL /* release */);
+            if (err == NO_ERROR && present > 0) {
+                if (acquire > 0) {
+                    acquireToPresentMs.push_back(toMs(present - acquire));
+                }
+                if (latch > 0) {
+                    latchToPresentMs.push_back(toMs(present - latch));
+                }
+            }
+            nextPending++;
+        }
+    }
+
+    if (timeStats) {
+        printf("\nSurfaceFlinger TimeStats for the run:\n");
+        fflush(stdout);
+        timeStatsCommand("-dump", STDOUT_FILENO);
+        timeStatsCommand("-disable", devNullFd);
+    }
+    close(devNullFd);
+
+    if (success && !acquireToPresentMs.empty()) {
+        std::sort(acquireToPresentMs.begin(), acquireToPresentMs.end());
+        std::sort(latchToPresentMs.begin(), latchToPresentMs.end());
+        const std::vector<double>& a = acquireToPresentMs;
+        const std::vector<double>& l = latchToPresentMs;
+        printf("\nPresent latency over %zu sampled frames (%zu layers):\n",
+                a.size(), numLayers);
+        printf("  acquire -> present (ms): p50 %6.3f  p95 %6.3f  p99 %6.3f\n",
+                a[a.size() / 2], a[a.size() * 95 / 100],
+                a[a.size() * 99 / 100]);
+        if (!l.empty()) {
+            printf("  latch   -> present (ms): p50 %6.3f  p95 %6.3f  p99 %6.3f\n",
+                    l[l.size() / 2], l[l.size() * 95 / 100],
+                    l[l.size() * 99 / 100]);
+        }
+    } else if (success) {
+        fprintf(stderr, "warning: no present timestamps were collected; "
+                "is the display on?\n");
+    }
+
+    for (size_t i = 0; i < numLayers; i++) {
+        session->destroySurface(controls[i]->getHandle());
+    }
+    session->dispose();
+
+    return success;
+}
+
+} // namespace android
@@ -18,6 +18,9 @@
 
 #include "CacheTracker.h"
 
+#include <atomic>
+#include <thread>
+
 #include <fts.h>
 #include <sys/quota.h>
 #include <sys/xattr.h>
@@ -33,6 +36,9 @@ using android::base::StringPrintf;
 namespace android {
 namespace installd {
 
+// Bound on concurrent FTS walks when loading detailed cache items.
+static const size_t kMaxWalkThreads = 4;
+
 CacheTracker::CacheTracker(userid_t userId, appid_t appId, const std::string& quotaDevice) :
         cacheUsed(0), cacheQuota(0), mUserId(userId), mAppId(appId), mQuotaDevice(quotaDevice),
         mItemsLoaded(false) {
@@ -99,7 +105,8 @@ bool CacheTracker::loadQuotaStats() {
     }
 }
 
-void CacheTracker::loadItemsFrom(const std::string& path) {
+void CacheTracker::loadItemsFrom(const std::string& path,
+        std::vector<std::shared_ptr<CacheItem>>* collected) {
     FTS *fts;
     FTSENT *p;
     char *argv[] = { (char*) path.c_str(), nullptr };
@@ -119,7 +126,7 @@ void CacheTracker::loadItemsFrom(const std::string& path) {
         case FTS_SLNONE: {
             auto item = std::shared_ptr<CacheItem>(new CacheItem(p));
             p->fts_pointer = static_cast<void*>(item.get());
-            items.push_back(item);
+            collected->push_back(item);
         }
         }
 
@@ -170,9 +177,41 @@ void CacheTracker::loadItems() {
     items.clear();
 
     ATRACE_BEGIN("loadItems");
+    std::vector<std::string> walkPaths;
     for (const auto& path : mDataPaths) {
-        loadItemsFrom(read_path_inode(path, "cache", kXattrInodeCache));
-        loadItemsFrom(read_path_inode(path, "code_cache", kXattrInodeCodeCache));
+        walkPaths.push_back(read_path_inode(path, "cache", kXattrInodeCache));
+        walkPaths.push_back(read_path_inode(path, "code_cache", kXattrInodeCodeCache));
+    }
+
+    // Each walk root is an independent FTS traversal, so walk them on
+    // separate threads and merge the per-walk items before sorting. Items
+    // only reference other items from the same walk, and the merge keeps
+    // walk order so the sort below stays deterministic.
+    std::vector<std::vector<std::shared_ptr<CacheItem>>> walkItems(walkPaths.size());
+    if (walkPaths.size() <= 1) {
+        for (size_t i = 0; i < walkPaths.size(); i++) {
+            loadItemsFrom(walkPaths[i], &walkItems[i]);
+        }
+    } else {
+        std::atomic<size_t> nextWalk(0);
+        auto worker = [&]() {
+            while (true) {
+                const size_t i = nextWalk.fetch_add(1);
+                if (i >= walkPaths.size()) break;
+                loadItemsFrom(walkPaths[i], &walkItems[i]);
+            }
+        };
+        std::vector<std::thread> workers;
+        for (size_t i = 0; i < walkPaths.size() && i < kMaxWalkThreads; i++) {
+            workers.emplace_back(worker);
+        }
+        for (auto& thread : workers) {
+            thread.join();
+        }
+    }
+    for (auto& walk : walkItems) {
+        items.insert(items.end(), std::make_move_iterator(walk.begin()),
+                std::make_move_iterator(walk.end()));
     }
     ATRACE_END();
 
@@ -192,6 +231,11 @@ void CacheTracker::loadItems() {
     ATRACE_END();
 }
 
+void CacheTracker::invalidateItems() {
+    items.clear();
+    mItemsLoaded = false;
+}
+
 void CacheTracker::ensureItems() {
     if (mItemsLoaded) {
         return;
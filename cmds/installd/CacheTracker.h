@@ -50,6 +50,7 @@ public:
     void loadItems();
 
     void ensureItems();
+    void invalidateItems();
 
     int getCacheRatio();
 
@@ -67,7 +68,8 @@ private:
     std::vector<std::string> mDataPaths;
 
     bool loadQuotaStats();
-    void loadItemsFrom(const std::string& path);
+    void loadItemsFrom(const std::string& path,
+            std::vector<std::shared_ptr<CacheItem>>* collected);
 
     DISALLOW_COPY_AND_ASSIGN(CacheTracker);
 };
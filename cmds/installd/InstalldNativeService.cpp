@@ -19,6 +19,7 @@
 #define ATRACE_TAG ATRACE_TAG_PACKAGE_MANAGER
 
 #include <algorithm>
+#include <atomic>
 #include <errno.h>
 #include <fstream>
 #include <fts.h>
@@ -38,6 +39,7 @@
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <sys/xattr.h>
+#include <thread>
 #include <unistd.h>
 
 #include <android-base/logging.h>
@@ -95,6 +97,15 @@ static constexpr int kVerityPageSize = 4096;
 static constexpr size_t kSha256Size = 32;
 static constexpr const char* kPropApkVerityMode = "ro.apk_verity.mode";
 
+// Bound on concurrent cache tracker stats walks during freeCache. The walks
+// are I/O bound, so a handful of threads saturates most flash storage.
+static constexpr size_t kMaxCacheStatsThreads = 4;
+
+// Maximum age of the retained cache accounting index before freeCache falls
+// back to a full rescan. Apps write their cache directories without going
+// through installd, so retained totals drift and must be rebuilt periodically.
+static constexpr auto kCacheIndexMaxAge = std::chrono::minutes(5);
+
 // NOTE: keep in sync with Installer
 static constexpr int FLAG_CLEAR_CACHE_ONLY = 1 << 8;
 static constexpr int FLAG_CLEAR_CODE_CACHE_ONLY = 1 << 9;
@@ -593,6 +604,7 @@ binder::Status InstalldNativeService::clearAppData(const std::unique_ptr<std::st
     CHECK_ARGUMENT_UUID(uuid);
     CHECK_ARGUMENT_PACKAGE_NAME(packageName);
     std::lock_guard<std::recursive_mutex> lock(mLock);
+    invalidateCacheIndex(uuid);
 
     const char* uuid_ = uuid ? uuid->c_str() : nullptr;
     const char* pkgname = packageName.c_str();
@@ -671,6 +683,7 @@ binder::Status InstalldNativeService::destroyAppData(const std::unique_ptr<std::
     CHECK_ARGUMENT_UUID(uuid);
     CHECK_ARGUMENT_PACKAGE_NAME(packageName);
     std::lock_guard<std::recursive_mutex> lock(mLock);
+    invalidateCacheIndex(uuid);
 
     const char* uuid_ = uuid ? uuid->c_str() : nullptr;
     const char* pkgname = packageName.c_str();
@@ -706,6 +719,7 @@ binder::Status InstalldNativeService::fixupAppData(const std::unique_ptr<std::st
     ENFORCE_UID(AID_SYSTEM);
     CHECK_ARGUMENT_UUID(uuid);
     std::lock_guard<std::recursive_mutex> lock(mLock);
+    invalidateCacheIndex(uuid);
 
     const char* uuid_ = uuid ? uuid->c_str() : nullptr;
     for (auto user : get_known_users(uuid_)) {
@@ -813,6 +827,8 @@ binder::Status InstalldNativeService::moveCompleteApp(const std::unique_ptr<std:
     CHECK_ARGUMENT_UUID(toUuid);
     CHECK_ARGUMENT_PACKAGE_NAME(packageName);
     std::lock_guard<std::recursive_mutex> lock(mLock);
+    invalidateCacheIndex(fromUuid);
+    invalidateCacheIndex(toUuid);
 
     const char* from_uuid = fromUuid ? fromUuid->c_str() : nullptr;
     const char* to_uuid = toUuid ? toUuid->c_str() : nullptr;
@@ -973,6 +989,7 @@ binder::Status InstalldNativeService::destroyUserData(const std::unique_ptr<std:
     ENFORCE_UID(AID_SYSTEM);
     CHECK_ARGUMENT_UUID(uuid);
     std::lock_guard<std::recursive_mutex> lock(mLock);
+    invalidateCacheIndex(uuid);
 
     const char* uuid_ = uuid ? uuid->c_str() : nullptr;
     binder::Status res = ok();
@@ -1005,6 +1022,10 @@ binder::Status InstalldNativeService::destroyUserData(const std::unique_ptr<std:
     return res;
 }
 
+void InstalldNativeService::invalidateCacheIndex(const std::unique_ptr<std::string>& uuid) {
+    mCacheIndex.erase(uuid ? *uuid : std::string());
+}
+
 binder::Status InstalldNativeService::freeCache(const std::unique_ptr<std::string>& uuid,
         int64_t targetFreeBytes, int64_t cacheReservedBytes, int32_t flags) {
     ENFORCE_UID(AID_SYSTEM);
@@ -1034,50 +1055,73 @@ binder::Status InstalldNativeService::freeCache(const std::unique_ptr<std::strin
         // This new cache strategy fairly removes files from UIDs by deleting
         // files from the UIDs which are most over their allocated quota
 
-        // 1. Create trackers for every known UID
+        // 1. Create trackers for every known UID, reusing the retained index
+        // when it is still fresh. A fresh index answers the populate pass
+        // below from memory; item lists are always reloaded, lazily, for the
+        // UIDs the eviction loop actually touches.
         ATRACE_BEGIN("create");
-        std::unordered_map<uid_t, std::shared_ptr<CacheTracker>> trackers;
-        for (auto user : get_known_users(uuid_)) {
-            FTS *fts;
-            FTSENT *p;
-            auto ce_path = create_data_user_ce_path(uuid_, user);
-            auto de_path = create_data_user_de_path(uuid_, user);
-            auto media_path = findDataMediaPath(uuid, user) + "/Android/data/";
-            char *argv[] = { (char*) ce_path.c_str(), (char*) de_path.c_str(),
-                    (char*) media_path.c_str(), nullptr };
-            if (!(fts = fts_open(argv, FTS_PHYSICAL | FTS_NOCHDIR | FTS_XDEV, NULL))) {
-                return error("Failed to fts_open");
+        CacheIndex& index = mCacheIndex[uuid ? *uuid : std::string()];
+        auto& trackers = index.trackers;
+        const auto indexNow = std::chrono::steady_clock::now();
+        const bool indexFresh = !trackers.empty()
+                && (indexNow - index.loadedAt) < kCacheIndexMaxAge;
+        if (indexFresh) {
+            for (auto& it : trackers) {
+                it.second->invalidateItems();
+                // Quotas may have changed since the index was built.
+                {
+                    std::lock_guard<std::recursive_mutex> lock(mQuotasLock);
+                    it.second->cacheQuota = mCacheQuotas[it.first];
+                }
+                if (it.second->cacheQuota == 0) {
+                    it.second->cacheQuota = 67108864;
+                }
             }
-            while ((p = fts_read(fts)) != NULL) {
-                if (p->fts_info == FTS_D && p->fts_level == 1) {
-                    uid_t uid = p->fts_statp->st_uid;
-                    if (multiuser_get_app_id(uid) == AID_MEDIA_RW) {
-                        uid = (multiuser_get_app_id(p->fts_statp->st_gid) - AID_EXT_GID_START)
-                                + AID_APP_START;
-                    }
-                    auto search = trackers.find(uid);
-                    if (search != trackers.end()) {
-                        search->second->addDataPath(p->fts_path);
-                    } else {
-                        auto tracker = std::shared_ptr<CacheTracker>(new CacheTracker(
-                                multiuser_get_user_id(uid), multiuser_get_app_id(uid), device));
-                        tracker->addDataPath(p->fts_path);
-                        {
-                            std::lock_guard<std::recursive_mutex> lock(mQuotasLock);
-                            tracker->cacheQuota = mCacheQuotas[uid];
+        } else {
+            trackers.clear();
+            for (auto user : get_known_users(uuid_)) {
+                FTS *fts;
+                FTSENT *p;
+                auto ce_path = create_data_user_ce_path(uuid_, user);
+                auto de_path = create_data_user_de_path(uuid_, user);
+                auto media_path = findDataMediaPath(uuid, user) + "/Android/data/";
+                char *argv[] = { (char*) ce_path.c_str(), (char*) de_path.c_str(),
+                        (char*) media_path.c_str(), nullptr };
+                if (!(fts = fts_open(argv, FTS_PHYSICAL | FTS_NOCHDIR | FTS_XDEV, NULL))) {
+                    return error("Failed to fts_open");
+                }
+                while ((p = fts_read(fts)) != NULL) {
+                    if (p->fts_info == FTS_D && p->fts_level == 1) {
+                        uid_t uid = p->fts_statp->st_uid;
+                        if (multiuser_get_app_id(uid) == AID_MEDIA_RW) {
+                            uid = (multiuser_get_app_id(p->fts_statp->st_gid) - AID_EXT_GID_START)
+                                    + AID_APP_START;
                         }
-                        if (tracker->cacheQuota == 0) {
+                        auto search = trackers.find(uid);
+                        if (search != trackers.end()) {
+                            search->second->addDataPath(p->fts_path);
+                        } else {
+                            auto tracker = std::shared_ptr<CacheTracker>(new CacheTracker(
+                                    multiuser_get_user_id(uid), multiuser_get_app_id(uid), device));
+                            tracker->addDataPath(p->fts_path);
+                            {
+                                std::lock_guard<std::recursive_mutex> lock(mQuotasLock);
+                                tracker->cacheQuota = mCacheQuotas[uid];
+                            }
+                            if (tracker->cacheQuota == 0) {
 #if MEASURE_DEBUG
-                            LOG(WARNING) << "UID " << uid << " has no cache quota; assuming 64MB";
+                                LOG(WARNING) << "UID " << uid
+                                        << " has no cache quota; assuming 64MB";
 #endif
-                            tracker->cacheQuota = 67108864;
+                                tracker->cacheQuota = 67108864;
+                            }
+                            trackers[uid] = tracker;
                         }
-                        trackers[uid] = tracker;
+                        fts_set(fts, p, FTS_SKIP);
                     }
-                    fts_set(fts, p, FTS_SKIP);
                 }
+                fts_close(fts);
             }
-            fts_close(fts);
         }
         ATRACE_END();
 
@@ -1089,10 +1133,48 @@ binder::Status InstalldNativeService::freeCache(const std::unique_ptr<std::strin
         };
         std::priority_queue<std::shared_ptr<CacheTracker>,
                 std::vector<std::shared_ptr<CacheTracker>>, decltype(cmp)> queue(cmp);
+
+        // Stats for UIDs without working quota fall back to full tree walks,
+        // and with hundreds of trackers those walks dominate this pass. Each
+        // tracker only touches its own paths, so load them on a small worker
+        // pool, then fill the queue on this thread. A fresh index skips the
+        // stats pass entirely: its totals were maintained by the previous
+        // purge loop and by index invalidation on app data mutation.
+        std::vector<std::shared_ptr<CacheTracker>> pending;
+        pending.reserve(trackers.size());
         for (const auto& it : trackers) {
-            it.second->loadStats();
-            queue.push(it.second);
-            cacheTotal += it.second->cacheUsed;
+            pending.push_back(it.second);
+        }
+        if (!indexFresh) {
+            size_t statsWorkerCount = std::min(pending.size(), kMaxCacheStatsThreads);
+            if (statsWorkerCount <= 1) {
+                for (const auto& tracker : pending) {
+                    tracker->loadStats();
+                }
+            } else {
+                std::atomic<size_t> nextTracker(0);
+                auto statsWorker = [&]() {
+                    while (true) {
+                        const size_t i = nextTracker.fetch_add(1);
+                        if (i >= pending.size()) {
+                            break;
+                        }
+                        pending[i]->loadStats();
+                    }
+                };
+                std::vector<std::thread> statsWorkers;
+                for (size_t i = 0; i < statsWorkerCount; i++) {
+                    statsWorkers.emplace_back(statsWorker);
+                }
+                for (auto& thread : statsWorkers) {
+                    thread.join();
+                }
+            }
+            index.loadedAt = indexNow;
+        }
+        for (const auto& tracker : pending) {
+            queue.push(tracker);
+            cacheTotal += tracker->cacheUsed;
         }
         ATRACE_END();
 
@@ -1161,6 +1243,12 @@ binder::Status InstalldNativeService::freeCache(const std::unique_ptr<std::strin
         }
         ATRACE_END();
 
+        // In noop mode the loop above deducted sizes without deleting
+        // anything, so the retained totals no longer match the disk.
+        if (noop) {
+            trackers.clear();
+        }
+
     } else {
         return error("Legacy cache logic no longer supported");
     }
@@ -1979,6 +2067,104 @@ binder::Status InstalldNativeService::dexopt(const std::string& apkPath, int32_t
     return res ? error(res, error_msg) : ok();
 }
 
+binder::Status InstalldNativeService::dexoptBatch(const std::vector<std::string>& apkPaths,
+        const std::vector<int32_t>& uids, const std::vector<std::string>& packageNames,
+        const std::vector<std::string>& instructionSets,
+        const std::vector<int32_t>& dexoptNeeded, const std::vector<std::string>& outputPaths,
+        const std::vector<int32_t>& dexFlags, const std::vector<std::string>& compilerFilters,
+        const std::unique_ptr<std::string>& uuid,
+        const std::vector<std::string>& classLoaderContexts,
+        const std::vector<std::string>& seInfos, bool downgrade,
+        const std::vector<int32_t>& targetSdkVersions,
+        const std::vector<std::string>& profileNames,
+        const std::vector<std::string>& dexMetadataPaths,
+        const std::unique_ptr<std::string>& compilationReason, int32_t maxConcurrency,
+        std::vector<int32_t>* _aidl_return) {
+    ENFORCE_UID(AID_SYSTEM);
+    CHECK_ARGUMENT_UUID(uuid);
+
+    const size_t jobCount = apkPaths.size();
+    if (uids.size() != jobCount || packageNames.size() != jobCount ||
+            instructionSets.size() != jobCount || dexoptNeeded.size() != jobCount ||
+            outputPaths.size() != jobCount || dexFlags.size() != jobCount ||
+            compilerFilters.size() != jobCount || classLoaderContexts.size() != jobCount ||
+            seInfos.size() != jobCount || targetSdkVersions.size() != jobCount ||
+            profileNames.size() != jobCount || dexMetadataPaths.size() != jobCount) {
+        return error(EINVAL, "Mismatched dexopt batch array lengths");
+    }
+    for (size_t i = 0; i < jobCount; i++) {
+        CHECK_ARGUMENT_PATH(apkPaths[i]);
+        if (!packageNames[i].empty() && packageNames[i] != "*") {
+            CHECK_ARGUMENT_PACKAGE_NAME(packageNames[i]);
+        }
+        if (!outputPaths[i].empty()) {
+            CHECK_ARGUMENT_PATH(outputPaths[i]);
+        }
+        if (!dexMetadataPaths[i].empty()) {
+            CHECK_ARGUMENT_PATH(dexMetadataPaths[i]);
+        }
+    }
+    std::lock_guard<std::recursive_mutex> lock(mLock);
+
+    // Bound the number of concurrent dex2oat children by the requested limit
+    // and the core count. Each child still applies its own cgroup and priority
+    // policy from its dexFlags, so background batches compete with foreground
+    // work the same way individual dexopt calls do.
+    size_t workerCount = maxConcurrency < 1 ? 1 : static_cast<size_t>(maxConcurrency);
+    const size_t coreCount = std::thread::hardware_concurrency();
+    if (coreCount > 0 && workerCount > coreCount) {
+        workerCount = coreCount;
+    }
+    if (workerCount > jobCount) {
+        workerCount = jobCount;
+    }
+
+    _aidl_return->assign(jobCount, 0);
+    std::vector<int32_t>& results = *_aidl_return;
+    std::atomic<size_t> nextJob(0);
+
+    // Workers claim the next unstarted job so that long compilations don't
+    // stall the jobs queued behind them on the same worker. Each worker writes
+    // only its own jobs' result slots.
+    auto worker = [&]() {
+        while (true) {
+            const size_t i = nextJob.fetch_add(1);
+            if (i >= jobCount) {
+                break;
+            }
+            const char* pkgname = packageNames[i].empty() ? "*" : packageNames[i].c_str();
+            std::string error_msg;
+            const int res = android::installd::dexopt(apkPaths[i].c_str(), uids[i], pkgname,
+                    instructionSets[i].c_str(), dexoptNeeded[i],
+                    outputPaths[i].empty() ? nullptr : outputPaths[i].c_str(), dexFlags[i],
+                    compilerFilters[i].c_str(), getCStr(uuid),
+                    classLoaderContexts[i].empty() ? nullptr : classLoaderContexts[i].c_str(),
+                    seInfos[i].empty() ? nullptr : seInfos[i].c_str(), downgrade,
+                    targetSdkVersions[i],
+                    profileNames[i].empty() ? nullptr : profileNames[i].c_str(),
+                    dexMetadataPaths[i].empty() ? nullptr : dexMetadataPaths[i].c_str(),
+                    getCStr(compilationReason), &error_msg);
+            results[i] = res;
+            if (res != 0) {
+                LOG(ERROR) << "Batch dexopt of " << apkPaths[i] << " failed: " << error_msg;
+            }
+        }
+    };
+
+    if (workerCount <= 1) {
+        worker();
+    } else {
+        std::vector<std::thread> workers;
+        for (size_t i = 0; i < workerCount; i++) {
+            workers.emplace_back(worker);
+        }
+        for (auto& thread : workers) {
+            thread.join();
+        }
+    }
+    return ok();
+}
+
 binder::Status InstalldNativeService::markBootComplete(const std::string& instructionSet) {
     ENFORCE_UID(AID_SYSTEM);
     std::lock_guard<std::recursive_mutex> lock(mLock);
@@ -21,6 +21,8 @@
 #include <inttypes.h>
 #include <unistd.h>
 
+#include <chrono>
+#include <memory>
 #include <vector>
 #include <unordered_map>
 
@@ -34,6 +36,8 @@
 namespace android {
 namespace installd {
 
+class CacheTracker;
+
 class InstalldNativeService : public BinderService<InstalldNativeService>, public os::BnInstalld {
 public:
     static status_t start();
@@ -89,6 +93,21 @@ public:
             const std::unique_ptr<std::string>& dexMetadataPath,
             const std::unique_ptr<std::string>& compilationReason);
 
+    binder::Status dexoptBatch(const std::vector<std::string>& apkPaths,
+            const std::vector<int32_t>& uids, const std::vector<std::string>& packageNames,
+            const std::vector<std::string>& instructionSets,
+            const std::vector<int32_t>& dexoptNeeded, const std::vector<std::string>& outputPaths,
+            const std::vector<int32_t>& dexFlags,
+            const std::vector<std::string>& compilerFilters,
+            const std::unique_ptr<std::string>& uuid,
+            const std::vector<std::string>& classLoaderContexts,
+            const std::vector<std::string>& seInfos, bool downgrade,
+            const std::vector<int32_t>& targetSdkVersions,
+            const std::vector<std::string>& profileNames,
+            const std::vector<std::string>& dexMetadataPaths,
+            const std::unique_ptr<std::string>& compilationReason, int32_t maxConcurrency,
+            std::vector<int32_t>* _aidl_return);
+
     binder::Status rmdex(const std::string& codePath, const std::string& instructionSet);
 
     binder::Status mergeProfiles(int32_t uid, const std::string& packageName,
@@ -156,6 +175,22 @@ private:
     /* Map from UID to cache quota size */
     std::unordered_map<uid_t, int64_t> mCacheQuotas;
 
+    /*
+     * Cache accounting index retained between freeCache calls, keyed by
+     * volume UUID. Totals are maintained incrementally: the purge loop in
+     * freeCache deducts freed bytes, and operations that mutate app data
+     * outside of that loop drop the affected volume from the index. Entries
+     * expire after kCacheIndexMaxAge to pick up writes made directly by
+     * apps, which never pass through installd. Guarded by mLock.
+     */
+    struct CacheIndex {
+        std::unordered_map<uid_t, std::shared_ptr<CacheTracker>> trackers;
+        std::chrono::steady_clock::time_point loadedAt;
+    };
+    std::unordered_map<std::string, CacheIndex> mCacheIndex;
+
+    void invalidateCacheIndex(const std::unique_ptr<std::string>& uuid);
+
     std::string findDataMediaPath(const std::unique_ptr<std::string>& uuid, userid_t userid);
     std::string findQuotaDeviceForUuid(const std::unique_ptr<std::string>& uuid);
 };
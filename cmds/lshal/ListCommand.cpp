@@ -18,12 +18,14 @@
 
 #include <getopt.h>
 
+#include <atomic>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
 #include <map>
 #include <sstream>
 #include <regex>
+#include <thread>
 
 #include <android-base/file.h>
 #include <android-base/parseint.h>
@@ -54,6 +56,11 @@ vintf::SchemaType toSchemaType(Partition p) {
     return (p == Partition::SYSTEM) ? vintf::SchemaType::FRAMEWORK : vintf::SchemaType::DEVICE;
 }
 
+// Number of threads on which registered HALs are queried. Each query is a
+// handful of IPCs that may each take up to IPC_CALL_WAIT, so slow HALs
+// dominate the runtime when probed one at a time.
+static constexpr size_t kFetchThreads = 8;
+
 NullableOStream<std::ostream> ListCommand::out() const {
     return mLshal.out();
 }
@@ -212,6 +219,10 @@ bool ListCommand::getPidInfo(
 }
 
 const PidInfo* ListCommand::getPidInfoCached(pid_t serverPid) {
+    // Hold the lock across getPidInfo so that concurrent fetch workers asking
+    // about the same process scan /d/binder only once; the scan is cheap
+    // compared to the HAL IPCs, which stay parallel.
+    std::lock_guard<std::mutex> lock(mFetchLock);
     auto pair = mCachedPidInfos.insert({serverPid, PidInfo{}});
     if (pair.second /* did insertion take place? */) {
         if (!getPidInfo(serverPid, &pair.first->second)) {
@@ -569,15 +580,42 @@ Status ListCommand::fetchBinderized(const sp<IServiceManager> &manager) {
         return DUMP_BINDERIZED_ERROR;
     }
 
-    Status status = OK;
     std::map<std::string, TableEntry> allTableEntries;
+    std::vector<TableEntry*> entries;
     for (const auto &fqInstanceName : fqInstanceNames) {
         // create entry and default assign all fields.
         TableEntry& entry = allTableEntries[fqInstanceName];
         entry.interfaceName = fqInstanceName;
         entry.transport = mode;
+        entries.push_back(&entry);
+    }
 
-        status |= fetchBinderizedEntry(manager, &entry);
+    // Each entry is written by exactly one worker; err() and the pid info
+    // cache are guarded by mFetchLock.
+    Status status = OK;
+    const size_t threadCount = std::min(kFetchThreads, entries.size());
+    if (threadCount <= 1) {
+        for (TableEntry* entry : entries) {
+            status |= fetchBinderizedEntry(manager, entry);
+        }
+    } else {
+        std::atomic<size_t> nextEntry(0);
+        std::mutex statusLock;
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < threadCount; ++i) {
+            threads.emplace_back([&]() {
+                Status threadStatus = OK;
+                size_t idx;
+                while ((idx = nextEntry.fetch_add(1)) < entries.size()) {
+                    threadStatus |= fetchBinderizedEntry(manager, entries[idx]);
+                }
+                std::lock_guard<std::mutex> lock(statusLock);
+                status |= threadStatus;
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
     }
 
     for (auto& pair : allTableEntries) {
@@ -590,6 +628,7 @@ Status ListCommand::fetchBinderizedEntry(const sp<IServiceManager> &manager,
                                          TableEntry *entry) {
     Status status = OK;
     const auto handleError = [&](Status additionalError, const std::string& msg) {
+        std::lock_guard<std::mutex> lock(mFetchLock);
         err() << "Warning: Skipping \"" << entry->interfaceName << "\": " << msg << std::endl;
         status |= DUMP_BINDERIZED_ERROR | additionalError;
     };
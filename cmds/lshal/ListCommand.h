@@ -21,6 +21,7 @@
 #include <stdint.h>
 
 #include <fstream>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -147,6 +148,10 @@ protected:
     // Cache for getPidInfo.
     std::map<pid_t, PidInfo> mCachedPidInfos;
 
+    // Serializes access to err() and mCachedPidInfos while entries are
+    // fetched on the worker pool in fetchBinderized.
+    mutable std::mutex mFetchLock;
+
     // Cache for getPartition.
     std::map<pid_t, Partition> mPartitions;
 
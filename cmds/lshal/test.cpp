@@ -17,6 +17,7 @@
 #define LOG_TAG "Lshal"
 #include <android-base/logging.h>
 
+#include <set>
 #include <sstream>
 #include <string>
 #include <thread>
@@ -417,6 +418,39 @@ TEST_F(ListTest, Fetch) {
 
 }
 
+// The fetch worker pool must produce the same table as a serial fetch, with
+// more registered services than worker threads.
+TEST_F(ListTest, FetchMoreServicesThanFetchThreads) {
+    ON_CALL(*serviceManager, list(_)).WillByDefault(Invoke(
+        [] (IServiceManager::list_cb cb) {
+            std::vector<hidl_string> names;
+            for (pid_t id = 1; id <= 20; ++id) {
+                names.push_back(getFqInstanceName(id));
+            }
+            cb(names);
+            return hardware::Void();
+        }));
+
+    EXPECT_EQ(0u, mockList->fetch());
+
+    bool checked = false;
+    mockList->forEachTable([&](const Table& table) {
+        if (checked) return; // only check mServicesTable
+        checked = true;
+        ASSERT_EQ(20u, table.size());
+        std::set<pid_t> ids;
+        for (const auto& entry : table) {
+            pid_t id = getIdFromInstanceName(splitFirst(entry.interfaceName, '/').second);
+            EXPECT_EQ(getFqInstanceName(id), entry.interfaceName);
+            EXPECT_EQ(id, entry.serverPid);
+            EXPECT_EQ(getPtr(id), entry.serverObjectAddress);
+            ids.insert(id);
+        }
+        EXPECT_EQ(20u, ids.size());
+    });
+    EXPECT_TRUE(checked);
+}
+
 TEST_F(ListTest, DumpVintf) {
     const std::string expected =
         "<!-- \n"
@@ -135,6 +135,7 @@ static int svc_can_find(const uint16_t *name, size_t name_len, pid_t spid, uid_t
 struct svcinfo
 {
     struct svcinfo *next;
+    struct svcinfo *hash_next;
     uint32_t handle;
     struct binder_death death;
     int allow_isolated;
@@ -145,13 +146,46 @@ struct svcinfo
 
 struct svcinfo *svclist = NULL;
 
+/* Hash table over svclist, chained through hash_next, so that lookups don't
+ * walk the whole list. svclist is kept as the canonical (insertion-ordered)
+ * list for SVC_MGR_LIST_SERVICES. Entries are never unlinked: a dead service
+ * only has its handle cleared, so there is no removal path to maintain.
+ */
+#define SVC_HASH_BUCKETS 256 /* must be a power of two */
+
+static struct svcinfo *svchash[SVC_HASH_BUCKETS];
+
+/* Cache for the most recently found service; lookups for the same name
+ * come in bursts (e.g. getService retry loops during boot).
+ */
+static struct svcinfo *last_found_svc;
+
+static uint32_t svc_hash(const uint16_t *s16, size_t len)
+{
+    /* FNV-1a over the code units */
+    uint32_t h = 2166136261u;
+    size_t i;
+
+    for (i = 0; i < len; i++) {
+        h = (h ^ s16[i]) * 16777619u;
+    }
+    return h & (SVC_HASH_BUCKETS - 1);
+}
+
 struct svcinfo *find_svc(const uint16_t *s16, size_t len)
 {
     struct svcinfo *si;
 
-    for (si = svclist; si; si = si->next) {
+    si = last_found_svc;
+    if (si && (len == si->len) &&
+        !memcmp(s16, si->name, len * sizeof(uint16_t))) {
+        return si;
+    }
+
+    for (si = svchash[svc_hash(s16, len)]; si; si = si->hash_next) {
         if ((len == si->len) &&
             !memcmp(s16, si->name, len * sizeof(uint16_t))) {
+            last_found_svc = si;
             return si;
         }
     }
@@ -224,6 +258,8 @@ int do_add_service(struct binder_state *bs, const uint16_t *s, size_t len, uint3
         }
         si->handle = handle;
     } else {
+        uint32_t h;
+
         si = malloc(sizeof(*si) + (len + 1) * sizeof(uint16_t));
         if (!si) {
             ALOGE("add_service('%s',%x) uid=%d - OUT OF MEMORY\n",
@@ -240,6 +276,9 @@ int do_add_service(struct binder_state *bs, const uint16_t *s, size_t len, uint3
         si->dumpsys_priority = dumpsys_priority;
         si->next = svclist;
         svclist = si;
+        h = svc_hash(si->name, si->len);
+        si->hash_next = svchash[h];
+        svchash[h] = si;
     }
 
     binder_acquire(bs, handle);
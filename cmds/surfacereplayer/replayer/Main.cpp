@@ -51,6 +51,15 @@ void printHelpMenu() {
 
     std::cout << "  -l  Indefinitely loop the replayer\n";
 
+    std::cout << "  -x [Speed]  Scale replay speed by this factor (e.g. 2.0 replays "
+                 "twice as fast, 0.5 at half speed)\n";
+
+    std::cout << "  -v  Schedule vsync increments against the device's hardware vsync "
+                 "instead of injecting vsyncs into SurfaceFlinger\n";
+
+    std::cout << "  -r  Print a timing report after the replay comparing replayed frame "
+                 "timing against the trace\n";
+
     std::cout << "  -h  Display help menu\n";
 
     std::cout << std::endl;
@@ -63,9 +72,12 @@ int main(int argc, char** argv) {
     bool pauseBeginning = false;
     int numThreads = DEFAULT_THREADS;
     long stopHere = -1;
+    float speed = 1.0f;
+    bool alignToVSync = false;
+    bool timingReport = false;
 
     int opt = 0;
-    while ((opt = getopt(argc, argv, "mt:s:nlh?")) != -1) {
+    while ((opt = getopt(argc, argv, "mt:s:nlx:vrh?")) != -1) {
         switch (opt) {
             case 'm':
                 pauseBeginning = true;
@@ -82,6 +94,19 @@ int main(int argc, char** argv) {
             case 'l':
                 loop = true;
                 break;
+            case 'x':
+                speed = atof(optarg);
+                if (speed <= 0.0f) {
+                    std::cerr << "Replay speed must be positive...exiting" << std::endl;
+                    exit(1);
+                }
+                break;
+            case 'v':
+                alignToVSync = true;
+                break;
+            case 'r':
+                timingReport = true;
+                break;
             case 'h':
             case '?':
                 printHelpMenu();
@@ -102,7 +127,8 @@ int main(int argc, char** argv) {
 
     status_t status = NO_ERROR;
     do {
-        android::Replayer r(filename, pauseBeginning, numThreads, wait, stopHere);
+        android::Replayer r(filename, pauseBeginning, numThreads, wait, stopHere, speed,
+                alignToVSync, timingReport);
         status = r.replay();
     } while(loop);
 
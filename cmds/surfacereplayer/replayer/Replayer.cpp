@@ -33,6 +33,8 @@
 #include <utils/String8.h>
 #include <utils/Trace.h>
 
+#include <poll.h>
+
 #include <chrono>
 #include <cmath>
 #include <condition_variable>
@@ -48,17 +50,29 @@
 
 using namespace android;
 
+// If the main loop falls this far behind its schedule (console pauses, slow
+// IPC), the timebase is re-anchored instead of replaying the backlog as one
+// burst. Small overshoots are absorbed so sleep jitter does not accumulate.
+static const nsecs_t REANCHOR_THRESHOLD_NS = 50000000;  // 50ms
+
+// How long to wait for a hardware vsync before assuming the display is not
+// producing them (e.g. it is blanked) and falling back to the current time.
+static const int VSYNC_POLL_TIMEOUT_MS = 100;
+
 std::atomic_bool Replayer::sReplayingManually(false);
 
 Replayer::Replayer(const std::string& filename, bool replayManually, int numThreads, bool wait,
-        nsecs_t stopHere)
+        nsecs_t stopHere, float speed, bool alignToVSync, bool emitTimingReport)
       : mTrace(),
         mLoaded(false),
         mIncrementIndex(0),
         mCurrentTime(0),
         mNumThreads(numThreads),
         mWaitForTimeStamps(wait),
-        mStopTimeStamp(stopHere) {
+        mStopTimeStamp(stopHere),
+        mSpeed(speed),
+        mAlignToVSync(alignToVSync),
+        mEmitTimingReport(emitTimingReport) {
     srand(RAND_COLOR_SEED);
 
     std::string input;
@@ -82,14 +96,18 @@ Replayer::Replayer(const std::string& filename, bool replayManually, int numThre
     }
 }
 
-Replayer::Replayer(const Trace& t, bool replayManually, int numThreads, bool wait, nsecs_t stopHere)
+Replayer::Replayer(const Trace& t, bool replayManually, int numThreads, bool wait, nsecs_t stopHere,
+        float speed, bool alignToVSync, bool emitTimingReport)
       : mTrace(t),
         mLoaded(true),
         mIncrementIndex(0),
         mCurrentTime(0),
         mNumThreads(numThreads),
         mWaitForTimeStamps(wait),
-        mStopTimeStamp(stopHere) {
+        mStopTimeStamp(stopHere),
+        mSpeed(speed),
+        mAlignToVSync(alignToVSync),
+        mEmitTimingReport(emitTimingReport) {
     srand(RAND_COLOR_SEED);
     mCurrentTime = mTrace.increment(0).time_stamp();
 
@@ -112,10 +130,27 @@ status_t Replayer::replay() {
         return status;
     }
 
-    SurfaceComposerClient::enableVSyncInjections(true);
+    if (mAlignToVSync) {
+        // Vsync increments are replayed against the device's real vsync, so
+        // do not take over SurfaceFlinger's vsync with injections.
+        auto receiver = std::make_unique<DisplayEventReceiver>();
+        if (receiver->initCheck() == NO_ERROR) {
+            mVSyncReceiver = std::move(receiver);
+        } else {
+            ALOGE("Couldn't create DisplayEventReceiver, falling back to vsync injection");
+            mAlignToVSync = false;
+        }
+    }
+
+    if (!mAlignToVSync) {
+        SurfaceComposerClient::enableVSyncInjections(true);
+    }
 
     initReplay();
 
+    mRealTimeBase = systemTime();
+    mTraceTimeBase = mCurrentTime;
+
     ALOGV("Starting actual Replay!");
     while (!mPendingIncrements.empty()) {
         mCurrentIncrement = mTrace.increment(mIncrementIndex);
@@ -155,6 +190,10 @@ status_t Replayer::replay() {
 
     SurfaceComposerClient::enableVSyncInjections(false);
 
+    if (mEmitTimingReport) {
+        printTimingReport();
+    }
+
     return status;
 }
 
@@ -674,7 +713,17 @@ status_t Replayer::injectVSyncEvent(
 
     event->readyToExecute();
 
-    SurfaceComposerClient::injectVSync(vSyncEvent.when());
+    if (mVSyncReceiver != nullptr) {
+        nsecs_t replayTime = waitForNextHardwareVSync();
+        if (mEmitTimingReport) {
+            recordVSync(vSyncEvent.when(), replayTime);
+        }
+    } else {
+        SurfaceComposerClient::injectVSync(vSyncEvent.when());
+        if (mEmitTimingReport) {
+            recordVSync(vSyncEvent.when(), systemTime());
+        }
+    }
 
     return NO_ERROR;
 }
@@ -709,8 +758,96 @@ void Replayer::updatePowerMode(const PowerModeUpdate& pmu, const std::shared_ptr
 }
 
 void Replayer::waitUntilTimestamp(int64_t timestamp) {
-    ALOGV("Waiting for %lld nanoseconds...", static_cast<int64_t>(timestamp - mCurrentTime));
-    std::this_thread::sleep_for(std::chrono::nanoseconds(timestamp - mCurrentTime));
+    nsecs_t target = mRealTimeBase +
+            static_cast<nsecs_t>(static_cast<double>(timestamp - mTraceTimeBase) / mSpeed);
+    nsecs_t now = systemTime();
+
+    ALOGV("Waiting for %lld nanoseconds...", static_cast<int64_t>(target - now));
+
+    if (target > now) {
+        std::this_thread::sleep_for(std::chrono::nanoseconds(target - now));
+    } else if (now - target > REANCHOR_THRESHOLD_NS) {
+        mRealTimeBase += now - target;
+        target = now;
+    }
+
+    if (mEmitTimingReport) {
+        nsecs_t drift = systemTime() - target;
+        if (drift > 0) {
+            std::lock_guard<std::mutex> lock(mTimingLock);
+            mTotalDispatchDrift += drift;
+            if (drift > mMaxDispatchDrift) {
+                mMaxDispatchDrift = drift;
+            }
+            mDispatchCount++;
+        }
+    }
+}
+
+nsecs_t Replayer::waitForNextHardwareVSync() {
+    std::lock_guard<std::mutex> lock(mVSyncReceiverLock);
+
+    mVSyncReceiver->requestNextVsync();
+
+    struct pollfd pfd = {mVSyncReceiver->getFd(), POLLIN, 0};
+    while (true) {
+        int ret = TEMP_FAILURE_RETRY(poll(&pfd, 1, VSYNC_POLL_TIMEOUT_MS));
+        if (ret <= 0) {
+            ALOGW("Timed out waiting for hardware vsync, is the display on?");
+            return systemTime();
+        }
+
+        DisplayEventReceiver::Event buffer[8];
+        nsecs_t vsyncTime = -1;
+        ssize_t n;
+        while ((n = mVSyncReceiver->getEvents(buffer, 8)) > 0) {
+            for (ssize_t i = 0; i < n; i++) {
+                if (buffer[i].header.type == DisplayEventReceiver::DISPLAY_EVENT_VSYNC) {
+                    vsyncTime = buffer[i].header.timestamp;
+                }
+            }
+        }
+
+        if (vsyncTime >= 0) {
+            return vsyncTime;
+        }
+    }
+}
+
+void Replayer::recordVSync(int64_t traceTime, nsecs_t replayTime) {
+    std::lock_guard<std::mutex> lock(mTimingLock);
+    mVSyncTimes.push_back(std::make_pair(traceTime, replayTime));
+}
+
+void Replayer::printTimingReport() {
+    std::lock_guard<std::mutex> lock(mTimingLock);
+
+    std::cout << "Replay timing report (speed " << mSpeed << ", "
+              << (mVSyncReceiver != nullptr ? "hardware vsync" : "injected vsync") << "):"
+              << std::endl;
+
+    if (mDispatchCount > 0) {
+        std::cout << "  Increment dispatch drift vs schedule over " << mDispatchCount
+                  << " timed increments: avg "
+                  << static_cast<double>(mTotalDispatchDrift / mDispatchCount) / 1e6
+                  << " ms, max " << static_cast<double>(mMaxDispatchDrift) / 1e6 << " ms"
+                  << std::endl;
+    }
+
+    if (mVSyncTimes.size() > 1) {
+        std::cout << "  Frame intervals, trace vs replay:" << std::endl;
+        char line[128];
+        for (size_t i = 1; i < mVSyncTimes.size(); i++) {
+            double traceMs =
+                    static_cast<double>(mVSyncTimes[i].first - mVSyncTimes[i - 1].first) / 1e6;
+            double replayMs =
+                    static_cast<double>(mVSyncTimes[i].second - mVSyncTimes[i - 1].second) / 1e6;
+            snprintf(line, sizeof(line),
+                    "    frame %4zu: trace %8.3f ms, replay %8.3f ms, diff %+8.3f ms", i, traceMs,
+                    replayMs, replayMs - traceMs / mSpeed);
+            std::cout << line << std::endl;
+        }
+    }
 }
 
 void Replayer::waitUntilDeferredTransactionLayerExists(
@@ -23,6 +23,7 @@
 
 #include <frameworks/native/cmds/surfacereplayer/proto/src/trace.pb.h>
 
+#include <gui/DisplayEventReceiver.h>
 #include <gui/SurfaceComposerClient.h>
 #include <gui/SurfaceControl.h>
 
@@ -37,6 +38,7 @@
 #include <thread>
 #include <unordered_map>
 #include <utility>
+#include <vector>
 
 namespace android {
 
@@ -53,9 +55,11 @@ typedef google::protobuf::RepeatedPtrField<DisplayChange> DisplayChanges;
 class Replayer {
   public:
     Replayer(const std::string& filename, bool replayManually = false,
-            int numThreads = DEFAULT_THREADS, bool wait = true, nsecs_t stopHere = -1);
+            int numThreads = DEFAULT_THREADS, bool wait = true, nsecs_t stopHere = -1,
+            float speed = 1.0f, bool alignToVSync = false, bool emitTimingReport = false);
     Replayer(const Trace& trace, bool replayManually = false, int numThreads = DEFAULT_THREADS,
-            bool wait = true, nsecs_t stopHere = -1);
+            bool wait = true, nsecs_t stopHere = -1, float speed = 1.0f,
+            bool alignToVSync = false, bool emitTimingReport = false);
 
     status_t replay();
 
@@ -122,6 +126,9 @@ class Replayer {
 
     void doDeleteSurfaceControls();
     void waitUntilTimestamp(int64_t timestamp);
+    nsecs_t waitForNextHardwareVSync();
+    void recordVSync(int64_t traceTime, nsecs_t replayTime);
+    void printTimingReport();
     void waitUntilDeferredTransactionLayerExists(
             const DeferredTransactionChange& dtc, std::unique_lock<std::mutex>& lock);
     status_t loadSurfaceComposerClient();
@@ -142,6 +149,29 @@ class Replayer {
     nsecs_t mStopTimeStamp;
     bool mHasStopped;
 
+    // Timed replay state. Increments are scheduled against a real-time anchor
+    // taken when the replay starts (mRealTimeBase maps to mTraceTimeBase), so
+    // sleep jitter does not accumulate across increments the way back-to-back
+    // relative sleeps would. mSpeed scales the trace deltas (2.0 replays twice
+    // as fast).
+    float mSpeed = 1.0f;
+    bool mAlignToVSync = false;
+    bool mEmitTimingReport = false;
+    nsecs_t mRealTimeBase = 0;
+    int64_t mTraceTimeBase = 0;
+
+    // Set up in replay() when vsync alignment is requested; vsync increments
+    // then wait for the next hardware vsync instead of injecting one.
+    std::unique_ptr<DisplayEventReceiver> mVSyncReceiver;
+    std::mutex mVSyncReceiverLock;
+
+    // Timing report data, written by worker threads while replaying.
+    std::mutex mTimingLock;
+    std::vector<std::pair<int64_t, nsecs_t>> mVSyncTimes;
+    nsecs_t mTotalDispatchDrift = 0;
+    nsecs_t mMaxDispatchDrift = 0;
+    size_t mDispatchCount = 0;
+
     std::mutex mLayerLock;
     std::condition_variable mLayerCond;
     std::unordered_map<layer_id, sp<SurfaceControl>> mLayers;
@@ -25,6 +25,13 @@ __BEGIN_DECLS
 int64_t stat_size(struct stat *s);
 int64_t calculate_dir_size(int dfd);
 
+/* Same accounting as calculate_dir_size(), but scans the tree with a pool
+ * of worker threads sharing a queue of directories, and skips directories
+ * whose dev/ino pair was already visited so aliased mounts cannot loop the
+ * walk. Takes ownership of dfd. Intended for multi-gigabyte trees; small
+ * trees should keep using calculate_dir_size(). */
+int64_t calculate_dir_size_parallel(int dfd);
+
 __END_DECLS
 
 #endif /* __LIBDISKUSAGE_DIRSIZE_H */
@@ -287,6 +287,13 @@ struct PointerProperties {
     void copyFrom(const PointerProperties& other);
 };
 
+// PointerCoords and PointerProperties are plain data; declaring them as such
+// lets Vector move, copy, and destroy sample storage with memcpy/memmove
+// instead of element-wise construction when samples are appended or the
+// backing array is reallocated.
+ANDROID_BASIC_TYPES_TRAITS(PointerCoords)
+ANDROID_BASIC_TYPES_TRAITS(PointerProperties)
+
 /*
  * Input events.
  */
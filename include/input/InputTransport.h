@@ -27,6 +27,8 @@
  * The InputConsumer is used by the application to receive events from the input dispatcher.
  */
 
+#include <vector>
+
 #include <input/Input.h>
 #include <utils/Errors.h>
 #include <utils/Timers.h>
@@ -195,8 +197,26 @@ public:
     sp<InputChannel> dup() const;
 
 private:
+    // Number of datagrams received from the socket in one recvmmsg call.
+    // Messages beyond the first are buffered and handed out by subsequent
+    // receiveMessage calls without touching the kernel, so a consumer that
+    // wakes once per frame pays one syscall for the whole backlog instead
+    // of one per message.
+    static const size_t RECEIVE_BATCH_SIZE = 4;
+
+    struct BufferedMessage {
+        InputMessage msg;
+        uint32_t length;
+    };
+
     std::string mName;
     int mFd;
+
+    // Messages already pulled from the socket but not yet handed to the caller.
+    // Only populated when a batch receive actually finds more than one pending
+    // datagram, so idle channels carry no extra memory.
+    std::vector<BufferedMessage> mReceiveBuffer;
+    size_t mReceiveBufferIndex;
 };
 
 /*
@@ -359,6 +379,18 @@ private:
     // True if touch resampling is enabled.
     const bool mResampleTouch;
 
+    // True if per-channel latency instrumentation is enabled.
+    const bool mTrackLatency;
+
+    // Latency statistics accumulated while instrumentation is enabled.  They
+    // measure how far behind the panel a consumed batch is at consume time and
+    // at the frame time it was resampled for; a summary is logged periodically.
+    int64_t mLatencySampleCount;
+    nsecs_t mConsumeLatencySum;
+    nsecs_t mConsumeLatencyMax;
+    nsecs_t mFrameLatencySum;
+    nsecs_t mFrameLatencyMax;
+
     // The input channel.
     sp<InputChannel> mChannel;
 
@@ -421,6 +453,12 @@ private:
         History history[2];
         History lastResample;
 
+        // Exponential moving average of the interval between received move
+        // samples.  This tracks the panel's actual scan cadence so that the
+        // resample point and the prediction cap can adapt to it instead of
+        // assuming a fixed scan rate.  Zero until two samples have arrived.
+        nsecs_t scanInterval;
+
         void initialize(int32_t deviceId, int32_t source) {
             this->deviceId = deviceId;
             this->source = source;
@@ -428,9 +466,18 @@ private:
             historySize = 0;
             lastResample.eventTime = 0;
             lastResample.idBits.clear();
+            scanInterval = 0;
         }
 
         void addHistory(const InputMessage& msg) {
+            if (historySize >= 1) {
+                nsecs_t delta = msg.body.motion.eventTime - history[historyCurrent].eventTime;
+                // Ignore implausible gaps (a finger that paused or a stalled
+                // reader) so they do not corrupt the cadence estimate.
+                if (delta > 0 && delta <= 50000000LL) { // 50 ms
+                    scanInterval = scanInterval ? (3 * scanInterval + delta) / 4 : delta;
+                }
+            }
             historyCurrent ^= 1;
             if (historySize < 2) {
                 historySize += 1;
@@ -481,6 +528,8 @@ private:
     void updateTouchState(InputMessage& msg);
     void resampleTouchState(nsecs_t frameTime, MotionEvent* event,
             const InputMessage *next);
+    nsecs_t getResampleLatency(const Batch& batch) const;
+    void trackLatency(const MotionEvent* event, nsecs_t frameTime);
 
     ssize_t findBatch(int32_t deviceId, int32_t source) const;
     ssize_t findTouchState(int32_t deviceId, int32_t source) const;
@@ -496,6 +545,7 @@ private:
     static bool shouldResampleTool(int32_t toolType);
 
     static bool isTouchResamplingEnabled();
+    static bool isLatencyTrackingEnabled();
 };
 
 } // namespace android
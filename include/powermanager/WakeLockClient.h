@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_WAKELOCK_CLIENT_H
+#define ANDROID_WAKELOCK_CLIENT_H
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include <powermanager/IPowerManager.h>
+#include <utils/String16.h>
+#include <utils/Timers.h>
+
+namespace android {
+
+/*
+ * WakeLockClient is a client-side coalescing wrapper around one
+ * IPowerManager wake lock, for callers that toggle a lock at high frequency
+ * around short work bursts.
+ *
+ * acquire() and release() maintain a local reference count; only the 0 -> 1
+ * transition can issue a binder transaction, and the final release is
+ * deferred by a configurable linger interval. A re-acquire within the linger
+ * window simply cancels the pending release, so a burst of N toggles costs
+ * at most one acquire and one release transaction instead of 2*N, and the
+ * kernel sees correspondingly fewer suspend/resume transitions.
+ *
+ * The linger trades up to lingerNs of extra wakeup time per burst for the
+ * saved IPCs; pass 0 to release on the next timer wakeup, or call flush()
+ * to drop a fully released lock immediately.
+ *
+ * All methods are safe to call from multiple threads.
+ */
+class WakeLockClient {
+public:
+    // Long enough to bridge back-to-back sensor bursts, short enough that an
+    // idle client does not noticeably hold off suspend.
+    static const nsecs_t kDefaultLingerNs = ms2ns(100);
+
+    WakeLockClient(const sp<IPowerManager>& powerManager, int flags, const String16& tag,
+                   const String16& packageName, nsecs_t lingerNs = kDefaultLingerNs);
+    ~WakeLockClient();
+
+    // Increments the local count, acquiring the service-side lock on the
+    // first reference. Returns the transaction status, or NO_ERROR when the
+    // lock was already held (including held by a pending lingering release).
+    status_t acquire();
+
+    // Decrements the local count. When it reaches zero the service-side
+    // release is deferred by the linger interval rather than issued inline.
+    // Returns BAD_VALUE if the lock is not held.
+    status_t release();
+
+    // Releases the service-side lock now if the local count is zero,
+    // cancelling any pending lingering release.
+    status_t flush();
+
+    // True while the service-side lock is held, including during a linger.
+    bool isHeldRemotely() const;
+
+private:
+    void lingerLoop();
+    // Issues the deferred release. Called with mLock held.
+    status_t releaseRemoteLocked();
+
+    const sp<IPowerManager> mPowerManager;
+    const sp<IBinder> mToken;
+    const int mFlags;
+    const String16 mTag;
+    const String16 mPackageName;
+    const nsecs_t mLingerNs;
+
+    mutable std::mutex mLock;
+    std::condition_variable mCondition;
+    int32_t mCount;             // local acquire() minus release()
+    bool mHeldRemotely;         // service-side lock currently acquired
+    bool mReleasePending;       // linger timer armed
+    nsecs_t mReleaseDeadline;   // CLOCK_MONOTONIC, valid while mReleasePending
+    bool mExiting;
+    std::thread mLingerThread;
+
+    WakeLockClient(const WakeLockClient&) = delete;
+    WakeLockClient& operator=(const WakeLockClient&) = delete;
+};
+
+} // namespace android
+
+#endif // ANDROID_WAKELOCK_CLIENT_H
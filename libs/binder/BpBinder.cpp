@@ -23,9 +23,14 @@
 #include <binder/IResultReceiver.h>
 #include <cutils/compiler.h>
 #include <utils/Log.h>
+#include <utils/Timers.h>
 
+#include <inttypes.h>
 #include <stdio.h>
 
+#include <atomic>
+#include <map>
+
 //#undef ALOGV
 //#define ALOGV(...) fprintf(stderr, __VA_ARGS__)
 
@@ -50,6 +55,98 @@ enum {
     COUNTING_VALUE_MASK = 0x7FFFFFFF,       // A mask of the remaining bits for the count value
 };
 
+std::atomic_bool BpBinder::sLatencyTrackingEnabled(false);
+
+// ---------------------------------------------------------------------------
+// Per-thread latency histograms.
+//
+// Each thread owns a fixed-size open-addressed table keyed by
+// (handle << 32) | code.  Only the owning thread inserts and increments,
+// with relaxed atomics, so the transact hot path never takes a lock; the
+// dump path walks all tables through a registry.  Tables are registered
+// once and never freed: binder threads live as long as the process, and
+// leaving retired tables in place keeps their samples and avoids any
+// teardown race with a concurrent dump.
+
+namespace {
+
+constexpr size_t kLatencyBuckets = 16;
+constexpr uint64_t kEmptyKey = ~0ULL;
+
+struct LatencyRecord {
+    std::atomic<uint64_t> key;
+    std::atomic<uint64_t> buckets[kLatencyBuckets];
+};
+
+struct LatencyTable {
+    static constexpr size_t kSlots = 256;
+
+    LatencyTable() : next(nullptr), dropped(0) {
+        for (size_t i = 0; i < kSlots; i++) {
+            slots[i].key.store(kEmptyKey, std::memory_order_relaxed);
+            for (size_t b = 0; b < kLatencyBuckets; b++) {
+                slots[i].buckets[b].store(0, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    LatencyRecord slots[kSlots];
+    LatencyTable* next;
+    std::atomic<uint64_t> dropped;
+};
+
+Mutex gLatencyTableLock;
+LatencyTable* gLatencyTables = nullptr;
+
+LatencyTable* threadLatencyTable()
+{
+    static thread_local LatencyTable* table = nullptr;
+    if (table == nullptr) {
+        table = new LatencyTable();
+        AutoMutex _l(gLatencyTableLock);
+        table->next = gLatencyTables;
+        gLatencyTables = table;
+    }
+    return table;
+}
+
+// Bucket i holds samples in [2^(i-1), 2^i) microseconds.
+size_t latencyBucket(int64_t timeUs)
+{
+    if (timeUs <= 0) return 0;
+    const size_t bit = 64 - __builtin_clzll(static_cast<uint64_t>(timeUs));
+    return bit < kLatencyBuckets ? bit : kLatencyBuckets - 1;
+}
+
+void recordLatency(int32_t handle, uint32_t code, int64_t timeUs)
+{
+    LatencyTable* table = threadLatencyTable();
+    const uint64_t key = (static_cast<uint64_t>(static_cast<uint32_t>(handle)) << 32) | code;
+    size_t slot = (key * 0x9E3779B97F4A7C15ULL) % LatencyTable::kSlots;
+    for (size_t probes = 0; probes < LatencyTable::kSlots; probes++) {
+        uint64_t cur = table->slots[slot].key.load(std::memory_order_relaxed);
+        if (cur == kEmptyKey) {
+            // Only this thread inserts, but the dumper reads keys; CAS
+            // publishes the claimed slot.
+            if (!table->slots[slot].key.compare_exchange_strong(
+                    cur, key, std::memory_order_release, std::memory_order_relaxed)) {
+                return;  // should not happen; be safe
+            }
+            cur = key;
+        }
+        if (cur == key) {
+            table->slots[slot].buckets[latencyBucket(timeUs)].fetch_add(
+                    1, std::memory_order_relaxed);
+            return;
+        }
+        slot = (slot + 1) % LatencyTable::kSlots;
+    }
+    // Table full; account for the lost sample so the dump shows it.
+    table->dropped.fetch_add(1, std::memory_order_relaxed);
+}
+
+}  // namespace
+
 BpBinder::ObjectManager::ObjectManager()
 {
 }
@@ -211,8 +308,17 @@ status_t BpBinder::transact(
 {
     // Once a binder has died, it will never come back to life.
     if (mAlive) {
-        status_t status = IPCThreadState::self()->transact(
-            mHandle, code, data, reply, flags);
+        status_t status;
+        if (CC_UNLIKELY(sLatencyTrackingEnabled.load(std::memory_order_relaxed))) {
+            const int64_t startUs = systemTime(SYSTEM_TIME_MONOTONIC) / 1000;
+            status = IPCThreadState::self()->transact(
+                mHandle, code, data, reply, flags);
+            recordLatency(mHandle, code,
+                          systemTime(SYSTEM_TIME_MONOTONIC) / 1000 - startUs);
+        } else {
+            status = IPCThreadState::self()->transact(
+                mHandle, code, data, reply, flags);
+        }
         if (status == DEAD_OBJECT) mAlive = 0;
         return status;
     }
@@ -465,6 +571,70 @@ void BpBinder::setBinderProxyCountWatermarks(int high, int low) {
     sBinderProxyCountLowWatermark = low;
 }
 
+void BpBinder::setLatencyTrackingEnabled(bool enable) {
+    sLatencyTrackingEnabled.store(enable);
+}
+
+void BpBinder::dumpLatencyHistograms(String8& out)
+{
+    struct Histogram {
+        uint64_t buckets[kLatencyBuckets] = {};
+        uint64_t total = 0;
+    };
+    // Aggregate the per-thread tables; a map keyed by (handle, code)
+    // gives stable, sorted output.
+    std::map<uint64_t, Histogram> merged;
+    uint64_t dropped = 0;
+
+    {
+        AutoMutex _l(gLatencyTableLock);
+        for (LatencyTable* table = gLatencyTables; table; table = table->next) {
+            dropped += table->dropped.load(std::memory_order_relaxed);
+            for (size_t i = 0; i < LatencyTable::kSlots; i++) {
+                const uint64_t key = table->slots[i].key.load(std::memory_order_acquire);
+                if (key == kEmptyKey) continue;
+                Histogram& h = merged[key];
+                for (size_t b = 0; b < kLatencyBuckets; b++) {
+                    const uint64_t count =
+                            table->slots[i].buckets[b].load(std::memory_order_relaxed);
+                    h.buckets[b] += count;
+                    h.total += count;
+                }
+            }
+        }
+    }
+
+    out.append("Binder proxy latency histograms (bucket i: [2^(i-1), 2^i) us):\n");
+    for (const auto& it : merged) {
+        const int32_t handle = static_cast<int32_t>(it.first >> 32);
+        const uint32_t code = static_cast<uint32_t>(it.first & 0xFFFFFFFF);
+        out.appendFormat("  handle %d code %u: %" PRIu64 " calls:",
+                         handle, code, it.second.total);
+        for (size_t b = 0; b < kLatencyBuckets; b++) {
+            out.appendFormat(" %" PRIu64, it.second.buckets[b]);
+        }
+        out.append("\n");
+    }
+    if (dropped > 0) {
+        out.appendFormat("  %" PRIu64 " samples dropped (per-thread tables full)\n", dropped);
+    }
+}
+
+void BpBinder::resetLatencyHistograms()
+{
+    AutoMutex _l(gLatencyTableLock);
+    for (LatencyTable* table = gLatencyTables; table; table = table->next) {
+        table->dropped.store(0, std::memory_order_relaxed);
+        for (size_t i = 0; i < LatencyTable::kSlots; i++) {
+            // Keep the keys: the owning thread may be about to bump a
+            // bucket for a slot it already claimed.
+            for (size_t b = 0; b < kLatencyBuckets; b++) {
+                table->slots[i].buckets[b].store(0, std::memory_order_relaxed);
+            }
+        }
+    }
+}
+
 // ---------------------------------------------------------------------------
 
 }; // namespace android
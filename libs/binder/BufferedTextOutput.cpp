@@ -51,6 +51,7 @@ struct BufferedTextOutput::BufferState : public RefBase
         if ((len+bufferPos) > bufferSize) {
             size_t newSize = ((len+bufferPos)*3)/2;
             if (newSize < (len+bufferPos)) return NO_MEMORY;    // overflow
+            if (newSize < kMinArenaSize) newSize = kMinArenaSize;
             void* b = realloc(buffer, newSize);
             if (!b) return NO_MEMORY;
             buffer = (char*)b;
@@ -60,18 +61,26 @@ struct BufferedTextOutput::BufferState : public RefBase
         bufferPos += len;
         return NO_ERROR;
     }
-    
+
     void restart() {
         bufferPos = 0;
         atFront = true;
-        if (bufferSize > 256) {
-            void* b = realloc(buffer, 256);
+        // Keep the arena for the next line instead of shrinking on every
+        // flush; only give memory back when a single line blew it up well
+        // past the steady state.
+        if (bufferSize > kMaxRetainedArenaSize) {
+            void* b = realloc(buffer, kMaxRetainedArenaSize);
             if (b) {
                 buffer = (char*)b;
-                bufferSize = 256;
+                bufferSize = kMaxRetainedArenaSize;
             }
         }
     }
+
+    enum {
+        kMinArenaSize = 256,
+        kMaxRetainedArenaSize = 4096,
+    };
     
     const int32_t seq;
     char* buffer;
@@ -87,6 +96,24 @@ struct BufferedTextOutput::ThreadState
     Vector<sp<BufferedTextOutput::BufferState> > states;
 };
 
+// Takes the lock only when operating on the shared fallback BufferState. A
+// thread-local BufferState in MULTITHREADED mode is never touched by another
+// thread, so appends and flushes on it proceed without serializing across
+// threads; the flush itself hands the line straight to writeLines(), relying
+// on the destination fd for atomicity.
+struct OptionalAutoMutex
+{
+    OptionalAutoMutex(Mutex& mutex, bool enabled)
+            : mMutex(mutex), mEnabled(enabled) {
+        if (mEnabled) mMutex.lock();
+    }
+    ~OptionalAutoMutex() {
+        if (mEnabled) mMutex.unlock();
+    }
+    Mutex& mMutex;
+    const bool mEnabled;
+};
+
 static mutex_t          gMutex;
 
 static thread_store_t   tls;
@@ -158,10 +185,10 @@ BufferedTextOutput::~BufferedTextOutput()
 status_t BufferedTextOutput::print(const char* txt, size_t len)
 {
     //printf("BufferedTextOutput: printing %d\n", len);
-    
-    AutoMutex _l(mLock);
+
     BufferState* b = getBuffer();
-    
+    OptionalAutoMutex _l(mLock, b == mGlobalState);
+
     const char* const end = txt+len;
     
     status_t err;
@@ -225,23 +252,23 @@ status_t BufferedTextOutput::print(const char* txt, size_t len)
 
 void BufferedTextOutput::moveIndent(int delta)
 {
-    AutoMutex _l(mLock);
     BufferState* b = getBuffer();
+    OptionalAutoMutex _l(mLock, b == mGlobalState);
     b->indent += delta;
     if (b->indent < 0) b->indent = 0;
 }
 
 void BufferedTextOutput::pushBundle()
 {
-    AutoMutex _l(mLock);
     BufferState* b = getBuffer();
+    OptionalAutoMutex _l(mLock, b == mGlobalState);
     b->bundle++;
 }
 
 void BufferedTextOutput::popBundle()
 {
-    AutoMutex _l(mLock);
     BufferState* b = getBuffer();
+    OptionalAutoMutex _l(mLock, b == mGlobalState);
     b->bundle--;
     LOG_FATAL_IF(b->bundle < 0,
         "TextOutput::popBundle() called more times than pushBundle()");
@@ -269,8 +296,11 @@ BufferedTextOutput::BufferState* BufferedTextOutput::getBuffer() const
             while (ts->states.size() <= (size_t)mIndex) ts->states.add(NULL);
             BufferState* bs = ts->states[mIndex].get();
             if (bs != NULL && bs->seq == mSeq) return bs;
-            
-            ts->states.editItemAt(mIndex) = new BufferState(mIndex);
+
+            // Tag the new state with this output's sequence number (not its
+            // buffer index) so it passes the check above and is reused on
+            // the next call rather than recreated every time.
+            ts->states.editItemAt(mIndex) = new BufferState(mSeq);
             bs = ts->states[mIndex].get();
             if (bs != NULL) return bs;
         }
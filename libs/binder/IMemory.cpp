@@ -17,7 +17,9 @@
 #define LOG_TAG "IMemory"
 
 #include <atomic>
+#include <memory>
 #include <stdatomic.h>
+#include <unordered_map>
 
 #include <fcntl.h>
 #include <stdint.h>
@@ -63,10 +65,24 @@ private:
 
     void free_heap(const wp<IBinder>& binder);
 
+    // Rebuilds mHeapSnapshot from mHeapCache and publishes it. Must be
+    // called with mHeapCacheLock held after every mutation of mHeapCache.
+    void publishSnapshotLocked();
+
     Mutex mHeapCacheLock;  // Protects entire vector below.
     KeyedVector< wp<IBinder>, heap_info_t > mHeapCache;
     // We do not use the copy-on-write capabilities of KeyedVector.
     // TODO: Reimplemement based on standard C++ container?
+
+    // Immutable copy-on-update snapshot of mHeapCache, consulted by
+    // get_heap() so heap resolution does not contend on mHeapCacheLock with
+    // concurrent heap registration. Keyed by the raw binder pointer; each
+    // entry's sp<IMemoryHeap> keeps the proxy (and therefore the binder)
+    // alive, so a key cannot be recycled while a snapshot references it.
+    // Readers pick the snapshot up with an atomic load; writers rebuild and
+    // republish it with mHeapCacheLock held.
+    using HeapSnapshot = std::unordered_map<IBinder*, sp<IMemoryHeap>>;
+    std::shared_ptr<const HeapSnapshot> mHeapSnapshot;
 };
 
 static sp<HeapCache> gHeapCache = new HeapCache();
@@ -405,7 +421,8 @@ status_t BnMemoryHeap::onTransact(
 /*****************************************************************************/
 
 HeapCache::HeapCache()
-    : DeathRecipient()
+    : DeathRecipient(),
+      mHeapSnapshot(std::make_shared<HeapSnapshot>())
 {
 }
 
@@ -441,10 +458,24 @@ sp<IMemoryHeap> HeapCache::find_heap(const sp<IBinder>& binder)
         //ALOGD("adding binder=%p, heap=%p, count=%d",
         //      binder.get(), info.heap.get(), info.count);
         mHeapCache.add(binder, info);
+        publishSnapshotLocked();
         return info.heap;
     }
 }
 
+void HeapCache::publishSnapshotLocked()
+{
+    auto snapshot = std::make_shared<HeapSnapshot>();
+    snapshot->reserve(mHeapCache.size());
+    for (size_t i = 0; i < mHeapCache.size(); i++) {
+        snapshot->emplace(mHeapCache.keyAt(i).unsafe_get(),
+                mHeapCache.valueAt(i).heap);
+    }
+    std::atomic_store_explicit(&mHeapSnapshot,
+            std::shared_ptr<const HeapSnapshot>(std::move(snapshot)),
+            std::memory_order_release);
+}
+
 void HeapCache::free_heap(const sp<IBinder>& binder)  {
     free_heap( wp<IBinder>(binder) );
 }
@@ -467,6 +498,7 @@ void HeapCache::free_heap(const wp<IBinder>& binder)
                         info.count);
                 rel = mHeapCache.valueAt(i).heap;
                 mHeapCache.removeItemsAt(i);
+                publishSnapshotLocked();
             }
         } else {
             ALOGE("free_heap binder=%p not found!!!", binder.unsafe_get());
@@ -476,6 +508,16 @@ void HeapCache::free_heap(const wp<IBinder>& binder)
 
 sp<IMemoryHeap> HeapCache::get_heap(const sp<IBinder>& binder)
 {
+    // Fast path: look the heap up in the published snapshot without taking
+    // mHeapCacheLock, so pointer resolution never blocks behind a concurrent
+    // heap registration.
+    std::shared_ptr<const HeapSnapshot> snapshot =
+            std::atomic_load_explicit(&mHeapSnapshot, std::memory_order_acquire);
+    HeapSnapshot::const_iterator it = snapshot->find(binder.get());
+    if (it != snapshot->end()) {
+        return it->second;
+    }
+
     sp<IMemoryHeap> realHeap;
     Mutex::Autolock _l(mHeapCacheLock);
     ssize_t i = mHeapCache.indexOfKey(binder);
@@ -25,6 +25,7 @@
 #include <cutils/sched_policy.h>
 #include <utils/Log.h>
 #include <utils/SystemClock.h>
+#include <utils/Timers.h>
 #include <utils/threads.h>
 
 #include <private/binder/binder_module.h>
@@ -65,6 +66,13 @@
 
 namespace android {
 
+// Limits for batched oneway transactions: a batch is handed to the driver
+// once this many commands or this much outgoing command data is pending.
+enum {
+    ONEWAY_BATCH_MAX_COMMANDS = 16,
+    ONEWAY_BATCH_MAX_BYTES = 8*1024,
+};
+
 // Static const and functions will be optimized out if not used,
 // when LOG_NDEBUG and references in IF_LOG_COMMANDS() are optimized out.
 static const char *kReturnStrings[] = {
@@ -271,6 +279,11 @@ static const void* printCommand(TextOutput& out, const void* _cmd)
     return cmd;
 }
 
+// Maximum number of BC_FREE_BUFFER commands left unflushed in mOut before
+// freeBuffer pushes them to the driver; bounds how much freed buffer space
+// an idle thread can pin.
+static const size_t kMaxPendingFreeBuffers = 32;
+
 static pthread_mutex_t gTLSMutex = PTHREAD_MUTEX_INITIALIZER;
 static bool gHaveTLS = false;
 static pthread_key_t gTLS = 0;
@@ -437,6 +450,7 @@ status_t IPCThreadState::getAndExecuteCommand()
     status_t result;
     int32_t cmd;
 
+    mLastCommandBusyUs = 0;
     result = talkWithDriver();
     if (result >= NO_ERROR) {
         size_t IN = mIn.dataAvail();
@@ -455,7 +469,10 @@ status_t IPCThreadState::getAndExecuteCommand()
         }
         pthread_mutex_unlock(&mProcess->mThreadCountLock);
 
+        const int64_t commandStartUs = systemTime(SYSTEM_TIME_MONOTONIC) / 1000;
         result = executeCommand(cmd);
+        mLastCommandBusyUs = systemTime(SYSTEM_TIME_MONOTONIC) / 1000 - commandStartUs;
+        mProcess->onThreadBusy(mLastCommandBusyUs);
 
         pthread_mutex_lock(&mProcess->mThreadCountLock);
         mProcess->mExecutingThreadsCount--;
@@ -525,16 +542,28 @@ void IPCThreadState::processPostWriteDerefs()
     mPostWriteStrongDerefs.clear();
 }
 
+void IPCThreadState::freeBatchedOnewayParcels()
+{
+    for (size_t i = 0; i < mBatchedOnewayParcels.size(); i++) {
+        delete mBatchedOnewayParcels[i];
+    }
+    mBatchedOnewayParcels.clear();
+}
+
 void IPCThreadState::joinThreadPool(bool isMain)
 {
     LOG_THREADPOOL("**** THREAD %p (PID %d) IS JOINING THE THREAD POOL\n", (void*)pthread_self(), getpid());
 
     mOut.writeInt32(isMain ? BC_ENTER_LOOPER : BC_REGISTER_LOOPER);
 
+    mProcess->onThreadEnteredPool();
+
     status_t result;
+    bool retired = false;
     do {
         processPendingDerefs();
         // now get the next command to be processed, waiting if necessary
+        const int64_t waitStartUs = systemTime(SYSTEM_TIME_MONOTONIC) / 1000;
         result = getAndExecuteCommand();
 
         if (result < NO_ERROR && result != TIMED_OUT && result != -ECONNREFUSED && result != -EBADF) {
@@ -548,8 +577,22 @@ void IPCThreadState::joinThreadPool(bool isMain)
         if(result == TIMED_OUT && !isMain) {
             break;
         }
+
+        // The time spent blocked in the driver waiting for this command
+        // is how long the thread sat idle; under an adaptive policy,
+        // persistently idle non-main threads retire.
+        if (!isMain) {
+            const int64_t idleUs = systemTime(SYSTEM_TIME_MONOTONIC) / 1000
+                    - waitStartUs - mLastCommandBusyUs;
+            if (mProcess->shouldRetireThread(idleUs)) {
+                retired = true;
+                break;
+            }
+        }
     } while (result != -ECONNREFUSED && result != -EBADF);
 
+    if (!retired) mProcess->onThreadExitedPool();
+
     LOG_THREADPOOL("**** THREAD %p (PID %d) IS LEAVING THE THREAD POOL err=%d\n",
         (void*)pthread_self(), getpid(), result);
 
@@ -608,7 +651,33 @@ status_t IPCThreadState::transact(int32_t handle,
 
     LOG_ONEWAY(">>>> SEND from pid %d uid %d %s", getpid(), getuid(),
         (flags & TF_ONE_WAY) == 0 ? "READ REPLY" : "ONE WAY");
-    err = writeTransactionData(BC_TRANSACTION, flags, handle, code, data, NULL);
+
+    // The driver copies the transaction payload out of the Parcel only when
+    // the BINDER_WRITE_READ ioctl runs. While a oneway batch is open that
+    // ioctl is deferred, so the command must not reference the caller's
+    // Parcel: it is typically destroyed as soon as transact() returns. Queue
+    // deferred commands against a copy we own instead; the copy is freed
+    // once the driver has consumed the write buffer.
+    const bool batchOneway = (flags & TF_ONE_WAY) != 0
+            && mOnewayBatchingEnabled && data.ipcBuffersSize() == 0;
+    if (batchOneway) {
+        Parcel* ownedData = new Parcel;
+        // appendFrom() also re-acquires any flattened binder objects, so
+        // references stay valid until the copy is freed after the flush.
+        err = ownedData->appendFrom(&data, 0, data.dataSize());
+        if (err == NO_ERROR) {
+            err = writeTransactionData(BC_TRANSACTION, flags, handle, code,
+                    *ownedData, NULL);
+        }
+        if (err != NO_ERROR) {
+            delete ownedData;
+        } else {
+            mBatchedOnewayParcels.push(ownedData);
+        }
+    } else {
+        err = writeTransactionData(BC_TRANSACTION, flags, handle, code, data,
+                NULL);
+    }
 
     if (err != NO_ERROR) {
         if (reply) reply->setError(err);
@@ -645,12 +714,49 @@ status_t IPCThreadState::transact(int32_t handle,
             else alog << "(none requested)" << endl;
         }
     } else {
-        err = waitForResponse(NULL, NULL);
+        if (batchOneway) {
+            // The command is already queued in mOut; defer the driver
+            // ioctl until the batch fills up or the batch is ended.
+            mBatchedOnewayCount++;
+            if (mBatchedOnewayCount >= ONEWAY_BATCH_MAX_COMMANDS
+                    || mOut.dataSize() >= ONEWAY_BATCH_MAX_BYTES) {
+                err = flushOnewayBatch();
+            } else {
+                err = NO_ERROR;
+            }
+        } else {
+            err = waitForResponse(NULL, NULL);
+        }
     }
 
     return err;
 }
 
+void IPCThreadState::startOnewayBatch()
+{
+    mOnewayBatchingEnabled = true;
+}
+
+status_t IPCThreadState::endOnewayBatch()
+{
+    mOnewayBatchingEnabled = false;
+    return flushOnewayBatch();
+}
+
+status_t IPCThreadState::flushOnewayBatch()
+{
+    status_t err = NO_ERROR;
+    // The first iteration hands the whole batch to the driver in one
+    // ioctl; later iterations only reap BR_TRANSACTION_COMPLETEs, which
+    // the driver typically returns together, so they rarely block.
+    while (mBatchedOnewayCount > 0 && err == NO_ERROR) {
+        mBatchedOnewayCount--;
+        err = waitForResponse(NULL, NULL);
+    }
+    mBatchedOnewayCount = 0;
+    return err;
+}
+
 void IPCThreadState::incStrongHandle(int32_t handle, BpBinder *proxy)
 {
     LOG_REMOTEREFS("IPCThreadState::incStrongHandle(%d)\n", handle);
@@ -736,7 +842,11 @@ status_t IPCThreadState::clearDeathNotification(int32_t handle, BpBinder* proxy)
 IPCThreadState::IPCThreadState()
     : mProcess(ProcessState::self()),
       mStrictModePolicy(0),
-      mLastTransactionBinderFlags(0)
+      mLastTransactionBinderFlags(0),
+      mOnewayBatchingEnabled(false),
+      mBatchedOnewayCount(0),
+      mPendingFreeBuffers(0),
+      mLastCommandBusyUs(0)
 {
     pthread_setspecific(gTLS, this);
     clearCaller();
@@ -746,6 +856,7 @@ IPCThreadState::IPCThreadState()
 
 IPCThreadState::~IPCThreadState()
 {
+    freeBatchedOnewayParcels();
 }
 
 status_t IPCThreadState::sendReply(const Parcel& reply, uint32_t flags)
@@ -779,6 +890,10 @@ status_t IPCThreadState::waitForResponse(Parcel *reply, status_t *acquireResult)
         switch (cmd) {
         case BR_TRANSACTION_COMPLETE:
             if (!reply && !acquireResult) goto finish;
+            // A completion absorbed while waiting for a real reply pays
+            // down batched oneways that were flushed ahead of this
+            // transaction (the driver completes commands in order).
+            if (mBatchedOnewayCount > 0) mBatchedOnewayCount--;
             break;
 
         case BR_DEAD_REPLY:
@@ -929,7 +1044,11 @@ status_t IPCThreadState::talkWithDriver(bool doReceive)
                 mOut.remove(0, bwr.write_consumed);
             else {
                 mOut.setDataSize(0);
+                mPendingFreeBuffers = 0;
                 processPostWriteDerefs();
+                // Every batched transaction in mOut has been copied out by
+                // the driver, so the owned payload copies can go too.
+                freeBatchedOnewayParcels();
             }
         }
         if (bwr.read_consumed > 0) {
@@ -955,35 +1074,47 @@ status_t IPCThreadState::talkWithDriver(bool doReceive)
 status_t IPCThreadState::writeTransactionData(int32_t cmd, uint32_t binderFlags,
     int32_t handle, uint32_t code, const Parcel& data, status_t* statusBuffer)
 {
-    binder_transaction_data tr;
-
-    tr.target.ptr = 0; /* Don't pass uninitialized stack data to a remote process */
-    tr.target.handle = handle;
-    tr.code = code;
-    tr.flags = binderFlags;
-    tr.cookie = 0;
-    tr.sender_pid = 0;
-    tr.sender_euid = 0;
+    binder_transaction_data_sg tr_sg;
+    /* Don't pass uninitialized stack data to a remote process */
+    tr_sg.transaction_data.target.ptr = 0;
+    tr_sg.transaction_data.target.handle = handle;
+    tr_sg.transaction_data.code = code;
+    tr_sg.transaction_data.flags = binderFlags;
+    tr_sg.transaction_data.cookie = 0;
+    tr_sg.transaction_data.sender_pid = 0;
+    tr_sg.transaction_data.sender_euid = 0;
+    tr_sg.buffers_size = 0;
 
     const status_t err = data.errorCheck();
     if (err == NO_ERROR) {
-        tr.data_size = data.ipcDataSize();
-        tr.data.ptr.buffer = data.ipcData();
-        tr.offsets_size = data.ipcObjectsCount()*sizeof(binder_size_t);
-        tr.data.ptr.offsets = data.ipcObjects();
+        tr_sg.transaction_data.data_size = data.ipcDataSize();
+        tr_sg.transaction_data.data.ptr.buffer = data.ipcData();
+        tr_sg.transaction_data.offsets_size =
+                data.ipcObjectsCount()*sizeof(binder_size_t);
+        tr_sg.transaction_data.data.ptr.offsets = data.ipcObjects();
+        tr_sg.buffers_size = data.ipcBuffersSize();
     } else if (statusBuffer) {
-        tr.flags |= TF_STATUS_CODE;
+        tr_sg.transaction_data.flags |= TF_STATUS_CODE;
         *statusBuffer = err;
-        tr.data_size = sizeof(status_t);
-        tr.data.ptr.buffer = reinterpret_cast<uintptr_t>(statusBuffer);
-        tr.offsets_size = 0;
-        tr.data.ptr.offsets = 0;
+        tr_sg.transaction_data.data_size = sizeof(status_t);
+        tr_sg.transaction_data.data.ptr.buffer =
+                reinterpret_cast<uintptr_t>(statusBuffer);
+        tr_sg.transaction_data.offsets_size = 0;
+        tr_sg.transaction_data.data.ptr.offsets = 0;
     } else {
         return (mLastError = err);
     }
 
-    mOut.writeInt32(cmd);
-    mOut.write(&tr, sizeof(tr));
+    if (tr_sg.buffers_size > 0) {
+        // The parcel references caller-owned buffers recorded with
+        // Parcel::writeNoCopy(); ask the driver to gather them into the
+        // target's buffer instead of requiring a flattened copy here.
+        mOut.writeInt32(cmd == BC_TRANSACTION ? BC_TRANSACTION_SG : BC_REPLY_SG);
+        mOut.write(&tr_sg, sizeof(tr_sg));
+    } else {
+        mOut.writeInt32(cmd);
+        mOut.write(&tr_sg.transaction_data, sizeof(tr_sg.transaction_data));
+    }
 
     return NO_ERROR;
 }
@@ -1009,6 +1140,14 @@ status_t IPCThreadState::executeCommand(int32_t cmd)
     case BR_OK:
         break;
 
+    case BR_TRANSACTION_COMPLETE:
+        // Completion for a batched oneway whose commands were flushed by
+        // an unrelated talkWithDriver(); account for it so that
+        // endOnewayBatch() does not wait for a completion that has
+        // already been consumed.
+        if (mBatchedOnewayCount > 0) mBatchedOnewayCount--;
+        break;
+
     case BR_ACQUIRE:
         refs = (RefBase::weakref_type*)mIn.readPointer();
         obj = (BBinder*)mIn.readPointer();
@@ -1221,6 +1360,13 @@ void IPCThreadState::freeBuffer(Parcel* parcel, const uint8_t* data,
     IPCThreadState* state = self();
     state->mOut.writeInt32(BC_FREE_BUFFER);
     state->mOut.writePointer((uintptr_t)data);
+    // The free is normally carried by the next talkWithDriver at no extra
+    // cost, but cap how many can accumulate so a thread that is not
+    // otherwise talking to the driver cannot keep freed transaction
+    // buffers pinned in the binder mmap window.
+    if (++state->mPendingFreeBuffers >= kMaxPendingFreeBuffers) {
+        state->flushCommands();
+    }
 }
 
 }; // namespace android
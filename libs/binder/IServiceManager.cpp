@@ -25,6 +25,7 @@
 #endif
 #include <binder/Parcel.h>
 #include <cutils/properties.h>
+#include <utils/KeyedVector.h>
 #include <utils/String8.h>
 #include <utils/SystemClock.h>
 #include <utils/CallStack.h>
@@ -52,6 +53,100 @@ sp<IServiceManager> defaultServiceManager()
     return gDefaultServiceManager;
 }
 
+// ----------------------------------------------------------------------
+
+// Per-process cache of services resolved through getService() and
+// waitForServices(). Entries are invalidated automatically when the remote
+// binder dies, so a cached lookup can never return a dead service; a
+// service that is replaced without its old binder dying is not detected,
+// which matches how services restart in practice.
+class ServiceCache : public IBinder::DeathRecipient
+{
+public:
+    sp<IBinder> find(const String16& name) {
+        AutoMutex _l(mLock);
+        ssize_t i = mServices.indexOfKey(name);
+        if (i < 0) return NULL;
+        return mServices.valueAt(i);
+    }
+
+    void insert(const String16& name, const sp<IBinder>& binder) {
+        if (binder == NULL) return;
+        AutoMutex _l(mLock);
+        if (mServices.indexOfKey(name) >= 0) return;
+        // Local binders cannot die; linkToDeath fails for them with
+        // INVALID_OPERATION and they are safe to cache unlinked. Any other
+        // failure means the binder is already dead, so don't cache it.
+        status_t err = binder->linkToDeath(this);
+        if (err != NO_ERROR && err != INVALID_OPERATION) return;
+        mServices.add(name, binder);
+    }
+
+    virtual void binderDied(const wp<IBinder>& who) {
+        AutoMutex _l(mLock);
+        for (size_t i = 0; i < mServices.size(); ) {
+            if (who.unsafe_get() == mServices.valueAt(i).get()) {
+                mServices.removeItemsAt(i);
+            } else {
+                i++;
+            }
+        }
+    }
+
+private:
+    Mutex mLock;
+    KeyedVector<String16, sp<IBinder> > mServices;
+};
+
+static sp<ServiceCache> gServiceCache = new ServiceCache();
+
+status_t waitForServices(const Vector<String16>& names,
+        Vector<sp<IBinder>>* outServices, int64_t timeoutMillis)
+{
+    sp<IServiceManager> sm = defaultServiceManager();
+
+    Vector<sp<IBinder>> resolved;
+    resolved.insertAt(sp<IBinder>(), 0, names.size());
+    size_t remaining = names.size();
+
+    if (!gSystemBootCompleted) {
+        char bootCompleted[PROPERTY_VALUE_MAX];
+        property_get("sys.boot_completed", bootCompleted, "0");
+        gSystemBootCompleted = strcmp(bootCompleted, "1") == 0 ? true : false;
+    }
+    const long sleepTime = gSystemBootCompleted ? 1000 : 100;
+    const int64_t timeout = uptimeMillis() + timeoutMillis;
+
+    for (;;) {
+        for (size_t i = 0; i < names.size(); i++) {
+            if (resolved[i] != NULL) continue;
+            sp<IBinder> svc = gServiceCache->find(names[i]);
+            if (svc == NULL) {
+                svc = sm->checkService(names[i]);
+                gServiceCache->insert(names[i], svc);
+            }
+            if (svc != NULL) {
+                resolved.editItemAt(i) = svc;
+                remaining--;
+            }
+        }
+        if (remaining == 0 || uptimeMillis() >= timeout) break;
+        usleep(1000 * sleepTime);
+    }
+
+    if (outServices != NULL) {
+        *outServices = resolved;
+    }
+    if (remaining != 0) {
+        for (size_t i = 0; i < names.size(); i++) {
+            ALOGW_IF(resolved[i] == NULL, "Service %s didn't start.",
+                    String8(names[i]).string());
+        }
+        return TIMED_OUT;
+    }
+    return NO_ERROR;
+}
+
 #ifndef __ANDROID_VNDK__
 // IPermissionController is not accessible to vendors
 
@@ -143,9 +238,15 @@ public:
 
     virtual sp<IBinder> getService(const String16& name) const
     {
-        sp<IBinder> svc = checkService(name);
+        sp<IBinder> svc = gServiceCache->find(name);
         if (svc != NULL) return svc;
 
+        svc = checkService(name);
+        if (svc != NULL) {
+            gServiceCache->insert(name, svc);
+            return svc;
+        }
+
         const bool isVendorService =
             strcmp(ProcessState::self()->getDriverName().c_str(), "/dev/vndbinder") == 0;
         const long timeout = uptimeMillis() + 5000;
@@ -170,7 +271,10 @@ public:
             usleep(1000*sleepTime);
 
             sp<IBinder> svc = checkService(name);
-            if (svc != NULL) return svc;
+            if (svc != NULL) {
+                gServiceCache->insert(name, svc);
+                return svc;
+            }
         }
         ALOGW("Service %s didn't start. Returning NULL", String8(name).string());
         return NULL;
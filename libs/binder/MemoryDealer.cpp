@@ -120,20 +120,38 @@ private:
 
 // ----------------------------------------------------------------------------
 
-class SimpleBestFitAllocator
+/*
+ * Interface shared by the heap allocators a MemoryDealer can be
+ * constructed with.
+ */
+class HeapAllocator
 {
+public:
     enum {
         PAGE_ALIGNED = 0x00000001
     };
+
+    virtual             ~HeapAllocator() { }
+    virtual size_t      allocate(size_t size, uint32_t flags = 0) = 0;
+    virtual status_t    deallocate(size_t offset) = 0;
+    virtual size_t      size() const = 0;
+    virtual void        dump(const char* what) const = 0;
+    virtual void        dump(String8& res, const char* what) const = 0;
+};
+
+// ----------------------------------------------------------------------------
+
+class SimpleBestFitAllocator : public HeapAllocator
+{
 public:
     explicit SimpleBestFitAllocator(size_t size);
-    ~SimpleBestFitAllocator();
+    virtual ~SimpleBestFitAllocator();
 
-    size_t      allocate(size_t size, uint32_t flags = 0);
-    status_t    deallocate(size_t offset);
-    size_t      size() const;
-    void        dump(const char* what) const;
-    void        dump(String8& res, const char* what) const;
+    virtual size_t      allocate(size_t size, uint32_t flags = 0);
+    virtual status_t    deallocate(size_t offset);
+    virtual size_t      size() const;
+    virtual void        dump(const char* what) const;
+    virtual void        dump(String8& res, const char* what) const;
 
     static size_t getAllocationAlignment() { return kMemoryAlign; }
 
@@ -163,6 +181,129 @@ private:
 
 // ----------------------------------------------------------------------------
 
+/*
+ * An O(1) allocator for dealers whose clients allocate and free small
+ * chunks of a few recurring sizes at high frequency.
+ *
+ * Requests are rounded up to power-of-two size classes.  Each class is
+ * served from a free list of equally-sized chunks carved out of page-sized
+ * slabs, which are themselves drawn from a backing best-fit allocator.
+ * allocate() and deallocate() are O(1) for all sizes up to half a slab;
+ * larger requests fall through to the backing allocator.  Slabs stay
+ * dedicated to their class once created, which suits the steady-state
+ * fixed-size workloads this allocator targets.
+ */
+class SizeClassAllocator : public HeapAllocator
+{
+public:
+    explicit SizeClassAllocator(size_t size)
+        : mBacking(size) {
+        mSlabCount = mBacking.size() / kSlabSize;
+        mSlabClass = new int8_t[mSlabCount];
+        memset(mSlabClass, -1, mSlabCount);
+    }
+
+    virtual ~SizeClassAllocator() {
+        delete [] mSlabClass;
+    }
+
+    virtual size_t allocate(size_t size, uint32_t flags = 0) {
+        if (size == 0) {
+            return 0;
+        }
+        const int cls = classIndex(size);
+        if (cls < 0) {
+            return mBacking.allocate(size, flags);
+        }
+        Mutex::Autolock _l(mLock);
+        Vector<size_t>& freeList = mFreeLists[cls];
+        if (freeList.isEmpty() && !refill(cls)) {
+            return NO_MEMORY;
+        }
+        const size_t offset = freeList.top();
+        freeList.pop();
+        return offset;
+    }
+
+    virtual status_t deallocate(size_t offset) {
+        {
+            Mutex::Autolock _l(mLock);
+            const size_t slab = offset / kSlabSize;
+            if (slab < mSlabCount && mSlabClass[slab] >= 0) {
+                mFreeLists[mSlabClass[slab]].push(offset);
+                return NO_ERROR;
+            }
+        }
+        return mBacking.deallocate(offset);
+    }
+
+    virtual size_t size() const {
+        return mBacking.size();
+    }
+
+    virtual void dump(const char* what) const {
+        String8 result;
+        dump(result, what);
+        ALOGD("%s", result.string());
+    }
+
+    virtual void dump(String8& res, const char* what) const {
+        {
+            Mutex::Autolock _l(mLock);
+            for (int cls = 0; cls < kNumClasses; cls++) {
+                const size_t chunkSize = kMinClassSize << cls;
+                res.appendFormat("  size class %4zu: %zu free chunks\n",
+                        chunkSize, mFreeLists[cls].size());
+            }
+        }
+        mBacking.dump(res, what);
+    }
+
+private:
+    enum {
+        kMinClassSize = 32,     // == kMemoryAlign of the backing allocator
+        kMaxClassSize = 2048,   // half a slab
+        kSlabSize     = 4096,
+        kNumClasses   = 7,      // 32, 64, ... 2048
+    };
+
+    static int classIndex(size_t size) {
+        if (size > kMaxClassSize) {
+            return -1;
+        }
+        int cls = 0;
+        size_t classSize = kMinClassSize;
+        while (classSize < size) {
+            classSize <<= 1;
+            cls++;
+        }
+        return cls;
+    }
+
+    bool refill(int cls) {
+        const size_t slab = mBacking.allocate(kSlabSize, PAGE_ALIGNED);
+        if (ssize_t(slab) < 0) {
+            return false;
+        }
+        mSlabClass[slab / kSlabSize] = cls;
+        const size_t chunkSize = kMinClassSize << cls;
+        for (size_t off = 0; off < kSlabSize; off += chunkSize) {
+            mFreeLists[cls].push(slab + off);
+        }
+        return true;
+    }
+
+    mutable Mutex           mLock;
+    SimpleBestFitAllocator  mBacking;
+    // size class each slab is dedicated to, or -1 while a slab (or any
+    // oversized allocation) is owned by the backing allocator
+    int8_t*                 mSlabClass;
+    size_t                  mSlabCount;
+    Vector<size_t>          mFreeLists[kNumClasses];
+};
+
+// ----------------------------------------------------------------------------
+
 Allocation::Allocation(
         const sp<MemoryDealer>& dealer,
         const sp<IMemoryHeap>& heap, ssize_t offset, size_t size)
@@ -227,10 +368,13 @@ Allocation::~Allocation()
 
 // ----------------------------------------------------------------------------
 
-MemoryDealer::MemoryDealer(size_t size, const char* name, uint32_t flags)
+MemoryDealer::MemoryDealer(size_t size, const char* name, uint32_t flags,
+        AllocatorType allocatorType)
     : mHeap(new MemoryHeapBase(size, flags, name)),
-    mAllocator(new SimpleBestFitAllocator(size))
-{    
+    mAllocator(allocatorType == SIZE_CLASS
+            ? static_cast<HeapAllocator*>(new SizeClassAllocator(size))
+            : static_cast<HeapAllocator*>(new SimpleBestFitAllocator(size)))
+{
 }
 
 MemoryDealer::~MemoryDealer()
@@ -262,7 +406,7 @@ const sp<IMemoryHeap>& MemoryDealer::heap() const {
     return mHeap;
 }
 
-SimpleBestFitAllocator* MemoryDealer::allocator() const {
+HeapAllocator* MemoryDealer::allocator() const {
     return mAllocator;
 }
 
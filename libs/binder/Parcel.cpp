@@ -73,6 +73,16 @@ static size_t pad_size(size_t s) {
     return PAD_SIZE_UNSAFE(s);
 }
 
+// The driver requires extra_buffers_size to be 8-byte aligned and charges
+// each BINDER_TYPE_PTR buffer ALIGN(length, sizeof(u64)) against it, so
+// scatter-gather buffer accounting must pad to 8 bytes, not pad_size()'s 4.
+static size_t buffer_pad_size(size_t s) {
+    if (s > (SIZE_T_MAX - 7)) {
+        abort();
+    }
+    return (s+7)&~((size_t)7);
+}
+
 // Note: must be kept in sync with android/os/StrictMode.java's PENALTY_GATHER
 #define STRICT_MODE_PENALTY_GATHER (0x40 << 16)
 
@@ -92,6 +102,68 @@ static size_t gParcelGlobalAllocCount = 0;
 
 static size_t gMaxFds = 0;
 
+// Opt-in pooling of parcel buffers.  Services handling very high transaction
+// rates can enable this so the data buffer and object offset array of small
+// parcels are recycled on the owning thread instead of going through
+// malloc/free on every transaction.  Expected to be flipped once during
+// process initialization, before binder threads are spawned.
+static bool gParcelBufferPoolEnabled = false;
+
+struct parcel_buffer_pool {
+    enum {
+        // Per-thread cap on retained buffers of each kind.
+        MAX_ENTRIES = 8,
+        // Buffers larger than this go back to the heap; the pool targets
+        // the small request/reply parcels that dominate transaction rate.
+        MAX_POOLED_CAPACITY = 4096,
+    };
+
+    struct entry {
+        void* data;
+        size_t capacity;
+    };
+
+    entry dataBuffers[MAX_ENTRIES];
+    size_t dataCount;
+    entry objectBuffers[MAX_ENTRIES];
+    size_t objectCount;
+
+    ~parcel_buffer_pool() {
+        while (dataCount > 0) free(dataBuffers[--dataCount].data);
+        while (objectCount > 0) free(objectBuffers[--objectCount].data);
+    }
+
+    static void* acquire(entry* entries, size_t* count, size_t desired,
+            size_t* outCapacity) {
+        for (size_t i = *count; i > 0; i--) {
+            if (entries[i-1].capacity >= desired) {
+                void* data = entries[i-1].data;
+                *outCapacity = entries[i-1].capacity;
+                entries[i-1] = entries[--(*count)];
+                return data;
+            }
+        }
+        return NULL;
+    }
+
+    static bool release(entry* entries, size_t* count, void* data,
+            size_t capacity) {
+        if (capacity == 0 || capacity > MAX_POOLED_CAPACITY
+                || *count >= MAX_ENTRIES) {
+            return false;
+        }
+        entries[*count].data = data;
+        entries[*count].capacity = capacity;
+        (*count)++;
+        return true;
+    }
+};
+
+static parcel_buffer_pool& threadBufferPool() {
+    static thread_local parcel_buffer_pool pool = {};
+    return pool;
+}
+
 // Maximum size of a blob to transfer in-place.
 static const size_t BLOB_INPLACE_LIMIT = 16 * 1024;
 
@@ -138,6 +210,9 @@ void acquire_object(const sp<ProcessState>& proc,
             }
             return;
         }
+        case BINDER_TYPE_PTR:
+            // Scatter-gather buffer reference; no refcounting to do.
+            return;
     }
 
     ALOGD("Invalid object type 0x%08x", obj.hdr.type);
@@ -189,6 +264,9 @@ static void release_object(const sp<ProcessState>& proc,
             }
             return;
         }
+        case BINDER_TYPE_PTR:
+            // Scatter-gather buffer reference; no refcounting to do.
+            return;
     }
 
     ALOGE("Invalid object type 0x%08x", obj.hdr.type);
@@ -377,6 +455,14 @@ size_t Parcel::getGlobalAllocCount() {
     return count;
 }
 
+void Parcel::setBufferPoolEnabled(bool enabled) {
+    gParcelBufferPoolEnabled = enabled;
+}
+
+bool Parcel::bufferPoolEnabled() {
+    return gParcelBufferPoolEnabled;
+}
+
 const uint8_t* Parcel::data() const
 {
     return mData;
@@ -551,6 +637,7 @@ status_t Parcel::appendFrom(const Parcel *parcel, size_t offset, size_t len)
                 flat->handle = fcntl(flat->handle, F_DUPFD_CLOEXEC, 0);
                 flat->cookie = 1;
                 mHasFds = mFdsKnown = true;
+                mFdCount++;
                 if (!mAllowFds) {
                     err = FDS_NOT_ALLOWED;
                 }
@@ -627,12 +714,17 @@ bool Parcel::enforceInterface(const String16& interface,
     } else {
       threadState->setStrictModePolicy(strictPolicy);
     }
-    const String16 str(readString16());
-    if (str == interface) {
+    // Compare the token in place: this runs once per incoming transaction,
+    // so don't pay for a String16 copy on the hot (matching) path.
+    size_t len;
+    const char16_t* str = readString16Inplace(&len);
+    if (str != NULL && len == interface.size()
+            && memcmp(str, interface.string(), len*sizeof(char16_t)) == 0) {
         return true;
     } else {
         ALOGW("**** enforceInterface() expected '%s' but read '%s'",
-                String8(interface).string(), String8(str).string());
+                String8(interface).string(),
+                String8(String16(str != NULL ? str : u"", len)).string());
         return false;
     }
 }
@@ -1317,6 +1409,7 @@ restart_write:
                 return FDS_NOT_ALLOWED;
             }
             mHasFds = mFdsKnown = true;
+            mFdCount++;
         }
 
         // Need to write meta-data?
@@ -1333,6 +1426,58 @@ restart_write:
         const status_t err = growData(sizeof(val));
         if (err != NO_ERROR) return err;
     }
+    if (!enoughObjects) {
+        size_t newSize = ((mObjectsSize+2)*3)/2;
+        if (newSize*sizeof(binder_size_t) < mObjectsSize) return NO_MEMORY;   // overflow
+        binder_size_t* objects = NULL;
+        if (mObjects == NULL && gParcelBufferPoolEnabled) {
+            parcel_buffer_pool& pool = threadBufferPool();
+            size_t capacity = 0;
+            objects = (binder_size_t*)parcel_buffer_pool::acquire(
+                    pool.objectBuffers, &pool.objectCount,
+                    newSize*sizeof(binder_size_t), &capacity);
+            if (objects != NULL) newSize = capacity/sizeof(binder_size_t);
+        }
+        if (objects == NULL) {
+            objects = (binder_size_t*)realloc(mObjects, newSize*sizeof(binder_size_t));
+        }
+        if (objects == NULL) return NO_MEMORY;
+        mObjects = objects;
+        mObjectsCapacity = newSize;
+    }
+
+    goto restart_write;
+}
+
+status_t Parcel::writeNoCopy(const void* data, size_t len)
+{
+    if (data == NULL || len > INT32_MAX) {
+        return BAD_VALUE;
+    }
+
+    binder_buffer_object obj;
+    obj.hdr.type = BINDER_TYPE_PTR;
+    obj.flags = 0;
+    obj.buffer = reinterpret_cast<binder_uintptr_t>(data);
+    obj.length = len;
+    obj.parent = 0;
+    obj.parent_offset = 0;
+
+restart_write:
+    const bool enoughData = (mDataPos+sizeof(obj)) <= mDataCapacity;
+    const bool enoughObjects = mObjectsSize < mObjectsCapacity;
+    if (enoughData && enoughObjects) {
+        memcpy(mData+mDataPos, &obj, sizeof(obj));
+        mObjects[mObjectsSize] = mDataPos;
+        mObjectsSize++;
+        mBuffersSize += buffer_pad_size(len);
+        return finishWrite(sizeof(obj));
+    }
+
+    if (!enoughData) {
+        const status_t err = growData(sizeof(obj));
+        if (err != NO_ERROR) return err;
+    }
     if (!enoughObjects) {
         size_t newSize = ((mObjectsSize+2)*3)/2;
         if (newSize*sizeof(binder_size_t) < mObjectsSize) return NO_MEMORY;   // overflow
@@ -2063,6 +2208,25 @@ status_t Parcel::readString8(String8* pArg) const
     return OK;
 }
 
+const char* Parcel::readString8Inplace(size_t* outLen) const
+{
+    int32_t size = readInt32();
+    // watch for potential int overflow from size+1
+    if (size >= 0 && size < INT32_MAX) {
+        *outLen = size;
+        if (size == 0) {
+            // |writeString8| writes nothing for the empty string.
+            return "";
+        }
+        const char* str = (const char*)readInplace(size+1);
+        if (str != NULL) {
+            return str;
+        }
+    }
+    *outLen = 0;
+    return NULL;
+}
+
 String16 Parcel::readString16() const
 {
     size_t len;
@@ -2286,6 +2450,21 @@ status_t Parcel::readBlob(size_t len, ReadableBlob* outBlob) const
     return NO_ERROR;
 }
 
+status_t Parcel::readNoCopy(const void** outData, size_t* outLen) const
+{
+    const binder_buffer_object* obj =
+            reinterpret_cast<const binder_buffer_object*>(
+                    readInplace(sizeof(binder_buffer_object)));
+    if (obj == NULL) return NOT_ENOUGH_DATA;
+    if (obj->hdr.type != BINDER_TYPE_PTR) return BAD_TYPE;
+
+    // The kernel rewrote obj->buffer to point into our own transaction
+    // buffer when it copied the sender's data across.
+    *outData = reinterpret_cast<const void*>(obj->buffer);
+    *outLen = obj->length;
+    return NO_ERROR;
+}
+
 status_t Parcel::read(FlattenableHelperInterface& val) const
 {
     // size
@@ -2434,6 +2613,11 @@ size_t Parcel::ipcObjectsCount() const
     return mObjectsSize;
 }
 
+size_t Parcel::ipcBuffersSize() const
+{
+    return mBuffersSize;
+}
+
 void Parcel::ipcSetDataReference(const uint8_t* data, size_t dataSize,
     const binder_size_t* objects, size_t objectsCount, release_func relFunc, void* relCookie)
 {
@@ -2492,8 +2676,11 @@ void Parcel::print(TextOutput& to, uint32_t /*flags*/) const
 
 void Parcel::releaseObjects()
 {
-    const sp<ProcessState> proc(ProcessState::self());
     size_t i = mObjectsSize;
+    if (i == 0) {
+        return;
+    }
+    const sp<ProcessState> proc(ProcessState::self());
     uint8_t* const data = mData;
     binder_size_t* const objects = mObjects;
     while (i > 0) {
@@ -2506,8 +2693,11 @@ void Parcel::releaseObjects()
 
 void Parcel::acquireObjects()
 {
-    const sp<ProcessState> proc(ProcessState::self());
     size_t i = mObjectsSize;
+    if (i == 0) {
+        return;
+    }
+    const sp<ProcessState> proc(ProcessState::self());
     uint8_t* const data = mData;
     binder_size_t* const objects = mObjects;
     while (i > 0) {
@@ -2545,9 +2735,22 @@ void Parcel::freeDataNoInit()
               gParcelGlobalAllocCount--;
             }
             pthread_mutex_unlock(&gParcelGlobalAllocSizeLock);
-            free(mData);
+            parcel_buffer_pool& pool = threadBufferPool();
+            if (!gParcelBufferPoolEnabled
+                    || !parcel_buffer_pool::release(pool.dataBuffers,
+                            &pool.dataCount, mData, mDataCapacity)) {
+                free(mData);
+            }
+        }
+        if (mObjects) {
+            parcel_buffer_pool& pool = threadBufferPool();
+            if (!gParcelBufferPoolEnabled
+                    || !parcel_buffer_pool::release(pool.objectBuffers,
+                            &pool.objectCount, mObjects,
+                            mObjectsCapacity*sizeof(binder_size_t))) {
+                free(mObjects);
+            }
         }
-        if (mObjects) free(mObjects);
     }
 }
 
@@ -2608,8 +2811,10 @@ status_t Parcel::restartWrite(size_t desired)
     mObjectsSize = mObjectsCapacity = 0;
     mNextObjectHint = 0;
     mObjectsSorted = false;
+    mBuffersSize = 0;
     mHasFds = false;
     mFdsKnown = true;
+    mFdCount = 0;
     mAllowFds = true;
 
     return NO_ERROR;
@@ -2703,9 +2908,16 @@ status_t Parcel::continueWrite(size_t desired)
             for (size_t i=objectsSize; i<mObjectsSize; i++) {
                 const flat_binder_object* flat
                     = reinterpret_cast<flat_binder_object*>(mData+mObjects[i]);
-                if (flat->hdr.type == BINDER_TYPE_FD) {
-                    // will need to rescan because we may have lopped off the only FDs
-                    mFdsKnown = false;
+                if (flat->hdr.type == BINDER_TYPE_FD && mFdsKnown) {
+                    // keep the file descriptor count current so dropping
+                    // objects does not force hasFileDescriptors to rescan
+                    mFdCount--;
+                    mHasFds = mFdCount != 0;
+                }
+                if (flat->hdr.type == BINDER_TYPE_PTR) {
+                    const binder_buffer_object* buf
+                        = reinterpret_cast<binder_buffer_object*>(mData+mObjects[i]);
+                    mBuffersSize -= buffer_pad_size(buf->length);
                 }
                 release_object(proc, *flat, this, &mOpenAshmemSize);
             }
@@ -2748,7 +2960,17 @@ status_t Parcel::continueWrite(size_t desired)
 
     } else {
         // This is the first data.  Easy!
-        uint8_t* data = (uint8_t*)malloc(desired);
+        uint8_t* data = NULL;
+        size_t capacity = desired;
+        if (gParcelBufferPoolEnabled) {
+            parcel_buffer_pool& pool = threadBufferPool();
+            data = (uint8_t*)parcel_buffer_pool::acquire(pool.dataBuffers,
+                    &pool.dataCount, desired, &capacity);
+        }
+        if (!data) {
+            data = (uint8_t*)malloc(desired);
+            capacity = desired;
+        }
         if (!data) {
             mError = NO_MEMORY;
             return NO_MEMORY;
@@ -2759,9 +2981,9 @@ status_t Parcel::continueWrite(size_t desired)
             ALOGE("continueWrite: %zu/%p/%zu/%zu", mDataCapacity, mObjects, mObjectsCapacity, desired);
         }
 
-        LOG_ALLOC("Parcel %p: allocating with %zu capacity", this, desired);
+        LOG_ALLOC("Parcel %p: allocating with %zu capacity", this, capacity);
         pthread_mutex_lock(&gParcelGlobalAllocSizeLock);
-        gParcelGlobalAllocSize += desired;
+        gParcelGlobalAllocSize += capacity;
         gParcelGlobalAllocCount++;
         pthread_mutex_unlock(&gParcelGlobalAllocSizeLock);
 
@@ -2769,7 +2991,7 @@ status_t Parcel::continueWrite(size_t desired)
         mDataSize = mDataPos = 0;
         ALOGV("continueWrite Setting data size of %p to %zu", this, mDataSize);
         ALOGV("continueWrite Setting data pos of %p to %zu", this, mDataPos);
-        mDataCapacity = desired;
+        mDataCapacity = capacity;
     }
 
     return NO_ERROR;
@@ -2792,7 +3014,9 @@ void Parcel::initState()
     mObjectsSorted = false;
     mHasFds = false;
     mFdsKnown = true;
+    mFdCount = 0;
     mAllowFds = true;
+    mBuffersSize = 0;
     mOwner = NULL;
     mOpenAshmemSize = 0;
 
@@ -2811,16 +3035,16 @@ void Parcel::initState()
 
 void Parcel::scanForFds() const
 {
-    bool hasFds = false;
+    size_t fdCount = 0;
     for (size_t i=0; i<mObjectsSize; i++) {
         const flat_binder_object* flat
             = reinterpret_cast<const flat_binder_object*>(mData + mObjects[i]);
         if (flat->hdr.type == BINDER_TYPE_FD) {
-            hasFds = true;
-            break;
+            fdCount++;
         }
     }
-    mHasFds = hasFds;
+    mFdCount = fdCount;
+    mHasFds = fdCount != 0;
     mFdsKnown = true;
 }
 
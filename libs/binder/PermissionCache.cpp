@@ -36,13 +36,20 @@ PermissionCache::PermissionCache() {
 
 status_t PermissionCache::check(bool* granted,
         const String16& permission, uid_t uid) const {
-    Mutex::Autolock _l(mLock);
+    // Snapshots are immutable once published, so we can search one without
+    // holding mLock; racing with a writer at worst reports a stale miss,
+    // which the slow path then resolves.
+    std::shared_ptr<const State> state =
+            std::atomic_load_explicit(&mState, std::memory_order_acquire);
+    if (state == nullptr) {
+        return NAME_NOT_FOUND;
+    }
     Entry e;
     e.name = permission;
     e.uid  = uid;
-    ssize_t index = mCache.indexOf(e);
+    ssize_t index = state->entries.indexOf(e);
     if (index >= 0) {
-        *granted = mCache.itemAt(index).granted;
+        *granted = state->entries.itemAt(index).granted;
         return NO_ERROR;
     }
     return NAME_NOT_FOUND;
@@ -63,15 +70,23 @@ void PermissionCache::cache(const String16& permission,
     // permission checks
     e.uid  = uid;
     e.granted = granted;
-    index = mCache.indexOf(e);
+    std::shared_ptr<State> next = std::make_shared<State>();
+    if (mState != nullptr) {
+        next->entries = mState->entries;
+    }
+    index = next->entries.indexOf(e);
     if (index < 0) {
-        mCache.add(e);
+        next->entries.add(e);
     }
+    std::atomic_store_explicit(&mState,
+            std::shared_ptr<const State>(std::move(next)),
+            std::memory_order_release);
 }
 
 void PermissionCache::purge() {
     Mutex::Autolock _l(mLock);
-    mCache.clear();
+    std::atomic_store_explicit(&mState, std::shared_ptr<const State>(),
+            std::memory_order_release);
 }
 
 bool PermissionCache::checkCallingPermission(const String16& permission) {
@@ -19,8 +19,11 @@
 #include <binder/PersistableBundle.h>
 #include <private/binder/ParcelValTypes.h>
 
+#include <algorithm>
 #include <limits>
 
+#include <string.h>
+
 #include <binder/IBinder.h>
 #include <binder/Parcel.h>
 #include <log/log.h>
@@ -42,8 +45,15 @@ enum {
     // Keep them in sync with BUNDLE_MAGIC* in frameworks/base/core/java/android/os/BaseBundle.java.
     BUNDLE_MAGIC = 0x4C444E42,
     BUNDLE_MAGIC_NATIVE = 0x4C444E44,
+    // Native-only flat (offset-indexed) format; see writeToParcelFlat().
+    // Java readers never see this magic unless the flat format was
+    // explicitly enabled, which requires all-native peers.
+    BUNDLE_MAGIC_NATIVE_FLAT = 0x4C444E46,
 };
 
+// Process-wide opt-in to the flat wire format; see setFlatFormatEnabled().
+static bool gFlatFormatEnabled = false;
+
 namespace {
 template <typename T>
 bool getValue(const android::String16& key, T* out, const map<android::String16, T>& map) {
@@ -62,6 +72,231 @@ set<android::String16> getKeys(const map<android::String16, T>& map) {
     }
     return keys;
 }
+
+/*
+ * Reads values out of a flat-format chunk, replicating Parcel's 4-byte
+ * alignment rules so values can be decoded without a Parcel instance.
+ */
+class FlatReader {
+  public:
+    FlatReader(const uint8_t* data, size_t size, size_t pos)
+        : mData(data), mSize(size), mPos(pos) {}
+
+    bool read(void* out, size_t len) {
+        if (mPos > mSize || len > mSize - mPos) return false;
+        memcpy(out, mData + mPos, len);
+        mPos = (mPos + len + 3) & ~static_cast<size_t>(3);
+        return true;
+    }
+
+    bool readInt32(int32_t* out) { return read(out, sizeof(*out)); }
+    bool readInt64(int64_t* out) { return read(out, sizeof(*out)); }
+    bool readDouble(double* out) { return read(out, sizeof(*out)); }
+
+    bool readBool(bool* out) {
+        int32_t tmp;
+        if (!readInt32(&tmp)) return false;
+        *out = tmp != 0;
+        return true;
+    }
+
+    bool readString16(android::String16* out) {
+        int32_t len;
+        if (!readInt32(&len) || len < 0) return false;
+        const size_t nbytes = (static_cast<size_t>(len) + 1) * sizeof(char16_t);
+        if (mPos > mSize || nbytes > mSize - mPos) return false;
+        out->setTo(reinterpret_cast<const char16_t*>(mData + mPos), len);
+        mPos = (mPos + nbytes + 3) & ~static_cast<size_t>(3);
+        return true;
+    }
+
+    template <typename T>
+    bool readVector(vector<T>* out) {
+        int32_t num;
+        if (!readInt32(&num) || num < 0) return false;
+        out->clear();
+        for (int32_t i = 0; i < num; i++) {
+            T value;
+            if (!read(&value, sizeof(value))) return false;
+            out->push_back(value);
+        }
+        return true;
+    }
+
+    bool readBoolVector(vector<bool>* out) {
+        int32_t num;
+        if (!readInt32(&num) || num < 0) return false;
+        out->clear();
+        for (int32_t i = 0; i < num; i++) {
+            bool value;
+            if (!readBool(&value)) return false;
+            out->push_back(value);
+        }
+        return true;
+    }
+
+    bool readString16Vector(vector<android::String16>* out) {
+        int32_t num;
+        if (!readInt32(&num) || num < 0) return false;
+        out->clear();
+        for (int32_t i = 0; i < num; i++) {
+            android::String16 value;
+            if (!readString16(&value)) return false;
+            out->push_back(value);
+        }
+        return true;
+    }
+
+    // Returns a reader over the same data positioned at |pos|.
+    FlatReader at(size_t pos) const { return FlatReader(mData, mSize, pos); }
+
+    // Returns a reader over the next |len| bytes and skips past them.
+    FlatReader window(size_t len) {
+        if (mPos > mSize || len > mSize - mPos) {
+            return FlatReader(mData, 0, 0);
+        }
+        FlatReader sub(mData + mPos, len, 0);
+        mPos = (mPos + len + 3) & ~static_cast<size_t>(3);
+        return sub;
+    }
+
+  private:
+    const uint8_t* mData;
+    size_t mSize;
+    size_t mPos;
+};
+
+// Returns the characters of the length-prefixed key stored at |pos|, or
+// nullptr if it does not fit inside the chunk.
+const char16_t* flatKeyAt(const uint8_t* data, size_t size, int32_t pos,
+                          size_t* outLen) {
+    if (pos < 0 || static_cast<size_t>(pos) + sizeof(int32_t) > size) return nullptr;
+    int32_t len;
+    memcpy(&len, data + pos, sizeof(len));
+    if (len < 0) return nullptr;
+    const size_t charsPos = pos + sizeof(int32_t);
+    const size_t nbytes = (static_cast<size_t>(len) + 1) * sizeof(char16_t);
+    if (nbytes > size - charsPos) return nullptr;
+    *outLen = len;
+    return reinterpret_cast<const char16_t*>(data + charsPos);
+}
+
+int compareKey16(const char16_t* a, size_t a_len, const char16_t* b, size_t b_len) {
+    const size_t n = a_len < b_len ? a_len : b_len;
+    for (size_t i = 0; i < n; i++) {
+        if (a[i] != b[i]) return a[i] < b[i] ? -1 : 1;
+    }
+    if (a_len == b_len) return 0;
+    return a_len < b_len ? -1 : 1;
+}
+
+bool readNestedBundle(FlatReader* reader, android::os::PersistableBundle* out);
+
+// Decodes a single flat-format value into |out| under |key|.
+bool decodeFlatValue(FlatReader* reader, int32_t type,
+                     const android::String16& key,
+                     android::os::PersistableBundle* out) {
+    switch (type) {
+        case VAL_BOOLEAN: {
+            bool value;
+            if (!reader->readBool(&value)) return false;
+            out->putBoolean(key, value);
+            return true;
+        }
+        case VAL_INTEGER: {
+            int32_t value;
+            if (!reader->readInt32(&value)) return false;
+            out->putInt(key, value);
+            return true;
+        }
+        case VAL_LONG: {
+            int64_t value;
+            if (!reader->readInt64(&value)) return false;
+            out->putLong(key, value);
+            return true;
+        }
+        case VAL_DOUBLE: {
+            double value;
+            if (!reader->readDouble(&value)) return false;
+            out->putDouble(key, value);
+            return true;
+        }
+        case VAL_STRING: {
+            android::String16 value;
+            if (!reader->readString16(&value)) return false;
+            out->putString(key, value);
+            return true;
+        }
+        case VAL_BOOLEANARRAY: {
+            vector<bool> value;
+            if (!reader->readBoolVector(&value)) return false;
+            out->putBooleanVector(key, value);
+            return true;
+        }
+        case VAL_INTARRAY: {
+            vector<int32_t> value;
+            if (!reader->readVector(&value)) return false;
+            out->putIntVector(key, value);
+            return true;
+        }
+        case VAL_LONGARRAY: {
+            vector<int64_t> value;
+            if (!reader->readVector(&value)) return false;
+            out->putLongVector(key, value);
+            return true;
+        }
+        case VAL_DOUBLEARRAY: {
+            vector<double> value;
+            if (!reader->readVector(&value)) return false;
+            out->putDoubleVector(key, value);
+            return true;
+        }
+        case VAL_STRINGARRAY: {
+            vector<android::String16> value;
+            if (!reader->readString16Vector(&value)) return false;
+            out->putStringVector(key, value);
+            return true;
+        }
+        case VAL_PERSISTABLEBUNDLE: {
+            android::os::PersistableBundle value;
+            if (!readNestedBundle(reader, &value)) return false;
+            out->putPersistableBundle(key, value);
+            return true;
+        }
+        default:
+            return false;
+    }
+}
+
+// Decodes a nested bundle (length + magic + flat chunk) eagerly.
+bool readNestedBundle(FlatReader* reader, android::os::PersistableBundle* out) {
+    int32_t length;
+    if (!reader->readInt32(&length) || length < 0) return false;
+    if (length == 0) {
+        *out = android::os::PersistableBundle();
+        return true;
+    }
+    int32_t magic;
+    if (!reader->readInt32(&magic)) return false;
+    // nested bundles always follow their parent's format
+    if (magic != BUNDLE_MAGIC_NATIVE_FLAT) return false;
+    FlatReader chunk = reader->window(length);
+    int32_t num_entries;
+    if (!chunk.readInt32(&num_entries) || num_entries < 0) return false;
+    for (int32_t i = 0; i < num_entries; i++) {
+        int32_t key_pos, type, value_pos;
+        if (!chunk.readInt32(&key_pos) || !chunk.readInt32(&type) ||
+            !chunk.readInt32(&value_pos) || key_pos < 0 || value_pos < 0) {
+            return false;
+        }
+        android::String16 key;
+        FlatReader key_reader = chunk.at(key_pos);
+        if (!key_reader.readString16(&key)) return false;
+        FlatReader value_reader = chunk.at(value_pos);
+        if (!decodeFlatValue(&value_reader, type, key, out)) return false;
+    }
+    return true;
+}
 }  // namespace
 
 namespace android {
@@ -86,12 +321,28 @@ namespace os {
          }                                                               \
     }
 
+// static
+void PersistableBundle::setFlatFormatEnabled(bool enabled) {
+    gFlatFormatEnabled = enabled;
+}
+
 status_t PersistableBundle::writeToParcel(Parcel* parcel) const {
     /*
      * Keep implementation in sync with writeToParcelInner() in
      * frameworks/base/core/java/android/os/BaseBundle.java.
      */
 
+    if (mFlatIndex) {
+        if (gFlatFormatEnabled) {
+            // Still in flat form: the chunk is position-independent, so
+            // pass it through without materializing the maps.
+            RETURN_IF_FAILED(parcel->writeInt32(static_cast<int32_t>(mFlatChunk->size())));
+            RETURN_IF_FAILED(parcel->writeInt32(BUNDLE_MAGIC_NATIVE_FLAT));
+            return parcel->write(mFlatChunk->data(), mFlatChunk->size());
+        }
+        unflatten();
+    }
+
     // Special case for empty bundles.
     if (empty()) {
         RETURN_IF_FAILED(parcel->writeInt32(0));
@@ -100,10 +351,12 @@ status_t PersistableBundle::writeToParcel(Parcel* parcel) const {
 
     size_t length_pos = parcel->dataPosition();
     RETURN_IF_FAILED(parcel->writeInt32(1));  // dummy, will hold length
-    RETURN_IF_FAILED(parcel->writeInt32(BUNDLE_MAGIC_NATIVE));
+    RETURN_IF_FAILED(parcel->writeInt32(
+            gFlatFormatEnabled ? BUNDLE_MAGIC_NATIVE_FLAT : BUNDLE_MAGIC_NATIVE));
 
     size_t start_pos = parcel->dataPosition();
-    RETURN_IF_FAILED(writeToParcelInner(parcel));
+    RETURN_IF_FAILED(gFlatFormatEnabled ? writeToParcelFlat(parcel)
+                                        : writeToParcelInner(parcel));
     size_t end_pos = parcel->dataPosition();
 
     // Backpatch length. This length value includes the length header.
@@ -137,6 +390,7 @@ bool PersistableBundle::empty() const {
 }
 
 size_t PersistableBundle::size() const {
+    unflatten();
     return (mBoolMap.size() +
             mIntMap.size() +
             mLongMap.size() +
@@ -151,6 +405,7 @@ size_t PersistableBundle::size() const {
 }
 
 size_t PersistableBundle::erase(const String16& key) {
+    unflatten();
     RETURN_IF_ENTRY_ERASED(mBoolMap, key);
     RETURN_IF_ENTRY_ERASED(mIntMap, key);
     RETURN_IF_ENTRY_ERASED(mLongMap, key);
@@ -220,90 +475,167 @@ void PersistableBundle::putPersistableBundle(const String16& key, const Persista
 }
 
 bool PersistableBundle::getBoolean(const String16& key, bool* out) const {
+    if (mFlatIndex) {
+        const FlatEntry* entry = findFlatEntry(key);
+        if (entry == nullptr || entry->type != VAL_BOOLEAN) return false;
+        FlatReader reader(mFlatChunk->data(), mFlatChunk->size(), entry->valuePos);
+        return reader.readBool(out);
+    }
     return getValue(key, out, mBoolMap);
 }
 
 bool PersistableBundle::getInt(const String16& key, int32_t* out) const {
+    if (mFlatIndex) {
+        const FlatEntry* entry = findFlatEntry(key);
+        if (entry == nullptr || entry->type != VAL_INTEGER) return false;
+        FlatReader reader(mFlatChunk->data(), mFlatChunk->size(), entry->valuePos);
+        return reader.readInt32(out);
+    }
     return getValue(key, out, mIntMap);
 }
 
 bool PersistableBundle::getLong(const String16& key, int64_t* out) const {
+    if (mFlatIndex) {
+        const FlatEntry* entry = findFlatEntry(key);
+        if (entry == nullptr || entry->type != VAL_LONG) return false;
+        FlatReader reader(mFlatChunk->data(), mFlatChunk->size(), entry->valuePos);
+        return reader.readInt64(out);
+    }
     return getValue(key, out, mLongMap);
 }
 
 bool PersistableBundle::getDouble(const String16& key, double* out) const {
+    if (mFlatIndex) {
+        const FlatEntry* entry = findFlatEntry(key);
+        if (entry == nullptr || entry->type != VAL_DOUBLE) return false;
+        FlatReader reader(mFlatChunk->data(), mFlatChunk->size(), entry->valuePos);
+        return reader.readDouble(out);
+    }
     return getValue(key, out, mDoubleMap);
 }
 
 bool PersistableBundle::getString(const String16& key, String16* out) const {
+    if (mFlatIndex) {
+        const FlatEntry* entry = findFlatEntry(key);
+        if (entry == nullptr || entry->type != VAL_STRING) return false;
+        FlatReader reader(mFlatChunk->data(), mFlatChunk->size(), entry->valuePos);
+        return reader.readString16(out);
+    }
     return getValue(key, out, mStringMap);
 }
 
 bool PersistableBundle::getBooleanVector(const String16& key, vector<bool>* out) const {
+    if (mFlatIndex) {
+        const FlatEntry* entry = findFlatEntry(key);
+        if (entry == nullptr || entry->type != VAL_BOOLEANARRAY) return false;
+        FlatReader reader(mFlatChunk->data(), mFlatChunk->size(), entry->valuePos);
+        return reader.readBoolVector(out);
+    }
     return getValue(key, out, mBoolVectorMap);
 }
 
 bool PersistableBundle::getIntVector(const String16& key, vector<int32_t>* out) const {
+    if (mFlatIndex) {
+        const FlatEntry* entry = findFlatEntry(key);
+        if (entry == nullptr || entry->type != VAL_INTARRAY) return false;
+        FlatReader reader(mFlatChunk->data(), mFlatChunk->size(), entry->valuePos);
+        return reader.readVector(out);
+    }
     return getValue(key, out, mIntVectorMap);
 }
 
 bool PersistableBundle::getLongVector(const String16& key, vector<int64_t>* out) const {
+    if (mFlatIndex) {
+        const FlatEntry* entry = findFlatEntry(key);
+        if (entry == nullptr || entry->type != VAL_LONGARRAY) return false;
+        FlatReader reader(mFlatChunk->data(), mFlatChunk->size(), entry->valuePos);
+        return reader.readVector(out);
+    }
     return getValue(key, out, mLongVectorMap);
 }
 
 bool PersistableBundle::getDoubleVector(const String16& key, vector<double>* out) const {
+    if (mFlatIndex) {
+        const FlatEntry* entry = findFlatEntry(key);
+        if (entry == nullptr || entry->type != VAL_DOUBLEARRAY) return false;
+        FlatReader reader(mFlatChunk->data(), mFlatChunk->size(), entry->valuePos);
+        return reader.readVector(out);
+    }
     return getValue(key, out, mDoubleVectorMap);
 }
 
 bool PersistableBundle::getStringVector(const String16& key, vector<String16>* out) const {
+    if (mFlatIndex) {
+        const FlatEntry* entry = findFlatEntry(key);
+        if (entry == nullptr || entry->type != VAL_STRINGARRAY) return false;
+        FlatReader reader(mFlatChunk->data(), mFlatChunk->size(), entry->valuePos);
+        return reader.readString16Vector(out);
+    }
     return getValue(key, out, mStringVectorMap);
 }
 
 bool PersistableBundle::getPersistableBundle(const String16& key, PersistableBundle* out) const {
+    if (mFlatIndex) {
+        const FlatEntry* entry = findFlatEntry(key);
+        if (entry == nullptr || entry->type != VAL_PERSISTABLEBUNDLE) return false;
+        FlatReader reader(mFlatChunk->data(), mFlatChunk->size(), entry->valuePos);
+        return readNestedBundle(&reader, out);
+    }
     return getValue(key, out, mPersistableBundleMap);
 }
 
 set<String16> PersistableBundle::getBooleanKeys() const {
+    unflatten();
     return getKeys(mBoolMap);
 }
 
 set<String16> PersistableBundle::getIntKeys() const {
+    unflatten();
     return getKeys(mIntMap);
 }
 
 set<String16> PersistableBundle::getLongKeys() const {
+    unflatten();
     return getKeys(mLongMap);
 }
 
 set<String16> PersistableBundle::getDoubleKeys() const {
+    unflatten();
     return getKeys(mDoubleMap);
 }
 
 set<String16> PersistableBundle::getStringKeys() const {
+    unflatten();
     return getKeys(mStringMap);
 }
 
 set<String16> PersistableBundle::getBooleanVectorKeys() const {
+    unflatten();
     return getKeys(mBoolVectorMap);
 }
 
 set<String16> PersistableBundle::getIntVectorKeys() const {
+    unflatten();
     return getKeys(mIntVectorMap);
 }
 
 set<String16> PersistableBundle::getLongVectorKeys() const {
+    unflatten();
     return getKeys(mLongVectorMap);
 }
 
 set<String16> PersistableBundle::getDoubleVectorKeys() const {
+    unflatten();
     return getKeys(mDoubleVectorMap);
 }
 
 set<String16> PersistableBundle::getStringVectorKeys() const {
+    unflatten();
     return getKeys(mStringVectorMap);
 }
 
 set<String16> PersistableBundle::getPersistableBundleKeys() const {
+    unflatten();
     return getKeys(mPersistableBundleMap);
 }
 
@@ -393,6 +725,9 @@ status_t PersistableBundle::readFromParcelInner(const Parcel* parcel, size_t len
 
     int32_t magic;
     RETURN_IF_FAILED(parcel->readInt32(&magic));
+    if (magic == BUNDLE_MAGIC_NATIVE_FLAT) {
+        return readFromParcelFlat(parcel, length);
+    }
     if (magic != BUNDLE_MAGIC && magic != BUNDLE_MAGIC_NATIVE) {
         ALOGE("Bad magic number for PersistableBundle: 0x%08x", magic);
         return BAD_VALUE;
@@ -473,6 +808,180 @@ status_t PersistableBundle::readFromParcelInner(const Parcel* parcel, size_t len
     return NO_ERROR;
 }
 
+/*
+ * Flat format layout (everything 4-byte aligned, offsets relative to the
+ * start of the chunk, i.e. the num_entries field):
+ *
+ *   int32 num_entries
+ *   num_entries * { int32 key_offset; int32 value_type; int32 value_offset; }
+ *   interleaved key strings (writeString16 layout) and values, written
+ *   with the regular Parcel primitives
+ *
+ * Readers can locate any key through the offset table without decoding
+ * the values; nested bundles recurse through writeToParcel().
+ */
+status_t PersistableBundle::writeToParcelFlat(Parcel* parcel) const {
+    size_t num_entries = size();
+    if (num_entries > std::numeric_limits<int32_t>::max()) {
+        ALOGE("The size of this PersistableBundle (%zu) too large to store in 32-bit signed int",
+              num_entries);
+        return BAD_VALUE;
+    }
+
+    const size_t base = parcel->dataPosition();
+    RETURN_IF_FAILED(parcel->writeInt32(static_cast<int32_t>(num_entries)));
+
+    const size_t table_pos = parcel->dataPosition();
+    for (size_t i = 0; i < 3 * num_entries; i++) {
+        RETURN_IF_FAILED(parcel->writeInt32(0));  // dummy, will hold the table
+    }
+
+    std::vector<FlatEntry> table;
+    table.reserve(num_entries);
+
+#define WRITE_FLAT_ENTRIES(m, vtype, writeExpr)                                   \
+    for (const auto& key_val_pair : (m)) {                                        \
+        FlatEntry entry;                                                          \
+        entry.keyPos = static_cast<int32_t>(parcel->dataPosition() - base);       \
+        RETURN_IF_FAILED(parcel->writeString16(key_val_pair.first));              \
+        entry.type = (vtype);                                                     \
+        entry.valuePos = static_cast<int32_t>(parcel->dataPosition() - base);     \
+        RETURN_IF_FAILED(writeExpr);                                              \
+        table.push_back(entry);                                                   \
+    }
+
+    WRITE_FLAT_ENTRIES(mBoolMap, VAL_BOOLEAN, parcel->writeBool(key_val_pair.second));
+    WRITE_FLAT_ENTRIES(mIntMap, VAL_INTEGER, parcel->writeInt32(key_val_pair.second));
+    WRITE_FLAT_ENTRIES(mLongMap, VAL_LONG, parcel->writeInt64(key_val_pair.second));
+    WRITE_FLAT_ENTRIES(mDoubleMap, VAL_DOUBLE, parcel->writeDouble(key_val_pair.second));
+    WRITE_FLAT_ENTRIES(mStringMap, VAL_STRING, parcel->writeString16(key_val_pair.second));
+    WRITE_FLAT_ENTRIES(mBoolVectorMap, VAL_BOOLEANARRAY,
+                       parcel->writeBoolVector(key_val_pair.second));
+    WRITE_FLAT_ENTRIES(mIntVectorMap, VAL_INTARRAY,
+                       parcel->writeInt32Vector(key_val_pair.second));
+    WRITE_FLAT_ENTRIES(mLongVectorMap, VAL_LONGARRAY,
+                       parcel->writeInt64Vector(key_val_pair.second));
+    WRITE_FLAT_ENTRIES(mDoubleVectorMap, VAL_DOUBLEARRAY,
+                       parcel->writeDoubleVector(key_val_pair.second));
+    WRITE_FLAT_ENTRIES(mStringVectorMap, VAL_STRINGARRAY,
+                       parcel->writeString16Vector(key_val_pair.second));
+    WRITE_FLAT_ENTRIES(mPersistableBundleMap, VAL_PERSISTABLEBUNDLE,
+                       key_val_pair.second.writeToParcel(parcel));
+
+#undef WRITE_FLAT_ENTRIES
+
+    // Backpatch the offset table.
+    const size_t end_pos = parcel->dataPosition();
+    parcel->setDataPosition(table_pos);
+    for (const FlatEntry& entry : table) {
+        RETURN_IF_FAILED(parcel->writeInt32(entry.keyPos));
+        RETURN_IF_FAILED(parcel->writeInt32(entry.type));
+        RETURN_IF_FAILED(parcel->writeInt32(entry.valuePos));
+    }
+    parcel->setDataPosition(end_pos);
+    return NO_ERROR;
+}
+
+status_t PersistableBundle::readFromParcelFlat(const Parcel* parcel, size_t length) {
+    const uint8_t* data =
+            reinterpret_cast<const uint8_t*>(parcel->readInplace(length));
+    if (data == nullptr) {
+        ALOGE("Flat PersistableBundle chunk (%zu bytes) exceeds parcel", length);
+        return BAD_VALUE;
+    }
+
+    auto chunk = std::make_shared<std::vector<uint8_t>>(data, data + length);
+    FlatReader reader(chunk->data(), chunk->size(), 0);
+
+    int32_t num_entries;
+    if (!reader.readInt32(&num_entries) || num_entries < 0) return BAD_VALUE;
+
+    auto index = std::make_shared<std::vector<FlatEntry>>();
+    index->reserve(num_entries);
+    for (int32_t i = 0; i < num_entries; i++) {
+        FlatEntry entry;
+        if (!reader.readInt32(&entry.keyPos) || !reader.readInt32(&entry.type) ||
+            !reader.readInt32(&entry.valuePos)) {
+            return BAD_VALUE;
+        }
+        size_t key_len;
+        if (flatKeyAt(chunk->data(), chunk->size(), entry.keyPos, &key_len) == nullptr ||
+            entry.valuePos < 0 || static_cast<size_t>(entry.valuePos) >= chunk->size()) {
+            ALOGE("Malformed flat PersistableBundle entry %d", i);
+            return BAD_VALUE;
+        }
+        index->push_back(entry);
+    }
+
+    // Sort the index by key so lookups can binary search.
+    const uint8_t* chunk_data = chunk->data();
+    const size_t chunk_size = chunk->size();
+    std::sort(index->begin(), index->end(),
+              [chunk_data, chunk_size](const FlatEntry& a, const FlatEntry& b) {
+                  size_t a_len, b_len;
+                  const char16_t* a_str = flatKeyAt(chunk_data, chunk_size, a.keyPos, &a_len);
+                  const char16_t* b_str = flatKeyAt(chunk_data, chunk_size, b.keyPos, &b_len);
+                  return compareKey16(a_str, a_len, b_str, b_len) < 0;
+              });
+
+    const bool was_empty = (size() == 0);  // note: materializes any previous flat state
+    mFlatChunk = std::move(chunk);
+    mFlatIndex = std::move(index);
+    if (!was_empty) {
+        // Reading into a non-empty bundle keeps the historical merge
+        // semantics, which require the maps.
+        unflatten();
+    }
+    return NO_ERROR;
+}
+
+const PersistableBundle::FlatEntry* PersistableBundle::findFlatEntry(
+        const String16& key) const {
+    const std::vector<FlatEntry>& index = *mFlatIndex;
+    const uint8_t* chunk_data = mFlatChunk->data();
+    const size_t chunk_size = mFlatChunk->size();
+    size_t lo = 0;
+    size_t hi = index.size();
+    while (lo < hi) {
+        const size_t mid = lo + (hi - lo) / 2;
+        size_t mid_len;
+        const char16_t* mid_str = flatKeyAt(chunk_data, chunk_size,
+                                            index[mid].keyPos, &mid_len);
+        const int cmp = compareKey16(mid_str, mid_len, key.string(), key.size());
+        if (cmp == 0) return &index[mid];
+        if (cmp < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return nullptr;
+}
+
+void PersistableBundle::unflatten() const {
+    if (!mFlatIndex) return;
+
+    // Logically const: this only converts the representation.
+    PersistableBundle* self = const_cast<PersistableBundle*>(this);
+
+    // Detach the flat state first so the put* calls below do not recurse
+    // back into unflatten() through erase().
+    std::shared_ptr<const std::vector<uint8_t>> chunk = std::move(self->mFlatChunk);
+    std::shared_ptr<const std::vector<FlatEntry>> index = std::move(self->mFlatIndex);
+    self->mFlatChunk.reset();
+    self->mFlatIndex.reset();
+
+    for (const FlatEntry& entry : *index) {
+        String16 key;
+        FlatReader key_reader(chunk->data(), chunk->size(), entry.keyPos);
+        FlatReader value_reader(chunk->data(), chunk->size(), entry.valuePos);
+        if (!key_reader.readString16(&key) ||
+            !decodeFlatValue(&value_reader, entry.type, key, self)) {
+            ALOGE("Dropping malformed flat PersistableBundle entry");
+        }
+    }
+}
+
 }  // namespace os
 
 }  // namespace android
@@ -25,8 +25,11 @@
 #include <utils/Log.h>
 #include <utils/String8.h>
 #include <utils/String8.h>
+#include <utils/Timers.h>
 #include <utils/threads.h>
 
+#include <inttypes.h>
+
 #include <private/binder/binder_module.h>
 #include <private/binder/Static.h>
 
@@ -71,7 +74,23 @@ sp<ProcessState> ProcessState::self()
     if (gProcess != NULL) {
         return gProcess;
     }
-    gProcess = new ProcessState("/dev/binder");
+    gProcess = new ProcessState("/dev/binder", BINDER_VM_SIZE);
+    return gProcess;
+}
+
+sp<ProcessState> ProcessState::initWithMmapSize(size_t mmapSize)
+{
+    Mutex::Autolock _l(gProcessMutex);
+    if (gProcess != NULL) {
+        // Allow for initWithMmapSize to be called repeatedly with the size
+        // already in effect.
+        if (gProcess->mMmapSize == mmapSize) {
+            return gProcess;
+        }
+        LOG_ALWAYS_FATAL("ProcessState was already initialized.");
+    }
+
+    gProcess = new ProcessState("/dev/binder", mmapSize);
     return gProcess;
 }
 
@@ -92,7 +111,7 @@ sp<ProcessState> ProcessState::initWithDriver(const char* driver)
         driver = "/dev/binder";
     }
 
-    gProcess = new ProcessState(driver);
+    gProcess = new ProcessState(driver, BINDER_VM_SIZE);
     return gProcess;
 }
 
@@ -228,28 +247,47 @@ ssize_t ProcessState::getKernelReferences(size_t buf_count, uintptr_t* buf)
     return count;
 }
 
-ProcessState::handle_entry* ProcessState::lookupHandleLocked(int32_t handle)
+ProcessState::handle_entry* ProcessState::lookupHandle(int32_t handle)
 {
-    const size_t N=mHandleToObject.size();
-    if (N <= (size_t)handle) {
-        handle_entry e;
-        e.binder = NULL;
-        e.refs = NULL;
-        status_t err = mHandleToObject.insertAt(e, N, handle+1-N);
-        if (err < NO_ERROR) return NULL;
+    if (handle < 0) return NULL;
+
+    const uint32_t n =
+            (static_cast<uint32_t>(handle) / kHandleSegmentSize) + 1;
+    const size_t seg = 31 - static_cast<size_t>(__builtin_clz(n));
+    if (seg >= kNumHandleSegments) return NULL;
+    const size_t offset = static_cast<uint32_t>(handle) -
+            kHandleSegmentSize * ((1u << seg) - 1);
+
+    handle_entry* segment = mHandleSegments[seg].load(std::memory_order_acquire);
+    if (segment == NULL) {
+        // Allocate the segment zero-initialized and race to publish it; the
+        // loser frees its copy and uses the winner's.
+        handle_entry* fresh =
+                new (std::nothrow) handle_entry[kHandleSegmentSize << seg]();
+        if (fresh == NULL) return NULL;
+        if (mHandleSegments[seg].compare_exchange_strong(segment, fresh,
+                std::memory_order_acq_rel, std::memory_order_acquire)) {
+            segment = fresh;
+        } else {
+            delete[] fresh;
+        }
     }
-    return &mHandleToObject.editItemAt(handle);
+    return &segment[offset];
+}
+
+Mutex& ProcessState::handleLock(int32_t handle) const
+{
+    return mHandleLocks[static_cast<uint32_t>(handle) % kHandleLockCount];
 }
 
 sp<IBinder> ProcessState::getStrongProxyForHandle(int32_t handle)
 {
     sp<IBinder> result;
 
-    AutoMutex _l(mLock);
-
-    handle_entry* e = lookupHandleLocked(handle);
+    handle_entry* e = lookupHandle(handle);
 
     if (e != NULL) {
+        AutoMutex _l(handleLock(handle));
         // We need to create a new BpBinder if there isn't currently one, OR we
         // are unable to acquire a weak reference on this current one.  See comment
         // in getWeakProxyForHandle() for more info about this.
@@ -302,11 +340,10 @@ wp<IBinder> ProcessState::getWeakProxyForHandle(int32_t handle)
 {
     wp<IBinder> result;
 
-    AutoMutex _l(mLock);
-
-    handle_entry* e = lookupHandleLocked(handle);
+    handle_entry* e = lookupHandle(handle);
 
-    if (e != NULL) {        
+    if (e != NULL) {
+        AutoMutex _l(handleLock(handle));
         // We need to create a new BpBinder if there isn't currently one, OR we
         // are unable to acquire a weak reference on this current one.  The
         // attemptIncWeak() is safe because we know the BpBinder destructor will always
@@ -331,9 +368,9 @@ wp<IBinder> ProcessState::getWeakProxyForHandle(int32_t handle)
 
 void ProcessState::expungeHandle(int32_t handle, IBinder* binder)
 {
-    AutoMutex _l(mLock);
-    
-    handle_entry* e = lookupHandleLocked(handle);
+    handle_entry* e = lookupHandle(handle);
+
+    AutoMutex _l(handleLock(handle));
 
     // This handle may have already been replaced with a new BpBinder
     // (if someone failed the AttemptIncWeak() above); we don't want
@@ -370,6 +407,100 @@ status_t ProcessState::setThreadPoolMaxThreadCount(size_t maxThreads) {
     return result;
 }
 
+// How long busy time is aggregated before the pre-spawn decision is made.
+#define POOL_BUSY_WINDOW_US (250 * 1000)
+
+status_t ProcessState::setThreadPoolPolicy(const ThreadPoolPolicy& policy)
+{
+    if (policy.maxThreads == 0 || policy.minThreads > policy.maxThreads ||
+            policy.busyThresholdPct > 100 || policy.idleTimeoutMs <= 0) {
+        return BAD_VALUE;
+    }
+
+    status_t result = setThreadPoolMaxThreadCount(policy.maxThreads);
+    if (result != NO_ERROR) return result;
+
+    size_t threadsToSpawn = 0;
+    pthread_mutex_lock(&mThreadCountLock);
+    mPoolPolicy = policy;
+    mAdaptivePoolEnabled = true;
+    mBusyWindowStartUs = 0;
+    mBusyTimeInWindowUs = 0;
+    if (mThreadPoolStarted && mPooledThreadsCount < policy.minThreads) {
+        threadsToSpawn = policy.minThreads - mPooledThreadsCount;
+    }
+    pthread_mutex_unlock(&mThreadCountLock);
+
+    // Pre-spawn up to the floor so the first burst does not have to wait
+    // for BR_SPAWN_LOOPER round trips through the driver.
+    for (size_t i = 0; i < threadsToSpawn; i++) {
+        spawnPooledThread(false);
+    }
+    return NO_ERROR;
+}
+
+void ProcessState::onThreadEnteredPool()
+{
+    pthread_mutex_lock(&mThreadCountLock);
+    mPooledThreadsCount++;
+    pthread_mutex_unlock(&mThreadCountLock);
+}
+
+bool ProcessState::shouldRetireThread(int64_t idleTimeUs)
+{
+    bool retire = false;
+    pthread_mutex_lock(&mThreadCountLock);
+    if (mAdaptivePoolEnabled && idleTimeUs >= mPoolPolicy.idleTimeoutMs * 1000 &&
+            mPooledThreadsCount > mPoolPolicy.minThreads) {
+        // Take the thread out of the count now so concurrent callers
+        // cannot retire the pool below minThreads.
+        mPooledThreadsCount--;
+        retire = true;
+    }
+    pthread_mutex_unlock(&mThreadCountLock);
+    return retire;
+}
+
+void ProcessState::onThreadExitedPool()
+{
+    pthread_mutex_lock(&mThreadCountLock);
+    if (mPooledThreadsCount > 0) mPooledThreadsCount--;
+    pthread_mutex_unlock(&mThreadCountLock);
+}
+
+void ProcessState::onThreadBusy(int64_t busyTimeUs)
+{
+    bool spawn = false;
+    pthread_mutex_lock(&mThreadCountLock);
+    if (mAdaptivePoolEnabled) {
+        const int64_t nowUs = systemTime(SYSTEM_TIME_MONOTONIC) / 1000;
+        if (mBusyWindowStartUs == 0) {
+            mBusyWindowStartUs = nowUs;
+        }
+        mBusyTimeInWindowUs += busyTimeUs;
+
+        const int64_t windowUs = nowUs - mBusyWindowStartUs;
+        if (windowUs >= POOL_BUSY_WINDOW_US) {
+            // Utilization of the pool as a whole over the window.  When
+            // it runs hotter than the threshold, grow before the driver
+            // reports starvation.
+            const size_t threads = mPooledThreadsCount ? mPooledThreadsCount : 1;
+            const int64_t busyPct = (mBusyTimeInWindowUs * 100) / (windowUs * threads);
+            if (busyPct >= mPoolPolicy.busyThresholdPct &&
+                    mPooledThreadsCount < mPoolPolicy.maxThreads) {
+                ALOGV("Binder pool %" PRId64 "%% busy over last %" PRId64 "ms, pre-spawning",
+                      busyPct, windowUs / 1000);
+                spawn = true;
+            }
+            mBusyWindowStartUs = nowUs;
+            mBusyTimeInWindowUs = 0;
+        }
+    }
+    pthread_mutex_unlock(&mThreadCountLock);
+
+    if (spawn) spawnPooledThread(false);
+}
+
 void ProcessState::giveThreadPoolName() {
     androidSetThreadName( makeBinderThreadName().string() );
 }
@@ -406,24 +537,34 @@ static int open_driver(const char *driver)
     return fd;
 }
 
-ProcessState::ProcessState(const char *driver)
+ProcessState::ProcessState(const char *driver, size_t mmapSize)
     : mDriverName(String8(driver))
     , mDriverFD(open_driver(driver))
     , mVMStart(MAP_FAILED)
+    , mMmapSize(mmapSize)
     , mThreadCountLock(PTHREAD_MUTEX_INITIALIZER)
     , mThreadCountDecrement(PTHREAD_COND_INITIALIZER)
     , mExecutingThreadsCount(0)
     , mMaxThreads(DEFAULT_MAX_BINDER_THREADS)
     , mStarvationStartTimeMs(0)
+    , mAdaptivePoolEnabled(false)
+    , mPoolPolicy()
+    , mPooledThreadsCount(0)
+    , mBusyWindowStartUs(0)
+    , mBusyTimeInWindowUs(0)
     , mManagesContexts(false)
     , mBinderContextCheckFunc(NULL)
     , mBinderContextUserData(NULL)
     , mThreadPoolStarted(false)
     , mThreadPoolSeq(1)
 {
+    for (size_t i = 0; i < kNumHandleSegments; i++) {
+        mHandleSegments[i].store(NULL, std::memory_order_relaxed);
+    }
+
     if (mDriverFD >= 0) {
         // mmap the binder, providing a chunk of virtual address space to receive transactions.
-        mVMStart = mmap(0, BINDER_VM_SIZE, PROT_READ, MAP_PRIVATE | MAP_NORESERVE, mDriverFD, 0);
+        mVMStart = mmap(0, mMmapSize, PROT_READ, MAP_PRIVATE | MAP_NORESERVE, mDriverFD, 0);
         if (mVMStart == MAP_FAILED) {
             // *sigh*
             ALOGE("Using %s failed: unable to mmap transaction memory.\n", mDriverName.c_str());
@@ -438,9 +579,12 @@ ProcessState::ProcessState(const char *driver)
 
 ProcessState::~ProcessState()
 {
+    for (size_t i = 0; i < kNumHandleSegments; i++) {
+        delete[] mHandleSegments[i].load(std::memory_order_relaxed);
+    }
     if (mDriverFD >= 0) {
         if (mVMStart != MAP_FAILED) {
-            munmap(mVMStart, BINDER_VM_SIZE);
+            munmap(mVMStart, mMmapSize);
         }
         close(mDriverFD);
     }
@@ -20,6 +20,7 @@
 #include <binder/IBinder.h>
 #include <utils/KeyedVector.h>
 #include <utils/Mutex.h>
+#include <utils/String8.h>
 #include <utils/threads.h>
 
 #include <unordered_map>
@@ -74,6 +75,17 @@ public:
     static void         setLimitCallback(binder_proxy_limit_callback cb);
     static void         setBinderProxyCountWatermarks(int high, int low);
 
+    /* Optional latency instrumentation.  When enabled, every proxy call
+     * records its round-trip time into a per-(handle, transaction code)
+     * histogram kept in lock-free per-thread tables, so the overhead on
+     * the transact path is one clock read and one relaxed atomic
+     * increment.  dumpLatencyHistograms() aggregates the tables from all
+     * threads; bucket i counts calls that took [2^(i-1), 2^i) us.
+     */
+    static void         setLatencyTrackingEnabled(bool enable);
+    static void         dumpLatencyHistograms(String8& out);
+    static void         resetLatencyHistograms();
+
     class ObjectManager
     {
     public:
@@ -139,6 +151,7 @@ private:
     static uint32_t                             sBinderProxyCountHighWatermark;
     static uint32_t                             sBinderProxyCountLowWatermark;
     static bool                                 sBinderProxyThrottleCreate;
+    static std::atomic_bool                     sLatencyTrackingEnabled;
 };
 
 }; // namespace android
@@ -64,6 +64,18 @@ public:
                                          uint32_t code, const Parcel& data,
                                          Parcel* reply, uint32_t flags);
 
+            // Batching of oneway transactions.  Between startOnewayBatch()
+            // and endOnewayBatch(), oneway calls made on this thread are
+            // queued in the outgoing command buffer and handed to the
+            // driver in a single ioctl, either when the batch limits are
+            // reached or when the batch ends.  Deferred commands are queued
+            // against a payload copy owned by this thread state, so callers
+            // may destroy or reuse their Parcel as soon as transact()
+            // returns, exactly as with unbatched calls.  Two-way calls
+            // flush any pending batch implicitly, preserving ordering.
+            void                startOnewayBatch();
+            status_t            endOnewayBatch();
+
             void                incStrongHandle(int32_t handle, BpBinder *proxy);
             void                decStrongHandle(int32_t handle);
             void                incWeakHandle(int32_t handle, BpBinder *proxy);
@@ -103,10 +115,12 @@ private:
                                                      uint32_t code,
                                                      const Parcel& data,
                                                      status_t* statusBuffer);
+            status_t            flushOnewayBatch();
             status_t            getAndExecuteCommand();
             status_t            executeCommand(int32_t command);
             void                processPendingDerefs();
             void                processPostWriteDerefs();
+            void                freeBatchedOnewayParcels();
 
             void                clearCaller();
 
@@ -128,6 +142,20 @@ private:
             uid_t               mCallingUid;
             int32_t             mStrictModePolicy;
             int32_t             mLastTransactionBinderFlags;
+            bool                mOnewayBatchingEnabled;
+            // number of BR_TRANSACTION_COMPLETEs owed for batched oneway
+            // transactions that have not been reaped yet
+            size_t              mBatchedOnewayCount;
+            // owned copies of batched oneway payloads; the commands queued
+            // in mOut point into these, so they are freed only once the
+            // driver has consumed the whole write buffer
+            Vector<Parcel*>     mBatchedOnewayParcels;
+            // number of BC_FREE_BUFFER commands queued in mOut since the
+            // last fully consumed driver write
+            size_t              mPendingFreeBuffers;
+            // time spent executing the last driver command, used by the
+            // adaptive thread pool to separate idle from busy time
+            int64_t             mLastCommandBusyUs;
 };
 
 }; // namespace android
@@ -49,7 +49,9 @@ public:
 
     /**
      * Retrieve an existing service, blocking for a few seconds
-     * if it doesn't yet exist.
+     * if it doesn't yet exist. Successfully resolved services are
+     * cached per-process; cache entries are dropped automatically
+     * when the remote binder dies.
      */
     virtual sp<IBinder>         getService( const String16& name) const = 0;
 
@@ -80,6 +82,19 @@ public:
 
 sp<IServiceManager> defaultServiceManager();
 
+/**
+ * Block until every service named in |names| is available, polling all of
+ * the outstanding names in a single pass per retry interval rather than
+ * waiting on them one at a time. Already-cached services are resolved
+ * without any transaction. On success returns NO_ERROR and, if outServices
+ * is non-NULL, fills it with the binders in the same order as |names|;
+ * returns TIMED_OUT if any service is still missing after timeoutMillis
+ * (outServices then holds NULL for the missing entries).
+ */
+status_t waitForServices(const Vector<String16>& names,
+                         Vector<sp<IBinder>>* outServices = NULL,
+                         int64_t timeoutMillis = 5000);
+
 template<typename INTERFACE>
 status_t getService(const String16& name, sp<INTERFACE>* outService)
 {
@@ -27,15 +27,25 @@
 namespace android {
 // ----------------------------------------------------------------------------
 
-class SimpleBestFitAllocator;
+class HeapAllocator;
 
 // ----------------------------------------------------------------------------
 
 class MemoryDealer : public RefBase
 {
 public:
+    // Selects how the dealer's heap is managed.
+    enum AllocatorType {
+        // general-purpose best-fit allocator; O(n) in live allocations
+        BEST_FIT,
+        // O(1) size-class slab allocator, for clients that allocate and
+        // free small chunks of a few fixed sizes at high frequency
+        SIZE_CLASS,
+    };
+
     MemoryDealer(size_t size, const char* name = 0,
-            uint32_t flags = 0 /* or bits such as MemoryHeapBase::READ_ONLY */ );
+            uint32_t flags = 0 /* or bits such as MemoryHeapBase::READ_ONLY */,
+            AllocatorType allocatorType = BEST_FIT);
 
     virtual sp<IMemory> allocate(size_t size);
     virtual void        deallocate(size_t offset);
@@ -51,10 +61,10 @@ protected:
 
 private:
     const sp<IMemoryHeap>&      heap() const;
-    SimpleBestFitAllocator*     allocator() const;
+    HeapAllocator*              allocator() const;
 
     sp<IMemoryHeap>             mHeap;
-    SimpleBestFitAllocator*     mAllocator;
+    HeapAllocator*              mAllocator;
 };
 
 
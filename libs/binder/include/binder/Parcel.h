@@ -233,6 +233,16 @@ public:
 
     status_t            writeObject(const flat_binder_object& val, bool nullMetaData);
 
+    // Records a reference to a caller-owned buffer as a scatter-gather
+    // (BINDER_TYPE_PTR) object instead of copying the payload into the
+    // parcel data.  The kernel copies the buffer directly into the
+    // receiver's transaction buffer when the parcel is sent, so the send
+    // side never flattens it.  The memory must remain valid and unchanged
+    // until the transaction completes; because completion of a oneway
+    // call cannot be observed, buffers written to oneway parcels must
+    // outlive the transaction by other means.
+    status_t            writeNoCopy(const void* data, size_t len);
+
     // Like Parcel.java's writeNoException().  Just writes a zero int32.
     // Currently the native implementation doesn't do any of the StrictMode
     // stack gathering and serialization that the Java implementation does.
@@ -270,6 +280,9 @@ public:
     const char*         readCString() const;
     String8             readString8() const;
     status_t            readString8(String8* pArg) const;
+    // Returns a pointer to the string data in the parcel, avoiding the
+    // String8 copy; valid only for the lifetime of the Parcel.
+    const char*         readString8Inplace(size_t* outLen) const;
     String16            readString16() const;
     status_t            readString16(String16* pArg) const;
     status_t            readString16(std::unique_ptr<String16>* pArg) const;
@@ -375,6 +388,11 @@ public:
     // The caller should call release() on the blob after reading its contents.
     status_t            readBlob(size_t len, ReadableBlob* outBlob) const;
 
+    // Counterpart of writeNoCopy(): returns a pointer to the scatter-gather
+    // payload, which the kernel has placed in the received transaction
+    // buffer.  The pointer is only valid for the lifetime of this Parcel.
+    status_t            readNoCopy(const void** outData, size_t* outLen) const;
+
     const flat_binder_object* readObject(bool nullMetaData) const;
 
     // Explicitly close all file descriptors in the parcel.
@@ -384,6 +402,12 @@ public:
     static size_t       getGlobalAllocSize();
     static size_t       getGlobalAllocCount();
 
+    // Opt-in recycling of small parcel buffers through a per-thread pool,
+    // for services handling very high transaction rates.  Should be set
+    // once during process initialization.
+    static void         setBufferPoolEnabled(bool enabled);
+    static bool         bufferPoolEnabled();
+
 private:
     typedef void        (*release_func)(Parcel* parcel,
                                         const uint8_t* data, size_t dataSize,
@@ -394,6 +418,7 @@ private:
     size_t              ipcDataSize() const;
     uintptr_t           ipcObjects() const;
     size_t              ipcObjectsCount() const;
+    size_t              ipcBuffersSize() const;
     void                ipcSetDataReference(const uint8_t* data, size_t dataSize,
                                             const binder_size_t* objects, size_t objectsCount,
                                             release_func relFunc, void* relCookie);
@@ -466,8 +491,16 @@ private:
     mutable size_t      mNextObjectHint;
     mutable bool        mObjectsSorted;
 
+    // Total padded size of all scatter-gather buffers recorded with
+    // writeNoCopy(); non-zero parcels are sent with BC_TRANSACTION_SG.
+    size_t              mBuffersSize;
+
     mutable bool        mFdsKnown;
     mutable bool        mHasFds;
+    // Number of BINDER_TYPE_FD entries in mObjects, maintained as objects are
+    // written and dropped so trimming the object table does not force a
+    // rescan.  Only meaningful while mFdsKnown is true.
+    mutable size_t      mFdCount;
     bool                mAllowFds;
 
     release_func        mOwner;
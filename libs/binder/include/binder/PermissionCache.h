@@ -22,6 +22,9 @@
 #include <stdint.h>
 #include <unistd.h>
 
+#include <atomic>
+#include <memory>
+
 #include <utils/String16.h>
 #include <utils/Singleton.h>
 #include <utils/SortedVector.h>
@@ -49,12 +52,20 @@ class PermissionCache : Singleton<PermissionCache> {
             return (uid == e.uid) ? (name < e.name) : (uid < e.uid);
         }
     };
+    // An immutable snapshot of the cache contents.  Readers atomically
+    // load the current snapshot and search it without taking any lock;
+    // writers build a replacement under mLock and publish it atomically.
+    struct State {
+        SortedVector< Entry > entries;
+    };
+
+    // serializes writers only; the check() fast path never takes it
     mutable Mutex mLock;
     // we pool all the permission names we see, as many permissions checks
     // will have identical names
     SortedVector< String16 > mPermissionNamesPool;
     // this is our cache per say. it stores pooled names.
-    SortedVector< Entry > mCache;
+    mutable std::shared_ptr<const State> mState;
 
     // free the whole cache, but keep the permission name pool
     void purge();
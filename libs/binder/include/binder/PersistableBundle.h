@@ -18,6 +18,7 @@
 #define ANDROID_PERSISTABLE_BUNDLE_H
 
 #include <map>
+#include <memory>
 #include <set>
 #include <vector>
 
@@ -42,6 +43,17 @@ public:
     status_t writeToParcel(Parcel* parcel) const override;
     status_t readFromParcel(const Parcel* parcel) override;
 
+    /*
+     * Opt-in to a flat, offset-indexed wire format.  Bundles received in
+     * this format keep their payload as a single flat buffer and index it
+     * lazily: point lookups decode only the requested value, and the
+     * member maps are only materialized when the bundle is enumerated or
+     * mutated.  Both ends must be native processes running a build that
+     * understands the format; the Java-compatible stream format remains
+     * the default and is always accepted on read.
+     */
+    static void setFlatFormatEnabled(bool enabled);
+
     bool empty() const;
     size_t size() const;
     size_t erase(const String16& key);
@@ -94,6 +106,8 @@ public:
     std::set<String16> getPersistableBundleKeys() const;
 
     friend bool operator==(const PersistableBundle& lhs, const PersistableBundle& rhs) {
+        lhs.unflatten();
+        rhs.unflatten();
         return (lhs.mBoolMap == rhs.mBoolMap && lhs.mIntMap == rhs.mIntMap &&
                 lhs.mLongMap == rhs.mLongMap && lhs.mDoubleMap == rhs.mDoubleMap &&
                 lhs.mStringMap == rhs.mStringMap && lhs.mBoolVectorMap == rhs.mBoolVectorMap &&
@@ -109,8 +123,28 @@ public:
     }
 
 private:
+    struct FlatEntry {
+        int32_t keyPos;    // offset of the key string within mFlatChunk
+        int32_t type;      // VAL_* type of the value
+        int32_t valuePos;  // offset of the value within mFlatChunk
+    };
+
     status_t writeToParcelInner(Parcel* parcel) const;
+    status_t writeToParcelFlat(Parcel* parcel) const;
     status_t readFromParcelInner(const Parcel* parcel, size_t length);
+    status_t readFromParcelFlat(const Parcel* parcel, size_t length);
+    const FlatEntry* findFlatEntry(const String16& key) const;
+    // Materializes the member maps from the flat buffer (if any) and
+    // drops it.  Logically const: the observable contents do not change.
+    void unflatten() const;
+
+    /*
+     * Payload and key-sorted index of a bundle received in the flat
+     * format that has not been materialized yet.  Immutable once set;
+     * shared between copies of the bundle.
+     */
+    std::shared_ptr<const std::vector<uint8_t>> mFlatChunk;
+    std::shared_ptr<const std::vector<FlatEntry>> mFlatIndex;
 
     std::map<String16, bool> mBoolMap;
     std::map<String16, int32_t> mIntMap;
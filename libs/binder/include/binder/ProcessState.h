@@ -24,6 +24,7 @@
 
 #include <utils/threads.h>
 
+#include <atomic>
 #include <pthread.h>
 
 // ---------------------------------------------------------------------------
@@ -41,6 +42,14 @@ public:
      * any call to ProcessState::self(). /dev/binder remains the default.
      */
     static  sp<ProcessState>    initWithDriver(const char *driver);
+    /* initWithMmapSize() can be used to configure the size of the
+     * transaction buffer this process maps from the binder driver, for
+     * services whose concurrent transaction volume exhausts the default
+     * window.  Like initWithDriver(), it must be called *before* any call
+     * to ProcessState::self().  The kernel rounds the size up to a page
+     * multiple and caps it at the driver's own limit.  Uses /dev/binder.
+     */
+    static  sp<ProcessState>    initWithMmapSize(size_t mmapSize);
 
             void                setContextObject(const sp<IBinder>& object);
             sp<IBinder>         getContextObject(const sp<IBinder>& caller);
@@ -66,8 +75,26 @@ public:
             void                expungeHandle(int32_t handle, IBinder* binder);
 
             void                spawnPooledThread(bool isMain);
-            
+
             status_t            setThreadPoolMaxThreadCount(size_t maxThreads);
+
+    /* Adaptive thread pool policy.  By default the pool only grows when
+     * the driver asks for another looper (BR_SPAWN_LOOPER) and threads
+     * never retire, which makes bursty services oscillate between
+     * starvation and oversubscription.  Installing a policy makes the
+     * pool track how busy its threads are, spawn ahead of demand when
+     * the pool runs hotter than busyThresholdPct over the sampling
+     * window, and retire non-main threads that stay idle longer than
+     * idleTimeoutMs, while keeping at least minThreads alive.
+     */
+    struct ThreadPoolPolicy {
+        size_t minThreads;          // threads kept alive even when idle
+        size_t maxThreads;          // hard cap, also handed to the driver
+        int64_t idleTimeoutMs;      // idle time before a thread may retire
+        uint32_t busyThresholdPct;  // pool utilization that triggers a pre-spawn
+    };
+            status_t            setThreadPoolPolicy(const ThreadPoolPolicy& policy);
+
             void                giveThreadPoolName();
 
             String8             getDriverName();
@@ -77,7 +104,7 @@ public:
 private:
     friend class IPCThreadState;
     
-                                ProcessState(const char* driver);
+                                ProcessState(const char* driver, size_t mmapSize);
                                 ~ProcessState();
 
                                 ProcessState(const ProcessState& o);
@@ -89,11 +116,38 @@ private:
                 RefBase::weakref_type* refs;
             };
 
-            handle_entry*       lookupHandleLocked(int32_t handle);
+            // The proxy handle table is a lock-free segmented array: a fixed
+            // spine of lazily allocated segments of doubling size, so entries
+            // never move once created and locating one takes no lock. Segment
+            // i holds (kHandleSegmentSize << i) entries and covers handles
+            // [kHandleSegmentSize*((1<<i)-1), kHandleSegmentSize*((2<<i)-1)).
+            // Entry state transitions (proxy creation and expunging) are
+            // serialized per handle by a striped lock, so resolving distinct
+            // handles on different binder threads never contends.
+            static const size_t kHandleSegmentSize = 256;
+            static const size_t kNumHandleSegments = 24;
+            static const size_t kHandleLockCount = 16;
+
+            // Returns the entry for the given handle, allocating its segment
+            // if needed. Lock-free; returns NULL for invalid handles or on
+            // allocation failure. The entry's fields may only be accessed
+            // with the handle's striped lock held.
+            handle_entry*       lookupHandle(int32_t handle);
+            Mutex&              handleLock(int32_t handle) const;
+
+            // Adaptive pool bookkeeping, driven by IPCThreadState.
+            void                onThreadEnteredPool();
+            // Returns true if the calling thread should leave the pool
+            // instead of calling onThreadExitedPool() later.
+            bool                shouldRetireThread(int64_t idleTimeUs);
+            void                onThreadExitedPool();
+            void                onThreadBusy(int64_t busyTimeUs);
 
             String8             mDriverName;
             int                 mDriverFD;
             void*               mVMStart;
+            // Size of the transaction buffer mapped at mVMStart.
+            const size_t        mMmapSize;
 
             // Protects thread count variable below.
             pthread_mutex_t     mThreadCountLock;
@@ -104,11 +158,21 @@ private:
             size_t              mMaxThreads;
             // Time when thread pool was emptied
             int64_t             mStarvationStartTimeMs;
+            // Adaptive pool state, also protected by mThreadCountLock.
+            bool                mAdaptivePoolEnabled;
+            ThreadPoolPolicy    mPoolPolicy;
+            // Number of threads currently sitting in joinThreadPool().
+            size_t              mPooledThreadsCount;
+            // Aggregate command execution time over the current sampling
+            // window, used to decide when to spawn ahead of demand.
+            int64_t             mBusyWindowStartUs;
+            int64_t             mBusyTimeInWindowUs;
+
+            std::atomic<handle_entry*> mHandleSegments[kNumHandleSegments];
+    mutable Mutex               mHandleLocks[kHandleLockCount];
 
     mutable Mutex               mLock;  // protects everything below.
 
-            Vector<handle_entry>mHandleToObject;
-
             bool                mManagesContexts;
             context_check_func  mBinderContextCheckFunc;
             void*               mBinderContextUserData;
@@ -152,6 +152,44 @@ public:
         return callParcel("writeParcelableVector",
                           [&]() { return parcel->writeParcelableVector(v); });
     }
+    // Parcel has no dedicated methods for vectors of Flattenables, so write a length-prefixed
+    // sequence of individually-flattened elements
+    template <typename T>
+    typename std::enable_if<std::is_base_of<Flattenable<T>, T>::value, status_t>::type read(
+            const Parcel& parcel, std::vector<T>* v) const {
+        uint32_t size = 0;
+        status_t error = callParcel("readUint32", [&]() { return parcel.readUint32(&size); });
+        if (CC_UNLIKELY(error != NO_ERROR)) {
+            return error;
+        }
+        v->clear();
+        v->reserve(size);
+        for (uint32_t i = 0; i < size; ++i) {
+            v->emplace_back();
+            error = callParcel("read(Flattenable)", [&]() { return parcel.read(v->back()); });
+            if (CC_UNLIKELY(error != NO_ERROR)) {
+                return error;
+            }
+        }
+        return NO_ERROR;
+    }
+    template <typename T>
+    typename std::enable_if<std::is_base_of<Flattenable<T>, T>::value, status_t>::type write(
+            Parcel* parcel, const std::vector<T>& v) const {
+        status_t error = callParcel("writeUint32", [&]() {
+            return parcel->writeUint32(static_cast<uint32_t>(v.size()));
+        });
+        if (CC_UNLIKELY(error != NO_ERROR)) {
+            return error;
+        }
+        for (const T& t : v) {
+            error = callParcel("write(Flattenable)", [&]() { return parcel->write(t); });
+            if (CC_UNLIKELY(error != NO_ERROR)) {
+                return error;
+            }
+        }
+        return NO_ERROR;
+    }
 
     // Templates to handle integral types. We use a struct template to require that the called
     // function exactly matches the signedness and size of the argument (e.g., the argument isn't
@@ -0,0 +1,209 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <binder/Binder.h>
+#include <binder/IPCThreadState.h>
+#include <binder/IServiceManager.h>
+#include <binder/Parcel.h>
+#include <binder/PersistableBundle.h>
+#include <binder/ProcessState.h>
+#include <utils/String16.h>
+
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace android;
+using ::benchmark::State;
+
+/*
+ * Measures Parcel pack/unpack costs per payload type and round-trip /
+ * oneway transaction costs through BpBinder::transact, so regressions in
+ * Parcel.cpp and IPCThreadState.cpp show up before they hit production.
+ *
+ * The IPC benchmarks talk to a forked echo service registered with the
+ * service manager; run them with different --benchmark_filter / thread
+ * counts to exercise the thread pool.
+ */
+
+static const String16 kServiceName = String16("binderBenchmark.echo");
+
+enum EchoServiceCode {
+    ECHO_TRANSACTION = IBinder::FIRST_CALL_TRANSACTION,
+};
+
+class EchoService : public BBinder {
+public:
+    virtual status_t onTransact(uint32_t code, const Parcel& data,
+                                Parcel* reply, uint32_t flags = 0) {
+        (void) flags;
+        if (code != ECHO_TRANSACTION) {
+            return UNKNOWN_TRANSACTION;
+        }
+        if (reply != NULL) {
+            reply->appendFrom(&data, 0, data.dataSize());
+        }
+        return NO_ERROR;
+    }
+};
+
+// ---------------------------------------------------------------------------
+// Parcel packing/unpacking
+
+static void BM_ParcelWriteInt32(State& state) {
+    Parcel p;
+    while (state.KeepRunning()) {
+        p.setDataPosition(0);
+        p.setDataSize(0);
+        p.writeInt32(42);
+    }
+}
+BENCHMARK(BM_ParcelWriteInt32);
+
+static void BM_ParcelWriteString16(State& state) {
+    Parcel p;
+    const String16 str("com.example.benchmark.InterfaceName");
+    while (state.KeepRunning()) {
+        p.setDataPosition(0);
+        p.setDataSize(0);
+        p.writeString16(str);
+    }
+}
+BENCHMARK(BM_ParcelWriteString16);
+
+static void BM_ParcelReadString16(State& state) {
+    Parcel p;
+    p.writeString16(String16("com.example.benchmark.InterfaceName"));
+    while (state.KeepRunning()) {
+        p.setDataPosition(0);
+        String16 str = p.readString16();
+        benchmark::DoNotOptimize(str);
+    }
+}
+BENCHMARK(BM_ParcelReadString16);
+
+static void BM_ParcelWriteStrongBinder(State& state) {
+    Parcel p;
+    sp<IBinder> binder = new BBinder();
+    while (state.KeepRunning()) {
+        p.setDataPosition(0);
+        p.setDataSize(0);
+        p.writeStrongBinder(binder);
+    }
+}
+BENCHMARK(BM_ParcelWriteStrongBinder);
+
+static void BM_ParcelWriteParcelable(State& state) {
+    Parcel p;
+    os::PersistableBundle bundle;
+    bundle.putInt(String16("answer"), 42);
+    bundle.putString(String16("name"), String16("benchmark"));
+    while (state.KeepRunning()) {
+        p.setDataPosition(0);
+        p.setDataSize(0);
+        p.writeParcelable(bundle);
+    }
+}
+BENCHMARK(BM_ParcelWriteParcelable);
+
+static void BM_ParcelWriteByteVector(State& state) {
+    Parcel p;
+    std::vector<uint8_t> bytes(state.range(0));
+    while (state.KeepRunning()) {
+        p.setDataPosition(0);
+        p.setDataSize(0);
+        p.writeByteVector(bytes);
+    }
+    state.SetBytesProcessed(int64_t(state.iterations()) * state.range(0));
+}
+BENCHMARK(BM_ParcelWriteByteVector)->Range(16, 1 << 17);
+
+// ---------------------------------------------------------------------------
+// Transaction round trips
+
+static sp<IBinder> getEchoService() {
+    // Registered once by main() before the benchmarks run.
+    return defaultServiceManager()->checkService(kServiceName);
+}
+
+static void BM_TransactRoundTrip(State& state) {
+    sp<IBinder> service = getEchoService();
+    const size_t payloadSize = state.range(0);
+    std::vector<uint8_t> bytes(payloadSize);
+    while (state.KeepRunning()) {
+        Parcel data, reply;
+        data.writeByteVector(bytes);
+        status_t err = service->transact(ECHO_TRANSACTION, data, &reply);
+        if (err != NO_ERROR) {
+            state.SkipWithError("transact failed");
+            break;
+        }
+    }
+    state.SetBytesProcessed(int64_t(state.iterations()) * payloadSize);
+}
+// ThreadRange exercises concurrent clients against the service's pool.
+BENCHMARK(BM_TransactRoundTrip)->Arg(64)->Arg(4096)->ThreadRange(1, 8);
+
+static void BM_TransactOneway(State& state) {
+    sp<IBinder> service = getEchoService();
+    std::vector<uint8_t> bytes(state.range(0));
+    while (state.KeepRunning()) {
+        Parcel data;
+        data.writeByteVector(bytes);
+        status_t err = service->transact(ECHO_TRANSACTION, data, NULL,
+                                         IBinder::FLAG_ONEWAY);
+        if (err != NO_ERROR) {
+            state.SkipWithError("oneway transact failed");
+            break;
+        }
+    }
+    // Make sure queued commands reach the driver before the timer stops.
+    IPCThreadState::self()->flushCommands();
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TransactOneway)->Arg(64)->Arg(4096)->ThreadRange(1, 8);
+
+// ---------------------------------------------------------------------------
+
+int main(int argc, char** argv) {
+    ::benchmark::Initialize(&argc, argv);
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        // Child: host the echo service.
+        ProcessState::self()->setThreadPoolMaxThreadCount(8);
+        defaultServiceManager()->addService(kServiceName, new EchoService());
+        ProcessState::self()->startThreadPool();
+        IPCThreadState::self()->joinThreadPool();
+        return 0;
+    }
+
+    // Give the child a moment to register.
+    sp<IBinder> service;
+    for (int i = 0; i < 50 && service == NULL; i++) {
+        service = defaultServiceManager()->checkService(kServiceName);
+        if (service == NULL) usleep(10000);
+    }
+
+    ProcessState::self()->startThreadPool();
+    ::benchmark::RunSpecifiedBenchmarks();
+
+    kill(pid, SIGTERM);
+    waitpid(pid, NULL, 0);
+    return 0;
+}
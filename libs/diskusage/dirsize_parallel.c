@@ -0,0 +1,271 @@
+/*
+ *
+ * Copyright (C) 2018, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <diskusage/dirsize.h>
+
+/* Upper bound on worker threads; sizing is I/O bound, so more threads than
+ * this just contend on the queue lock. */
+#define MAX_WALK_THREADS 8
+
+/* A directory waiting to be scanned. The fd is owned by the queue entry
+ * until a worker pops it. */
+struct dir_work {
+    int fd;
+    struct dir_work *next;
+};
+
+/* Open-addressing set of (dev, ino) pairs for directories already queued,
+ * so bind mounts or other aliasing cannot make the walk revisit a subtree
+ * or loop forever. */
+struct visited_set {
+    struct visited_entry {
+        dev_t dev;
+        ino_t ino;
+        int used;
+    } *entries;
+    size_t count;
+    size_t capacity; /* always a power of two */
+};
+
+struct walk_state {
+    pthread_mutex_t lock;
+    pthread_cond_t work_available;
+
+    struct dir_work *work_head; /* LIFO, so workers stay in hot dentry cache */
+    size_t pending;             /* directories queued or being scanned */
+
+    struct visited_set visited;
+    int64_t size;
+};
+
+static size_t visited_slot(const struct visited_set *set, dev_t dev, ino_t ino)
+{
+    /* Splittable 64-bit mix of the pair; inode numbers are often sequential
+     * so a plain mask would cluster badly. */
+    uint64_t h = (uint64_t)ino * UINT64_C(0x9e3779b97f4a7c15);
+    h ^= (uint64_t)dev * UINT64_C(0xc2b2ae3d27d4eb4f);
+    h ^= h >> 29;
+    return (size_t)(h & (set->capacity - 1));
+}
+
+static int visited_grow(struct visited_set *set)
+{
+    struct visited_entry *old_entries = set->entries;
+    size_t old_capacity = set->capacity;
+    size_t i;
+
+    set->capacity = old_capacity ? old_capacity * 2 : 64;
+    set->entries = calloc(set->capacity, sizeof(struct visited_entry));
+    if (set->entries == NULL) {
+        set->entries = old_entries;
+        set->capacity = old_capacity;
+        return -1;
+    }
+
+    for (i = 0; i < old_capacity; i++) {
+        if (old_entries[i].used) {
+            size_t slot = visited_slot(set, old_entries[i].dev, old_entries[i].ino);
+            while (set->entries[slot].used)
+                slot = (slot + 1) & (set->capacity - 1);
+            set->entries[slot] = old_entries[i];
+        }
+    }
+    free(old_entries);
+    return 0;
+}
+
+/* Returns 1 if (dev, ino) was already present, 0 if it was inserted.
+ * On allocation failure the entry is treated as new, which at worst
+ * double-counts; the walk still terminates because the fd table bounds
+ * the number of simultaneously open directories. */
+static int visited_test_and_set(struct visited_set *set, dev_t dev, ino_t ino)
+{
+    size_t slot;
+
+    if (set->count * 4 >= set->capacity * 3) {
+        if (visited_grow(set) != 0 && set->capacity == 0)
+            return 0;
+    }
+
+    slot = visited_slot(set, dev, ino);
+    while (set->entries[slot].used) {
+        if (set->entries[slot].dev == dev && set->entries[slot].ino == ino)
+            return 1;
+        slot = (slot + 1) & (set->capacity - 1);
+    }
+    set->entries[slot].dev = dev;
+    set->entries[slot].ino = ino;
+    set->entries[slot].used = 1;
+    set->count++;
+    return 0;
+}
+
+/* Queues dfd for scanning unless its dev/ino pair was seen before, in which
+ * case the fd is closed. Called with the state lock held. */
+static void enqueue_dir_locked(struct walk_state *state, int dfd)
+{
+    struct stat s;
+    struct dir_work *work;
+
+    if (fstat(dfd, &s) == 0 &&
+            visited_test_and_set(&state->visited, s.st_dev, s.st_ino)) {
+        close(dfd);
+        return;
+    }
+
+    work = malloc(sizeof(struct dir_work));
+    if (work == NULL) {
+        /* Fall back to sizing the subtree inline; slower but never wrong. */
+        pthread_mutex_unlock(&state->lock);
+        int64_t size = calculate_dir_size(dfd);
+        pthread_mutex_lock(&state->lock);
+        state->size += size;
+        return;
+    }
+
+    work->fd = dfd;
+    work->next = state->work_head;
+    state->work_head = work;
+    state->pending++;
+    pthread_cond_signal(&state->work_available);
+}
+
+/* Scans a single directory: accounts every entry, and queues subdirectories
+ * for any worker to pick up. Consumes dfd. */
+static void scan_dir(struct walk_state *state, int dfd)
+{
+    int64_t size = 0;
+    struct stat s;
+    DIR *d;
+    struct dirent *de;
+
+    d = fdopendir(dfd);
+    if (d == NULL) {
+        close(dfd);
+        return;
+    }
+
+    while ((de = readdir(d))) {
+        const char *name = de->d_name;
+        if (de->d_type == DT_DIR) {
+            int subfd;
+
+            /* always skip "." and ".." */
+            if (name[0] == '.') {
+                if (name[1] == 0)
+                    continue;
+                if ((name[1] == '.') && (name[2] == 0))
+                    continue;
+            }
+
+            if (fstatat(dfd, name, &s, AT_SYMLINK_NOFOLLOW) == 0) {
+                size += stat_size(&s);
+            }
+            subfd = openat(dfd, name, O_RDONLY | O_DIRECTORY);
+            if (subfd >= 0) {
+                pthread_mutex_lock(&state->lock);
+                enqueue_dir_locked(state, subfd);
+                pthread_mutex_unlock(&state->lock);
+            }
+        } else {
+            if (fstatat(dfd, name, &s, AT_SYMLINK_NOFOLLOW) == 0) {
+                size += stat_size(&s);
+            }
+        }
+    }
+    closedir(d);
+
+    pthread_mutex_lock(&state->lock);
+    state->size += size;
+    pthread_mutex_unlock(&state->lock);
+}
+
+static void *walk_worker(void *arg)
+{
+    struct walk_state *state = arg;
+
+    pthread_mutex_lock(&state->lock);
+    while (state->pending > 0) {
+        struct dir_work *work = state->work_head;
+        if (work == NULL) {
+            /* Another worker is still scanning and may queue more. */
+            pthread_cond_wait(&state->work_available, &state->lock);
+            continue;
+        }
+        state->work_head = work->next;
+        pthread_mutex_unlock(&state->lock);
+
+        scan_dir(state, work->fd);
+        free(work);
+
+        pthread_mutex_lock(&state->lock);
+        /* This directory is done; if it was the last one, wake everybody so
+         * they can observe pending == 0 and exit. */
+        if (--state->pending == 0)
+            pthread_cond_broadcast(&state->work_available);
+    }
+    pthread_mutex_unlock(&state->lock);
+    return NULL;
+}
+
+int64_t calculate_dir_size_parallel(int dfd)
+{
+    struct walk_state state;
+    pthread_t threads[MAX_WALK_THREADS];
+    long ncpus;
+    size_t nthreads, started, i;
+    int64_t size;
+
+    ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (ncpus <= 1)
+        return calculate_dir_size(dfd);
+    nthreads = (ncpus < MAX_WALK_THREADS) ? (size_t)ncpus : MAX_WALK_THREADS;
+
+    memset(&state, 0, sizeof(state));
+    pthread_mutex_init(&state.lock, NULL);
+    pthread_cond_init(&state.work_available, NULL);
+
+    pthread_mutex_lock(&state.lock);
+    enqueue_dir_locked(&state, dfd);
+    pthread_mutex_unlock(&state.lock);
+
+    for (started = 0; started < nthreads; started++) {
+        if (pthread_create(&threads[started], NULL, walk_worker, &state) != 0)
+            break;
+    }
+    if (started == 0) {
+        /* No workers; drain the queue on the calling thread. */
+        walk_worker(&state);
+    }
+    for (i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    size = state.size;
+    free(state.visited.entries);
+    pthread_cond_destroy(&state.work_available);
+    pthread_mutex_destroy(&state.lock);
+    return size;
+}
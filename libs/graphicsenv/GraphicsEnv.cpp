@@ -19,6 +19,7 @@
 #include <graphicsenv/GraphicsEnv.h>
 
 #include <mutex>
+#include <thread>
 
 #include <android/dlext.h>
 #include <log/log.h>
@@ -54,6 +55,12 @@ void GraphicsEnv::setDriverPath(const std::string path) {
     }
     ALOGV("setting driver path to '%s'", path.c_str());
     mDriverPath = path;
+    // Build the driver namespace now, off the critical path, instead of on
+    // first EGL/Vulkan use. setDriverPath() runs around process start, so the
+    // linker work overlaps the rest of app startup; if the first GL call
+    // races us, createDriverNamespace() makes it wait rather than redo the
+    // work.
+    std::thread([this]() { createDriverNamespace(); }).detach();
 }
 
 void GraphicsEnv::setLayerPaths(android_namespace_t* appNamespace, const std::string layerPaths) {
@@ -82,9 +89,23 @@ void GraphicsEnv::setDebugLayers(const std::string layers) {
     mDebugLayers = layers;
 }
 
-android_namespace_t* GraphicsEnv::getDriverNamespace() {
-    static std::once_flag once;
-    std::call_once(once, [this]() {
+void GraphicsEnv::setLayerDiscoveryCachePath(const std::string path) {
+    if (mLayerDiscoveryCachePath.empty()) {
+        mLayerDiscoveryCachePath = path;
+    } else {
+        ALOGV("layer discovery cache path already set, not clobbering with '%s'",
+                path.c_str());
+    }
+}
+
+const std::string GraphicsEnv::getLayerDiscoveryCachePath() {
+    return mLayerDiscoveryCachePath;
+}
+
+void GraphicsEnv::createDriverNamespace() {
+    // Shared by the pre-warm thread and getDriverNamespace(); whichever runs
+    // second waits for the first, and both observe the published namespace.
+    std::call_once(mDriverNamespaceOnce, [this]() {
         if (mDriverPath.empty())
             return;
         // If the sphal namespace isn't configured for a device, don't support updatable drivers.
@@ -99,6 +120,10 @@ android_namespace_t* GraphicsEnv::getDriverNamespace() {
                                                     nullptr, // permitted_when_isolated_path
                                                     sphalNamespace);
     });
+}
+
+android_namespace_t* GraphicsEnv::getDriverNamespace() {
+    createDriverNamespace();
     return mDriverNamespace;
 }
 
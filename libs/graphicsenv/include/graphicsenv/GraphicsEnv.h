@@ -17,6 +17,7 @@
 #ifndef ANDROID_UI_GRAPHICS_ENV_H
 #define ANDROID_UI_GRAPHICS_ENV_H 1
 
+#include <mutex>
 #include <string>
 
 struct android_namespace_t;
@@ -32,6 +33,9 @@ public:
     // (drivers must be stored uncompressed and page aligned); such elements
     // in the search path must have a '!' after the zip filename, e.g.
     //     /data/app/com.example.driver/base.apk!/lib/arm64-v8a
+    // Setting the path also kicks off construction of the driver linker
+    // namespace on a background thread, so getDriverNamespace() usually
+    // finds it ready.
     void setDriverPath(const std::string path);
     android_namespace_t* getDriverNamespace();
 
@@ -42,11 +46,21 @@ public:
     void setDebugLayers(const std::string layers);
     const std::string getDebugLayers();
 
+    // Set the file used to persist Vulkan layer discovery results between
+    // application launches, so unchanged layer libraries don't have to be
+    // re-probed with dlopen. An empty path (the default) disables caching.
+    void setLayerDiscoveryCachePath(const std::string path);
+    const std::string getLayerDiscoveryCachePath();
+
 private:
     GraphicsEnv() = default;
+    // Builds mDriverNamespace exactly once; safe to call from any thread.
+    void createDriverNamespace();
+    std::once_flag mDriverNamespaceOnce;
     std::string mDriverPath;
     std::string mDebugLayers;
     std::string mLayerPaths;
+    std::string mLayerDiscoveryCachePath;
     android_namespace_t* mDriverNamespace = nullptr;
     android_namespace_t* mAppNamespace = nullptr;
 };
@@ -17,6 +17,7 @@
 #include <private/gui/BitTube.h>
 
 #include <stdint.h>
+#include <string.h>
 #include <sys/socket.h>
 #include <sys/types.h>
 
@@ -86,6 +87,18 @@ void BitTube::setReceiveFd(base::unique_fd&& receiveFd) {
     mReceiveFd = std::move(receiveFd);
 }
 
+status_t BitTube::setReceiveBufferSize(size_t size) {
+    if (mReceiveFd < 0) {
+        return NO_INIT;
+    }
+    if (setsockopt(mReceiveFd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size)) < 0) {
+        int error = errno;
+        ALOGE("BitTube: can't set receive buffer size to %zu (%s)", size, strerror(error));
+        return -error;
+    }
+    return NO_ERROR;
+}
+
 ssize_t BitTube::write(void const* vaddr, size_t size) {
     ssize_t err, len;
     do {
@@ -143,6 +156,52 @@ ssize_t BitTube::sendObjects(BitTube* tube, void const* events, size_t count, si
     return size < 0 ? size : size / static_cast<ssize_t>(objSize);
 }
 
+// Maximum number of messages moved by a single sendmmsg/recvmmsg syscall; larger batches loop.
+static const size_t MAX_BATCH_MESSAGES = 64;
+
+ssize_t BitTube::sendObjectsBatch(BitTube* tube, void const* events, size_t count,
+                                  size_t objSize) {
+    const char* vaddr = reinterpret_cast<const char*>(events);
+    size_t objects = 0;
+    while (objects < count) {
+        struct iovec iov[MAX_BATCH_MESSAGES];
+        struct mmsghdr msgs[MAX_BATCH_MESSAGES];
+        const size_t batch = (count - objects) < MAX_BATCH_MESSAGES ? (count - objects)
+                                                                    : MAX_BATCH_MESSAGES;
+        memset(msgs, 0, batch * sizeof(msgs[0]));
+        for (size_t i = 0; i < batch; i++) {
+            iov[i].iov_base = const_cast<char*>(vaddr + (objects + i) * objSize);
+            iov[i].iov_len = objSize;
+            msgs[i].msg_hdr.msg_iov = &iov[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+
+        int sent;
+        do {
+            sent = ::sendmmsg(tube->mSendFd, msgs, static_cast<unsigned int>(batch),
+                              MSG_DONTWAIT | MSG_NOSIGNAL);
+        } while (sent < 0 && errno == EINTR);
+        if (sent < 0) {
+            // If the send buffer filled up mid-batch, report what was sent.
+            return objects > 0 ? static_cast<ssize_t>(objects) : -errno;
+        }
+
+        // should never happen because of SOCK_SEQPACKET
+        for (int i = 0; i < sent; i++) {
+            LOG_ALWAYS_FATAL_IF(msgs[i].msg_len != objSize,
+                                "BitTube::sendObjectsBatch(count=%zu, size=%zu), len=%u (partial "
+                                "events were sent!)",
+                                count, objSize, msgs[i].msg_len);
+        }
+
+        objects += static_cast<size_t>(sent);
+        if (static_cast<size_t>(sent) < batch) {
+            break;
+        }
+    }
+    return static_cast<ssize_t>(objects);
+}
+
 ssize_t BitTube::recvObjects(BitTube* tube, void* events, size_t count, size_t objSize) {
     char* vaddr = reinterpret_cast<char*>(events);
     ssize_t size = tube->read(vaddr, count * objSize);
@@ -157,5 +216,51 @@ ssize_t BitTube::recvObjects(BitTube* tube, void* events, size_t count, size_t o
     return size < 0 ? size : size / static_cast<ssize_t>(objSize);
 }
 
+ssize_t BitTube::recvObjectsBatch(BitTube* tube, void* events, size_t count, size_t objSize) {
+    char* vaddr = reinterpret_cast<char*>(events);
+    size_t objects = 0;
+    while (objects < count) {
+        struct iovec iov[MAX_BATCH_MESSAGES];
+        struct mmsghdr msgs[MAX_BATCH_MESSAGES];
+        const size_t batch = (count - objects) < MAX_BATCH_MESSAGES ? (count - objects)
+                                                                    : MAX_BATCH_MESSAGES;
+        memset(msgs, 0, batch * sizeof(msgs[0]));
+        for (size_t i = 0; i < batch; i++) {
+            iov[i].iov_base = vaddr + (objects + i) * objSize;
+            iov[i].iov_len = objSize;
+            msgs[i].msg_hdr.msg_iov = &iov[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+
+        int received;
+        do {
+            received = ::recvmmsg(tube->mReceiveFd, msgs, static_cast<unsigned int>(batch),
+                                  MSG_DONTWAIT, nullptr);
+        } while (received < 0 && errno == EINTR);
+        if (received < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                // No more queued messages; not an error (see BitTube::read).
+                break;
+            }
+            return objects > 0 ? static_cast<ssize_t>(objects) : -errno;
+        }
+
+        // A shorter or longer message means the sender didn't send exactly one object per
+        // message, which this batched path requires (see the header).
+        for (int i = 0; i < received; i++) {
+            LOG_ALWAYS_FATAL_IF(msgs[i].msg_len != objSize,
+                                "BitTube::recvObjectsBatch(count=%zu, size=%zu), len=%u (partial "
+                                "or packed events were received!)",
+                                count, objSize, msgs[i].msg_len);
+        }
+
+        objects += static_cast<size_t>(received);
+        if (static_cast<size_t>(received) < batch) {
+            break;
+        }
+    }
+    return static_cast<ssize_t>(objects);
+}
+
 } // namespace gui
 } // namespace android
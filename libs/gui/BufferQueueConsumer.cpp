@@ -58,226 +58,286 @@ status_t BufferQueueConsumer::acquireBuffer(BufferItem* outBuffer,
     sp<IProducerListener> listener;
     {
         Mutex::Autolock lock(mCore->mMutex);
+        status_t result = acquireBufferLocked(outBuffer, expectedPresent,
+                maxFrameNumber, &listener, &numDroppedBuffers);
+        if (result != NO_ERROR) {
+            return result;
+        }
+    }
+
+    if (listener != NULL) {
+        for (int i = 0; i < numDroppedBuffers; ++i) {
+            listener->onBufferReleased();
+        }
+    }
+
+    return NO_ERROR;
+}
+
+status_t BufferQueueConsumer::acquireBuffers(std::vector<BufferItem>* outBuffers,
+        nsecs_t expectedPresent, int maxBuffers) {
+    ATRACE_CALL();
+
+    if (outBuffers == nullptr || maxBuffers < 1) {
+        BQ_LOGE("acquireBuffers: invalid arguments (outBuffers %p maxBuffers %d)",
+                outBuffers, maxBuffers);
+        return BAD_VALUE;
+    }
+    outBuffers->clear();
+
+    int numDroppedBuffers = 0;
+    sp<IProducerListener> listener;
+    {
+        Mutex::Autolock lock(mCore->mMutex);
+        while (static_cast<int>(outBuffers->size()) < maxBuffers) {
+            // In shared buffer mode an empty queue still yields the shared
+            // buffer. Acquiring it more than once per call would hand out
+            // duplicates, so only the first item may come from there.
+            if (!outBuffers->empty() && mCore->mQueue.empty()) {
+                break;
+            }
 
-        // Check that the consumer doesn't currently have the maximum number of
-        // buffers acquired. We allow the max buffer count to be exceeded by one
-        // buffer so that the consumer can successfully set up the newly acquired
-        // buffer before releasing the old one.
-        int numAcquiredBuffers = 0;
-        for (int s : mCore->mActiveBuffers) {
-            if (mSlots[s].mBufferState.isAcquired()) {
-                ++numAcquiredBuffers;
+            BufferItem item;
+            status_t result = acquireBufferLocked(&item, expectedPresent, 0,
+                    &listener, &numDroppedBuffers);
+            if (result != NO_ERROR) {
+                // Report a failure only if nothing was acquired; otherwise
+                // return what we have
+                if (outBuffers->empty()) {
+                    return result;
+                }
+                break;
             }
+            outBuffers->push_back(item);
         }
-        if (numAcquiredBuffers >= mCore->mMaxAcquiredBufferCount + 1) {
-            BQ_LOGE("acquireBuffer: max acquired buffer count reached: %d (max %d)",
-                    numAcquiredBuffers, mCore->mMaxAcquiredBufferCount);
-            return INVALID_OPERATION;
+    }
+
+    if (listener != NULL) {
+        for (int i = 0; i < numDroppedBuffers; ++i) {
+            listener->onBufferReleased();
         }
+    }
 
-        bool sharedBufferAvailable = mCore->mSharedBufferMode &&
-                mCore->mAutoRefresh && mCore->mSharedBufferSlot !=
-                BufferQueueCore::INVALID_BUFFER_SLOT;
+    return NO_ERROR;
+}
 
-        // In asynchronous mode the list is guaranteed to be one buffer deep,
-        // while in synchronous mode we use the oldest buffer.
-        if (mCore->mQueue.empty() && !sharedBufferAvailable) {
-            return NO_BUFFER_AVAILABLE;
+status_t BufferQueueConsumer::acquireBufferLocked(BufferItem* outBuffer,
+        nsecs_t expectedPresent, uint64_t maxFrameNumber,
+        sp<IProducerListener>* outListener, int* outNumDroppedBuffers) {
+    // Check that the consumer doesn't currently have the maximum number of
+    // buffers acquired. We allow the max buffer count to be exceeded by one
+    // buffer so that the consumer can successfully set up the newly acquired
+    // buffer before releasing the old one.
+    int numAcquiredBuffers = 0;
+    for (int s : mCore->mActiveBuffers) {
+        if (mSlots[s].mBufferState.isAcquired()) {
+            ++numAcquiredBuffers;
         }
+    }
+    if (numAcquiredBuffers >= mCore->mMaxAcquiredBufferCount + 1) {
+        BQ_LOGE("acquireBuffer: max acquired buffer count reached: %d (max %d)",
+                numAcquiredBuffers, mCore->mMaxAcquiredBufferCount);
+        return INVALID_OPERATION;
+    }
 
-        BufferQueueCore::Fifo::iterator front(mCore->mQueue.begin());
-
-        // If expectedPresent is specified, we may not want to return a buffer yet.
-        // If it's specified and there's more than one buffer queued, we may want
-        // to drop a buffer.
-        // Skip this if we're in shared buffer mode and the queue is empty,
-        // since in that case we'll just return the shared buffer.
-        if (expectedPresent != 0 && !mCore->mQueue.empty()) {
-            const int MAX_REASONABLE_NSEC = 1000000000ULL; // 1 second
-
-            // The 'expectedPresent' argument indicates when the buffer is expected
-            // to be presented on-screen. If the buffer's desired present time is
-            // earlier (less) than expectedPresent -- meaning it will be displayed
-            // on time or possibly late if we show it as soon as possible -- we
-            // acquire and return it. If we don't want to display it until after the
-            // expectedPresent time, we return PRESENT_LATER without acquiring it.
-            //
-            // To be safe, we don't defer acquisition if expectedPresent is more
-            // than one second in the future beyond the desired present time
-            // (i.e., we'd be holding the buffer for a long time).
-            //
-            // NOTE: Code assumes monotonic time values from the system clock
-            // are positive.
-
-            // Start by checking to see if we can drop frames. We skip this check if
-            // the timestamps are being auto-generated by Surface. If the app isn't
-            // generating timestamps explicitly, it probably doesn't want frames to
-            // be discarded based on them.
-            while (mCore->mQueue.size() > 1 && !mCore->mQueue[0].mIsAutoTimestamp) {
-                const BufferItem& bufferItem(mCore->mQueue[1]);
-
-                // If dropping entry[0] would leave us with a buffer that the
-                // consumer is not yet ready for, don't drop it.
-                if (maxFrameNumber && bufferItem.mFrameNumber > maxFrameNumber) {
-                    break;
-                }
+    bool sharedBufferAvailable = mCore->mSharedBufferMode &&
+            mCore->mAutoRefresh && mCore->mSharedBufferSlot !=
+            BufferQueueCore::INVALID_BUFFER_SLOT;
 
-                // If entry[1] is timely, drop entry[0] (and repeat). We apply an
-                // additional criterion here: we only drop the earlier buffer if our
-                // desiredPresent falls within +/- 1 second of the expected present.
-                // Otherwise, bogus desiredPresent times (e.g., 0 or a small
-                // relative timestamp), which normally mean "ignore the timestamp
-                // and acquire immediately", would cause us to drop frames.
-                //
-                // We may want to add an additional criterion: don't drop the
-                // earlier buffer if entry[1]'s fence hasn't signaled yet.
-                nsecs_t desiredPresent = bufferItem.mTimestamp;
-                if (desiredPresent < expectedPresent - MAX_REASONABLE_NSEC ||
-                        desiredPresent > expectedPresent) {
-                    // This buffer is set to display in the near future, or
-                    // desiredPresent is garbage. Either way we don't want to drop
-                    // the previous buffer just to get this on the screen sooner.
-                    BQ_LOGV("acquireBuffer: nodrop desire=%" PRId64 " expect=%"
-                            PRId64 " (%" PRId64 ") now=%" PRId64,
-                            desiredPresent, expectedPresent,
-                            desiredPresent - expectedPresent,
-                            systemTime(CLOCK_MONOTONIC));
-                    break;
-                }
-
-                BQ_LOGV("acquireBuffer: drop desire=%" PRId64 " expect=%" PRId64
-                        " size=%zu",
-                        desiredPresent, expectedPresent, mCore->mQueue.size());
-
-                if (!front->mIsStale) {
-                    // Front buffer is still in mSlots, so mark the slot as free
-                    mSlots[front->mSlot].mBufferState.freeQueued();
-
-                    // After leaving shared buffer mode, the shared buffer will
-                    // still be around. Mark it as no longer shared if this
-                    // operation causes it to be free.
-                    if (!mCore->mSharedBufferMode &&
-                            mSlots[front->mSlot].mBufferState.isFree()) {
-                        mSlots[front->mSlot].mBufferState.mShared = false;
-                    }
-
-                    // Don't put the shared buffer on the free list
-                    if (!mSlots[front->mSlot].mBufferState.isShared()) {
-                        mCore->mActiveBuffers.erase(front->mSlot);
-                        mCore->mFreeBuffers.push_back(front->mSlot);
-                    }
-
-                    listener = mCore->mConnectedProducerListener;
-                    ++numDroppedBuffers;
-                }
+    // In asynchronous mode the list is guaranteed to be one buffer deep,
+    // while in synchronous mode we use the oldest buffer.
+    if (mCore->mQueue.empty() && !sharedBufferAvailable) {
+        return NO_BUFFER_AVAILABLE;
+    }
 
-                mCore->mQueue.erase(front);
-                front = mCore->mQueue.begin();
+    BufferQueueCore::Fifo::iterator front(mCore->mQueue.begin());
+
+    // If expectedPresent is specified, we may not want to return a buffer yet.
+    // If it's specified and there's more than one buffer queued, we may want
+    // to drop a buffer.
+    // Skip this if we're in shared buffer mode and the queue is empty,
+    // since in that case we'll just return the shared buffer.
+    if (expectedPresent != 0 && !mCore->mQueue.empty()) {
+        const int MAX_REASONABLE_NSEC = 1000000000ULL; // 1 second
+
+        // The 'expectedPresent' argument indicates when the buffer is expected
+        // to be presented on-screen. If the buffer's desired present time is
+        // earlier (less) than expectedPresent -- meaning it will be displayed
+        // on time or possibly late if we show it as soon as possible -- we
+        // acquire and return it. If we don't want to display it until after the
+        // expectedPresent time, we return PRESENT_LATER without acquiring it.
+        //
+        // To be safe, we don't defer acquisition if expectedPresent is more
+        // than one second in the future beyond the desired present time
+        // (i.e., we'd be holding the buffer for a long time).
+        //
+        // NOTE: Code assumes monotonic time values from the system clock
+        // are positive.
+
+        // Start by checking to see if we can drop frames. We skip this check if
+        // the timestamps are being auto-generated by Surface. If the app isn't
+        // generating timestamps explicitly, it probably doesn't want frames to
+        // be discarded based on them.
+        while (mCore->mQueue.size() > 1 && !mCore->mQueue[0].mIsAutoTimestamp) {
+            const BufferItem& bufferItem(mCore->mQueue[1]);
+
+            // If dropping entry[0] would leave us with a buffer that the
+            // consumer is not yet ready for, don't drop it.
+            if (maxFrameNumber && bufferItem.mFrameNumber > maxFrameNumber) {
+                break;
             }
 
-            // See if the front buffer is ready to be acquired
-            nsecs_t desiredPresent = front->mTimestamp;
-            bool bufferIsDue = desiredPresent <= expectedPresent ||
-                    desiredPresent > expectedPresent + MAX_REASONABLE_NSEC;
-            bool consumerIsReady = maxFrameNumber > 0 ?
-                    front->mFrameNumber <= maxFrameNumber : true;
-            if (!bufferIsDue || !consumerIsReady) {
-                BQ_LOGV("acquireBuffer: defer desire=%" PRId64 " expect=%" PRId64
-                        " (%" PRId64 ") now=%" PRId64 " frame=%" PRIu64
-                        " consumer=%" PRIu64,
+            // If entry[1] is timely, drop entry[0] (and repeat). We apply an
+            // additional criterion here: we only drop the earlier buffer if our
+            // desiredPresent falls within +/- 1 second of the expected present.
+            // Otherwise, bogus desiredPresent times (e.g., 0 or a small
+            // relative timestamp), which normally mean "ignore the timestamp
+            // and acquire immediately", would cause us to drop frames.
+            //
+            // We may want to add an additional criterion: don't drop the
+            // earlier buffer if entry[1]'s fence hasn't signaled yet.
+            nsecs_t desiredPresent = bufferItem.mTimestamp;
+            if (desiredPresent < expectedPresent - MAX_REASONABLE_NSEC ||
+                    desiredPresent > expectedPresent) {
+                // This buffer is set to display in the near future, or
+                // desiredPresent is garbage. Either way we don't want to drop
+                // the previous buffer just to get this on the screen sooner.
+                BQ_LOGV("acquireBuffer: nodrop desire=%" PRId64 " expect=%"
+                        PRId64 " (%" PRId64 ") now=%" PRId64,
                         desiredPresent, expectedPresent,
                         desiredPresent - expectedPresent,
-                        systemTime(CLOCK_MONOTONIC),
-                        front->mFrameNumber, maxFrameNumber);
-                return PRESENT_LATER;
+                        systemTime(CLOCK_MONOTONIC));
+                break;
             }
 
-            BQ_LOGV("acquireBuffer: accept desire=%" PRId64 " expect=%" PRId64 " "
-                    "(%" PRId64 ") now=%" PRId64, desiredPresent, expectedPresent,
-                    desiredPresent - expectedPresent,
-                    systemTime(CLOCK_MONOTONIC));
-        }
+            BQ_LOGV("acquireBuffer: drop desire=%" PRId64 " expect=%" PRId64
+                    " size=%zu",
+                    desiredPresent, expectedPresent, mCore->mQueue.size());
 
-        int slot = BufferQueueCore::INVALID_BUFFER_SLOT;
-
-        if (sharedBufferAvailable && mCore->mQueue.empty()) {
-            // make sure the buffer has finished allocating before acquiring it
-            mCore->waitWhileAllocatingLocked();
-
-            slot = mCore->mSharedBufferSlot;
-
-            // Recreate the BufferItem for the shared buffer from the data that
-            // was cached when it was last queued.
-            outBuffer->mGraphicBuffer = mSlots[slot].mGraphicBuffer;
-            outBuffer->mFence = Fence::NO_FENCE;
-            outBuffer->mFenceTime = FenceTime::NO_FENCE;
-            outBuffer->mCrop = mCore->mSharedBufferCache.crop;
-            outBuffer->mTransform = mCore->mSharedBufferCache.transform &
-                    ~static_cast<uint32_t>(
-                    NATIVE_WINDOW_TRANSFORM_INVERSE_DISPLAY);
-            outBuffer->mScalingMode = mCore->mSharedBufferCache.scalingMode;
-            outBuffer->mDataSpace = mCore->mSharedBufferCache.dataspace;
-            outBuffer->mFrameNumber = mCore->mFrameCounter;
-            outBuffer->mSlot = slot;
-            outBuffer->mAcquireCalled = mSlots[slot].mAcquireCalled;
-            outBuffer->mTransformToDisplayInverse =
-                    (mCore->mSharedBufferCache.transform &
-                    NATIVE_WINDOW_TRANSFORM_INVERSE_DISPLAY) != 0;
-            outBuffer->mSurfaceDamage = Region::INVALID_REGION;
-            outBuffer->mQueuedBuffer = false;
-            outBuffer->mIsStale = false;
-            outBuffer->mAutoRefresh = mCore->mSharedBufferMode &&
-                    mCore->mAutoRefresh;
-        } else {
-            slot = front->mSlot;
-            *outBuffer = *front;
-        }
+            if (!front->mIsStale) {
+                // Front buffer is still in mSlots, so mark the slot as free
+                mSlots[front->mSlot].mBufferState.freeQueued();
 
-        ATRACE_BUFFER_INDEX(slot);
+                // After leaving shared buffer mode, the shared buffer will
+                // still be around. Mark it as no longer shared if this
+                // operation causes it to be free.
+                if (!mCore->mSharedBufferMode &&
+                        mSlots[front->mSlot].mBufferState.isFree()) {
+                    mSlots[front->mSlot].mBufferState.mShared = false;
+                }
 
-        BQ_LOGV("acquireBuffer: acquiring { slot=%d/%" PRIu64 " buffer=%p }",
-                slot, outBuffer->mFrameNumber, outBuffer->mGraphicBuffer->handle);
+                // Don't put the shared buffer on the free list
+                if (!mSlots[front->mSlot].mBufferState.isShared()) {
+                    mCore->mActiveBuffers.erase(front->mSlot);
+                    mCore->mFreeBuffers.push_back(front->mSlot);
+                }
 
-        if (!outBuffer->mIsStale) {
-            mSlots[slot].mAcquireCalled = true;
-            // Don't decrease the queue count if the BufferItem wasn't
-            // previously in the queue. This happens in shared buffer mode when
-            // the queue is empty and the BufferItem is created above.
-            if (mCore->mQueue.empty()) {
-                mSlots[slot].mBufferState.acquireNotInQueue();
-            } else {
-                mSlots[slot].mBufferState.acquire();
+                *outListener = mCore->mBufferReleasedCbEnabled
+                        ? mCore->mConnectedProducerListener : NULL;
+                ++(*outNumDroppedBuffers);
             }
-            mSlots[slot].mFence = Fence::NO_FENCE;
+
+            mCore->mQueue.erase(front);
+            front = mCore->mQueue.begin();
         }
 
-        // If the buffer has previously been acquired by the consumer, set
-        // mGraphicBuffer to NULL to avoid unnecessarily remapping this buffer
-        // on the consumer side
-        if (outBuffer->mAcquireCalled) {
-            outBuffer->mGraphicBuffer = NULL;
+        // See if the front buffer is ready to be acquired
+        nsecs_t desiredPresent = front->mTimestamp;
+        bool bufferIsDue = desiredPresent <= expectedPresent ||
+                desiredPresent > expectedPresent + MAX_REASONABLE_NSEC;
+        bool consumerIsReady = maxFrameNumber > 0 ?
+                front->mFrameNumber <= maxFrameNumber : true;
+        if (!bufferIsDue || !consumerIsReady) {
+            BQ_LOGV("acquireBuffer: defer desire=%" PRId64 " expect=%" PRId64
+                    " (%" PRId64 ") now=%" PRId64 " frame=%" PRIu64
+                    " consumer=%" PRIu64,
+                    desiredPresent, expectedPresent,
+                    desiredPresent - expectedPresent,
+                    systemTime(CLOCK_MONOTONIC),
+                    front->mFrameNumber, maxFrameNumber);
+            return PRESENT_LATER;
         }
 
-        mCore->mQueue.erase(front);
+        BQ_LOGV("acquireBuffer: accept desire=%" PRId64 " expect=%" PRId64 " "
+                "(%" PRId64 ") now=%" PRId64, desiredPresent, expectedPresent,
+                desiredPresent - expectedPresent,
+                systemTime(CLOCK_MONOTONIC));
+    }
 
-        // We might have freed a slot while dropping old buffers, or the producer
-        // may be blocked waiting for the number of buffers in the queue to
-        // decrease.
-        mCore->mDequeueCondition.broadcast();
+    int slot = BufferQueueCore::INVALID_BUFFER_SLOT;
 
-        ATRACE_INT(mCore->mConsumerName.string(),
-                static_cast<int32_t>(mCore->mQueue.size()));
-        mCore->mOccupancyTracker.registerOccupancyChange(mCore->mQueue.size());
+    if (sharedBufferAvailable && mCore->mQueue.empty()) {
+        // make sure the buffer has finished allocating before acquiring it
+        mCore->waitWhileAllocatingLocked();
 
-        VALIDATE_CONSISTENCY();
+        slot = mCore->mSharedBufferSlot;
+
+        // Recreate the BufferItem for the shared buffer from the data that
+        // was cached when it was last queued.
+        outBuffer->mGraphicBuffer = mSlots[slot].mGraphicBuffer;
+        outBuffer->mFence = Fence::NO_FENCE;
+        outBuffer->mFenceTime = FenceTime::NO_FENCE;
+        outBuffer->mCrop = mCore->mSharedBufferCache.crop;
+        outBuffer->mTransform = mCore->mSharedBufferCache.transform &
+                ~static_cast<uint32_t>(
+                NATIVE_WINDOW_TRANSFORM_INVERSE_DISPLAY);
+        outBuffer->mScalingMode = mCore->mSharedBufferCache.scalingMode;
+        outBuffer->mDataSpace = mCore->mSharedBufferCache.dataspace;
+        outBuffer->mFrameNumber = mCore->mFrameCounter;
+        outBuffer->mSlot = slot;
+        outBuffer->mAcquireCalled = mSlots[slot].mAcquireCalled;
+        outBuffer->mTransformToDisplayInverse =
+                (mCore->mSharedBufferCache.transform &
+                NATIVE_WINDOW_TRANSFORM_INVERSE_DISPLAY) != 0;
+        outBuffer->mSurfaceDamage = Region::INVALID_REGION;
+        outBuffer->mQueuedBuffer = false;
+        outBuffer->mIsStale = false;
+        outBuffer->mAutoRefresh = mCore->mSharedBufferMode &&
+                mCore->mAutoRefresh;
+    } else {
+        slot = front->mSlot;
+        *outBuffer = *front;
     }
 
-    if (listener != NULL) {
-        for (int i = 0; i < numDroppedBuffers; ++i) {
-            listener->onBufferReleased();
+    ATRACE_BUFFER_INDEX(slot);
+
+    BQ_LOGV("acquireBuffer: acquiring { slot=%d/%" PRIu64 " buffer=%p }",
+            slot, outBuffer->mFrameNumber, outBuffer->mGraphicBuffer->handle);
+
+    if (!outBuffer->mIsStale) {
+        mSlots[slot].mAcquireCalled = true;
+        // Don't decrease the queue count if the BufferItem wasn't
+        // previously in the queue. This happens in shared buffer mode when
+        // the queue is empty and the BufferItem is created above.
+        if (mCore->mQueue.empty()) {
+            mSlots[slot].mBufferState.acquireNotInQueue();
+        } else {
+            mSlots[slot].mBufferState.acquire();
         }
+        mSlots[slot].mFence = Fence::NO_FENCE;
     }
 
+    // If the buffer has previously been acquired by the consumer, set
+    // mGraphicBuffer to NULL to avoid unnecessarily remapping this buffer
+    // on the consumer side
+    if (outBuffer->mAcquireCalled) {
+        outBuffer->mGraphicBuffer = NULL;
+    }
+
+    mCore->mQueue.erase(front);
+
+    // We might have freed a slot while dropping old buffers, or the producer
+    // may be blocked waiting for the number of buffers in the queue to
+    // decrease.
+    mCore->mDequeueCondition.broadcast();
+
+    ATRACE_INT(mCore->mConsumerName.string(),
+            static_cast<int32_t>(mCore->mQueue.size()));
+    mCore->mOccupancyTracker.registerOccupancyChange(mCore->mQueue.size());
+    mCore->updateAdaptiveBufferCountLocked();
+
+    VALIDATE_CONSISTENCY();
+
     return NO_ERROR;
 }
 
@@ -359,6 +419,7 @@ status_t BufferQueueConsumer::attachBuffer(int* outSlot,
     }
 
     // Find a free slot to put the buffer into
+    mCore->drainStagedSlotsLocked();
     int found = BufferQueueCore::INVALID_BUFFER_SLOT;
     if (!mCore->mFreeSlots.empty()) {
         auto slot = mCore->mFreeSlots.begin();
@@ -423,52 +484,118 @@ status_t BufferQueueConsumer::releaseBuffer(int slot, uint64_t frameNumber,
     { // Autolock scope
         Mutex::Autolock lock(mCore->mMutex);
 
-        // If the frame number has changed because the buffer has been reallocated,
-        // we can ignore this releaseBuffer for the old buffer.
-        // Ignore this for the shared buffer where the frame number can easily
-        // get out of sync due to the buffer being queued and acquired at the
-        // same time.
-        if (frameNumber != mSlots[slot].mFrameNumber &&
-                !mSlots[slot].mBufferState.isShared()) {
-            return STALE_BUFFER_SLOT;
+        status_t result = releaseBufferLocked(slot, frameNumber, releaseFence,
+                eglDisplay, eglFence);
+        if (result != NO_ERROR) {
+            return result;
         }
 
-        if (!mSlots[slot].mBufferState.isAcquired()) {
-            BQ_LOGE("releaseBuffer: attempted to release buffer slot %d "
-                    "but its state was %s", slot,
-                    mSlots[slot].mBufferState.string());
-            return BAD_VALUE;
-        }
+        listener = mCore->mBufferReleasedCbEnabled
+                ? mCore->mConnectedProducerListener : NULL;
+        mCore->mDequeueCondition.broadcast();
+        VALIDATE_CONSISTENCY();
+    } // Autolock scope
 
-        mSlots[slot].mEglDisplay = eglDisplay;
-        mSlots[slot].mEglFence = eglFence;
-        mSlots[slot].mFence = releaseFence;
-        mSlots[slot].mBufferState.release();
+    // Call back without lock held
+    if (listener != NULL) {
+        listener->onBufferReleased();
+    }
 
-        // After leaving shared buffer mode, the shared buffer will
-        // still be around. Mark it as no longer shared if this
-        // operation causes it to be free.
-        if (!mCore->mSharedBufferMode && mSlots[slot].mBufferState.isFree()) {
-            mSlots[slot].mBufferState.mShared = false;
-        }
-        // Don't put the shared buffer on the free list.
-        if (!mSlots[slot].mBufferState.isShared()) {
-            mCore->mActiveBuffers.erase(slot);
-            mCore->mFreeBuffers.push_back(slot);
-        }
+    return NO_ERROR;
+}
 
-        listener = mCore->mConnectedProducerListener;
-        BQ_LOGV("releaseBuffer: releasing slot %d", slot);
+status_t BufferQueueConsumer::releaseBuffers(const std::vector<BufferItem>& buffers) {
+    ATRACE_CALL();
 
-        mCore->mDequeueCondition.broadcast();
-        VALIDATE_CONSISTENCY();
+    status_t result = NO_ERROR;
+    int numReleasedBuffers = 0;
+    sp<IProducerListener> listener;
+    { // Autolock scope
+        Mutex::Autolock lock(mCore->mMutex);
+
+        for (const BufferItem& item : buffers) {
+            status_t err;
+            if (item.mSlot < 0 ||
+                    item.mSlot >= BufferQueueDefs::NUM_BUFFER_SLOTS ||
+                    item.mFence == NULL) {
+                BQ_LOGE("releaseBuffers: slot %d out of range or fence %p "
+                        "NULL", item.mSlot, item.mFence.get());
+                err = BAD_VALUE;
+            } else {
+                err = releaseBufferLocked(item.mSlot, item.mFrameNumber,
+                        item.mFence, EGL_NO_DISPLAY, EGL_NO_SYNC_KHR);
+            }
+            // Keep going on failure so one stale entry doesn't strand the
+            // rest of the batch, but report the first failing status
+            if (err != NO_ERROR) {
+                if (result == NO_ERROR) {
+                    result = err;
+                }
+                continue;
+            }
+            ++numReleasedBuffers;
+        }
+
+        if (numReleasedBuffers > 0) {
+            mCore->mDequeueCondition.broadcast();
+            listener = mCore->mBufferReleasedCbEnabled
+                    ? mCore->mConnectedProducerListener : NULL;
+            VALIDATE_CONSISTENCY();
+        }
     } // Autolock scope
 
     // Call back without lock held
     if (listener != NULL) {
-        listener->onBufferReleased();
+        for (int i = 0; i < numReleasedBuffers; ++i) {
+            listener->onBufferReleased();
+        }
     }
 
+    return result;
+}
+
+status_t BufferQueueConsumer::releaseBufferLocked(int slot, uint64_t frameNumber,
+        const sp<Fence>& releaseFence, EGLDisplay eglDisplay,
+        EGLSyncKHR eglFence) {
+    // If the frame number has changed because the buffer has been reallocated,
+    // we can ignore this releaseBuffer for the old buffer.
+    // Ignore this for the shared buffer where the frame number can easily
+    // get out of sync due to the buffer being queued and acquired at the
+    // same time.
+    if (frameNumber != mSlots[slot].mFrameNumber &&
+            !mSlots[slot].mBufferState.isShared()) {
+        return STALE_BUFFER_SLOT;
+    }
+
+    if (!mSlots[slot].mBufferState.isAcquired()) {
+        BQ_LOGE("releaseBuffer: attempted to release buffer slot %d "
+                "but its state was %s", slot,
+                mSlots[slot].mBufferState.string());
+        return BAD_VALUE;
+    }
+
+    mSlots[slot].mEglDisplay = eglDisplay;
+    mSlots[slot].mEglFence = eglFence;
+    mSlots[slot].mFence = releaseFence;
+    mSlots[slot].mBufferState.release();
+
+    // After leaving shared buffer mode, the shared buffer will
+    // still be around. Mark it as no longer shared if this
+    // operation causes it to be free.
+    if (!mCore->mSharedBufferMode && mSlots[slot].mBufferState.isFree()) {
+        mSlots[slot].mBufferState.mShared = false;
+    }
+    // Don't put the shared buffer on the free list. Prefer staging the
+    // slot for the lock-free dequeue fast path; if it doesn't qualify,
+    // fall back to the regular free list.
+    if (!mSlots[slot].mBufferState.isShared() &&
+            !mCore->tryStageFreeSlotLocked(slot)) {
+        mCore->mActiveBuffers.erase(slot);
+        mCore->mFreeBuffers.push_back(slot);
+    }
+
+    BQ_LOGV("releaseBuffer: releasing slot %d", slot);
+
     return NO_ERROR;
 }
 
@@ -569,6 +696,7 @@ status_t BufferQueueConsumer::setDefaultBufferSize(uint32_t width,
     BQ_LOGV("setDefaultBufferSize: width=%u height=%u", width, height);
 
     Mutex::Autolock lock(mCore->mMutex);
+    mCore->drainStagedSlotsLocked();
     mCore->mDefaultWidth = width;
     mCore->mDefaultHeight = height;
     return NO_ERROR;
@@ -693,6 +821,7 @@ status_t BufferQueueConsumer::setDefaultBufferFormat(PixelFormat defaultFormat)
     ATRACE_CALL();
     BQ_LOGV("setDefaultBufferFormat: %u", defaultFormat);
     Mutex::Autolock lock(mCore->mMutex);
+    mCore->drainStagedSlotsLocked();
     mCore->mDefaultBufferFormat = defaultFormat;
     return NO_ERROR;
 }
@@ -710,6 +839,7 @@ status_t BufferQueueConsumer::setConsumerUsageBits(uint64_t usage) {
     ATRACE_CALL();
     BQ_LOGV("setConsumerUsageBits: %#" PRIx64, usage);
     Mutex::Autolock lock(mCore->mMutex);
+    mCore->drainStagedSlotsLocked();
     mCore->mConsumerUsageBits = usage;
     return NO_ERROR;
 }
@@ -743,6 +873,37 @@ status_t BufferQueueConsumer::getOccupancyHistory(bool forceFlush,
     return NO_ERROR;
 }
 
+status_t BufferQueueConsumer::setAdaptiveBufferCountEnabled(bool enabled) {
+    ATRACE_CALL();
+    BQ_LOGV("setAdaptiveBufferCountEnabled: enabled=%d", enabled);
+    Mutex::Autolock lock(mCore->mMutex);
+
+    if (enabled && mCore->mSharedBufferMode) {
+        BQ_LOGE("setAdaptiveBufferCountEnabled: invalid in shared buffer mode");
+        return BAD_VALUE;
+    }
+
+    if (enabled == mCore->mAdaptiveBufferCountEnabled) {
+        return NO_ERROR;
+    }
+
+    mCore->mAdaptiveBufferCountEnabled = enabled;
+    mCore->mAdaptiveQuietSegments = 0;
+    mCore->mAdaptiveLastUpdateTime = systemTime();
+    if (enabled) {
+        // Start at the configured count and shrink as evidence accumulates.
+        // Staged slots must be drained because the lock-free dequeue path
+        // bypasses the controller's limit.
+        mCore->mAdaptiveMaxBufferCount = mCore->getMaxBufferCountLocked();
+        mCore->drainStagedSlotsLocked();
+    } else {
+        // A producer may be blocked on a shrunken count.
+        mCore->mDequeueCondition.broadcast();
+    }
+
+    return NO_ERROR;
+}
+
 status_t BufferQueueConsumer::discardFreeBuffers() {
     Mutex::Autolock lock(mCore->mMutex);
     mCore->discardFreeBuffersLocked();
@@ -27,6 +27,7 @@
 #endif
 
 #include <inttypes.h>
+#include <sched.h>
 
 #include <cutils/properties.h>
 #include <cutils/atomic.h>
@@ -65,12 +66,15 @@ BufferQueueCore::BufferQueueCore() :
     mConnectedApi(NO_CONNECTED_API),
     mLinkedToDeath(),
     mConnectedProducerListener(),
+    mBufferReleasedCbEnabled(false),
     mSlots(),
     mQueue(),
     mFreeSlots(),
     mFreeBuffers(),
     mUnusedSlots(),
     mActiveBuffers(),
+    mStagedFreeSlots(0),
+    mFastDequeuesInFlight(0),
     mDequeueCondition(),
     mDequeueBufferCannotBlock(false),
     mDefaultBufferFormat(PIXEL_FORMAT_RGBA_8888),
@@ -95,6 +99,10 @@ BufferQueueCore::BufferQueueCore() :
     mSharedBufferCache(Rect::INVALID_RECT, 0, NATIVE_WINDOW_SCALING_MODE_FREEZE,
             HAL_DATASPACE_UNKNOWN),
     mLastQueuedSlot(INVALID_BUFFER_SLOT),
+    mAdaptiveBufferCountEnabled(false),
+    mAdaptiveMaxBufferCount(0),
+    mAdaptiveQuietSegments(0),
+    mAdaptiveLastUpdateTime(0),
     mUniqueId(getUniqueId())
 {
     int numStartingBuffers = getMaxBufferCountLocked();
@@ -117,10 +125,27 @@ void BufferQueueCore::dumpState(const String8& prefix, String8* outResult) const
                             mMaxAcquiredBufferCount, mMaxDequeuedBufferCount);
     outResult->appendFormat("%s  mDequeueBufferCannotBlock=%d mAsyncMode=%d\n", prefix.string(),
                             mDequeueBufferCannotBlock, mAsyncMode);
+    if (mAdaptiveBufferCountEnabled) {
+        outResult->appendFormat("%s  mAdaptiveMaxBufferCount=%d\n", prefix.string(),
+                                mAdaptiveMaxBufferCount);
+    }
     outResult->appendFormat("%s  default-size=[%dx%d] default-format=%d ", prefix.string(),
                             mDefaultWidth, mDefaultHeight, mDefaultBufferFormat);
     outResult->appendFormat("transform-hint=%02x frame-counter=%" PRIu64, mTransformHint,
-                            mFrameCounter);
+                            mFrameCounter.load());
+
+    OccupancyTracker::QueueHealthStats health;
+    mOccupancyTracker.getQueueHealthStats(&health);
+    outResult->appendFormat("\n%s  occupancy-ms=[%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 "]",
+                            prefix.string(), health.timeAtOccupancyNs[0] / 1000000,
+                            health.timeAtOccupancyNs[1] / 1000000,
+                            health.timeAtOccupancyNs[2] / 1000000,
+                            health.timeAtOccupancyNs[3] / 1000000);
+    outResult->appendFormat(" dequeue-waits=%" PRIu64 " (%" PRIu64 "ms) hist=[%" PRIu64 ",%" PRIu64
+                            ",%" PRIu64 ",%" PRIu64 "]",
+                            health.producerWaitCount, health.producerWaitTimeNs / 1000000,
+                            health.producerWaitHistogram[0], health.producerWaitHistogram[1],
+                            health.producerWaitHistogram[2], health.producerWaitHistogram[3]);
 
     outResult->appendFormat("\n%sFIFO(%zu):\n", prefix.string(), mQueue.size());
     Fifo::const_iterator current(mQueue.begin());
@@ -201,6 +226,68 @@ int BufferQueueCore::getMaxBufferCountLocked() const {
     return maxBufferCount;
 }
 
+int BufferQueueCore::getEffectiveMaxBufferCountLocked() const {
+    int maxBufferCount = getMaxBufferCountLocked();
+    if (mAdaptiveBufferCountEnabled) {
+        maxBufferCount = std::min(maxBufferCount,
+                std::max(mAdaptiveMaxBufferCount, getMinMaxBufferCountLocked()));
+    }
+    return maxBufferCount;
+}
+
+void BufferQueueCore::updateAdaptiveBufferCountLocked() {
+    if (!mAdaptiveBufferCountEnabled || mSharedBufferMode) {
+        return;
+    }
+
+    nsecs_t now = systemTime();
+    if (now - mAdaptiveLastUpdateTime < ADAPTIVE_UPDATE_DELAY) {
+        return;
+    }
+    mAdaptiveLastUpdateTime = now;
+
+    // Force a flush so the controller also sees activity on queues that
+    // never go idle long enough for the tracker to close a segment on its
+    // own. While the controller is enabled it owns the segment history.
+    std::vector<OccupancyTracker::Segment> segments =
+            mOccupancyTracker.getSegmentHistory(true);
+    if (segments.empty()) {
+        return;
+    }
+
+    const int minCount = getMinMaxBufferCountLocked();
+    const int maxCount = getMaxBufferCountLocked();
+    int target = std::min(std::max(mAdaptiveMaxBufferCount, minCount), maxCount);
+
+    // getSegmentHistory returns the most recent segment first; walk from the
+    // oldest so the hysteresis follows wall-clock order.
+    for (auto segment = segments.crbegin(); segment != segments.crend(); ++segment) {
+        if (segment->usedThirdBuffer) {
+            // The consumer fell behind at some point during this segment, so
+            // grow right away to absorb the jitter.
+            mAdaptiveQuietSegments = 0;
+            if (target < maxCount) {
+                ++target;
+            }
+        } else if (++mAdaptiveQuietSegments >= ADAPTIVE_SHRINK_SEGMENTS) {
+            // The consumer has kept up for a while; try a smaller pipeline
+            // for lower latency and memory use.
+            mAdaptiveQuietSegments = 0;
+            if (target > minCount) {
+                --target;
+            }
+        }
+    }
+
+    if (target != mAdaptiveMaxBufferCount) {
+        BQ_LOGV("updateAdaptiveBufferCountLocked: target %d -> %d",
+                mAdaptiveMaxBufferCount, target);
+        mAdaptiveMaxBufferCount = target;
+        // A producer blocked on the old limit may be able to dequeue now.
+        mDequeueCondition.broadcast();
+    }
+}
+
 void BufferQueueCore::clearBufferSlotLocked(int slot) {
     BQ_LOGV("clearBufferSlotLocked: slot %d", slot);
 
@@ -225,6 +312,8 @@ void BufferQueueCore::clearBufferSlotLocked(int slot) {
 }
 
 void BufferQueueCore::freeAllBuffersLocked() {
+    drainStagedSlotsLocked();
+
     for (int s : mFreeSlots) {
         clearBufferSlotLocked(s);
     }
@@ -256,6 +345,8 @@ void BufferQueueCore::freeAllBuffersLocked() {
 }
 
 void BufferQueueCore::discardFreeBuffersLocked() {
+    drainStagedSlotsLocked();
+
     for (int s : mFreeBuffers) {
         mFreeSlots.insert(s);
         clearBufferSlotLocked(s);
@@ -266,6 +357,8 @@ void BufferQueueCore::discardFreeBuffersLocked() {
 }
 
 bool BufferQueueCore::adjustAvailableSlotsLocked(int delta) {
+    drainStagedSlotsLocked();
+
     if (delta >= 0) {
         // If we're going to fail, do so before modifying anything
         if (delta > static_cast<int>(mUnusedSlots.size())) {
@@ -313,6 +406,94 @@ void BufferQueueCore::waitWhileAllocatingLocked() const {
     }
 }
 
+// The staging bitmask can only describe this many slots.
+static_assert(BufferQueueDefs::NUM_BUFFER_SLOTS <= 64,
+        "BufferQueueCore::mStagedFreeSlots cannot track this many slots");
+
+bool BufferQueueCore::tryStageFreeSlotLocked(int slot) {
+    // The fast path would bypass the adaptive controller's limit, so slots
+    // aren't staged while it is enabled.
+    if (mIsAbandoned || mSharedBufferMode || mIsAllocating ||
+            mAdaptiveBufferCountEnabled || mConnectedApi == NO_CONNECTED_API) {
+        return false;
+    }
+    // Match the reconnect guard in waitForFreeSlotThenRelock: don't let
+    // the fast path outrun the consumer.
+    if (mQueue.size() > static_cast<size_t>(getMaxBufferCountLocked())) {
+        return false;
+    }
+    // The fast path cannot re-check the dequeued-buffer limit at claim
+    // time, so enforce it here: never leave more slots staged than the
+    // producer may still dequeue. Staged slots and claims in flight both
+    // count against the budget; over-counting only sends the next dequeue
+    // to the locked path, which re-checks the limit under the lock.
+    int dequeuedCount = 0;
+    for (int s : mActiveBuffers) {
+        if (mSlots[s].mBufferState.isDequeued()) {
+            dequeuedCount++;
+        }
+    }
+    dequeuedCount += __builtin_popcountll(
+            mStagedFreeSlots.load(std::memory_order_relaxed));
+    dequeuedCount += mFastDequeuesInFlight.load(std::memory_order_acquire);
+    if (dequeuedCount >= mMaxDequeuedBufferCount) {
+        return false;
+    }
+
+    BufferSlot& bufferSlot(mSlots[slot]);
+    if (!bufferSlot.mBufferState.isFree() || bufferSlot.mBufferState.isShared()) {
+        return false;
+    }
+    const sp<GraphicBuffer>& buffer(bufferSlot.mGraphicBuffer);
+    if (buffer == NULL || bufferSlot.mNeedsReallocation ||
+            !bufferSlot.mRequestBufferCalled ||
+            bufferSlot.mEglFence != EGL_NO_SYNC_KHR) {
+        return false;
+    }
+    // The buffer must be usable as-is for a default-sized dequeue; the
+    // producer-requested usage bits are checked again at claim time.
+    if (buffer->needsReallocation(mDefaultWidth, mDefaultHeight,
+            mDefaultBufferFormat, 1 /* layerCount */, mConsumerUsageBits)) {
+        return false;
+    }
+
+    BQ_LOGV("tryStageFreeSlotLocked: staging slot %d for fast dequeue", slot);
+
+    // The slot stays in mActiveBuffers while staged; the release ordering
+    // publishes the fence and state stored by our caller to the fast path.
+    mStagedFreeSlots.fetch_or(1ULL << slot, std::memory_order_release);
+    return true;
+}
+
+void BufferQueueCore::drainStagedSlotsLocked() {
+    for (;;) {
+        uint64_t staged = mStagedFreeSlots.exchange(0,
+                std::memory_order_acquire);
+        while (staged != 0) {
+            int slot = __builtin_ctzll(staged);
+            staged &= staged - 1;
+            mActiveBuffers.erase(slot);
+            mFreeBuffers.push_back(slot);
+        }
+
+        // Wait out dequeues that already claimed a staged slot so our
+        // caller never sees a slot in the middle of a fast-path
+        // transition. The window is tiny: claimers only flip the slot
+        // state and move fences.
+        while (mFastDequeuesInFlight.load(std::memory_order_acquire) > 0) {
+            sched_yield();
+        }
+
+        // A claim that failed its usage check hands its slot back by
+        // restaging it, possibly after the exchange above. Staging proper
+        // happens under mMutex, which we hold, so once no bits have
+        // reappeared the mask stays empty until our caller is done.
+        if (mStagedFreeSlots.load(std::memory_order_acquire) == 0) {
+            break;
+        }
+    }
+}
+
 #if DEBUG_ONLY_CODE
 void BufferQueueCore::validateConsistencyLocked() const {
     static const useconds_t PAUSE_TIME = 0;
@@ -413,8 +594,10 @@ void BufferQueueCore::validateConsistencyLocked() const {
                         slot);
                 usleep(PAUSE_TIME);
             }
+            bool isStaged = (mStagedFreeSlots.load(std::memory_order_relaxed) &
+                    (1ULL << slot)) != 0;
             if (mSlots[slot].mBufferState.isFree() &&
-                    !mSlots[slot].mBufferState.isShared()) {
+                    !mSlots[slot].mBufferState.isShared() && !isStaged) {
                 BQ_LOGE("Slot %d is in mActiveBuffers but is FREE", slot);
                 usleep(PAUSE_TIME);
             }
@@ -251,6 +251,9 @@ status_t BufferQueueProducer::waitForFreeSlotThenRelock(FreeSlotCaller caller,
             "dequeueBuffer" : "attachBuffer";
     bool tryAgain = true;
     while (tryAgain) {
+        // Make slots staged for the fast path visible to the search below.
+        mCore->drainStagedSlotsLocked();
+
         if (mCore->mIsAbandoned) {
             BQ_LOGE("%s: BufferQueue has been abandoned", callerString);
             return NO_INIT;
@@ -286,6 +289,18 @@ status_t BufferQueueProducer::waitForFreeSlotThenRelock(FreeSlotCaller caller,
         const int maxBufferCount = mCore->getMaxBufferCountLocked();
         bool tooManyBuffers = mCore->mQueue.size()
                             > static_cast<size_t>(maxBufferCount);
+        if (!tooManyBuffers && mCore->mAdaptiveBufferCountEnabled &&
+                !mCore->mSharedBufferMode) {
+            // The adaptive controller may cap the number of buffers in
+            // flight below what the producer configured. The producer hasn't
+            // violated its own limits, so it waits here (or gets WOULD_BLOCK
+            // in non-blocking mode) instead of getting an error.
+            const int inUseCount = dequeuedCount + acquiredCount +
+                    static_cast<int>(mCore->mQueue.size());
+            if (inUseCount >= mCore->getEffectiveMaxBufferCountLocked()) {
+                tooManyBuffers = true;
+            }
+        }
         if (tooManyBuffers) {
             BQ_LOGV("%s: queue size is %zu, waiting", callerString,
                     mCore->mQueue.size());
@@ -332,14 +347,19 @@ status_t BufferQueueProducer::waitForFreeSlotThenRelock(FreeSlotCaller caller,
                     (acquiredCount <= mCore->mMaxAcquiredBufferCount)) {
                 return WOULD_BLOCK;
             }
+            const nsecs_t waitStart = systemTime();
             if (mDequeueTimeout >= 0) {
                 status_t result = mCore->mDequeueCondition.waitRelative(
                         mCore->mMutex, mDequeueTimeout);
+                mCore->mOccupancyTracker.registerDequeueWait(
+                        systemTime() - waitStart);
                 if (result == TIMED_OUT) {
                     return result;
                 }
             } else {
                 mCore->mDequeueCondition.wait(mCore->mMutex);
+                mCore->mOccupancyTracker.registerDequeueWait(
+                        systemTime() - waitStart);
             }
         }
     } // while (tryAgain)
@@ -347,11 +367,86 @@ status_t BufferQueueProducer::waitForFreeSlotThenRelock(FreeSlotCaller caller,
     return NO_ERROR;
 }
 
+bool BufferQueueProducer::dequeueBufferFastPath(int* outSlot,
+        sp<Fence>* outFence, uint64_t usage, uint64_t* outBufferAge) {
+    // Announce ourselves before claiming so drainStagedSlotsLocked can
+    // wait for a claim that races with its exchange of the staged mask.
+    mCore->mFastDequeuesInFlight.fetch_add(1, std::memory_order_acquire);
+
+    int found = BufferQueueCore::INVALID_BUFFER_SLOT;
+    uint64_t staged = mCore->mStagedFreeSlots.load(std::memory_order_acquire);
+    while (staged != 0) {
+        const int slot = __builtin_ctzll(staged);
+        // acq_rel: acquire pairs with the staging release so the slot's
+        // state and fence are visible; release publishes our in-flight
+        // announcement above to the drain's acquire exchange, so a drainer
+        // that sees the slot claimed also waits for us.
+        if (mCore->mStagedFreeSlots.compare_exchange_weak(staged,
+                staged & ~(1ULL << slot), std::memory_order_acq_rel)) {
+            found = slot;
+            break;
+        }
+    }
+    if (found == BufferQueueCore::INVALID_BUFFER_SLOT) {
+        mCore->mFastDequeuesInFlight.fetch_sub(1, std::memory_order_release);
+        return false;
+    }
+
+    // The claimed slot is now exclusively ours until it is handed to the
+    // caller (or handed back below); nobody else mutates it.
+    BufferSlot& slot(mSlots[found]);
+    const sp<GraphicBuffer>& buffer(slot.mGraphicBuffer);
+
+    // Staging validated everything except the usage bits this particular
+    // dequeue asks for.
+    if ((buffer->getUsage() & usage) != usage) {
+        // Hand the slot back by restaging it; nothing has been modified
+        // yet. Taking mMutex here could deadlock against a drain that is
+        // waiting on our in-flight count, so the bit goes straight back
+        // into the mask -- restaged before the decrement, so a concurrent
+        // drainStagedSlotsLocked re-collects it -- and the locked path
+        // reallocates.
+        mCore->mStagedFreeSlots.fetch_or(1ULL << found,
+                std::memory_order_release);
+        mCore->mFastDequeuesInFlight.fetch_sub(1, std::memory_order_release);
+        return false;
+    }
+
+    slot.mBufferState.dequeue();
+
+    *outFence = slot.mFence;
+    slot.mFence = Fence::NO_FENCE;
+
+    const uint64_t bufferAge =
+            mCore->mFrameCounter.load(std::memory_order_relaxed) + 1 -
+            slot.mFrameNumber;
+    mCore->mBufferAge.store(bufferAge, std::memory_order_relaxed);
+    if (outBufferAge) {
+        *outBufferAge = bufferAge;
+    }
+    *outSlot = found;
+    ATRACE_BUFFER_INDEX(found);
+    BQ_LOGV("dequeueBuffer: fast path returning slot=%d", found);
+
+    mCore->mFastDequeuesInFlight.fetch_sub(1, std::memory_order_release);
+    return true;
+}
+
 status_t BufferQueueProducer::dequeueBuffer(int* outSlot, sp<android::Fence>* outFence,
                                             uint32_t width, uint32_t height, PixelFormat format,
                                             uint64_t usage, uint64_t* outBufferAge,
                                             FrameEventHistoryDelta* outTimestamps) {
     ATRACE_CALL();
+
+    // Fast path: claim a pre-validated FREE slot with atomics only. Only
+    // default-sized requests can use slots staged against the current
+    // defaults, and frame event history still needs the lock.
+    if (width == 0 && height == 0 && format == 0 && outTimestamps == nullptr) {
+        if (dequeueBufferFastPath(outSlot, outFence, usage, outBufferAge)) {
+            return NO_ERROR;
+        }
+    }
+
     { // Autolock scope
         Mutex::Autolock lock(mCore->mMutex);
         mConsumerName = mCore->mConsumerName;
@@ -469,7 +564,7 @@ status_t BufferQueueProducer::dequeueBuffer(int* outSlot, sp<android::Fence>* ou
         }
 
         BQ_LOGV("dequeueBuffer: setting buffer age to %" PRIu64,
-                mCore->mBufferAge);
+                mCore->mBufferAge.load());
 
         if (CC_UNLIKELY(mSlots[found].mFence == NULL)) {
             BQ_LOGE("dequeueBuffer: about to return a NULL fence - "
@@ -652,6 +747,7 @@ status_t BufferQueueProducer::detachNextBuffer(sp<GraphicBuffer>* outBuffer,
         }
 
         mCore->waitWhileAllocatingLocked();
+        mCore->drainStagedSlotsLocked();
 
         if (mCore->mFreeBuffers.empty()) {
             return NO_MEMORY;
@@ -943,6 +1039,7 @@ status_t BufferQueueProducer::queueBuffer(int slot,
         ATRACE_INT(mCore->mConsumerName.string(),
                 static_cast<int32_t>(mCore->mQueue.size()));
         mCore->mOccupancyTracker.registerOccupancyChange(mCore->mQueue.size());
+        mCore->updateAdaptiveBufferCountLocked();
 
         // Take a ticket for the callback functions
         callbackTicket = mNextCallbackTicket++;
@@ -1011,6 +1108,43 @@ status_t BufferQueueProducer::queueBuffer(int slot,
     return NO_ERROR;
 }
 
+status_t BufferQueueProducer::queueBufferAsync(int slot,
+        const QueueBufferInput &input) {
+    ATRACE_CALL();
+
+    QueueBufferOutput output;
+    status_t result = queueBuffer(slot, input, &output);
+    if (result != NO_ERROR) {
+        return result;
+    }
+
+    // Push the output fields to the producer listener, but only when they
+    // changed since the last notification; the whole point of the async path
+    // is to avoid per-frame producer-bound IPC.
+    sp<IProducerListener> listener;
+    { // Autolock scope
+        Mutex::Autolock lock(mCore->mMutex);
+        const bool runningBehind = output.numPendingBuffers >= 2;
+        if (output.width != mLastOutputWidth ||
+                output.height != mLastOutputHeight ||
+                output.transformHint != mLastOutputTransformHint ||
+                runningBehind != mLastOutputRunningBehind) {
+            mLastOutputWidth = output.width;
+            mLastOutputHeight = output.height;
+            mLastOutputTransformHint = output.transformHint;
+            mLastOutputRunningBehind = runningBehind;
+            listener = mCore->mConnectedProducerListener;
+        }
+    } // Autolock scope
+
+    if (listener != NULL) {
+        listener->onQueueBufferOutputChanged(output.width, output.height,
+                output.transformHint, output.numPendingBuffers);
+    }
+
+    return NO_ERROR;
+}
+
 status_t BufferQueueProducer::cancelBuffer(int slot, const sp<Fence>& fence) {
     ATRACE_CALL();
     BQ_LOGV("cancelBuffer: slot %d", slot);
@@ -1200,9 +1334,8 @@ status_t BufferQueueProducer::connect(const sp<IProducerListener>& listener,
                     }
                     mCore->mLinkedToDeath = listener;
                 }
-                if (listener->needsReleaseNotify()) {
-                    mCore->mConnectedProducerListener = listener;
-                }
+                mCore->mConnectedProducerListener = listener;
+                mCore->mBufferReleasedCbEnabled = listener->needsReleaseNotify();
             }
             break;
         default:
@@ -1280,6 +1413,7 @@ status_t BufferQueueProducer::disconnect(int api, DisconnectMode mode) {
                             BufferQueueCore::INVALID_BUFFER_SLOT;
                     mCore->mLinkedToDeath = NULL;
                     mCore->mConnectedProducerListener = NULL;
+                    mCore->mBufferReleasedCbEnabled = false;
                     mCore->mConnectedApi = BufferQueueCore::NO_CONNECTED_API;
                     mCore->mConnectedPid = -1;
                     mCore->mSidebandStream.clear();
@@ -1455,7 +1589,10 @@ status_t BufferQueueProducer::setSharedBufferMode(bool sharedBufferMode) {
     BQ_LOGV("setSharedBufferMode: %d", sharedBufferMode);
 
     Mutex::Autolock lock(mCore->mMutex);
-    if (!sharedBufferMode) {
+    if (sharedBufferMode) {
+        // Staged slots were validated for non-shared operation.
+        mCore->drainStagedSlotsLocked();
+    } else {
         mCore->mSharedBufferSlot = BufferQueueCore::INVALID_BUFFER_SLOT;
     }
     mCore->mSharedBufferMode = sharedBufferMode;
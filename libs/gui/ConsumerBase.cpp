@@ -57,6 +57,9 @@ static int32_t createProcessUniqueId() {
 
 ConsumerBase::ConsumerBase(const sp<IGraphicBufferConsumer>& bufferQueue, bool controlledByApp) :
         mAbandoned(false),
+        mFrameAvailableCoalescing(false),
+        mFrameCallbackPending(false),
+        mCoalescedFrameCount(0),
         mConsumer(bufferQueue),
         mPrevFinalReleaseFence(Fence::NO_FENCE) {
     // Choose a name using the PID and a process-unique ID.
@@ -105,14 +108,33 @@ void ConsumerBase::onFrameAvailable(const BufferItem& item) {
     CB_LOGV("onFrameAvailable");
 
     sp<FrameAvailableListener> listener;
+    bool coalesce = false;
+    size_t count = 1;
     { // scope for the lock
         Mutex::Autolock lock(mFrameAvailableMutex);
+        coalesce = mFrameAvailableCoalescing;
+        if (coalesce) {
+            if (mFrameCallbackPending) {
+                // The listener already has a wakeup outstanding; fold this
+                // frame into the count reported by the next callback.
+                mCoalescedFrameCount++;
+                return;
+            }
+            mFrameCallbackPending = true;
+            count += mCoalescedFrameCount;
+            mCoalescedFrameCount = 0;
+        }
         listener = mFrameAvailableListener.promote();
     }
 
     if (listener != NULL) {
-        CB_LOGV("actually calling onFrameAvailable");
-        listener->onFrameAvailable(item);
+        if (coalesce) {
+            CB_LOGV("actually calling onFramesAvailable, count=%zu", count);
+            listener->onFramesAvailable(item, count);
+        } else {
+            CB_LOGV("actually calling onFrameAvailable");
+            listener->onFrameAvailable(item);
+        }
     }
 }
 
@@ -199,6 +221,14 @@ void ConsumerBase::setFrameAvailableListener(
     mFrameAvailableListener = listener;
 }
 
+void ConsumerBase::setFrameAvailableCoalescing(bool enabled) {
+    CB_LOGV("setFrameAvailableCoalescing: enabled=%d", enabled);
+    Mutex::Autolock lock(mFrameAvailableMutex);
+    mFrameAvailableCoalescing = enabled;
+    mFrameCallbackPending = false;
+    mCoalescedFrameCount = 0;
+}
+
 status_t ConsumerBase::detachBuffer(int slot) {
     CB_LOGV("detachBuffer");
     Mutex::Autolock lock(mMutex);
@@ -301,6 +331,15 @@ status_t ConsumerBase::getOccupancyHistory(bool forceFlush,
     return mConsumer->getOccupancyHistory(forceFlush, outHistory);
 }
 
+status_t ConsumerBase::setAdaptiveBufferCountEnabled(bool enabled) {
+    Mutex::Autolock _l(mMutex);
+    if (mAbandoned) {
+        CB_LOGE("setAdaptiveBufferCountEnabled: ConsumerBase is abandoned!");
+        return NO_INIT;
+    }
+    return mConsumer->setAdaptiveBufferCountEnabled(enabled);
+}
+
 status_t ConsumerBase::discardFreeBuffers() {
     Mutex::Autolock _l(mMutex);
     if (mAbandoned) {
@@ -362,6 +401,13 @@ status_t ConsumerBase::acquireBufferLocked(BufferItem *item,
     mSlots[item->mSlot].mFrameNumber = item->mFrameNumber;
     mSlots[item->mSlot].mFence = item->mFence;
 
+    { // scope for the lock
+        // The consumer has woken up and is draining; re-arm the coalesced
+        // frame callback so the next queued buffer triggers a new wakeup.
+        Mutex::Autolock lock(mFrameAvailableMutex);
+        mFrameCallbackPending = false;
+    }
+
     CB_LOGV("acquireBufferLocked: -> slot=%d/%" PRIu64,
             item->mSlot, item->mFrameNumber);
 
@@ -35,7 +35,8 @@ CpuConsumer::CpuConsumer(const sp<IGraphicBufferConsumer>& bq,
         size_t maxLockedBuffers, bool controlledByApp) :
     ConsumerBase(bq, controlledByApp),
     mMaxLockedBuffers(maxLockedBuffers),
-    mCurrentLockedBuffers(0)
+    mCurrentLockedBuffers(0),
+    mPersistentMappingEnabled(false)
 {
     // Create tracking entries for locked buffers
     mAcquiredBuffers.insertAt(0, maxLockedBuffers);
@@ -87,10 +88,50 @@ static bool isPossiblyYUV(PixelFormat format) {
     }
 }
 
-status_t CpuConsumer::lockBufferItem(const BufferItem& item, LockedBuffer* outBuffer) const {
+status_t CpuConsumer::lockBufferItem(const BufferItem& item, LockedBuffer* outBuffer) {
+    PersistentMapping& mapping = mMappedSlots[item.mSlot];
+    PixelFormat format = item.mGraphicBuffer->getPixelFormat();
+
+    if (mPersistentMappingEnabled && mapping.mGraphicBuffer == item.mGraphicBuffer) {
+        // The buffer is still mapped from an earlier lock; wait out the
+        // producer's fence on the CPU and hand back the cached pointers.
+        if (item.mFence.get() != nullptr && item.mFence->isValid()) {
+            status_t err = item.mFence->waitForever("CpuConsumer::lockBufferItem");
+            if (err != OK) {
+                CC_LOGE("Fence wait for cached mapping failed: %s (%d)", strerror(-err), err);
+                return err;
+            }
+        }
+
+        outBuffer->data = mapping.mData;
+        outBuffer->stride = mapping.mStride;
+        outBuffer->dataCb = mapping.mDataCb;
+        outBuffer->dataCr = mapping.mDataCr;
+        outBuffer->chromaStride = mapping.mChromaStride;
+        outBuffer->chromaStep = mapping.mChromaStep;
+        outBuffer->flexFormat = mapping.mFlexFormat;
+
+        outBuffer->width = item.mGraphicBuffer->getWidth();
+        outBuffer->height = item.mGraphicBuffer->getHeight();
+        outBuffer->format = format;
+
+        outBuffer->crop = item.mCrop;
+        outBuffer->transform = item.mTransform;
+        outBuffer->scalingMode = item.mScalingMode;
+        outBuffer->timestamp = item.mTimestamp;
+        outBuffer->dataSpace = item.mDataSpace;
+        outBuffer->frameNumber = item.mFrameNumber;
+
+        return OK;
+    }
+
+    if (mPersistentMappingEnabled) {
+        // The slot was reallocated since the mapping was cached
+        dropPersistentMappingLocked(item.mSlot);
+    }
+
     android_ycbcr ycbcr = android_ycbcr();
 
-    PixelFormat format = item.mGraphicBuffer->getPixelFormat();
     PixelFormat flexFormat = format;
     if (isPossiblyYUV(format)) {
         int fenceFd = item.mFence.get() ? item.mFence->dup() : -1;
@@ -133,6 +174,19 @@ status_t CpuConsumer::lockBufferItem(const BufferItem& item, LockedBuffer* outBu
         outBuffer->chromaStep = 0;
     }
 
+    if (mPersistentMappingEnabled) {
+        // Keep the mapping for the next time this buffer comes around;
+        // unlockBuffer leaves the buffer locked while it is cached here.
+        mapping.mGraphicBuffer = item.mGraphicBuffer;
+        mapping.mData = outBuffer->data;
+        mapping.mStride = outBuffer->stride;
+        mapping.mDataCb = outBuffer->dataCb;
+        mapping.mDataCr = outBuffer->dataCr;
+        mapping.mChromaStride = outBuffer->chromaStride;
+        mapping.mChromaStep = outBuffer->chromaStep;
+        mapping.mFlexFormat = flexFormat;
+    }
+
     outBuffer->width = item.mGraphicBuffer->getWidth();
     outBuffer->height = item.mGraphicBuffer->getHeight();
     outBuffer->format = format;
@@ -208,15 +262,23 @@ status_t CpuConsumer::unlockBuffer(const LockedBuffer &nativeBuffer) {
 
     AcquiredBuffer& ab = mAcquiredBuffers.editItemAt(lockedIdx);
 
-    int fenceFd = -1;
-    status_t err = ab.mGraphicBuffer->unlockAsync(&fenceFd);
-    if (err != OK) {
-        CC_LOGE("%s: Unable to unlock graphic buffer %zd", __FUNCTION__,
-                lockedIdx);
-        return err;
+    // If the mapping is cached for reuse, skip the gralloc unlock and keep
+    // the buffer mapped. CPU reads are complete by the time the caller
+    // returns the buffer, so no release fence is needed either way.
+    sp<Fence> fence(Fence::NO_FENCE);
+    const bool mappingCached = mPersistentMappingEnabled &&
+            mMappedSlots[ab.mSlot].mGraphicBuffer == ab.mGraphicBuffer;
+    if (!mappingCached) {
+        int fenceFd = -1;
+        status_t err = ab.mGraphicBuffer->unlockAsync(&fenceFd);
+        if (err != OK) {
+            CC_LOGE("%s: Unable to unlock graphic buffer %zd", __FUNCTION__,
+                    lockedIdx);
+            return err;
+        }
+        fence = fenceFd >= 0 ? new Fence(fenceFd) : Fence::NO_FENCE;
     }
 
-    sp<Fence> fence(fenceFd >= 0 ? new Fence(fenceFd) : Fence::NO_FENCE);
     addReleaseFenceLocked(ab.mSlot, ab.mGraphicBuffer, fence);
     releaseBufferLocked(ab.mSlot, ab.mGraphicBuffer);
 
@@ -227,4 +289,41 @@ status_t CpuConsumer::unlockBuffer(const LockedBuffer &nativeBuffer) {
     return OK;
 }
 
+status_t CpuConsumer::setPersistentMappingEnabled(bool enabled) {
+    Mutex::Autolock _l(mMutex);
+    if (mPersistentMappingEnabled && !enabled) {
+        // Unmap everything that isn't handed out to the user; those buffers
+        // are unlocked on their unlockBuffer call instead.
+        for (int i = 0; i < BufferQueueDefs::NUM_BUFFER_SLOTS; i++) {
+            dropPersistentMappingLocked(i);
+        }
+    }
+    mPersistentMappingEnabled = enabled;
+    return OK;
+}
+
+void CpuConsumer::dropPersistentMappingLocked(int slotIndex) {
+    PersistentMapping& mapping = mMappedSlots[slotIndex];
+    if (mapping.mGraphicBuffer == nullptr) {
+        return;
+    }
+    // If the user still holds this mapping, clearing the cache entry is
+    // enough: their unlockBuffer call misses the cache and performs the real
+    // unlock.
+    uintptr_t id = reinterpret_cast<uintptr_t>(mapping.mData);
+    if (findAcquiredBufferLocked(id) == mMaxLockedBuffers) {
+        status_t err = mapping.mGraphicBuffer->unlock();
+        if (err != OK) {
+            CC_LOGE("%s: Unable to unlock graphic buffer in slot %d",
+                    __FUNCTION__, slotIndex);
+        }
+    }
+    mapping.reset();
+}
+
+void CpuConsumer::freeBufferLocked(int slotIndex) {
+    dropPersistentMappingLocked(slotIndex);
+    ConsumerBase::freeBufferLocked(slotIndex);
+}
+
 } // namespace android
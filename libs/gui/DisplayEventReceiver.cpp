@@ -32,13 +32,17 @@ namespace android {
 
 // ---------------------------------------------------------------------------
 
-DisplayEventReceiver::DisplayEventReceiver(ISurfaceComposer::VsyncSource vsyncSource) {
+DisplayEventReceiver::DisplayEventReceiver(ISurfaceComposer::VsyncSource vsyncSource,
+        size_t eventQueueDepth, uint32_t vsyncRate, uint32_t vsyncPhase) {
     sp<ISurfaceComposer> sf(ComposerService::getComposerService());
     if (sf != NULL) {
-        mEventConnection = sf->createDisplayEventConnection(vsyncSource);
+        mEventConnection = sf->createDisplayEventConnection(vsyncSource, vsyncRate, vsyncPhase);
         if (mEventConnection != NULL) {
             mDataChannel = std::make_unique<gui::BitTube>();
             mEventConnection->stealReceiveChannel(mDataChannel.get());
+            if (eventQueueDepth > 0) {
+                mDataChannel->setReceiveBufferSize(eventQueueDepth * sizeof(Event));
+            }
         }
     }
 }
@@ -87,13 +91,15 @@ ssize_t DisplayEventReceiver::getEvents(DisplayEventReceiver::Event* events,
 ssize_t DisplayEventReceiver::getEvents(gui::BitTube* dataChannel,
         Event* events, size_t count)
 {
-    return gui::BitTube::recvObjects(dataChannel, events, count);
+    // Events are sent one per message, so a batched receive drains every
+    // pending event (up to count) in a single syscall.
+    return gui::BitTube::recvObjectsBatch(dataChannel, events, count);
 }
 
 ssize_t DisplayEventReceiver::sendEvents(gui::BitTube* dataChannel,
         Event const* events, size_t count)
 {
-    return gui::BitTube::sendObjects(dataChannel, events, count);
+    return gui::BitTube::sendObjectsBatch(dataChannel, events, count);
 }
 
 // ---------------------------------------------------------------------------
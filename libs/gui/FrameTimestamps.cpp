@@ -167,6 +167,8 @@ struct FrameNumberEqual {
 
 }  // namespace
 
+FrameEventHistory::FrameEventHistory() : mFrames(DEFAULT_FRAME_HISTORY) {}
+
 FrameEventHistory::~FrameEventHistory() = default;
 
 FrameEvents* FrameEventHistory::getFrame(uint64_t frameNumber) {
@@ -268,10 +270,14 @@ void ProducerFrameEventHistory::applyDelta(
     mCompositorTiming = delta.mCompositorTiming;
 
     for (auto& d : delta.mDeltas) {
-        // Avoid out-of-bounds access.
-        if (CC_UNLIKELY(d.mIndex >= mFrames.size())) {
-            ALOGE("applyDelta: Bad index.");
-            return;
+        // The consumer may be using a deeper ring than we started with, so
+        // grow to match it. Indices above the shared cap are invalid.
+        if (d.mIndex >= mFrames.size()) {
+            if (CC_UNLIKELY(d.mIndex >= MAX_FRAME_HISTORY)) {
+                ALOGE("applyDelta: Bad index.");
+                return;
+            }
+            mFrames.resize(d.mIndex + 1);
         }
 
         FrameEvents& frame = mFrames[d.mIndex];
@@ -348,8 +354,24 @@ std::shared_ptr<FenceTime> ProducerFrameEventHistory::createFenceTime(
 // ConsumerFrameEventHistory
 // ============================================================================
 
+ConsumerFrameEventHistory::ConsumerFrameEventHistory()
+      : mFramesDirty(DEFAULT_FRAME_HISTORY) {}
+
 ConsumerFrameEventHistory::~ConsumerFrameEventHistory() = default;
 
+void ConsumerFrameEventHistory::resizeFrameHistory(size_t depth) {
+    if (depth < 1) {
+        depth = 1;
+    } else if (depth > MAX_FRAME_HISTORY) {
+        depth = MAX_FRAME_HISTORY;
+    }
+    mFrames.assign(depth, FrameEvents());
+    mFramesDirty.assign(depth, FrameEventDirtyFields());
+    mQueueOffset = 0;
+    mCompositionOffset = 0;
+    mReleaseOffset = 0;
+}
+
 void ConsumerFrameEventHistory::onDisconnect() {
     mCurrentConnectId++;
     mProducerWantsEvents = false;
@@ -445,7 +467,7 @@ void ConsumerFrameEventHistory::addRelease(uint64_t frameNumber,
 
 void ConsumerFrameEventHistory::getFrameDelta(
         FrameEventHistoryDelta* delta,
-        const std::array<FrameEvents, MAX_FRAME_HISTORY>::iterator& frame) {
+        const std::vector<FrameEvents>::iterator& frame) {
     mProducerWantsEvents = true;
     size_t i = static_cast<size_t>(std::distance(mFrames.begin(), frame));
     if (mFramesDirty[i].anyDirty()) {
@@ -482,6 +504,75 @@ void ConsumerFrameEventHistory::getAndResetDelta(
 // FrameEventsDelta
 // ============================================================================
 
+namespace {
+
+// Helpers for the packed FrameEventsDelta encoding. Values are LEB128
+// varints, 7 bits per byte with the low bits first; signed values are
+// zigzag-mapped first so small negative values stay small.
+
+size_t varintSize(uint64_t value) {
+    size_t size = 1;
+    while (value >= 0x80) {
+        value >>= 7;
+        size++;
+    }
+    return size;
+}
+
+void writeVarint(void*& buffer, size_t& size, uint64_t value) {
+    while (value >= 0x80) {
+        FlattenableUtils::write(
+                buffer, size, static_cast<uint8_t>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    FlattenableUtils::write(buffer, size, static_cast<uint8_t>(value));
+}
+
+status_t readVarint(void const*& buffer, size_t& size, uint64_t* value) {
+    *value = 0;
+    for (unsigned int shift = 0; shift < 64; shift += 7) {
+        if (size < 1) {
+            return NO_MEMORY;
+        }
+        uint8_t byte = 0;
+        FlattenableUtils::read(buffer, size, byte);
+        *value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            return NO_ERROR;
+        }
+    }
+    return BAD_VALUE;
+}
+
+uint64_t zigzagEncode(int64_t value) {
+    return (static_cast<uint64_t>(value) << 1) ^
+            static_cast<uint64_t>(value >> 63);
+}
+
+int64_t zigzagDecode(uint64_t value) {
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+// Timestamps other than the posted time are encoded as offsets from the
+// posted time, which the frame's other events trail by no more than a few
+// frame periods. Zero means the event is still pending; anything else is
+// the zigzag-encoded offset plus one.
+uint64_t encodeTimestamp(nsecs_t timestamp, nsecs_t postedTime) {
+    if (!FrameEvents::isValidTimestamp(timestamp)) {
+        return 0;
+    }
+    return zigzagEncode(timestamp - postedTime) + 1;
+}
+
+nsecs_t decodeTimestamp(uint64_t encoded, nsecs_t postedTime) {
+    if (encoded == 0) {
+        return FrameEvents::TIMESTAMP_PENDING;
+    }
+    return zigzagDecode(encoded - 1) + postedTime;
+}
+
+}  // namespace
+
 FrameEventsDelta::FrameEventsDelta(
         size_t index,
         const FrameEvents& frameTimestamps,
@@ -510,22 +601,25 @@ FrameEventsDelta::FrameEventsDelta(
 }
 
 constexpr size_t FrameEventsDelta::minFlattenedSize() {
-    return sizeof(FrameEventsDelta::mFrameNumber) +
-            sizeof(uint16_t) + // mIndex
-            sizeof(uint8_t) + // mAddPostCompositeCalled
-            sizeof(uint8_t) + // mAddReleaseCalled
-            sizeof(FrameEventsDelta::mPostedTime) +
-            sizeof(FrameEventsDelta::mRequestedPresentTime) +
-            sizeof(FrameEventsDelta::mLatchTime) +
-            sizeof(FrameEventsDelta::mFirstRefreshStartTime) +
-            sizeof(FrameEventsDelta::mLastRefreshStartTime) +
-            sizeof(FrameEventsDelta::mDequeueReadyTime);
+    return sizeof(uint16_t) + // mIndex
+            sizeof(uint8_t) + // mAddPostCompositeCalled / mAddReleaseCalled
+            1 + // mFrameNumber (varint)
+            1 + // mPostedTime (varint)
+            5; // remaining timestamps (varint, one byte each when pending)
 }
 
 // Flattenable implementation
 size_t FrameEventsDelta::getFlattenedSize() const {
     auto fences = allFences(this);
-    return minFlattenedSize() +
+    return sizeof(uint16_t) + // mIndex
+            sizeof(uint8_t) + // mAddPostCompositeCalled / mAddReleaseCalled
+            varintSize(mFrameNumber) +
+            varintSize(zigzagEncode(mPostedTime)) +
+            varintSize(encodeTimestamp(mRequestedPresentTime, mPostedTime)) +
+            varintSize(encodeTimestamp(mLatchTime, mPostedTime)) +
+            varintSize(encodeTimestamp(mFirstRefreshStartTime, mPostedTime)) +
+            varintSize(encodeTimestamp(mLastRefreshStartTime, mPostedTime)) +
+            varintSize(encodeTimestamp(mDequeueReadyTime, mPostedTime)) +
             std::accumulate(fences.begin(), fences.end(), size_t(0),
                     [](size_t a, const FenceTime::Snapshot* fence) {
                             return a + fence->getFlattenedSize();
@@ -551,21 +645,23 @@ status_t FrameEventsDelta::flatten(void*& buffer, size_t& size, int*& fds,
         return BAD_VALUE;
     }
 
-    FlattenableUtils::write(buffer, size, mFrameNumber);
-
-    // These are static_cast to uint16_t/uint8_t for alignment.
+    // The index and flags are fixed width so a bad delta can be rejected
+    // before any varint decoding; everything else is varint-packed.
     FlattenableUtils::write(buffer, size, static_cast<uint16_t>(mIndex));
-    FlattenableUtils::write(
-            buffer, size, static_cast<uint8_t>(mAddPostCompositeCalled));
-    FlattenableUtils::write(
-            buffer, size, static_cast<uint8_t>(mAddReleaseCalled));
-
-    FlattenableUtils::write(buffer, size, mPostedTime);
-    FlattenableUtils::write(buffer, size, mRequestedPresentTime);
-    FlattenableUtils::write(buffer, size, mLatchTime);
-    FlattenableUtils::write(buffer, size, mFirstRefreshStartTime);
-    FlattenableUtils::write(buffer, size, mLastRefreshStartTime);
-    FlattenableUtils::write(buffer, size, mDequeueReadyTime);
+    uint8_t flags = (mAddPostCompositeCalled ? 0x1 : 0x0) |
+            (mAddReleaseCalled ? 0x2 : 0x0);
+    FlattenableUtils::write(buffer, size, flags);
+
+    writeVarint(buffer, size, mFrameNumber);
+    writeVarint(buffer, size, zigzagEncode(mPostedTime));
+    writeVarint(buffer, size,
+            encodeTimestamp(mRequestedPresentTime, mPostedTime));
+    writeVarint(buffer, size, encodeTimestamp(mLatchTime, mPostedTime));
+    writeVarint(buffer, size,
+            encodeTimestamp(mFirstRefreshStartTime, mPostedTime));
+    writeVarint(buffer, size,
+            encodeTimestamp(mLastRefreshStartTime, mPostedTime));
+    writeVarint(buffer, size, encodeTimestamp(mDequeueReadyTime, mPostedTime));
 
     // Fences
     for (auto fence : allFences(this)) {
@@ -583,31 +679,42 @@ status_t FrameEventsDelta::unflatten(void const*& buffer, size_t& size,
         return NO_MEMORY;
     }
 
-    FlattenableUtils::read(buffer, size, mFrameNumber);
-
-    // These were written as uint16_t/uint8_t for alignment.
     uint16_t temp16 = 0;
     FlattenableUtils::read(buffer, size, temp16);
     mIndex = temp16;
     if (mIndex >= FrameEventHistory::MAX_FRAME_HISTORY) {
         return BAD_VALUE;
     }
-    uint8_t temp8 = 0;
-    FlattenableUtils::read(buffer, size, temp8);
-    mAddPostCompositeCalled = static_cast<bool>(temp8);
-    FlattenableUtils::read(buffer, size, temp8);
-    mAddReleaseCalled = static_cast<bool>(temp8);
+    uint8_t flags = 0;
+    FlattenableUtils::read(buffer, size, flags);
+    mAddPostCompositeCalled = (flags & 0x1) != 0;
+    mAddReleaseCalled = (flags & 0x2) != 0;
+
+    status_t status = readVarint(buffer, size, &mFrameNumber);
+    if (status != NO_ERROR) {
+        return status;
+    }
 
-    FlattenableUtils::read(buffer, size, mPostedTime);
-    FlattenableUtils::read(buffer, size, mRequestedPresentTime);
-    FlattenableUtils::read(buffer, size, mLatchTime);
-    FlattenableUtils::read(buffer, size, mFirstRefreshStartTime);
-    FlattenableUtils::read(buffer, size, mLastRefreshStartTime);
-    FlattenableUtils::read(buffer, size, mDequeueReadyTime);
+    uint64_t encoded = 0;
+    if ((status = readVarint(buffer, size, &encoded)) != NO_ERROR) {
+        return status;
+    }
+    mPostedTime = zigzagDecode(encoded);
+
+    nsecs_t* const timestamps[] = {
+        &mRequestedPresentTime, &mLatchTime, &mFirstRefreshStartTime,
+        &mLastRefreshStartTime, &mDequeueReadyTime,
+    };
+    for (nsecs_t* timestamp : timestamps) {
+        if ((status = readVarint(buffer, size, &encoded)) != NO_ERROR) {
+            return status;
+        }
+        *timestamp = decodeTimestamp(encoded, mPostedTime);
+    }
 
     // Fences
     for (auto fence : allFences(this)) {
-        status_t status = fence->unflatten(buffer, size, fds, count);
+        status = fence->unflatten(buffer, size, fds, count);
         if (status != NO_ERROR) {
             return status;
         }
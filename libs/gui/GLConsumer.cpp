@@ -145,7 +145,12 @@ GLConsumer::GLConsumer(const sp<IGraphicBufferConsumer>& bq, uint32_t tex,
     mEglDisplay(EGL_NO_DISPLAY),
     mEglContext(EGL_NO_CONTEXT),
     mCurrentTexture(BufferQueue::INVALID_BUFFER_SLOT),
-    mAttached(true)
+    mAttached(true),
+    mStrictGLFenceWait(false),
+    mCpuFenceWaitCount(0),
+    mImagePrecachingEnabled(false),
+    mHasPrecachedItem(false),
+    mPrecacheInProgress(false)
 {
     GLC_LOGV("GLConsumer");
 
@@ -174,7 +179,12 @@ GLConsumer::GLConsumer(const sp<IGraphicBufferConsumer>& bq, uint32_t texTarget,
     mEglDisplay(EGL_NO_DISPLAY),
     mEglContext(EGL_NO_CONTEXT),
     mCurrentTexture(BufferQueue::INVALID_BUFFER_SLOT),
-    mAttached(false)
+    mAttached(false),
+    mStrictGLFenceWait(false),
+    mCpuFenceWaitCount(0),
+    mImagePrecachingEnabled(false),
+    mHasPrecachedItem(false),
+    mPrecacheInProgress(false)
 {
     GLC_LOGV("GLConsumer");
 
@@ -184,6 +194,22 @@ GLConsumer::GLConsumer(const sp<IGraphicBufferConsumer>& bq, uint32_t texTarget,
     mConsumer->setConsumerUsageBits(DEFAULT_USAGE_FLAGS);
 }
 
+GLConsumer::~GLConsumer() {
+    GLC_LOGV("~GLConsumer");
+
+    sp<ImagePrecacheThread> thread;
+    { // scope for the lock
+        Mutex::Autolock lock(mMutex);
+        thread = mImagePrecacheThread;
+        mImagePrecacheThread.clear();
+    }
+    if (thread != NULL) {
+        // Join the worker before any members are destroyed; it holds a bare
+        // pointer back to this GLConsumer.
+        thread->shutdown();
+    }
+}
+
 status_t GLConsumer::setDefaultBufferSize(uint32_t w, uint32_t h)
 {
     Mutex::Autolock lock(mMutex);
@@ -214,21 +240,37 @@ status_t GLConsumer::updateTexImage() {
 
     BufferItem item;
 
-    // Acquire the next buffer.
-    // In asynchronous mode the list is guaranteed to be one buffer
-    // deep, while in synchronous mode we use the oldest buffer.
-    err = acquireBufferLocked(&item, 0);
-    if (err != NO_ERROR) {
-        if (err == BufferQueue::NO_BUFFER_AVAILABLE) {
-            // We always bind the texture even if we don't update its contents.
-            GLC_LOGV("updateTexImage: no buffers were available");
-            glBindTexture(mTexTarget, mTexName);
-            err = NO_ERROR;
-        } else {
-            GLC_LOGE("updateTexImage: acquire failed: %s (%d)",
-                strerror(-err), err);
+    // If the precache thread is mid-handoff, wait for it to finish creating
+    // the EGLImage rather than racing it for the buffer.
+    while (mPrecacheInProgress) {
+        mPrecacheCondition.wait(mMutex);
+    }
+
+    if (mHasPrecachedItem) {
+        // The precache thread already acquired the next buffer and created
+        // its EGLImage; it was acquired before anything still in the queue,
+        // so consuming it here preserves ordering.
+        item = mPrecachedItem;
+        mPrecachedItem = BufferItem();
+        mHasPrecachedItem = false;
+    } else {
+        // Acquire the next buffer.
+        // In asynchronous mode the list is guaranteed to be one buffer
+        // deep, while in synchronous mode we use the oldest buffer.
+        err = acquireBufferLocked(&item, 0);
+        if (err != NO_ERROR) {
+            if (err == BufferQueue::NO_BUFFER_AVAILABLE) {
+                // We always bind the texture even if we don't update its
+                // contents.
+                GLC_LOGV("updateTexImage: no buffers were available");
+                glBindTexture(mTexTarget, mTexName);
+                err = NO_ERROR;
+            } else {
+                GLC_LOGE("updateTexImage: acquire failed: %s (%d)",
+                    strerror(-err), err);
+            }
+            return err;
         }
-        return err;
     }
 
     // Release the previous buffer.
@@ -669,6 +711,155 @@ status_t GLConsumer::attachToContext(uint32_t tex) {
     return OK;
 }
 
+status_t GLConsumer::setImagePrecachingEnabled(bool enabled) {
+    GLC_LOGV("setImagePrecachingEnabled: enabled=%d", enabled);
+
+    sp<ImagePrecacheThread> oldThread;
+    { // scope for the lock
+        Mutex::Autolock lock(mMutex);
+        if (mAbandoned) {
+            GLC_LOGE("setImagePrecachingEnabled: GLConsumer is abandoned!");
+            return NO_INIT;
+        }
+        if (enabled == mImagePrecachingEnabled) {
+            return NO_ERROR;
+        }
+        mImagePrecachingEnabled = enabled;
+
+        if (enabled) {
+            mImagePrecacheThread = new ImagePrecacheThread(this);
+            status_t err = mImagePrecacheThread->run("GLConsumer");
+            if (err != NO_ERROR) {
+                GLC_LOGE("setImagePrecachingEnabled: failed to start worker: "
+                        "%s (%d)", strerror(-err), err);
+                mImagePrecacheThread.clear();
+                mImagePrecachingEnabled = false;
+                return err;
+            }
+            return NO_ERROR;
+        }
+
+        oldThread = mImagePrecacheThread;
+        mImagePrecacheThread.clear();
+    }
+
+    // Stop the worker without holding mMutex, since it may currently be
+    // waiting for it. Any buffer it already pre-acquired stays published and
+    // is consumed by the next updateTexImage call.
+    if (oldThread != NULL) {
+        oldThread->shutdown();
+    }
+    return NO_ERROR;
+}
+
+void GLConsumer::onFrameAvailable(const BufferItem& item) {
+    sp<ImagePrecacheThread> thread;
+    { // scope for the lock
+        Mutex::Autolock lock(mMutex);
+        thread = mImagePrecacheThread;
+    }
+    if (thread != NULL) {
+        thread->signalWork();
+    }
+
+    ConsumerBase::onFrameAvailable(item);
+}
+
+void GLConsumer::precacheNextBuffer() {
+    sp<EglImage> image;
+    Rect crop;
+    EGLDisplay display = EGL_NO_DISPLAY;
+    { // scope for the lock
+        Mutex::Autolock lock(mMutex);
+        if (mAbandoned || !mImagePrecachingEnabled || !mAttached ||
+                mEglDisplay == EGL_NO_DISPLAY) {
+            // Nothing useful can be done before the GL thread has latched a
+            // display; updateTexImage will acquire as usual.
+            return;
+        }
+        if (mHasPrecachedItem || mPrecacheInProgress) {
+            // Only one buffer is pre-acquired at a time; with the default
+            // maxAcquiredBufferCount of one a second acquire would fail
+            // anyway.
+            return;
+        }
+
+        BufferItem item;
+        status_t err = acquireBufferLocked(&item, 0);
+        if (err != NO_ERROR) {
+            // NO_BUFFER_AVAILABLE just means updateTexImage got there first.
+            if (err != BufferQueue::NO_BUFFER_AVAILABLE) {
+                GLC_LOGE("precacheNextBuffer: acquire failed: %s (%d)",
+                        strerror(-err), err);
+            }
+            return;
+        }
+
+        mPrecachedItem = item;
+        mPrecacheInProgress = true;
+        image = mEglSlots[item.mSlot].mEglImage;
+        crop = item.mCrop;
+        display = mEglDisplay;
+    }
+
+    // Create the EGLImage without holding mMutex. eglCreateImageKHR needs no
+    // current GL context and can take a while for a newly allocated buffer,
+    // and updateTexImage must not block behind it on the lock.
+    status_t err = image->createIfNeeded(display, crop);
+    if (err != NO_ERROR) {
+        // This is best effort: updateAndReleaseLocked will retry the
+        // creation and deal with the failure.
+        GLC_LOGW("precacheNextBuffer: image creation failed, deferring to "
+                "updateTexImage");
+    }
+
+    { // scope for the lock
+        Mutex::Autolock lock(mMutex);
+        mPrecacheInProgress = false;
+        if (!mAbandoned) {
+            mHasPrecachedItem = true;
+        } else {
+            // abandonLocked already dropped its buffer references; drop ours.
+            mPrecachedItem = BufferItem();
+        }
+        mPrecacheCondition.broadcast();
+    }
+}
+
+GLConsumer::ImagePrecacheThread::ImagePrecacheThread(GLConsumer* consumer)
+      : mConsumer(consumer), mWorkMutex(), mWorkCondition(),
+        mWorkPending(false), mShutdown(false) {}
+
+void GLConsumer::ImagePrecacheThread::signalWork() {
+    Mutex::Autolock lock(mWorkMutex);
+    mWorkPending = true;
+    mWorkCondition.signal();
+}
+
+void GLConsumer::ImagePrecacheThread::shutdown() {
+    {
+        Mutex::Autolock lock(mWorkMutex);
+        mShutdown = true;
+        mWorkCondition.signal();
+    }
+    requestExitAndWait();
+}
+
+bool GLConsumer::ImagePrecacheThread::threadLoop() {
+    {
+        Mutex::Autolock lock(mWorkMutex);
+        while (!mWorkPending && !mShutdown) {
+            mWorkCondition.wait(mWorkMutex);
+        }
+        if (mShutdown) {
+            return false;
+        }
+        mWorkPending = false;
+    }
+
+    mConsumer->precacheNextBuffer();
+    return true;
+}
 
 status_t GLConsumer::syncForReleaseLocked(EGLDisplay dpy) {
     GLC_LOGV("syncForReleaseLocked");
@@ -743,6 +934,16 @@ void GLConsumer::getTransformMatrix(float mtx[16]) {
     memcpy(mtx, mCurrentTransformMatrix, sizeof(mCurrentTransformMatrix));
 }
 
+void GLConsumer::setStrictGLFenceWait(bool strict) {
+    Mutex::Autolock lock(mMutex);
+    mStrictGLFenceWait = strict;
+}
+
+uint64_t GLConsumer::getCpuFenceWaitCount() const {
+    Mutex::Autolock lock(mMutex);
+    return mCpuFenceWaitCount;
+}
+
 void GLConsumer::setFilteringEnabled(bool enabled) {
     Mutex::Autolock lock(mMutex);
     if (mAbandoned) {
@@ -1017,6 +1218,13 @@ status_t GLConsumer::doGLFenceWaitLocked() const {
                 return UNKNOWN_ERROR;
             }
         } else {
+            mCpuFenceWaitCount++;
+            if (mStrictGLFenceWait) {
+                GLC_LOGE("doGLFenceWait: no GPU-side fence wait available, "
+                        "refusing to block the CPU in strict mode");
+                return INVALID_OPERATION;
+            }
+            ATRACE_NAME("GLConsumer: CPU fence wait");
             status_t err = mCurrentFence->waitForever(
                     "GLConsumer::doGLFenceWaitLocked");
             if (err != NO_ERROR) {
@@ -1040,6 +1248,10 @@ void GLConsumer::freeBufferLocked(int slotIndex) {
 
 void GLConsumer::abandonLocked() {
     GLC_LOGV("abandonLocked");
+    if (mHasPrecachedItem) {
+        mPrecachedItem = BufferItem();
+        mHasPrecachedItem = false;
+    }
     mCurrentTextureImage.clear();
     ConsumerBase::abandonLocked();
 }
@@ -1052,10 +1264,11 @@ void GLConsumer::dumpLocked(String8& result, const char* prefix) const
 {
     result.appendFormat(
        "%smTexName=%d mCurrentTexture=%d\n"
-       "%smCurrentCrop=[%d,%d,%d,%d] mCurrentTransform=%#x\n",
+       "%smCurrentCrop=[%d,%d,%d,%d] mCurrentTransform=%#x\n"
+       "%smCpuFenceWaitCount=%" PRIu64 " mStrictGLFenceWait=%d\n",
        prefix, mTexName, mCurrentTexture, prefix, mCurrentCrop.left,
        mCurrentCrop.top, mCurrentCrop.right, mCurrentCrop.bottom,
-       mCurrentTransform);
+       mCurrentTransform, prefix, mCpuFenceWaitCount, mStrictGLFenceWait);
 
     ConsumerBase::dumpLocked(result, prefix);
 }
@@ -52,7 +52,10 @@ enum class Tag : uint32_t {
     GET_OCCUPANCY_HISTORY,
     DISCARD_FREE_BUFFERS,
     DUMP_STATE,
-    LAST = DUMP_STATE,
+    ACQUIRE_BUFFERS,
+    RELEASE_BUFFERS,
+    SET_ADAPTIVE_BUFFER_COUNT_ENABLED,
+    LAST = SET_ADAPTIVE_BUFFER_COUNT_ENABLED,
 };
 
 } // Anonymous namespace
@@ -70,6 +73,12 @@ public:
         return callRemote<Signature>(Tag::ACQUIRE_BUFFER, buffer, presentWhen, maxFrameNumber);
     }
 
+    status_t acquireBuffers(std::vector<BufferItem>* outBuffers, nsecs_t presentWhen,
+                            int maxBuffers) override {
+        using Signature = decltype(&IGraphicBufferConsumer::acquireBuffers);
+        return callRemote<Signature>(Tag::ACQUIRE_BUFFERS, outBuffers, presentWhen, maxBuffers);
+    }
+
     status_t detachBuffer(int slot) override {
         using Signature = decltype(&IGraphicBufferConsumer::detachBuffer);
         return callRemote<Signature>(Tag::DETACH_BUFFER, slot);
@@ -87,6 +96,11 @@ public:
         return callRemote<ReleaseBuffer>(Tag::RELEASE_BUFFER, buf, frameNumber, releaseFence);
     }
 
+    status_t releaseBuffers(const std::vector<BufferItem>& buffers) override {
+        using Signature = decltype(&IGraphicBufferConsumer::releaseBuffers);
+        return callRemote<Signature>(Tag::RELEASE_BUFFERS, buffers);
+    }
+
     status_t consumerConnect(const sp<IConsumerListener>& consumer, bool controlledByApp) override {
         using Signature = decltype(&IGraphicBufferConsumer::consumerConnect);
         return callRemote<Signature>(Tag::CONSUMER_CONNECT, consumer, controlledByApp);
@@ -158,6 +172,11 @@ public:
         return callRemote<Signature>(Tag::GET_OCCUPANCY_HISTORY, forceFlush, outHistory);
     }
 
+    status_t setAdaptiveBufferCountEnabled(bool enabled) override {
+        using Signature = decltype(&IGraphicBufferConsumer::setAdaptiveBufferCountEnabled);
+        return callRemote<Signature>(Tag::SET_ADAPTIVE_BUFFER_COUNT_ENABLED, enabled);
+    }
+
     status_t discardFreeBuffers() override {
         return callRemote<decltype(&IGraphicBufferConsumer::discardFreeBuffers)>(
                 Tag::DISCARD_FREE_BUFFERS);
@@ -175,6 +194,42 @@ BpGraphicBufferConsumer::~BpGraphicBufferConsumer() = default;
 
 IMPLEMENT_META_INTERFACE(GraphicBufferConsumer, "android.gui.IGraphicBufferConsumer");
 
+// Generic fallbacks for implementations that don't provide a native batch path. These still
+// save the per-buffer binder round trips when invoked through the Bp, since the loop runs on
+// the remote side.
+status_t IGraphicBufferConsumer::acquireBuffers(std::vector<BufferItem>* outBuffers,
+                                                nsecs_t presentWhen, int maxBuffers) {
+    if (outBuffers == nullptr || maxBuffers < 1) {
+        return BAD_VALUE;
+    }
+    outBuffers->clear();
+    while (static_cast<int>(outBuffers->size()) < maxBuffers) {
+        BufferItem item;
+        status_t result = acquireBuffer(&item, presentWhen);
+        if (result != NO_ERROR) {
+            // Report a failure only if nothing was acquired; otherwise return what we have
+            return outBuffers->empty() ? result : NO_ERROR;
+        }
+        outBuffers->push_back(item);
+    }
+    return NO_ERROR;
+}
+
+status_t IGraphicBufferConsumer::setAdaptiveBufferCountEnabled(bool /* enabled */) {
+    return INVALID_OPERATION;
+}
+
+status_t IGraphicBufferConsumer::releaseBuffers(const std::vector<BufferItem>& buffers) {
+    status_t result = NO_ERROR;
+    for (const BufferItem& item : buffers) {
+        status_t err = releaseHelper(item.mSlot, item.mFrameNumber, item.mFence);
+        if (err != NO_ERROR && result == NO_ERROR) {
+            result = err;
+        }
+    }
+    return result;
+}
+
 status_t BnGraphicBufferConsumer::onTransact(uint32_t code, const Parcel& data, Parcel* reply,
                                              uint32_t flags) {
     if (code < IBinder::FIRST_CALL_TRANSACTION || code > static_cast<uint32_t>(Tag::LAST)) {
@@ -224,6 +279,13 @@ status_t BnGraphicBufferConsumer::onTransact(uint32_t code, const Parcel& data,
             using Signature = status_t (IGraphicBufferConsumer::*)(const String8&, String8*) const;
             return callLocal<Signature>(data, reply, &IGraphicBufferConsumer::dumpState);
         }
+        case Tag::ACQUIRE_BUFFERS:
+            return callLocal(data, reply, &IGraphicBufferConsumer::acquireBuffers);
+        case Tag::RELEASE_BUFFERS:
+            return callLocal(data, reply, &IGraphicBufferConsumer::releaseBuffers);
+        case Tag::SET_ADAPTIVE_BUFFER_COUNT_ENABLED:
+            return callLocal(data, reply,
+                             &IGraphicBufferConsumer::setAdaptiveBufferCountEnabled);
     }
 }
 
@@ -67,6 +67,7 @@ enum {
     GET_FRAME_TIMESTAMPS,
     GET_UNIQUE_ID,
     GET_CONSUMER_USAGE,
+    QUEUE_BUFFER_ASYNC,
 };
 
 class BpGraphicBufferProducer : public BpInterface<IGraphicBufferProducer>
@@ -271,6 +272,17 @@ public:
         return result;
     }
 
+    virtual status_t queueBufferAsync(int buf, const QueueBufferInput& input) {
+        Parcel data, reply;
+
+        data.writeInterfaceToken(IGraphicBufferProducer::getInterfaceDescriptor());
+        data.writeInt32(buf);
+        data.write(input);
+
+        return remote()->transact(QUEUE_BUFFER_ASYNC, data, &reply,
+                IBinder::FLAG_ONEWAY);
+    }
+
     virtual status_t cancelBuffer(int buf, const sp<Fence>& fence) {
         Parcel data, reply;
         data.writeInterfaceToken(IGraphicBufferProducer::getInterfaceDescriptor());
@@ -832,6 +844,17 @@ status_t BnGraphicBufferProducer::onTransact(
 
             return NO_ERROR;
         }
+        case QUEUE_BUFFER_ASYNC: {
+            CHECK_INTERFACE(IGraphicBufferProducer, data, reply);
+
+            int buf = data.readInt32();
+            QueueBufferInput input(data);
+            status_t result = queueBufferAsync(buf, input);
+            // Oneway transaction; errors are only visible in the log.
+            ALOGE_IF(result != NO_ERROR, "queueBufferAsync: failed: %d", result);
+
+            return NO_ERROR;
+        }
         case CANCEL_BUFFER: {
             CHECK_INTERFACE(IGraphicBufferProducer, data, reply);
             int buf = data.readInt32();
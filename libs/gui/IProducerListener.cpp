@@ -23,6 +23,7 @@ namespace android {
 enum {
     ON_BUFFER_RELEASED = IBinder::FIRST_CALL_TRANSACTION,
     NEEDS_RELEASE_NOTIFY,
+    ON_QUEUE_BUFFER_OUTPUT_CHANGED,
 };
 
 class BpProducerListener : public BpInterface<IProducerListener>
@@ -55,6 +56,18 @@ public:
         }
         return result;
     }
+
+    virtual void onQueueBufferOutputChanged(uint32_t width, uint32_t height,
+            uint32_t transformHint, uint32_t numPendingBuffers) {
+        Parcel data, reply;
+        data.writeInterfaceToken(IProducerListener::getInterfaceDescriptor());
+        data.writeUint32(width);
+        data.writeUint32(height);
+        data.writeUint32(transformHint);
+        data.writeUint32(numPendingBuffers);
+        remote()->transact(ON_QUEUE_BUFFER_OUTPUT_CHANGED, data, &reply,
+                IBinder::FLAG_ONEWAY);
+    }
 };
 
 // Out-of-line virtual method definition to trigger vtable emission in this
@@ -74,6 +87,16 @@ status_t BnProducerListener::onTransact(uint32_t code, const Parcel& data,
             CHECK_INTERFACE(IProducerListener, data, reply);
             reply->writeBool(needsReleaseNotify());
             return NO_ERROR;
+        case ON_QUEUE_BUFFER_OUTPUT_CHANGED: {
+            CHECK_INTERFACE(IProducerListener, data, reply);
+            uint32_t width = data.readUint32();
+            uint32_t height = data.readUint32();
+            uint32_t transformHint = data.readUint32();
+            uint32_t numPendingBuffers = data.readUint32();
+            onQueueBufferOutputChanged(width, height, transformHint,
+                    numPendingBuffers);
+            return NO_ERROR;
+        }
     }
     return BBinder::onTransact(code, data, reply, flags);
 }
@@ -237,7 +237,8 @@ public:
         return NO_ERROR;
     }
 
-    virtual sp<IDisplayEventConnection> createDisplayEventConnection(VsyncSource vsyncSource)
+    virtual sp<IDisplayEventConnection> createDisplayEventConnection(VsyncSource vsyncSource,
+            uint32_t vsyncRate, uint32_t vsyncPhase)
     {
         Parcel data, reply;
         sp<IDisplayEventConnection> result;
@@ -247,6 +248,8 @@ public:
             return result;
         }
         data.writeInt32(static_cast<int32_t>(vsyncSource));
+        data.writeUint32(vsyncRate);
+        data.writeUint32(vsyncPhase);
         err = remote()->transact(
                 BnSurfaceComposer::CREATE_DISPLAY_EVENT_CONNECTION,
                 data, &reply);
@@ -699,8 +702,12 @@ status_t BnSurfaceComposer::onTransact(
         }
         case CREATE_DISPLAY_EVENT_CONNECTION: {
             CHECK_INTERFACE(ISurfaceComposer, data, reply);
-            sp<IDisplayEventConnection> connection(createDisplayEventConnection(
-                    static_cast<ISurfaceComposer::VsyncSource>(data.readInt32())));
+            ISurfaceComposer::VsyncSource vsyncSource =
+                    static_cast<ISurfaceComposer::VsyncSource>(data.readInt32());
+            uint32_t vsyncRate = data.readUint32();
+            uint32_t vsyncPhase = data.readUint32();
+            sp<IDisplayEventConnection> connection(
+                    createDisplayEventConnection(vsyncSource, vsyncRate, vsyncPhase));
             reply->writeStrongBinder(IInterface::asBinder(connection));
             return NO_ERROR;
         }
@@ -21,6 +21,7 @@
 
 #include <gui/IGraphicBufferProducer.h>
 
+#include <binder/Parcel.h>
 #include <binder/SafeInterface.h>
 
 #include <ui/FrameStats.h>
@@ -34,11 +35,72 @@ enum class Tag : uint32_t {
     DESTROY_SURFACE,
     CLEAR_LAYER_FRAME_STATS,
     GET_LAYER_FRAME_STATS,
-    LAST = GET_LAYER_FRAME_STATS,
+    CREATE_SURFACES,
+    LAST = CREATE_SURFACES,
 };
 
 } // Anonymous namespace
 
+status_t ISurfaceComposerClient::SurfaceDescriptor::writeToParcel(Parcel* parcel) const {
+    status_t status = parcel->writeString8(name);
+    if (status != NO_ERROR) return status;
+    status = parcel->writeUint32(width);
+    if (status != NO_ERROR) return status;
+    status = parcel->writeUint32(height);
+    if (status != NO_ERROR) return status;
+    status = parcel->writeInt32(static_cast<int32_t>(format));
+    if (status != NO_ERROR) return status;
+    status = parcel->writeUint32(flags);
+    if (status != NO_ERROR) return status;
+    status = parcel->writeStrongBinder(parent);
+    if (status != NO_ERROR) return status;
+    status = parcel->writeInt32(windowType);
+    if (status != NO_ERROR) return status;
+    return parcel->writeInt32(ownerUid);
+}
+
+status_t ISurfaceComposerClient::SurfaceDescriptor::readFromParcel(const Parcel* parcel) {
+    status_t status = parcel->readString8(&name);
+    if (status != NO_ERROR) return status;
+    status = parcel->readUint32(&width);
+    if (status != NO_ERROR) return status;
+    status = parcel->readUint32(&height);
+    if (status != NO_ERROR) return status;
+    int32_t formatValue = 0;
+    status = parcel->readInt32(&formatValue);
+    if (status != NO_ERROR) return status;
+    format = static_cast<PixelFormat>(formatValue);
+    status = parcel->readUint32(&flags);
+    if (status != NO_ERROR) return status;
+    status = parcel->readStrongBinder(&parent);
+    if (status != NO_ERROR) return status;
+    status = parcel->readInt32(&windowType);
+    if (status != NO_ERROR) return status;
+    return parcel->readInt32(&ownerUid);
+}
+
+status_t ISurfaceComposerClient::CreatedSurface::writeToParcel(Parcel* parcel) const {
+    status_t status = parcel->writeInt32(result);
+    if (status != NO_ERROR) return status;
+    status = parcel->writeStrongBinder(handle);
+    if (status != NO_ERROR) return status;
+    return parcel->writeStrongBinder(IInterface::asBinder(gbp));
+}
+
+status_t ISurfaceComposerClient::CreatedSurface::readFromParcel(const Parcel* parcel) {
+    int32_t resultValue = 0;
+    status_t status = parcel->readInt32(&resultValue);
+    if (status != NO_ERROR) return status;
+    result = static_cast<status_t>(resultValue);
+    status = parcel->readStrongBinder(&handle);
+    if (status != NO_ERROR) return status;
+    sp<IBinder> gbpBinder;
+    status = parcel->readStrongBinder(&gbpBinder);
+    if (status != NO_ERROR) return status;
+    gbp = interface_cast<IGraphicBufferProducer>(gbpBinder);
+    return NO_ERROR;
+}
+
 class BpSurfaceComposerClient : public SafeBpInterface<ISurfaceComposerClient> {
 public:
     explicit BpSurfaceComposerClient(const sp<IBinder>& impl)
@@ -57,6 +119,13 @@ public:
                                                                             handle, gbp);
     }
 
+    status_t createSurfaces(const std::vector<SurfaceDescriptor>& descriptors,
+                            std::vector<CreatedSurface>* outResults) override {
+        return callRemote<decltype(&ISurfaceComposerClient::createSurfaces)>(Tag::CREATE_SURFACES,
+                                                                             descriptors,
+                                                                             outResults);
+    }
+
     status_t destroySurface(const sp<IBinder>& handle) override {
         return callRemote<decltype(&ISurfaceComposerClient::destroySurface)>(Tag::DESTROY_SURFACE,
                                                                              handle);
@@ -98,6 +167,8 @@ status_t BnSurfaceComposerClient::onTransact(uint32_t code, const Parcel& data,
             return callLocal(data, reply, &ISurfaceComposerClient::clearLayerFrameStats);
         case Tag::GET_LAYER_FRAME_STATS:
             return callLocal(data, reply, &ISurfaceComposerClient::getLayerFrameStats);
+        case Tag::CREATE_SURFACES:
+            return callLocal(data, reply, &ISurfaceComposerClient::createSurfaces);
     }
 }
 
@@ -24,8 +24,81 @@
 
 #include <inttypes.h>
 
+#include <mutex>
+#include <unordered_set>
+
 namespace android {
 
+// Registry of live trackers plus the folded-in totals of destroyed ones,
+// so getProcessQueueHealthStats covers the whole process lifetime.  Kept
+// as leaky function-local statics to dodge static destruction order.
+static std::mutex& trackerRegistryMutex() {
+    static std::mutex* mutex = new std::mutex;
+    return *mutex;
+}
+
+static std::unordered_set<OccupancyTracker*>& trackerRegistry() {
+    static std::unordered_set<OccupancyTracker*>* registry =
+            new std::unordered_set<OccupancyTracker*>;
+    return *registry;
+}
+
+static OccupancyTracker::QueueHealthStats& retiredTrackerStats() {
+    static OccupancyTracker::QueueHealthStats* stats = []() {
+        auto* s = new OccupancyTracker::QueueHealthStats;
+        s->clear();
+        return s;
+    }();
+    return *stats;
+}
+
+void OccupancyTracker::QueueHealthStats::clear() {
+    for (size_t i = 0; i < NUM_OCCUPANCY_BUCKETS; ++i) {
+        timeAtOccupancyNs[i] = 0;
+    }
+    producerWaitTimeNs = 0;
+    producerWaitCount = 0;
+    for (size_t i = 0; i < NUM_WAIT_BUCKETS; ++i) {
+        producerWaitHistogram[i] = 0;
+    }
+}
+
+void OccupancyTracker::QueueHealthStats::add(const QueueHealthStats& other) {
+    for (size_t i = 0; i < NUM_OCCUPANCY_BUCKETS; ++i) {
+        timeAtOccupancyNs[i] += other.timeAtOccupancyNs[i];
+    }
+    producerWaitTimeNs += other.producerWaitTimeNs;
+    producerWaitCount += other.producerWaitCount;
+    for (size_t i = 0; i < NUM_WAIT_BUCKETS; ++i) {
+        producerWaitHistogram[i] += other.producerWaitHistogram[i];
+    }
+}
+
+OccupancyTracker::OccupancyTracker()
+  : mPendingSegment(),
+    mSegmentHistory(),
+    mLastOccupancy(0),
+    mLastOccupancyChangeTime(0),
+    mProducerWaitTimeNs(0),
+    mProducerWaitCount(0) {
+    for (size_t i = 0; i < NUM_OCCUPANCY_BUCKETS; ++i) {
+        mTimeAtOccupancyNs[i].store(0, std::memory_order_relaxed);
+    }
+    for (size_t i = 0; i < NUM_WAIT_BUCKETS; ++i) {
+        mProducerWaitHistogram[i].store(0, std::memory_order_relaxed);
+    }
+    std::lock_guard<std::mutex> lock(trackerRegistryMutex());
+    trackerRegistry().insert(this);
+}
+
+OccupancyTracker::~OccupancyTracker() {
+    QueueHealthStats stats;
+    getQueueHealthStats(&stats);
+    std::lock_guard<std::mutex> lock(trackerRegistryMutex());
+    retiredTrackerStats().add(stats);
+    trackerRegistry().erase(this);
+}
+
 status_t OccupancyTracker::Segment::writeToParcel(Parcel* parcel) const {
     status_t result = parcel->writeInt64(totalTime);
     if (result != OK) {
@@ -64,6 +137,14 @@ void OccupancyTracker::registerOccupancyChange(size_t occupancy) {
     ATRACE_CALL();
     nsecs_t now = systemTime();
     nsecs_t delta = now - mLastOccupancyChangeTime;
+    if (mLastOccupancyChangeTime != 0 && delta > 0) {
+        // Health counters charge the full wall time to the previous
+        // occupancy, including idle gaps the segment logic below discards.
+        size_t bucket = mLastOccupancy < NUM_OCCUPANCY_BUCKETS ?
+                mLastOccupancy : NUM_OCCUPANCY_BUCKETS - 1;
+        mTimeAtOccupancyNs[bucket].fetch_add(static_cast<uint64_t>(delta),
+                std::memory_order_relaxed);
+    }
     if (delta > NEW_SEGMENT_DELAY) {
         recordPendingSegment();
     } else {
@@ -114,4 +195,49 @@ void OccupancyTracker::recordPendingSegment() {
     mPendingSegment.clear();
 }
 
+void OccupancyTracker::registerDequeueWait(nsecs_t waitTime) {
+    if (waitTime <= 0) {
+        return;
+    }
+    mProducerWaitTimeNs.fetch_add(static_cast<uint64_t>(waitTime),
+            std::memory_order_relaxed);
+    mProducerWaitCount.fetch_add(1, std::memory_order_relaxed);
+    size_t bucket;
+    if (waitTime < ms2ns(1)) {
+        bucket = 0;
+    } else if (waitTime < ms2ns(4)) {
+        bucket = 1;
+    } else if (waitTime < ms2ns(16)) {
+        bucket = 2;
+    } else {
+        bucket = 3;
+    }
+    mProducerWaitHistogram[bucket].fetch_add(1, std::memory_order_relaxed);
+}
+
+void OccupancyTracker::getQueueHealthStats(QueueHealthStats* outStats) const {
+    for (size_t i = 0; i < NUM_OCCUPANCY_BUCKETS; ++i) {
+        outStats->timeAtOccupancyNs[i] =
+                mTimeAtOccupancyNs[i].load(std::memory_order_relaxed);
+    }
+    outStats->producerWaitTimeNs =
+            mProducerWaitTimeNs.load(std::memory_order_relaxed);
+    outStats->producerWaitCount =
+            mProducerWaitCount.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < NUM_WAIT_BUCKETS; ++i) {
+        outStats->producerWaitHistogram[i] =
+                mProducerWaitHistogram[i].load(std::memory_order_relaxed);
+    }
+}
+
+void OccupancyTracker::getProcessQueueHealthStats(QueueHealthStats* outStats) {
+    std::lock_guard<std::mutex> lock(trackerRegistryMutex());
+    *outStats = retiredTrackerStats();
+    for (const OccupancyTracker* tracker : trackerRegistry()) {
+        QueueHealthStats stats;
+        tracker->getQueueHealthStats(&stats);
+        outStats->add(stats);
+    }
+}
+
 } // namespace android
@@ -58,9 +58,17 @@ status_t StreamSplitter::createSplitter(
 
 StreamSplitter::StreamSplitter(const sp<IGraphicBufferConsumer>& inputQueue)
       : mIsAbandoned(false), mMutex(), mReleaseCondition(),
-        mOutstandingBuffers(0), mInput(inputQueue), mOutputs(), mBuffers() {}
+        mOutstandingBuffers(0), mInput(inputQueue), mOutputs(), mWorkers(),
+        mBuffers() {}
 
 StreamSplitter::~StreamSplitter() {
+    // Join the workers before any other teardown, since they hold a bare
+    // pointer back to the splitter
+    Vector<sp<OutputWorker> >::iterator worker = mWorkers.begin();
+    for (; worker != mWorkers.end(); ++worker) {
+        (*worker)->shutdown();
+    }
+
     mInput->consumerDisconnect();
     Vector<sp<IGraphicBufferProducer> >::iterator output = mOutputs.begin();
     for (; output != mOutputs.end(); ++output) {
@@ -93,6 +101,16 @@ status_t StreamSplitter::addOutput(
 
     mOutputs.push_back(outputQueue);
 
+    sp<OutputWorker> worker(new OutputWorker(this, outputQueue));
+    status = worker->run("StreamSplitter");
+    if (status != NO_ERROR) {
+        ALOGE("addOutput: failed to start worker (%d)", status);
+        mOutputs.pop_back();
+        outputQueue->disconnect(NATIVE_WINDOW_API_CPU);
+        return status;
+    }
+    mWorkers.push_back(worker);
+
     return NO_ERROR;
 }
 
@@ -148,42 +166,53 @@ void StreamSplitter::onFrameAvailable(const BufferItem& /* item */) {
             static_cast<int32_t>(bufferItem.mScalingMode),
             bufferItem.mTransform, bufferItem.mFence);
 
-    // Attach and queue the buffer to each of the outputs
-    Vector<sp<IGraphicBufferProducer> >::iterator output = mOutputs.begin();
-    for (; output != mOutputs.end(); ++output) {
-        int slot;
-        status = (*output)->attachBuffer(&slot, bufferItem.mGraphicBuffer);
-        if (status == NO_INIT) {
-            // If we just discovered that this output has been abandoned, note
-            // that, increment the release count so that we still release this
-            // buffer eventually, and move on to the next output
-            onAbandonedLocked();
-            mBuffers.editValueFor(bufferItem.mGraphicBuffer->getId())->
-                    incrementReleaseCountLocked();
-            continue;
-        } else {
-            LOG_ALWAYS_FATAL_IF(status != NO_ERROR,
-                    "attaching buffer to output failed (%d)", status);
-        }
+    // Hand the buffer to each output's worker, which attach and queue it to
+    // their outputs in parallel so that a slow output doesn't delay the
+    // others
+    Vector<sp<OutputWorker> >::iterator worker = mWorkers.begin();
+    for (; worker != mWorkers.end(); ++worker) {
+        (*worker)->queueWork(bufferItem.mGraphicBuffer, queueInput);
+    }
+}
 
-        IGraphicBufferProducer::QueueBufferOutput queueOutput;
-        status = (*output)->queueBuffer(slot, queueInput, &queueOutput);
-        if (status == NO_INIT) {
-            // If we just discovered that this output has been abandoned, note
-            // that, increment the release count so that we still release this
-            // buffer eventually, and move on to the next output
-            onAbandonedLocked();
-            mBuffers.editValueFor(bufferItem.mGraphicBuffer->getId())->
-                    incrementReleaseCountLocked();
-            continue;
-        } else {
-            LOG_ALWAYS_FATAL_IF(status != NO_ERROR,
-                    "queueing buffer to output failed (%d)", status);
-        }
+void StreamSplitter::fanOutBufferToOutput(
+        const sp<IGraphicBufferProducer>& output,
+        const sp<GraphicBuffer>& buffer,
+        const IGraphicBufferProducer::QueueBufferInput& input) {
+    ATRACE_CALL();
 
-        ALOGV("queued buffer %#" PRIx64 " to output %p",
-                bufferItem.mGraphicBuffer->getId(), output->get());
+    int slot;
+    status_t status = output->attachBuffer(&slot, buffer);
+    if (status == NO_INIT) {
+        // If we just discovered that this output has been abandoned, note
+        // that, and release this output's reference to the buffer so that it
+        // still gets returned to the input eventually
+        Mutex::Autolock lock(mMutex);
+        onAbandonedLocked();
+        releaseReferenceLocked(buffer);
+        return;
+    } else {
+        LOG_ALWAYS_FATAL_IF(status != NO_ERROR,
+                "attaching buffer to output failed (%d)", status);
     }
+
+    IGraphicBufferProducer::QueueBufferOutput queueOutput;
+    status = output->queueBuffer(slot, input, &queueOutput);
+    if (status == NO_INIT) {
+        // If we just discovered that this output has been abandoned, note
+        // that, and release this output's reference to the buffer so that it
+        // still gets returned to the input eventually
+        Mutex::Autolock lock(mMutex);
+        onAbandonedLocked();
+        releaseReferenceLocked(buffer);
+        return;
+    } else {
+        LOG_ALWAYS_FATAL_IF(status != NO_ERROR,
+                "queueing buffer to output failed (%d)", status);
+    }
+
+    ALOGV("queued buffer %#" PRIx64 " to output %p",
+            buffer->getId(), output.get());
 }
 
 void StreamSplitter::onBufferReleasedByOutput(
@@ -207,11 +236,15 @@ void StreamSplitter::onBufferReleasedByOutput(
     ALOGV("detached buffer %#" PRIx64 " from output %p",
           buffer->getId(), from.get());
 
-    const sp<BufferTracker>& tracker = mBuffers.editValueFor(buffer->getId());
-
     // Merge the release fence of the incoming buffer so that the fence we send
     // back to the input includes all of the outputs' fences
-    tracker->mergeFence(fence);
+    mBuffers.editValueFor(buffer->getId())->mergeFence(fence);
+
+    releaseReferenceLocked(buffer);
+}
+
+void StreamSplitter::releaseReferenceLocked(const sp<GraphicBuffer>& buffer) {
+    sp<BufferTracker> tracker = mBuffers.valueFor(buffer->getId());
 
     // Check to see if this is the last outstanding reference to this buffer
     size_t releaseCount = tracker->incrementReleaseCountLocked();
@@ -230,7 +263,7 @@ void StreamSplitter::onBufferReleasedByOutput(
 
     // Attach and release the buffer back to the input
     int consumerSlot;
-    status = mInput->attachBuffer(&consumerSlot, tracker->getBuffer());
+    status_t status = mInput->attachBuffer(&consumerSlot, tracker->getBuffer());
     LOG_ALWAYS_FATAL_IF(status != NO_ERROR,
             "attaching buffer to input failed (%d)", status);
 
@@ -275,6 +308,48 @@ void StreamSplitter::OutputListener::binderDied(const wp<IBinder>& /* who */) {
     mSplitter->onAbandonedLocked();
 }
 
+StreamSplitter::OutputWorker::OutputWorker(StreamSplitter* splitter,
+        const sp<IGraphicBufferProducer>& output)
+      : mSplitter(splitter), mOutput(output), mWorkMutex(), mWorkCondition(),
+        mPendingWork(), mShutdown(false) {}
+
+void StreamSplitter::OutputWorker::queueWork(const sp<GraphicBuffer>& buffer,
+        const IGraphicBufferProducer::QueueBufferInput& input) {
+    Mutex::Autolock lock(mWorkMutex);
+    mPendingWork.push_back(Work{buffer, input});
+    mWorkCondition.signal();
+}
+
+void StreamSplitter::OutputWorker::shutdown() {
+    {
+        Mutex::Autolock lock(mWorkMutex);
+        mShutdown = true;
+        mWorkCondition.signal();
+    }
+    requestExitAndWait();
+}
+
+bool StreamSplitter::OutputWorker::threadLoop() {
+    std::list<Work> work;
+    {
+        Mutex::Autolock lock(mWorkMutex);
+        while (mPendingWork.empty() && !mShutdown) {
+            mWorkCondition.wait(mWorkMutex);
+        }
+        if (mShutdown) {
+            return false;
+        }
+        work.splice(work.begin(), mPendingWork);
+    }
+
+    // Perform the fan-out without holding mWorkMutex so that more work can be
+    // queued while we're blocked on the output
+    for (const Work& w : work) {
+        mSplitter->fanOutBufferToOutput(mOutput, w.buffer, w.input);
+    }
+    return true;
+}
+
 StreamSplitter::BufferTracker::BufferTracker(const sp<GraphicBuffer>& buffer)
       : mBuffer(buffer), mMergedFence(Fence::NO_FENCE), mReleaseCount(0) {}
 
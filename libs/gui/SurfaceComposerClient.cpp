@@ -104,18 +104,38 @@ SurfaceComposerClient::Transaction::Transaction(const Transaction& other) :
     mAnimation(other.mAnimation),
     mEarlyWakeup(other.mEarlyWakeup) {
     mDisplayStates = other.mDisplayStates;
-    mComposerStates = other.mComposerStates;
+    mComposerStates.assign(other.mComposerStates.begin(),
+            other.mComposerStates.begin() +
+                    static_cast<ssize_t>(other.mComposerStateCount));
+    mComposerStateControls.assign(other.mComposerStateControls.begin(),
+            other.mComposerStateControls.begin() +
+                    static_cast<ssize_t>(other.mComposerStateCount));
+    mComposerStateCount = other.mComposerStateCount;
+}
+
+void SurfaceComposerClient::Transaction::releaseComposerStates() {
+    // A single default-constructed state used to scrub recycled slots.
+    // Assigning it drops any references a slot holds, and since Region
+    // assignment is copy-on-write, neither the scrub nor the slot's reuse
+    // allocates.
+    static const ComposerState sCleanState;
+    for (size_t i = 0; i < mComposerStateCount; i++) {
+        mComposerStates[i] = sCleanState;
+        mComposerStateControls[i].clear();
+    }
+    mComposerStateCount = 0;
 }
 
 SurfaceComposerClient::Transaction& SurfaceComposerClient::Transaction::merge(Transaction&& other) {
-    for (auto const& kv : other.mComposerStates) {
-        if (mComposerStates.count(kv.first) == 0) {
-            mComposerStates[kv.first] = kv.second;
-        } else {
-            mComposerStates[kv.first].state.merge(kv.second.state);
+    for (size_t i = 0; i < other.mComposerStateCount; i++) {
+        layer_state_t* s = getLayerState(other.mComposerStateControls[i]);
+        if (!s) {
+            mStatus = BAD_INDEX;
+            return *this;
         }
+        s->merge(other.mComposerStates[i].state);
     }
-    other.mComposerStates.clear();
+    other.releaseComposerStates();
 
     for (auto const& state : other.mDisplayStates) {
         ssize_t index = mDisplayStates.indexOf(state);
@@ -143,11 +163,15 @@ status_t SurfaceComposerClient::Transaction::apply(bool synchronous) {
 
     mForceSynchronous |= synchronous;
 
-    for (auto const& kv : mComposerStates){
-        composerStates.add(kv.second);
+    // ComposerState copies are cheap here: the sp members are reference
+    // bumps and the Region copies share their storage, so this is close to
+    // a move of the accumulated states.
+    composerStates.setCapacity(mComposerStateCount);
+    for (size_t i = 0; i < mComposerStateCount; i++) {
+        composerStates.add(mComposerStates[i]);
     }
 
-    mComposerStates.clear();
+    releaseComposerStates();
 
     displayStates = mDisplayStates;
     mDisplayStates.clear();
@@ -195,15 +219,27 @@ void SurfaceComposerClient::Transaction::setEarlyWakeup() {
 }
 
 layer_state_t* SurfaceComposerClient::Transaction::getLayerState(const sp<SurfaceControl>& sc) {
-    if (mComposerStates.count(sc) == 0) {
-        // we don't have it, add an initialized layer_state to our list
-        ComposerState s;
-        s.client = sc->getClient()->mClient;
-        s.state.surface = sc->getHandle();
-        mComposerStates[sc] = s;
+    // A linear scan beats a hash map here: transactions touch at most a few
+    // dozen layers and the slots can be recycled without freeing any nodes.
+    for (size_t i = 0; i < mComposerStateCount; i++) {
+        if (mComposerStateControls[i] == sc) {
+            return &(mComposerStates[i].state);
+        }
+    }
+
+    // We don't have it; claim a recycled slot from the arena, or grow the
+    // arena to a new high-water mark.
+    if (mComposerStateCount == mComposerStates.size()) {
+        mComposerStates.emplace_back();
+        mComposerStateControls.emplace_back();
     }
+    ComposerState& s = mComposerStates[mComposerStateCount];
+    s.client = sc->getClient()->mClient;
+    s.state.surface = sc->getHandle();
+    mComposerStateControls[mComposerStateCount] = sc;
+    mComposerStateCount++;
 
-    return &(mComposerStates[sc].state);
+    return &s.state;
 }
 
 SurfaceComposerClient::Transaction& SurfaceComposerClient::Transaction::setPosition(
@@ -660,6 +696,41 @@ status_t SurfaceComposerClient::createSurfaceChecked(
     return err;
 }
 
+status_t SurfaceComposerClient::createSurfaces(
+        const std::vector<ISurfaceComposerClient::SurfaceDescriptor>& descriptors,
+        std::vector<sp<SurfaceControl>>* outSurfaces)
+{
+    outSurfaces->clear();
+    if (mStatus != NO_ERROR) {
+        return mStatus;
+    }
+
+    std::vector<ISurfaceComposerClient::CreatedSurface> results;
+    status_t err = mClient->createSurfaces(descriptors, &results);
+    ALOGE_IF(err, "SurfaceComposerClient::createSurfaces error %s", strerror(-err));
+    if (err != NO_ERROR) {
+        return err;
+    }
+    if (results.size() != descriptors.size()) {
+        ALOGE("SurfaceComposerClient::createSurfaces got %zu results for %zu descriptors",
+                results.size(), descriptors.size());
+        return UNKNOWN_ERROR;
+    }
+
+    outSurfaces->resize(results.size());
+    for (size_t i = 0; i < results.size(); i++) {
+        if (results[i].result != NO_ERROR || results[i].handle == nullptr) {
+            ALOGE_IF(results[i].result != NO_ERROR,
+                    "SurfaceComposerClient::createSurfaces entry %zu error %s", i,
+                    strerror(-results[i].result));
+            continue;
+        }
+        (*outSurfaces)[i] = new SurfaceControl(this, results[i].handle, results[i].gbp,
+                                               true /* owned */);
+    }
+    return NO_ERROR;
+}
+
 status_t SurfaceComposerClient::destroySurface(const sp<IBinder>& sid) {
     if (mStatus != NO_ERROR)
         return mStatus;
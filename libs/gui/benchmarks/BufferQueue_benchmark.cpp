@@ -0,0 +1,390 @@
+/*
+ * Copyright 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "BufferQueueBenchmark"
+
+#include <chrono>
+#include <memory>
+#include <vector>
+
+#include <errno.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <benchmark/benchmark.h>
+
+#include <binder/IServiceManager.h>
+#include <binder/Parcel.h>
+#include <binder/ProcessState.h>
+#include <gui/BufferItem.h>
+#include <gui/BufferItemConsumer.h>
+#include <gui/BufferQueue.h>
+#include <gui/IConsumerListener.h>
+#include <gui/IGraphicBufferConsumer.h>
+#include <gui/IGraphicBufferProducer.h>
+#include <ui/Fence.h>
+#include <ui/GraphicBuffer.h>
+#include <utils/Log.h>
+#include <utils/String16.h>
+
+namespace android {
+namespace {
+
+using ::benchmark::Counter;
+using ::benchmark::State;
+
+const String16 kServiceName("BufferQueueBenchmark");
+
+constexpr uint32_t kBufferWidth = 1;
+constexpr uint32_t kBufferHeight = 1;
+constexpr PixelFormat kBufferFormat = HAL_PIXEL_FORMAT_RGBA_8888;
+constexpr uint64_t kBufferUsage =
+        GRALLOC_USAGE_SW_READ_OFTEN | GRALLOC_USAGE_SW_WRITE_OFTEN;
+
+// Transaction code asking the service process to create a BufferQueue,
+// consume from it locally, and reply with the IGraphicBufferProducer.
+constexpr uint32_t CREATE_BUFFER_QUEUE = IBinder::FIRST_CALL_TRANSACTION;
+
+// Consumer listener that ignores all callbacks. The in-process benchmarks
+// drive the consumer side explicitly through IGraphicBufferConsumer.
+class StubConsumerListener : public BnConsumerListener {
+public:
+    virtual ~StubConsumerListener() {}
+    virtual void onFrameAvailable(const BufferItem& /* item */) override {}
+    virtual void onBuffersReleased() override {}
+    virtual void onSidebandStreamChanged() override {}
+};
+
+// Dequeues one buffer from the producer, allocating it if necessary, and
+// queues it back. Returns the dequeued slot, or a negative error.
+int dequeueAndQueue(const sp<IGraphicBufferProducer>& producer) {
+    int slot = BufferQueue::INVALID_BUFFER_SLOT;
+    sp<Fence> fence;
+    status_t result = producer->dequeueBuffer(&slot, &fence, kBufferWidth,
+            kBufferHeight, kBufferFormat, kBufferUsage, nullptr, nullptr);
+    if (result < 0) {
+        return result;
+    }
+    if (result & IGraphicBufferProducer::BUFFER_NEEDS_REALLOCATION) {
+        sp<GraphicBuffer> buffer;
+        result = producer->requestBuffer(slot, &buffer);
+        if (result != NO_ERROR) {
+            return result;
+        }
+    }
+    IGraphicBufferProducer::QueueBufferInput input(0, false,
+            HAL_DATASPACE_UNKNOWN, Rect(kBufferWidth, kBufferHeight),
+            NATIVE_WINDOW_SCALING_MODE_FREEZE, 0, Fence::NO_FENCE);
+    IGraphicBufferProducer::QueueBufferOutput output;
+    result = producer->queueBuffer(slot, input, &output);
+    if (result != NO_ERROR) {
+        return result;
+    }
+    return slot;
+}
+
+// Measures the full dequeue/queue/acquire/release cycle with both endpoints
+// in-process, so every IGraphicBufferProducer call resolves to a local
+// BufferQueueProducer and the numbers isolate BufferQueueCore locking from
+// binder overhead. Arg 0 is the max dequeued buffer count, arg 1 selects
+// async mode. Per-phase averages are reported as counters so changes to a
+// single lock section show up in the right phase.
+void BM_BufferQueueCycleInProcess(State& state) {
+    const int maxDequeuedBuffers = static_cast<int>(state.range(0));
+    const bool async = state.range(1) != 0;
+
+    sp<IGraphicBufferProducer> producer;
+    sp<IGraphicBufferConsumer> consumer;
+    BufferQueue::createBufferQueue(&producer, &consumer);
+    consumer->consumerConnect(new StubConsumerListener, false);
+    consumer->setConsumerUsageBits(kBufferUsage);
+
+    IGraphicBufferProducer::QueueBufferOutput output;
+    producer->connect(nullptr, NATIVE_WINDOW_API_CPU, true, &output);
+    producer->setMaxDequeuedBufferCount(maxDequeuedBuffers);
+    producer->setAsyncMode(async);
+
+    // Run one cycle per slot up front so buffer allocation stays out of the
+    // measured loop.
+    for (int i = 0; i < maxDequeuedBuffers; i++) {
+        if (dequeueAndQueue(producer) < 0) {
+            state.SkipWithError("failed to prime buffers");
+            return;
+        }
+        BufferItem item;
+        if (consumer->acquireBuffer(&item, 0) != NO_ERROR ||
+                consumer->releaseHelper(item.mSlot, item.mFrameNumber,
+                        Fence::NO_FENCE) != NO_ERROR) {
+            state.SkipWithError("failed to prime consumer");
+            return;
+        }
+    }
+
+    double totalDequeueUs = 0;
+    double totalQueueUs = 0;
+    double totalAcquireUs = 0;
+    double totalReleaseUs = 0;
+    int iterations = 0;
+
+    while (state.KeepRunning()) {
+        int slot = BufferQueue::INVALID_BUFFER_SLOT;
+        sp<Fence> fence;
+        status_t result;
+
+        auto t0 = std::chrono::high_resolution_clock::now();
+        result = producer->dequeueBuffer(&slot, &fence, kBufferWidth,
+                kBufferHeight, kBufferFormat, kBufferUsage, nullptr, nullptr);
+        auto t1 = std::chrono::high_resolution_clock::now();
+        if (result < 0) {
+            state.SkipWithError("dequeueBuffer failed");
+            return;
+        }
+
+        IGraphicBufferProducer::QueueBufferInput input(0, false,
+                HAL_DATASPACE_UNKNOWN, Rect(kBufferWidth, kBufferHeight),
+                NATIVE_WINDOW_SCALING_MODE_FREEZE, 0, Fence::NO_FENCE);
+        auto t2 = std::chrono::high_resolution_clock::now();
+        result = producer->queueBuffer(slot, input, &output);
+        auto t3 = std::chrono::high_resolution_clock::now();
+        if (result != NO_ERROR) {
+            state.SkipWithError("queueBuffer failed");
+            return;
+        }
+
+        BufferItem item;
+        auto t4 = std::chrono::high_resolution_clock::now();
+        result = consumer->acquireBuffer(&item, 0);
+        auto t5 = std::chrono::high_resolution_clock::now();
+        if (result != NO_ERROR) {
+            state.SkipWithError("acquireBuffer failed");
+            return;
+        }
+
+        auto t6 = std::chrono::high_resolution_clock::now();
+        result = consumer->releaseHelper(item.mSlot, item.mFrameNumber,
+                Fence::NO_FENCE);
+        auto t7 = std::chrono::high_resolution_clock::now();
+        if (result != NO_ERROR) {
+            state.SkipWithError("releaseBuffer failed");
+            return;
+        }
+
+        totalDequeueUs +=
+                std::chrono::duration<double, std::micro>(t1 - t0).count();
+        totalQueueUs +=
+                std::chrono::duration<double, std::micro>(t3 - t2).count();
+        totalAcquireUs +=
+                std::chrono::duration<double, std::micro>(t5 - t4).count();
+        totalReleaseUs +=
+                std::chrono::duration<double, std::micro>(t7 - t6).count();
+        iterations++;
+    }
+
+    if (iterations > 0) {
+        state.counters["dequeue_us"] = Counter(totalDequeueUs / iterations);
+        state.counters["queue_us"] = Counter(totalQueueUs / iterations);
+        state.counters["acquire_us"] = Counter(totalAcquireUs / iterations);
+        state.counters["release_us"] = Counter(totalReleaseUs / iterations);
+    }
+
+    producer->disconnect(NATIVE_WINDOW_API_CPU);
+    consumer->consumerDisconnect();
+}
+BENCHMARK(BM_BufferQueueCycleInProcess)
+        ->Unit(::benchmark::kMicrosecond)
+        ->ArgNames({"buffers", "async"})
+        ->Args({1, 0})
+        ->Args({2, 0})
+        ->Args({3, 0})
+        ->Args({4, 0})
+        ->Args({2, 1})
+        ->Args({3, 1});
+
+// Measures the producer half of the cycle when the BufferQueue lives in
+// another process, so dequeueBuffer and queueBuffer go through binder. The
+// service process consumes each frame as it arrives (see runBinderServer),
+// making the delta against BM_BufferQueueCycleInProcess the
+// IGraphicBufferProducer transport overhead. Arg 0 is the max dequeued
+// buffer count.
+void BM_BufferQueueCycleCrossProcess(State& state) {
+    sp<IBinder> service = defaultServiceManager()->getService(kServiceName);
+    if (service == nullptr) {
+        state.SkipWithError("benchmark service not found");
+        return;
+    }
+
+    Parcel data;
+    Parcel reply;
+    if (service->transact(CREATE_BUFFER_QUEUE, data, &reply) != NO_ERROR) {
+        state.SkipWithError("failed to create remote BufferQueue");
+        return;
+    }
+    sp<IBinder> binder;
+    if (reply.readNullableStrongBinder(&binder) != NO_ERROR ||
+            binder == nullptr) {
+        state.SkipWithError("failed to read remote producer");
+        return;
+    }
+    sp<IGraphicBufferProducer> producer =
+            interface_cast<IGraphicBufferProducer>(binder);
+
+    const int maxDequeuedBuffers = static_cast<int>(state.range(0));
+    IGraphicBufferProducer::QueueBufferOutput output;
+    producer->connect(nullptr, NATIVE_WINDOW_API_CPU, true, &output);
+    producer->setMaxDequeuedBufferCount(maxDequeuedBuffers);
+
+    for (int i = 0; i < maxDequeuedBuffers; i++) {
+        if (dequeueAndQueue(producer) < 0) {
+            state.SkipWithError("failed to prime buffers");
+            return;
+        }
+    }
+
+    double totalDequeueUs = 0;
+    double totalQueueUs = 0;
+    int iterations = 0;
+
+    while (state.KeepRunning()) {
+        int slot = BufferQueue::INVALID_BUFFER_SLOT;
+        sp<Fence> fence;
+        status_t result;
+
+        auto t0 = std::chrono::high_resolution_clock::now();
+        result = producer->dequeueBuffer(&slot, &fence, kBufferWidth,
+                kBufferHeight, kBufferFormat, kBufferUsage, nullptr, nullptr);
+        auto t1 = std::chrono::high_resolution_clock::now();
+        if (result < 0) {
+            state.SkipWithError("dequeueBuffer failed");
+            return;
+        }
+
+        IGraphicBufferProducer::QueueBufferInput input(0, false,
+                HAL_DATASPACE_UNKNOWN, Rect(kBufferWidth, kBufferHeight),
+                NATIVE_WINDOW_SCALING_MODE_FREEZE, 0, Fence::NO_FENCE);
+        auto t2 = std::chrono::high_resolution_clock::now();
+        result = producer->queueBuffer(slot, input, &output);
+        auto t3 = std::chrono::high_resolution_clock::now();
+        if (result != NO_ERROR) {
+            state.SkipWithError("queueBuffer failed");
+            return;
+        }
+
+        totalDequeueUs +=
+                std::chrono::duration<double, std::micro>(t1 - t0).count();
+        totalQueueUs +=
+                std::chrono::duration<double, std::micro>(t3 - t2).count();
+        iterations++;
+    }
+
+    if (iterations > 0) {
+        state.counters["dequeue_us"] = Counter(totalDequeueUs / iterations);
+        state.counters["queue_us"] = Counter(totalQueueUs / iterations);
+    }
+
+    producer->disconnect(NATIVE_WINDOW_API_CPU);
+}
+BENCHMARK(BM_BufferQueueCycleCrossProcess)
+        ->Unit(::benchmark::kMicrosecond)
+        ->ArgNames({"buffers"})
+        ->Arg(2)
+        ->Arg(3);
+
+// Service hosted in the parent process. Each CREATE_BUFFER_QUEUE
+// transaction creates a BufferQueue whose consumer side stays local: a
+// BufferItemConsumer acquires and releases every frame as soon as it is
+// queued, so the remote producer is never starved of free slots.
+class BufferQueueService : public BBinder {
+public:
+    status_t onTransact(uint32_t code, const Parcel& /* data */,
+            Parcel* reply, uint32_t /* flags */ = 0) override {
+        switch (code) {
+            case CREATE_BUFFER_QUEUE: {
+                auto queue = std::make_unique<BufferQueueHolder>();
+                reply->writeStrongBinder(
+                        IInterface::asBinder(queue->mProducer));
+                mQueues.push_back(std::move(queue));
+                return NO_ERROR;
+            }
+            default:
+                return UNKNOWN_TRANSACTION;
+        }
+    }
+
+private:
+    struct BufferQueueHolder {
+        BufferQueueHolder() {
+            sp<IGraphicBufferConsumer> consumer;
+            BufferQueue::createBufferQueue(&mProducer, &consumer);
+            mItemConsumer = new BufferItemConsumer(consumer, kBufferUsage, 1,
+                    true);
+            mListener = new FrameListener(mItemConsumer);
+            mItemConsumer->setFrameAvailableListener(mListener);
+        }
+
+        struct FrameListener : public ConsumerBase::FrameAvailableListener {
+            explicit FrameListener(const sp<BufferItemConsumer>& consumer)
+                  : mItemConsumer(consumer) {}
+
+            void onFrameAvailable(const BufferItem& /* item */) override {
+                BufferItem item;
+                if (mItemConsumer->acquireBuffer(&item, 0) == NO_ERROR) {
+                    mItemConsumer->releaseBuffer(item, Fence::NO_FENCE);
+                }
+            }
+
+            sp<BufferItemConsumer> mItemConsumer;
+        };
+
+        sp<IGraphicBufferProducer> mProducer;
+        sp<BufferItemConsumer> mItemConsumer;
+        sp<FrameListener> mListener;
+    };
+
+    std::vector<std::unique_ptr<BufferQueueHolder>> mQueues;
+};
+
+void runBinderServer() {
+    ProcessState::self()->startThreadPool();
+
+    sp<BufferQueueService> service = new BufferQueueService;
+    defaultServiceManager()->addService(kServiceName, service, false);
+
+    ALOGI("BufferQueue benchmark server running");
+
+    // Stay alive until the benchmark process exits.
+    while (true) {
+        int stat;
+        if (wait(&stat) == -1 && errno == ECHILD) {
+            break;
+        }
+    }
+}
+
+} // namespace
+} // namespace android
+
+int main(int argc, char** argv) {
+    pid_t pid = fork();
+    if (pid == 0) {
+        // Child: run the benchmarks against the server in the parent.
+        android::ProcessState::self()->startThreadPool();
+        ::benchmark::Initialize(&argc, argv);
+        ::benchmark::RunSpecifiedBenchmarks();
+        return 0;
+    }
+    android::runBinderServer();
+    return 0;
+}
@@ -301,32 +301,24 @@ inline status_t flattenFence(hidl_handle const& fence,
  */
 // wrap: Fence -> hidl_handle
 inline bool wrapAs(hidl_handle* t, native_handle_t** nh, Fence const& l) {
-    size_t const baseSize = l.getFlattenedSize();
-    std::unique_ptr<uint8_t[]> baseBuffer(
-            new (std::nothrow) uint8_t[baseSize]);
-    if (!baseBuffer) {
-        return false;
-    }
-
-    size_t const baseNumFds = l.getFdCount();
-    std::unique_ptr<int[]> baseFds(
-            new (std::nothrow) int[baseNumFds]);
-    if (!baseFds) {
-        return false;
-    }
-
-    void* buffer = static_cast<void*>(baseBuffer.get());
-    size_t size = baseSize;
-    int* fds = static_cast<int*>(baseFds.get());
-    size_t numFds = baseNumFds;
+    // A flattened fence is a single uint32_t fd count plus at most one fd,
+    // so the round trip fits on the stack; this runs once per frame on the
+    // queueBuffer path.
+    uint32_t flatWord = 0;
+    int fd = -1;
+
+    void* buffer = static_cast<void*>(&flatWord);
+    size_t size = sizeof(flatWord);
+    int* fds = &fd;
+    size_t numFds = 1;
     if (l.flatten(buffer, size, fds, numFds) != NO_ERROR) {
         return false;
     }
 
-    void const* constBuffer = static_cast<void const*>(baseBuffer.get());
-    size = baseSize;
-    int const* constFds = static_cast<int const*>(baseFds.get());
-    numFds = baseNumFds;
+    void const* constBuffer = static_cast<void const*>(&flatWord);
+    size = sizeof(flatWord);
+    int const* constFds = &fd;
+    numFds = l.getFdCount();
     if (unflattenFence(t, nh, constBuffer, size, constFds, numFds)
             != NO_ERROR) {
         return false;
@@ -353,48 +345,23 @@ inline bool convertTo(Fence* l, hidl_handle const& t) {
             return false;
         }
     }
-    native_handle_t* nh = native_handle_create_from_fd(fd);
-    if (nh == nullptr) {
+
+    // Feed Fence::unflatten straight from the stack in the format
+    // Fence::flatten produces: a uint32_t fd count followed by the fd.
+    // This runs once per frame on the dequeueBuffer path, so no temporary
+    // handle or heap buffer is created.
+    uint32_t const flatWord = fd == -1 ? 0 : 1;
+    void const* constBuffer = static_cast<void const*>(&flatWord);
+    size_t size = sizeof(flatWord);
+    int const* constFds = &fd;
+    size_t numFds = static_cast<size_t>(flatWord);
+    if (l->unflatten(constBuffer, size, constFds, numFds) != NO_ERROR) {
         if (fd != -1) {
             close(fd);
         }
         return false;
     }
 
-    size_t const baseSize = getFenceFlattenedSize(t);
-    std::unique_ptr<uint8_t[]> baseBuffer(
-            new (std::nothrow) uint8_t[baseSize]);
-    if (!baseBuffer) {
-        native_handle_delete(nh);
-        return false;
-    }
-
-    size_t const baseNumFds = getFenceFdCount(t);
-    std::unique_ptr<int[]> baseFds(
-            new (std::nothrow) int[baseNumFds]);
-    if (!baseFds) {
-        native_handle_delete(nh);
-        return false;
-    }
-
-    void* buffer = static_cast<void*>(baseBuffer.get());
-    size_t size = baseSize;
-    int* fds = static_cast<int*>(baseFds.get());
-    size_t numFds = baseNumFds;
-    if (flattenFence(hidl_handle(nh), buffer, size, fds, numFds) != NO_ERROR) {
-        native_handle_delete(nh);
-        return false;
-    }
-    native_handle_delete(nh);
-
-    void const* constBuffer = static_cast<void const*>(baseBuffer.get());
-    size = baseSize;
-    int const* constFds = static_cast<int const*>(baseFds.get());
-    numFds = baseNumFds;
-    if (l->unflatten(constBuffer, size, constFds, numFds) != NO_ERROR) {
-        return false;
-    }
-
     return true;
 }
 
@@ -531,34 +498,64 @@ inline bool wrapAs(
         HGraphicBufferProducer::QueueBufferInput* t,
         native_handle_t** nh,
         BGraphicBufferProducer::QueueBufferInput const& l) {
-
-    size_t const baseSize = l.getFlattenedSize();
-    std::unique_ptr<uint8_t[]> baseBuffer(
-            new (std::nothrow) uint8_t[baseSize]);
-    if (!baseBuffer) {
-        return false;
-    }
-
-    size_t const baseNumFds = l.getFdCount();
-    std::unique_ptr<int[]> baseFds(
-            new (std::nothrow) int[baseNumFds]);
-    if (!baseFds) {
+    // This runs once per queued frame, so the scalar fields are copied
+    // directly instead of round-tripping the whole input through its
+    // flattened representation.
+    int64_t timestamp;
+    bool isAutoTimestamp;
+    android_dataspace dataSpace;
+    ::android::Rect crop(::android::Rect::EMPTY_RECT);
+    int scalingMode;
+    uint32_t transform;
+    uint32_t stickyTransform;
+    sp<Fence> fence;
+    bool getFrameTimestamps;
+    l.deflate(&timestamp, &isAutoTimestamp, &dataSpace, &crop, &scalingMode,
+            &transform, &fence, &stickyTransform, &getFrameTimestamps);
+    t->timestamp = timestamp;
+    t->isAutoTimestamp = static_cast<int32_t>(isAutoTimestamp);
+    t->dataSpace = static_cast<Dataspace>(dataSpace);
+    t->crop = HRect{
+            static_cast<int32_t>(crop.left),
+            static_cast<int32_t>(crop.top),
+            static_cast<int32_t>(crop.right),
+            static_cast<int32_t>(crop.bottom)};
+    t->scalingMode = static_cast<int32_t>(scalingMode);
+    t->transform = transform;
+    t->stickyTransform = stickyTransform;
+    t->getFrameTimestamps = getFrameTimestamps;
+
+    if (fence == nullptr) {
+        *nh = nullptr;
+        t->fence = hidl_handle();
+    } else if (!wrapAs(&(t->fence), nh, *fence)) {
         return false;
     }
 
-    void* buffer = static_cast<void*>(baseBuffer.get());
-    size_t size = baseSize;
-    int* fds = baseFds.get();
-    size_t numFds = baseNumFds;
-    if (l.flatten(buffer, size, fds, numFds) != NO_ERROR) {
-        return false;
+    // The surface damage keeps going through Region's flattened form so the
+    // HRegion matches what the old full round trip produced (including the
+    // trailing bounds rect of a multi-rect region). Damage regions are
+    // almost always empty or a single rect, so a stack buffer suffices.
+    ::android::Region const& damage = l.getSurfaceDamage();
+    size_t const regionSize = damage.getFlattenedSize();
+    uint8_t stackBuffer[256];
+    std::unique_ptr<uint8_t[]> heapBuffer;
+    void* regionBuffer = static_cast<void*>(stackBuffer);
+    if (regionSize > sizeof(stackBuffer)) {
+        heapBuffer.reset(new (std::nothrow) uint8_t[regionSize]);
+        if (!heapBuffer) {
+            return false;
+        }
+        regionBuffer = static_cast<void*>(heapBuffer.get());
     }
-
-    void const* constBuffer = static_cast<void const*>(baseBuffer.get());
-    size = baseSize;
-    int const* constFds = static_cast<int const*>(baseFds.get());
-    numFds = baseNumFds;
-    if (unflatten(t, nh, constBuffer, size, constFds, numFds) != NO_ERROR) {
+    void const* constBuffer = static_cast<void const*>(regionBuffer);
+    size_t size = regionSize;
+    if (damage.flatten(regionBuffer, regionSize) != NO_ERROR ||
+            unflatten(&(t->surfaceDamage), constBuffer, size) != NO_ERROR) {
+        if (*nh != nullptr) {
+            native_handle_delete(*nh);
+            *nh = nullptr;
+        }
         return false;
     }
 
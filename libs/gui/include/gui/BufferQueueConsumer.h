@@ -50,6 +50,13 @@ public:
     virtual status_t acquireBuffer(BufferItem* outBuffer,
             nsecs_t expectedPresent, uint64_t maxFrameNumber = 0) override;
 
+    // acquireBuffers acquires up to maxBuffers pending buffers while holding
+    // the BufferQueue lock only once, so a consumer that has fallen behind
+    // can drain the queue in a single call. See
+    // IGraphicBufferConsumer::acquireBuffers.
+    virtual status_t acquireBuffers(std::vector<BufferItem>* outBuffers,
+            nsecs_t expectedPresent, int maxBuffers) override;
+
     // See IGraphicBufferConsumer::detachBuffer
     virtual status_t detachBuffer(int slot);
 
@@ -72,6 +79,11 @@ public:
             const sp<Fence>& releaseFence, EGLDisplay display,
             EGLSyncKHR fence);
 
+    // releaseBuffers releases a batch of buffer slots back to the BufferQueue
+    // while holding the BufferQueue lock only once. See
+    // IGraphicBufferConsumer::releaseBuffers.
+    virtual status_t releaseBuffers(const std::vector<BufferItem>& buffers) override;
+
     // connect connects a consumer to the BufferQueue.  Only one
     // consumer may be connected, and when that consumer disconnects the
     // BufferQueue is placed into the "abandoned" state, causing most
@@ -146,6 +158,9 @@ public:
     virtual status_t getOccupancyHistory(bool forceFlush,
             std::vector<OccupancyTracker::Segment>* outHistory) override;
 
+    // See IGraphicBufferConsumer::setAdaptiveBufferCountEnabled
+    virtual status_t setAdaptiveBufferCountEnabled(bool enabled) override;
+
     // See IGraphicBufferConsumer::discardFreeBuffers
     virtual status_t discardFreeBuffers() override;
 
@@ -172,6 +187,21 @@ public:
     // End functions required for backwards compatibility
 
 private:
+    // The workhorse of acquireBuffer/acquireBuffers. The caller must hold
+    // mCore->mMutex and, after dropping it, must invoke onBufferReleased on
+    // *outListener once per buffer dropped by this call (counted into
+    // *outNumDroppedBuffers).
+    status_t acquireBufferLocked(BufferItem* outBuffer, nsecs_t expectedPresent,
+            uint64_t maxFrameNumber, sp<IProducerListener>* outListener,
+            int* outNumDroppedBuffers);
+
+    // The workhorse of releaseBuffer/releaseBuffers. The caller must hold
+    // mCore->mMutex and is responsible for broadcasting mDequeueCondition and
+    // notifying the producer listener on success.
+    status_t releaseBufferLocked(int slot, uint64_t frameNumber,
+            const sp<Fence>& releaseFence, EGLDisplay eglDisplay,
+            EGLSyncKHR eglFence);
+
     sp<BufferQueueCore> mCore;
 
     // This references mCore->mSlots. Lock mCore->mMutex while accessing.
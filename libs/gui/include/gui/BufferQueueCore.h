@@ -31,6 +31,7 @@
 #include <utils/Trace.h>
 #include <utils/Vector.h>
 
+#include <atomic>
 #include <list>
 #include <set>
 
@@ -115,6 +116,22 @@ private:
     int getMaxBufferCountLocked(bool asyncMode,
             bool dequeueBufferCannotBlock, int maxBufferCount) const;
 
+    // getEffectiveMaxBufferCountLocked returns getMaxBufferCountLocked
+    // clamped to the adaptive controller's current target when adaptive
+    // buffer counting is enabled. The result never goes below
+    // getMinMaxBufferCountLocked, so the producer/consumer pair can always
+    // make progress.
+    int getEffectiveMaxBufferCountLocked() const;
+
+    // updateAdaptiveBufferCountLocked periodically folds the occupancy data
+    // collected by mOccupancyTracker into mAdaptiveMaxBufferCount: segments
+    // during which the consumer fell behind (a third buffer was needed) grow
+    // the target immediately, while several consecutive segments where the
+    // consumer kept up shrink it by one. It is called wherever the occupancy
+    // changes and rate-limits itself to one update per
+    // ADAPTIVE_UPDATE_DELAY.
+    void updateAdaptiveBufferCountLocked();
+
     // clearBufferSlotLocked frees the GraphicBuffer and sync resources for the
     // given slot.
     void clearBufferSlotLocked(int slot);
@@ -135,6 +152,24 @@ private:
     // waitWhileAllocatingLocked blocks until mIsAllocating is false.
     void waitWhileAllocatingLocked() const;
 
+    // tryStageFreeSlotLocked publishes a slot that just became FREE into
+    // mStagedFreeSlots so BufferQueueProducer::dequeueBufferFastPath can
+    // claim it without taking mMutex. The slot must have a buffer that
+    // matches the current defaults and consumer usage, and staging it must
+    // not allow the producer to exceed mMaxDequeuedBufferCount; if any of
+    // the validated conditions cannot be met the slot is not staged and
+    // the caller must put it on the regular free list. Staged slots stay
+    // in mActiveBuffers so slot accounting is unchanged.
+    bool tryStageFreeSlotLocked(int slot);
+
+    // drainStagedSlotsLocked returns all staged slots to mFreeBuffers and
+    // waits out any in-flight fast-path dequeue, repeating until no claim
+    // hands its slot back into the mask. It must be called before
+    // any operation that searches the free lists or invalidates the
+    // conditions validated by tryStageFreeSlotLocked (defaults, consumer
+    // usage, connection state, slot adjustment, ...).
+    void drainStagedSlotsLocked();
+
 #if DEBUG_ONLY_CODE
     // validateConsistencyLocked ensures that the free lists are in sync with
     // the information stored in mSlots
@@ -187,9 +222,13 @@ private:
     // the producer.
     sp<IProducerListener> mLinkedToDeath;
 
-    // mConnectedProducerListener is used to handle the onBufferReleased
-    // notification.
+    // mConnectedProducerListener is used to handle the onBufferReleased and
+    // onQueueBufferOutputChanged notifications.
     sp<IProducerListener> mConnectedProducerListener;
+    // mBufferReleasedCbEnabled is used to indicate whether the connected
+    // producer listener wants the onBufferReleased notification; the listener
+    // itself is kept around regardless for onQueueBufferOutputChanged.
+    bool mBufferReleasedCbEnabled;
 
     // mSlots is an array of buffer slots that must be mirrored on the producer
     // side. This allows buffer ownership to be transferred between the producer
@@ -216,6 +255,20 @@ private:
     // mActiveBuffers contains all slots which have a non-FREE buffer attached.
     std::set<int> mActiveBuffers;
 
+    // mStagedFreeSlots is a bitmask of FREE slots (which also remain in
+    // mActiveBuffers) that have been validated for the lock-free dequeue
+    // fast path. Bits are set under mMutex by tryStageFreeSlotLocked and
+    // cleared either by a fast-path dequeue (no lock held) or by
+    // drainStagedSlotsLocked; a claim that fails its usage check restores
+    // its bit without the lock.
+    std::atomic<uint64_t> mStagedFreeSlots;
+
+    // mFastDequeuesInFlight counts fast-path dequeues that have claimed a
+    // staged slot but have not finished handing it out yet.
+    // drainStagedSlotsLocked waits for this to reach zero so lock holders
+    // never observe a slot in the middle of a fast-path transition.
+    std::atomic<int> mFastDequeuesInFlight;
+
     // mDequeueCondition is a condition variable used for dequeueBuffer in
     // synchronous mode.
     mutable Condition mDequeueCondition;
@@ -264,8 +317,9 @@ private:
     bool mBufferHasBeenQueued;
 
     // mFrameCounter is the free running counter, incremented on every
-    // successful queueBuffer call and buffer allocation.
-    uint64_t mFrameCounter;
+    // successful queueBuffer call and buffer allocation. It is atomic so
+    // the dequeue fast path can compute buffer ages without mMutex.
+    std::atomic<uint64_t> mFrameCounter;
 
     // mTransformHint is used to optimize for screen rotations.
     uint32_t mTransformHint;
@@ -288,8 +342,9 @@ private:
     bool mAllowAllocation;
 
     // mBufferAge tracks the age of the contents of the most recently dequeued
-    // buffer as the number of frames that have elapsed since it was last queued
-    uint64_t mBufferAge;
+    // buffer as the number of frames that have elapsed since it was last
+    // queued. Atomic because the dequeue fast path updates it without mMutex.
+    std::atomic<uint64_t> mBufferAge;
 
     // mGenerationNumber stores the current generation number of the attached
     // producer. Any attempt to attach a buffer with a different generation
@@ -334,6 +389,28 @@ private:
 
     OccupancyTracker mOccupancyTracker;
 
+    // How often the adaptive controller re-evaluates the occupancy history,
+    // and how many consecutive "consumer kept up" segments are needed before
+    // the buffer count shrinks. Growing has no such hysteresis so a janky
+    // consumer gets its extra buffer back within one update.
+    static constexpr nsecs_t ADAPTIVE_UPDATE_DELAY = ms2ns(500);
+    static constexpr int ADAPTIVE_SHRINK_SEGMENTS = 4;
+
+    // When true, the number of buffers the producer may have in flight is
+    // capped at mAdaptiveMaxBufferCount instead of the configured maximum.
+    // See IGraphicBufferConsumer::setAdaptiveBufferCountEnabled.
+    bool mAdaptiveBufferCountEnabled;
+
+    // The adaptive controller's current target for the total number of
+    // buffers in flight (dequeued + queued + acquired). Only meaningful
+    // while mAdaptiveBufferCountEnabled is true.
+    int mAdaptiveMaxBufferCount;
+
+    // The number of consecutive segments during which the consumer kept up,
+    // and the time of the last controller update.
+    int mAdaptiveQuietSegments;
+    nsecs_t mAdaptiveLastUpdateTime;
+
     const uint64_t mUniqueId;
 
 }; // class BufferQueueCore
@@ -113,6 +113,13 @@ public:
     virtual status_t queueBuffer(int slot,
             const QueueBufferInput& input, QueueBufferOutput* output);
 
+    // queueBufferAsync is the fire-and-forget variant of queueBuffer. The
+    // output fields are not returned to the caller; instead, the connected
+    // IProducerListener is notified through onQueueBufferOutputChanged when
+    // the default dimensions, transform hint, or the consumer-running-behind
+    // state change compared to the last notification.
+    virtual status_t queueBufferAsync(int slot, const QueueBufferInput& input);
+
     // cancelBuffer returns a dequeued buffer to the BufferQueue, but doesn't
     // queue it for use by the consumer.
     //
@@ -212,6 +219,14 @@ private:
     };
     status_t waitForFreeSlotThenRelock(FreeSlotCaller caller, int* found) const;
 
+    // dequeueBufferFastPath tries to claim a slot staged by
+    // BufferQueueCore::tryStageFreeSlotLocked using atomics only, for
+    // default-sized dequeues. Returns true and fills the outputs if a
+    // suitable staged slot was claimed; returns false if the caller must
+    // fall back to the locked dequeue path.
+    bool dequeueBufferFastPath(int* outSlot, sp<Fence>* outFence,
+            uint64_t usage, uint64_t* outBufferAge);
+
     sp<BufferQueueCore> mCore;
 
     // This references mCore->mSlots. Lock mCore->mMutex while accessing.
@@ -237,6 +252,14 @@ private:
     Rect mLastQueuedCrop;
     uint32_t mLastQueuedTransform;
 
+    // The QueueBufferOutput fields last pushed to the producer listener by
+    // queueBufferAsync, used to notify only on change. Protected by
+    // mCore->mMutex.
+    uint32_t mLastOutputWidth = 0;
+    uint32_t mLastOutputHeight = 0;
+    uint32_t mLastOutputTransformHint = 0;
+    bool mLastOutputRunningBehind = false;
+
     // Take-a-ticket system for ensuring that onFrame* callbacks are called in
     // the order that frames are queued. While the BufferQueue lock
     // (mCore->mMutex) is held, a ticket is retained by the producer. After
@@ -25,6 +25,8 @@
 
 #include <utils/StrongPointer.h>
 
+#include <atomic>
+
 namespace android {
 
 class Fence;
@@ -40,9 +42,15 @@ struct BufferState {
       mShared(false) {
     }
 
-    uint32_t mDequeueCount;
-    uint32_t mQueueCount;
-    uint32_t mAcquireCount;
+    // The counts are atomic so that the dequeue fast path can transition
+    // a staged slot from FREE to DEQUEUED without holding
+    // BufferQueueCore::mMutex, and so that lock holders can read the
+    // state of such a slot concurrently.  Transitions for a given slot
+    // are still serialized by slot ownership (or mMutex), so relaxed
+    // ordering suffices.
+    std::atomic<uint32_t> mDequeueCount;
+    std::atomic<uint32_t> mQueueCount;
+    std::atomic<uint32_t> mAcquireCount;
     bool mShared;
 
     // A buffer can be in one of five states, represented as below:
@@ -89,15 +97,15 @@ struct BufferState {
     }
 
     inline bool isDequeued() const {
-        return mDequeueCount > 0;
+        return mDequeueCount.load(std::memory_order_relaxed) > 0;
     }
 
     inline bool isQueued() const {
-        return mQueueCount > 0;
+        return mQueueCount.load(std::memory_order_relaxed) > 0;
     }
 
     inline bool isAcquired() const {
-        return mAcquireCount > 0;
+        return mAcquireCount.load(std::memory_order_relaxed) > 0;
     }
 
     inline bool isShared() const {
@@ -105,69 +113,72 @@ struct BufferState {
     }
 
     inline void reset() {
-        *this = BufferState();
+        mDequeueCount.store(0, std::memory_order_relaxed);
+        mQueueCount.store(0, std::memory_order_relaxed);
+        mAcquireCount.store(0, std::memory_order_relaxed);
+        mShared = false;
     }
 
     const char* string() const;
 
     inline void dequeue() {
-        mDequeueCount++;
+        mDequeueCount.fetch_add(1, std::memory_order_relaxed);
     }
 
     inline void detachProducer() {
-        if (mDequeueCount > 0) {
-            mDequeueCount--;
+        if (isDequeued()) {
+            mDequeueCount.fetch_sub(1, std::memory_order_relaxed);
         }
     }
 
     inline void attachProducer() {
-        mDequeueCount++;
+        mDequeueCount.fetch_add(1, std::memory_order_relaxed);
     }
 
     inline void queue() {
-        if (mDequeueCount > 0) {
-            mDequeueCount--;
+        if (isDequeued()) {
+            mDequeueCount.fetch_sub(1, std::memory_order_relaxed);
         }
-        mQueueCount++;
+        mQueueCount.fetch_add(1, std::memory_order_relaxed);
     }
 
     inline void cancel() {
-        if (mDequeueCount > 0) {
-            mDequeueCount--;
+        if (isDequeued()) {
+            mDequeueCount.fetch_sub(1, std::memory_order_relaxed);
         }
     }
 
     inline void freeQueued() {
-        if (mQueueCount > 0) {
-            mQueueCount--;
+        if (isQueued()) {
+            mQueueCount.fetch_sub(1, std::memory_order_relaxed);
         }
     }
 
     inline void acquire() {
-        if (mQueueCount > 0) {
-            mQueueCount--;
+        if (isQueued()) {
+            mQueueCount.fetch_sub(1, std::memory_order_relaxed);
         }
-        mAcquireCount++;
+        mAcquireCount.fetch_add(1, std::memory_order_relaxed);
     }
 
     inline void acquireNotInQueue() {
-        mAcquireCount++;
+        mAcquireCount.fetch_add(1, std::memory_order_relaxed);
     }
 
     inline void release() {
-        if (mAcquireCount > 0) {
-            mAcquireCount--;
+        if (isAcquired()) {
+            mAcquireCount.fetch_sub(1, std::memory_order_relaxed);
         }
     }
 
     inline void detachConsumer() {
-        if (mAcquireCount > 0) {
-            mAcquireCount--;
+        if (isAcquired()) {
+            mAcquireCount.fetch_sub(1, std::memory_order_relaxed);
         }
     }
 
     inline void attachConsumer() {
-        mAcquireCount++;
+        mAcquireCount.fetch_add(1, std::memory_order_relaxed);
     }
 };
 
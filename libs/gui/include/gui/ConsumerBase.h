@@ -45,6 +45,16 @@ public:
         // See IConsumerListener::onFrame{Available,Replaced}
         virtual void onFrameAvailable(const BufferItem& item) = 0;
         virtual void onFrameReplaced(const BufferItem& /* item */) {}
+        // Called instead of onFrameAvailable when frame callback coalescing
+        // is enabled (see setFrameAvailableCoalescing). The item is the most
+        // recently queued buffer and count is the number of buffers queued
+        // since the previous callback; per-buffer detail is available from
+        // acquireBuffer. The default implementation forwards to
+        // onFrameAvailable, ignoring the count.
+        virtual void onFramesAvailable(const BufferItem& item,
+                size_t /* count */) {
+            onFrameAvailable(item);
+        }
     };
 
     ~ConsumerBase() override;
@@ -77,6 +87,16 @@ public:
     // when a new frame becomes available.
     void setFrameAvailableListener(const wp<FrameAvailableListener>& listener);
 
+    // setFrameAvailableCoalescing enables or disables coalescing of frame
+    // notifications. While enabled, the listener receives a single
+    // onFramesAvailable callback per consumer wakeup: buffers queued before
+    // the consumer has acquired in response to the previous callback are
+    // accumulated and reported in the count of the next callback rather than
+    // delivered individually. This reduces handler thread churn for bursty
+    // producers. Listeners must acquire until NO_BUFFER_AVAILABLE after each
+    // callback to guarantee forward progress. Disabled by default.
+    void setFrameAvailableCoalescing(bool enabled);
+
     // See IGraphicBufferConsumer::detachBuffer
     status_t detachBuffer(int slot);
 
@@ -105,6 +125,9 @@ public:
     status_t getOccupancyHistory(bool forceFlush,
             std::vector<OccupancyTracker::Segment>* outHistory);
 
+    // See IGraphicBufferConsumer::setAdaptiveBufferCountEnabled
+    status_t setAdaptiveBufferCountEnabled(bool enabled);
+
     // See IGraphicBufferConsumer::discardFreeBuffers
     status_t discardFreeBuffers();
 
@@ -258,6 +281,16 @@ protected:
     Mutex mFrameAvailableMutex;
     wp<FrameAvailableListener> mFrameAvailableListener;
 
+    // mFrameAvailableCoalescing indicates whether frame notifications are
+    // coalesced into a single onFramesAvailable callback per consumer wakeup.
+    // While a callback is outstanding (mFrameCallbackPending), newly queued
+    // buffers only increment mCoalescedFrameCount; the pending flag is
+    // cleared when the consumer acquires a buffer. These members are
+    // protected by mFrameAvailableMutex.
+    bool mFrameAvailableCoalescing;
+    bool mFrameCallbackPending;
+    size_t mCoalescedFrameCount;
+
     // The ConsumerBase has-a BufferQueue and is responsible for creating this object
     // if none is supplied
     sp<IGraphicBufferConsumer> mConsumer;
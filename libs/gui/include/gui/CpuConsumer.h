@@ -111,6 +111,20 @@ class CpuConsumer : public ConsumerBase
     // lockNextBuffer.
     status_t unlockBuffer(const LockedBuffer &nativeBuffer);
 
+    // setPersistentMappingEnabled controls whether gralloc CPU mappings are
+    // kept across lock/unlock cycles. When enabled, the first lockNextBuffer
+    // for each buffer pays the usual gralloc lock cost and the mapping is
+    // cached per slot; subsequent locks of the same buffer only wait for the
+    // producer's fence and return the cached pointers, and unlockBuffer
+    // skips the gralloc unlock. This is only safe for buffers whose CPU
+    // access needs no per-lock cache maintenance (i.e. linear, CPU-coherent
+    // formats); for anything else leave it disabled.
+    //
+    // Cached mappings are dropped when a slot's buffer is freed, when
+    // persistent mapping is disabled again, or when the consumer is
+    // destroyed.
+    status_t setPersistentMappingEnabled(bool enabled);
+
   private:
     // Maximum number of buffers that can be locked at a time
     const size_t mMaxLockedBuffers;
@@ -138,14 +152,65 @@ class CpuConsumer : public ConsumerBase
         }
     };
 
+    // Cached CPU mapping of a buffer slot, kept across lock/unlock cycles
+    // when persistent mapping is enabled. The pointers stay valid for as
+    // long as mGraphicBuffer is held here, since the buffer stays locked.
+    struct PersistentMapping {
+        sp<GraphicBuffer> mGraphicBuffer;
+        uint8_t *mData;
+        uint32_t mStride;
+        uint8_t *mDataCb;
+        uint8_t *mDataCr;
+        uint32_t mChromaStride;
+        uint32_t mChromaStep;
+        PixelFormat mFlexFormat;
+
+        PersistentMapping() :
+                mData(NULL),
+                mStride(0),
+                mDataCb(NULL),
+                mDataCr(NULL),
+                mChromaStride(0),
+                mChromaStep(0),
+                mFlexFormat(PIXEL_FORMAT_NONE) {
+        }
+
+        void reset() {
+            mGraphicBuffer.clear();
+            mData = NULL;
+            mStride = 0;
+            mDataCb = NULL;
+            mDataCr = NULL;
+            mChromaStride = 0;
+            mChromaStep = 0;
+            mFlexFormat = PIXEL_FORMAT_NONE;
+        }
+    };
+
     size_t findAcquiredBufferLocked(uintptr_t id) const;
 
-    status_t lockBufferItem(const BufferItem& item, LockedBuffer* outBuffer) const;
+    status_t lockBufferItem(const BufferItem& item, LockedBuffer* outBuffer);
+
+    // Unmaps the cached mapping for the given slot, unless the user still
+    // holds it (in which case the entry is just cleared and the unlock
+    // happens on the user's unlockBuffer call).
+    void dropPersistentMappingLocked(int slotIndex);
+
+    // freeBufferLocked overrides the ConsumerBase method to also drop the
+    // slot's cached mapping.
+    virtual void freeBufferLocked(int slotIndex);
 
     Vector<AcquiredBuffer> mAcquiredBuffers;
 
     // Count of currently locked buffers
     size_t mCurrentLockedBuffers;
+
+    // Whether mappings are kept across lock/unlock cycles. See
+    // setPersistentMappingEnabled.
+    bool mPersistentMappingEnabled;
+
+    // Cached mappings, indexed by buffer slot
+    PersistentMapping mMappedSlots[BufferQueueDefs::NUM_BUFFER_SLOTS];
 };
 
 } // namespace android
@@ -80,12 +80,20 @@ public:
 public:
     /*
      * DisplayEventReceiver creates and registers an event connection with
-     * SurfaceFlinger. VSync events are disabled by default. Call setVSyncRate
-     * or requestNextVsync to receive them.
+     * SurfaceFlinger. With a zero vsyncRate, VSync events are disabled until
+     * setVsyncRate or requestNextVsync is called; a rate of N subscribes to
+     * every Nth vsync from creation, with vsyncPhase selecting which beat
+     * within the divisor fires (taken modulo the rate), so low-rate clients
+     * can be spread across vsyncs.
      * Other events start being delivered immediately.
+     *
+     * A non-zero eventQueueDepth grows the receive queue to hold at least
+     * that many events, for clients that drain the queue in batches at a
+     * lower rate than events arrive.
      */
     DisplayEventReceiver(
-            ISurfaceComposer::VsyncSource vsyncSource = ISurfaceComposer::eVsyncSourceApp);
+            ISurfaceComposer::VsyncSource vsyncSource = ISurfaceComposer::eVsyncSourceApp,
+            size_t eventQueueDepth = 0, uint32_t vsyncRate = 0, uint32_t vsyncPhase = 0);
 
     /*
      * ~DisplayEventReceiver severs the connection with SurfaceFlinger, new events
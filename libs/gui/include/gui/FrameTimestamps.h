@@ -107,6 +107,7 @@ struct CompositorTiming {
 // producer via deltas.
 class FrameEventHistory {
 public:
+    FrameEventHistory();
     virtual ~FrameEventHistory();
 
     FrameEvents* getFrame(uint64_t frameNumber);
@@ -114,10 +115,17 @@ public:
     void checkFencesForCompletion();
     void dump(String8& outString) const;
 
-    static constexpr size_t MAX_FRAME_HISTORY = 8;
+    // The depth of the ring unless a consumer asks for a deeper one via
+    // ConsumerFrameEventHistory::resizeFrameHistory.
+    static constexpr size_t DEFAULT_FRAME_HISTORY = 8;
+
+    // Hard cap on the ring depth and on the frame index sent over the wire.
+    static constexpr size_t MAX_FRAME_HISTORY = 128;
+
+    size_t size() const { return mFrames.size(); }
 
 protected:
-    std::array<FrameEvents, MAX_FRAME_HISTORY> mFrames;
+    std::vector<FrameEvents> mFrames;
 
     CompositorTiming mCompositorTiming;
 };
@@ -205,10 +213,18 @@ private:
 // The consumer's interface to FrameEventHistory
 class ConsumerFrameEventHistory : public FrameEventHistory {
 public:
+    ConsumerFrameEventHistory();
     ~ConsumerFrameEventHistory() override;
 
     void onDisconnect();
 
+    // resizeFrameHistory changes the depth of the history ring, between 1 and
+    // MAX_FRAME_HISTORY frames. Any events recorded so far are discarded, so
+    // this is best called right after the consumer is connected. The producer
+    // grows its ring to match as it receives deltas, so no producer-side
+    // configuration is needed.
+    void resizeFrameHistory(size_t depth);
+
     void initializeCompositorTiming(const CompositorTiming& compositorTiming);
 
     void addQueue(const NewFrameEventsEntry& newEntry);
@@ -225,9 +241,9 @@ public:
 
 private:
     void getFrameDelta(FrameEventHistoryDelta* delta,
-            const std::array<FrameEvents, MAX_FRAME_HISTORY>::iterator& frame);
+            const std::vector<FrameEvents>::iterator& frame);
 
-    std::array<FrameEventDirtyFields, MAX_FRAME_HISTORY> mFramesDirty;
+    std::vector<FrameEventDirtyFields> mFramesDirty;
 
     size_t mQueueOffset{0};
     size_t mCompositionOffset{0};
@@ -242,6 +258,10 @@ private:
 // through Binder.
 // Although this may be sent multiple times for the same frame as new
 // timestamps are set, Fences only need to be sent once.
+// The frame number and timestamps are varint-packed when flattened: the
+// timestamps are encoded relative to the posted time, which makes them
+// small, and pending ones take a single byte. With a deep history ring the
+// fixed-width encoding would dominate the transaction size.
 class FrameEventsDelta : public Flattenable<FrameEventsDelta> {
 friend class ProducerFrameEventHistory;
 public:
@@ -20,6 +20,7 @@
 #include <EGL/egl.h>
 #include <EGL/eglext.h>
 
+#include <gui/BufferItem.h>
 #include <gui/BufferQueueDefs.h>
 #include <gui/ConsumerBase.h>
 
@@ -89,6 +90,10 @@ public:
     GLConsumer(const sp<IGraphicBufferConsumer>& bq, uint32_t texureTarget,
             bool useFenceSync, bool isControlledByApp);
 
+    // The destructor stops the image precache thread, if one was started by
+    // setImagePrecachingEnabled.
+    virtual ~GLConsumer() override;
+
     // updateTexImage acquires the most recently queued buffer, and sets the
     // image contents of the target texture to it.
     //
@@ -175,6 +180,20 @@ public:
     // for use with bilinear filtering.
     void setFilteringEnabled(bool enabled);
 
+    // setStrictGLFenceWait controls what happens when the driver offers no
+    // way to wait for an acquire fence on the GPU (no EGL_KHR_wait_sync or
+    // no EGL_ANDROID_native_fence_sync).  By default updateTexImage blocks
+    // the calling thread until the fence signals; in strict mode it fails
+    // with INVALID_OPERATION instead, so a latency-sensitive consumer never
+    // silently stalls its GL thread for a frame.
+    void setStrictGLFenceWait(bool strict);
+
+    // getCpuFenceWaitCount returns the number of times this GLConsumer has
+    // had to block the CPU on an acquire fence because a GPU-side wait was
+    // unavailable.  A non-zero count on a device that advertises native
+    // fence sync indicates a configuration problem.
+    uint64_t getCpuFenceWaitCount() const;
+
     // getCurrentBuffer returns the buffer associated with the current image.
     // When outSlot is not nullptr, the current buffer slot index is also
     // returned.
@@ -232,8 +251,29 @@ public:
     // current at the time of the last call to detachFromContext.
     status_t attachToContext(uint32_t tex);
 
+    // setImagePrecachingEnabled starts (or stops) a worker thread that
+    // acquires newly queued buffers as soon as they become available and
+    // creates their EGLImages off the GL thread.  When the producer
+    // reallocates its buffers (e.g. after a resize or format change), the
+    // first updateTexImage for each new buffer normally blocks in
+    // eglCreateImageKHR; with precaching enabled that work happens on the
+    // worker instead, and updateTexImage just consumes the pre-acquired
+    // buffer.  eglCreateImageKHR does not require a current GL context, so
+    // the worker needs no EGL state of its own.
+    //
+    // Precaching only takes effect once this GLConsumer has latched an
+    // EGLDisplay, i.e. after the first call to updateTexImage or
+    // attachToContext.  Disabling does not drop a pending pre-acquired
+    // buffer; the next updateTexImage call consumes it as usual.
+    status_t setImagePrecachingEnabled(bool enabled);
+
 protected:
 
+    // onFrameAvailable overrides the ConsumerBase method to wake the image
+    // precache thread, if one is running, in addition to the ConsumerBase
+    // behavior.
+    virtual void onFrameAvailable(const BufferItem& item) override;
+
     // abandonLocked overrides the ConsumerBase method to clear
     // mCurrentTextureImage in addition to the ConsumerBase behavior.
     virtual void abandonLocked();
@@ -496,6 +536,71 @@ private:
     // attachToContext.
     bool mAttached;
 
+    // mStrictGLFenceWait indicates that doGLFenceWaitLocked should fail
+    // rather than fall back to a CPU wait on the acquire fence.  See
+    // setStrictGLFenceWait.
+    bool mStrictGLFenceWait;
+
+    // mCpuFenceWaitCount counts the CPU-blocking acquire fence waits taken
+    // by doGLFenceWaitLocked; mutable because that method is const.
+    mutable uint64_t mCpuFenceWaitCount;
+
+    // ImagePrecacheThread is the worker started by setImagePrecachingEnabled.
+    // It sleeps until onFrameAvailable signals it, then calls
+    // precacheNextBuffer on the GLConsumer.
+    class ImagePrecacheThread : public Thread {
+    public:
+        explicit ImagePrecacheThread(GLConsumer* consumer);
+
+        // signalWork wakes the worker to look for a newly queued buffer.
+        void signalWork();
+
+        // shutdown wakes the worker and waits for it to exit.
+        void shutdown();
+
+    private:
+        virtual bool threadLoop();
+
+        // The GLConsumer joins this thread before it is destroyed, so this
+        // bare back-pointer cannot dangle.  Holding an sp here would create
+        // a reference cycle.
+        GLConsumer* const mConsumer;
+
+        Mutex mWorkMutex;
+        Condition mWorkCondition;
+        bool mWorkPending;
+        bool mShutdown;
+    };
+
+    // precacheNextBuffer runs on the precache thread.  It acquires the next
+    // queued buffer, if any, creates its EGLImage without holding mMutex, and
+    // then publishes the buffer in mPrecachedItem for updateTexImage to
+    // consume.
+    void precacheNextBuffer();
+
+    // mImagePrecacheThread is the worker created by
+    // setImagePrecachingEnabled(true), or NULL when precaching is disabled.
+    sp<ImagePrecacheThread> mImagePrecacheThread;
+
+    // mImagePrecachingEnabled indicates whether the precache thread should
+    // pre-acquire buffers.  It is cleared before the thread is stopped so a
+    // worker that is already awake does no further work.
+    bool mImagePrecachingEnabled;
+
+    // mPrecachedItem is a buffer that the precache thread acquired and that
+    // updateTexImage has not consumed yet.  It is only valid while
+    // mHasPrecachedItem is true.
+    BufferItem mPrecachedItem;
+    bool mHasPrecachedItem;
+
+    // mPrecacheInProgress is true from the moment the precache thread
+    // acquires a buffer until its EGLImage creation - which happens outside
+    // of mMutex - is done.  mPrecacheCondition is broadcast when it goes
+    // false so updateTexImage can wait for the handoff instead of racing the
+    // worker for the buffer.
+    bool mPrecacheInProgress;
+    Condition mPrecacheCondition;
+
     // protects static initialization
     static Mutex sStaticInitLock;
 
@@ -80,6 +80,33 @@ public:
     virtual status_t acquireBuffer(BufferItem* buffer, nsecs_t presentWhen,
                                    uint64_t maxFrameNumber = 0) = 0;
 
+    // acquireBuffers attempts to acquire ownership of up to maxBuffers pending buffers in a
+    // single call, storing one BufferItem per acquired buffer in outBuffers (any previous
+    // contents of outBuffers are discarded). This allows a
+    // consumer that has fallen several frames behind to drain the queue with one binder
+    // transaction instead of one per buffer. The presentWhen parameter has the same meaning as
+    // in acquireBuffer and applies to every candidate buffer.
+    //
+    // At least one buffer must be acquired for the call to succeed; if some buffers were
+    // acquired and a later candidate could not be, the acquired buffers are returned and the
+    // call reports NO_ERROR.
+    //
+    // The default implementation loops over acquireBuffer. BufferQueueConsumer overrides it to
+    // acquire every buffer under a single lock hold.
+    //
+    // Return of NO_ERROR means at least one buffer was acquired.
+    //
+    // Return of a positive value means no buffer could be acquired at this time, but the user
+    // should try again later:
+    // * NO_BUFFER_AVAILABLE - no buffer is pending (nothing queued by producer)
+    // * PRESENT_LATER - the next buffer's timestamp is farther in the future
+    //
+    // Return of a negative value means an error has occurred:
+    // * BAD_VALUE - outBuffers was NULL or maxBuffers was not positive
+    // * INVALID_OPERATION - too many buffers have been acquired
+    virtual status_t acquireBuffers(std::vector<BufferItem>* outBuffers, nsecs_t presentWhen,
+                                    int maxBuffers);
+
     // detachBuffer attempts to remove all ownership of the buffer in the given slot from the buffer
     // queue. If this call succeeds, the slot will be freed, and there will be no way to obtain the
     // buffer from this interface. The freed slot will remain unallocated until either it is
@@ -144,6 +171,18 @@ public:
     // as we can finally finish converting away from EGL sync to native Android sync
     using ReleaseBuffer = decltype(&IGraphicBufferConsumer::releaseHelper);
 
+    // releaseBuffers releases a batch of buffer slots back to the BufferQueue in a single call.
+    // Each BufferItem identifies the buffer via its mSlot and mFrameNumber fields, and mFence is
+    // used as the release fence, with the same semantics as releaseBuffer. This is the
+    // counterpart of acquireBuffers and likewise saves one binder transaction per buffer.
+    //
+    // Every entry is processed even if an earlier one fails; the status of the first failing
+    // entry (including STALE_BUFFER_SLOT) is returned, otherwise NO_ERROR.
+    //
+    // The default implementation loops over releaseBuffer. BufferQueueConsumer overrides it to
+    // release every buffer under a single lock hold.
+    virtual status_t releaseBuffers(const std::vector<BufferItem>& buffers);
+
     // consumerConnect connects a consumer to the BufferQueue. Only one consumer may be connected,
     // and when that consumer disconnects the BufferQueue is placed into the "abandoned" state,
     // causing most interactions with the BufferQueue by the producer to fail. controlledByApp
@@ -264,6 +303,21 @@ public:
     virtual status_t getOccupancyHistory(bool forceFlush,
                                          std::vector<OccupancyTracker::Segment>* outHistory) = 0;
 
+    // setAdaptiveBufferCountEnabled enables or disables automatic tuning of the number of buffers
+    // the queue lets the producer keep in flight. When enabled, the queue watches the occupancy
+    // history: it shrinks toward a double-buffered pipeline (lower latency, fewer allocations)
+    // while the consumer keeps up, and grows back toward the configured count as soon as a
+    // segment shows the consumer falling behind. The producer is throttled in dequeueBuffer
+    // rather than failed when it hits the shrunken count, and the configured maximums are never
+    // exceeded. While enabled, the controller consumes the occupancy history, so
+    // getOccupancyHistory will return little or no data.
+    //
+    // Not supported in shared buffer mode.
+    //
+    // The default implementation does not support adaptive buffer counts and returns
+    // INVALID_OPERATION.
+    virtual status_t setAdaptiveBufferCountEnabled(bool enabled);
+
     // discardFreeBuffers releases all currently-free buffers held by the BufferQueue, in order to
     // reduce the memory consumption of the BufferQueue to the minimum possible without
     // discarding data.
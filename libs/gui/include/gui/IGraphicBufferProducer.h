@@ -409,6 +409,26 @@ public:
     virtual status_t queueBuffer(int slot, const QueueBufferInput& input,
             QueueBufferOutput* output) = 0;
 
+    // queueBufferAsync is a fire-and-forget variant of queueBuffer. The
+    // queued buffer is submitted over a oneway transaction and no
+    // QueueBufferOutput is returned; instead, implementations push the output
+    // fields they cache (default dimensions, transform hint, pending buffer
+    // count) to the connected IProducerListener via
+    // onQueueBufferOutputChanged whenever they change. This removes the
+    // synchronous round trip per frame, at the cost of queueing errors being
+    // reported through logs rather than the return value, so callers must
+    // opt in (see Surface::setQueueBufferAsync).
+    //
+    // input.getFrameTimestamps must be false, since there is no output to
+    // carry the timestamp delta back.
+    //
+    // The default implementation falls back to the synchronous queueBuffer
+    // call and discards the output.
+    virtual status_t queueBufferAsync(int slot, const QueueBufferInput& input) {
+        QueueBufferOutput output;
+        return queueBuffer(slot, input, &output);
+    }
+
     // cancelBuffer indicates that the client does not wish to fill in the
     // buffer associated with slot and transfers ownership of the slot back to
     // the server.
@@ -42,6 +42,15 @@ public:
     // multiple threads.
     virtual void onBufferReleased() = 0; // Asynchronous
     virtual bool needsReleaseNotify() = 0;
+
+    // onQueueBufferOutputChanged is called when the producer queued a buffer
+    // through the fire-and-forget IGraphicBufferProducer::queueBufferAsync
+    // path and the QueueBufferOutput fields the producer caches (default
+    // dimensions, transform hint, or whether the consumer is running behind)
+    // changed since the last notification. The default implementation ignores
+    // the notification.
+    virtual void onQueueBufferOutputChanged(uint32_t /*width*/, uint32_t /*height*/,
+            uint32_t /*transformHint*/, uint32_t /*numPendingBuffers*/) {} // Asynchronous
 };
 
 class IProducerListener : public ProducerListener, public IInterface
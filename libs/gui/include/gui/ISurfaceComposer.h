@@ -101,9 +101,17 @@ public:
     virtual sp<ISurfaceComposerClient> createScopedConnection(
             const sp<IGraphicBufferProducer>& parent) = 0;
 
-    /* return an IDisplayEventConnection */
+    /* return an IDisplayEventConnection
+     *
+     * vsyncRate 0 leaves vsync events disabled until setVsyncRate() or
+     * requestNextVsync() is called; a rate of N delivers every Nth vsync.
+     * vsyncPhase selects which beat within the divisor the connection fires
+     * on (taken modulo the rate), so low-rate clients can be spread across
+     * vsyncs instead of all waking on the same one.
+     */
     virtual sp<IDisplayEventConnection> createDisplayEventConnection(
-            VsyncSource vsyncSource = eVsyncSourceApp) = 0;
+            VsyncSource vsyncSource = eVsyncSourceApp, uint32_t vsyncRate = 0,
+            uint32_t vsyncPhase = 0) = 0;
 
     /* create a virtual display
      * requires ACCESS_SURFACE_FLINGER permission.
@@ -16,9 +16,13 @@
 
 #pragma once
 
+#include <vector>
+
 #include <binder/IInterface.h>
+#include <binder/Parcelable.h>
 #include <binder/SafeInterface.h>
 #include <ui/PixelFormat.h>
+#include <utils/String8.h>
 
 namespace android {
 
@@ -53,6 +57,44 @@ public:
                                    int32_t ownerUid, sp<IBinder>* handle,
                                    sp<IGraphicBufferProducer>* gbp) = 0;
 
+    // Describes one surface in a createSurfaces() batch. The fields mirror
+    // the createSurface() arguments.
+    struct SurfaceDescriptor : public Parcelable {
+        String8 name;
+        uint32_t width = 0;
+        uint32_t height = 0;
+        PixelFormat format = 0;
+        uint32_t flags = 0;
+        sp<IBinder> parent;
+        int32_t windowType = -1;
+        int32_t ownerUid = -1;
+
+        status_t writeToParcel(Parcel* parcel) const override;
+        status_t readFromParcel(const Parcel* parcel) override;
+    };
+
+    // The outcome of one createSurfaces() batch entry. handle and gbp are
+    // only valid when result is NO_ERROR.
+    struct CreatedSurface : public Parcelable {
+        status_t result = NO_INIT;
+        sp<IBinder> handle;
+        sp<IGraphicBufferProducer> gbp;
+
+        status_t writeToParcel(Parcel* parcel) const override;
+        status_t readFromParcel(const Parcel* parcel) override;
+    };
+
+    /*
+     * Creates a batch of surfaces in a single transaction and returns one
+     * result per descriptor, in order. Individual creations can fail
+     * without failing the batch; the return value only reflects
+     * transaction-level errors.
+     *
+     * Requires ACCESS_SURFACE_FLINGER permission
+     */
+    virtual status_t createSurfaces(const std::vector<SurfaceDescriptor>& descriptors,
+                                    std::vector<CreatedSurface>* outResults) = 0;
+
     /*
      * Requires ACCESS_SURFACE_FLINGER permission
      */
@@ -22,6 +22,7 @@
 
 #include <utils/Timers.h>
 
+#include <atomic>
 #include <deque>
 #include <unordered_map>
 
@@ -32,11 +33,8 @@ class String8;
 class OccupancyTracker
 {
 public:
-    OccupancyTracker()
-      : mPendingSegment(),
-        mSegmentHistory(),
-        mLastOccupancy(0),
-        mLastOccupancyChangeTime(0) {}
+    OccupancyTracker();
+    ~OccupancyTracker();
 
     struct Segment : public Parcelable {
         Segment()
@@ -69,9 +67,43 @@ public:
         bool usedThirdBuffer;
     };
 
+    // Always-on queue health counters.  Unlike the segment history these
+    // are never reset, are maintained with relaxed atomics so the hot paths
+    // stay cheap, and may be read at any time without holding the
+    // BufferQueue mutex -- including aggregated over every tracker in the
+    // process via getProcessQueueHealthStats().
+    struct QueueHealthStats {
+        // Wall time spent with 0, 1, 2 and 3-or-more buffers queued.
+        // Time at occupancy 0 bounds how long the consumer could have been
+        // starved; time in the last bucket is time the pipeline ran deep.
+        uint64_t timeAtOccupancyNs[4];
+
+        // Time the producer spent blocked inside dequeueBuffer waiting for
+        // a free slot, plus a histogram of individual wait durations
+        // (<1ms, <4ms, <16ms, >=16ms) for coarse percentiles without
+        // per-sample storage.
+        uint64_t producerWaitTimeNs;
+        uint64_t producerWaitCount;
+        uint64_t producerWaitHistogram[4];
+
+        void clear();
+        void add(const QueueHealthStats& other);
+    };
+
     void registerOccupancyChange(size_t occupancy);
     std::vector<Segment> getSegmentHistory(bool forceFlush);
 
+    // Called by the producer side after blocking in dequeueBuffer for
+    // waitTime nanoseconds.  Safe to call with the BufferQueue mutex held.
+    void registerDequeueWait(nsecs_t waitTime);
+
+    // Snapshots this tracker's health counters.
+    void getQueueHealthStats(QueueHealthStats* outStats) const;
+
+    // Sums the health counters of every BufferQueue in this process,
+    // including queues that have since been destroyed.
+    static void getProcessQueueHealthStats(QueueHealthStats* outStats);
+
 private:
     static constexpr size_t MAX_HISTORY_SIZE = 10;
     static constexpr nsecs_t NEW_SEGMENT_DELAY = ms2ns(100);
@@ -97,6 +129,16 @@ private:
     size_t mLastOccupancy;
     nsecs_t mLastOccupancyChangeTime;
 
+    // Health counters; see QueueHealthStats.  Updated with relaxed atomics
+    // from the producer/consumer paths, read lock-free by the stats
+    // getters.
+    static constexpr size_t NUM_OCCUPANCY_BUCKETS = 4;
+    static constexpr size_t NUM_WAIT_BUCKETS = 4;
+    std::atomic<uint64_t> mTimeAtOccupancyNs[NUM_OCCUPANCY_BUCKETS];
+    std::atomic<uint64_t> mProducerWaitTimeNs;
+    std::atomic<uint64_t> mProducerWaitCount;
+    std::atomic<uint64_t> mProducerWaitHistogram[NUM_WAIT_BUCKETS];
+
 }; // class OccupancyTracker
 
 } // namespace android
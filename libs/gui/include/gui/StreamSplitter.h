@@ -18,18 +18,21 @@
 #define ANDROID_GUI_STREAMSPLITTER_H
 
 #include <gui/IConsumerListener.h>
+#include <gui/IGraphicBufferProducer.h>
 #include <gui/IProducerListener.h>
 
 #include <utils/Condition.h>
 #include <utils/KeyedVector.h>
 #include <utils/Mutex.h>
 #include <utils/StrongPointer.h>
+#include <utils/Thread.h>
+
+#include <list>
 
 namespace android {
 
 class GraphicBuffer;
 class IGraphicBufferConsumer;
-class IGraphicBufferProducer;
 
 // StreamSplitter is an autonomous class that manages one input BufferQueue
 // and multiple output BufferQueues. By using the buffer attach and detach logic
@@ -70,7 +73,8 @@ private:
     // From IConsumerListener
     //
     // During this callback, we store some tracking information, detach the
-    // buffer from the input, and attach it to each of the outputs. This call
+    // buffer from the input, and hand it to the per-output workers, which
+    // attach and queue it to each of the outputs in parallel. This call
     // can block if there are too many outstanding buffers. If it blocks, it
     // will resume when onBufferReleasedByOutput releases a buffer back to the
     // input.
@@ -97,6 +101,21 @@ private:
     // onFrameAvailable call to proceed.
     void onBufferReleasedByOutput(const sp<IGraphicBufferProducer>& from);
 
+    // fanOutBufferToOutput attaches and queues buffer to the given output.
+    // It runs on an OutputWorker thread without mMutex held, so the binder
+    // calls to the outputs proceed in parallel; mMutex is only taken to
+    // update the buffer tracking state if the output turns out to have been
+    // abandoned.
+    void fanOutBufferToOutput(const sp<IGraphicBufferProducer>& output,
+            const sp<GraphicBuffer>& buffer,
+            const IGraphicBufferProducer::QueueBufferInput& input);
+
+    // releaseReferenceLocked increments the release count of the buffer and,
+    // if every output has now released it, returns it to the input and wakes
+    // any blocked onFrameAvailable call. This must be called with mMutex
+    // locked.
+    void releaseReferenceLocked(const sp<GraphicBuffer>& buffer);
+
     // When this is called, the splitter disconnects from (i.e., abandons) its
     // input queue and signals any waiting onFrameAvailable calls to wake up.
     // It still processes callbacks from other outputs, but only detaches their
@@ -126,6 +145,48 @@ private:
         sp<IGraphicBufferProducer> mOutput;
     };
 
+    // Each output gets a dedicated worker thread that performs the
+    // attachBuffer/queueBuffer calls for that output. onFrameAvailable only
+    // hands the acquired buffer to every worker, so a slow output delays its
+    // own copy of the stream without stalling the others, and the total
+    // fan-out latency is that of the slowest output instead of the sum of
+    // all of them. Work is processed in FIFO order to preserve the frame
+    // order on each output.
+    class OutputWorker : public Thread {
+    public:
+        OutputWorker(StreamSplitter* splitter,
+                const sp<IGraphicBufferProducer>& output);
+
+        // queueWork hands one buffer to this worker for attaching and
+        // queueing to its output. Must be called with mSplitter->mMutex held
+        // so that work is enqueued in the same order for every output.
+        void queueWork(const sp<GraphicBuffer>& buffer,
+                const IGraphicBufferProducer::QueueBufferInput& input);
+
+        // shutdown wakes the worker and waits for it to exit. Any work that
+        // has not started yet is discarded.
+        void shutdown();
+
+    private:
+        virtual bool threadLoop();
+
+        struct Work {
+            sp<GraphicBuffer> buffer;
+            IGraphicBufferProducer::QueueBufferInput input;
+        };
+
+        // The splitter joins all workers in its destructor (before any other
+        // teardown), so a bare pointer is safe here and avoids a reference
+        // cycle with the sp<OutputWorker> the splitter holds.
+        StreamSplitter* const mSplitter;
+        sp<IGraphicBufferProducer> mOutput;
+
+        Mutex mWorkMutex;
+        Condition mWorkCondition;
+        std::list<Work> mPendingWork;
+        bool mShutdown;
+    };
+
     class BufferTracker : public LightRefBase<BufferTracker> {
     public:
         BufferTracker(const sp<GraphicBuffer>& buffer);
@@ -173,6 +234,9 @@ private:
     sp<IGraphicBufferConsumer> mInput;
     Vector<sp<IGraphicBufferProducer> > mOutputs;
 
+    // One worker per output, at the same index as the output in mOutputs.
+    Vector<sp<OutputWorker> > mWorkers;
+
     // Map of GraphicBuffer IDs (GraphicBuffer::getId()) to buffer tracking
     // objects (which are mostly for counting how many outputs have released the
     // buffer, but also contain merged release fences).
@@ -31,6 +31,8 @@
 
 #include <system/window.h>
 
+#include <thread>
+
 namespace android {
 
 class ISurfaceComposer;
@@ -125,6 +127,28 @@ public:
     // See IGraphicBufferProducer::setDequeueTimeout
     status_t setDequeueTimeout(nsecs_t timeout);
 
+    /* Enables or disables speculative dequeue. When enabled, a worker thread
+     * dequeues the next buffer slot as soon as queueBuffer completes, so the
+     * next dequeueBuffer call usually consumes a locally cached (slot, fence)
+     * pair instead of blocking in IGraphicBufferProducer::dequeueBuffer. On a
+     * prefetch hit, NATIVE_WINDOW_LAST_DEQUEUE_DURATION reports the time the
+     * speculative dequeue spent in the producer. Disabled by default; has no
+     * effect in shared buffer mode.
+     */
+    status_t setDequeueBufferPrefetch(bool enable);
+
+    /* Enables or disables fire-and-forget buffer submission. When enabled,
+     * queueBuffer uses the oneway IGraphicBufferProducer::queueBufferAsync
+     * call and the QueueBufferOutput fields (default dimensions, transform
+     * hint, consumer-running-behind) are pushed back asynchronously through
+     * the producer listener when they change, removing one synchronous binder
+     * round trip per frame. Queueing errors are then only visible in the log,
+     * so callers must accept relaxed error reporting. Disabled by default;
+     * frames queued while frame timestamps are enabled fall back to the
+     * synchronous call.
+     */
+    status_t setQueueBufferAsync(bool enable);
+
     /*
      * Wait for frame number to increase past lastFrame for at most
      * timeoutNs. Useful for one thread to wait for another unknown
@@ -300,9 +324,36 @@ protected:
     void freeAllBuffers();
     int getSlotFromBufferLocked(android_native_buffer_t* buffer) const;
 
+    // Speculative dequeue. The worker thread parks on mPrefetchCondition and
+    // issues one IGBP::dequeueBuffer per request posted by
+    // triggerPrefetchLocked; the result is handed back under mMutex.
+    // invalidatePrefetchLocked bumps the prefetch generation so an in-flight
+    // result is cancelled by the worker itself instead of blocking the caller,
+    // which matters when the worker is stalled waiting for a free slot.
+    void prefetchThreadLoop();
+    void triggerPrefetchLocked();
+    void waitForPrefetchLocked();
+    void invalidatePrefetchLocked();
+    void discardPrefetchedBufferLocked();
+
+    // Called by ProducerListenerProxy when the BufferQueue pushes new
+    // QueueBufferOutput fields on the fire-and-forget queueBuffer path.
+    void onQueueBufferOutputChanged(uint32_t width, uint32_t height,
+            uint32_t transformHint, uint32_t numPendingBuffers);
+
     struct BufferSlot {
         sp<GraphicBuffer> buffer;
-        Region dirtyRegion;
+        // Region of this slot's buffer whose content is out of date with
+        // respect to the most recently posted frame. Maintained by the CPU
+        // rendering path (lock/unlockAndPost) so that copyback cost is
+        // proportional to the damage accumulated while the buffer sat in
+        // the queue, and reset whenever the slot's buffer is replaced.
+        Region staleRegion;
+        // Whether this slot's buffer has been through a full
+        // lock/unlockAndPost round since it was allocated, i.e. whether
+        // staleRegion describes real content rather than an uninitialized
+        // buffer.
+        bool hasPostedContent = false;
     };
 
     // mSurfaceTexture is the interface to the surface texture server. All
@@ -411,12 +462,11 @@ protected:
     sp<GraphicBuffer>           mPostedBuffer;
     bool                        mConnectedToCpu;
 
-    // When a CPU producer is attached, this reflects the region that the
-    // producer wished to update as well as whether the Surface was able to copy
-    // the previous buffer back to allow a partial update.
-    //
     // When a non-CPU producer is attached, this reflects the surface damage
-    // (the change since the previous frame) passed in by the producer.
+    // (the change since the previous frame) passed in by the producer. The
+    // CPU rendering path tracks damage per buffer slot instead (see
+    // BufferSlot::staleRegion) and always reports full damage to the
+    // consumer.
     Region mDirtyRegion;
 
     // mBufferAge tracks the age of the contents of the most recently dequeued
@@ -462,6 +512,55 @@ protected:
 
     bool mReportRemovedBuffers = false;
     std::vector<sp<GraphicBuffer>> mRemovedBuffers;
+
+    // State of one speculatively dequeued slot. Filled in by the prefetch
+    // thread and consumed (or cancelled) by dequeueBuffer under mMutex.
+    struct PrefetchedBuffer {
+        bool valid = false;
+        status_t result = NO_INIT;
+        int slot = -1;
+        sp<Fence> fence;
+        uint64_t bufferAge = 0;
+        nsecs_t dequeueDuration = 0;
+        FrameEventHistoryDelta frameTimestamps;
+
+        // The buffer request the speculative dequeue was issued with. A hit
+        // requires these to still match dequeueBuffer's current request.
+        uint32_t reqWidth = 0;
+        uint32_t reqHeight = 0;
+        PixelFormat reqFormat = 0;
+        uint64_t reqUsage = 0;
+        bool enableFrameTimestamps = false;
+
+        // Snapshot of mPrefetchGeneration when the request was posted. The
+        // worker cancels its own result if the generation moved on while the
+        // dequeue was in flight.
+        uint32_t generation = 0;
+    };
+
+    // Wraps the listener passed to connect() so the BufferQueue can push
+    // QueueBufferOutput changes back to this Surface on the fire-and-forget
+    // queueBuffer path. Defined in Surface.cpp.
+    class ProducerListenerProxy;
+
+    // Non-null once connect() has wrapped the caller's listener; required for
+    // the fire-and-forget path to receive output updates.
+    sp<IProducerListener> mListenerProxy;
+
+    // Whether queueBuffer should use the oneway
+    // IGraphicBufferProducer::queueBufferAsync call; see setQueueBufferAsync.
+    bool mQueueBufferAsync = false;
+
+    // Speculative dequeue state; see setDequeueBufferPrefetch. All fields are
+    // protected by mMutex, and mPrefetchCondition pairs with mMutex for the
+    // request/result handoff with the worker thread.
+    bool mPrefetchEnabled = false;
+    bool mPrefetchInFlight = false;
+    bool mPrefetchThreadExit = false;
+    uint32_t mPrefetchGeneration = 0;
+    PrefetchedBuffer mPrefetchedBuffer;
+    Condition mPrefetchCondition;
+    std::thread mPrefetchThread;
 };
 
 } // namespace android
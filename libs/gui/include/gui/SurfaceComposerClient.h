@@ -19,7 +19,7 @@
 
 #include <stdint.h>
 #include <sys/types.h>
-#include <unordered_map>
+#include <vector>
 
 #include <binder/IBinder.h>
 
@@ -33,6 +33,7 @@
 #include <ui/PixelFormat.h>
 
 #include <gui/CpuConsumer.h>
+#include <gui/ISurfaceComposerClient.h>
 #include <gui/SurfaceControl.h>
 #include <math/vec3.h>
 #include <gui/LayerState.h>
@@ -131,6 +132,13 @@ public:
             int32_t ownerUid = -1 // UID of the task
     );
 
+    //! Create several surfaces in one transaction. outSurfaces gets one
+    //! entry per descriptor, in order; entries that failed individually are
+    //! nullptr. Returns an error only if the batch itself could not run.
+    status_t createSurfaces(
+            const std::vector<ISurfaceComposerClient::SurfaceDescriptor>& descriptors,
+            std::vector<sp<SurfaceControl>>* outSurfaces);
+
     //! Create a virtual display
     static sp<IBinder> createDisplay(const String8& displayName, bool secure);
 
@@ -145,14 +153,16 @@ public:
 
     static status_t injectVSync(nsecs_t when);
 
-    struct SCHash {
-        std::size_t operator()(const sp<SurfaceControl>& sc) const {
-            return std::hash<SurfaceControl *>{}(sc.get());
-        }
-    };
-
     class Transaction {
-        std::unordered_map<sp<SurfaceControl>, ComposerState, SCHash> mComposerStates;
+        // The composer states are kept in an arena of slots that is reused
+        // across applies: releaseComposerStates() scrubs the live slots
+        // instead of destroying them, so their heap storage (notably the
+        // transparent region's) survives and building the next transaction
+        // does not allocate. The first mComposerStateCount slots are live;
+        // mComposerStateControls holds the matching SurfaceControl for each.
+        std::vector<ComposerState>  mComposerStates;
+        std::vector<sp<SurfaceControl>> mComposerStateControls;
+        size_t                      mComposerStateCount = 0;
         SortedVector<DisplayState > mDisplayStates;
         uint32_t                    mForceSynchronous = 0;
         uint32_t                    mTransactionNestCount = 0;
@@ -164,6 +174,10 @@ public:
         layer_state_t* getLayerState(const sp<SurfaceControl>& sc);
         DisplayState& getDisplayState(const sp<IBinder>& token);
 
+        // Scrubs the live composer states and returns their slots to the
+        // arena for reuse.
+        void releaseComposerStates();
+
     public:
         Transaction() = default;
         virtual ~Transaction() = default;
@@ -58,12 +58,25 @@ public:
     // resets this BitTube's receive file descriptor to receiveFd
     void setReceiveFd(base::unique_fd&& receiveFd);
 
+    // grows (or shrinks) the receive queue. Use this on the receiving end when more than a few
+    // messages may queue up between reads, e.g. for a client draining events in batches at a low
+    // rate; the default queue only holds about 4KB of messages.
+    status_t setReceiveBufferSize(size_t size);
+
     // send objects (sized blobs). All objects are guaranteed to be written or the call fails.
     template <typename T>
     static ssize_t sendObjects(BitTube* tube, T const* events, size_t count) {
         return sendObjects(tube, events, count, sizeof(T));
     }
 
+    // send objects as one message each, in a single syscall. Returns the number of objects sent,
+    // which may be less than count if the send buffer fills up. Use this instead of sendObjects
+    // when the receiving end drains with recvObjectsBatch.
+    template <typename T>
+    static ssize_t sendObjectsBatch(BitTube* tube, T const* events, size_t count) {
+        return sendObjectsBatch(tube, events, count, sizeof(T));
+    }
+
     // receive objects (sized blobs). If the receiving buffer isn't large enough, excess messages
     // are silently discarded.
     template <typename T>
@@ -71,6 +84,14 @@ public:
         return recvObjects(tube, events, count, sizeof(T));
     }
 
+    // receive objects from multiple queued messages in a single syscall. Every queued message
+    // must contain exactly one object, i.e. the sending end must use sendObjectsBatch or send
+    // objects one at a time.
+    template <typename T>
+    static ssize_t recvObjectsBatch(BitTube* tube, T* events, size_t count) {
+        return recvObjectsBatch(tube, events, count, sizeof(T));
+    }
+
     // implement the Parcelable protocol. Only parcels the receive file descriptor
     status_t writeToParcel(Parcel* reply) const;
     status_t readFromParcel(const Parcel* parcel);
@@ -90,7 +111,12 @@ private:
 
     static ssize_t sendObjects(BitTube* tube, void const* events, size_t count, size_t objSize);
 
+    static ssize_t sendObjectsBatch(BitTube* tube, void const* events, size_t count,
+                                    size_t objSize);
+
     static ssize_t recvObjects(BitTube* tube, void* events, size_t count, size_t objSize);
+
+    static ssize_t recvObjectsBatch(BitTube* tube, void* events, size_t count, size_t objSize);
 };
 
 } // namespace gui
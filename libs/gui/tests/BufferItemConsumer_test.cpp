@@ -203,4 +203,60 @@ TEST_F(BufferItemConsumerTest, TriggerBufferFreed_DeleteBufferItemConsumer) {
     ASSERT_EQ(1, GetFreedBufferCount());
 }
 
+// Test that frame callback coalescing delivers a single onFramesAvailable
+// per consumer wakeup and accumulates the count of suppressed frames.
+TEST_F(BufferItemConsumerTest, CoalescedFrameCallbacks) {
+    struct CountingFrameListener : public ConsumerBase::FrameAvailableListener {
+        void onFrameAvailable(const BufferItem& /* item */) override {
+            mSingleCalls++;
+        }
+        void onFramesAvailable(const BufferItem& /* item */,
+                size_t count) override {
+            mCoalescedCalls++;
+            mFrameCount += count;
+        }
+        int mSingleCalls{0};
+        int mCoalescedCalls{0};
+        size_t mFrameCount{0};
+    };
+    sp<CountingFrameListener> listener = new CountingFrameListener;
+    mBIC->setFrameAvailableListener(listener);
+    mBIC->setFrameAvailableCoalescing(true);
+
+    // In-process the listener is called synchronously from queueBuffer, so
+    // the counts below are deterministic. A burst of three queued buffers
+    // should produce a single callback; the two suppressed frames are
+    // reported in the count of the next one.
+    int slots[kMaxLockedBuffers];
+    for (int i = 0; i < kMaxLockedBuffers; i++) {
+        DequeueBuffer(&slots[i]);
+        QueueBuffer(slots[i]);
+    }
+    ASSERT_EQ(0, listener->mSingleCalls);
+    ASSERT_EQ(1, listener->mCoalescedCalls);
+    ASSERT_EQ(1u, listener->mFrameCount);
+
+    // Draining re-arms the callback; the next queued buffer triggers another
+    // callback carrying the two frames coalesced into the first burst.
+    for (int i = 0; i < kMaxLockedBuffers; i++) {
+        int slot;
+        AcquireBuffer(&slot);
+        ReleaseBuffer(slot);
+    }
+    int slot;
+    DequeueBuffer(&slot);
+    QueueBuffer(slot);
+    ASSERT_EQ(2, listener->mCoalescedCalls);
+    ASSERT_EQ(4u, listener->mFrameCount);
+    AcquireBuffer(&slot);
+    ReleaseBuffer(slot);
+
+    // Disabling coalescing restores the per-buffer callback.
+    mBIC->setFrameAvailableCoalescing(false);
+    DequeueBuffer(&slot);
+    QueueBuffer(slot);
+    ASSERT_EQ(1, listener->mSingleCalls);
+    ASSERT_EQ(2, listener->mCoalescedCalls);
+}
+
 }  // namespace android
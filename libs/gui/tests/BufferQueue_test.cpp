@@ -205,6 +205,45 @@ TEST_F(BufferQueueTest, AcquireBuffer_ExceedsMaxAcquireCount_Fails) {
     ASSERT_EQ(INVALID_OPERATION, mConsumer->acquireBuffer(&item, 0));
 }
 
+TEST_F(BufferQueueTest, AcquireBuffers_BatchesPendingBuffers) {
+    createBufferQueue();
+    sp<DummyConsumer> dc(new DummyConsumer);
+    mConsumer->consumerConnect(dc, false);
+    ASSERT_EQ(OK, mConsumer->setMaxAcquiredBufferCount(3));
+    IGraphicBufferProducer::QueueBufferOutput qbo;
+    mProducer->connect(new DummyProducerListener, NATIVE_WINDOW_API_CPU, false,
+            &qbo);
+    mProducer->setMaxDequeuedBufferCount(3);
+
+    int slot;
+    sp<Fence> fence;
+    sp<GraphicBuffer> buf;
+    IGraphicBufferProducer::QueueBufferInput qbi(0, false,
+            HAL_DATASPACE_UNKNOWN, Rect(0, 0, 1, 1),
+            NATIVE_WINDOW_SCALING_MODE_FREEZE, 0, Fence::NO_FENCE);
+
+    for (int i = 0; i < 3; i++) {
+        ASSERT_EQ(IGraphicBufferProducer::BUFFER_NEEDS_REALLOCATION,
+                  mProducer->dequeueBuffer(&slot, &fence, 1, 1, 0, GRALLOC_USAGE_SW_READ_OFTEN,
+                                           nullptr, nullptr));
+        ASSERT_EQ(OK, mProducer->requestBuffer(slot, &buf));
+        ASSERT_EQ(OK, mProducer->queueBuffer(slot, qbi, &qbo));
+    }
+
+    // All three pending buffers should come back in a single call
+    std::vector<BufferItem> items;
+    ASSERT_EQ(OK, mConsumer->acquireBuffers(&items, 0, 8));
+    ASSERT_EQ(3u, items.size());
+
+    // The batch release should return every slot to the producer
+    ASSERT_EQ(OK, mConsumer->releaseBuffers(items));
+
+    // With nothing pending, a batch acquire reports NO_BUFFER_AVAILABLE
+    ASSERT_EQ(IGraphicBufferConsumer::NO_BUFFER_AVAILABLE,
+              mConsumer->acquireBuffers(&items, 0, 8));
+    ASSERT_TRUE(items.empty());
+}
+
 TEST_F(BufferQueueTest, SetMaxAcquiredBufferCountWithIllegalValues_ReturnsError) {
     createBufferQueue();
     sp<DummyConsumer> dc(new DummyConsumer);
@@ -318,6 +357,21 @@ TEST_F(BufferQueueTest, SetMaxBufferCountWithIllegalValues_ReturnsError) {
     EXPECT_EQ(BAD_VALUE, mConsumer->setMaxBufferCount(3));
 }
 
+TEST_F(BufferQueueTest, SetAdaptiveBufferCountEnabled) {
+    createBufferQueue();
+    sp<DummyConsumer> dc(new DummyConsumer);
+    mConsumer->consumerConnect(dc, false);
+
+    EXPECT_EQ(OK, mConsumer->setAdaptiveBufferCountEnabled(true));
+    // Enabling twice is a no-op
+    EXPECT_EQ(OK, mConsumer->setAdaptiveBufferCountEnabled(true));
+    EXPECT_EQ(OK, mConsumer->setAdaptiveBufferCountEnabled(false));
+
+    // The adaptive controller is not supported in shared buffer mode
+    ASSERT_EQ(OK, mProducer->setSharedBufferMode(true));
+    EXPECT_EQ(BAD_VALUE, mConsumer->setAdaptiveBufferCountEnabled(true));
+}
+
 TEST_F(BufferQueueTest, DetachAndReattachOnProducerSide) {
     createBufferQueue();
     sp<DummyConsumer> dc(new DummyConsumer);
@@ -998,6 +1052,57 @@ TEST_F(BufferQueueTest, TestOccupancyHistory) {
     ASSERT_EQ(true, thirdSegment.usedThirdBuffer);
 }
 
+TEST_F(BufferQueueTest, TestQueueHealthStats) {
+    createBufferQueue();
+    sp<DummyConsumer> dc(new DummyConsumer);
+    ASSERT_EQ(OK, mConsumer->consumerConnect(dc, false));
+    IGraphicBufferProducer::QueueBufferOutput output;
+    ASSERT_EQ(OK, mProducer->connect(new DummyProducerListener,
+            NATIVE_WINDOW_API_CPU, false, &output));
+
+    // The health counters are only reachable process-wide, so measure the
+    // delta this queue's activity produces on top of whatever other queues
+    // in the test process have accumulated.
+    OccupancyTracker::QueueHealthStats before;
+    OccupancyTracker::getProcessQueueHealthStats(&before);
+
+    int slot = BufferQueue::INVALID_BUFFER_SLOT;
+    sp<Fence> fence = Fence::NO_FENCE;
+    sp<GraphicBuffer> buffer = nullptr;
+    IGraphicBufferProducer::QueueBufferInput input(0ull, true,
+        HAL_DATASPACE_UNKNOWN, Rect::INVALID_RECT,
+        NATIVE_WINDOW_SCALING_MODE_FREEZE, 0, Fence::NO_FENCE);
+    BufferItem item{};
+
+    // Cycle a few frames, dwelling both with the queue empty and with one
+    // buffer queued so both occupancy buckets accumulate time.
+    for (size_t i = 0; i < 3; ++i) {
+        ASSERT_EQ(IGraphicBufferProducer::BUFFER_NEEDS_REALLOCATION,
+                mProducer->dequeueBuffer(&slot, &fence, 0, 0, 0, 0, nullptr, nullptr));
+        ASSERT_EQ(OK, mProducer->requestBuffer(slot, &buffer));
+        ASSERT_EQ(OK, mProducer->queueBuffer(slot, input, &output));
+        std::this_thread::sleep_for(16ms);
+        ASSERT_EQ(OK, mConsumer->acquireBuffer(&item, 0));
+        ASSERT_EQ(OK, mConsumer->releaseBuffer(item.mSlot, item.mFrameNumber,
+                EGL_NO_DISPLAY, EGL_NO_SYNC_KHR, Fence::NO_FENCE));
+        std::this_thread::sleep_for(16ms);
+    }
+    // One more occupancy change so the time spent at the last level above
+    // gets charged.
+    ASSERT_EQ(OK, mProducer->dequeueBuffer(&slot, &fence, 0, 0, 0, 0, nullptr, nullptr));
+    ASSERT_EQ(OK, mProducer->queueBuffer(slot, input, &output));
+
+    OccupancyTracker::QueueHealthStats after;
+    OccupancyTracker::getProcessQueueHealthStats(&after);
+
+    ASSERT_GT(after.timeAtOccupancyNs[0], before.timeAtOccupancyNs[0]);
+    ASSERT_GT(after.timeAtOccupancyNs[1], before.timeAtOccupancyNs[1]);
+    // The producer never had to wait for a slot, so wait counters must not
+    // have moved on this queue's account alone; they can only have grown
+    // from other queues, never shrunk.
+    ASSERT_GE(after.producerWaitCount, before.producerWaitCount);
+}
+
 TEST_F(BufferQueueTest, TestDiscardFreeBuffers) {
     createBufferQueue();
     sp<DummyConsumer> dc(new DummyConsumer);
@@ -565,6 +565,49 @@ TEST_P(CpuConsumerTest, FromCpuSingle) {
     mCC->unlockBuffer(b);
 }
 
+// This test is disabled because the HAL_PIXEL_FORMAT_RAW16 format is not
+// supported on all devices.
+TEST_P(CpuConsumerTest, FromCpuPersistentMapping) {
+    status_t err;
+    CpuConsumerTestParams params = GetParam();
+
+    // Set up
+
+    ASSERT_NO_FATAL_FAILURE(configureANW(mANW, params, 1));
+    ASSERT_EQ(OK, mCC->setPersistentMappingEnabled(true));
+
+    // Produce and consume the same buffer twice; the second lock must reuse
+    // the cached mapping.
+
+    uint8_t* firstData = NULL;
+    for (int i = 0; i < 2; i++) {
+        const int64_t time = 12345678L + i;
+        uint32_t stride;
+        ASSERT_NO_FATAL_FAILURE(produceOneFrame(mANW, params, time, &stride));
+
+        CpuConsumer::LockedBuffer b;
+        err = mCC->lockNextBuffer(&b);
+        ASSERT_NO_ERROR(err, "getNextBuffer error: ");
+
+        ASSERT_TRUE(b.data != NULL);
+        EXPECT_EQ(params.width,  b.width);
+        EXPECT_EQ(params.height, b.height);
+        EXPECT_EQ(params.format, b.format);
+        EXPECT_EQ(time, b.timestamp);
+
+        checkAnyBuffer(b, GetParam().format);
+
+        if (i == 0) {
+            firstData = b.data;
+        } else {
+            // With a single buffer in flight the same buffer comes around
+            // again, so the cached mapping must be returned.
+            EXPECT_EQ(firstData, b.data);
+        }
+        mCC->unlockBuffer(b);
+    }
+}
+
 // This test is disabled because the HAL_PIXEL_FORMAT_RAW16 format is not
 // supported on all devices.
 TEST_P(CpuConsumerTest, FromCpuManyInQueue) {
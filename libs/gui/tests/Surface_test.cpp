@@ -396,6 +396,94 @@ TEST_F(SurfaceTest, DynamicSetBufferCount) {
     ASSERT_EQ(NO_ERROR, window->queueBuffer(window.get(), buffer, fence));
 }
 
+TEST_F(SurfaceTest, DequeueBufferPrefetch) {
+    sp<IGraphicBufferProducer> producer;
+    sp<IGraphicBufferConsumer> consumer;
+    BufferQueue::createBufferQueue(&producer, &consumer);
+
+    sp<DummyConsumer> dummyConsumer(new DummyConsumer);
+    consumer->consumerConnect(dummyConsumer, false);
+    consumer->setConsumerName(String8("TestConsumer"));
+
+    sp<Surface> surface = new Surface(producer);
+    sp<ANativeWindow> window(surface);
+
+    ASSERT_EQ(NO_ERROR, native_window_api_connect(window.get(),
+            NATIVE_WINDOW_API_CPU));
+    native_window_set_buffer_count(window.get(), 4);
+    ASSERT_EQ(NO_ERROR, surface->setDequeueBufferPrefetch(true));
+
+    // The first dequeue takes the synchronous path; the queueBuffer below
+    // posts a speculative dequeue that the next dequeueBuffer can consume.
+    int fence;
+    ANativeWindowBuffer* buffer;
+    ASSERT_EQ(NO_ERROR, window->dequeueBuffer(window.get(), &buffer, &fence));
+    ASSERT_EQ(NO_ERROR, window->queueBuffer(window.get(), buffer, fence));
+    ASSERT_EQ(NO_ERROR, window->dequeueBuffer(window.get(), &buffer, &fence));
+    ASSERT_EQ(NO_ERROR, window->queueBuffer(window.get(), buffer, fence));
+
+    // Changing the buffer request after a prefetch was issued must not
+    // return a stale buffer.
+    ASSERT_EQ(NO_ERROR, native_window_set_buffers_dimensions(window.get(),
+            16, 16));
+    ASSERT_EQ(NO_ERROR, window->dequeueBuffer(window.get(), &buffer, &fence));
+    EXPECT_EQ(16, buffer->width);
+    EXPECT_EQ(16, buffer->height);
+    ASSERT_EQ(NO_ERROR, window->cancelBuffer(window.get(), buffer, fence));
+
+    // Disabling returns any held slot and restores the synchronous path.
+    ASSERT_EQ(NO_ERROR, surface->setDequeueBufferPrefetch(false));
+    ASSERT_EQ(NO_ERROR, window->dequeueBuffer(window.get(), &buffer, &fence));
+    ASSERT_EQ(NO_ERROR, window->queueBuffer(window.get(), buffer, fence));
+
+    ASSERT_EQ(NO_ERROR, native_window_api_disconnect(window.get(),
+            NATIVE_WINDOW_API_CPU));
+}
+
+TEST_F(SurfaceTest, QueueBufferAsyncOutputChange) {
+    sp<IGraphicBufferProducer> producer;
+    sp<IGraphicBufferConsumer> consumer;
+    BufferQueue::createBufferQueue(&producer, &consumer);
+
+    sp<DummyConsumer> dummyConsumer(new DummyConsumer);
+    consumer->consumerConnect(dummyConsumer, false);
+    consumer->setConsumerName(String8("TestConsumer"));
+
+    sp<Surface> surface = new Surface(producer);
+    sp<ANativeWindow> window(surface);
+
+    ASSERT_EQ(NO_ERROR, native_window_api_connect(window.get(),
+            NATIVE_WINDOW_API_CPU));
+    native_window_set_buffer_count(window.get(), 4);
+    ASSERT_EQ(NO_ERROR, surface->setQueueBufferAsync(true));
+
+    int fence;
+    ANativeWindowBuffer* buffer;
+    ASSERT_EQ(NO_ERROR, window->dequeueBuffer(window.get(), &buffer, &fence));
+    ASSERT_EQ(NO_ERROR, window->queueBuffer(window.get(), buffer, fence));
+
+    // Default dimension changes must reach the Surface through the producer
+    // listener instead of the (skipped) QueueBufferOutput.
+    ASSERT_EQ(NO_ERROR, consumer->setDefaultBufferSize(32, 64));
+    ASSERT_EQ(NO_ERROR, window->dequeueBuffer(window.get(), &buffer, &fence));
+    ASSERT_EQ(NO_ERROR, window->queueBuffer(window.get(), buffer, fence));
+
+    int value = -1;
+    ASSERT_EQ(NO_ERROR, window->query(window.get(),
+            NATIVE_WINDOW_DEFAULT_WIDTH, &value));
+    EXPECT_EQ(32, value);
+    ASSERT_EQ(NO_ERROR, window->query(window.get(),
+            NATIVE_WINDOW_DEFAULT_HEIGHT, &value));
+    EXPECT_EQ(64, value);
+
+    ASSERT_EQ(NO_ERROR, surface->setQueueBufferAsync(false));
+    ASSERT_EQ(NO_ERROR, window->dequeueBuffer(window.get(), &buffer, &fence));
+    ASSERT_EQ(NO_ERROR, window->queueBuffer(window.get(), buffer, fence));
+
+    ASSERT_EQ(NO_ERROR, native_window_api_disconnect(window.get(),
+            NATIVE_WINDOW_API_CPU));
+}
+
 TEST_F(SurfaceTest, GetAndFlushRemovedBuffers) {
     sp<IGraphicBufferProducer> producer;
     sp<IGraphicBufferConsumer> consumer;
@@ -540,8 +628,8 @@ public:
             const sp<IGraphicBufferProducer>& /* parent */) override {
         return nullptr;
     }
-    sp<IDisplayEventConnection> createDisplayEventConnection(ISurfaceComposer::VsyncSource)
-            override {
+    sp<IDisplayEventConnection> createDisplayEventConnection(ISurfaceComposer::VsyncSource,
+            uint32_t /*vsyncRate*/, uint32_t /*vsyncPhase*/) override {
         return nullptr;
     }
     sp<IBinder> createDisplay(const String8& /*displayName*/,
@@ -1667,4 +1755,62 @@ TEST_F(GetFrameTimestampsTest, PresentUnsupportedNoSync) {
     EXPECT_EQ(-1, outDisplayPresentTime);
 }
 
+// This test verifies that a delta from a history ring deeper than the
+// default round-trips through the packed wire format and that the producer
+// grows its own ring to match the consumer's.
+TEST(FrameEventHistoryTest, DeltaFlattenRoundTrip) {
+    const size_t kDefaultDepth = FrameEventHistory::DEFAULT_FRAME_HISTORY;
+    const size_t kDepth = 16;
+    const uint64_t kFrameCount = kDefaultDepth + 2;
+
+    ConsumerFrameEventHistory consumer;
+    consumer.resizeFrameHistory(kDepth);
+    EXPECT_EQ(kDepth, consumer.size());
+
+    for (uint64_t f = 1; f <= kFrameCount; f++) {
+        NewFrameEventsEntry entry;
+        entry.frameNumber = f;
+        entry.postedTime = 1000000000 + f * 16666667;
+        entry.requestedPresentTime = entry.postedTime + 33333333;
+        entry.acquireFence = FenceTime::NO_FENCE;
+        consumer.addQueue(entry);
+        consumer.addLatch(f, entry.postedTime + 4000000);
+    }
+
+    FrameEventHistoryDelta delta;
+    consumer.getAndResetDelta(&delta);
+
+    std::vector<uint8_t> buffer(delta.getFlattenedSize());
+    void* flattenPtr = buffer.data();
+    size_t flattenSize = buffer.size();
+    int* flattenFds = nullptr;
+    size_t fdCount = delta.getFdCount();
+    ASSERT_EQ(0u, fdCount);
+    ASSERT_EQ(NO_ERROR,
+            delta.flatten(flattenPtr, flattenSize, flattenFds, fdCount));
+    EXPECT_EQ(0u, flattenSize);
+
+    FrameEventHistoryDelta unflattenedDelta;
+    void const* unflattenPtr = buffer.data();
+    size_t unflattenSize = buffer.size();
+    int const* unflattenFds = nullptr;
+    fdCount = 0;
+    ASSERT_EQ(NO_ERROR, unflattenedDelta.unflatten(
+            unflattenPtr, unflattenSize, unflattenFds, fdCount));
+
+    ProducerFrameEventHistory producer;
+    EXPECT_EQ(kDefaultDepth, producer.size());
+    producer.applyDelta(unflattenedDelta);
+    EXPECT_LT(kDefaultDepth, producer.size());
+
+    for (uint64_t f = 1; f <= kFrameCount; f++) {
+        FrameEvents* frame = producer.getFrame(f);
+        ASSERT_NE(nullptr, frame);
+        EXPECT_EQ(1000000000 + f * 16666667, static_cast<uint64_t>(frame->postedTime));
+        EXPECT_EQ(frame->postedTime + 33333333, frame->requestedPresentTime);
+        EXPECT_EQ(frame->postedTime + 4000000, frame->latchTime);
+        EXPECT_FALSE(FrameEvents::isValidTimestamp(frame->dequeueReadyTime));
+    }
+}
+
 } // namespace android
@@ -19,6 +19,7 @@
 
 #include <math.h>
 #include <limits.h>
+#include <string.h>
 
 #include <input/Input.h>
 #include <input/InputEventLabels.h>
@@ -190,10 +191,7 @@ bool PointerCoords::operator==(const PointerCoords& other) const {
 
 void PointerCoords::copyFrom(const PointerCoords& other) {
     bits = other.bits;
-    uint32_t count = BitSet64::count(bits);
-    for (uint32_t i = 0; i < count; i++) {
-        values[i] = other.values[i];
-    }
+    memcpy(values, other.values, BitSet64::count(bits) * sizeof(values[0]));
 }
 
 
@@ -347,9 +345,12 @@ void MotionEvent::scale(float scaleFactor) {
     mXPrecision *= scaleFactor;
     mYPrecision *= scaleFactor;
 
+    // Resolve the copy-on-write storage once instead of paying the
+    // editItemAt() check for every sample of every pointer.
     size_t numSamples = mSamplePointerCoords.size();
+    PointerCoords* coords = mSamplePointerCoords.editArray();
     for (size_t i = 0; i < numSamples; i++) {
-        mSamplePointerCoords.editItemAt(i).scale(scaleFactor);
+        coords[i].scale(scaleFactor);
     }
 }
 
@@ -406,8 +407,9 @@ void MotionEvent::transform(const float matrix[9]) {
 
     // Apply the transformation to all samples.
     size_t numSamples = mSamplePointerCoords.size();
+    PointerCoords* coords = mSamplePointerCoords.editArray();
     for (size_t i = 0; i < numSamples; i++) {
-        PointerCoords& c = mSamplePointerCoords.editItemAt(i);
+        PointerCoords& c = coords[i];
         float x = c.getAxisValue(AMOTION_EVENT_AXIS_X) + oldXOffset;
         float y = c.getAxisValue(AMOTION_EVENT_AXIS_Y) + oldYOffset;
         transformPoint(matrix, x, y, &x, &y);
@@ -44,9 +44,16 @@ static const size_t SOCKET_BUFFER_SIZE = 32 * 1024;
 static const nsecs_t NANOS_PER_MS = 1000000;
 
 // Latency added during resampling.  A few milliseconds doesn't hurt much but
-// reduces the impact of mispredicted touch positions.
+// reduces the impact of mispredicted touch positions.  This is the fallback
+// used until the panel's scan cadence has been observed; once it has, the
+// latency adapts to half the scan interval, clamped to the bounds below, so
+// that the resample point is usually bracketed by two real samples.
 static const nsecs_t RESAMPLE_LATENCY = 5 * NANOS_PER_MS;
 
+// Bounds on the adaptive resample latency derived from the touch scan cadence.
+static const nsecs_t RESAMPLE_MIN_LATENCY = 2 * NANOS_PER_MS;
+static const nsecs_t RESAMPLE_MAX_LATENCY = 8 * NANOS_PER_MS;
+
 // Minimum time difference between consecutive samples before attempting to resample.
 static const nsecs_t RESAMPLE_MIN_DELTA = 2 * NANOS_PER_MS;
 
@@ -200,7 +207,7 @@ void InputMessage::getSanitizedCopy(InputMessage* msg) const {
 // --- InputChannel ---
 
 InputChannel::InputChannel(const std::string& name, int fd) :
-        mName(name), mFd(fd) {
+        mName(name), mFd(fd), mReceiveBufferIndex(0) {
 #if DEBUG_CHANNEL_LIFECYCLE
     ALOGD("Input channel constructed: name='%s', fd=%d",
             mName.c_str(), fd);
@@ -287,12 +294,59 @@ status_t InputChannel::sendMessage(const InputMessage* msg) {
 }
 
 status_t InputChannel::receiveMessage(InputMessage* msg) {
-    ssize_t nRead;
+    // Serve messages buffered by an earlier batch receive first.
+    if (mReceiveBufferIndex < mReceiveBuffer.size()) {
+        const BufferedMessage& buffered = mReceiveBuffer[mReceiveBufferIndex];
+        uint32_t length = buffered.length;
+        memcpy(msg, &buffered.msg, length);
+        mReceiveBufferIndex += 1;
+        if (mReceiveBufferIndex == mReceiveBuffer.size()) {
+            mReceiveBuffer.clear();
+            mReceiveBufferIndex = 0;
+        }
+        if (length == 0) { // check for EOF
+#if DEBUG_CHANNEL_MESSAGES
+            ALOGD("channel '%s' ~ receive message failed because peer was closed",
+                    mName.c_str());
+#endif
+            return DEAD_OBJECT;
+        }
+        if (!msg->isValid(length)) {
+#if DEBUG_CHANNEL_MESSAGES
+            ALOGD("channel '%s' ~ received invalid message", mName.c_str());
+#endif
+            return BAD_VALUE;
+        }
+#if DEBUG_CHANNEL_MESSAGES
+        ALOGD("channel '%s' ~ received message of type %d", mName.c_str(), msg->header.type);
+#endif
+        return OK;
+    }
+
+    // Receive up to RECEIVE_BATCH_SIZE pending datagrams in one syscall.  The
+    // first goes straight into the caller's buffer; any extras are spilled into
+    // mReceiveBuffer and handed out by later calls without touching the kernel.
+    InputMessage spill[RECEIVE_BATCH_SIZE - 1];
+    struct mmsghdr msgs[RECEIVE_BATCH_SIZE];
+    struct iovec iovs[RECEIVE_BATCH_SIZE];
+    memset(msgs, 0, sizeof(msgs));
+    iovs[0].iov_base = msg;
+    iovs[0].iov_len = sizeof(InputMessage);
+    for (size_t i = 1; i < RECEIVE_BATCH_SIZE; i++) {
+        iovs[i].iov_base = &spill[i - 1];
+        iovs[i].iov_len = sizeof(InputMessage);
+    }
+    for (size_t i = 0; i < RECEIVE_BATCH_SIZE; i++) {
+        msgs[i].msg_hdr.msg_iov = &iovs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    int nReceived;
     do {
-        nRead = ::recv(mFd, msg, sizeof(InputMessage), MSG_DONTWAIT);
-    } while (nRead == -1 && errno == EINTR);
+        nReceived = ::recvmmsg(mFd, msgs, RECEIVE_BATCH_SIZE, MSG_DONTWAIT, NULL);
+    } while (nReceived == -1 && errno == EINTR);
 
-    if (nRead < 0) {
+    if (nReceived < 0) {
         int error = errno;
 #if DEBUG_CHANNEL_MESSAGES
         ALOGD("channel '%s' ~ receive message failed, errno=%d", mName.c_str(), errno);
@@ -306,14 +360,21 @@ status_t InputChannel::receiveMessage(InputMessage* msg) {
         return -error;
     }
 
-    if (nRead == 0) { // check for EOF
+    for (int i = 1; i < nReceived; i++) {
+        mReceiveBuffer.push_back(BufferedMessage());
+        BufferedMessage& buffered = mReceiveBuffer.back();
+        buffered.length = msgs[i].msg_len;
+        memcpy(&buffered.msg, &spill[i - 1], sizeof(InputMessage));
+    }
+
+    if (nReceived == 0 || msgs[0].msg_len == 0) { // check for EOF
 #if DEBUG_CHANNEL_MESSAGES
         ALOGD("channel '%s' ~ receive message failed because peer was closed", mName.c_str());
 #endif
         return DEAD_OBJECT;
     }
 
-    if (!msg->isValid(nRead)) {
+    if (!msg->isValid(msgs[0].msg_len)) {
 #if DEBUG_CHANNEL_MESSAGES
         ALOGD("channel '%s' ~ received invalid message", mName.c_str());
 #endif
@@ -478,6 +539,10 @@ status_t InputPublisher::receiveFinishedSignal(uint32_t* outSeq, bool* outHandle
 
 InputConsumer::InputConsumer(const sp<InputChannel>& channel) :
         mResampleTouch(isTouchResamplingEnabled()),
+        mTrackLatency(isLatencyTrackingEnabled()),
+        mLatencySampleCount(0),
+        mConsumeLatencySum(0), mConsumeLatencyMax(0),
+        mFrameLatencySum(0), mFrameLatencyMax(0),
         mChannel(channel), mMsgDeferred(false) {
 }
 
@@ -499,6 +564,12 @@ bool InputConsumer::isTouchResamplingEnabled() {
     return true;
 }
 
+bool InputConsumer::isLatencyTrackingEnabled() {
+    char value[PROPERTY_VALUE_MAX];
+    int length = property_get("debug.input.consumer_latency", value, NULL);
+    return length > 0 && !strcmp("1", value);
+}
+
 status_t InputConsumer::consume(InputEventFactoryInterface* factory,
         bool consumeBatches, nsecs_t frameTime, uint32_t* outSeq, InputEvent** outEvent,
         int32_t* displayId) {
@@ -634,7 +705,7 @@ status_t InputConsumer::consumeBatch(InputEventFactoryInterface* factory,
 
         nsecs_t sampleTime = frameTime;
         if (mResampleTouch) {
-            sampleTime -= RESAMPLE_LATENCY;
+            sampleTime -= getResampleLatency(batch);
         }
         ssize_t split = findSampleNoLaterThan(batch, sampleTime);
         if (split < 0) {
@@ -652,12 +723,70 @@ status_t InputConsumer::consumeBatch(InputEventFactoryInterface* factory,
         if (!result && mResampleTouch) {
             resampleTouchState(sampleTime, static_cast<MotionEvent*>(*outEvent), next);
         }
+        if (!result && mTrackLatency) {
+            trackLatency(static_cast<MotionEvent*>(*outEvent), frameTime);
+        }
         return result;
     }
 
     return WOULD_BLOCK;
 }
 
+nsecs_t InputConsumer::getResampleLatency(const Batch& batch) const {
+    const InputMessage& head = batch.samples.itemAt(0);
+    if (head.body.motion.source & AINPUT_SOURCE_CLASS_POINTER) {
+        ssize_t index = findTouchState(head.body.motion.deviceId, head.body.motion.source);
+        if (index >= 0) {
+            nsecs_t scanInterval = mTouchStates.itemAt(index).scanInterval;
+            if (scanInterval > 0) {
+                // Trail the frame by half a scan interval so the resample point
+                // is usually between two real samples (interpolation) rather
+                // than ahead of the newest one (extrapolation).
+                nsecs_t latency = scanInterval / 2;
+                if (latency < RESAMPLE_MIN_LATENCY) {
+                    latency = RESAMPLE_MIN_LATENCY;
+                } else if (latency > RESAMPLE_MAX_LATENCY) {
+                    latency = RESAMPLE_MAX_LATENCY;
+                }
+                return latency;
+            }
+        }
+    }
+    return RESAMPLE_LATENCY;
+}
+
+void InputConsumer::trackLatency(const MotionEvent* event, nsecs_t frameTime) {
+    nsecs_t eventTime = event->getEventTime();
+    nsecs_t consumeLatency = systemTime(SYSTEM_TIME_MONOTONIC) - eventTime;
+    nsecs_t frameLatency = frameTime >= 0 ? frameTime - eventTime : 0;
+
+    mLatencySampleCount += 1;
+    mConsumeLatencySum += consumeLatency;
+    if (consumeLatency > mConsumeLatencyMax) {
+        mConsumeLatencyMax = consumeLatency;
+    }
+    mFrameLatencySum += frameLatency;
+    if (frameLatency > mFrameLatencyMax) {
+        mFrameLatencyMax = frameLatency;
+    }
+
+    if (mLatencySampleCount >= 500) {
+        ALOGD("channel '%s' ~ latency over %" PRId64 " batches: "
+                "event-to-consume avg=%0.2fms max=%0.2fms, "
+                "event-to-frame avg=%0.2fms max=%0.2fms",
+                mChannel->getName().c_str(), mLatencySampleCount,
+                mConsumeLatencySum / (mLatencySampleCount * 1000000.0),
+                mConsumeLatencyMax / 1000000.0,
+                mFrameLatencySum / (mLatencySampleCount * 1000000.0),
+                mFrameLatencyMax / 1000000.0);
+        mLatencySampleCount = 0;
+        mConsumeLatencySum = 0;
+        mConsumeLatencyMax = 0;
+        mFrameLatencySum = 0;
+        mFrameLatencyMax = 0;
+    }
+}
+
 status_t InputConsumer::consumeSamples(InputEventFactoryInterface* factory,
         Batch& batch, size_t count, uint32_t* outSeq, InputEvent** outEvent, int32_t* displayId) {
     MotionEvent* motionEvent = factory->createMotionEvent();
@@ -867,7 +996,14 @@ void InputConsumer::resampleTouchState(nsecs_t sampleTime, MotionEvent* event,
 #endif
             return;
         }
-        nsecs_t maxPredict = current->eventTime + min(delta / 2, RESAMPLE_MAX_PREDICTION);
+        // Never predict further ahead than half the observed scan interval;
+        // on fast panels the next real sample is close, so long predictions
+        // only add jitter that gets corrected a frame later.
+        nsecs_t maxPrediction = RESAMPLE_MAX_PREDICTION;
+        if (touchState.scanInterval > 0) {
+            maxPrediction = min(maxPrediction, touchState.scanInterval / 2);
+        }
+        nsecs_t maxPredict = current->eventTime + min(delta / 2, maxPrediction);
         if (sampleTime > maxPredict) {
 #if DEBUG_RESAMPLING
             ALOGD("Sample time is too far in the future, adjusting prediction "
@@ -18,6 +18,10 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
+
+#include <map>
+#include <utility>
 
 #ifdef __ANDROID__
 #include <binder/Parcel.h>
@@ -30,6 +34,7 @@
 
 #include <utils/Log.h>
 #include <utils/Errors.h>
+#include <utils/Mutex.h>
 #include <utils/Tokenizer.h>
 #include <utils/Timers.h>
 
@@ -106,10 +111,38 @@ KeyCharacterMap::~KeyCharacterMap() {
     }
 }
 
+// Cache of parsed key character maps, keyed by file name and format.  Like key
+// layout maps, character maps are immutable once parsed (combine() copies its
+// inputs) and most devices share the same files, so device hotplug hits the
+// cache instead of re-running the tokenizer.  Entries are revalidated against
+// the file's size and modification time on every lookup.
+struct CachedKeyCharacterMap {
+    sp<KeyCharacterMap> map;
+    off_t size;
+    time_t mtime;
+};
+typedef std::pair<String8, int32_t> CachedKeyCharacterMapKey;
+static Mutex gCacheLock;
+static std::map<CachedKeyCharacterMapKey, CachedKeyCharacterMap> gCache;
+
 status_t KeyCharacterMap::load(const String8& filename,
         Format format, sp<KeyCharacterMap>* outMap) {
     outMap->clear();
 
+    CachedKeyCharacterMapKey cacheKey(filename, int32_t(format));
+    struct stat st;
+    bool haveStat = !stat(filename.string(), &st);
+    if (haveStat) {
+        AutoMutex _l(gCacheLock);
+        std::map<CachedKeyCharacterMapKey, CachedKeyCharacterMap>::const_iterator it =
+                gCache.find(cacheKey);
+        if (it != gCache.end() && it->second.size == st.st_size
+                && it->second.mtime == st.st_mtime) {
+            *outMap = it->second.map;
+            return OK;
+        }
+    }
+
     Tokenizer* tokenizer;
     status_t status = Tokenizer::open(filename, &tokenizer);
     if (status) {
@@ -117,6 +150,13 @@ status_t KeyCharacterMap::load(const String8& filename,
     } else {
         status = load(tokenizer, format, outMap);
         delete tokenizer;
+        if (!status && haveStat) {
+            AutoMutex _l(gCacheLock);
+            CachedKeyCharacterMap& entry = gCache[cacheKey];
+            entry.map = *outMap;
+            entry.size = st.st_size;
+            entry.mtime = st.st_mtime;
+        }
     }
     return status;
 }
@@ -17,6 +17,9 @@
 #define LOG_TAG "KeyLayoutMap"
 
 #include <stdlib.h>
+#include <sys/stat.h>
+
+#include <map>
 
 #include <android/keycodes.h>
 #include <input/InputEventLabels.h>
@@ -24,6 +27,7 @@
 #include <input/KeyLayoutMap.h>
 #include <utils/Log.h>
 #include <utils/Errors.h>
+#include <utils/Mutex.h>
 #include <utils/Tokenizer.h>
 #include <utils/Timers.h>
 
@@ -43,6 +47,20 @@ static const char* WHITESPACE = " \t\r";
 
 // --- KeyLayoutMap ---
 
+// Cache of parsed key layout maps, keyed by file name.  Layout maps are
+// immutable once parsed and most external devices resolve to the same file
+// (typically Generic.kl), so device hotplug hits the cache instead of
+// re-running the tokenizer.  An entry is revalidated against the file's size
+// and modification time on every lookup.  The set of distinct layout files on
+// a device is small, so the cache is not bounded.
+struct CachedKeyLayoutMap {
+    sp<KeyLayoutMap> map;
+    off_t size;
+    time_t mtime;
+};
+static Mutex gCacheLock;
+static std::map<String8, CachedKeyLayoutMap> gCache;
+
 KeyLayoutMap::KeyLayoutMap() {
 }
 
@@ -52,6 +70,18 @@ KeyLayoutMap::~KeyLayoutMap() {
 status_t KeyLayoutMap::load(const String8& filename, sp<KeyLayoutMap>* outMap) {
     outMap->clear();
 
+    struct stat st;
+    bool haveStat = !stat(filename.string(), &st);
+    if (haveStat) {
+        AutoMutex _l(gCacheLock);
+        std::map<String8, CachedKeyLayoutMap>::const_iterator it = gCache.find(filename);
+        if (it != gCache.end() && it->second.size == st.st_size
+                && it->second.mtime == st.st_mtime) {
+            *outMap = it->second.map;
+            return OK;
+        }
+    }
+
     Tokenizer* tokenizer;
     status_t status = Tokenizer::open(filename, &tokenizer);
     if (status) {
@@ -75,6 +105,13 @@ status_t KeyLayoutMap::load(const String8& filename, sp<KeyLayoutMap>* outMap) {
 #endif
             if (!status) {
                 *outMap = map;
+                if (haveStat) {
+                    AutoMutex _l(gCacheLock);
+                    CachedKeyLayoutMap& entry = gCache[filename];
+                    entry.map = map;
+                    entry.size = st.st_size;
+                    entry.mtime = st.st_mtime;
+                }
             }
         }
         delete tokenizer;
@@ -562,42 +562,58 @@ static bool solveLeastSquares(const float* x, const float* y,
 
 /*
  * Optimized unweighted second-order least squares fit. About 2x speed improvement compared to
- * the default implementation
+ * the default implementation.
+ *
+ * Solves both axes in a single pass: the sums of powers of x (time) and the
+ * denominator are identical for the two fits, so sharing them roughly halves
+ * the arithmetic of fitting each axis independently, and the single loop over
+ * the sample window is straightforward for the compiler to vectorize.
  */
-static float solveUnweightedLeastSquaresDeg2(const float* x, const float* y, size_t count) {
-    float sxi = 0, sxiyi = 0, syi = 0, sxi2 = 0, sxi3 = 0, sxi2yi = 0, sxi4 = 0;
+static void solveUnweightedLeastSquaresDeg2(const float* x, const float* y, const float* z,
+        size_t count, float* outBy, float* outBz) {
+    float sxi = 0, sxi2 = 0, sxi3 = 0, sxi4 = 0;
+    float syi = 0, sxiyi = 0, sxi2yi = 0;
+    float szi = 0, sxizi = 0, sxi2zi = 0;
 
     for (size_t i = 0; i < count; i++) {
         float xi = x[i];
         float yi = y[i];
+        float zi = z[i];
         float xi2 = xi*xi;
         float xi3 = xi2*xi;
         float xi4 = xi3*xi;
-        float xi2yi = xi2*yi;
-        float xiyi = xi*yi;
 
         sxi += xi;
         sxi2 += xi2;
-        sxiyi += xiyi;
-        sxi2yi += xi2yi;
-        syi += yi;
         sxi3 += xi3;
         sxi4 += xi4;
+        syi += yi;
+        sxiyi += xi*yi;
+        sxi2yi += xi2*yi;
+        szi += zi;
+        sxizi += xi*zi;
+        sxi2zi += xi2*zi;
     }
 
     float Sxx = sxi2 - sxi*sxi / count;
-    float Sxy = sxiyi - sxi*syi / count;
     float Sxx2 = sxi3 - sxi*sxi2 / count;
-    float Sx2y = sxi2yi - sxi2*syi / count;
     float Sx2x2 = sxi4 - sxi2*sxi2 / count;
 
-    float numerator = Sxy*Sx2x2 - Sx2y*Sxx2;
     float denominator = Sxx*Sx2x2 - Sxx2*Sxx2;
     if (denominator == 0) {
         ALOGW("division by 0 when computing velocity, Sxx=%f, Sx2x2=%f, Sxx2=%f", Sxx, Sx2x2, Sxx2);
-        return 0;
+        *outBy = 0;
+        *outBz = 0;
+        return;
     }
-    return numerator/denominator;
+
+    float Sxy = sxiyi - sxi*syi / count;
+    float Sx2y = sxi2yi - sxi2*syi / count;
+    float Sxz = sxizi - sxi*szi / count;
+    float Sx2z = sxi2zi - sxi2*szi / count;
+
+    *outBy = (Sxy*Sx2x2 - Sx2y*Sxx2) / denominator;
+    *outBz = (Sxz*Sx2x2 - Sx2z*Sxx2) / denominator;
 }
 
 bool LeastSquaresVelocityTrackerStrategy::getEstimator(uint32_t id,
@@ -647,8 +663,8 @@ bool LeastSquaresVelocityTrackerStrategy::getEstimator(uint32_t id,
             outEstimator->confidence = 1;
             outEstimator->xCoeff[0] = 0; // only slope is calculated, set rest of coefficients = 0
             outEstimator->yCoeff[0] = 0;
-            outEstimator->xCoeff[1] = solveUnweightedLeastSquaresDeg2(time, x, m);
-            outEstimator->yCoeff[1] = solveUnweightedLeastSquaresDeg2(time, y, m);
+            solveUnweightedLeastSquaresDeg2(time, x, y, m,
+                    &outEstimator->xCoeff[1], &outEstimator->yCoeff[1]);
             outEstimator->xCoeff[2] = 0;
             outEstimator->yCoeff[2] = 0;
             return true;
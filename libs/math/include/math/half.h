@@ -21,6 +21,14 @@
 #include <limits>
 #include <type_traits>
 
+#if defined(__ARM_NEON) && defined(__ARM_FP) && (__ARM_FP & 2)
+#define ANDROID_HALF_USE_NEON 1
+#include <arm_neon.h>
+#elif defined(__F16C__)
+#define ANDROID_HALF_USE_F16C 1
+#include <immintrin.h>
+#endif
+
 #ifndef LIKELY
 #define LIKELY_DEFINED_LOCAL
 #ifdef __cplusplus
@@ -110,7 +118,7 @@ inline CONSTEXPR half::fp16 half::ftoh(float v) noexcept {
         int e = static_cast<int>(in.getE()) - 127 + 15;
         if (e >= 0x1F) {
             // overflow
-            out.setE(0x31); // +/- inf
+            out.setE(0x1F); // +/- inf
         } else if (e <= 0) {
             // underflow
             // flush to +/- 0
@@ -154,6 +162,100 @@ inline CONSTEXPR android::half operator"" _hf(long double v) {
     return android::half(android::half::binary, android::half::ftoh(static_cast<float>(v)).bits);
 }
 
+/*
+ * Bulk float <-> half conversion for pixel buffers (RGBA16F readback and
+ * upload paths convert megapixels per frame through these).
+ *
+ * On ARM with the half-precision extension and on x86 with F16C the loops
+ * use the hardware converters, four values per instruction, including for
+ * the tail so a buffer is converted with uniform semantics.  The hardware
+ * rounds to nearest-even and converts half denormals exactly, whereas the
+ * scalar fallback (like the half class) flushes denormals to zero; pixel
+ * pipelines do not care, but do not use these to compare conversions
+ * bit-for-bit against the scalar path.
+ */
+inline void convert(const float* in, half* out, size_t count) noexcept {
+    static_assert(sizeof(half) == sizeof(uint16_t), "half must be 16 bits");
+#if defined(ANDROID_HALF_USE_NEON)
+    uint16_t* dst = reinterpret_cast<uint16_t*>(out);
+    while (count >= 4) {
+        vst1_u16(dst, vreinterpret_u16_f16(vcvt_f16_f32(vld1q_f32(in))));
+        in += 4;
+        dst += 4;
+        count -= 4;
+    }
+    if (count > 0) {
+        float tmpIn[4] = { 0 };
+        uint16_t tmpOut[4];
+        for (size_t i = 0; i < count; i++) tmpIn[i] = in[i];
+        vst1_u16(tmpOut, vreinterpret_u16_f16(vcvt_f16_f32(vld1q_f32(tmpIn))));
+        for (size_t i = 0; i < count; i++) dst[i] = tmpOut[i];
+    }
+#elif defined(ANDROID_HALF_USE_F16C)
+    uint16_t* dst = reinterpret_cast<uint16_t*>(out);
+    while (count >= 4) {
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(dst),
+                _mm_cvtps_ph(_mm_loadu_ps(in), _MM_FROUND_TO_NEAREST_INT));
+        in += 4;
+        dst += 4;
+        count -= 4;
+    }
+    if (count > 0) {
+        float tmpIn[4] = { 0 };
+        alignas(16) uint16_t tmpOut[8];
+        for (size_t i = 0; i < count; i++) tmpIn[i] = in[i];
+        _mm_store_si128(reinterpret_cast<__m128i*>(tmpOut),
+                _mm_cvtps_ph(_mm_loadu_ps(tmpIn), _MM_FROUND_TO_NEAREST_INT));
+        for (size_t i = 0; i < count; i++) dst[i] = tmpOut[i];
+    }
+#else
+    for (size_t i = 0; i < count; i++) {
+        out[i] = half(in[i]);
+    }
+#endif
+}
+
+inline void convert(const half* in, float* out, size_t count) noexcept {
+    static_assert(sizeof(half) == sizeof(uint16_t), "half must be 16 bits");
+#if defined(ANDROID_HALF_USE_NEON)
+    const uint16_t* src = reinterpret_cast<const uint16_t*>(in);
+    while (count >= 4) {
+        vst1q_f32(out, vcvt_f32_f16(vreinterpret_f16_u16(vld1_u16(src))));
+        src += 4;
+        out += 4;
+        count -= 4;
+    }
+    if (count > 0) {
+        uint16_t tmpIn[4] = { 0 };
+        float tmpOut[4];
+        for (size_t i = 0; i < count; i++) tmpIn[i] = src[i];
+        vst1q_f32(tmpOut, vcvt_f32_f16(vreinterpret_f16_u16(vld1_u16(tmpIn))));
+        for (size_t i = 0; i < count; i++) out[i] = tmpOut[i];
+    }
+#elif defined(ANDROID_HALF_USE_F16C)
+    const uint16_t* src = reinterpret_cast<const uint16_t*>(in);
+    while (count >= 4) {
+        _mm_storeu_ps(out,
+                _mm_cvtph_ps(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(src))));
+        src += 4;
+        out += 4;
+        count -= 4;
+    }
+    if (count > 0) {
+        alignas(16) uint16_t tmpIn[8] = { 0 };
+        float tmpOut[4];
+        for (size_t i = 0; i < count; i++) tmpIn[i] = src[i];
+        _mm_storeu_ps(tmpOut,
+                _mm_cvtph_ps(_mm_load_si128(reinterpret_cast<const __m128i*>(tmpIn))));
+        for (size_t i = 0; i < count; i++) out[i] = tmpOut[i];
+    }
+#else
+    for (size_t i = 0; i < count; i++) {
+        out[i] = float(in[i]);
+    }
+#endif
+}
+
 } // namespace android
 
 namespace std {
@@ -26,6 +26,12 @@
 #include <sys/types.h>
 #include <limits>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
 #define PURE __attribute__((pure))
 
 #if __cplusplus >= 201402L
@@ -571,6 +577,113 @@ typename TMat44<T>::col_type PURE diag(const TMat44<T>& m) {
     return matrix::diag(m);
 }
 
+// ----------------------------------------------------------------------------------------
+
+#if defined(__SSE2__) || defined(__ARM_NEON)
+/*
+ * SIMD specializations of the generic matrix helpers for the float 4x4 case.
+ *
+ * TMat44<float> stores its four columns contiguously, so a matrix can be
+ * loaded as four 4-float vectors directly. The specializations are selected
+ * at compile time through the regular explicit-specialization mechanism and
+ * are picked up transparently by operator*, transpose() and friends.
+ *
+ * Note that unlike the primary templates these are not constexpr: vector
+ * intrinsics cannot appear in constant expressions. An explicit
+ * specialization is allowed to differ from its primary template in that
+ * respect, so constant-folded uses of the generic code are unaffected for
+ * other types.
+ *
+ * inverse() intentionally stays on the generic path: the pivoted
+ * Gauss-Jordan elimination it uses is branch-heavy and does not vectorize
+ * profitably at 4x4.
+ */
+namespace matrix {
+
+#if defined(__SSE2__)
+
+template<>
+inline TMat44<float> PURE multiply<TMat44<float>, TMat44<float>, TMat44<float>>(
+        const TMat44<float>& lhs, const TMat44<float>& rhs) {
+    TMat44<float> res(TMat44<float>::NO_INIT);
+    const float* const a = &lhs[0][0];
+    const float* const b = &rhs[0][0];
+    float* const r = &res[0][0];
+    const __m128 c0 = _mm_loadu_ps(a +  0);
+    const __m128 c1 = _mm_loadu_ps(a +  4);
+    const __m128 c2 = _mm_loadu_ps(a +  8);
+    const __m128 c3 = _mm_loadu_ps(a + 12);
+    for (size_t col = 0; col < 4; ++col) {
+        const __m128 v = _mm_loadu_ps(b + col * 4);
+        __m128 acc = _mm_mul_ps(c0, _mm_shuffle_ps(v, v, 0x00));
+        acc = _mm_add_ps(acc, _mm_mul_ps(c1, _mm_shuffle_ps(v, v, 0x55)));
+        acc = _mm_add_ps(acc, _mm_mul_ps(c2, _mm_shuffle_ps(v, v, 0xAA)));
+        acc = _mm_add_ps(acc, _mm_mul_ps(c3, _mm_shuffle_ps(v, v, 0xFF)));
+        _mm_storeu_ps(r + col * 4, acc);
+    }
+    return res;
+}
+
+template<>
+inline TMat44<float> PURE transpose<TMat44<float>>(const TMat44<float>& m) {
+    TMat44<float> res(TMat44<float>::NO_INIT);
+    const float* const s = &m[0][0];
+    float* const r = &res[0][0];
+    __m128 c0 = _mm_loadu_ps(s +  0);
+    __m128 c1 = _mm_loadu_ps(s +  4);
+    __m128 c2 = _mm_loadu_ps(s +  8);
+    __m128 c3 = _mm_loadu_ps(s + 12);
+    _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+    _mm_storeu_ps(r +  0, c0);
+    _mm_storeu_ps(r +  4, c1);
+    _mm_storeu_ps(r +  8, c2);
+    _mm_storeu_ps(r + 12, c3);
+    return res;
+}
+
+#elif defined(__ARM_NEON)
+
+template<>
+inline TMat44<float> PURE multiply<TMat44<float>, TMat44<float>, TMat44<float>>(
+        const TMat44<float>& lhs, const TMat44<float>& rhs) {
+    TMat44<float> res(TMat44<float>::NO_INIT);
+    const float* const a = &lhs[0][0];
+    const float* const b = &rhs[0][0];
+    float* const r = &res[0][0];
+    const float32x4_t c0 = vld1q_f32(a +  0);
+    const float32x4_t c1 = vld1q_f32(a +  4);
+    const float32x4_t c2 = vld1q_f32(a +  8);
+    const float32x4_t c3 = vld1q_f32(a + 12);
+    for (size_t col = 0; col < 4; ++col) {
+        const float32x4_t v = vld1q_f32(b + col * 4);
+        float32x4_t acc = vmulq_lane_f32(c0, vget_low_f32(v), 0);
+        acc = vmlaq_lane_f32(acc, c1, vget_low_f32(v), 1);
+        acc = vmlaq_lane_f32(acc, c2, vget_high_f32(v), 0);
+        acc = vmlaq_lane_f32(acc, c3, vget_high_f32(v), 1);
+        vst1q_f32(r + col * 4, acc);
+    }
+    return res;
+}
+
+template<>
+inline TMat44<float> PURE transpose<TMat44<float>>(const TMat44<float>& m) {
+    // vld4q de-interleaves by groups of four, which for a column-major
+    // matrix stored contiguously is exactly a 4x4 transpose.
+    TMat44<float> res(TMat44<float>::NO_INIT);
+    float* const r = &res[0][0];
+    const float32x4x4_t t = vld4q_f32(&m[0][0]);
+    vst1q_f32(r +  0, t.val[0]);
+    vst1q_f32(r +  4, t.val[1]);
+    vst1q_f32(r +  8, t.val[2]);
+    vst1q_f32(r + 12, t.val[3]);
+    return res;
+}
+
+#endif
+
+}  // namespace matrix
+#endif  // defined(__SSE2__) || defined(__ARM_NEON)
+
 } // namespace details
 
 // ----------------------------------------------------------------------------------------
@@ -19,6 +19,8 @@
 #include <math.h>
 #include <stdlib.h>
 
+#include <vector>
+
 #include <math/half.h>
 #include <math/vec4.h>
 
@@ -93,4 +95,51 @@ TEST_F(HalfTest, Vec) {
     EXPECT_EQ(f4.xy, h2);
 }
 
+TEST_F(HalfTest, BulkConvert) {
+    // Exactly representable values convert identically through the bulk and
+    // scalar paths regardless of which conversion kernel is compiled in.
+    // Odd counts exercise the vector tail handling.
+    for (size_t count : { size_t(1), size_t(3), size_t(4), size_t(7),
+            size_t(64), size_t(2048 + 5) }) {
+        std::vector<float> in(count);
+        std::vector<half> out(count, half(0.0f));
+        for (size_t i = 0; i < count; i++) {
+            in[i] = float(int(i) - int(count / 2));
+        }
+
+        convert(in.data(), out.data(), count);
+        for (size_t i = 0; i < count; i++) {
+            EXPECT_EQ(half(in[i]).getBits(), out[i].getBits());
+        }
+
+        std::vector<float> back(count);
+        convert(out.data(), back.data(), count);
+        for (size_t i = 0; i < count; i++) {
+            EXPECT_EQ(in[i], back[i]);
+        }
+    }
+}
+
+TEST_F(HalfTest, BulkConvertSpecials) {
+    const float in[] = { 0.0f, -0.0f, 1.0f / 3.0f, 65504.0f, -65504.0f,
+            1e6f, -1e6f, float(NAN),
+            std::numeric_limits<float>::infinity(),
+            -std::numeric_limits<float>::infinity() };
+    const size_t count = sizeof(in) / sizeof(in[0]);
+    std::vector<half> out(count, half(0.0f));
+    convert(in, out.data(), count);
+
+    EXPECT_EQ(0x0000, out[0].getBits());
+    EXPECT_EQ(0x8000, out[1].getBits());
+    EXPECT_EQ(0x3555, out[2].getBits());
+    EXPECT_EQ(0x7BFF, out[3].getBits());
+    EXPECT_EQ(0xFBFF, out[4].getBits());
+    EXPECT_EQ(0x7C00, out[5].getBits());  // overflow to +inf
+    EXPECT_EQ(0xFC00, out[6].getBits());  // overflow to -inf
+    EXPECT_EQ(0x1F, out[7].getExponent());  // some NaN
+    EXPECT_NE(0u, out[7].getMantissa());
+    EXPECT_EQ(0x7C00, out[8].getBits());
+    EXPECT_EQ(0xFC00, out[9].getBits());
+}
+
 }; // namespace android
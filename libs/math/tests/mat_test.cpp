@@ -163,6 +163,44 @@ TEST_F(MatTest, ElementAccess) {
     EXPECT_FLOAT_EQ(m(3, 2), 100);
 }
 
+// Pins the float 4x4 multiply and transpose to scalar references so the
+// SIMD specializations in mat4.h stay bit-exact with the generic code.
+TEST_F(MatTest, SimdAgainstScalar) {
+    std::default_random_engine generator(82828); // NOLINT
+    std::uniform_real_distribution<float> distribution(-100.0f, 100.0f);
+    auto rand_gen = std::bind(distribution, generator);
+
+    for (size_t i = 0; i < 100; ++i) {
+        mat4 a, b;
+        for (size_t c = 0; c < 4; ++c) {
+            for (size_t r = 0; r < 4; ++r) {
+                a[c][r] = rand_gen();
+                b[c][r] = rand_gen();
+            }
+        }
+
+        const mat4 product = a * b;
+        for (size_t c = 0; c < 4; ++c) {
+            for (size_t r = 0; r < 4; ++r) {
+                float dot = 0;
+                for (size_t k = 0; k < 4; ++k) {
+                    dot += a[k][r] * b[c][k];
+                }
+                EXPECT_FLOAT_EQ(dot, product[c][r]);
+            }
+        }
+
+        const mat4 transposed = transpose(a);
+        for (size_t c = 0; c < 4; ++c) {
+            for (size_t r = 0; r < 4; ++r) {
+                EXPECT_EQ(a[r][c], transposed[c][r]);
+            }
+        }
+
+        EXPECT_EQ(a, transpose(transpose(a)));
+    }
+}
+
 //------------------------------------------------------------------------------
 // MAT 3
 //------------------------------------------------------------------------------
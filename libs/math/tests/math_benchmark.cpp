@@ -0,0 +1,117 @@
+/*
+ * Copyright 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <functional>
+#include <random>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include <math/half.h>
+#include <math/mat4.h>
+#include <math/vec4.h>
+
+namespace android {
+
+// Quantifies the matrix operations that per-frame layer transform math in
+// the render engine sits on. On x86 and ARM builds multiply and transpose
+// go through the SIMD specializations in mat4.h; inverse always uses the
+// generic Gauss-Jordan path.
+
+static mat4 randomMatrix(uint32_t seed) {
+    std::default_random_engine generator(seed); // NOLINT
+    std::uniform_real_distribution<float> distribution(-100.0f, 100.0f);
+    auto rand_gen = std::bind(distribution, generator);
+    mat4 m;
+    for (size_t c = 0; c < 4; ++c) {
+        for (size_t r = 0; r < 4; ++r) {
+            m[c][r] = rand_gen();
+        }
+    }
+    return m;
+}
+
+static void BM_mat4_multiply(benchmark::State& state) {
+    const mat4 a = randomMatrix(1);
+    mat4 b = randomMatrix(2);
+    while (state.KeepRunning()) {
+        b = a * b;
+        benchmark::DoNotOptimize(b);
+    }
+}
+BENCHMARK(BM_mat4_multiply);
+
+static void BM_mat4_transpose(benchmark::State& state) {
+    mat4 m = randomMatrix(3);
+    while (state.KeepRunning()) {
+        m = transpose(m);
+        benchmark::DoNotOptimize(m);
+    }
+}
+BENCHMARK(BM_mat4_transpose);
+
+static void BM_mat4_inverse(benchmark::State& state) {
+    const mat4 m = randomMatrix(4);
+    while (state.KeepRunning()) {
+        mat4 i = inverse(m);
+        benchmark::DoNotOptimize(i);
+    }
+}
+BENCHMARK(BM_mat4_inverse);
+
+static void BM_mat4_vec4_multiply(benchmark::State& state) {
+    const mat4 m = randomMatrix(5);
+    vec4 v(1.0f, 2.0f, 3.0f, 1.0f);
+    while (state.KeepRunning()) {
+        v = m * v;
+        benchmark::DoNotOptimize(v);
+    }
+}
+BENCHMARK(BM_mat4_vec4_multiply);
+
+// One row of a 1080p RGBA16F buffer, the unit the capture pipeline converts
+// at a time.  On ARM and x86 builds with half-precision converters this runs
+// the SIMD kernels in half.h; otherwise the scalar fallback.
+constexpr size_t kPixelComponents = 1920 * 4;
+
+static void BM_half_fromFloat(benchmark::State& state) {
+    std::vector<float> in(kPixelComponents);
+    std::vector<half> out(kPixelComponents, half(0.0f));
+    std::default_random_engine generator(6);  // NOLINT
+    std::uniform_real_distribution<float> distribution(0.0f, 100.0f);
+    for (auto& v : in) {
+        v = distribution(generator);
+    }
+    while (state.KeepRunning()) {
+        convert(in.data(), out.data(), kPixelComponents);
+        benchmark::DoNotOptimize(out.data());
+    }
+}
+BENCHMARK(BM_half_fromFloat);
+
+static void BM_half_toFloat(benchmark::State& state) {
+    std::vector<half> in(kPixelComponents, half(0.5f));
+    std::vector<float> out(kPixelComponents);
+    while (state.KeepRunning()) {
+        convert(in.data(), out.data(), kPixelComponents);
+        benchmark::DoNotOptimize(out.data());
+    }
+}
+BENCHMARK(BM_half_toFloat);
+
+}  // namespace android
+
+BENCHMARK_MAIN();
@@ -137,6 +137,29 @@ int AHardwareBuffer_lock(AHardwareBuffer* buffer, uint64_t usage,
     return gBuffer->lockAsync(usage, usage, bounds, outVirtualAddress, fence);
 }
 
+int AHardwareBuffer_lockPersistent(AHardwareBuffer* buffer, uint64_t usage,
+        int32_t fence, void** outVirtualAddress) {
+    if (!buffer || !outVirtualAddress) return BAD_VALUE;
+
+    if (usage & ~(AHARDWAREBUFFER_USAGE_CPU_READ_MASK |
+                  AHARDWAREBUFFER_USAGE_CPU_WRITE_MASK)) {
+        ALOGE("Invalid usage flags passed to AHardwareBuffer_lockPersistent; "
+                "only AHARDWAREBUFFER_USAGE_CPU_* flags are allowed");
+        return BAD_VALUE;
+    }
+
+    usage = AHardwareBuffer_convertToGrallocUsageBits(usage);
+    GraphicBuffer* gBuffer = AHardwareBuffer_to_GraphicBuffer(buffer);
+    return gBuffer->lockPersistent(usage, outVirtualAddress, fence);
+}
+
+int AHardwareBuffer_unlockPersistent(AHardwareBuffer* buffer) {
+    if (!buffer) return BAD_VALUE;
+
+    GraphicBuffer* gBuffer = AHardwareBuffer_to_GraphicBuffer(buffer);
+    return gBuffer->unlockPersistent();
+}
+
 int AHardwareBuffer_unlock(AHardwareBuffer* buffer, int32_t* fence) {
     if (!buffer) return BAD_VALUE;
 
@@ -26,6 +26,30 @@ __BEGIN_DECLS
 
 const native_handle_t* AHardwareBuffer_getNativeHandle(const AHardwareBuffer* buffer);
 
+/**
+ * Locks the buffer for direct CPU access through a persistent mapping.
+ *
+ * The first call establishes a long-lived mapping of the whole buffer; later
+ * calls only synchronize on \a fence and return the same address, avoiding a
+ * gralloc mapper round-trip per access. The mapping stays valid until the
+ * buffer's last reference is released, so \a usage must be a subset of the
+ * usage passed to the first call, and the buffer must only be produced and
+ * consumed on the CPU while persistently mapped.
+ *
+ * Takes ownership of \a fence, which is signaled when it is safe to access
+ * the buffer contents; pass -1 if the contents are already safe to access.
+ */
+int AHardwareBuffer_lockPersistent(AHardwareBuffer* buffer, uint64_t usage,
+        int32_t fence, void** outVirtualAddress);
+
+/**
+ * Ends a CPU access started with AHardwareBuffer_lockPersistent().
+ *
+ * Unlike AHardwareBuffer_unlock() this does not release the mapping and
+ * produces no release fence: CPU writes are complete when this returns.
+ */
+int AHardwareBuffer_unlockPersistent(AHardwareBuffer* buffer);
+
 
 /**
  * Buffer pixel formats.
@@ -38,6 +38,7 @@ enum {
     FLUSH_SENSOR,
     CONFIGURE_CHANNEL,
     DESTROY,
+    ENABLE_DISABLE_MULTIPLE,
 };
 
 class BpSensorEventConnection : public BpInterface<ISensorEventConnection>
@@ -72,6 +73,23 @@ public:
         return reply.readInt32();
     }
 
+    virtual status_t enableDisableMultiple(const Vector<SensorRequest>& requests)
+    {
+        Parcel data, reply;
+        data.writeInterfaceToken(ISensorEventConnection::getInterfaceDescriptor());
+        data.writeInt32(requests.size());
+        for (size_t i = 0; i < requests.size(); i++) {
+            const SensorRequest& req = requests[i];
+            data.writeInt32(req.handle);
+            data.writeInt32(req.enabled);
+            data.writeInt64(req.samplingPeriodNs);
+            data.writeInt64(req.maxBatchReportLatencyNs);
+            data.writeInt32(req.reservedFlags);
+        }
+        remote()->transact(ENABLE_DISABLE_MULTIPLE, data, &reply);
+        return reply.readInt32();
+    }
+
     virtual status_t setEventRate(int handle, nsecs_t ns)
     {
         Parcel data, reply;
@@ -166,6 +184,28 @@ status_t BnSensorEventConnection::onTransact(
             destroy();
             return NO_ERROR;
         }
+        case ENABLE_DISABLE_MULTIPLE: {
+            CHECK_INTERFACE(ISensorEventConnection, data, reply);
+            int32_t count = data.readInt32();
+            if (count < 0) {
+                reply->writeInt32(BAD_VALUE);
+                return NO_ERROR;
+            }
+            Vector<SensorRequest> requests;
+            requests.setCapacity(count);
+            for (int32_t i = 0; i < count; i++) {
+                SensorRequest req;
+                req.handle = data.readInt32();
+                req.enabled = data.readInt32();
+                req.samplingPeriodNs = data.readInt64();
+                req.maxBatchReportLatencyNs = data.readInt64();
+                req.reservedFlags = data.readInt32();
+                requests.add(req);
+            }
+            status_t result = enableDisableMultiple(requests);
+            reply->writeInt32(result);
+            return NO_ERROR;
+        }
 
     }
     return BBinder::onTransact(code, data, reply, flags);
@@ -79,6 +79,54 @@ ssize_t SensorEventQueue::read(ASensorEvent* events, size_t numEvents) {
     return static_cast<ssize_t>(count);
 }
 
+ssize_t SensorEventQueue::readBatch(ASensorEvent* events, size_t numEvents,
+        int64_t minTimestampNs, int64_t minDeltaNs) {
+    size_t count = 0;
+    while (count < numEvents) {
+        if (mAvailable == 0) {
+            ssize_t err = BitTube::recvObjects(mSensorChannel,
+                    mRecBuffer, MAX_RECEIVE_BUFFER_EVENT_COUNT);
+            if (err < 0) {
+                // Once events have been collected return them; the error (typically -EAGAIN
+                // when the tube is drained) will show up again on the next call.
+                return count > 0 ? static_cast<ssize_t>(count) : err;
+            }
+            mAvailable = static_cast<size_t>(err);
+            mConsumed = 0;
+        }
+        while (mAvailable > 0 && count < numEvents) {
+            const ASensorEvent& event = mRecBuffer[mConsumed];
+            mConsumed++;
+            mAvailable--;
+
+            bool deliver = true;
+            if (event.type == SENSOR_TYPE_META_DATA ||
+                    (event.flags & WAKE_UP_SENSOR_EVENT_NEEDS_ACK)) {
+                // flush complete events and wake-up events carry protocol state (flush
+                // matching and the wake lock ack), never filter them.
+            } else if (event.timestamp < minTimestampNs) {
+                deliver = false;
+            } else if (minDeltaNs > 0) {
+                ssize_t index = mLastDeliveredTimestamp.indexOfKey(event.sensor);
+                if (index < 0) {
+                    mLastDeliveredTimestamp.add(event.sensor, event.timestamp);
+                } else if (event.timestamp - mLastDeliveredTimestamp.valueAt(index) <
+                        minDeltaNs - minDeltaNs / 10) {
+                    // tolerate 10% sampling jitter so a rate matching minDeltaNs exactly is
+                    // not halved by decimation.
+                    deliver = false;
+                } else {
+                    mLastDeliveredTimestamp.replaceValueAt(index, event.timestamp);
+                }
+            }
+            if (deliver) {
+                events[count++] = event;
+            }
+        }
+    }
+    return static_cast<ssize_t>(count);
+}
+
 sp<Looper> SensorEventQueue::getLooper() const
 {
     Mutex::Autolock _l(mLock);
@@ -140,6 +188,11 @@ status_t SensorEventQueue::enableSensor(int32_t handle, int32_t samplingPeriodUs
                                                  us2ns(maxBatchReportLatencyUs), reservedFlags);
 }
 
+status_t SensorEventQueue::enableSensors(
+        const Vector<ISensorEventConnection::SensorRequest>& requests) const {
+    return mSensorEventConnection->enableDisableMultiple(requests);
+}
+
 status_t SensorEventQueue::flush() const {
     return mSensorEventConnection->flush();
 }
@@ -27,6 +27,7 @@
 #include <utils/Singleton.h>
 
 #include <binder/IBinder.h>
+#include <binder/IMemory.h>
 #include <binder/IPermissionController.h>
 #include <binder/IServiceManager.h>
 
@@ -160,7 +161,12 @@ status_t SensorManager::assertStateLocked() {
         mDeathObserver = new DeathObserver(*const_cast<SensorManager *>(this));
         IInterface::asBinder(mSensorServer)->linkToDeath(mDeathObserver);
 
-        mSensors = mSensorServer->getSensorList(mOpPackageName);
+        // The static list is identical for every client, so prefer the
+        // shared region the service publishes once over flattening the
+        // whole list through a reply parcel for each package instance.
+        if (!fetchSharedSensorListLocked()) {
+            mSensors = mSensorServer->getSensorList(mOpPackageName);
+        }
         size_t count = mSensors.size();
         mSensorList =
                 static_cast<Sensor const**>(malloc(count * sizeof(Sensor*)));
@@ -174,6 +180,48 @@ status_t SensorManager::assertStateLocked() {
     return NO_ERROR;
 }
 
+bool SensorManager::fetchSharedSensorListLocked() {
+    sp<IMemory> memory = mSensorServer->getSensorListMemory();
+    if (memory == NULL) {
+        return false;
+    }
+    const uint8_t* base = static_cast<const uint8_t*>(memory->pointer());
+    const size_t avail = memory->size();
+    if (base == NULL || avail < sizeof(uint32_t)) {
+        return false;
+    }
+
+    uint32_t count;
+    memcpy(&count, base, sizeof(count));
+    size_t offset = sizeof(count);
+    Vector<Sensor> sensors;
+    sensors.setCapacity(count);
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t size;
+        if (avail - offset < sizeof(size)) {
+            return false;
+        }
+        memcpy(&size, base + offset, sizeof(size));
+        offset += sizeof(size);
+        if (size > avail - offset) {
+            return false;
+        }
+        Sensor sensor;
+        if (sensor.unflatten(base + offset, size) != NO_ERROR) {
+            return false;
+        }
+        sensors.add(sensor);
+        // Entries are 4-byte aligned.
+        offset += (size_t(size) + 3) & ~size_t(3);
+        if (offset > avail) {
+            offset = avail;
+        }
+    }
+
+    mSensors = sensors;
+    return true;
+}
+
 ssize_t SensorManager::getSensorList(Sensor const* const** list) {
     Mutex::Autolock _l(mLock);
     status_t err = assertStateLocked();
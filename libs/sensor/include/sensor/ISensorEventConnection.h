@@ -22,6 +22,7 @@
 #include <utils/Errors.h>
 #include <utils/StrongPointer.h>
 #include <utils/Timers.h>
+#include <utils/Vector.h>
 
 #include <binder/IInterface.h>
 
@@ -36,9 +37,23 @@ class ISensorEventConnection : public IInterface
 public:
     DECLARE_META_INTERFACE(SensorEventConnection)
 
+    // one enable/disable request, as taken by enableDisableMultiple; mirrors the
+    // parameters of enableDisable.
+    struct SensorRequest {
+        int32_t handle;
+        bool enabled;
+        nsecs_t samplingPeriodNs;
+        nsecs_t maxBatchReportLatencyNs;
+        int32_t reservedFlags;
+    };
+
     virtual sp<BitTube> getSensorChannel() const = 0;
     virtual status_t enableDisable(int handle, bool enabled, nsecs_t samplingPeriodNs,
                                    nsecs_t maxBatchReportLatencyNs, int reservedFlags) = 0;
+    // apply several enable/disable requests in a single transaction. Requests are
+    // applied in order; the first failure is returned but later requests are still
+    // attempted.
+    virtual status_t enableDisableMultiple(const Vector<SensorRequest>& requests) = 0;
     virtual status_t setEventRate(int handle, nsecs_t ns) = 0;
     virtual status_t flush() = 0;
     virtual int32_t configureChannel(int32_t handle, int32_t rateLevel) = 0;
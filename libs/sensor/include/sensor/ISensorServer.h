@@ -30,6 +30,7 @@ typedef struct native_handle native_handle_t;
 namespace android {
 // ----------------------------------------------------------------------------
 
+class IMemory;
 class ISensorEventConnection;
 class Parcel;
 class Sensor;
@@ -44,6 +45,16 @@ public:
     virtual Vector<Sensor> getSensorList(const String16& opPackageName) = 0;
     virtual Vector<Sensor> getDynamicSensorList(const String16& opPackageName) = 0;
 
+    // Returns the static sensor list in a read-only shared memory region
+    // that the service builds once and hands to every client, instead of
+    // flattening the whole list into a reply parcel per caller.  Layout:
+    // a uint32 sensor count followed by, for each sensor, a uint32 byte
+    // size and the Sensor's flattened representation, each entry aligned
+    // to 4 bytes.  Returns NULL when the region is unavailable; callers
+    // fall back to getSensorList().  Dynamic sensors are not included as
+    // their visibility depends on the caller's permissions.
+    virtual sp<IMemory> getSensorListMemory() = 0;
+
     virtual sp<ISensorEventConnection> createSensorEventConnection(const String8& packageName,
              int mode, const String16& opPackageName) = 0;
     virtual int32_t isDataInjectionEnabled() = 0;
@@ -20,11 +20,13 @@
 #include <sys/types.h>
 
 #include <utils/Errors.h>
+#include <utils/KeyedVector.h>
 #include <utils/RefBase.h>
 #include <utils/Timers.h>
 #include <utils/Mutex.h>
 
 #include <sensor/BitTube.h>
+#include <sensor/ISensorEventConnection.h>
 
 // ----------------------------------------------------------------------------
 #define WAKE_UP_SENSOR_EVENT_NEEDS_ACK (1U << 31)
@@ -40,7 +42,6 @@ struct ASensorEventQueue {
 namespace android {
 // ----------------------------------------------------------------------------
 
-class ISensorEventConnection;
 class Sensor;
 class Looper;
 
@@ -75,6 +76,15 @@ public:
 
     ssize_t read(ASensorEvent* events, size_t numEvents);
 
+    // Like read(), but keeps draining the channel until numEvents have been collected or no
+    // more data is available. Events with a timestamp older than minTimestampNs are dropped,
+    // and if minDeltaNs is positive, consecutive events of the same sensor closer together
+    // than minDeltaNs are decimated in the library, before they reach the client. Wake-up
+    // events flagged with WAKE_UP_SENSOR_EVENT_NEEDS_ACK and flush complete events are always
+    // delivered regardless of filtering, as both carry protocol state.
+    ssize_t readBatch(ASensorEvent* events, size_t numEvents,
+            int64_t minTimestampNs = INT64_MIN, int64_t minDeltaNs = 0);
+
     status_t waitForEvent() const;
     status_t wake() const;
 
@@ -87,6 +97,9 @@ public:
     status_t enableSensor(int32_t handle, int32_t samplingPeriodUs, int64_t maxBatchReportLatencyUs,
                           int reservedFlags) const;
     status_t disableSensor(int32_t handle) const;
+    // Apply several enable/disable requests in a single binder transaction. Sampling periods
+    // and report latencies in the requests are in nanoseconds.
+    status_t enableSensors(const Vector<ISensorEventConnection::SensorRequest>& requests) const;
     status_t flush() const;
     // Send an ack for every wake_up sensor event that is set to WAKE_UP_SENSOR_EVENT_NEEDS_ACK.
     void sendAck(const ASensorEvent* events, int count);
@@ -102,6 +115,9 @@ private:
     size_t mAvailable;
     size_t mConsumed;
     uint32_t mNumAcksToSend;
+    // Timestamp of the last event delivered by readBatch for each sensor handle, used for
+    // decimation. Only accessed from the consumer thread, like mRecBuffer.
+    KeyedVector<int32_t, int64_t> mLastDeliveredTimestamp;
 };
 
 // ----------------------------------------------------------------------------
@@ -73,6 +73,10 @@ private:
 
     SensorManager(const String16& opPackageName);
     status_t assertStateLocked();
+    // Fills mSensors from the shared memory region published by the
+    // service; returns false if the region is unavailable or malformed,
+    // in which case the caller uses the parcel-based getSensorList().
+    bool fetchSharedSensorListLocked();
 
 private:
     static Mutex sLock;
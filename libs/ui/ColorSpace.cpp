@@ -109,6 +109,7 @@ ColorSpace::ColorSpace(
         , mOETF(std::move(OETF))
         , mEOTF(std::move(EOTF))
         , mClamper(std::move(clamper))
+        , mTransferType(TransferType::Custom)
         , mPrimaries(computePrimaries(rgbToXYZ))
         , mWhitePoint(computeWhitePoint(rgbToXYZ)) {
 }
@@ -125,6 +126,8 @@ ColorSpace::ColorSpace(
         , mOETF(toOETF(mParameters))
         , mEOTF(toEOTF(mParameters))
         , mClamper(std::move(clamper))
+        , mTransferType(parameters.e == 0.0f && parameters.f == 0.0f
+                ? TransferType::Parametric : TransferType::ParametricFull)
         , mPrimaries(computePrimaries(rgbToXYZ))
         , mWhitePoint(computeWhitePoint(rgbToXYZ)) {
 }
@@ -141,6 +144,7 @@ ColorSpace::ColorSpace(
         , mOETF(toOETF(gamma))
         , mEOTF(toEOTF(gamma))
         , mClamper(std::move(clamper))
+        , mTransferType(gamma == 1.0f ? TransferType::Linear : TransferType::Gamma)
         , mPrimaries(computePrimaries(rgbToXYZ))
         , mWhitePoint(computeWhitePoint(rgbToXYZ)) {
 }
@@ -158,6 +162,7 @@ ColorSpace::ColorSpace(
         , mOETF(std::move(OETF))
         , mEOTF(std::move(EOTF))
         , mClamper(std::move(clamper))
+        , mTransferType(TransferType::Custom)
         , mPrimaries(primaries)
         , mWhitePoint(whitePoint) {
 }
@@ -175,6 +180,8 @@ ColorSpace::ColorSpace(
         , mOETF(toOETF(mParameters))
         , mEOTF(toEOTF(mParameters))
         , mClamper(std::move(clamper))
+        , mTransferType(parameters.e == 0.0f && parameters.f == 0.0f
+                ? TransferType::Parametric : TransferType::ParametricFull)
         , mPrimaries(primaries)
         , mWhitePoint(whitePoint) {
 }
@@ -192,10 +199,77 @@ ColorSpace::ColorSpace(
         , mOETF(toOETF(gamma))
         , mEOTF(toEOTF(gamma))
         , mClamper(std::move(clamper))
+        , mTransferType(gamma == 1.0f ? TransferType::Linear : TransferType::Gamma)
         , mPrimaries(primaries)
         , mWhitePoint(whitePoint) {
 }
 
+void ColorSpace::fromLinear(float3* v, size_t count) const noexcept {
+    switch (mTransferType) {
+        case TransferType::Linear:
+            break;
+        case TransferType::Gamma: {
+            const float e = 1.0f / mParameters.g;
+            for (size_t i = 0; i < count; i++) {
+                v[i] = float3{safePow(v[i].r, e), safePow(v[i].g, e), safePow(v[i].b, e)};
+            }
+            break;
+        }
+        case TransferType::Parametric:
+            for (size_t i = 0; i < count; i++) {
+                v[i] = float3{rcpResponse(v[i].r, mParameters),
+                              rcpResponse(v[i].g, mParameters),
+                              rcpResponse(v[i].b, mParameters)};
+            }
+            break;
+        case TransferType::ParametricFull:
+            for (size_t i = 0; i < count; i++) {
+                v[i] = float3{rcpFullResponse(v[i].r, mParameters),
+                              rcpFullResponse(v[i].g, mParameters),
+                              rcpFullResponse(v[i].b, mParameters)};
+            }
+            break;
+        case TransferType::Custom:
+            for (size_t i = 0; i < count; i++) {
+                v[i] = apply(v[i], mOETF);
+            }
+            break;
+    }
+}
+
+void ColorSpace::toLinear(float3* v, size_t count) const noexcept {
+    switch (mTransferType) {
+        case TransferType::Linear:
+            break;
+        case TransferType::Gamma: {
+            const float e = mParameters.g;
+            for (size_t i = 0; i < count; i++) {
+                v[i] = float3{safePow(v[i].r, e), safePow(v[i].g, e), safePow(v[i].b, e)};
+            }
+            break;
+        }
+        case TransferType::Parametric:
+            for (size_t i = 0; i < count; i++) {
+                v[i] = float3{response(v[i].r, mParameters),
+                              response(v[i].g, mParameters),
+                              response(v[i].b, mParameters)};
+            }
+            break;
+        case TransferType::ParametricFull:
+            for (size_t i = 0; i < count; i++) {
+                v[i] = float3{fullResponse(v[i].r, mParameters),
+                              fullResponse(v[i].g, mParameters),
+                              fullResponse(v[i].b, mParameters)};
+            }
+            break;
+        case TransferType::Custom:
+            for (size_t i = 0; i < count; i++) {
+                v[i] = apply(v[i], mEOTF);
+            }
+            break;
+    }
+}
+
 constexpr mat3 ColorSpace::computeXYZMatrix(
         const std::array<float2, 3>& primaries, const float2& whitePoint) {
     const float2& R = primaries[0];
@@ -365,11 +439,29 @@ std::unique_ptr<float3> ColorSpace::createLUT(uint32_t size,
     for (uint32_t z = 0; z < size; z++) {
         for (int32_t y = int32_t(size - 1); y >= 0; y--) {
             for (uint32_t x = 0; x < size; x++) {
-                *data++ = connector.transform({x * m, y * m, z * m});
+                *data++ = {x * m, y * m, z * m};
             }
         }
     }
 
+    connector.transform(lut.get(), size * size * size);
+
+    return lut;
+}
+
+std::unique_ptr<float> ColorSpace::createLUT1D(uint32_t size,
+        const transfer_function& fn) {
+
+    size = clamp(size, 2u, 1024u);
+    float m = 1.0f / float(size - 1);
+
+    std::unique_ptr<float> lut(new float[size]);
+    float* data = lut.get();
+
+    for (uint32_t i = 0; i < size; i++) {
+        data[i] = fn(i * m);
+    }
+
     return lut;
 }
 
@@ -414,4 +506,21 @@ ColorSpaceConnector::ColorSpaceConnector(
     }
 }
 
+void ColorSpaceConnector::transform(float3* v, size_t count) const noexcept {
+    const ColorSpace::clamping_function& srcClamper = mSource.getClamper();
+    const ColorSpace::clamping_function& dstClamper = mDestination.getClamper();
+
+    for (size_t i = 0; i < count; i++) {
+        v[i] = apply(v[i], srcClamper);
+    }
+    mSource.toLinear(v, count);
+    for (size_t i = 0; i < count; i++) {
+        v[i] = mTransform * v[i];
+    }
+    mDestination.fromLinear(v, count);
+    for (size_t i = 0; i < count; i++) {
+        v[i] = apply(v[i], dstClamper);
+    }
+}
+
 }; // namespace android
@@ -51,7 +51,11 @@ status_t Fence::wait(int timeout) {
         return NO_ERROR;
     }
     int err = sync_wait(mFenceFd, timeout);
-    return err < 0 ? -errno : status_t(NO_ERROR);
+    if (err < 0) {
+        return -errno;
+    }
+    mSignaled.store(true, std::memory_order_relaxed);
+    return NO_ERROR;
 }
 
 status_t Fence::waitForever(const char* logname) {
@@ -66,7 +70,11 @@ status_t Fence::waitForever(const char* logname) {
                 warningTimeout);
         err = sync_wait(mFenceFd, TIMEOUT_NEVER);
     }
-    return err < 0 ? -errno : status_t(NO_ERROR);
+    if (err < 0) {
+        return -errno;
+    }
+    mSignaled.store(true, std::memory_order_relaxed);
+    return NO_ERROR;
 }
 
 sp<Fence> Fence::merge(const char* name, const sp<Fence>& f1,
@@ -100,6 +108,59 @@ sp<Fence> Fence::merge(const String8& name, const sp<Fence>& f1,
     return merge(name.string(), f1, f2);
 }
 
+sp<Fence> Fence::merge(const char* name, const sp<Fence>* fences,
+        size_t count) {
+    ATRACE_CALL();
+    // Fold all the valid fences into a single one. The first valid fence is
+    // only remembered at first: if it turns out to be the only one it is
+    // merged with itself, like in the two-fence merge, so that a new fence
+    // with the given name is created.
+    base::unique_fd merged;
+    int firstFd = -1;
+    for (size_t i = 0; i < count; i++) {
+        const sp<Fence>& f(fences[i]);
+        if (f == NULL || !f->isValid()) {
+            continue;
+        }
+        int result;
+        if (merged != -1) {
+            result = sync_merge(name, merged, f->mFenceFd);
+        } else if (firstFd != -1) {
+            result = sync_merge(name, firstFd, f->mFenceFd);
+        } else {
+            firstFd = f->mFenceFd;
+            continue;
+        }
+        if (result == -1) {
+            status_t err = -errno;
+            ALOGE("merge: sync_merge(\"%s\", %d, %d) returned an error: %s (%d)",
+                    name, merged != -1 ? merged.get() : firstFd,
+                    f->mFenceFd.get(), strerror(-err), err);
+            return NO_FENCE;
+        }
+        merged.reset(result);
+    }
+    if (merged != -1) {
+        return sp<Fence>(new Fence(std::move(merged)));
+    }
+    if (firstFd != -1) {
+        int result = sync_merge(name, firstFd, firstFd);
+        if (result == -1) {
+            status_t err = -errno;
+            ALOGE("merge: sync_merge(\"%s\", %d, %d) returned an error: %s (%d)",
+                    name, firstFd, firstFd, strerror(-err), err);
+            return NO_FENCE;
+        }
+        return sp<Fence>(new Fence(result));
+    }
+    return NO_FENCE;
+}
+
+sp<Fence> Fence::merge(const char* name,
+        const std::vector<sp<Fence>>& fences) {
+    return merge(name, fences.data(), fences.size());
+}
+
 int Fence::dup() const {
     return ::dup(mFenceFd);
 }
@@ -118,6 +179,7 @@ nsecs_t Fence::getSignalTime() const {
         sync_fence_info_free(finfo);
         return SIGNAL_TIME_PENDING;
     }
+    mSignaled.store(true, std::memory_order_relaxed);
 
     struct sync_pt_info* pinfo = NULL;
     uint64_t timestamp = 0;
@@ -271,28 +271,61 @@ status_t FenceTime::Snapshot::unflatten(
 // ============================================================================
 // FenceTimeline
 // ============================================================================
+FenceTimeline::~FenceTimeline() {
+    Entry* chain = mIncoming.exchange(nullptr, std::memory_order_acquire);
+    while (chain) {
+        Entry* next = chain->next;
+        delete chain;
+        chain = next;
+    }
+}
+
 void FenceTimeline::push(const std::shared_ptr<FenceTime>& fence) {
-    std::lock_guard<std::mutex> lock(mMutex);
-    while (mQueue.size() >= MAX_ENTRIES) {
-        // This is a sanity check to make sure the queue doesn't grow unbounded.
-        // MAX_ENTRIES should be big enough not to trigger this path.
-        // In case this path is taken though, users of FenceTime must make sure
-        // not to rely solely on FenceTimeline to get the final timestamp and
-        // should eventually call Fence::getSignalTime on their own.
-        std::shared_ptr<FenceTime> front = mQueue.front().lock();
-        if (front) {
-            // Make a last ditch effort to get the signalTime here since
-            // we are removing it from the timeline.
-            front->getSignalTime();
+    Entry* entry = new Entry(fence);
+    entry->next = mIncoming.load(std::memory_order_relaxed);
+    while (!mIncoming.compare_exchange_weak(entry->next, entry,
+            std::memory_order_release, std::memory_order_relaxed)) {
+    }
+}
+
+void FenceTimeline::drainIncoming() {
+    Entry* chain = mIncoming.exchange(nullptr, std::memory_order_acquire);
+
+    // The chain is in LIFO push order; reverse it so mQueue stays FIFO.
+    Entry* reversed = nullptr;
+    while (chain) {
+        Entry* next = chain->next;
+        chain->next = reversed;
+        reversed = chain;
+        chain = next;
+    }
+
+    while (reversed) {
+        if (mQueue.size() >= MAX_ENTRIES) {
+            // This is a sanity check to make sure the queue doesn't grow
+            // unbounded. MAX_ENTRIES should be big enough not to trigger this
+            // path. In case this path is taken though, users of FenceTime must
+            // make sure not to rely solely on FenceTimeline to get the final
+            // timestamp and should eventually call Fence::getSignalTime on
+            // their own.
+            std::shared_ptr<FenceTime> front = mQueue.front().lock();
+            if (front) {
+                // Make a last ditch effort to get the signalTime here since
+                // we are removing it from the timeline.
+                front->getSignalTime();
+            }
+            mQueue.pop();
         }
-        mQueue.pop();
+        mQueue.push(std::move(reversed->fence));
+        Entry* next = reversed->next;
+        delete reversed;
+        reversed = next;
     }
-    mQueue.push(fence);
 }
 
 void FenceTimeline::updateSignalTimes() {
+    drainIncoming();
     while (!mQueue.empty()) {
-        std::lock_guard<std::mutex> lock(mMutex);
         std::shared_ptr<FenceTime> fence = mQueue.front().lock();
         if (!fence) {
             // The shared_ptr no longer exists and no one cares about the
@@ -18,11 +18,14 @@
 
 #include <ui/GraphicBuffer.h>
 
+#include <inttypes.h>
+
 #include <cutils/atomic.h>
 
 #include <grallocusage/GrallocUsageConversion.h>
 
 #include <ui/DetachedBufferHandle.h>
+#include <ui/Fence.h>
 #include <ui/Gralloc2.h>
 #include <ui/GraphicBufferAllocator.h>
 #include <ui/GraphicBufferMapper.h>
@@ -44,9 +47,13 @@ sp<GraphicBuffer> GraphicBuffer::from(ANativeWindowBuffer* anwb) {
     return static_cast<GraphicBuffer *>(anwb);
 }
 
+Mutex GraphicBuffer::sIdRegistryLock;
+KeyedVector<uint64_t, wp<GraphicBuffer>> GraphicBuffer::sIdRegistry;
+
 GraphicBuffer::GraphicBuffer()
     : BASE(), mOwner(ownData), mBufferMapper(GraphicBufferMapper::get()),
-      mInitCheck(NO_ERROR), mId(getUniqueId()), mGenerationNumber(0)
+      mInitCheck(NO_ERROR), mId(getUniqueId()), mRegistered(false),
+      mGenerationNumber(0), mPersistentVaddr(nullptr), mPersistentUsage(0)
 {
     width  =
     height =
@@ -97,8 +104,22 @@ GraphicBuffer::GraphicBuffer(const native_handle_t* handle,
 GraphicBuffer::~GraphicBuffer()
 {
     if (handle) {
+        // Tear down any persistent mapping before the handle goes away so
+        // the mapper does not see a free of a locked buffer.
+        if (mPersistentVaddr != nullptr) {
+            mBufferMapper.unlock(handle);
+        }
         free_handle();
     }
+    if (mRegistered) {
+        Mutex::Autolock _l(sIdRegistryLock);
+        ssize_t index = sIdRegistry.indexOfKey(mId);
+        // A later unflatten of the same id may have replaced the entry;
+        // only remove it if it still points at us.
+        if (index >= 0 && sIdRegistry.valueAt(index).unsafe_get() == this) {
+            sIdRegistry.removeItemsAt(index);
+        }
+    }
 }
 
 void GraphicBuffer::free_handle()
@@ -327,6 +348,47 @@ status_t GraphicBuffer::unlockAsync(int *fenceFd)
     return res;
 }
 
+status_t GraphicBuffer::lockPersistent(uint64_t inUsage, void** vaddr,
+        int fenceFd)
+{
+    Mutex::Autolock _l(mPersistentLock);
+    if (mPersistentVaddr != nullptr) {
+        if (inUsage & ~mPersistentUsage) {
+            ALOGE("lockPersistent: usage %" PRIx64 " is not a subset of the "
+                    "mapping usage %" PRIx64, inUsage, mPersistentUsage);
+            return BAD_VALUE;
+        }
+        // The mapping is already established; only synchronize with the
+        // producer before handing out the cached address.
+        if (fenceFd >= 0) {
+            sp<Fence> fence(new Fence(fenceFd));
+            status_t res = fence->waitForever("GraphicBuffer::lockPersistent");
+            if (res != OK) {
+                return res;
+            }
+        }
+        *vaddr = mPersistentVaddr;
+        return NO_ERROR;
+    }
+    const Rect lockBounds(width, height);
+    status_t res = getBufferMapper().lockAsync(handle, inUsage, inUsage,
+            lockBounds, vaddr, fenceFd);
+    if (res == NO_ERROR) {
+        mPersistentVaddr = *vaddr;
+        mPersistentUsage = inUsage;
+    }
+    return res;
+}
+
+status_t GraphicBuffer::unlockPersistent()
+{
+    // The mapper lock is deliberately kept held so the next
+    // lockPersistent() only has to synchronize on a fence; the mapping is
+    // released when the buffer is destroyed.
+    Mutex::Autolock _l(mPersistentLock);
+    return mPersistentVaddr != nullptr ? NO_ERROR : INVALID_OPERATION;
+}
+
 size_t GraphicBuffer::getFlattenedSize() const {
     return static_cast<size_t>(13 + (handle ? mTransportNumInts : 0)) * sizeof(int);
 }
@@ -466,7 +528,10 @@ status_t GraphicBuffer::unflatten(
 
     if (handle != 0) {
         buffer_handle_t importedHandle;
-        status_t err = mBufferMapper.importBuffer(handle, uint32_t(width), uint32_t(height),
+        // Import through the per-process cache: a buffer unflattened more than
+        // once reuses the handle from the first import instead of going back
+        // to the mapper HAL.
+        status_t err = mBufferMapper.importBuffer(handle, mId, uint32_t(width), uint32_t(height),
                 uint32_t(layerCount), format, usage, uint32_t(stride), &importedHandle);
         if (err != NO_ERROR) {
             width = height = stride = format = usage_deprecated = 0;
@@ -481,6 +546,14 @@ status_t GraphicBuffer::unflatten(
         native_handle_delete(const_cast<native_handle_t*>(handle));
         handle = importedHandle;
         mBufferMapper.getTransportSize(handle, &mTransportNumFds, &mTransportNumInts);
+
+        { // acquire lock
+            // Make this buffer reachable through unflattenFromId(), so the
+            // sender may transport it as just an id from now on.
+            Mutex::Autolock _l(sIdRegistryLock);
+            sIdRegistry.replaceValueFor(mId, wp<GraphicBuffer>(this));
+            mRegistered = true;
+        }
     }
 
     buffer = static_cast<void const*>(static_cast<uint8_t const*>(buffer) + sizeNeeded);
@@ -491,6 +564,63 @@ status_t GraphicBuffer::unflatten(
     return NO_ERROR;
 }
 
+size_t GraphicBuffer::getIdFlattenedSize() const {
+    return 4 * sizeof(int);
+}
+
+status_t GraphicBuffer::flattenAsId(void*& buffer, size_t& size) const {
+    size_t sizeNeeded = getIdFlattenedSize();
+    if (size < sizeNeeded) return NO_MEMORY;
+
+    int32_t* buf = static_cast<int32_t*>(buffer);
+    buf[0] = 'GBID';
+    buf[1] = static_cast<int32_t>(mId >> 32);
+    buf[2] = static_cast<int32_t>(mId & 0xFFFFFFFFull);
+    buf[3] = static_cast<int32_t>(mGenerationNumber);
+
+    buffer = static_cast<void*>(static_cast<uint8_t*>(buffer) + sizeNeeded);
+    size -= sizeNeeded;
+
+    return NO_ERROR;
+}
+
+status_t GraphicBuffer::unflattenFromId(void const*& buffer, size_t& size,
+        sp<GraphicBuffer>* outBuffer) {
+    const size_t sizeNeeded = 4 * sizeof(int);
+    if (size < sizeNeeded) return NO_MEMORY;
+
+    int const* buf = static_cast<int const*>(buffer);
+    if (buf[0] != 'GBID') {
+        return BAD_TYPE;
+    }
+
+    uint64_t id = static_cast<uint64_t>(buf[1]) << 32;
+    id |= static_cast<uint32_t>(buf[2]);
+    const uint32_t generation = static_cast<uint32_t>(buf[3]);
+
+    buffer = static_cast<void const*>(
+            static_cast<uint8_t const*>(buffer) + sizeNeeded);
+    size -= sizeNeeded;
+
+    sp<GraphicBuffer> found;
+    { // acquire lock
+        Mutex::Autolock _l(sIdRegistryLock);
+        ssize_t index = sIdRegistry.indexOfKey(id);
+        if (index >= 0) {
+            found = sIdRegistry.valueAt(index).promote();
+        }
+    }
+    // The id check guards against a stale entry left behind when a
+    // GraphicBuffer object is re-used to unflatten a different buffer.
+    if (found == NULL || found->mId != id ||
+            found->mGenerationNumber != generation) {
+        return NAME_NOT_FOUND;
+    }
+
+    *outBuffer = found;
+    return NO_ERROR;
+}
+
 bool GraphicBuffer::isDetachedBuffer() const {
     return mDetachedBufferHandle && mDetachedBufferHandle->isValid();
 }
@@ -24,6 +24,7 @@
 
 #include <grallocusage/GrallocUsageConversion.h>
 
+#include <cutils/properties.h>
 #include <log/log.h>
 #include <utils/Singleton.h>
 #include <utils/String8.h>
@@ -46,6 +47,7 @@ GraphicBufferAllocator::GraphicBufferAllocator()
     mAllocator(std::make_unique<Gralloc2::Allocator>(
                 mMapper.getGrallocMapper()))
 {
+    mPoolTtl = ms2ns(property_get_int64("debug.ui.buffer_pool_ttl_ms", 1000));
 }
 
 GraphicBufferAllocator::~GraphicBufferAllocator() {}
@@ -81,6 +83,12 @@ void GraphicBufferAllocator::dump(String8& result) const
     snprintf(buffer, SIZE, "Total allocated (estimate): %.2f KB\n", total/1024.0);
     result.append(buffer);
 
+    const size_t lookups = mPoolHits + mPoolMisses;
+    snprintf(buffer, SIZE, "Buffer pool: %zu warm buffers, %zu hits / %zu lookups (%.1f%%)\n",
+            mBufferPool.size(), mPoolHits, lookups,
+            lookups ? 100.0 * mPoolHits / lookups : 0.0);
+    result.append(buffer);
+
     std::string deviceDump = mAllocator->dumpDebugInfo();
     result.append(deviceDump.c_str(), deviceDump.size());
 }
@@ -96,9 +104,21 @@ status_t GraphicBufferAllocator::allocate(uint32_t width, uint32_t height,
         PixelFormat format, uint32_t layerCount, uint64_t usage,
         buffer_handle_t* handle, uint32_t* stride,
         uint64_t /*graphicBufferId*/, std::string requestorName)
+{
+    return allocate(width, height, format, layerCount, usage, 1, handle, stride,
+            std::move(requestorName));
+}
+
+status_t GraphicBufferAllocator::allocate(uint32_t width, uint32_t height,
+        PixelFormat format, uint32_t layerCount, uint64_t usage, uint32_t count,
+        buffer_handle_t* outHandles, uint32_t* outStride, std::string requestorName)
 {
     ATRACE_CALL();
 
+    if (count == 0) {
+        return BAD_VALUE;
+    }
+
     // make sure to not allocate a N x 0 or 0 x N buffer, since this is
     // allowed from an API stand-point allocate a 1x1 buffer instead.
     if (!width || !height)
@@ -108,6 +128,37 @@ status_t GraphicBufferAllocator::allocate(uint32_t width, uint32_t height,
     if (layerCount < 1)
         layerCount = 1;
 
+    // Serve as much of the request as possible from the warm pool: a buffer freed with
+    // identical parameters can be handed back without a round trip through the allocator HAL.
+    uint32_t fromPool = 0;
+    if (mPoolTtl > 0) {
+        Mutex::Autolock _l(sLock);
+        evictExpiredBuffersLocked(systemTime(SYSTEM_TIME_MONOTONIC));
+        for (auto it = mBufferPool.begin(); it != mBufferPool.end() && fromPool < count;) {
+            if (it->width == width && it->height == height && it->format == format &&
+                    it->layerCount == layerCount && it->usage == usage) {
+                outHandles[fromPool] = it->handle;
+                *outStride = it->stride;
+                ssize_t index = sAllocList.indexOfKey(it->handle);
+                if (index >= 0) {
+                    sAllocList.editValueAt(index).requestorName = requestorName;
+                }
+                it = mBufferPool.erase(it);
+                fromPool++;
+                mPoolHits++;
+            } else {
+                ++it;
+            }
+        }
+        if (fromPool < count) {
+            mPoolMisses++;
+        }
+    }
+    const uint32_t remaining = count - fromPool;
+    if (remaining == 0) {
+        return NO_ERROR;
+    }
+
     Gralloc2::IMapper::BufferDescriptorInfo info = {};
     info.width = width;
     info.height = height;
@@ -115,7 +166,9 @@ status_t GraphicBufferAllocator::allocate(uint32_t width, uint32_t height,
     info.format = static_cast<Gralloc2::PixelFormat>(format);
     info.usage = usage;
 
-    Gralloc2::Error error = mAllocator->allocate(info, stride, handle);
+    // The remainder is allocated in one trip to the HAL regardless of count.
+    Gralloc2::Error error = mAllocator->allocate(info, remaining, outStride,
+            outHandles + fromPool);
     if (error == Gralloc2::Error::NONE) {
         Mutex::Autolock _l(sLock);
         KeyedVector<buffer_handle_t, alloc_rec_t>& list(sAllocList);
@@ -123,13 +176,15 @@ status_t GraphicBufferAllocator::allocate(uint32_t width, uint32_t height,
         alloc_rec_t rec;
         rec.width = width;
         rec.height = height;
-        rec.stride = *stride;
+        rec.stride = *outStride;
         rec.format = format;
         rec.layerCount = layerCount;
         rec.usage = usage;
-        rec.size = static_cast<size_t>(height * (*stride) * bpp);
+        rec.size = static_cast<size_t>(height * (*outStride) * bpp);
         rec.requestorName = std::move(requestorName);
-        list.add(*handle, rec);
+        for (uint32_t i = 0; i < remaining; i++) {
+            list.add(outHandles[fromPool + i], rec);
+        }
 
         return NO_ERROR;
     } else {
@@ -137,14 +192,57 @@ status_t GraphicBufferAllocator::allocate(uint32_t width, uint32_t height,
                 "usage %" PRIx64 ": %d",
                 width, height, layerCount, format, usage,
                 error);
+        // Return the pool-served buffers so the caller sees all-or-nothing.
+        for (uint32_t i = 0; i < fromPool; i++) {
+            free(outHandles[i]);
+            outHandles[i] = nullptr;
+        }
         return NO_MEMORY;
     }
 }
 
+std::future<status_t> GraphicBufferAllocator::allocateAsync(uint32_t width, uint32_t height,
+        PixelFormat format, uint32_t layerCount, uint64_t usage, uint32_t count,
+        buffer_handle_t* outHandles, uint32_t* outStride, std::string requestorName)
+{
+    return std::async(std::launch::async,
+            [this, width, height, format, layerCount, usage, count, outHandles, outStride,
+             name = std::move(requestorName)]() mutable -> status_t {
+                return allocate(width, height, format, layerCount, usage, count, outHandles,
+                        outStride, std::move(name));
+            });
+}
+
 status_t GraphicBufferAllocator::free(buffer_handle_t handle)
 {
     ATRACE_CALL();
 
+    if (mPoolTtl > 0) {
+        Mutex::Autolock _l(sLock);
+        ssize_t index = sAllocList.indexOfKey(handle);
+        if (index >= 0) {
+            // Keep the buffer warm instead of freeing it: it stays imported in the mapper
+            // and listed in sAllocList until it expires or is evicted.
+            const nsecs_t now = systemTime(SYSTEM_TIME_MONOTONIC);
+            evictExpiredBuffersLocked(now);
+            if (mBufferPool.size() >= MAX_POOLED_BUFFERS) {
+                releaseOldestPooledBufferLocked();
+            }
+            const alloc_rec_t& rec(sAllocList.valueAt(index));
+            pooled_buffer_t pooled;
+            pooled.width = rec.width;
+            pooled.height = rec.height;
+            pooled.format = rec.format;
+            pooled.layerCount = rec.layerCount;
+            pooled.usage = rec.usage;
+            pooled.stride = rec.stride;
+            pooled.handle = handle;
+            pooled.freeTime = now;
+            mBufferPool.push_back(pooled);
+            return NO_ERROR;
+        }
+    }
+
     // We allocated a buffer from the allocator and imported it into the
     // mapper to get the handle.  We just need to free the handle now.
     mMapper.freeBuffer(handle);
@@ -156,5 +254,20 @@ status_t GraphicBufferAllocator::free(buffer_handle_t handle)
     return NO_ERROR;
 }
 
+void GraphicBufferAllocator::releaseOldestPooledBufferLocked()
+{
+    const pooled_buffer_t& pooled(mBufferPool.front());
+    mMapper.freeBuffer(pooled.handle);
+    sAllocList.removeItem(pooled.handle);
+    mBufferPool.pop_front();
+}
+
+void GraphicBufferAllocator::evictExpiredBuffersLocked(nsecs_t now)
+{
+    while (!mBufferPool.empty() && now - mBufferPool.front().freeTime > mPoolTtl) {
+        releaseOldestPooledBufferLocked();
+    }
+}
+
 // ---------------------------------------------------------------------------
 }; // namespace android
@@ -85,6 +85,41 @@ status_t GraphicBufferMapper::importBuffer(buffer_handle_t rawHandle,
     return NO_ERROR;
 }
 
+status_t GraphicBufferMapper::importBuffer(buffer_handle_t rawHandle,
+        uint64_t bufferId, uint32_t width, uint32_t height,
+        uint32_t layerCount, PixelFormat format, uint64_t usage,
+        uint32_t stride, buffer_handle_t* outHandle)
+{
+    { // acquire lock
+        Mutex::Autolock _l(mCacheLock);
+        auto it = mImportCache.find(bufferId);
+        if (it != mImportCache.end()) {
+            it->second.refCount++;
+            *outHandle = it->second.handle;
+            return NO_ERROR;
+        }
+    }
+
+    status_t err = importBuffer(rawHandle, width, height, layerCount, format,
+            usage, stride, outHandle);
+    if (err != NO_ERROR) {
+        return err;
+    }
+
+    { // acquire lock
+        Mutex::Autolock _l(mCacheLock);
+        // Another thread may have imported the same buffer while we were in
+        // the mapper HAL; in that case both imports stay valid and only the
+        // first one to finish is cached.
+        if (mImportCache.count(bufferId) == 0) {
+            mImportCache.emplace(bufferId, CachedBuffer{*outHandle, 1});
+            mImportedIds.emplace(*outHandle, bufferId);
+        }
+    }
+
+    return NO_ERROR;
+}
+
 void GraphicBufferMapper::getTransportSize(buffer_handle_t handle,
             uint32_t* outTransportNumFds, uint32_t* outTransportNumInts)
 {
@@ -95,6 +130,19 @@ status_t GraphicBufferMapper::freeBuffer(buffer_handle_t handle)
 {
     ATRACE_CALL();
 
+    { // acquire lock
+        Mutex::Autolock _l(mCacheLock);
+        auto it = mImportedIds.find(handle);
+        if (it != mImportedIds.end()) {
+            auto cached = mImportCache.find(it->second);
+            if (--cached->second.refCount > 0) {
+                return NO_ERROR;
+            }
+            mImportCache.erase(cached);
+            mImportedIds.erase(it);
+        }
+    }
+
     mMapper->freeBuffer(handle);
 
     return NO_ERROR;
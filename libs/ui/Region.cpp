@@ -188,17 +188,29 @@ static void reverseRectsResolvingJunctions(const Rect* begin, const Rect* end,
  * Note: the output will not necessarily be a very efficient representation of the region, since it
  * may be that a triangle-based approach would generate significantly simpler geometry
  */
+/**
+ * Shared implementation of createTJunctionFreeRegion(). Both directional
+ * passes are needed - each one only resolves junctions against the span on
+ * one side - but all intermediate storage lives in |scratch|, so a caller
+ * providing its own arena pays no per-call allocation once the arena has
+ * grown to a steady state.
+ */
+static void makeTJunctionFreeRegion(const Rect* begin, const Rect* end,
+        const Rect& bounds, Vector<Rect>& scratch, Vector<Rect>& dst) {
+    reverseRectsResolvingJunctions(begin, end, scratch, direction_RTL);
+    reverseRectsResolvingJunctions(scratch.begin(), scratch.end(), dst,
+            direction_LTR);
+    dst.add(bounds); // to make region valid, mStorage must end with bounds
+}
+
 Region Region::createTJunctionFreeRegion(const Region& r) {
     if (r.isEmpty()) return r;
     if (r.isRect()) return r;
 
-    Vector<Rect> reversed;
-    reverseRectsResolvingJunctions(r.begin(), r.end(), reversed, direction_RTL);
-
+    Vector<Rect> scratch;
     Region outputRegion;
-    reverseRectsResolvingJunctions(reversed.begin(), reversed.end(),
-            outputRegion.mStorage, direction_LTR);
-    outputRegion.mStorage.add(r.getBounds()); // to make region valid, mStorage must end with bounds
+    makeTJunctionFreeRegion(r.begin(), r.end(), r.getBounds(), scratch,
+            outputRegion.mStorage);
 
 #if VALIDATE_REGIONS
     validate(outputRegion, "T-Junction free region");
@@ -207,6 +219,29 @@ Region Region::createTJunctionFreeRegion(const Region& r) {
     return outputRegion;
 }
 
+const Region& Region::createTJunctionFreeRegion(const Region& r,
+        TJunctionFreeCache& cache) {
+    if (cache.mInput.isTriviallyEqual(r)) {
+        return cache.mOutput;
+    }
+
+    // Keep a reference to r's storage; as long as it is cached the caller
+    // cannot mutate that storage in place, so trivial equality above stays
+    // a valid identity test.
+    cache.mInput = r;
+
+    if (r.isEmpty() || r.isRect()) {
+        cache.mOutput = r;
+    } else {
+        makeTJunctionFreeRegion(r.begin(), r.end(), r.getBounds(),
+                cache.mScratch, cache.mOutput.mStorage);
+#if VALIDATE_REGIONS
+        validate(cache.mOutput, "T-Junction free region (cached)");
+#endif
+    }
+    return cache.mOutput;
+}
+
 Region& Region::operator = (const Region& rhs)
 {
 #if VALIDATE_REGIONS
@@ -414,19 +449,27 @@ const Region Region::operation(const Region& rhs, int dx, int dy, uint32_t op) c
 // ----------------------------------------------------------------------------
 
 // This is our region rasterizer, which merges rects and spans together
-// to obtain an optimal region.
+// to obtain an optimal region. Spans are accumulated directly at the tail
+// of the destination storage (tracked by index, since the buffer may move
+// when it grows) instead of in a separate scratch Vector, so a boolean
+// operation performs no allocations beyond the destination's own growth.
 class Region::rasterizer : public region_operator<Rect>::region_rasterizer
 {
     Rect bounds;
     Vector<Rect>& storage;
-    Rect* head;
-    Rect* tail;
-    Vector<Rect> span;
-    Rect* cur;
+    // Start of the previously flushed span in storage
+    size_t headIndex;
+    // Start of the span currently being accumulated; everything at or past
+    // this index is part of the open span
+    size_t spanIndex;
 public:
-    explicit rasterizer(Region& reg)
-        : bounds(INT_MAX, 0, INT_MIN, 0), storage(reg.mStorage), head(), tail(), cur() {
+    explicit rasterizer(Region& reg, size_t capacityHint = 0)
+        : bounds(INT_MAX, 0, INT_MIN, 0), storage(reg.mStorage),
+          headIndex(0), spanIndex(0) {
         storage.clear();
+        if (capacityHint > storage.capacity()) {
+            storage.setCapacity(capacityHint);
+        }
     }
 
     virtual ~rasterizer();
@@ -444,7 +487,7 @@ private:
 
 Region::rasterizer::~rasterizer()
 {
-    if (span.size()) {
+    if (storage.size() > spanIndex) {
         flushSpan();
     }
     if (storage.size()) {
@@ -464,7 +507,8 @@ void Region::rasterizer::operator()(const Rect& rect)
 {
     //ALOGD(">>> %3d, %3d, %3d, %3d",
     //        rect.left, rect.top, rect.right, rect.bottom);
-    if (span.size()) {
+    if (storage.size() > spanIndex) {
+        Rect* cur = storage.editArray() + (storage.size() - 1);
         if (cur->top != rect.top) {
             flushSpan();
         } else if (cur->right == rect.left) {
@@ -472,43 +516,41 @@ void Region::rasterizer::operator()(const Rect& rect)
             return;
         }
     }
-    span.add(rect);
-    cur = span.editArray() + (span.size() - 1);
+    storage.add(rect);
 }
 
 void Region::rasterizer::flushSpan()
 {
+    const size_t spanCount = storage.size() - spanIndex;
     bool merge = false;
-    if (tail-head == ssize_t(span.size())) {
-        Rect const* p = span.editArray();
-        Rect const* q = head;
+    if (spanIndex - headIndex == spanCount) {
+        Rect const* p = storage.array() + spanIndex;
+        Rect const* q = storage.array() + headIndex;
         if (p->top == q->bottom) {
             merge = true;
-            while (q != tail) {
-                if ((p->left != q->left) || (p->right != q->right)) {
+            for (size_t i = 0; i < spanCount; i++) {
+                if ((p[i].left != q[i].left) || (p[i].right != q[i].right)) {
                     merge = false;
                     break;
                 }
-                p++;
-                q++;
             }
         }
     }
     if (merge) {
-        const int bottom = span[0].bottom;
-        Rect* r = head;
-        while (r != tail) {
-            r->bottom = bottom;
-            r++;
+        // The span is identical to the previous one; extend the previous
+        // span downward and drop the new rects
+        const int bottom = storage.itemAt(spanIndex).bottom;
+        Rect* r = storage.editArray() + headIndex;
+        for (size_t i = 0; i < spanIndex - headIndex; i++) {
+            r[i].bottom = bottom;
         }
+        storage.removeItemsAt(spanIndex, spanCount);
     } else {
-        bounds.left = min(span.itemAt(0).left, bounds.left);
-        bounds.right = max(span.top().right, bounds.right);
-        storage.appendVector(span);
-        tail = storage.editArray() + storage.size();
-        head = tail - span.size();
+        bounds.left = min(storage.itemAt(spanIndex).left, bounds.left);
+        bounds.right = max(storage.top().right, bounds.right);
+        headIndex = spanIndex;
     }
-    span.clear();
+    spanIndex = storage.size();
 }
 
 bool Region::validate(const Region& reg, const char* name, bool silent)
@@ -589,6 +631,112 @@ bool Region::validate(const Region& reg, const char* name, bool silent)
     return result;
 }
 
+bool Region::boolean_operation_fast_path(uint32_t op, Region& dst,
+        const Region& lhs, const Region* rhs, const Rect& rhsBounds,
+        bool rhsIsRect, int dx, int dy)
+{
+    const Rect lhsBounds(lhs.getBounds());
+    const bool lhsIsRect = lhs.isRect();
+    const bool lhsEmpty = lhsBounds.isEmpty();
+    const bool rhsEmpty = rhsBounds.isEmpty();
+
+    Rect intersection;
+    const bool overlap = lhsBounds.intersect(rhsBounds, &intersection);
+
+    const bool lhsContainsRhs = !rhsEmpty &&
+            lhsBounds.left <= rhsBounds.left && lhsBounds.top <= rhsBounds.top &&
+            lhsBounds.right >= rhsBounds.right && lhsBounds.bottom >= rhsBounds.bottom;
+    const bool rhsContainsLhs = !lhsEmpty &&
+            rhsBounds.left <= lhsBounds.left && rhsBounds.top <= lhsBounds.top &&
+            rhsBounds.right >= lhsBounds.right && rhsBounds.bottom >= lhsBounds.bottom;
+
+    // Copies the right-hand operand into dst, applying the translation
+    auto copyRhs = [&] {
+        if (rhs != nullptr) {
+            if (&dst != rhs) {
+                dst = *rhs;
+            }
+            translate(dst, dx, dy);
+        } else {
+            dst.set(rhsBounds);
+        }
+    };
+
+    switch (op) {
+        case op_and:
+            if (!overlap) {
+                dst.clear();
+                return true;
+            }
+            if (lhsIsRect && rhsIsRect) {
+                dst.set(intersection);
+                return true;
+            }
+            if (rhsIsRect && rhsContainsLhs) {
+                if (&dst != &lhs) {
+                    dst = lhs;
+                }
+                return true;
+            }
+            if (lhsIsRect && lhsContainsRhs) {
+                copyRhs();
+                return true;
+            }
+            break;
+        case op_or:
+            if (lhsEmpty) {
+                copyRhs();
+                return true;
+            }
+            if (rhsEmpty) {
+                if (&dst != &lhs) {
+                    dst = lhs;
+                }
+                return true;
+            }
+            if (rhsIsRect && rhsContainsLhs) {
+                dst.set(rhsBounds);
+                return true;
+            }
+            if (lhsIsRect && lhsContainsRhs) {
+                if (&dst != &lhs) {
+                    dst = lhs;
+                }
+                return true;
+            }
+            break;
+        case op_nand:
+            if (lhsEmpty) {
+                dst.clear();
+                return true;
+            }
+            if (rhsEmpty || !overlap) {
+                if (&dst != &lhs) {
+                    dst = lhs;
+                }
+                return true;
+            }
+            if (rhsIsRect && rhsContainsLhs) {
+                dst.clear();
+                return true;
+            }
+            break;
+        case op_xor:
+            if (lhsEmpty) {
+                copyRhs();
+                return true;
+            }
+            if (rhsEmpty) {
+                if (&dst != &lhs) {
+                    dst = lhs;
+                }
+                return true;
+            }
+            break;
+    }
+    return false;
+}
+
 void Region::boolean_operation(uint32_t op, Region& dst,
         const Region& lhs,
         const Region& rhs, int dx, int dy)
@@ -599,6 +747,17 @@ void Region::boolean_operation(uint32_t op, Region& dst,
     validate(dst, "boolean_operation (before): dst");
 #endif
 
+#if !VALIDATE_REGIONS && !VALIDATE_WITH_CORECG
+    // Most operations SurfaceFlinger issues per frame hit one of the
+    // trivial cases; resolving them from the bounds alone skips the span
+    // rasterizer and its storage reallocation.
+    Rect rhsBounds(rhs.getBounds());
+    rhsBounds.offsetBy(dx, dy);
+    if (boolean_operation_fast_path(op, dst, lhs, &rhs, rhsBounds, rhs.isRect(), dx, dy)) {
+        return;
+    }
+#endif
+
     size_t lhs_count;
     Rect const * const lhs_rects = lhs.getArray(&lhs_count);
 
@@ -609,7 +768,7 @@ void Region::boolean_operation(uint32_t op, Region& dst,
     region_operator<Rect>::region rhs_region(rhs_rects, rhs_count, dx, dy);
     region_operator<Rect> operation(op, lhs_region, rhs_region);
     { // scope for rasterizer (dtor has side effects)
-        rasterizer r(dst);
+        rasterizer r(dst, lhs_count + rhs_count);
         operation(r);
     }
 
@@ -714,6 +873,12 @@ void Region::boolean_operation(uint32_t op, Region& dst,
 #if VALIDATE_WITH_CORECG || VALIDATE_REGIONS
     boolean_operation(op, dst, lhs, Region(rhs), dx, dy);
 #else
+    Rect rhsBounds(rhs);
+    rhsBounds.offsetBy(dx, dy);
+    if (boolean_operation_fast_path(op, dst, lhs, nullptr, rhsBounds, true, dx, dy)) {
+        return;
+    }
+
     size_t lhs_count;
     Rect const * const lhs_rects = lhs.getArray(&lhs_count);
 
@@ -721,7 +886,7 @@ void Region::boolean_operation(uint32_t op, Region& dst,
     region_operator<Rect>::region rhs_region(&rhs, 1, dx, dy);
     region_operator<Rect> operation(op, lhs_region, rhs_region);
     { // scope for rasterizer (dtor has side effects)
-        rasterizer r(dst);
+        rasterizer r(dst, lhs_count + 1);
         operation(r);
     }
 
@@ -162,6 +162,20 @@ public:
         return apply(v, mEOTF);
     }
 
+    /**
+     * Encodes count RGB values in place using this color space's
+     * opto-electronic transfer function. For color spaces defined by
+     * transfer parameters or a gamma value the transfer math is
+     * evaluated directly, avoiding an indirect call per channel.
+     */
+    void fromLinear(float3* v, size_t count) const noexcept;
+
+    /**
+     * Decodes count RGB values in place using this color space's
+     * electro-optical transfer function. See fromLinear(float3*, size_t).
+     */
+    void toLinear(float3* v, size_t count) const noexcept;
+
     /**
      * Converts the supplied XYZ value to RGB. The returned value
      * is encoded with this color space's opto-electronic transfer
@@ -253,6 +267,23 @@ public:
     static std::unique_ptr<float3> createLUT(uint32_t size,
             const ColorSpace& src, const ColorSpace& dst);
 
+    // Creates a 1D LUT of the specified size (min=2, max=1024) tabulating
+    // the supplied transfer function over the domain [0..1]. Evaluate it
+    // with lookupLUT1D(). Useful to amortize an expensive custom transfer
+    // function over a whole image
+    static std::unique_ptr<float> createLUT1D(uint32_t size,
+            const transfer_function& fn);
+
+    // Evaluates a LUT created by createLUT1D() at x, interpolating
+    // linearly between samples. x is clamped to the domain [0..1]
+    static float lookupLUT1D(const float* lut, uint32_t size, float x) noexcept {
+        float v = saturate(x) * float(size - 1);
+        uint32_t i = uint32_t(v);
+        if (i > size - 2) i = size - 2;
+        float f = v - float(i);
+        return lut[i] + (lut[i + 1] - lut[i]) * f;
+    }
+
 private:
     static constexpr mat3 computeXYZMatrix(
             const std::array<float2, 3>& primaries, const float2& whitePoint);
@@ -261,6 +292,17 @@ private:
         return v;
     }
 
+    // How the transfer functions were specified, so the bulk conversions
+    // can evaluate the transfer math directly instead of going through
+    // mOETF/mEOTF for every channel
+    enum class TransferType {
+        Linear,          // identity
+        Gamma,           // pure power curve
+        Parametric,      // TransferParameters with e == f == 0
+        ParametricFull,  // all seven TransferParameters
+        Custom           // arbitrary transfer_function objects
+    };
+
     std::string mName;
 
     mat3 mRGBtoXYZ;
@@ -270,6 +312,7 @@ private:
     transfer_function mOETF;
     transfer_function mEOTF;
     clamping_function mClamper;
+    TransferType mTransferType;
 
     std::array<float2, 3> mPrimaries;
     float2 mWhitePoint;
@@ -289,6 +332,14 @@ public:
         return apply(mDestination.fromLinear(mTransform * linear), mDestination.getClamper());
     }
 
+    /**
+     * Bulk, in-place variant of transform(). The matrix multiply and the
+     * transfer functions are each applied over the whole batch, which lets
+     * parametric color spaces evaluate the transfer math without an
+     * indirect call per channel.
+     */
+    void transform(float3* v, size_t count) const noexcept;
+
     constexpr float3 transformLinear(const float3& v) const noexcept {
         float3 linear = apply(v, mSource.getClamper());
         return apply(mTransform * linear, mDestination.getClamper());
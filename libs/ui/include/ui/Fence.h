@@ -19,6 +19,9 @@
 
 #include <stdint.h>
 
+#include <atomic>
+#include <vector>
+
 #include <android-base/unique_fd.h>
 #include <utils/Flattenable.h>
 #include <utils/RefBase.h>
@@ -94,6 +97,18 @@ public:
     static sp<Fence> merge(const String8& name, const sp<Fence>& f1,
             const sp<Fence>& f2);
 
+    // merge combines count Fence objects, creating a new Fence object that
+    // becomes signaled when all of them are signaled. Invalid fences (and
+    // NULL entries) are skipped, so merging a set with a single valid fence
+    // costs one kernel call and merging a set with none returns NO_FENCE
+    // without any. Folding the whole set here is cheaper than a chain of
+    // two-fence merges, which pays an extra kernel call per invalid fence.
+    static sp<Fence> merge(const char* name, const sp<Fence>* fences,
+            size_t count);
+
+    static sp<Fence> merge(const char* name,
+            const std::vector<sp<Fence>>& fences);
+
     // Return a duplicate of the fence file descriptor. The caller is
     // responsible for closing the returned file descriptor. On error, -1 will
     // be returned and errno will indicate the problem.
@@ -113,8 +128,12 @@ public:
 
     // getStatus() returns whether the fence has signaled yet. Prefer this to
     // getSignalTime() or wait() if all you care about is whether the fence has
-    // signaled.
+    // signaled. Once the fence has been seen signaled the result is cached and
+    // subsequent calls return without going back to the kernel.
     inline Status getStatus() {
+        if (mSignaled.load(std::memory_order_relaxed)) {
+            return Status::Signaled;
+        }
         // The sync_wait call underlying wait() has been measured to be
         // significantly faster than the sync_fence_info call underlying
         // getSignalTime(), which might otherwise appear to be the more obvious
@@ -141,6 +160,10 @@ private:
     ~Fence() = default;
 
     base::unique_fd mFenceFd;
+    // Set once the fence has been observed signaled, so the queue/acquire
+    // bookkeeping paths that poll getStatus() stop issuing kernel calls for
+    // fences that already signaled.
+    mutable std::atomic<bool> mSignaled{false};
 };
 
 }; // namespace android
@@ -153,17 +153,37 @@ private:
 // if FenceTimeline did nothing. i.e. they should eventually call
 // Fence::getSignalTime(), not only Fence::getCachedSignalTime().
 //
-// push() and updateSignalTimes() are safe to call simultaneously from
-// different threads.
+// push() is lock-free and safe to call simultaneously from multiple
+// threads, including concurrently with updateSignalTimes().
+// updateSignalTimes() is the single consumer and must not be called from
+// two threads at the same time.
 class FenceTimeline {
 public:
     static constexpr size_t MAX_ENTRIES = 64;
 
+    FenceTimeline() = default;
+    ~FenceTimeline();
+
     void push(const std::shared_ptr<FenceTime>& fence);
     void updateSignalTimes();
 
 private:
-    mutable std::mutex mMutex;
+    // A fence pushed by a producer but not yet drained by the consumer.
+    // Producers link entries onto mIncoming with a CAS; the consumer takes
+    // the whole chain in one exchange.
+    struct Entry {
+        explicit Entry(const std::shared_ptr<FenceTime>& f) : fence(f) {}
+        std::weak_ptr<FenceTime> fence;
+        Entry* next{nullptr};
+    };
+
+    // Moves the entries pushed since the last drain into mQueue.
+    // Only called by the consumer.
+    void drainIncoming();
+
+    // Lock-free LIFO of freshly pushed fences (multi-producer).
+    std::atomic<Entry*> mIncoming{nullptr};
+    // FIFO of pending fences, only touched by the consumer.
     std::queue<std::weak_ptr<FenceTime>> mQueue;
 };
 
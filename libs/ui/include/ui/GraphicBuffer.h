@@ -26,6 +26,8 @@
 #include <ui/PixelFormat.h>
 #include <ui/Rect.h>
 #include <utils/Flattenable.h>
+#include <utils/KeyedVector.h>
+#include <utils/Mutex.h>
 #include <utils/RefBase.h>
 
 #include <nativebase/nativebase.h>
@@ -180,6 +182,16 @@ public:
             android_ycbcr *ycbcr, int fenceFd);
     status_t unlockAsync(int *fenceFd);
 
+    // Persistent CPU mapping. The first call establishes a long-lived
+    // full-buffer mapping through the mapper HAL; subsequent calls only
+    // synchronize on fenceFd and hand out the cached address, skipping the
+    // mapper round-trip. inUsage must be a subset of the usage of the first
+    // call. unlockPersistent() does not release the mapping - that happens
+    // when the buffer is destroyed - so this is only suitable for buffers
+    // whose contents are exclusively produced and consumed on the CPU.
+    status_t lockPersistent(uint64_t inUsage, void** vaddr, int fenceFd = -1);
+    status_t unlockPersistent();
+
     ANativeWindowBuffer* getNativeBuffer() const;
 
     // for debugging
@@ -191,6 +203,20 @@ public:
     status_t flatten(void*& buffer, size_t& size, int*& fds, size_t& count) const;
     status_t unflatten(void const*& buffer, size_t& size, int const*& fds, size_t& count);
 
+    // Cached-transport protocol. A sender that knows the receiver has
+    // already unflattened this exact buffer (for example because the
+    // receiver acknowledged its id and generation) may transport just the
+    // id and generation with flattenAsId(), skipping the handle fds and
+    // ints and their dup cost. The receiver reconstitutes the buffer with
+    // unflattenFromId(), which looks it up in a per-process registry that
+    // unflatten() populates. If the buffer is not registered or the
+    // generation does not match, unflattenFromId() returns NAME_NOT_FOUND
+    // and the sender must fall back to a full flatten().
+    size_t getIdFlattenedSize() const;
+    status_t flattenAsId(void*& buffer, size_t& size) const;
+    static status_t unflattenFromId(void const*& buffer, size_t& size,
+            sp<GraphicBuffer>* outBuffer);
+
     // Sets and takes DetachedBuffer. Should only be called from BufferHub.
     bool isDetachedBuffer() const;
     status_t setDetachedBufferHandle(std::unique_ptr<DetachedBufferHandle> detachedBuffer);
@@ -242,11 +268,27 @@ private:
 
     uint64_t mId;
 
+    // Set when this buffer is in sIdRegistry, so the destructor knows to
+    // remove it.
+    bool mRegistered;
+
+    // Per-process registry of buffers that arrived through unflatten(),
+    // keyed by buffer id. Backs unflattenFromId(). Entries are weak so the
+    // registry never extends a buffer's lifetime.
+    static Mutex sIdRegistryLock;
+    static KeyedVector<uint64_t, wp<GraphicBuffer>> sIdRegistry;
+
     // Stores the generation number of this buffer. If this number does not
     // match the BufferQueue's internal generation number (set through
     // IGBP::setGenerationNumber), attempts to attach the buffer will fail.
     uint32_t mGenerationNumber;
 
+    // Persistent mapping state, see lockPersistent(). mPersistentVaddr is
+    // non-null while the long-lived mapper lock is held.
+    mutable Mutex mPersistentLock;
+    void* mPersistentVaddr;
+    uint64_t mPersistentUsage;
+
     // Stores a BufferHub handle that can be used to re-attach this GraphicBuffer back into a
     // BufferHub producer/consumer set. In terms of GraphicBuffer's relationship with BufferHub,
     // there are three different modes:
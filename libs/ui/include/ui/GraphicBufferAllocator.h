@@ -20,6 +20,8 @@
 
 #include <stdint.h>
 
+#include <future>
+#include <list>
 #include <memory>
 #include <string>
 
@@ -31,6 +33,7 @@
 #include <utils/KeyedVector.h>
 #include <utils/Mutex.h>
 #include <utils/Singleton.h>
+#include <utils/Timers.h>
 
 namespace android {
 
@@ -51,6 +54,26 @@ public:
             buffer_handle_t* handle, uint32_t* stride, uint64_t graphicBufferId,
             std::string requestorName);
 
+    /*
+     * Allocates count buffers with identical parameters in a single trip to the
+     * allocator HAL. outHandles must have room for count handles; all buffers
+     * share the returned stride. On error no buffer stays allocated.
+     */
+    status_t allocate(uint32_t w, uint32_t h, PixelFormat format,
+            uint32_t layerCount, uint64_t usage, uint32_t count,
+            buffer_handle_t* outHandles, uint32_t* outStride,
+            std::string requestorName);
+
+    /*
+     * Like the batched allocate, but runs on a separate thread so the HAL work
+     * overlaps with the caller. The caller must keep outHandles and outStride
+     * valid until the returned future is ready.
+     */
+    std::future<status_t> allocateAsync(uint32_t w, uint32_t h, PixelFormat format,
+            uint32_t layerCount, uint64_t usage, uint32_t count,
+            buffer_handle_t* outHandles, uint32_t* outStride,
+            std::string requestorName);
+
     status_t free(buffer_handle_t handle);
 
     void dump(String8& res) const;
@@ -68,6 +91,24 @@ private:
         std::string requestorName;
     };
 
+    // A freed buffer kept warm for reuse. Buffers are interchangeable only when every
+    // allocation parameter matches.
+    struct pooled_buffer_t {
+        uint32_t width;
+        uint32_t height;
+        PixelFormat format;
+        uint32_t layerCount;
+        uint64_t usage;
+        uint32_t stride;
+        buffer_handle_t handle;
+        nsecs_t freeTime;
+    };
+
+    // Release the oldest pooled buffer back to the mapper.
+    void releaseOldestPooledBufferLocked();
+    // Release pooled buffers whose TTL has expired.
+    void evictExpiredBuffersLocked(nsecs_t now);
+
     static Mutex sLock;
     static KeyedVector<buffer_handle_t, alloc_rec_t> sAllocList;
 
@@ -77,6 +118,16 @@ private:
 
     GraphicBufferMapper& mMapper;
     const std::unique_ptr<const Gralloc2::Allocator> mAllocator;
+
+    // Warm buffer pool, oldest entries first. Pooled buffers stay imported in the mapper and
+    // listed in sAllocList until they expire or are evicted. Guarded by sLock.
+    std::list<pooled_buffer_t> mBufferPool;
+    size_t mPoolHits = 0;
+    size_t mPoolMisses = 0;
+    // How long a freed buffer is retained for reuse; 0 disables pooling.
+    nsecs_t mPoolTtl;
+
+    static const size_t MAX_POOLED_BUFFERS = 32;
 };
 
 // ---------------------------------------------------------------------------
@@ -21,8 +21,10 @@
 #include <sys/types.h>
 
 #include <memory>
+#include <unordered_map>
 
 #include <ui/PixelFormat.h>
+#include <utils/Mutex.h>
 #include <utils/Singleton.h>
 
 
@@ -54,6 +56,17 @@ public:
             PixelFormat format, uint64_t usage, uint32_t stride,
             buffer_handle_t* outHandle);
 
+    // Like importBuffer, but consults a per-process cache keyed by the
+    // buffer's unique ID (GraphicBuffer::getId) first. If the buffer has
+    // already been imported by this process, the cached handle is returned
+    // and its reference count incremented, skipping the mapper HAL call.
+    // The outHandle must still be freed with freeBuffer; the underlying
+    // import is released when the last reference is freed.
+    status_t importBuffer(buffer_handle_t rawHandle, uint64_t bufferId,
+            uint32_t width, uint32_t height, uint32_t layerCount,
+            PixelFormat format, uint64_t usage, uint32_t stride,
+            buffer_handle_t* outHandle);
+
     status_t freeBuffer(buffer_handle_t handle);
 
     void getTransportSize(buffer_handle_t handle,
@@ -91,6 +104,20 @@ private:
     GraphicBufferMapper();
 
     const std::unique_ptr<const Gralloc2::Mapper> mMapper;
+
+    // A buffer imported through the cache, shared by every GraphicBuffer in
+    // this process that was unflattened from the same allocation.
+    struct CachedBuffer {
+        buffer_handle_t handle;
+        uint32_t refCount;
+    };
+
+    // Per-process import cache keyed by buffer ID, with a reverse map from
+    // the imported handle so freeBuffer can find the cache entry. Both are
+    // guarded by mCacheLock.
+    mutable Mutex mCacheLock;
+    std::unordered_map<uint64_t, CachedBuffer> mImportCache;
+    std::unordered_map<buffer_handle_t, uint64_t> mImportedIds;
 };
 
 // ---------------------------------------------------------------------------
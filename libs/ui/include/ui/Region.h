@@ -43,6 +43,20 @@ public:
 
     static  Region      createTJunctionFreeRegion(const Region& r);
 
+    // Reusable scratch space and memo for createTJunctionFreeRegion().
+    // Callers that repeatedly convert the same few regions (e.g. once per
+    // frame) keep one of these around; a call with an unchanged region is
+    // answered from the memo without rebuilding anything. The cache holds a
+    // reference to the input region's storage, so storage identity
+    // (isTriviallyEqual) is a sound cache key: any mutation of the caller's
+    // region copies or replaces its storage first. The returned reference
+    // is only valid until the next call with the same cache; copy it (O(1),
+    // shared storage) to keep it longer.
+    class TJunctionFreeCache;
+
+    static  const Region& createTJunctionFreeRegion(const Region& r,
+                                                    TJunctionFreeCache& cache);
+
         Region& operator = (const Region& rhs);
 
     inline  bool        isEmpty() const     { return getBounds().isEmpty(); }
@@ -129,6 +143,16 @@ public:
     // Region object.
     Rect const* getArray(size_t* count) const;
 
+    // Calls f(const Rect&) for every rect in the region, in the Y-X sorted
+    // order of the internal storage. This walks the storage in place; there
+    // is never a reason to copy the rects into a temporary array first.
+    template <typename F>
+    void forEachRect(F&& f) const {
+        for (const_iterator it = begin(), e = end(); it != e; ++it) {
+            f(*it);
+        }
+    }
+
     /* no user serviceable parts here... */
 
             // add a rectangle to the internal list. This rectangle must
@@ -159,6 +183,16 @@ private:
     static void boolean_operation(uint32_t op, Region& dst,
             const Region& lhs, const Rect& rhs, int dx, int dy);
 
+    // Handles the structurally trivial cases of a boolean operation (empty
+    // or disjoint operands, single-rect containment) without running the
+    // span rasterizer, producing exactly the result the rasterizer would.
+    // rhsBounds must already be translated; rhs may be null when the
+    // right-hand operand is just a rect. Returns whether the operation was
+    // handled.
+    static bool boolean_operation_fast_path(uint32_t op, Region& dst,
+            const Region& lhs, const Region* rhs, const Rect& rhsBounds,
+            bool rhsIsRect, int dx, int dy);
+
     static void boolean_operation(uint32_t op, Region& dst,
             const Region& lhs, const Region& rhs);
     static void boolean_operation(uint32_t op, Region& dst,
@@ -177,6 +211,16 @@ private:
     Vector<Rect> mStorage;
 };
 
+// Defined outside the Region body because it holds Regions by value; see the
+// comment at the forward declaration for the caching contract.
+class Region::TJunctionFreeCache {
+private:
+    friend class Region;
+    Region mInput;
+    Region mOutput;
+    Vector<Rect> mScratch;
+};
+
 
 const Region Region::operator | (const Region& rhs) const {
     return merge(rhs);
@@ -152,5 +152,120 @@ TEST_F(RegionTest, Random_TJunction) {
     }
 }
 
+TEST_F(RegionTest, Cached_TJunction) {
+    Region::TJunctionFreeCache cache;
+
+    Region r;
+     // | x |
+     // |xxx|
+    r.orSelf(Rect(1, 0, 2, 1));
+    r.orSelf(Rect(0, 1, 3, 2));
+
+    // The cached overload produces the same region as the uncached one
+    Region first = Region::createTJunctionFreeRegion(r, cache);
+    verifyNoTJunctions(first);
+    EXPECT_TRUE((r ^ first).isEmpty());
+    EXPECT_TRUE((Region::createTJunctionFreeRegion(r) ^ first).isEmpty());
+
+    // A repeated call with the unchanged region is answered from the memo
+    // (same underlying storage, nothing rebuilt)
+    EXPECT_TRUE(Region::createTJunctionFreeRegion(r, cache).isTriviallyEqual(first));
+
+    // Mutating the region invalidates the memo
+    r.orSelf(Rect(0, 2, 1, 3));
+    const Region& reconverted = Region::createTJunctionFreeRegion(r, cache);
+    verifyNoTJunctions(reconverted);
+    EXPECT_TRUE((r ^ reconverted).isEmpty());
+    EXPECT_FALSE(reconverted.isTriviallyEqual(first));
+
+    // In-place mutation (translate) must also miss the cache
+    Region before = Region::createTJunctionFreeRegion(r, cache);
+    r.translateSelf(1, 1);
+    const Region& after = Region::createTJunctionFreeRegion(r, cache);
+    EXPECT_TRUE((r ^ after).isEmpty());
+    EXPECT_FALSE(after.isTriviallyEqual(before));
+
+    // Trivial regions pass through the cache unchanged
+    Region rect(Rect(0, 0, 10, 10));
+    EXPECT_TRUE(Region::createTJunctionFreeRegion(rect, cache).isTriviallyEqual(rect));
+}
+
+TEST_F(RegionTest, ForEachRect) {
+    Region r;
+    r.orSelf(Rect(0, 0, 10, 10));
+    r.orSelf(Rect(20, 0, 30, 10));
+    r.orSelf(Rect(0, 20, 30, 30));
+
+    // forEachRect visits exactly the rects exposed by begin()/end(),
+    // in the same order
+    const Rect* expected = r.begin();
+    size_t visited = 0;
+    r.forEachRect([&](const Rect& rect) {
+        ASSERT_LT(expected + visited, r.end());
+        EXPECT_EQ(expected[visited], rect);
+        visited++;
+    });
+    EXPECT_EQ(size_t(r.end() - r.begin()), visited);
+
+    // An empty region visits nothing
+    Region empty;
+    empty.forEachRect([](const Rect& rect) {
+        EXPECT_TRUE(rect.isEmpty());
+    });
+}
+
+TEST_F(RegionTest, BooleanFastPaths) {
+    const Rect outer(0, 0, 100, 100);
+    const Rect inner(10, 10, 20, 20);
+    const Rect disjoint(200, 200, 300, 300);
+
+    // An L-shaped region contained inside outer
+    Region lShape;
+    lShape.orSelf(Rect(10, 10, 20, 30));
+    lShape.orSelf(Rect(10, 30, 40, 40));
+
+    // Intersection with a disjoint rect is empty
+    EXPECT_TRUE(lShape.intersect(disjoint).isEmpty());
+
+    // Intersection of two rects is their geometric intersection
+    Region r(Rect(0, 0, 50, 50));
+    Region i = r.intersect(Rect(25, 25, 100, 100));
+    EXPECT_TRUE(i.isRect());
+    EXPECT_EQ(Rect(25, 25, 50, 50), i.getBounds());
+
+    // Intersection with a containing rect preserves the region exactly
+    Region clipped = lShape.intersect(outer);
+    EXPECT_TRUE((clipped ^ lShape).isEmpty());
+    EXPECT_EQ(lShape.end() - lShape.begin(), clipped.end() - clipped.begin());
+
+    // Union with an empty region yields the other operand
+    Region empty;
+    EXPECT_TRUE((lShape.merge(empty) ^ lShape).isEmpty());
+    EXPECT_TRUE((empty.merge(inner)).isRect());
+
+    // Union with a containing rect collapses to that rect
+    Region merged = lShape.merge(outer);
+    EXPECT_TRUE(merged.isRect());
+    EXPECT_EQ(outer, merged.getBounds());
+
+    // Subtracting a disjoint rect is a no-op
+    EXPECT_TRUE((lShape.subtract(disjoint) ^ lShape).isEmpty());
+
+    // Subtracting a covering rect empties the region
+    EXPECT_TRUE(lShape.subtract(outer).isEmpty());
+
+    // Xor with an empty region yields the other operand
+    EXPECT_TRUE((lShape.mergeExclusive(empty) ^ lShape).isEmpty());
+
+    // Overlapping operands still go through the full rasterizer
+    Region overlap(Rect(0, 0, 20, 20));
+    overlap.orSelf(Rect(10, 10, 30, 30));
+    Region expected;
+    expected.orSelf(Rect(0, 0, 20, 10));
+    expected.orSelf(Rect(0, 10, 30, 20));
+    expected.orSelf(Rect(10, 20, 30, 30));
+    EXPECT_TRUE((overlap ^ expected).isEmpty());
+}
+
 }; // namespace android
 
@@ -162,6 +162,31 @@ TEST_F(ColorSpaceTest, Connect) {
     EXPECT_TRUE(all(lessThan(abs(r - float3{0.70226f, 0.2757f, 0.1036f}), float3{1e-4f})));
 }
 
+TEST_F(ColorSpaceTest, BulkTransform) {
+    ColorSpaceConnector connector(ColorSpace::sRGB(), ColorSpace::ProPhotoRGB());
+
+    const float3 colors[] = {{1.0f, 0.5f, 0.0f}, {0.25f, 0.5f, 0.75f}, {0.0f, 1.0f, 1.0f}};
+    float3 bulk[] = {colors[0], colors[1], colors[2]};
+    connector.transform(bulk, 3);
+
+    // The bulk path must agree with the per-color path
+    for (size_t i = 0; i < 3; i++) {
+        auto r = connector.transform(colors[i]);
+        ASSERT_TRUE(all(lessThan(abs(bulk[i] - r), float3{1e-5f})));
+    }
+}
+
+TEST_F(ColorSpaceTest, LUT1D) {
+    ColorSpace sRGB = ColorSpace::sRGB();
+
+    auto lut = ColorSpace::createLUT1D(1024, sRGB.getEOTF());
+    EXPECT_TRUE(lut != nullptr);
+
+    for (float v = 0.0f; v <= 1.0f; v += 1e-3f) {
+        ASSERT_NEAR(sRGB.getEOTF()(v), ColorSpace::lookupLUT1D(lut.get(), 1024, v), 1e-4f);
+    }
+}
+
 TEST_F(ColorSpaceTest, LUT) {
     auto lut = ColorSpace::createLUT(17, ColorSpace::sRGB(), ColorSpace::AdobeRGB());
     EXPECT_TRUE(lut != nullptr);
@@ -0,0 +1,331 @@
+/*
+ * Copyright 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "UiBenchmark"
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include <memory>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include <cutils/native_handle.h>
+#include <ui/ColorSpace.h>
+#include <ui/Fence.h>
+#include <ui/GraphicBuffer.h>
+#include <ui/Rect.h>
+#include <ui/Region.h>
+
+namespace android {
+namespace {
+
+using ::benchmark::State;
+
+/* Region boolean operations */
+
+// Build a region of count disjoint rects laid out on a grid with gaps, so
+// the region keeps count rects rather than coalescing into one.
+Region makeGridRegion(size_t count, int offset) {
+    Region region;
+    const size_t perRow = 16;
+    for (size_t i = 0; i < count; i++) {
+        int x = static_cast<int>(i % perRow) * 20 + offset;
+        int y = static_cast<int>(i / perRow) * 20 + offset;
+        region.orSelf(Rect(x, y, x + 10, y + 10));
+    }
+    return region;
+}
+
+// The two operand shapes overlap but do not coincide, so every span has to
+// be walked and the result has a different rect count than either input.
+void BM_RegionMerge(State& state) {
+    const size_t rects = static_cast<size_t>(state.range(0));
+    const Region lhs = makeGridRegion(rects, 0);
+    const Region rhs = makeGridRegion(rects, 5);
+    while (state.KeepRunning()) {
+        Region result = lhs.merge(rhs);
+        ::benchmark::DoNotOptimize(result.getArray());
+    }
+}
+BENCHMARK(BM_RegionMerge)->ArgName("rects")->Arg(1)->Arg(4)->Arg(16)->Arg(64)->Arg(256);
+
+void BM_RegionIntersect(State& state) {
+    const size_t rects = static_cast<size_t>(state.range(0));
+    const Region lhs = makeGridRegion(rects, 0);
+    const Region rhs = makeGridRegion(rects, 5);
+    while (state.KeepRunning()) {
+        Region result = lhs.intersect(rhs);
+        ::benchmark::DoNotOptimize(result.getArray());
+    }
+}
+BENCHMARK(BM_RegionIntersect)->ArgName("rects")->Arg(1)->Arg(4)->Arg(16)->Arg(64)->Arg(256);
+
+void BM_RegionSubtract(State& state) {
+    const size_t rects = static_cast<size_t>(state.range(0));
+    const Region lhs = makeGridRegion(rects, 0);
+    const Region rhs = makeGridRegion(rects, 5);
+    while (state.KeepRunning()) {
+        Region result = lhs.subtract(rhs);
+        ::benchmark::DoNotOptimize(result.getArray());
+    }
+}
+BENCHMARK(BM_RegionSubtract)->ArgName("rects")->Arg(1)->Arg(4)->Arg(16)->Arg(64)->Arg(256);
+
+/* ColorSpace bulk conversions */
+
+void BM_ColorSpaceToLinearBulk(State& state) {
+    const size_t pixels = static_cast<size_t>(state.range(0));
+    const ColorSpace sRGB = ColorSpace::sRGB();
+    std::vector<float3> buffer(pixels);
+    for (size_t i = 0; i < pixels; i++) {
+        float v = static_cast<float>(i) / pixels;
+        buffer[i] = float3{v, 1.0f - v, 0.5f};
+    }
+    while (state.KeepRunning()) {
+        sRGB.toLinear(buffer.data(), buffer.size());
+        ::benchmark::DoNotOptimize(buffer.data());
+    }
+    state.SetItemsProcessed(state.iterations() * pixels);
+}
+BENCHMARK(BM_ColorSpaceToLinearBulk)->ArgName("pixels")->Arg(64)->Arg(1024)->Arg(65536);
+
+void BM_ColorSpaceConnectorTransform(State& state) {
+    const size_t pixels = static_cast<size_t>(state.range(0));
+    const ColorSpaceConnector connector(ColorSpace::sRGB(), ColorSpace::DisplayP3());
+    std::vector<float3> buffer(pixels);
+    for (size_t i = 0; i < pixels; i++) {
+        float v = static_cast<float>(i) / pixels;
+        buffer[i] = float3{v, 1.0f - v, 0.5f};
+    }
+    while (state.KeepRunning()) {
+        for (size_t i = 0; i < pixels; i++) {
+            buffer[i] = connector.transform(buffer[i]);
+        }
+        ::benchmark::DoNotOptimize(buffer.data());
+    }
+    state.SetItemsProcessed(state.iterations() * pixels);
+}
+BENCHMARK(BM_ColorSpaceConnectorTransform)->ArgName("pixels")->Arg(64)->Arg(1024)->Arg(65536);
+
+/* Fence merge and wait */
+
+// Minimal sw_sync interface, matching the kernel's debugfs test driver.
+// There is no userspace library for it in this tree, and it only exists on
+// debug-friendly kernels, so the fence benchmarks that need real sync fds
+// skip themselves when the timeline cannot be opened.
+struct sw_sync_create_fence_data {
+    __u32 value;
+    char name[32];
+    __s32 fence;
+};
+
+#define SW_SYNC_IOC_MAGIC 'W'
+#define SW_SYNC_IOC_CREATE_FENCE _IOWR(SW_SYNC_IOC_MAGIC, 0, struct sw_sync_create_fence_data)
+#define SW_SYNC_IOC_INC _IOW(SW_SYNC_IOC_MAGIC, 1, __u32)
+
+int openSwSyncTimeline() {
+    int fd = open("/sys/kernel/debug/sync/sw_sync", O_RDWR);
+    if (fd < 0) {
+        fd = open("/dev/sw_sync", O_RDWR);
+    }
+    return fd;
+}
+
+int createSwSyncFence(int timelineFd, unsigned value) {
+    struct sw_sync_create_fence_data data;
+    memset(&data, 0, sizeof(data));
+    data.value = value;
+    strncpy(data.name, "ui_benchmark", sizeof(data.name) - 1);
+    if (ioctl(timelineFd, SW_SYNC_IOC_CREATE_FENCE, &data) < 0) {
+        return -1;
+    }
+    return data.fence;
+}
+
+// The common SurfaceFlinger case: merging when one or both fences are
+// NO_FENCE takes a shortcut that should never hit the kernel.
+void BM_FenceMergeNoFence(State& state) {
+    while (state.KeepRunning()) {
+        sp<Fence> merged = Fence::merge("benchmark", Fence::NO_FENCE, Fence::NO_FENCE);
+        ::benchmark::DoNotOptimize(merged.get());
+    }
+}
+BENCHMARK(BM_FenceMergeNoFence);
+
+// One sync_merge syscall plus an fd close per iteration.
+void BM_FenceMergeReal(State& state) {
+    int timelineFd = openSwSyncTimeline();
+    if (timelineFd < 0) {
+        state.SkipWithError("sw_sync not available");
+        return;
+    }
+    sp<Fence> f1 = new Fence(createSwSyncFence(timelineFd, 1));
+    sp<Fence> f2 = new Fence(createSwSyncFence(timelineFd, 2));
+    if (!f1->isValid() || !f2->isValid()) {
+        state.SkipWithError("failed to create sw_sync fences");
+        close(timelineFd);
+        return;
+    }
+    while (state.KeepRunning()) {
+        sp<Fence> merged = Fence::merge("benchmark", f1, f2);
+        ::benchmark::DoNotOptimize(merged.get());
+    }
+    close(timelineFd);
+}
+BENCHMARK(BM_FenceMergeReal);
+
+// Waiting on an already-signaled fence still costs a poll on the sync fd;
+// this is the floor for every doFenceWait in the compositor.
+void BM_FenceWaitSignaled(State& state) {
+    int timelineFd = openSwSyncTimeline();
+    if (timelineFd < 0) {
+        state.SkipWithError("sw_sync not available");
+        return;
+    }
+    sp<Fence> fence = new Fence(createSwSyncFence(timelineFd, 1));
+    __u32 one = 1;
+    if (!fence->isValid() || ioctl(timelineFd, SW_SYNC_IOC_INC, &one) < 0) {
+        state.SkipWithError("failed to signal sw_sync fence");
+        close(timelineFd);
+        return;
+    }
+    while (state.KeepRunning()) {
+        status_t result = fence->wait(0);
+        ::benchmark::DoNotOptimize(result);
+    }
+    close(timelineFd);
+}
+BENCHMARK(BM_FenceWaitSignaled);
+
+/* GraphicBuffer flatten/unflatten */
+
+constexpr uint32_t kBufferWidth = 64;
+constexpr uint32_t kBufferHeight = 64;
+constexpr uint32_t kBufferFormat = HAL_PIXEL_FORMAT_RGBA_8888;
+constexpr uint32_t kBufferLayerCount = 1;
+constexpr uint64_t kBufferUsage =
+        GraphicBuffer::USAGE_SW_READ_OFTEN | GraphicBuffer::USAGE_SW_WRITE_OFTEN;
+
+// Flatten cost scales with the handle's fd and int counts, which are
+// gralloc's choice for allocated buffers; wrapping a synthetic handle lets
+// the fd count vary deterministically. WRAP_HANDLE leaves ownership with us
+// and skips the mapper, so no gralloc is needed.
+void BM_GraphicBufferFlatten(State& state) {
+    const int numFds = static_cast<int>(state.range(0));
+    native_handle_t* handle = native_handle_create(numFds, 4);
+    if (handle == nullptr) {
+        state.SkipWithError("failed to create handle");
+        return;
+    }
+    for (int i = 0; i < numFds; i++) {
+        handle->data[i] = open("/dev/null", O_RDONLY);
+    }
+    for (int i = 0; i < 4; i++) {
+        handle->data[numFds + i] = i;
+    }
+
+    {
+        sp<GraphicBuffer> buffer = new GraphicBuffer(handle, GraphicBuffer::WRAP_HANDLE,
+                kBufferWidth, kBufferHeight, kBufferFormat, kBufferLayerCount, kBufferUsage,
+                kBufferWidth);
+
+        std::vector<uint8_t> flattened(buffer->getFlattenedSize());
+        std::vector<int> fds(buffer->getFdCount());
+
+        while (state.KeepRunning()) {
+            void* flatPtr = flattened.data();
+            size_t flatSize = flattened.size();
+            int* fdPtr = fds.data();
+            size_t fdCount = fds.size();
+            status_t result = buffer->flatten(flatPtr, flatSize, fdPtr, fdCount);
+            ::benchmark::DoNotOptimize(result);
+        }
+    }
+
+    native_handle_close(handle);
+    native_handle_delete(handle);
+}
+BENCHMARK(BM_GraphicBufferFlatten)->ArgName("fds")->Arg(1)->Arg(2)->Arg(4)->Arg(8);
+
+// Unflatten has to import the handle through the mapper, so this needs a
+// real allocated buffer and runs only where gralloc is reachable.
+void BM_GraphicBufferUnflatten(State& state) {
+    sp<GraphicBuffer> buffer = new GraphicBuffer(kBufferWidth, kBufferHeight, kBufferFormat,
+            kBufferLayerCount, kBufferUsage);
+    if (buffer->initCheck() != NO_ERROR) {
+        state.SkipWithError("failed to allocate buffer");
+        return;
+    }
+
+    std::vector<uint8_t> flattened(buffer->getFlattenedSize());
+    std::vector<int> fds(buffer->getFdCount());
+    void* flatPtr = flattened.data();
+    size_t flatSize = flattened.size();
+    int* fdPtr = fds.data();
+    size_t fdCount = fds.size();
+    if (buffer->flatten(flatPtr, flatSize, fdPtr, fdCount) != NO_ERROR) {
+        state.SkipWithError("failed to flatten buffer");
+        return;
+    }
+
+    while (state.KeepRunning()) {
+        sp<GraphicBuffer> incoming = new GraphicBuffer();
+        void const* constPtr = flattened.data();
+        size_t constSize = flattened.size();
+        int const* constFds = fds.data();
+        size_t constFdCount = fds.size();
+        status_t result = incoming->unflatten(constPtr, constSize, constFds, constFdCount);
+        if (result != NO_ERROR) {
+            state.SkipWithError("unflatten failed");
+            return;
+        }
+    }
+}
+BENCHMARK(BM_GraphicBufferUnflatten);
+
+/* GraphicBufferMapper lock/unlock */
+
+void BM_GraphicBufferLockUnlock(State& state) {
+    sp<GraphicBuffer> buffer = new GraphicBuffer(kBufferWidth, kBufferHeight, kBufferFormat,
+            kBufferLayerCount, kBufferUsage);
+    if (buffer->initCheck() != NO_ERROR) {
+        state.SkipWithError("failed to allocate buffer");
+        return;
+    }
+
+    while (state.KeepRunning()) {
+        void* vaddr = nullptr;
+        if (buffer->lock(GraphicBuffer::USAGE_SW_WRITE_OFTEN, &vaddr) != NO_ERROR) {
+            state.SkipWithError("lock failed");
+            return;
+        }
+        ::benchmark::DoNotOptimize(vaddr);
+        if (buffer->unlock() != NO_ERROR) {
+            state.SkipWithError("unlock failed");
+            return;
+        }
+    }
+}
+BENCHMARK(BM_GraphicBufferLockUnlock);
+
+} // namespace
+} // namespace android
+
+BENCHMARK_MAIN();
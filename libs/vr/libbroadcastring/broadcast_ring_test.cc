@@ -1,8 +1,10 @@
 #include "libbroadcastring/broadcast_ring.h"
 
 #include <stdlib.h>
+#include <chrono>  // NOLINT
 #include <memory>
 #include <thread>  // NOLINT
+#include <vector>
 #include <sys/mman.h>
 
 #include <gtest/gtest.h>
@@ -61,7 +63,7 @@ FakeMmap CreateRing(Ring* ring, uint32_t count) {
 
 template <typename RecordType, bool StaticSize = false,
           uint32_t StaticCount = 0, uint32_t MaxReserved = 1,
-          uint32_t MinAvailable = 0>
+          uint32_t MinAvailable = 0, bool FutexWake = false>
 struct Traits {
   using Record = RecordType;
   static constexpr bool kUseStaticRecordSize = StaticSize;
@@ -69,12 +71,14 @@ struct Traits {
   static constexpr uint32_t kMaxReservedRecords = MaxReserved;
   static constexpr uint32_t kMinAvailableRecords = MinAvailable;
   static constexpr uint32_t kMinRecordCount = MaxReserved + MinAvailable;
+  static constexpr bool kFutexWakeOnPublish = FutexWake;
 };
 
 template <typename Record, bool StaticSize = false, uint32_t MaxReserved = 1,
-          uint32_t MinAvailable = 7>
+          uint32_t MinAvailable = 7, bool FutexWake = false>
 struct TraitsDynamic
-    : public Traits<Record, StaticSize, 0, MaxReserved, MinAvailable> {
+    : public Traits<Record, StaticSize, 0, MaxReserved, MinAvailable,
+                    FutexWake> {
   using Ring = BroadcastRing<Record, TraitsDynamic>;
   static uint32_t MinCount() { return MaxReserved + MinAvailable; }
 };
@@ -95,6 +99,7 @@ using Dynamic_16_NxM_1plus0 = TraitsDynamic<Sized<16>, false, 1, 0>;
 using Dynamic_16_NxM_1plus1 = TraitsDynamic<Sized<16>, false, 1, 1>;
 using Dynamic_16_NxM_5plus11 = TraitsDynamic<Sized<16>, false, 5, 11>;
 using Dynamic_256_NxM_1plus0 = TraitsDynamic<Sized<256>, false, 1, 0>;
+using Dynamic_32_NxM_Wake = TraitsDynamic<Sized<32>, false, 1, 7, true>;
 
 using Static_8_8x1 = TraitsStatic<Sized<8>, 1>;
 using Static_8_8x16 = TraitsStatic<Sized<8>, 16>;
@@ -111,6 +116,7 @@ using TraitsList = ::testing::Types<Dynamic_8_NxM,           //
                                     Dynamic_16_NxM_1plus1,   //
                                     Dynamic_16_NxM_5plus11,  //
                                     Dynamic_256_NxM_1plus0,  //
+                                    Dynamic_32_NxM_Wake,     //
                                     Static_8_8x1,            //
                                     Static_8_8x16,           //
                                     Static_16_16x8,          //
@@ -286,6 +292,50 @@ TYPED_TEST(BroadcastRingTest, FillTwice) {
   }
 }
 
+TYPED_TEST(BroadcastRingTest, GetBatch) {
+  using Record = typename TypeParam::Record;
+  using Ring = typename TypeParam::Ring;
+  Ring ring;
+  auto mmap = CreateRing(&ring, Ring::Traits::MinCount());
+  const uint32_t next_sequence_at_start = ring.GetNextSequence();
+  std::vector<Record> records(ring.record_count() + 1);
+  {
+    uint32_t sequence = next_sequence_at_start;
+    EXPECT_EQ(0U, ring.GetBatch(&sequence, records.data(), records.size()));
+    EXPECT_EQ(next_sequence_at_start, sequence);
+  }
+  for (uint32_t i = 0; i < ring.record_count(); ++i)
+    ring.Put(Record(FillChar(i)));
+  {
+    // All available records are returned, oldest first.
+    uint32_t sequence = next_sequence_at_start;
+    EXPECT_EQ(ring.record_count(),
+              ring.GetBatch(&sequence, records.data(), records.size()));
+    EXPECT_EQ(ring.GetOldestSequence(), sequence);
+    for (uint32_t i = 0; i < ring.record_count(); ++i)
+      EXPECT_EQ(Record(FillChar(i)), records[i]);
+  }
+  {
+    // A batch smaller than what is available returns the newest records.
+    uint32_t sequence = next_sequence_at_start;
+    Record record;
+    EXPECT_EQ(1U, ring.GetBatch(&sequence, &record, 1));
+    EXPECT_EQ(ring.GetNewestSequence(), sequence);
+    EXPECT_EQ(Record(FillChar(ring.record_count() - 1)), record);
+  }
+  {
+    // A zero sized batch never returns records.
+    uint32_t sequence = next_sequence_at_start;
+    EXPECT_EQ(0U, ring.GetBatch(&sequence, records.data(), 0));
+    EXPECT_EQ(next_sequence_at_start, sequence);
+  }
+  {
+    // The sequence after the newest record yields an empty batch.
+    uint32_t sequence = ring.GetNewestSequence() + 1;
+    EXPECT_EQ(0U, ring.GetBatch(&sequence, records.data(), records.size()));
+  }
+}
+
 TYPED_TEST(BroadcastRingTest, Import) {
   using Record = typename TypeParam::Record;
   using Ring = typename TypeParam::Ring;
@@ -862,5 +912,66 @@ TEST(BroadcastRingTest, ThreadedOverwriteTortureLarge) {
   ThreadedOverwriteTorture<Dynamic_256_NxM_1plus0::Ring>();
 }
 
+TEST(BroadcastRingTest, WaitTimeout) {
+  using Ring = Dynamic_32_NxM::Ring;
+  using Record = Ring::Record;
+  Ring ring;
+  auto mmap = CreateRing(&ring, Ring::Traits::MinCount());
+
+  constexpr int64_t kShortTimeoutUs = 1000;
+  EXPECT_FALSE(ring.Wait(ring.GetNextSequence(), 0));
+  EXPECT_FALSE(ring.Wait(ring.GetNextSequence(), kShortTimeoutUs));
+
+  ring.Put(Record(0x2d));
+  EXPECT_TRUE(ring.Wait(ring.GetNewestSequence(), 0));
+  EXPECT_TRUE(ring.Wait(ring.GetNewestSequence(), kShortTimeoutUs));
+  EXPECT_FALSE(ring.Wait(ring.GetNextSequence(), kShortTimeoutUs));
+}
+
+template <typename Ring>
+void ThreadedWaitTest() {
+  using Record = typename Ring::Record;
+  Ring out_ring;
+  auto out_mmap = CreateRing(&out_ring, Ring::Traits::MinCount());
+
+  constexpr uint32_t kRecordsToProcess = 100;
+  constexpr int64_t kWaitTimeoutUs = 10000000;  // Generous; avoids hangs.
+  void* in_base = out_mmap.mmap();
+  size_t in_size = out_mmap.size;
+  const uint32_t start_sequence = out_ring.GetNextSequence();
+  std::thread wait_task([in_base, in_size, start_sequence]() {
+    bool import_ok;
+    Ring in_ring;
+    std::tie(in_ring, import_ok) = Ring::Import(in_base, in_size);
+    ASSERT_TRUE(import_ok);
+
+    uint32_t sequence = start_sequence;
+    while (sequence - start_sequence < kRecordsToProcess) {
+      ASSERT_TRUE(in_ring.Wait(sequence, kWaitTimeoutUs));
+      Record record;
+      while (in_ring.Get(&sequence, &record)) {
+        // Get() may skip forward if the writer lapped us; the record contents
+        // always identify the sequence that was actually read.
+        EXPECT_EQ(Record(FillChar(sequence - start_sequence)), record);
+        sequence++;
+      }
+    }
+  });
+
+  for (uint32_t i = 0; i < kRecordsToProcess; ++i) {
+    out_ring.Put(Record(FillChar(i)));
+    std::this_thread::sleep_for(std::chrono::microseconds(500));
+  }
+  wait_task.join();
+}
+
+TEST(BroadcastRingTest, ThreadedWaitWithWake) {
+  ThreadedWaitTest<Dynamic_32_NxM_Wake::Ring>();
+}
+
+TEST(BroadcastRingTest, ThreadedWaitWakeless) {
+  ThreadedWaitTest<Dynamic_32_NxM::Ring>();
+}
+
 } // namespace dvr
 } // namespace android
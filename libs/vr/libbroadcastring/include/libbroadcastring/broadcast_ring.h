@@ -2,8 +2,12 @@
 #define ANDROID_DVR_BROADCAST_RING_H_
 
 #include <inttypes.h>
+#include <linux/futex.h>
 #include <stddef.h>
 #include <stdio.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
 #include <atomic>
 #include <limits>
 #include <tuple>
@@ -31,6 +35,11 @@ struct DefaultRingTraits {
 
   // Set this to the min number of records that must be readable.
   static constexpr uint32_t kMinAvailableRecords = 1;
+
+  // Set this to true to make Put() wake readers blocked in Wait(). Leave it
+  // false for rings whose readers only poll; it adds a futex syscall to every
+  // put.
+  static constexpr bool kFutexWakeOnPublish = false;
 };
 
 // Nonblocking ring suitable for concurrent single-writer, multi-reader access.
@@ -369,6 +378,122 @@ class BroadcastRing {
     return Get(sequence, record);
   }
 
+  // Copies all available records with sequence at least |*sequence| to
+  // |records|, oldest first, up to a limit of |max_records|.
+  //
+  // If more than |max_records| records are available, the newest ones are
+  // returned and the skipped records are lost to this reader, consistent with
+  // the lossy nature of the ring.
+  //
+  // Returns the number of records copied; zero means no recent enough record
+  // was available.
+  //
+  // Updates |*sequence| with the sequence number of the first record returned.
+  // To get the record that follows the last one returned, add the returned
+  // count to this number.
+  //
+  // Synchronizes with the writer exactly as Get() does; if any part of the
+  // batch was overwritten concurrently the whole batch is re-read, so the
+  // returned records are always consecutive and individually consistent.
+  uint32_t GetBatch(uint32_t* sequence /*inout*/, Record* records /*out*/,
+                    uint32_t max_records) const {
+    if (max_records == 0) return 0;
+    for (;;) {
+      uint32_t tail = std::atomic_load_explicit(&header_mmap()->tail,
+                                                std::memory_order_acquire);
+      uint32_t head = std::atomic_load_explicit(&header_mmap()->head,
+                                                std::memory_order_relaxed);
+
+      if (tail - head > record_count())
+        continue;  // Concurrent modification; re-try.
+
+      if (*sequence - head > tail - head)
+        *sequence = head;  // Out of window, skip forward to first available.
+
+      if (*sequence == tail) return 0;  // No new records available.
+
+      uint32_t count = tail - *sequence;
+      if (count > max_records) {
+        *sequence = tail - max_records;
+        count = max_records;
+      }
+
+      for (uint32_t i = 0; i < count; ++i) {
+        RecordStorage* record_storage =
+            record_mmap_reader(SequenceToIndex(*sequence + i, record_count()));
+        GetRecordInternal(record_storage, &records[i]);
+      }
+
+      // NB: It is not sufficient to change this to a load-acquire of |head|.
+      std::atomic_thread_fence(std::memory_order_acquire);
+
+      uint32_t final_head = std::atomic_load_explicit(
+          &header_mmap()->head, std::memory_order_relaxed);
+
+      // The writer overwrites the oldest record first, so if the first record
+      // of the batch was not overwritten then neither was any later one.
+      if (final_head - head > *sequence - head)
+        continue;  // Concurrent modification; re-try.
+
+      return count;
+    }
+  }
+
+  // Waits for the record with sequence number |sequence| to be published.
+  //
+  // Pass the value of GetNextSequence() to wait for the next record; passing
+  // a sequence number that is already available returns true immediately.
+  //
+  // Readers first spin briefly in case the writer is just about to publish,
+  // then block on the futex word underlying |tail|. Writers wake waiters only
+  // if Traits::kFutexWakeOnPublish is set; for rings without it the futex
+  // wait doubles as a bounded sleep and the ring is re-checked every
+  // kWakelessWaitSliceUs.
+  //
+  // The spin window adapts per ring instance: it grows when spinning catches
+  // a record and shrinks when we end up in the kernel, so a reader of a
+  // high-rate writer avoids syscalls without burning a core when the writer
+  // goes idle.
+  //
+  // A |timeout_us| of zero polls without blocking; a negative value waits
+  // indefinitely. Returns true once the record is available and false on
+  // timeout.
+  bool Wait(uint32_t sequence, int64_t timeout_us) {
+    const int64_t start_us = GetMonotonicTimeUs();
+    const int64_t spin_deadline_us = start_us + spin_limit_us_;
+    bool spun = false;
+    for (;;) {
+      uint32_t tail = std::atomic_load_explicit(&header_mmap()->tail,
+                                                std::memory_order_acquire);
+      if (tail != sequence) {
+        if (spun && spin_limit_us_ < kMaxSpinUs) spin_limit_us_ *= 2;
+        return true;
+      }
+      spun = true;
+      int64_t now_us = GetMonotonicTimeUs();
+      if (now_us >= spin_deadline_us ||
+          (timeout_us >= 0 && now_us - start_us >= timeout_us))
+        break;
+    }
+    if (spin_limit_us_ > kMinSpinUs) spin_limit_us_ /= 2;
+    if (timeout_us == 0) return false;
+    for (;;) {
+      int64_t wait_us;
+      if (timeout_us < 0) {
+        wait_us = Traits::kFutexWakeOnPublish ? -1 : kWakelessWaitSliceUs;
+      } else {
+        wait_us = timeout_us - (GetMonotonicTimeUs() - start_us);
+        if (wait_us <= 0) return false;
+        if (!Traits::kFutexWakeOnPublish && wait_us > kWakelessWaitSliceUs)
+          wait_us = kWakelessWaitSliceUs;
+      }
+      FutexWait(&header_mmap()->tail, sequence, wait_us);
+      uint32_t tail = std::atomic_load_explicit(&header_mmap()->tail,
+                                                std::memory_order_acquire);
+      if (tail != sequence) return true;
+    }
+  }
+
   // Returns true if this instance has been created or imported.
   bool is_valid() const { return !!data_.mmap; }
 
@@ -412,6 +537,14 @@ class BroadcastRing {
   static_assert(kRecordAlignment % sizeof(StorageType) == 0,
                 "Bad record alignment");
 
+  // Bounds for the adaptive spin window in Wait().
+  static constexpr int64_t kMinSpinUs = 2;
+  static constexpr int64_t kMaxSpinUs = 64;
+
+  // How often Wait() re-checks the ring while blocked on a ring whose writer
+  // does not wake waiters.
+  static constexpr int64_t kWakelessWaitSliceUs = 250;
+
   struct RecordStorage {
     // This is accessed with relaxed atomics to prevent data races on the
     // contained data, which would be undefined behavior.
@@ -535,6 +668,34 @@ class BroadcastRing {
     return sequence & (record_count - 1);
   }
 
+  static int64_t GetMonotonicTimeUs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000LL + ts.tv_nsec / 1000LL;
+  }
+
+  // Blocks until |*word| != |expected|, a wakeup, a timeout or a spurious
+  // return. The mmap area is shared between processes, so the non-private
+  // futex forms are required. FUTEX_WAIT only reads the word and therefore
+  // works on read-only reader mappings.
+  static void FutexWait(std::atomic<uint32_t>* word, uint32_t expected,
+                        int64_t timeout_us) {
+    struct timespec timeout;
+    struct timespec* timeout_ptr = nullptr;
+    if (timeout_us >= 0) {
+      timeout.tv_sec = timeout_us / 1000000;
+      timeout.tv_nsec = (timeout_us % 1000000) * 1000;
+      timeout_ptr = &timeout;
+    }
+    syscall(__NR_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAIT, expected,
+            timeout_ptr, nullptr, 0);
+  }
+
+  static void FutexWakeAll(std::atomic<uint32_t>* word) {
+    syscall(__NR_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAKE,
+            std::numeric_limits<int>::max(), nullptr, nullptr, 0);
+  }
+
   // Computes readable & writable ranges from ring parameters.
   static Geometry CalculateGeometry(uint32_t record_count, uint32_t record_size,
                                     uint32_t head, uint32_t tail) {
@@ -594,6 +755,7 @@ class BroadcastRing {
     std::atomic_store_explicit(&header_mmap()->tail,
                                geometry.tail + publish_count,
                                std::memory_order_release);
+    if (Traits::kFutexWakeOnPublish) FutexWakeAll(&header_mmap()->tail);
   }
 
   // Helpers to compute addresses in mmap area.
@@ -684,6 +846,10 @@ class BroadcastRing {
                                 DataDynamicSize>::type;
 
   DataStaticOrDynamic data_;
+
+  // Reader-local adaptive spin window for Wait(); not part of the shared
+  // mmap state.
+  int64_t spin_limit_us_ = kMinSpinUs;
 };
 
 }  // namespace dvr
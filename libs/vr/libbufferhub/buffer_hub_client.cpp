@@ -407,7 +407,11 @@ int BufferConsumer::ReleaseAsync(const DvrNativeBufferMetadata* meta,
       SendImpulse(BufferHubRPC::ConsumerRelease::Opcode));
 }
 
-int BufferConsumer::Discard() { return Release(LocalHandle()); }
+int BufferConsumer::Discard() {
+  // Release through the shared memory fast path; a discard carries no fence or
+  // metadata, so there is nothing for bufferhubd to transfer.
+  return ReleaseAsync();
+}
 
 int BufferConsumer::SetIgnore(bool ignore) {
   return ReturnStatusOrError(
@@ -100,6 +100,24 @@ class BufferHubBuffer : public pdx::Client {
     }
   }
 
+  // Batched event fetch support; see ClientChannel::AppendPollFds().
+  size_t AppendPollFds(std::vector<pollfd>* pollfds) const {
+    if (auto* client_channel = GetChannel()) {
+      return client_channel->AppendPollFds(pollfds);
+    } else {
+      return 0;
+    }
+  }
+
+  pdx::Status<int> TranslatePollEvents(const pollfd* entries,
+                                       size_t count) const {
+    if (auto* client_channel = GetChannel()) {
+      return client_channel->TranslatePollEvents(entries, count);
+    } else {
+      return pdx::ErrorStatus(EINVAL);
+    }
+  }
+
   native_handle_t* native_handle() const {
     return const_cast<native_handle_t*>(buffer_.handle());
   }
@@ -6,6 +6,9 @@
 #include <sys/epoll.h>
 
 #include <array>
+#include <bitset>
+#include <chrono>
+#include <vector>
 
 #include <pdx/default_transport/client_channel.h>
 #include <pdx/default_transport/client_channel_factory.h>
@@ -149,6 +152,14 @@ bool BufferHubQueue::WaitForBuffers(int timeout) {
   ATRACE_NAME("BufferHubQueue::WaitForBuffers");
   std::array<epoll_event, kMaxEvents> events;
 
+  // When spin waiting is enabled and this call may block, poll the epoll set
+  // without blocking until the spin deadline passes, then fall back to a
+  // blocking wait for the remainder of |timeout|. This avoids scheduler
+  // wakeup latency when a buffer is released within the spin window.
+  const bool spin_wait = spin_wait_duration_us_ > 0 && timeout != 0;
+  const auto spin_deadline = std::chrono::steady_clock::now() +
+                             std::chrono::microseconds(spin_wait_duration_us_);
+
   // Loop at least once to check for hangups.
   do {
     ALOGD_IF(
@@ -156,11 +167,17 @@ bool BufferHubQueue::WaitForBuffers(int timeout) {
         "BufferHubQueue::WaitForBuffers: queue_id=%d count=%zu capacity=%zu",
         id(), count(), capacity());
 
+    const bool spinning = spin_wait && count() == 0 &&
+                          std::chrono::steady_clock::now() < spin_deadline;
+
     // If there is already a buffer then just check for hangup without waiting.
     const int ret = epoll_fd_.Wait(events.data(), events.size(),
-                                   count() == 0 ? timeout : 0);
+                                   count() == 0 && !spinning ? timeout : 0);
 
     if (ret == 0) {
+      if (spinning)
+        continue;
+
       ALOGI_IF(TRACE,
                "BufferHubQueue::WaitForBuffers: No events before timeout: "
                "queue_id=%d",
@@ -178,7 +195,15 @@ bool BufferHubQueue::WaitForBuffers(int timeout) {
 
     // A BufferQueue's epoll fd tracks N+1 events, where there are N events,
     // one for each buffer in the queue, and one extra event for the queue
-    // client itself.
+    // client itself. Collect the distinct buffer slots with pending events,
+    // coalescing multiple event sources of the same buffer, so that their
+    // states can be fetched in one batch below.
+    std::bitset<kMaxQueueCapacity> ready;
+    std::array<size_t, kMaxQueueCapacity> ready_slots;
+    std::array<int, kMaxQueueCapacity> slot_poll_events = {};
+    std::array<int, kMaxQueueCapacity> slot_event_fds;
+    size_t ready_slot_count = 0;
+
     for (int i = 0; i < num_events; i++) {
       int32_t event_fd;
       int32_t index;
@@ -194,8 +219,13 @@ bool BufferHubQueue::WaitForBuffers(int timeout) {
                i, event_fd, index);
 
       if (is_buffer_event_index(index)) {
-        HandleBufferEvent(static_cast<size_t>(index), event_fd,
-                          events[i].events);
+        const auto slot = static_cast<size_t>(index);
+        if (!ready[slot]) {
+          ready.set(slot);
+          ready_slots[ready_slot_count++] = slot;
+        }
+        slot_poll_events[slot] |= events[i].events;
+        slot_event_fds[slot] = event_fd;
       } else if (is_queue_event_index(index)) {
         HandleQueueEvent(events[i].events);
       } else {
@@ -205,6 +235,14 @@ bool BufferHubQueue::WaitForBuffers(int timeout) {
             event_fd, index);
       }
     }
+
+    if (ready_slot_count == 1) {
+      const size_t slot = ready_slots[0];
+      HandleBufferEvent(slot, slot_event_fds[slot], slot_poll_events[slot]);
+    } else if (ready_slot_count > 1) {
+      HandleBufferEvents(ready_slots.data(), ready_slot_count,
+                         slot_poll_events.data(), slot_event_fds.data());
+    }
   } while (count() == 0 && capacity() > 0 && !hung_up());
 
   return count() != 0;
@@ -231,17 +269,76 @@ Status<void> BufferHubQueue::HandleBufferEvent(size_t slot, int event_fd,
       "events=%d|",
       id(), buffers_[slot]->id(), slot, event_fd, poll_events, events);
 
+  return HandleBufferState(slot, events);
+}
+
+void BufferHubQueue::HandleBufferEvents(const size_t* slots, size_t slot_count,
+                                        const int* slot_poll_events,
+                                        const int* slot_event_fds) {
+  ATRACE_NAME("BufferHubQueue::HandleBufferEvents");
+
+  // Gather the pollfd entries of every ready buffer so that their event
+  // states are fetched with a single poll syscall instead of one
+  // GetEventMask() syscall per buffer.
+  std::vector<pollfd> pollfds;
+  std::array<size_t, kMaxQueueCapacity> entry_counts;
+  for (size_t i = 0; i < slot_count; i++) {
+    entry_counts[i] =
+        buffers_[slots[i]] ? buffers_[slots[i]]->AppendPollFds(&pollfds) : 0;
+  }
+
+  if (!pollfds.empty() &&
+      RETRY_EINTR(poll(pollfds.data(), pollfds.size(), 0)) < 0) {
+    ALOGW(
+        "BufferHubQueue::HandleBufferEvents: Failed to poll buffer states: %s",
+        strerror(errno));
+    // Fall back to per-buffer event handling below.
+    entry_counts.fill(0);
+  }
+
+  size_t offset = 0;
+  for (size_t i = 0; i < slot_count; i++) {
+    const size_t slot = slots[i];
+    const size_t entry_count = entry_counts[i];
+
+    if (entry_count == 0) {
+      // The transport does not support batched event fetch for this buffer;
+      // fetch its state individually.
+      HandleBufferEvent(slot, slot_event_fds[slot], slot_poll_events[slot]);
+      continue;
+    }
+
+    auto status =
+        buffers_[slot]->TranslatePollEvents(&pollfds[offset], entry_count);
+    offset += entry_count;
+    if (!status) {
+      HandleBufferEvent(slot, slot_event_fds[slot], slot_poll_events[slot]);
+      continue;
+    }
+
+    PDX_TRACE_FORMAT("buffer|queue_id=%d;buffer_id=%d;slot=%zu;events=%d|",
+                     id(), buffers_[slot]->id(), slot, status.get());
+    HandleBufferState(slot, status.get());
+  }
+}
+
+Status<void> BufferHubQueue::HandleBufferState(size_t slot, int events) {
+  if (!buffers_[slot]) {
+    ALOGW("BufferHubQueue::HandleBufferState: Invalid buffer slot: %zu", slot);
+    return ErrorStatus(ENOENT);
+  }
+
   if (events & EPOLLIN) {
     return Enqueue({buffers_[slot], slot, buffers_[slot]->GetQueueIndex()});
   } else if (events & EPOLLHUP) {
     ALOGW(
-        "BufferHubQueue::HandleBufferEvent: Received EPOLLHUP event: slot=%zu "
+        "BufferHubQueue::HandleBufferState: Received EPOLLHUP event: slot=%zu "
         "event_fd=%d buffer_id=%d",
         slot, buffers_[slot]->event_fd(), buffers_[slot]->id());
     return RemoveBuffer(slot);
   } else {
     ALOGW(
-        "BufferHubQueue::HandleBufferEvent: Unknown event, slot=%zu, epoll "
+        "BufferHubQueue::HandleBufferState: Unknown event, slot=%zu, epoll "
         "events=%d",
         slot, events);
   }
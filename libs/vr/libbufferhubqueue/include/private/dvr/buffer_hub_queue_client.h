@@ -22,6 +22,7 @@
 #pragma clang diagnostic pop
 #endif
 
+#include <functional>
 #include <memory>
 #include <queue>
 #include <vector>
@@ -120,6 +121,16 @@ class BufferHubQueue : public pdx::Client {
   void SetBufferAvailableCallback(BufferAvailableCallback callback);
   void SetBufferRemovedCallback(BufferRemovedCallback callback);
 
+  // Sets how long WaitForBuffers() spins on the epoll set before blocking.
+  // A sleeping dequeue thread pays scheduler wakeup latency on top of the
+  // buffer release itself; latency-critical consumers, such as compositor
+  // threads working against a vsync deadline, can use a short spin window to
+  // avoid it. Spinning burns CPU for up to |duration_us| per wait, so this
+  // should remain disabled (0, the default) for ordinary clients.
+  void SetSpinWaitDuration(int64_t duration_us) {
+    spin_wait_duration_us_ = duration_us;
+  }
+
   // The queue tracks at most this many buffers.
   static constexpr size_t kMaxQueueCapacity =
       android::BufferQueueDefs::NUM_BUFFER_SLOTS;
@@ -168,6 +179,19 @@ class BufferHubQueue : public pdx::Client {
                                       int poll_events);
   pdx::Status<void> HandleQueueEvent(int poll_events);
 
+  // Handles events for the |slot_count| buffer slots in |slots|, fetching
+  // their pending event state with a single batched poll when the transport
+  // supports it and falling back to HandleBufferEvent() per slot otherwise.
+  // |slot_poll_events| and |slot_event_fds| hold the coalesced epoll events
+  // and the last signaled event fd for each slot, indexed by slot.
+  void HandleBufferEvents(const size_t* slots, size_t slot_count,
+                          const int* slot_poll_events,
+                          const int* slot_event_fds);
+
+  // Handles the resolved event mask of a single buffer slot: enqueues the
+  // buffer on EPOLLIN and removes it on EPOLLHUP.
+  pdx::Status<void> HandleBufferState(size_t slot, int events);
+
   // Entry in the priority queue of available buffers that stores related
   // per-buffer data.
   struct Entry {
@@ -268,6 +292,10 @@ class BufferHubQueue : public pdx::Client {
   // the other end hung up.
   bool hung_up_{false};
 
+  // How long WaitForBuffers() spins before blocking in epoll, in
+  // microseconds. Disabled when 0. See SetSpinWaitDuration().
+  int64_t spin_wait_duration_us_{0};
+
   // Global id for the queue that is consistent across processes.
   int id_{-1};
 
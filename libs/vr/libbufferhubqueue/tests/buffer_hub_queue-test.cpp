@@ -181,6 +181,47 @@ TEST_F(BufferHubQueueTest, TestProducerConsumer) {
   }
 }
 
+TEST_F(BufferHubQueueTest, TestBatchedDequeue) {
+  const size_t kBufferCount = 8;
+  size_t slot;
+  DvrNativeBufferMetadata mi, mo;
+  LocalHandle fence;
+
+  ASSERT_TRUE(CreateQueues(config_builder_.Build(), UsagePolicy{}));
+
+  for (size_t i = 0; i < kBufferCount; i++)
+    AllocateBuffer();
+
+  // Dequeue and post all the buffers from the producer before the consumer
+  // looks at any of them, so that the consumer observes all the buffer events
+  // in a single batch.
+  for (size_t i = 0; i < kBufferCount; i++) {
+    auto producer_status =
+        producer_queue_->Dequeue(kTimeoutMs, &slot, &mo, &fence);
+    ASSERT_TRUE(producer_status.ok());
+    auto producer = producer_status.take();
+    ASSERT_NE(nullptr, producer);
+
+    mi.index = static_cast<int64_t>(i);
+    ASSERT_EQ(producer->PostAsync(&mi, LocalHandle()), 0);
+  }
+
+  // Enable a short spin window to cover the spin-then-wait path as well.
+  consumer_queue_->SetSpinWaitDuration(100);
+
+  // The consumer should drain all the posted buffers in order.
+  for (size_t i = 0; i < kBufferCount; i++) {
+    auto consumer_status =
+        consumer_queue_->Dequeue(kTimeoutMs, &slot, &mo, &fence);
+    ASSERT_TRUE(consumer_status.ok());
+    auto consumer = consumer_status.take();
+    ASSERT_NE(nullptr, consumer);
+    EXPECT_EQ(mo.index, static_cast<int64_t>(i));
+
+    ASSERT_EQ(consumer->ReleaseAsync(&mi, LocalHandle()), 0);
+  }
+}
+
 TEST_F(BufferHubQueueTest, TestRemoveBuffer) {
   ASSERT_TRUE(CreateProducerQueue(config_builder_.Build(), UsagePolicy{}));
   DvrNativeBufferMetadata mo;
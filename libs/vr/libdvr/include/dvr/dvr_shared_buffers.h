@@ -29,7 +29,7 @@ static_assert(sizeof(DvrVsync) == 32, "Unexpected size for DvrVsync");
 static_assert(sizeof(DvrConfig) == 16, "Unexpected size for DvrConfig");
 
 // A helper class that provides compile time sized traits for the BroadcastRing.
-template <class DvrType, size_t StaticCount>
+template <class DvrType, size_t StaticCount, bool FutexWakeOnPublish = false>
 class DvrRingBufferTraits {
  public:
   using Record = DvrType;
@@ -37,10 +37,12 @@ class DvrRingBufferTraits {
   static constexpr uint32_t kStaticRecordCount = StaticCount;
   static constexpr int kMaxReservedRecords = 1;
   static constexpr int kMinAvailableRecords = 1;
+  static constexpr bool kFutexWakeOnPublish = FutexWakeOnPublish;
 };
 
-// Traits classes.
-using DvrPoseTraits = DvrRingBufferTraits<DvrPose, 0>;
+// Traits classes. The pose ring wakes waiters on publish so that pose
+// consumers can block in BroadcastRing::Wait() instead of polling.
+using DvrPoseTraits = DvrRingBufferTraits<DvrPose, 0, true>;
 using DvrVsyncTraits = DvrRingBufferTraits<DvrVsync, 2>;
 using DvrConfigTraits = DvrRingBufferTraits<DvrConfig, 2>;
 
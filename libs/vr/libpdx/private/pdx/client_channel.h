@@ -1,6 +1,8 @@
 #ifndef ANDROID_PDX_CLIENT_CHANNEL_H_
 #define ANDROID_PDX_CLIENT_CHANNEL_H_
 
+#include <poll.h>
+
 #include <vector>
 
 #include <pdx/channel_handle.h>
@@ -32,6 +34,22 @@ class ClientChannel {
   // fds are owned by the ClientChannel and must never be closed by the caller.
   virtual std::vector<EventSource> GetEventSources() const = 0;
 
+  // Appends the pollfd entries needed to compute this channel's pending event
+  // mask to |pollfds|, returning the number of entries appended. After polling
+  // the entries, TranslatePollEvents() converts their revents back into a
+  // channel event mask. Together these allow a caller that manages many
+  // channels to fetch the state of all of them with a single poll, instead of
+  // one GetEventMask() syscall per channel. Transports that do not support
+  // batched event fetch append nothing and return 0; callers must fall back
+  // to GetEventMask() for those channels.
+  virtual size_t AppendPollFds(std::vector<pollfd>* /*pollfds*/) const {
+    return 0;
+  }
+  virtual Status<int> TranslatePollEvents(const pollfd* /*entries*/,
+                                          size_t /*count*/) const {
+    return ErrorStatus(EOPNOTSUPP);
+  }
+
   virtual LocalChannelHandle& GetChannelHandle() = 0;
   virtual const LocalChannelHandle& GetChannelHandle() const = 0;
   virtual void* AllocateTransactionState() = 0;
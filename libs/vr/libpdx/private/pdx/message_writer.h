@@ -30,6 +30,18 @@ class MessageWriter {
   virtual void* GetNextWriteBufferSection(size_t size) = 0;
   virtual OutputResourceMapper* GetOutputResourceMapper() = 0;
 
+  // Offers the writer |size| bytes at |data| to transmit by reference instead
+  // of by copy. |buffer| is the current write position within the section
+  // returned by GetNextWriteBufferSection(). A writer that accepts records the
+  // span for scatter-gather transmission at this position in the stream,
+  // leaves |buffer| unmoved and returns true; the referenced memory must then
+  // remain valid until the payload has been sent. The default implementation
+  // declines, directing the caller to copy the bytes inline at |buffer|.
+  virtual bool WriteReference(const void* /*data*/, size_t /*size*/,
+                              void*& /*buffer*/) {
+    return false;
+  }
+
  protected:
   virtual ~MessageWriter() = default;
 };
@@ -1,6 +1,9 @@
 #ifndef ANDROID_PDX_RPC_PAYLOAD_H_
 #define ANDROID_PDX_RPC_PAYLOAD_H_
 
+#include <sys/uio.h>
+
+#include <array>
 #include <iterator>
 
 #include <pdx/client.h>
@@ -109,8 +112,11 @@ class ServicePayload : public MessagePayload<Slot>,
   Message& message_;
 };
 
-// Implements the payload interface for client-side RPCs. Handles gathering file
-// handles to be sent over IPC automatically.
+// Implements the payload interface for client-side RPCs. Handles gathering
+// file handles to be sent over IPC automatically, and records large POD
+// payload contents (BufferWrapper data) as scatter-gather references so they
+// are sent directly from caller memory instead of being copied through the
+// serialization buffer.
 template <typename Slot>
 class ClientPayload : public MessagePayload<Slot>,
                       public MessageWriter,
@@ -120,6 +126,14 @@ class ClientPayload : public MessagePayload<Slot>,
       MessageBuffer<ThreadLocalTypeSlot<ClientPayload<Slot>>, 1024u, int>;
   using BufferType = typename ContainerType::BufferType;
 
+  // Spans smaller than this are cheaper to copy inline than to describe as a
+  // separate iovec to the kernel.
+  static constexpr std::size_t kReferenceSizeThreshold = 128;
+
+  // Maximum number of out-of-line spans per message. Messages with more
+  // references than this copy the excess inline.
+  static constexpr std::size_t kMaxReferences = 8;
+
   ClientPayload(Transaction& transaction) : transaction_{transaction} {}
 
   // MessageWriter
@@ -132,6 +146,47 @@ class ClientPayload : public MessagePayload<Slot>,
     return &transaction_;
   }
 
+  bool WriteReference(const void* data, size_t size, void*& buffer) override {
+    if (size < kReferenceSizeThreshold || reference_count_ == kMaxReferences)
+      return false;
+    references_[reference_count_++] = {
+        static_cast<std::size_t>(PointerDistance(buffer, this->Data())), data,
+        size};
+    referenced_bytes_ += size;
+    return true;
+  }
+
+  // Builds the scatter-gather vector describing the serialized payload:
+  // segments of the local buffer interleaved, in stream order, with the
+  // referenced spans. The vectored send of the result produces the same byte
+  // stream as a fully inline encoding, so the receiving side is oblivious to
+  // which fields were sent by reference. Must be called after serialization
+  // is complete; the count is available from SendVectorCount() afterwards.
+  const iovec* SendVector() {
+    std::size_t count = 0;
+    std::size_t segment_start = 0;
+    for (std::size_t i = 0; i < reference_count_; i++) {
+      if (references_[i].offset > segment_start) {
+        send_vector_[count++] = {this->Data() + segment_start,
+                                 references_[i].offset - segment_start};
+      }
+      send_vector_[count++] = {const_cast<void*>(references_[i].data),
+                               references_[i].size};
+      segment_start = references_[i].offset;
+    }
+    // Referenced bytes leave unused space at the end of the buffer, since the
+    // write section is sized for a fully inline encoding.
+    const std::size_t written_end = this->Size() - referenced_bytes_;
+    if (written_end > segment_start) {
+      send_vector_[count++] = {this->Data() + segment_start,
+                               written_end - segment_start};
+    }
+    send_vector_count_ = count;
+    return send_vector_.data();
+  }
+
+  std::size_t SendVectorCount() const { return send_vector_count_; }
+
   // MessageReader
   BufferSection GetNextReadBufferSection() override {
     return {&*this->ConstCursor(), &*this->ConstEnd()};
@@ -147,7 +202,21 @@ class ClientPayload : public MessagePayload<Slot>,
   }
 
  private:
+  // Records where in the serialized stream a referenced span belongs.
+  // |offset| is the position within the local buffer at which the span's
+  // bytes would have been copied.
+  struct Reference {
+    std::size_t offset;
+    const void* data;
+    std::size_t size;
+  };
+
   Transaction& transaction_;
+  std::array<Reference, kMaxReferences> references_;
+  std::size_t reference_count_{0};
+  std::size_t referenced_bytes_{0};
+  std::array<iovec, 2 * kMaxReferences + 1> send_vector_;
+  std::size_t send_vector_count_{0};
 };
 
 }  // namespace rpc
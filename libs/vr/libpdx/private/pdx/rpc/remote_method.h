@@ -339,7 +339,9 @@ struct CheckArgumentTypes<Opcode, Return(Args...)> {
     rpc::ClientPayload<rpc::SendBuffer> payload{trans};
     rpc::MakeArgumentEncoder<Return(Args...)>(&payload).EncodeArguments(
         std::forward<Args>(args)...);
-    return trans.Send<R>(Opcode, payload.Data(), payload.Size(), nullptr, 0);
+    const iovec* send_vector = payload.SendVector();
+    return trans.SendVector<R>(Opcode, send_vector, payload.SendVectorCount(),
+                               nullptr, 0);
   }
 
   template <typename R>
@@ -355,9 +357,11 @@ struct CheckArgumentTypes<Opcode, Return(Args...)> {
     reply_payload.Resize(reply_payload.Capacity());
 
     Status<R> result;
-    auto status =
-        trans.Send<void>(Opcode, send_payload.Data(), send_payload.Size(),
-                         reply_payload.Data(), reply_payload.Size());
+    const iovec* send_vector = send_payload.SendVector();
+    const iovec reply_vector = {reply_payload.Data(), reply_payload.Size()};
+    auto status = trans.SendVector<void>(Opcode, send_vector,
+                                         send_payload.SendVectorCount(),
+                                         &reply_vector, 1);
     if (!status) {
       result.SetError(status.error());
     } else {
@@ -395,8 +399,10 @@ struct CheckArgumentTypes<Opcode, Return(Args...)> {
         .EncodeArguments(std::forward<Args>(args)...);
 
     Status<void> result;
-    auto status = trans.Send<R>(Opcode, send_payload.Data(),
-                                send_payload.Size(), nullptr, 0);
+    const iovec* send_vector = send_payload.SendVector();
+    auto status = trans.SendVector<R>(Opcode, send_vector,
+                                      send_payload.SendVectorCount(),
+                                      nullptr, 0);
     if (status) {
       *return_value = status.take();
       result.SetValue();
@@ -418,9 +424,11 @@ struct CheckArgumentTypes<Opcode, Return(Args...)> {
     rpc::ClientPayload<rpc::ReplyBuffer> reply_payload{trans};
     reply_payload.Resize(reply_payload.Capacity());
 
-    auto result =
-        trans.Send<void>(Opcode, send_payload.Data(), send_payload.Size(),
-                         reply_payload.Data(), reply_payload.Size());
+    const iovec* send_vector = send_payload.SendVector();
+    const iovec reply_vector = {reply_payload.Data(), reply_payload.Size()};
+    auto result = trans.SendVector<void>(Opcode, send_vector,
+                                         send_payload.SendVectorCount(),
+                                         &reply_vector, 1);
     if (result) {
       rpc::ErrorType error =
           rpc::MakeArgumentDecoder<Return(Args...)>(&reply_payload)
@@ -922,21 +922,28 @@ inline void SerializeObject(const ChannelHandle<Mode>& handle,
   SerializeRaw(value, buffer);
 }
 
-// Serializes the payload of BufferWrapper types.
+// Serializes the payload of BufferWrapper types. The contents are plain bytes
+// and are offered to the writer as a scatter-gather reference first, so that
+// writers with vectored transports send them directly from caller memory;
+// writers without such support copy them inline.
 template <typename T, typename Allocator>
 inline void SerializeObject(const BufferWrapper<std::vector<T, Allocator>>& b,
-                            MessageWriter* /*writer*/, void*& buffer) {
+                            MessageWriter* writer, void*& buffer) {
   const auto value_type_size =
       sizeof(typename BufferWrapper<std::vector<T, Allocator>>::value_type);
+  const std::size_t data_size = b.size() * value_type_size;
   SerializeType(b, buffer);
-  WriteRawData(buffer, b.data(), b.size() * value_type_size);
+  if (!writer->WriteReference(b.data(), data_size, buffer))
+    WriteRawData(buffer, b.data(), data_size);
 }
 template <typename T>
 inline void SerializeObject(const BufferWrapper<T*>& b,
-                            MessageWriter* /*writer*/, void*& buffer) {
+                            MessageWriter* writer, void*& buffer) {
   const auto value_type_size = sizeof(typename BufferWrapper<T*>::value_type);
+  const std::size_t data_size = b.size() * value_type_size;
   SerializeType(b, buffer);
-  WriteRawData(buffer, b.data(), b.size() * value_type_size);
+  if (!writer->WriteReference(b.data(), data_size, buffer))
+    WriteRawData(buffer, b.data(), data_size);
 }
 
 // Serializes the payload of string types.
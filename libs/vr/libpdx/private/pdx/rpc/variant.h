@@ -535,6 +535,18 @@ class Variant {
     }
   }
 
+  // Constructs an element of type T in place from the given arguments. The
+  // active element is always destroyed and replaced, even when it is already
+  // the target type. Unlike assignment this never materializes a temporary T,
+  // making it suitable for element types that are expensive to move or not
+  // movable at all. Returns a reference to the new element.
+  template <typename T, typename... Args>
+  EnableIfElement<T&, T> emplace(Args&&... args) {
+    Destruct();
+    Construct(DecayedTypeTag<T>{}, std::forward<Args>(args)...);
+    return *get<T>();
+  }
+
   // Invokes |Op| on the active element. If the Variant is empty |Op| is invoked
   // on EmptyVariant.
   template <typename Op>
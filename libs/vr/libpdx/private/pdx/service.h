@@ -46,6 +46,10 @@ enum {
   PDX_OPCODE(REPORT_SYSPROP_CHANGE, 0),
   // Request the service to dump state and return it in a text buffer.
   PDX_OPCODE(DUMP_STATE, 1),
+  // Request the transport endpoint to set up a shared-memory impulse ring
+  // for the sending channel. Handled by the endpoint, not the service;
+  // transports without such support reply with EOPNOTSUPP.
+  PDX_OPCODE(CHANNEL_OPEN_IMPULSE_RING, 2),
 };
 
 }  // namespace opcodes
@@ -615,6 +619,22 @@ class Service : public std::enable_shared_from_this<Service> {
    */
   Status<void> ReceiveAndDispatch();
 
+  /*
+   * Receives a message on this Service instance's endpoint without dispatching
+   * it. Blocking semantics are the same as for ReceiveAndDispatch(). This is
+   * useful for explicit thread pools that receive messages on one thread and
+   * hand them over (via move assignment) to dispatch threads.
+   */
+  Status<void> ReceiveMessage(Message* message);
+
+  /*
+   * Dispatches a message previously received with ReceiveMessage(). This may
+   * be called from a different thread than the receiver, as long as messages
+   * belonging to the same channel are dispatched in the order they were
+   * received.
+   */
+  Status<void> DispatchMessage(Message& message);
+
  private:
   friend class Message;
 
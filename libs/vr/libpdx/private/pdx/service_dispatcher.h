@@ -1,6 +1,8 @@
 #ifndef ANDROID_PDX_SERVICE_DISPATCHER_H_
 #define ANDROID_PDX_SERVICE_DISPATCHER_H_
 
+#include <atomic>
+#include <condition_variable>
 #include <memory>
 #include <mutex>
 #include <unordered_map>
@@ -68,6 +70,18 @@ class ServiceDispatcher {
    */
   int EnterDispatchLoop();
 
+  /*
+   * Same as above, but dispatches messages on a pool of |worker_count| worker
+   * threads owned by the dispatcher, with the calling thread acting as the
+   * receiver. Messages are assigned to workers by hashing their (service,
+   * channel) pair, so messages belonging to the same channel are always
+   * dispatched by the same worker in the order they were received, while
+   * independent channels dispatch in parallel. A |worker_count| of 0 is
+   * equivalent to EnterDispatchLoop(). The workers are joined before this
+   * method returns.
+   */
+  int EnterDispatchLoop(size_t worker_count);
+
   /*
    * Sets the canceled state of the dispatcher. When canceled is true, any
    * threads blocked waiting for messages will return. This method waits until
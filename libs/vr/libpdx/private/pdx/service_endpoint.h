@@ -133,6 +133,14 @@ class Endpoint {
   virtual void* AllocateMessageState() = 0;
   virtual void FreeMessageState(void* state) = 0;
 
+  // Sets up an optional transport-specific shared-memory impulse ring for the
+  // channel the CHANNEL_OPEN_IMPULSE_RING message arrived on. Transports
+  // without such support decline, which makes the client stay on the regular
+  // send path.
+  virtual Status<void> EnableChannelImpulseRing(Message* /*message*/) {
+    return ErrorStatus(EOPNOTSUPP);
+  }
+
   // Cancels the endpoint, unblocking any receiver threads waiting for a
   // message.
   virtual Status<void> Cancel() = 0;
@@ -48,12 +48,14 @@ class Status {
 
   // Assignment operators.
   Status& operator=(const Status& other) = default;
+  // Like the move constructor and take(), the moved-from value is left in its
+  // moved-from state rather than being reset with a temporary: the value of an
+  // empty Status is inaccessible, so the extra default construction and swap
+  // would only add churn on every moved message result.
   Status& operator=(Status&& other) {
     error_ = other.error_;
     value_ = std::move(other.value_);
     other.error_ = -1;
-    T empty;
-    std::swap(other.value_, empty);
     return *this;
   }
 
@@ -1094,6 +1094,72 @@ TEST(SerializationTest, ArrayWrapper) {
   result.Clear();
 }
 
+// Test writer that accepts scatter-gather references, recording each span and
+// the position within the buffer where its bytes belong in the stream.
+class ReferencePayload : public Payload {
+ public:
+  struct Span {
+    std::size_t offset;
+    const void* data;
+    std::size_t size;
+  };
+
+  bool WriteReference(const void* data, size_t size, void*& buffer) override {
+    spans_.push_back(
+        {static_cast<std::size_t>(PointerDistance(buffer, Data())), data,
+         size});
+    referenced_bytes_ += size;
+    return true;
+  }
+
+  // Reassembles the full byte stream from buffer segments and referenced
+  // spans, as a vectored send would transmit it.
+  std::vector<std::uint8_t> Reassemble() const {
+    std::vector<std::uint8_t> stream;
+    std::size_t segment_start = 0;
+    for (const Span& span : spans_) {
+      stream.insert(stream.end(), Data() + segment_start, Data() + span.offset);
+      const auto* bytes = static_cast<const std::uint8_t*>(span.data);
+      stream.insert(stream.end(), bytes, bytes + span.size);
+      segment_start = span.offset;
+    }
+    stream.insert(stream.end(), Data() + segment_start,
+                  Data() + Size() - referenced_bytes_);
+    return stream;
+  }
+
+  const std::vector<Span>& spans() const { return spans_; }
+
+ private:
+  std::vector<Span> spans_;
+  std::size_t referenced_bytes_{0};
+};
+
+TEST(SerializationTest, BufferWrapperReference) {
+  std::vector<std::uint8_t> data(512);
+  for (std::size_t i = 0; i < data.size(); i++)
+    data[i] = static_cast<std::uint8_t>(i);
+
+  // Encode inline through a writer that declines references.
+  Payload inline_result;
+  Serialize(WrapBuffer(data.data(), data.size()), &inline_result);
+
+  // Encode the same object through a writer that takes references: the
+  // contents must be offered by reference and left out of the buffer.
+  ReferencePayload reference_result;
+  Serialize(WrapBuffer(data.data(), data.size()), &reference_result);
+
+  ASSERT_EQ(1u, reference_result.spans().size());
+  EXPECT_EQ(data.data(), reference_result.spans()[0].data);
+  EXPECT_EQ(data.size(), reference_result.spans()[0].size);
+
+  // Reassembling buffer segments and referenced spans in stream order must
+  // reproduce the inline encoding exactly, so receivers cannot tell which
+  // fields were sent by reference.
+  std::vector<std::uint8_t> stream = reference_result.Reassemble();
+  EXPECT_EQ(inline_result, stream);
+}
+
 TEST(SerializationTest, pair) {
   Payload result;
   Payload expected;
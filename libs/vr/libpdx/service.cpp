@@ -623,6 +623,14 @@ Status<void> Service::HandleSystemMessage(Message& message) {
         return message.Reply(status);
     }
 
+    case opcodes::CHANNEL_OPEN_IMPULSE_RING: {
+      ALOGD("%s:CHANNEL_OPEN_IMPULSE_RING: pid=%d cid=%d\n", name_.c_str(),
+            info.pid, info.cid);
+      // Ring setup is a transport concern; the endpoint either adopts the
+      // shared ring offered by the client or declines with EOPNOTSUPP.
+      return message.Reply(endpoint_->EnableChannelImpulseRing(&message));
+    }
+
     default:
       return ErrorStatus{EOPNOTSUPP};
   }
@@ -639,6 +647,7 @@ Status<void> Service::DefaultHandleMessage(Message& message) {
     case opcodes::CHANNEL_CLOSE:
     case opcodes::REPORT_SYSPROP_CHANGE:
     case opcodes::DUMP_STATE:
+    case opcodes::CHANNEL_OPEN_IMPULSE_RING:
       return HandleSystemMessage(message);
 
     default:
@@ -650,16 +659,25 @@ void Service::OnSysPropChange() {}
 
 Status<void> Service::ReceiveAndDispatch() {
   Message message;
-  const auto status = endpoint_->MessageReceive(&message);
-  if (!status) {
-    ALOGE("Failed to receive message: %s\n", status.GetErrorMessage().c_str());
+  const auto status = ReceiveMessage(&message);
+  if (!status)
     return status;
-  }
 
+  return DispatchMessage(message);
+}
+
+Status<void> Service::ReceiveMessage(Message* message) {
+  const auto status = endpoint_->MessageReceive(message);
+  ALOGE_IF(!status, "Failed to receive message: %s\n",
+           status.GetErrorMessage().c_str());
+  return status;
+}
+
+Status<void> Service::DispatchMessage(Message& message) {
   std::shared_ptr<Service> service = message.GetService();
 
   if (!service) {
-    ALOGE("Service::ReceiveAndDispatch: service context is NULL!!!\n");
+    ALOGE("Service::DispatchMessage: service context is NULL!!!\n");
     // Don't block the sender indefinitely in this error case.
     endpoint_->MessageReply(&message, -EINVAL);
     return ErrorStatus{EINVAL};
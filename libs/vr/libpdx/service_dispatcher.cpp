@@ -5,6 +5,11 @@
 #include <sys/epoll.h>
 #include <sys/eventfd.h>
 
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <thread>
+
 #include <pdx/service.h>
 #include <pdx/service_endpoint.h>
 
@@ -13,6 +18,25 @@ static const int kMaxEventsPerLoop = 128;
 namespace android {
 namespace pdx {
 
+namespace {
+
+// Channel-affinity work queue for one dispatch worker. The receiver thread
+// pushes received messages and the worker pops and dispatches them, so
+// messages assigned to the same queue dispatch in receive order.
+struct WorkerQueue {
+  struct WorkItem {
+    Service* service;
+    Message message;
+  };
+
+  std::mutex mutex;
+  std::condition_variable condition;
+  std::deque<WorkItem> queue;
+  bool quit = false;
+};
+
+}  // anonymous namespace
+
 std::unique_ptr<ServiceDispatcher> ServiceDispatcher::Create() {
   std::unique_ptr<ServiceDispatcher> dispatcher{new ServiceDispatcher()};
   if (!dispatcher->epoll_fd_ || !dispatcher->event_fd_) {
@@ -172,6 +196,95 @@ int ServiceDispatcher::EnterDispatchLoop() {
   return 0;
 }
 
+int ServiceDispatcher::EnterDispatchLoop(size_t worker_count) {
+  if (worker_count == 0)
+    return EnterDispatchLoop();
+
+  int ret = ThreadEnter();
+  if (ret < 0)
+    return ret;
+
+  // One channel-affinity queue and worker per pool thread. Workers drain any
+  // messages left in their queue before exiting so that no received message
+  // is dropped on shutdown.
+  std::vector<std::unique_ptr<WorkerQueue>> queues;
+  std::vector<std::thread> workers;
+  for (size_t i = 0; i < worker_count; i++)
+    queues.push_back(std::make_unique<WorkerQueue>());
+  for (size_t i = 0; i < worker_count; i++) {
+    workers.emplace_back([queue = queues[i].get()] {
+      std::unique_lock<std::mutex> lock(queue->mutex);
+      while (true) {
+        queue->condition.wait(
+            lock, [queue] { return !queue->queue.empty() || queue->quit; });
+        if (queue->queue.empty())
+          break;
+
+        WorkerQueue::WorkItem item = std::move(queue->queue.front());
+        queue->queue.pop_front();
+
+        lock.unlock();
+        item.service->DispatchMessage(item.message);
+        lock.lock();
+      }
+    });
+  }
+
+  epoll_event events[kMaxEventsPerLoop];
+  int result = 0;
+  bool done = false;
+
+  while (!done && !IsCanceled()) {
+    int count = epoll_wait(epoll_fd_.Get(), events, kMaxEventsPerLoop, -1);
+    if (count < 0 && errno != EINTR) {
+      ALOGE("Failed to wait for epoll events because: %s\n", strerror(errno));
+      result = -errno;
+      break;
+    }
+
+    for (int i = 0; i < count; i++) {
+      if (events[i].data.ptr == this) {
+        result = -EBUSY;
+        done = true;
+        break;
+      }
+
+      Service* service = static_cast<Service*>(events[i].data.ptr);
+
+      Message message;
+      if (!service->ReceiveMessage(&message))
+        continue;
+
+      // Hashing the (service, channel) pair to a queue preserves per-channel
+      // message order while spreading independent channels across workers.
+      const size_t index = (std::hash<Service*>{}(service) ^
+                            std::hash<int>{}(message.GetChannelId())) %
+                           worker_count;
+      WorkerQueue* queue = queues[index].get();
+
+      ALOGI_IF(TRACE, "Queueing message: fd=%d worker=%zu\n",
+               service->endpoint()->epoll_fd(), index);
+      {
+        std::lock_guard<std::mutex> autolock(queue->mutex);
+        queue->queue.push_back(
+            WorkerQueue::WorkItem{service, std::move(message)});
+      }
+      queue->condition.notify_one();
+    }
+  }
+
+  for (auto& queue : queues) {
+    std::lock_guard<std::mutex> autolock(queue->mutex);
+    queue->quit = true;
+    queue->condition.notify_one();
+  }
+  for (auto& worker : workers)
+    worker.join();
+
+  ThreadExit();
+  return result;
+}
+
 void ServiceDispatcher::SetCanceled(bool cancel) {
   std::unique_lock<std::mutex> lock(mutex_);
   canceled_ = cancel;
@@ -2,6 +2,7 @@
 #include <cstdint>
 #include <functional>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <type_traits>
 
@@ -763,6 +764,57 @@ TEST(Variant, Become) {
   }
 }
 
+TEST(Variant, Emplace) {
+  {
+    Variant<int, bool, std::string> v;
+
+    v.emplace<int>(10);
+    ASSERT_TRUE(v.is<int>());
+    EXPECT_EQ(10, std::get<int>(v));
+
+    v.emplace<bool>(true);
+    ASSERT_TRUE(v.is<bool>());
+    EXPECT_EQ(true, std::get<bool>(v));
+
+    v.emplace<std::string>("test");
+    ASSERT_TRUE(v.is<std::string>());
+    EXPECT_EQ("test", std::get<std::string>(v));
+  }
+
+  {
+    // Emplace constructs the element in place from constructor arguments
+    // without materializing a temporary of the element type.
+    Variant<std::string> v;
+
+    std::string& value = v.emplace<std::string>(3u, 'x');
+    ASSERT_TRUE(v.is<std::string>());
+    EXPECT_EQ("xxx", std::get<std::string>(v));
+    EXPECT_EQ(&value, v.get<std::string>());
+  }
+
+  {
+    // Unlike Become with a matching target index, emplace always replaces the
+    // active element, even when the target type is already active.
+    Variant<std::string> v("foo");
+
+    v.emplace<std::string>("bar");
+    ASSERT_TRUE(v.is<std::string>());
+    EXPECT_EQ("bar", std::get<std::string>(v));
+  }
+
+  {
+    // Emplace supports element types that are not movable.
+    Variant<int, std::mutex> v(10);
+
+    v.emplace<std::mutex>();
+    EXPECT_TRUE(v.is<std::mutex>());
+
+    v.emplace<int>(20);
+    ASSERT_TRUE(v.is<int>());
+    EXPECT_EQ(20, std::get<int>(v));
+  }
+}
+
 TEST(Variant, Swap) {
   {
     Variant<std::string> a;
@@ -113,10 +113,34 @@ ChannelEventReceiver::ChannelEventReceiver(LocalHandle data_fd,
   epoll_fd_ = std::move(epoll_fd);
 }
 
+void ChannelEventReceiver::FillPollFds(pollfd* entries) const {
+  entries[0] = {pollin_event_fd_.Get(), POLLIN, 0};
+  entries[1] = {pollhup_event_fd_.Get(), POLLIN, 0};
+  entries[2] = {data_fd_.Get(), POLLHUP | POLLRDHUP, 0};
+}
+
+size_t ChannelEventReceiver::AppendPollFds(std::vector<pollfd>* pollfds) const {
+  const size_t original_size = pollfds->size();
+  pollfds->resize(original_size + kPollFdCount);
+  FillPollFds(pollfds->data() + original_size);
+  return kPollFdCount;
+}
+
+Status<int> ChannelEventReceiver::TranslatePollEvents(const pollfd* entries,
+                                                      size_t count) const {
+  if (count != kPollFdCount)
+    return ErrorStatus{EINVAL};
+
+  const int event_mask =
+      ((entries[0].revents & POLLIN) ? EPOLLIN : 0) |
+      ((entries[1].revents & POLLIN) ? EPOLLHUP : 0) |
+      ((entries[2].revents & (POLLHUP | POLLRDHUP)) ? EPOLLHUP : 0);
+  return {event_mask};
+}
+
 Status<int> ChannelEventReceiver::PollPendingEvents(int timeout_ms) const {
-  std::array<pollfd, 3> pfds = {{{pollin_event_fd_.Get(), POLLIN, 0},
-                                 {pollhup_event_fd_.Get(), POLLIN, 0},
-                                 {data_fd_.Get(), POLLHUP | POLLRDHUP, 0}}};
+  std::array<pollfd, kPollFdCount> pfds;
+  FillPollFds(pfds.data());
   if (RETRY_EINTR(poll(pfds.data(), pfds.size(), timeout_ms)) < 0) {
     const int error = errno;
     ALOGE(
@@ -126,11 +150,7 @@ Status<int> ChannelEventReceiver::PollPendingEvents(int timeout_ms) const {
     return ErrorStatus{error};
   }
 
-  const int event_mask =
-      ((pfds[0].revents & POLLIN) ? EPOLLIN : 0) |
-      ((pfds[1].revents & POLLIN) ? EPOLLHUP : 0) |
-      ((pfds[2].revents & (POLLHUP | POLLRDHUP)) ? EPOLLHUP : 0);
-  return {event_mask};
+  return TranslatePollEvents(pfds.data(), pfds.size());
 }
 
 Status<int> ChannelEventReceiver::GetPendingEvents() const {
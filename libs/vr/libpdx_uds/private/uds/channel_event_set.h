@@ -67,7 +67,18 @@ class ChannelEventReceiver {
 
   std::vector<ClientChannel::EventSource> GetEventSources() const;
 
+  // Batched event fetch support: appends the pollfd entries needed to compute
+  // the pending event mask to |pollfds| and converts their revents back into
+  // an event mask, so callers can poll many receivers with a single syscall.
+  // See ClientChannel::AppendPollFds().
+  size_t AppendPollFds(std::vector<pollfd>* pollfds) const;
+  Status<int> TranslatePollEvents(const pollfd* entries, size_t count) const;
+
+  enum : size_t { kPollFdCount = 3 };
+
  private:
+  void FillPollFds(pollfd* entries) const;
+
   LocalHandle data_fd_;
   LocalHandle pollin_event_fd_;
   LocalHandle pollhup_event_fd_;
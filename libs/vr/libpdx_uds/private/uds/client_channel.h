@@ -3,11 +3,13 @@
 
 #include <pdx/client_channel.h>
 
+#include <memory>
 #include <mutex>
 
 #include <uds/channel_event_set.h>
 #include <uds/channel_manager.h>
 #include <uds/service_endpoint.h>
+#include <uds/shared_ring.h>
 
 namespace android {
 namespace pdx {
@@ -40,6 +42,18 @@ class ClientChannel : public pdx::ClientChannel {
       return ErrorStatus(EINVAL);
   }
 
+  size_t AppendPollFds(std::vector<pollfd>* pollfds) const override {
+    return channel_data_ ? channel_data_->AppendPollFds(pollfds) : 0;
+  }
+
+  Status<int> TranslatePollEvents(const pollfd* entries,
+                                  size_t count) const override {
+    if (channel_data_)
+      return channel_data_->TranslatePollEvents(entries, count);
+    else
+      return ErrorStatus(EINVAL);
+  }
+
   LocalChannelHandle& GetChannelHandle() override { return channel_handle_; }
   const LocalChannelHandle& GetChannelHandle() const override {
     return channel_handle_;
@@ -86,9 +100,22 @@ class ClientChannel : public pdx::ClientChannel {
                              const iovec* send_vector, size_t send_count,
                              const iovec* receive_vector, size_t receive_count);
 
+  // Offers the service a shared-memory impulse ring for this channel. Called
+  // once, on the first impulse; if the service declines (or predates ring
+  // support) impulses stay on the socket path. Must be called with
+  // socket_mutex_ held.
+  void TryEnableImpulseRingLocked();
+
   LocalChannelHandle channel_handle_;
   ChannelEventReceiver* channel_data_;
   std::mutex socket_mutex_;
+
+  // Shared-memory impulse fast path. impulse_ring_ is the producer-side
+  // mapping and impulse_ring_event_fd_ wakes the service endpoint's epoll
+  // set after each record. Both are null until the service accepts the ring.
+  std::unique_ptr<SharedImpulseRing> impulse_ring_;
+  LocalHandle impulse_ring_event_fd_;
+  bool impulse_ring_checked_{false};
 };
 
 }  // namespace uds
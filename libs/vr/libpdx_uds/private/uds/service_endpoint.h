@@ -13,6 +13,7 @@
 #include <pdx/service.h>
 #include <pdx/service_endpoint.h>
 #include <uds/channel_event_set.h>
+#include <uds/shared_ring.h>
 
 namespace android {
 namespace pdx {
@@ -81,6 +82,8 @@ class Endpoint : public pdx::Endpoint {
   void* AllocateMessageState() override;
   void FreeMessageState(void* state) override;
 
+  Status<void> EnableChannelImpulseRing(Message* message) override;
+
   Status<void> Cancel() override;
 
   // Open an endpoint at the given path.
@@ -112,6 +115,16 @@ class Endpoint : public pdx::Endpoint {
     LocalHandle data_fd;
     ChannelEventSet event_set;
     Channel* channel_state{nullptr};
+
+    // Optional shared-memory impulse ring offered by the client. The
+    // eventfd is registered in the endpoint epoll set and signals one
+    // pending ring record per wakeup. The credentials are captured from the
+    // ring setup message, since ring records do not carry them.
+    std::unique_ptr<SharedImpulseRing> impulse_ring;
+    LocalHandle impulse_ring_event_fd;
+    pid_t impulse_ring_pid{-1};
+    uid_t impulse_ring_uid{static_cast<uid_t>(-1)};
+    gid_t impulse_ring_gid{static_cast<gid_t>(-1)};
   };
 
   // This class must be instantiated using Create() static methods above.
@@ -133,6 +146,8 @@ class Endpoint : public pdx::Endpoint {
   Status<void> AcceptConnection(Message* message);
   Status<void> ReceiveMessageForChannel(const BorrowedHandle& channel_fd,
                                         Message* message);
+  Status<void> ReceiveRingImpulse(const BorrowedHandle& event_fd,
+                                  Message* message);
   Status<void> OnNewChannel(LocalHandle channel_fd);
   Status<std::pair<int32_t, ChannelData*>> OnNewChannelLocked(
       LocalHandle channel_fd, Channel* channel_state);
@@ -155,6 +170,8 @@ class Endpoint : public pdx::Endpoint {
   mutable std::mutex channel_mutex_;
   std::map<int32_t, ChannelData> channels_;
   std::map<int, int32_t> channel_fd_to_id_;
+  // Maps impulse ring eventfds in the epoll set back to their channels.
+  std::map<int, int32_t> ring_fd_to_id_;
   int32_t last_channel_id_{0};
 
   Service* service_{nullptr};
@@ -0,0 +1,94 @@
+#ifndef ANDROID_PDX_UDS_SHARED_RING_H_
+#define ANDROID_PDX_UDS_SHARED_RING_H_
+
+#include <stdint.h>
+
+#include <atomic>
+#include <memory>
+
+#include <pdx/file_handle.h>
+
+namespace android {
+namespace pdx {
+namespace uds {
+
+// Single-producer/single-consumer ring of impulse records in a shared-memory
+// region, used as a fast path between a client channel and its service
+// endpoint. The client writes records directly into the shared region and the
+// service reads them out, replacing the header serialization and
+// sendmsg/recvmsg round trip of the socket path with a memcpy on each side.
+// Signaling is done separately (the uds transport uses an eventfd so the ring
+// integrates with the endpoint's epoll set).
+//
+// The consumer must treat the shared region as untrusted: the producer may be
+// a malicious client. Read() clamps the record length accordingly.
+class SharedImpulseRing {
+ public:
+  // Maximum impulse payload carried by a record. Matches the impulse payload
+  // size of the socket protocol, which callers static_assert against.
+  static constexpr size_t kMaxPayloadSize = 32;
+
+  // Number of records in the ring. Must be a power of two. Sized so the
+  // region fits in a single page.
+  static constexpr uint32_t kRecordCount = 64;
+
+  struct Record {
+    int32_t op;
+    uint32_t length;
+    uint8_t payload[kMaxPayloadSize];
+  };
+
+  // Creates the shared region and maps it. Used by the producing side.
+  static std::unique_ptr<SharedImpulseRing> Create();
+
+  // Maps an existing region received from the producer over IPC. Does not
+  // take ownership of |region_fd|; the mapping remains valid after the fd is
+  // closed.
+  static std::unique_ptr<SharedImpulseRing> Import(
+      const BorrowedHandle& region_fd);
+
+  ~SharedImpulseRing();
+
+  // Returns the region fd to be passed to the consuming side. Only valid on
+  // rings obtained from Create().
+  BorrowedHandle region_handle() const { return region_fd_.Borrow(); }
+
+  // Writes one record to the ring. Returns false without writing when the
+  // ring is full or |length| exceeds kMaxPayloadSize, in which case the
+  // caller is expected to fall back to the socket path.
+  bool Write(int32_t op, const void* buffer, size_t length);
+
+  // Reads one record from the ring. Returns false when the ring is empty.
+  bool Read(Record* record);
+
+ private:
+  // The head and tail indices are kept on separate cache lines so the
+  // producer and consumer do not false-share.
+  struct RingHeader {
+    std::atomic<uint32_t> head;  // Next record to write. Owned by producer.
+    uint32_t reserved_head[15];
+    std::atomic<uint32_t> tail;  // Next record to read. Owned by consumer.
+    uint32_t reserved_tail[15];
+  };
+
+  static_assert((kRecordCount & (kRecordCount - 1)) == 0,
+                "kRecordCount must be a power of two");
+
+  static constexpr size_t kRegionSize =
+      sizeof(RingHeader) + kRecordCount * sizeof(Record);
+
+  SharedImpulseRing(LocalHandle region_fd, void* base);
+
+  SharedImpulseRing(const SharedImpulseRing&) = delete;
+  void operator=(const SharedImpulseRing&) = delete;
+
+  LocalHandle region_fd_;
+  RingHeader* header_;
+  Record* records_;
+};
+
+}  // namespace uds
+}  // namespace pdx
+}  // namespace android
+
+#endif  // ANDROID_PDX_UDS_SHARED_RING_H_
@@ -5,6 +5,7 @@
 #include <sys/eventfd.h>
 #include <sys/socket.h>
 #include <sys/un.h>
+#include <unistd.h>
 #include <algorithm>  // std::min
 
 #include <android-base/logging.h>
@@ -212,6 +213,47 @@ void Endpoint::FreeMessageState(void* state) {
   delete static_cast<MessageState*>(state);
 }
 
+Status<void> Endpoint::EnableChannelImpulseRing(Message* message) {
+  // The client sends the shared region fd and the wakeup eventfd with the
+  // setup request.
+  auto* state = static_cast<MessageState*>(message->GetState());
+  if (state->request.file_descriptors.size() != 2)
+    return ErrorStatus{EINVAL};
+
+  auto ring =
+      SharedImpulseRing::Import(state->request.file_descriptors[0].Borrow());
+  if (!ring)
+    return ErrorStatus{EINVAL};
+  LocalHandle event_fd = std::move(state->request.file_descriptors[1]);
+
+  std::lock_guard<std::mutex> autolock(channel_mutex_);
+  auto iter = channels_.find(message->GetChannelId());
+  if (iter == channels_.end())
+    return ErrorStatus{EINVAL};
+  ChannelData& channel_data = iter->second;
+  if (channel_data.impulse_ring)
+    return ErrorStatus{EALREADY};
+
+  epoll_event event;
+  event.events = EPOLLIN | EPOLLONESHOT;
+  event.data.fd = event_fd.Get();
+  if (epoll_ctl(epoll_fd_.Get(), EPOLL_CTL_ADD, event_fd.Get(), &event) < 0) {
+    ALOGE(
+        "Endpoint::EnableChannelImpulseRing: Failed to add ring event fd to "
+        "epoll fd: %s\n",
+        strerror(errno));
+    return ErrorStatus{errno};
+  }
+
+  ring_fd_to_id_.emplace(event_fd.Get(), message->GetChannelId());
+  channel_data.impulse_ring = std::move(ring);
+  channel_data.impulse_ring_event_fd = std::move(event_fd);
+  channel_data.impulse_ring_pid = message->GetProcessId();
+  channel_data.impulse_ring_uid = message->GetEffectiveUserId();
+  channel_data.impulse_ring_gid = message->GetEffectiveGroupId();
+  return {};
+}
+
 Status<void> Endpoint::AcceptConnection(Message* message) {
   if (!socket_fd_)
     return ErrorStatus(EBADF);
@@ -345,6 +387,12 @@ Status<void> Endpoint::CloseChannelLocked(int32_t channel_id) {
     status.SetValue();
   }
 
+  if (iter->second.impulse_ring_event_fd) {
+    const int ring_event_fd = iter->second.impulse_ring_event_fd.Get();
+    epoll_ctl(epoll_fd_.Get(), EPOLL_CTL_DEL, ring_event_fd, &dummy);
+    ring_fd_to_id_.erase(ring_event_fd);
+  }
+
   channel_fd_to_id_.erase(channel_fd);
   channels_.erase(iter);
   return status;
@@ -600,10 +648,67 @@ Status<void> Endpoint::MessageReceive(Message* message) {
     return status;
   }
 
+  {
+    std::lock_guard<std::mutex> autolock(channel_mutex_);
+    if (ring_fd_to_id_.count(event.data.fd) != 0)
+      return ReceiveRingImpulse(BorrowedHandle{event.data.fd}, message);
+  }
+
   BorrowedHandle channel_fd{event.data.fd};
   return ReceiveMessageForChannel(channel_fd, message);
 }
 
+Status<void> Endpoint::ReceiveRingImpulse(const BorrowedHandle& event_fd,
+                                          Message* message) {
+  // Consume one wakeup. The eventfd is in semaphore mode, so each read
+  // balances one record written by the client.
+  uint64_t wakeups = 0;
+  RETRY_EINTR(read(event_fd.Get(), &wakeups, sizeof(wakeups)));
+
+  std::lock_guard<std::mutex> autolock(channel_mutex_);
+  auto iter = ring_fd_to_id_.find(event_fd.Get());
+  if (iter == ring_fd_to_id_.end())
+    return ErrorStatus{EBADF};
+  const int32_t channel_id = iter->second;
+  auto channel_iter = channels_.find(channel_id);
+  if (channel_iter == channels_.end())
+    return ErrorStatus{EBADF};
+  ChannelData& channel_data = channel_iter->second;
+
+  SharedImpulseRing::Record record;
+  const bool have_record = channel_data.impulse_ring->Read(&record);
+  auto status = ReenableEpollEvent(event_fd);
+  if (!status)
+    return status;
+  if (!have_record) {
+    // Wakeup with no pending record: the client fell back to the socket for
+    // an impulse whose poke failed, or is misbehaving. Not an error worth
+    // tearing the channel down for.
+    return ErrorStatus{ETIMEDOUT};
+  }
+
+  MessageInfo info;
+  info.pid = channel_data.impulse_ring_pid;
+  info.tid = -1;
+  info.cid = channel_id;
+  info.mid = Message::IMPULSE_MESSAGE_ID;
+  info.euid = channel_data.impulse_ring_uid;
+  info.egid = channel_data.impulse_ring_gid;
+  info.op = record.op;
+  info.flags = 0;
+  info.service = service_;
+  info.channel = channel_data.channel_state;
+  info.send_len = record.length;
+  info.recv_len = 0;
+  info.fd_count = 0;
+  static_assert(sizeof(info.impulse) == sizeof(record.payload),
+                "Impulse payload sizes must be the same in ring records and "
+                "MessageInfo");
+  memcpy(info.impulse, record.payload, sizeof(record.payload));
+  *message = Message{info};
+  return {};
+}
+
 Status<void> Endpoint::MessageReply(Message* message, int return_code) {
   const int32_t channel_id = message->GetChannelId();
   auto channel_socket = GetChannelSocketFd(channel_id);
@@ -0,0 +1,110 @@
+#include "uds/shared_ring.h"
+
+#include <string.h>
+#include <sys/mman.h>
+
+#include <cutils/ashmem.h>
+#include <log/log.h>
+
+namespace android {
+namespace pdx {
+namespace uds {
+
+namespace {
+
+void* MapRegion(int fd, size_t size) {
+  void* base =
+      mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  return base == MAP_FAILED ? nullptr : base;
+}
+
+}  // anonymous namespace
+
+SharedImpulseRing::SharedImpulseRing(LocalHandle region_fd, void* base)
+    : region_fd_{std::move(region_fd)},
+      header_{static_cast<RingHeader*>(base)},
+      records_{reinterpret_cast<Record*>(static_cast<uint8_t*>(base) +
+                                         sizeof(RingHeader))} {}
+
+SharedImpulseRing::~SharedImpulseRing() { munmap(header_, kRegionSize); }
+
+std::unique_ptr<SharedImpulseRing> SharedImpulseRing::Create() {
+  LocalHandle region_fd{
+      ashmem_create_region("pdx-impulse-ring", kRegionSize)};
+  if (!region_fd) {
+    ALOGE("SharedImpulseRing::Create: Failed to create shared region: %s",
+          strerror(errno));
+    return nullptr;
+  }
+
+  void* base = MapRegion(region_fd.Get(), kRegionSize);
+  if (base == nullptr) {
+    ALOGE("SharedImpulseRing::Create: Failed to map shared region: %s",
+          strerror(errno));
+    return nullptr;
+  }
+
+  memset(base, 0, sizeof(RingHeader));
+  return std::unique_ptr<SharedImpulseRing>{
+      new SharedImpulseRing{std::move(region_fd), base}};
+}
+
+std::unique_ptr<SharedImpulseRing> SharedImpulseRing::Import(
+    const BorrowedHandle& region_fd) {
+  // Reject regions of unexpected size: the producer controls the fd and the
+  // consumer must not map or index past what it expects.
+  if (ashmem_get_size_region(region_fd.Get()) <
+      static_cast<int>(kRegionSize)) {
+    ALOGE("SharedImpulseRing::Import: Region is too small");
+    return nullptr;
+  }
+
+  void* base = MapRegion(region_fd.Get(), kRegionSize);
+  if (base == nullptr) {
+    ALOGE("SharedImpulseRing::Import: Failed to map shared region: %s",
+          strerror(errno));
+    return nullptr;
+  }
+
+  return std::unique_ptr<SharedImpulseRing>{
+      new SharedImpulseRing{LocalHandle{}, base}};
+}
+
+bool SharedImpulseRing::Write(int32_t op, const void* buffer, size_t length) {
+  if (length > kMaxPayloadSize || (buffer == nullptr && length != 0))
+    return false;
+
+  const uint32_t head = header_->head.load(std::memory_order_relaxed);
+  const uint32_t tail = header_->tail.load(std::memory_order_acquire);
+  if (head - tail >= kRecordCount)
+    return false;
+
+  Record* record = &records_[head & (kRecordCount - 1)];
+  record->op = op;
+  record->length = static_cast<uint32_t>(length);
+  if (length > 0)
+    memcpy(record->payload, buffer, length);
+
+  // Publish the record before it becomes visible to the consumer.
+  header_->head.store(head + 1, std::memory_order_release);
+  return true;
+}
+
+bool SharedImpulseRing::Read(Record* record) {
+  const uint32_t tail = header_->tail.load(std::memory_order_relaxed);
+  if (header_->head.load(std::memory_order_acquire) == tail)
+    return false;
+
+  *record = records_[tail & (kRecordCount - 1)];
+  // The producer may scribble on the shared region at any time; make sure
+  // the length the consumer acts on is in range regardless.
+  if (record->length > kMaxPayloadSize)
+    record->length = kMaxPayloadSize;
+
+  header_->tail.store(tail + 1, std::memory_order_release);
+  return true;
+}
+
+}  // namespace uds
+}  // namespace pdx
+}  // namespace android
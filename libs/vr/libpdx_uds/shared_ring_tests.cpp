@@ -0,0 +1,105 @@
+#include <uds/shared_ring.h>
+
+#include <string.h>
+
+#include <memory>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+using android::pdx::uds::SharedImpulseRing;
+
+namespace {
+
+using Record = SharedImpulseRing::Record;
+
+class SharedRingTest : public testing::Test {
+ public:
+  void SetUp() override {
+    producer_ = SharedImpulseRing::Create();
+    ASSERT_NE(nullptr, producer_);
+    consumer_ = SharedImpulseRing::Import(producer_->region_handle());
+    ASSERT_NE(nullptr, consumer_);
+  }
+
+ protected:
+  std::unique_ptr<SharedImpulseRing> producer_;
+  std::unique_ptr<SharedImpulseRing> consumer_;
+};
+
+TEST_F(SharedRingTest, WriteRead) {
+  const char payload[] = "impulse payload";
+  ASSERT_TRUE(producer_->Write(123, payload, sizeof(payload)));
+
+  Record record;
+  ASSERT_TRUE(consumer_->Read(&record));
+  EXPECT_EQ(123, record.op);
+  EXPECT_EQ(sizeof(payload), record.length);
+  EXPECT_EQ(0, memcmp(record.payload, payload, sizeof(payload)));
+
+  // The ring is empty again.
+  EXPECT_FALSE(consumer_->Read(&record));
+}
+
+TEST_F(SharedRingTest, EmptyPayload) {
+  ASSERT_TRUE(producer_->Write(1, nullptr, 0));
+
+  Record record;
+  ASSERT_TRUE(consumer_->Read(&record));
+  EXPECT_EQ(1, record.op);
+  EXPECT_EQ(0u, record.length);
+}
+
+TEST_F(SharedRingTest, RejectsOversizedPayload) {
+  uint8_t payload[SharedImpulseRing::kMaxPayloadSize + 1] = {};
+  EXPECT_FALSE(producer_->Write(1, payload, sizeof(payload)));
+  EXPECT_TRUE(producer_->Write(1, payload, sizeof(payload) - 1));
+}
+
+TEST_F(SharedRingTest, FullRing) {
+  for (uint32_t i = 0; i < SharedImpulseRing::kRecordCount; i++)
+    ASSERT_TRUE(producer_->Write(static_cast<int32_t>(i), &i, sizeof(i)));
+
+  // The ring is full; further writes are declined until a record is drained.
+  uint32_t extra = 0xffffffff;
+  EXPECT_FALSE(producer_->Write(-1, &extra, sizeof(extra)));
+
+  Record record;
+  ASSERT_TRUE(consumer_->Read(&record));
+  EXPECT_EQ(0, record.op);
+  EXPECT_TRUE(producer_->Write(-1, &extra, sizeof(extra)));
+
+  // Drain the rest and confirm ordering, including the wrapped record.
+  for (uint32_t i = 1; i < SharedImpulseRing::kRecordCount; i++) {
+    ASSERT_TRUE(consumer_->Read(&record));
+    EXPECT_EQ(static_cast<int32_t>(i), record.op);
+  }
+  ASSERT_TRUE(consumer_->Read(&record));
+  EXPECT_EQ(-1, record.op);
+  EXPECT_FALSE(consumer_->Read(&record));
+}
+
+TEST_F(SharedRingTest, ConcurrentProducerConsumer) {
+  constexpr int32_t kCount = 100000;
+  std::thread producer_thread([this] {
+    for (int32_t i = 0; i < kCount;) {
+      if (producer_->Write(i, &i, sizeof(i)))
+        i++;
+    }
+  });
+
+  Record record;
+  for (int32_t i = 0; i < kCount;) {
+    if (consumer_->Read(&record)) {
+      EXPECT_EQ(i, record.op);
+      int32_t value;
+      memcpy(&value, record.payload, sizeof(value));
+      EXPECT_EQ(i, value);
+      i++;
+    }
+  }
+  producer_thread.join();
+  EXPECT_FALSE(consumer_->Read(&record));
+}
+
+}  // namespace
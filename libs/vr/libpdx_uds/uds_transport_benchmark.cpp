@@ -0,0 +1,261 @@
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <pdx/client.h>
+#include <pdx/file_handle.h>
+#include <pdx/service.h>
+#include <pdx/service_dispatcher.h>
+#include <uds/client_channel.h>
+#include <uds/client_channel_factory.h>
+#include <uds/service_endpoint.h>
+
+using android::pdx::ClientBase;
+using android::pdx::FileReference;
+using android::pdx::LocalHandle;
+using android::pdx::Message;
+using android::pdx::ServiceBase;
+using android::pdx::ServiceDispatcher;
+using android::pdx::Status;
+using android::pdx::Transaction;
+using android::pdx::uds::Endpoint;
+using ::benchmark::State;
+
+namespace {
+
+const char kBenchmarkServicePath[] = "socket_benchmark";
+
+// Largest payload exercised by the round trip benchmark. Handlers read into
+// stack buffers of this size so that echoing does not allocate and remains
+// safe under a worker pool dispatcher.
+constexpr size_t kMaxPayloadSize = 64 * 1024;
+
+enum benchmark_op_codes {
+  BENCHMARK_OP_PING,
+  BENCHMARK_OP_ECHO,
+  BENCHMARK_OP_SEND_HANDLE,
+};
+
+// Service that answers pings, echoes transaction payloads and accepts pushed
+// file handles. Handlers do as little work as possible so that the measured
+// numbers reflect transport and dispatch overhead rather than handler cost.
+class BenchmarkService : public ServiceBase<BenchmarkService> {
+ public:
+  Status<void> HandleMessage(Message& message) override {
+    switch (message.GetOp()) {
+      case BENCHMARK_OP_PING:
+        REPLY_MESSAGE_RETURN(message, 0, {});
+
+      case BENCHMARK_OP_ECHO: {
+        uint8_t buffer[kMaxPayloadSize];
+        const size_t size = message.GetSendLength();
+        if (size > kMaxPayloadSize || !message.ReadAll(buffer, size))
+          REPLY_ERROR_RETURN(message, EIO, {});
+        if (size > 0 && !message.WriteAll(buffer, size))
+          REPLY_ERROR_RETURN(message, EIO, {});
+        REPLY_MESSAGE_RETURN(message, static_cast<int>(size), {});
+      }
+
+      case BENCHMARK_OP_SEND_HANDLE: {
+        FileReference ref = -1;
+        LocalHandle handle;
+        if (!message.ReadAll(&ref, sizeof(ref)) ||
+            !message.GetFileHandle(ref, &handle))
+          REPLY_ERROR_RETURN(message, EIO, {});
+        REPLY_MESSAGE_RETURN(message, 0, {});
+      }
+
+      default:
+        return Service::DefaultHandleMessage(message);
+    }
+  }
+
+ private:
+  friend BASE;
+
+  BenchmarkService()
+      : BASE("BenchmarkService",
+             Endpoint::CreateAndBindSocket(kBenchmarkServicePath)) {}
+
+  BenchmarkService(const BenchmarkService&) = delete;
+  void operator=(const BenchmarkService&) = delete;
+};
+
+// Client used to drive the benchmark service.
+class BenchmarkClient : public ClientBase<BenchmarkClient> {
+ public:
+  // Minimal round trip carrying no payload.
+  int Ping() {
+    Transaction trans{*this};
+    return ReturnStatusOrError(trans.Send<int>(BENCHMARK_OP_PING));
+  }
+
+  // Sends |size| bytes and receives them back into |receive_buffer|.
+  int Echo(const void* send_buffer, size_t size, void* receive_buffer) {
+    Transaction trans{*this};
+    return ReturnStatusOrError(trans.Send<int>(
+        BENCHMARK_OP_ECHO, send_buffer, size, receive_buffer, size));
+  }
+
+  // Pushes |handle| to the service, which takes ownership of the duplicate
+  // created by the kernel during the transfer.
+  int SendHandle(const LocalHandle& handle) {
+    Transaction trans{*this};
+    FileReference ref = trans.PushFileHandle(handle.Borrow()).get();
+    return ReturnStatusOrError(trans.Send<int>(BENCHMARK_OP_SEND_HANDLE, &ref,
+                                               sizeof(ref), nullptr, 0));
+  }
+
+ private:
+  friend BASE;
+
+  BenchmarkClient()
+      : BASE{android::pdx::uds::ClientChannelFactory::Create(
+            kBenchmarkServicePath)} {}
+
+  BenchmarkClient(const BenchmarkClient&) = delete;
+  void operator=(const BenchmarkClient&) = delete;
+};
+
+// Runs the benchmark service on a dispatcher thread for the lifetime of a
+// benchmark case. Clients must be destroyed before this object so that their
+// blocking close messages are answered before the dispatcher is canceled;
+// declare the environment first and clients after it in each benchmark.
+class BenchmarkServiceRunner {
+ public:
+  explicit BenchmarkServiceRunner(size_t worker_count = 0) {
+    dispatcher_ = ServiceDispatcher::Create();
+    service_ = BenchmarkService::Create();
+    if (!dispatcher_ || !service_ ||
+        dispatcher_->AddService(service_) != 0) {
+      std::cerr << "Failed to start benchmark service!" << std::endl;
+      exit(1);
+    }
+    dispatch_thread_ = std::thread([this, worker_count] {
+      dispatcher_->EnterDispatchLoop(worker_count);
+    });
+  }
+
+  ~BenchmarkServiceRunner() {
+    dispatcher_->SetCanceled(true);
+    dispatch_thread_.join();
+  }
+
+ private:
+  std::unique_ptr<ServiceDispatcher> dispatcher_;
+  std::shared_ptr<BenchmarkService> service_;
+  std::thread dispatch_thread_;
+
+  BenchmarkServiceRunner(const BenchmarkServiceRunner&) = delete;
+  void operator=(const BenchmarkServiceRunner&) = delete;
+};
+
+// Round trip latency and throughput versus payload size. The time per
+// iteration is the request/reply latency for the given payload; the reported
+// byte rate counts the payload in both directions.
+void BM_RoundTrip(State& state) {
+  BenchmarkServiceRunner runner;
+  auto client = BenchmarkClient::Create();
+  if (!client) {
+    state.SkipWithError("Failed to connect to benchmark service.");
+    return;
+  }
+
+  const size_t payload_size = static_cast<size_t>(state.range(0));
+  std::vector<uint8_t> send_buffer(payload_size, 0x5a);
+  std::vector<uint8_t> receive_buffer(payload_size);
+
+  while (state.KeepRunning()) {
+    const int ret = client->Echo(send_buffer.data(), payload_size,
+                                 receive_buffer.data());
+    if (ret != static_cast<int>(payload_size)) {
+      state.SkipWithError("Echo transaction failed.");
+      return;
+    }
+  }
+
+  state.SetBytesProcessed(2 * static_cast<int64_t>(payload_size) *
+                          state.iterations());
+}
+BENCHMARK(BM_RoundTrip)
+    ->Arg(0)
+    ->Arg(16)
+    ->Arg(128)
+    ->Arg(1024)
+    ->Arg(8192)
+    ->Arg(65536);
+
+// Cost of translating a file descriptor through a transaction, on top of the
+// empty round trip measured by BM_RoundTrip with payload size 0.
+void BM_FileHandlePassing(State& state) {
+  BenchmarkServiceRunner runner;
+  auto client = BenchmarkClient::Create();
+  if (!client) {
+    state.SkipWithError("Failed to connect to benchmark service.");
+    return;
+  }
+
+  LocalHandle handle{eventfd(0, EFD_CLOEXEC)};
+  if (!handle) {
+    state.SkipWithError("Failed to create eventfd.");
+    return;
+  }
+
+  while (state.KeepRunning()) {
+    if (client->SendHandle(handle) != 0) {
+      state.SkipWithError("Handle transaction failed.");
+      return;
+    }
+  }
+}
+BENCHMARK(BM_FileHandlePassing);
+
+// Dispatcher fan-out scaling: round-robin pings across |range(0)| channels
+// of the same service, dispatched on |range(1)| workers (0 uses the plain
+// single-threaded dispatch loop). Shows how per-message dispatch cost grows
+// with the number of registered channels.
+void BM_DispatcherFanOut(State& state) {
+  BenchmarkServiceRunner runner(static_cast<size_t>(state.range(1)));
+
+  const size_t channel_count = static_cast<size_t>(state.range(0));
+  std::vector<std::unique_ptr<BenchmarkClient>> clients;
+  for (size_t i = 0; i < channel_count; i++) {
+    auto client = BenchmarkClient::Create();
+    if (!client || client->Ping() != 0) {
+      state.SkipWithError("Failed to connect to benchmark service.");
+      return;
+    }
+    clients.push_back(std::move(client));
+  }
+
+  size_t next_client = 0;
+  while (state.KeepRunning()) {
+    if (clients[next_client]->Ping() != 0) {
+      state.SkipWithError("Ping transaction failed.");
+      return;
+    }
+    next_client = (next_client + 1) % channel_count;
+  }
+}
+BENCHMARK(BM_DispatcherFanOut)
+    ->Args({1, 0})
+    ->Args({4, 0})
+    ->Args({16, 0})
+    ->Args({64, 0})
+    ->Args({16, 2})
+    ->Args({64, 2})
+    ->Args({64, 4});
+
+}  // anonymous namespace
+
+// Buffer queue produce/consume cycles over this transport are covered by the
+// buffer_transport_benchmark target in libbufferhubqueue/benchmarks.
+BENCHMARK_MAIN();
@@ -15,7 +15,11 @@ AcquiredBuffer::AcquiredBuffer(const std::shared_ptr<BufferConsumer>& buffer,
 AcquiredBuffer::AcquiredBuffer(const std::shared_ptr<BufferConsumer>& buffer,
                                int* error) {
   LocalHandle fence;
-  const int ret = buffer->Acquire(&fence);
+  DvrNativeBufferMetadata meta;
+  // Acquire through the shared memory fast path: the state transition is an
+  // atomic CAS on the shared state word and the fence comes from the shared
+  // fence set, so bufferhubd stays off the latency path.
+  const int ret = buffer->AcquireAsync(&meta, &fence);
 
   if (error)
     *error = ret;
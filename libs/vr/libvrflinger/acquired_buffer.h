@@ -51,6 +51,11 @@ class AcquiredBuffer {
   // fence is empty). Returns false when empty or if the fence is not signaled.
   bool IsAvailable() const;
 
+  // Closes the acquire fence after an external wait (such as a batched poll()
+  // across several buffers) observed it signal. Subsequent calls to
+  // IsAvailable() return true without calling sync_wait().
+  void MarkAvailable() const { acquire_fence_.Close(); }
+
   bool IsEmpty() const { return buffer_ == nullptr; }
 
   // Returns the acquire fence, passing ownership to the caller.
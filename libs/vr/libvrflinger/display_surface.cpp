@@ -440,6 +440,21 @@ bool DirectDisplaySurface::IsBufferAvailable() {
          acquired_buffers_.Front().IsAvailable();
 }
 
+int DirectDisplaySurface::GetPendingBufferFence() {
+  std::lock_guard<std::mutex> autolock(lock_);
+  DequeueBuffersLocked();
+
+  if (acquired_buffers_.IsEmpty())
+    return -1;
+  return acquired_buffers_.Front().acquire_fence();
+}
+
+void DirectDisplaySurface::MarkPendingBufferFenceSignaled() {
+  std::lock_guard<std::mutex> autolock(lock_);
+  if (!acquired_buffers_.IsEmpty())
+    acquired_buffers_.Front().MarkAvailable();
+}
+
 bool DirectDisplaySurface::IsBufferPosted() {
   std::lock_guard<std::mutex> autolock(lock_);
   DequeueBuffersLocked();
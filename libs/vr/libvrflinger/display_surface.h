@@ -146,6 +146,18 @@ class DirectDisplaySurface : public DisplaySurface {
   std::vector<int32_t> GetQueueIds() const override;
   bool IsBufferAvailable();
   bool IsBufferPosted();
+
+  // Returns the acquire fence fd of the next buffer to display, or -1 if there
+  // is no pending buffer or its fence has already signaled. The fd remains
+  // owned by the buffer and is only valid until the next call into this
+  // surface.
+  int GetPendingBufferFence();
+
+  // Marks the pending buffer's acquire fence as signaled so that the next
+  // IsBufferAvailable() does not need to check it. Only call this after
+  // observing the fence signal, e.g. with poll().
+  void MarkPendingBufferFenceSignaled();
+
   AcquiredBuffer AcquireCurrentBuffer();
 
   // Get the newest buffer. Up to one buffer will be skipped. If a buffer is
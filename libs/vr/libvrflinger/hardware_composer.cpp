@@ -466,9 +466,42 @@ std::string HardwareComposer::Dump() {
   return stream.str();
 }
 
+void HardwareComposer::PollPendingLayerFences() {
+  std::vector<pollfd> poll_entries;
+  std::vector<Layer*> poll_layers;
+  for (auto& layer : layers_) {
+    const int fence = layer.GetPendingBufferFence();
+    if (fence >= 0) {
+      poll_entries.push_back({fence, POLLIN, 0});
+      poll_layers.push_back(&layer);
+    }
+  }
+
+  // With a single unsignaled fence the sync_wait() in Prepare() is just as
+  // cheap; batching only pays off with multiple layers in flight.
+  if (poll_entries.size() < 2)
+    return;
+
+  int ret;
+  do {
+    ret = poll(poll_entries.data(), poll_entries.size(), /*timeout=*/0);
+  } while (ret < 0 && errno == EINTR);
+  if (ret <= 0)
+    return;
+
+  for (size_t i = 0; i < poll_entries.size(); ++i) {
+    if (poll_entries[i].revents & POLLIN)
+      poll_layers[i]->MarkPendingBufferFenceSignaled();
+  }
+}
+
 void HardwareComposer::PostLayers(hwc2_display_t display) {
   ATRACE_NAME("HardwareComposer::PostLayers");
 
+  // Check all outstanding acquire fences together so that each frame pays for
+  // at most one fence syscall before the layer setup below.
+  PollPendingLayerFences();
+
   // Setup the hardware composer layers with current buffers.
   for (auto& layer : layers_) {
     layer.Prepare();
@@ -1442,14 +1475,20 @@ void Layer::Prepare() {
     if (cached)
       handle = nullptr;
 
-    HWC::Error error{HWC::Error::None};
-    error =
-        composer_->setLayerBuffer(display_params_.id, hardware_composer_layer_,
-                                  slot, handle, acquire_fence_.Get());
+    // HWC layer state is persistent across presents. When no new buffer was
+    // acquired this frame (no acquire fence) and the slot association is
+    // already established, the layer contents are unchanged and the buffer
+    // command can be elided entirely.
+    if (!cached || acquire_fence_) {
+      HWC::Error error =
+          composer_->setLayerBuffer(display_params_.id,
+                                    hardware_composer_layer_, slot, handle,
+                                    acquire_fence_.Get());
 
-    ALOGE_IF(error != HWC::Error::None,
-             "Layer::Prepare: Error setting layer buffer: %s",
-             error.to_string().c_str());
+      ALOGE_IF(error != HWC::Error::None,
+               "Layer::Prepare: Error setting layer buffer: %s",
+               error.to_string().c_str());
+    }
 
     if (!surface_rect_functions_applied_) {
       const float float_right = right;
@@ -145,6 +145,27 @@ class Layer {
     return buffer_id;
   }
 
+  // Returns the acquire fence of the buffer this layer would pick up on the
+  // next Prepare(), or -1 if there is no pending buffer or its fence already
+  // signaled. Only valid for layers backed by a surface.
+  int GetPendingBufferFence() {
+    int fence = -1;
+    pdx::rpc::IfAnyOf<SourceSurface>::Call(
+        &source_, [&fence](SourceSurface& surface_source) {
+          fence = surface_source.surface->GetPendingBufferFence();
+        });
+    return fence;
+  }
+
+  // Marks the pending buffer's acquire fence as signaled after an external
+  // poll() observed it; see DirectDisplaySurface for details.
+  void MarkPendingBufferFenceSignaled() {
+    pdx::rpc::IfAnyOf<SourceSurface>::Call(
+        &source_, [](SourceSurface& surface_source) {
+          surface_source.surface->MarkPendingBufferFenceSignaled();
+        });
+  }
+
   // Compares Layers by surface id.
   bool operator<(const Layer& other) const {
     return GetSurfaceId() < other.GetSurfaceId();
@@ -390,6 +411,10 @@ class HardwareComposer {
   HWC::Error Validate(hwc2_display_t display);
   HWC::Error Present(hwc2_display_t display);
 
+  // Checks the pending acquire fences of all layers with a single poll()
+  // instead of one sync_wait() per layer during Prepare().
+  void PollPendingLayerFences();
+
   void PostLayers(hwc2_display_t display);
   void PostThread();
 
@@ -116,6 +116,24 @@ int dvrPoseClientLogController(DvrPoseClient* client, bool enable);
 // @return Zero on success, negative error code on failure.
 int dvrPoseClientPoll(DvrPoseClient* client, DvrPose* state);
 
+// Computes a predicted pose for a future display time by extrapolating the
+// newest sample published by the pose service.
+//
+// The DvrPose sample already carries the fitted motion model produced by
+// sensor fusion (velocity, acceleration and angular velocity), so the
+// prediction is a handful of multiplies over the shared memory ring: no RPC,
+// no allocation and no per-client filter state. All clients predicting for
+// the same display time compute the same pose.
+//
+// @param client Pointer to the pose client.
+// @param time_ns Absolute CLOCK_MONOTONIC time in nanoseconds to predict the
+//   pose for, typically when 50% of the frame's pixels are visible.
+// @param out_pose Struct to store the predicted state; timestamp_ns is set to
+//   time_ns.
+// @return Zero on success, negative error code on failure.
+int dvrPoseClientPredict(DvrPoseClient* client, int64_t time_ns,
+                         DvrPose* out_pose);
+
 // Freezes the pose to the provided state.
 //
 // Future poll operations will return this state until a different state is
@@ -4,6 +4,8 @@
 
 #include <stdint.h>
 
+#include <cmath>
+
 #include <log/log.h>
 #include <pdx/client.h>
 #include <pdx/default_transport/client_channel_factory.h>
@@ -27,6 +29,64 @@ namespace {
 typedef CPUMappedBroadcastRing<DvrPoseRing> SensorPoseRing;
 
 constexpr static int32_t MAX_CONTROLLERS = 2;
+
+// Cap on how far a sample may be extrapolated in either direction. Predicting
+// much past the next few frames amplifies sensor noise without bound.
+constexpr int64_t kMaxPredictionTimeNs = 100000000;  // 100 ms.
+
+// Extrapolates |sample| to |time_ns| using the motion model carried in the
+// sample: constant acceleration for position and constant angular velocity
+// for orientation.
+void PredictPose(const DvrPose& sample, int64_t time_ns, DvrPose* out_pose) {
+  int64_t dt_ns = time_ns - sample.timestamp_ns;
+  if (dt_ns > kMaxPredictionTimeNs)
+    dt_ns = kMaxPredictionTimeNs;
+  else if (dt_ns < -kMaxPredictionTimeNs)
+    dt_ns = -kMaxPredictionTimeNs;
+  const float dt = dt_ns * 1e-9f;
+
+  *out_pose = sample;
+  out_pose->timestamp_ns = time_ns;
+
+  for (int i = 0; i < 3; ++i) {
+    out_pose->position[i] = sample.position[i] + sample.velocity[i] * dt +
+                            0.5f * sample.acceleration[i] * dt * dt;
+    out_pose->velocity[i] = sample.velocity[i] + sample.acceleration[i] * dt;
+  }
+
+  // Integrate the start-space angular velocity into the orientation
+  // quaternion: q(t) = exp(w * dt / 2) * q(0). Lane order is x,y,z,w.
+  const float wx = sample.angular_velocity[0];
+  const float wy = sample.angular_velocity[1];
+  const float wz = sample.angular_velocity[2];
+  const float rate = std::sqrt(wx * wx + wy * wy + wz * wz);
+  const float angle = rate * dt;
+  if (rate > 0.0f && angle != 0.0f) {
+    const float half_sin = std::sin(0.5f * angle) / rate;
+    const float half_cos = std::cos(0.5f * angle);
+    const float dx = wx * half_sin;
+    const float dy = wy * half_sin;
+    const float dz = wz * half_sin;
+    const float qx = sample.orientation[0];
+    const float qy = sample.orientation[1];
+    const float qz = sample.orientation[2];
+    const float qw = sample.orientation[3];
+
+    float px = half_cos * qx + dx * qw + dy * qz - dz * qy;
+    float py = half_cos * qy - dx * qz + dy * qw + dz * qx;
+    float pz = half_cos * qz + dx * qy - dy * qx + dz * qw;
+    float pw = half_cos * qw - dx * qx - dy * qy - dz * qz;
+
+    const float norm = std::sqrt(px * px + py * py + pz * pz + pw * pw);
+    if (norm > 0.0f) {
+      out_pose->orientation[0] = px / norm;
+      out_pose->orientation[1] = py / norm;
+      out_pose->orientation[2] = pz / norm;
+      out_pose->orientation[3] = pw / norm;
+    }
+  }
+}
+
 }  // namespace
 
 // PoseClient is a remote interface to the pose service in sensord.
@@ -59,6 +119,30 @@ class PoseClient : public pdx::ClientBase<PoseClient> {
     return -EINVAL;
   }
 
+  // Predicts the pose for |time_ns| from the newest sample in the shared
+  // pose ring; see dvrPoseClientPredict(). Returns zero on success, a
+  // negative error code otherwise.
+  int Predict(int64_t time_ns, DvrPose* out_pose) {
+    if (!out_pose)
+      return -EINVAL;
+
+    // Refresh the cached sample if the service published a newer one. When no
+    // new sample arrived the previous one still carries the motion model to
+    // extrapolate from. Poll() may scribble on its output even when it fails,
+    // so it gets a scratch struct rather than the cached sample.
+    DvrPose sample;
+    const int ret = Poll(&sample);
+    if (ret == 0) {
+      last_pose_sample_ = sample;
+      have_pose_sample_ = true;
+    } else if (ret != -EAGAIN || !have_pose_sample_) {
+      return ret;
+    }
+
+    PredictPose(last_pose_sample_, time_ns, out_pose);
+    return 0;
+  }
+
   int GetPose(uint32_t vsync_count, DvrPoseAsync* out_pose) {
     const auto vsync_buffer = GetVsyncBuffer();
     if (vsync_buffer) {
@@ -294,6 +378,11 @@ class PoseClient : public pdx::ClientBase<PoseClient> {
     const DvrPoseAsync* mapped_pose_buffer = nullptr;
   };
   ControllerClientState controllers_[MAX_CONTROLLERS];
+
+  // The newest pose sample seen by Predict(), kept so that prediction can
+  // continue from the last motion model when no new sample is available yet.
+  DvrPose last_pose_sample_ = {};
+  bool have_pose_sample_ = false;
 };
 
 int dvrPoseClientGetDataReaderHandle(DvrPoseClient* client, uint64_t type,
@@ -340,6 +429,11 @@ int dvrPoseClientPoll(DvrPoseClient* client, DvrPose* state) {
   return PoseClient::FromC(client)->Poll(state);
 }
 
+int dvrPoseClientPredict(DvrPoseClient* client, int64_t time_ns,
+                         DvrPose* out_pose) {
+  return PoseClient::FromC(client)->Predict(time_ns, out_pose);
+}
+
 int dvrPoseClientFreeze(DvrPoseClient* client, const DvrPose* frozen_state) {
   return PoseClient::FromC(client)->Freeze(*frozen_state);
 }
@@ -54,6 +54,11 @@ BlobCache::BlobCache(size_t maxKeySize, size_t maxValueSize, size_t maxTotalSize
 
 void BlobCache::set(const void* key, size_t keySize, const void* value,
         size_t valueSize) {
+    setInternal(key, keySize, value, valueSize, true);
+}
+
+void BlobCache::setInternal(const void* key, size_t keySize, const void* value,
+        size_t valueSize, bool copyData) {
     if (mMaxKeySize < keySize) {
         ALOGV("set: not caching because the key is too large: %zu (limit: %zu)",
                 keySize, mMaxKeySize);
@@ -78,15 +83,14 @@ void BlobCache::set(const void* key, size_t keySize, const void* value,
         return;
     }
 
-    std::shared_ptr<Blob> dummyKey(new Blob(key, keySize, false));
-    CacheEntry dummyEntry(dummyKey, NULL);
+    const uint32_t hash = hashKey(key, keySize);
 
     while (true) {
-        auto index = std::lower_bound(mCacheEntries.begin(), mCacheEntries.end(), dummyEntry);
-        if (index == mCacheEntries.end() || dummyEntry < *index) {
+        ssize_t index = findEntry(key, keySize, hash);
+        if (index < 0) {
             // Create a new cache entry.
-            std::shared_ptr<Blob> keyBlob(new Blob(key, keySize, true));
-            std::shared_ptr<Blob> valueBlob(new Blob(value, valueSize, true));
+            std::shared_ptr<Blob> keyBlob(new Blob(key, keySize, copyData));
+            std::shared_ptr<Blob> valueBlob(new Blob(value, valueSize, copyData));
             size_t newTotalSize = mTotalSize + keySize + valueSize;
             if (mMaxTotalSize < newTotalSize) {
                 if (isCleanable()) {
@@ -101,14 +105,21 @@ void BlobCache::set(const void* key, size_t keySize, const void* value,
                     break;
                 }
             }
-            mCacheEntries.insert(index, CacheEntry(keyBlob, valueBlob));
+            mCacheEntries.push_back(CacheEntry(keyBlob, valueBlob));
+            // Keep the index at most 3/4 full, accounting for the entry
+            // just added.
+            if (mCacheEntries.size() * 4 > mIndexSlots.size() * 3) {
+                rebuildIndex(mCacheEntries.size());
+            } else {
+                indexInsert(hash, mCacheEntries.size() - 1);
+            }
             mTotalSize = newTotalSize;
             ALOGV("set: created new cache entry with %zu byte key and %zu byte value",
                     keySize, valueSize);
         } else {
             // Update the existing cache entry.
-            std::shared_ptr<Blob> valueBlob(new Blob(value, valueSize, true));
-            std::shared_ptr<Blob> oldValueBlob(index->getValue());
+            std::shared_ptr<Blob> valueBlob(new Blob(value, valueSize, copyData));
+            std::shared_ptr<Blob> oldValueBlob(mCacheEntries[index].getValue());
             size_t newTotalSize = mTotalSize + valueSize - oldValueBlob->getSize();
             if (mMaxTotalSize < newTotalSize) {
                 if (isCleanable()) {
@@ -122,7 +133,7 @@ void BlobCache::set(const void* key, size_t keySize, const void* value,
                     break;
                 }
             }
-            index->setValue(valueBlob);
+            mCacheEntries[index].setValue(valueBlob);
             mTotalSize = newTotalSize;
             ALOGV("set: updated existing cache entry with %zu byte key and %zu byte "
                     "value", keySize, valueSize);
@@ -138,17 +149,15 @@ size_t BlobCache::get(const void* key, size_t keySize, void* value,
                 keySize, mMaxKeySize);
         return 0;
     }
-    std::shared_ptr<Blob> dummyKey(new Blob(key, keySize, false));
-    CacheEntry dummyEntry(dummyKey, NULL);
-    auto index = std::lower_bound(mCacheEntries.begin(), mCacheEntries.end(), dummyEntry);
-    if (index == mCacheEntries.end() || dummyEntry < *index) {
+    ssize_t index = findEntry(key, keySize, hashKey(key, keySize));
+    if (index < 0) {
         ALOGV("get: no cache entry found for key of size %zu", keySize);
         return 0;
     }
 
     // The key was found. Return the value if the caller's buffer is large
     // enough.
-    std::shared_ptr<Blob> valueBlob(index->getValue());
+    std::shared_ptr<Blob> valueBlob(mCacheEntries[index].getValue());
     size_t valueBlobSize = valueBlob->getSize();
     if (valueBlobSize <= valueSize) {
         ALOGV("get: copying %zu bytes to caller's buffer", valueBlobSize);
@@ -224,9 +233,68 @@ int BlobCache::flatten(void* buffer, size_t size) const {
     return 0;
 }
 
-int BlobCache::unflatten(void const* buffer, size_t size) {
+uint32_t BlobCache::hashKey(const void* key, size_t keySize) {
+    // 32-bit FNV-1a over the key bytes.
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(key);
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < keySize; i++) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash;
+}
+
+ssize_t BlobCache::findEntry(const void* key, size_t keySize,
+        uint32_t hash) const {
+    if (mIndexSlots.empty()) {
+        return -1;
+    }
+    const size_t mask = mIndexSlots.size() - 1;
+    for (size_t slot = hash & mask; mIndexSlots[slot] != 0;
+            slot = (slot + 1) & mask) {
+        if (mIndexHashes[slot] != hash) {
+            continue;
+        }
+        size_t index = mIndexSlots[slot] - 1;
+        const std::shared_ptr<Blob> keyBlob(mCacheEntries[index].getKey());
+        if (keyBlob->getSize() == keySize &&
+                memcmp(keyBlob->getData(), key, keySize) == 0) {
+            return ssize_t(index);
+        }
+    }
+    return -1;
+}
+
+void BlobCache::indexInsert(uint32_t hash, size_t entryIndex) {
+    const size_t mask = mIndexSlots.size() - 1;
+    size_t slot = hash & mask;
+    while (mIndexSlots[slot] != 0) {
+        slot = (slot + 1) & mask;
+    }
+    mIndexSlots[slot] = uint32_t(entryIndex + 1);
+    mIndexHashes[slot] = hash;
+}
+
+void BlobCache::rebuildIndex(size_t entryCount) {
+    // Size the table so entryCount entries fill it at most 3/4 full, with a
+    // floor that avoids rebuilding again for the first handful of sets.
+    size_t capacity = 16;
+    while (entryCount * 4 > capacity * 3) {
+        capacity *= 2;
+    }
+    mIndexSlots.assign(capacity, 0);
+    mIndexHashes.assign(capacity, 0);
+    for (size_t i = 0; i < mCacheEntries.size(); i++) {
+        const std::shared_ptr<Blob> keyBlob(mCacheEntries[i].getKey());
+        indexInsert(hashKey(keyBlob->getData(), keyBlob->getSize()), i);
+    }
+}
+
+int BlobCache::unflatten(void const* buffer, size_t size, bool copyData) {
     // All errors should result in the BlobCache being in an empty state.
     mCacheEntries.clear();
+    mIndexSlots.clear();
+    mIndexHashes.clear();
+    mTotalSize = 0;
 
     // Read the cache header
     if (size < sizeof(Header)) {
@@ -255,6 +323,9 @@ int BlobCache::unflatten(void const* buffer, size_t size) {
     for (size_t i = 0; i < numEntries; i++) {
         if (byteOffset + sizeof(EntryHeader) > size) {
             mCacheEntries.clear();
+            mIndexSlots.clear();
+            mIndexHashes.clear();
+            mTotalSize = 0;
             ALOGE("unflatten: not enough room for cache entry headers");
             return -EINVAL;
         }
@@ -268,12 +339,15 @@ int BlobCache::unflatten(void const* buffer, size_t size) {
         size_t totalSize = align4(entrySize);
         if (byteOffset + totalSize > size) {
             mCacheEntries.clear();
+            mIndexSlots.clear();
+            mIndexHashes.clear();
+            mTotalSize = 0;
             ALOGE("unflatten: not enough room for cache entry headers");
             return -EINVAL;
         }
 
         const uint8_t* data = eheader->mData;
-        set(data, keySize, data + keySize, valueSize);
+        setInternal(data, keySize, data + keySize, valueSize, copyData);
 
         byteOffset += totalSize;
     }
@@ -291,13 +365,19 @@ long int BlobCache::blob_random() {
 
 void BlobCache::clean() {
     // Remove a random cache entry until the total cache size gets below half
-    // the maximum total cache size.
+    // the maximum total cache size. The entry vector is unordered, so the
+    // victim is swapped with the last entry before popping; the index is
+    // rebuilt once afterwards since entry positions have changed.
     while (mTotalSize > mMaxTotalSize / 2) {
         size_t i = size_t(blob_random() % (mCacheEntries.size()));
         const CacheEntry& entry(mCacheEntries[i]);
         mTotalSize -= entry.getKey()->getSize() + entry.getValue()->getSize();
-        mCacheEntries.erase(mCacheEntries.begin() + i);
+        if (i != mCacheEntries.size() - 1) {
+            mCacheEntries[i] = mCacheEntries.back();
+        }
+        mCacheEntries.pop_back();
     }
+    rebuildIndex(mCacheEntries.size());
 }
 
 bool BlobCache::isCleanable() const {
@@ -18,6 +18,8 @@
 #define ANDROID_BLOB_CACHE_H
 
 #include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
 
 #include <memory>
 #include <vector>
@@ -95,7 +97,11 @@ public:
     // unflattening the serialized cache contents then the BlobCache will be
     // left in an empty state.
     //
-    int unflatten(void const* buffer, size_t size);
+    // If copyData is false the cache keeps pointers into 'buffer' rather than
+    // copying the key and value bytes, making loads (and subsequent gets)
+    // zero-copy against a memory-mapped file.  The caller must then keep
+    // 'buffer' valid and unchanged for the lifetime of the BlobCache.
+    int unflatten(void const* buffer, size_t size, bool copyData = true);
 
 protected:
     // mMaxTotalSize is the maximum size that all cache entries can occupy. This
@@ -113,6 +119,27 @@ private:
     // A random function helper to get around MinGW not having nrand48()
     long int blob_random();
 
+    // setInternal is the implementation behind set and unflatten. When
+    // copyData is false the cache keeps pointers to the caller's key and
+    // value bytes instead of copying them.
+    void setInternal(const void* key, size_t keySize, const void* value,
+            size_t valueSize, bool copyData);
+
+    // hashKey computes the hash used by the entry index for a binary key.
+    static uint32_t hashKey(const void* key, size_t keySize);
+
+    // findEntry probes the index for the entry matching the given key and
+    // returns its position in mCacheEntries, or -1 if the key is absent.
+    ssize_t findEntry(const void* key, size_t keySize, uint32_t hash) const;
+
+    // indexInsert records an entry's position in the first free index slot
+    // of its probe sequence. The caller must have ensured enough capacity.
+    void indexInsert(uint32_t hash, size_t entryIndex);
+
+    // rebuildIndex resizes the index to hold entryCount entries at the
+    // target load factor and re-inserts every cache entry.
+    void rebuildIndex(size_t entryCount);
+
     // clean evicts a randomly chosen set of entries from the cache such that
     // the total size of all remaining entries is less than mMaxTotalSize/2.
     void clean();
@@ -237,8 +264,17 @@ private:
     unsigned short mRandState[3];
 
     // mCacheEntries stores all the cache entries that are resident in memory.
-    // Cache entries are added to it by the 'set' method.
+    // Cache entries are added to it by the 'set' method. The vector is
+    // unordered; lookups go through the open-addressing index below.
     std::vector<CacheEntry> mCacheEntries;
+
+    // Open-addressing (linear probing) hash index over mCacheEntries. The
+    // table size is always a power of two and kept at most 3/4 full.
+    // mIndexSlots holds the entry position biased by one (0 means an empty
+    // slot); mIndexHashes caches the key hash of each occupied slot so
+    // probing rarely has to touch the entry's key bytes.
+    std::vector<uint32_t> mIndexSlots;
+    std::vector<uint32_t> mIndexHashes;
 };
 
 }
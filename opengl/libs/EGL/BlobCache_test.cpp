@@ -290,6 +290,30 @@ protected:
     sp<BlobCache> mBC2;
 };
 
+TEST_F(BlobCacheFlattenTest, UnflattenZeroCopy) {
+    // With copyData == false the cache keeps pointers into the caller's
+    // buffer instead of copying the key and value bytes.
+    unsigned char buf[4] = { 0xee, 0xee, 0xee, 0xee };
+    mBC->set("abcd", 4, "efgh", 4);
+    size_t size = mBC->getFlattenedSize();
+    uint8_t* flat = new uint8_t[size];
+    ASSERT_EQ(OK, mBC->flatten(flat, size));
+    ASSERT_EQ(OK, mBC2->unflatten(flat, size, false));
+    ASSERT_EQ(size_t(4), mBC2->get("abcd", 4, buf, 4));
+    ASSERT_EQ('e', buf[0]);
+    ASSERT_EQ('f', buf[1]);
+    ASSERT_EQ('g', buf[2]);
+    ASSERT_EQ('h', buf[3]);
+
+    // Updating a zero-copy entry replaces the value with an owned copy.
+    mBC2->set("abcd", 4, "ijkl", 4);
+    ASSERT_EQ(size_t(4), mBC2->get("abcd", 4, buf, 4));
+    ASSERT_EQ('i', buf[0]);
+
+    mBC2.reset();
+    delete[] flat;
+}
+
 TEST_F(BlobCacheFlattenTest, FlattenOneValue) {
     unsigned char buf[4] = { 0xee, 0xee, 0xee, 0xee };
     mBC->set("abcd", 4, "efgh", 4);
@@ -22,11 +22,30 @@
 #include <sys/mman.h>
 #include <sys/stat.h>
 
+#include <vector>
+
 
 // Cache file header
 static const char* cacheFileMagic = "EGL$";
 static const size_t cacheFileHeaderSize = 8;
 
+// Journal entry record magic, 'EGLj'
+static const uint32_t journalEntryMagic =
+        ('j' << 24) + ('L' << 16) + ('G' << 8) + 'E';
+
+// A JournalEntryHeader precedes the key and value bytes of every record in
+// the journal file. Records are padded to a 4-byte boundary.
+struct JournalEntryHeader {
+    uint32_t mMagic;
+    uint32_t mCrc;       // crc32c of the key and value bytes
+    uint32_t mKeySize;
+    uint32_t mValueSize;
+};
+
+static inline size_t align4(size_t size) {
+    return (size + 3) & ~3;
+}
+
 namespace android {
 
 static uint32_t crc32c(const uint8_t* buf, size_t len) {
@@ -48,69 +67,211 @@ static uint32_t crc32c(const uint8_t* buf, size_t len) {
 FileBlobCache::FileBlobCache(size_t maxKeySize, size_t maxValueSize, size_t maxTotalSize,
         const std::string& filename)
         : BlobCache(maxKeySize, maxValueSize, maxTotalSize)
-        , mFilename(filename) {
+        , mFilename(filename)
+        , mJournalFd(-1)
+        , mJournalBytes(0)
+        , mBuffer(NULL)
+        , mBufferSize(0) {
     if (mFilename.length() > 0) {
-        size_t headerSize = cacheFileHeaderSize;
+        loadCacheFile();
+        replayJournal();
+    }
+}
 
-        int fd = open(mFilename.c_str(), O_RDONLY, 0);
-        if (fd == -1) {
-            if (errno != ENOENT) {
-                ALOGE("error opening cache file %s: %s (%d)", mFilename.c_str(),
-                        strerror(errno), errno);
-            }
-            return;
+void FileBlobCache::loadCacheFile() {
+    size_t headerSize = cacheFileHeaderSize;
+
+    int fd = open(mFilename.c_str(), O_RDONLY, 0);
+    if (fd == -1) {
+        if (errno != ENOENT) {
+            ALOGE("error opening cache file %s: %s (%d)", mFilename.c_str(),
+                    strerror(errno), errno);
         }
+        return;
+    }
+
+    struct stat statBuf;
+    if (fstat(fd, &statBuf) == -1) {
+        ALOGE("error stat'ing cache file: %s (%d)", strerror(errno), errno);
+        close(fd);
+        return;
+    }
+
+    // Sanity check the size before trying to mmap it.
+    size_t fileSize = statBuf.st_size;
+    if (fileSize > mMaxTotalSize * 2) {
+        ALOGE("cache file is too large: %#" PRIx64,
+              static_cast<off64_t>(statBuf.st_size));
+        close(fd);
+        return;
+    }
+
+    uint8_t* buf = reinterpret_cast<uint8_t*>(mmap(NULL, fileSize,
+            PROT_READ, MAP_PRIVATE, fd, 0));
+    if (buf == MAP_FAILED) {
+        ALOGE("error mmaping cache file: %s (%d)", strerror(errno),
+                errno);
+        close(fd);
+        return;
+    }
+
+    // Check the file magic and CRC
+    size_t cacheSize = fileSize - headerSize;
+    if (memcmp(buf, cacheFileMagic, 4) != 0) {
+        ALOGE("cache file has bad mojo");
+        munmap(buf, fileSize);
+        close(fd);
+        return;
+    }
+    uint32_t* crc = reinterpret_cast<uint32_t*>(buf + 4);
+    if (crc32c(buf + headerSize, cacheSize) != *crc) {
+        ALOGE("cache file failed CRC check");
+        munmap(buf, fileSize);
+        close(fd);
+        return;
+    }
+
+    // Load the entries zero-copy: they point straight into the mapping,
+    // which is kept alive until the FileBlobCache is destroyed.
+    int err = unflatten(buf + headerSize, cacheSize, false /* copyData */);
+    if (err < 0) {
+        ALOGE("error reading cache contents: %s (%d)", strerror(-err),
+                -err);
+        munmap(buf, fileSize);
+        close(fd);
+        return;
+    }
+
+    mBuffer = buf;
+    mBufferSize = fileSize;
+    close(fd);
+}
+
+FileBlobCache::~FileBlobCache() {
+    if (mJournalFd >= 0) {
+        close(mJournalFd);
+    }
+    if (mBuffer) {
+        munmap(mBuffer, mBufferSize);
+    }
+}
+
+std::string FileBlobCache::journalFilename() const {
+    return mFilename + ".journal";
+}
 
+size_t FileBlobCache::appendJournalEntry(const void* key, size_t keySize,
+        const void* value, size_t valueSize) {
+    if (mFilename.length() == 0) {
+        return 0;
+    }
+    if (mJournalFd < 0) {
+        mJournalFd = open(journalFilename().c_str(),
+                O_CREAT | O_WRONLY | O_APPEND, S_IRUSR | S_IWUSR);
+        if (mJournalFd < 0) {
+            ALOGE("error opening journal file %s: %s (%d)",
+                    journalFilename().c_str(), strerror(errno), errno);
+            return 0;
+        }
         struct stat statBuf;
-        if (fstat(fd, &statBuf) == -1) {
-            ALOGE("error stat'ing cache file: %s (%d)", strerror(errno), errno);
-            close(fd);
-            return;
+        if (fstat(mJournalFd, &statBuf) == 0) {
+            mJournalBytes = statBuf.st_size;
         }
+    }
 
-        // Sanity check the size before trying to mmap it.
-        size_t fileSize = statBuf.st_size;
-        if (fileSize > mMaxTotalSize * 2) {
-            ALOGE("cache file is too large: %#" PRIx64,
-                  static_cast<off64_t>(statBuf.st_size));
-            close(fd);
-            return;
+    size_t entrySize = sizeof(JournalEntryHeader) + keySize + valueSize;
+    size_t totalSize = align4(entrySize);
+    std::vector<uint8_t> buf(totalSize, 0);
+    JournalEntryHeader* header = reinterpret_cast<JournalEntryHeader*>(buf.data());
+    header->mMagic = journalEntryMagic;
+    header->mKeySize = uint32_t(keySize);
+    header->mValueSize = uint32_t(valueSize);
+    uint8_t* data = buf.data() + sizeof(JournalEntryHeader);
+    memcpy(data, key, keySize);
+    memcpy(data + keySize, value, valueSize);
+    header->mCrc = crc32c(data, keySize + valueSize);
+
+    if (write(mJournalFd, buf.data(), totalSize) !=
+            static_cast<ssize_t>(totalSize)) {
+        // A short or failed write leaves a corrupt tail; replay stops there
+        // and truncates, so older records stay usable.
+        ALOGE("error writing journal entry: %s (%d)", strerror(errno), errno);
+        close(mJournalFd);
+        mJournalFd = -1;
+        return mJournalBytes;
+    }
+    mJournalBytes += totalSize;
+    return mJournalBytes;
+}
+
+void FileBlobCache::replayJournal() {
+    int fd = open(journalFilename().c_str(), O_RDONLY, 0);
+    if (fd == -1) {
+        if (errno != ENOENT) {
+            ALOGE("error opening journal file %s: %s (%d)",
+                    journalFilename().c_str(), strerror(errno), errno);
         }
+        return;
+    }
 
-        uint8_t* buf = reinterpret_cast<uint8_t*>(mmap(NULL, fileSize,
-                PROT_READ, MAP_PRIVATE, fd, 0));
-        if (buf == MAP_FAILED) {
-            ALOGE("error mmaping cache file: %s (%d)", strerror(errno),
-                    errno);
-            close(fd);
-            return;
+    struct stat statBuf;
+    if (fstat(fd, &statBuf) == -1) {
+        ALOGE("error stat'ing journal file: %s (%d)", strerror(errno), errno);
+        close(fd);
+        return;
+    }
+
+    size_t size = statBuf.st_size;
+    if (size == 0 || size > mMaxTotalSize * 2) {
+        close(fd);
+        if (size != 0) {
+            ALOGE("journal file is too large: %#" PRIx64,
+                  static_cast<off64_t>(statBuf.st_size));
+            unlink(journalFilename().c_str());
         }
+        return;
+    }
 
-        // Check the file magic and CRC
-        size_t cacheSize = fileSize - headerSize;
-        if (memcmp(buf, cacheFileMagic, 4) != 0) {
-            ALOGE("cache file has bad mojo");
-            close(fd);
-            return;
+    std::vector<uint8_t> buf(size);
+    if (read(fd, buf.data(), size) != static_cast<ssize_t>(size)) {
+        ALOGE("error reading journal file: %s (%d)", strerror(errno), errno);
+        close(fd);
+        return;
+    }
+    close(fd);
+
+    size_t offset = 0;
+    size_t valid = 0;
+    while (offset + sizeof(JournalEntryHeader) <= size) {
+        const JournalEntryHeader* header =
+                reinterpret_cast<const JournalEntryHeader*>(&buf[offset]);
+        if (header->mMagic != journalEntryMagic) {
+            break;
         }
-        uint32_t* crc = reinterpret_cast<uint32_t*>(buf + 4);
-        if (crc32c(buf + headerSize, cacheSize) != *crc) {
-            ALOGE("cache file failed CRC check");
-            close(fd);
-            return;
+        size_t keySize = header->mKeySize;
+        size_t valueSize = header->mValueSize;
+        size_t totalSize = align4(sizeof(JournalEntryHeader) + keySize + valueSize);
+        if (offset + totalSize > size) {
+            break;
         }
-
-        int err = unflatten(buf + headerSize, cacheSize);
-        if (err < 0) {
-            ALOGE("error reading cache contents: %s (%d)", strerror(-err),
-                    -err);
-            munmap(buf, fileSize);
-            close(fd);
-            return;
+        const uint8_t* data = &buf[offset] + sizeof(JournalEntryHeader);
+        if (crc32c(data, keySize + valueSize) != header->mCrc) {
+            break;
         }
+        set(data, keySize, data + keySize, valueSize);
+        offset += totalSize;
+        valid = offset;
+    }
 
-        munmap(buf, fileSize);
-        close(fd);
+    if (valid != size) {
+        // Drop the corrupt tail so future appends start from a good record
+        // boundary.
+        ALOGE("journal file has a corrupt tail, keeping %zu of %zu bytes",
+                valid, size);
+        if (truncate(journalFilename().c_str(), valid) == -1) {
+            ALOGE("error truncating journal file: %s (%d)", strerror(errno),
+                    errno);
+        }
     }
 }
 
@@ -180,6 +341,15 @@ void FileBlobCache::writeToFile() {
         delete [] buf;
         fchmod(fd, S_IRUSR);
         close(fd);
+
+        // The journal only covers entries newer than the cache file; after
+        // a successful full write it is obsolete.
+        if (mJournalFd >= 0) {
+            close(mJournalFd);
+            mJournalFd = -1;
+        }
+        unlink(journalFilename().c_str());
+        mJournalBytes = 0;
     }
 }
 
@@ -25,17 +25,57 @@ namespace android {
 class FileBlobCache : public BlobCache {
 public:
     // FileBlobCache attempts to load the saved cache contents from disk into
-    // BlobCache.
+    // BlobCache. The cache file stays memory-mapped for the lifetime of the
+    // FileBlobCache and loaded entries reference the mapping directly, so
+    // loading does not copy the key and value data.
     FileBlobCache(size_t maxKeySize, size_t maxValueSize, size_t maxTotalSize,
             const std::string& filename);
 
+    ~FileBlobCache();
+
     // writeToFile attempts to save the current contents of BlobCache to
-    // disk.
+    // disk. On success the side journal is deleted, since the file now
+    // covers every entry.
     void writeToFile();
 
+    // appendJournalEntry appends a single key/value pair to a journal file
+    // kept next to the cache file, creating it if needed, and returns the
+    // journal's size in bytes afterwards. Journaled entries are replayed on
+    // top of the cache file contents at load time, so newly inserted
+    // entries can be persisted without rewriting the whole cache file.
+    size_t appendJournalEntry(const void* key, size_t keySize,
+            const void* value, size_t valueSize);
+
 private:
+    // loadCacheFile memory-maps the cache file and loads its entries.
+    void loadCacheFile();
+
+    // replayJournal inserts any journaled entries on top of the freshly
+    // loaded cache contents, stopping at the first corrupt record and
+    // discarding everything after it.
+    void replayJournal();
+
+    // journalFilename returns the name of the journal file, derived from
+    // mFilename.
+    std::string journalFilename() const;
+
     // mFilename is the name of the file for storing cache contents.
     std::string mFilename;
+
+    // mJournalFd is the file descriptor used to append journal entries, or
+    // -1 if the journal has not been opened for writing yet.
+    int mJournalFd;
+
+    // mJournalBytes is the current size of the journal file in bytes.
+    size_t mJournalBytes;
+
+    // mBuffer is the memory-mapped contents of the cache file loaded at
+    // construction time, or NULL if no file was loaded. It must stay mapped
+    // as long as cache entries point into it.
+    uint8_t* mBuffer;
+
+    // mBufferSize is the size of the mapping at mBuffer in bytes.
+    size_t mBufferSize;
 };
 
 } // namespace android
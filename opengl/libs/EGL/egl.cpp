@@ -30,6 +30,7 @@
 #include "egl_tls.h"
 #include "egl_display.h"
 #include "egl_object.h"
+#include "egl_trace.h"
 #include "CallStack.h"
 #include "Loader.h"
 
@@ -47,6 +48,13 @@ pthread_key_t gGLWrapperKey = -1;
 // ----------------------------------------------------------------------------
 
 void setGLHooksThreadSpecific(gl_hooks_t const *value) {
+    // In ring trace mode (debug.egl.trace=ring), real context hook tables
+    // are diverted through the generated trace wrappers; the no-context
+    // table keeps its fatal-error behavior.
+    if (value == &gHooks[egl_connection_t::GLESv1_INDEX] ||
+            value == &gHooks[egl_connection_t::GLESv2_INDEX]) {
+        value = GLTrace::installHooks(value);
+    }
     setGlThreadSpecific(value);
 }
 
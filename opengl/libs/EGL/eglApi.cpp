@@ -236,6 +236,13 @@ static const extention_map_t sExtensionMap[] = {
             (__eglMustCastToProperFunctionPointerType)&eglDupNativeFenceFDANDROID },
 };
 
+// Perfect hash over the names above, generated by tools/genprochash.
+#include "egl_ext_hash.h"
+
+static_assert(sizeof(sExtensionMap) / sizeof(sExtensionMap[0]) == kExtensionHashCount,
+        "sExtensionMap changed; rerun opengl/libs/tools/genfiles to "
+        "regenerate egl_ext_hash.h");
+
 /*
  * These extensions entry-points should not be exposed to applications.
  * They're used internally by the Android EGL layer.
@@ -253,10 +260,11 @@ static pthread_mutex_t sExtensionMapMutex = PTHREAD_MUTEX_INITIALIZER;
 
 static void(*findProcAddress(const char* name,
         const extention_map_t* map, size_t n))() {
-    for (uint32_t i=0 ; i<n ; i++) {
-        if (!strcmp(name, map[i].name)) {
-            return map[i].address;
-        }
+    // The generated hash maps a name to at most one candidate entry, so a
+    // lookup is one hash plus one strcmp instead of a scan of the table.
+    size_t i = kExtensionHashTable[extensionHashSlot(name)];
+    if (i < n && !strcmp(name, map[i].name)) {
+        return map[i].address;
     }
     return NULL;
 }
@@ -1272,6 +1280,7 @@ __eglMustCastToProperFunctionPointerType eglGetProcAddress(const char *procname)
             if (cnx->dso && cnx->egl.eglGetProcAddress) {
                 // Extensions are independent of the bound context
                 addr =
+                gHooksTrace.ext.extensions[slot] =
                 cnx->hooks[egl_connection_t::GLESv1_INDEX]->ext.extensions[slot] =
                 cnx->hooks[egl_connection_t::GLESv2_INDEX]->ext.extensions[slot] =
                         cnx->egl.eglGetProcAddress(procname);
@@ -26,6 +26,7 @@
 
 #include <thread>
 
+#include <cutils/properties.h>
 #include <log/log.h>
 
 // Cache size limits.
@@ -33,8 +34,14 @@ static const size_t maxKeySize = 12 * 1024;
 static const size_t maxValueSize = 64 * 1024;
 static const size_t maxTotalSize = 2 * 1024 * 1024;
 
-// The time in seconds to wait before saving newly inserted cache entries.
-static const unsigned int deferredSaveDelay = 4;
+// Size limit for the optional system-wide shared cache segment. It holds
+// entries aggregated across apps, so it is allowed to be larger than a
+// per-app cache.
+static const size_t maxSharedTotalSize = 8 * 1024 * 1024;
+
+// The journal size above which the writer thread compacts the journal into
+// the cache file.
+static const size_t maxJournalSize = 256 * 1024;
 
 // ----------------------------------------------------------------------------
 namespace android {
@@ -64,10 +71,20 @@ static EGLsizeiANDROID getBlob(const void* key, EGLsizeiANDROID keySize,
 // egl_cache_t definition
 //
 egl_cache_t::egl_cache_t() :
-        mInitialized(false) {
+        mInitialized(false),
+        mSharedCacheChecked(false),
+        mWriterExit(false) {
 }
 
 egl_cache_t::~egl_cache_t() {
+    { // acquire lock
+        std::lock_guard<std::mutex> lock(mMutex);
+        mWriterExit = true;
+    }
+    mWriterCond.notify_all();
+    if (mWriterThread.joinable()) {
+        mWriterThread.join();
+    }
 }
 
 egl_cache_t egl_cache_t::sCache;
@@ -115,11 +132,30 @@ void egl_cache_t::initialize(egl_display_t *display) {
 }
 
 void egl_cache_t::terminate() {
+    // Stop the writer thread first so it can't touch mBlobCache while the
+    // cache is being written out and destroyed below.
+    { // acquire lock
+        std::lock_guard<std::mutex> lock(mMutex);
+        mWriterExit = true;
+    }
+    mWriterCond.notify_all();
+    if (mWriterThread.joinable()) {
+        mWriterThread.join();
+    }
+
     std::lock_guard<std::mutex> lock(mMutex);
+    mWriterExit = false;
+    mWriterThread = std::thread();
+    // Entries still queued for the journal are covered by the full write.
+    mPendingWrites.clear();
     if (mBlobCache) {
         mBlobCache->writeToFile();
     }
     mBlobCache = NULL;
+    // Drop the shared segment too so a segment published while this process
+    // ran is picked up on the next initialize.
+    mSharedBlobCache = NULL;
+    mSharedCacheChecked = false;
 }
 
 void egl_cache_t::setBlob(const void* key, EGLsizeiANDROID keySize,
@@ -135,17 +171,58 @@ void egl_cache_t::setBlob(const void* key, EGLsizeiANDROID keySize,
         BlobCache* bc = getBlobCacheLocked();
         bc->set(key, keySize, value, valueSize);
 
-        if (!mSavePending) {
-            mSavePending = true;
-            std::thread deferredSaveThread([this]() {
-                sleep(deferredSaveDelay);
-                std::lock_guard<std::mutex> lock(mMutex);
-                if (mInitialized && mBlobCache) {
-                    mBlobCache->writeToFile();
-                }
-                mSavePending = false;
-            });
-            deferredSaveThread.detach();
+        // Queue the entry for the writer thread, which appends it to the
+        // cache journal without holding mMutex across the file write.
+        // Entries the cache rejects as oversized are not worth journaling.
+        if (mFilename.length() > 0 &&
+                size_t(keySize) <= maxKeySize &&
+                size_t(valueSize) <= maxValueSize) {
+            const uint8_t* k = reinterpret_cast<const uint8_t*>(key);
+            const uint8_t* v = reinterpret_cast<const uint8_t*>(value);
+            mPendingWrites.push_back(PendingWrite{
+                    std::vector<uint8_t>(k, k + keySize),
+                    std::vector<uint8_t>(v, v + valueSize)});
+            if (!mWriterThread.joinable()) {
+                mWriterThread = std::thread(&egl_cache_t::writerLoop, this);
+            }
+            mWriterCond.notify_one();
+        }
+    }
+}
+
+void egl_cache_t::writerLoop() {
+    std::unique_lock<std::mutex> lock(mMutex);
+    while (true) {
+        while (!mWriterExit && mPendingWrites.empty()) {
+            mWriterCond.wait(lock);
+        }
+        if (mWriterExit) {
+            break;
+        }
+
+        std::vector<PendingWrite> batch(std::move(mPendingWrites));
+        mPendingWrites.clear();
+        FileBlobCache* bc = mBlobCache.get();
+        if (bc == nullptr) {
+            continue;
+        }
+
+        // Append with the lock dropped so setBlob/getBlob callers never
+        // wait on file I/O. mBlobCache cannot go away while unlocked:
+        // terminate() joins this thread before destroying it.
+        lock.unlock();
+        size_t journalBytes = 0;
+        for (const PendingWrite& e : batch) {
+            journalBytes = bc->appendJournalEntry(e.key.data(), e.key.size(),
+                    e.value.data(), e.value.size());
+        }
+        lock.lock();
+
+        // Periodic compaction: fold the journal into the cache file once it
+        // outgrows the threshold. This is the only time the writer holds
+        // the mutex across file I/O, and it is rare and bounded.
+        if (journalBytes > maxJournalSize && mBlobCache) {
+            mBlobCache->writeToFile();
         }
     }
 }
@@ -160,6 +237,16 @@ EGLsizeiANDROID egl_cache_t::getBlob(const void* key, EGLsizeiANDROID keySize,
     }
 
     if (mInitialized) {
+        // Consult the optional system-wide segment first: entries published
+        // there were compiled once on behalf of every process. Misses fall
+        // through to the per-app cache, and writes only ever go there.
+        FileBlobCache* shared = getSharedBlobCacheLocked();
+        if (shared != nullptr) {
+            EGLsizeiANDROID ret = shared->get(key, keySize, value, valueSize);
+            if (ret > 0) {
+                return ret;
+            }
+        }
         BlobCache* bc = getBlobCacheLocked();
         return bc->get(key, keySize, value, valueSize);
     }
@@ -178,6 +265,24 @@ BlobCache* egl_cache_t::getBlobCacheLocked() {
     return mBlobCache.get();
 }
 
+FileBlobCache* egl_cache_t::getSharedBlobCacheLocked() {
+    if (!mSharedCacheChecked) {
+        mSharedCacheChecked = true;
+        char path[PROPERTY_VALUE_MAX];
+        property_get("ro.egl.blobcache.shared_path", path, "");
+        if (path[0] != '\0') {
+            // The segment is loaded through FileBlobCache, so entries
+            // reference the read-only mapping directly and all processes
+            // share the same page cache pages. A publisher replacing the
+            // file via rename doesn't affect this mapping; the new contents
+            // are picked up on the next initialize.
+            mSharedBlobCache.reset(new FileBlobCache(maxKeySize, maxValueSize,
+                    maxSharedTotalSize, path));
+        }
+    }
+    return mSharedBlobCache.get();
+}
+
 // ----------------------------------------------------------------------------
 }; // namespace android
 // ----------------------------------------------------------------------------
@@ -22,9 +22,12 @@
 
 #include "FileBlobCache.h"
 
+#include <condition_variable>
 #include <memory>
 #include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
 
 // ----------------------------------------------------------------------------
 namespace android {
@@ -82,6 +85,12 @@ private:
     // possible.
     BlobCache* getBlobCacheLocked();
 
+    // getSharedBlobCacheLocked returns the optional system-wide read-only
+    // cache segment named by ro.egl.blobcache.shared_path, loading it on
+    // first use. Returns NULL when the property is unset or nothing could
+    // be loaded.
+    FileBlobCache* getSharedBlobCacheLocked();
+
     // mInitialized indicates whether the egl_cache_t is in the initialized
     // state.  It is initialized to false at construction time, and gets set to
     // true when initialize is called.  It is set back to false when terminate
@@ -95,6 +104,18 @@ private:
     // first time it's needed.
     std::unique_ptr<FileBlobCache> mBlobCache;
 
+    // mSharedBlobCache is the optional read-only cache segment shared by
+    // every process on the device. It is published by a system component
+    // (and replaced atomically via rename), consulted by getBlob before the
+    // per-app cache, and never written back to; setBlob still goes to the
+    // per-app cache only.
+    std::unique_ptr<FileBlobCache> mSharedBlobCache;
+
+    // mSharedCacheChecked records whether the shared cache property has
+    // already been probed, so a device without a shared segment pays the
+    // property lookup only once.
+    bool mSharedCacheChecked;
+
     // mFilename is the name of the file for storing cache contents in between
     // program invocations.  It is initialized to an empty string at
     // construction time, and can be set with the setCacheFilename method.  An
@@ -102,12 +123,33 @@ private:
     // from disk.
     std::string mFilename;
 
-    // mSavePending indicates whether or not a deferred save operation is
-    // pending.  Each time a key/value pair is inserted into the cache via
-    // setBlob, a deferred save is initiated if one is not already pending.
-    // This will wait some amount of time and then trigger a save of the cache
-    // contents to disk.
-    bool mSavePending;
+    // writerLoop is the body of mWriterThread. It appends queued entries to
+    // the cache journal with the mutex dropped, so GL and binder threads
+    // calling setBlob never wait on file I/O, and compacts the journal into
+    // the cache file once it grows past a threshold.
+    void writerLoop();
+
+    // A PendingWrite holds a copy of an entry inserted via setBlob until the
+    // writer thread has appended it to the journal.
+    struct PendingWrite {
+        std::vector<uint8_t> key;
+        std::vector<uint8_t> value;
+    };
+
+    // mPendingWrites is the queue of entries awaiting the writer thread.
+    std::vector<PendingWrite> mPendingWrites;
+
+    // mWriterThread is the dedicated persistence thread. It is started
+    // lazily by the first setBlob with a cache filename set, and joined by
+    // terminate and the destructor.
+    std::thread mWriterThread;
+
+    // mWriterCond signals the writer thread that entries were queued or
+    // that mWriterExit was set.
+    std::condition_variable mWriterCond;
+
+    // mWriterExit asks the writer thread to exit. Protected by mMutex.
+    bool mWriterExit;
 
     // mMutex is the mutex used to prevent concurrent access to the member
     // variables. It must be locked whenever the member variables are accessed.
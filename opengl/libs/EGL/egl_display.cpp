@@ -94,17 +94,17 @@ egl_display_t* egl_display_t::get(EGLDisplay dpy) {
 }
 
 void egl_display_t::addObject(egl_object_t* object) {
-    std::lock_guard<std::mutex> _l(lock);
+    std::lock_guard<std::mutex> _l(objectsLock);
     objects.insert(object);
 }
 
 void egl_display_t::removeObject(egl_object_t* object) {
-    std::lock_guard<std::mutex> _l(lock);
+    std::lock_guard<std::mutex> _l(objectsLock);
     objects.erase(object);
 }
 
 bool egl_display_t::getObject(egl_object_t* object) const {
-    std::lock_guard<std::mutex> _l(lock);
+    std::lock_guard<std::mutex> _l(objectsLock);
     if (objects.find(object) != objects.end()) {
         if (object->getDisplay() == this) {
             object->incRef();
@@ -324,17 +324,21 @@ EGLBoolean egl_display_t::terminate() {
         // reinitialized.
         mExtensionString.clear();
 
-        // Mark all objects remaining in the list as terminated, unless
-        // there are no reference to them, it which case, we're free to
-        // delete them.
-        size_t count = objects.size();
-        ALOGW_IF(count, "eglTerminate() called w/ %zu objects remaining", count);
-        for (auto o : objects) {
-            o->destroy();
-        }
+        { // scope for objectsLock
+            std::lock_guard<std::mutex> _ol(objectsLock);
 
-        // this marks all object handles are "terminated"
-        objects.clear();
+            // Mark all objects remaining in the list as terminated, unless
+            // there are no reference to them, it which case, we're free to
+            // delete them.
+            size_t count = objects.size();
+            ALOGW_IF(count, "eglTerminate() called w/ %zu objects remaining", count);
+            for (auto o : objects) {
+                o->destroy();
+            }
+
+            // this marks all object handles are "terminated"
+            objects.clear();
+        }
     }
 
     { // scope for refLock
@@ -120,9 +120,16 @@ private:
 
             uint32_t                    refs;
             bool                        eglIsInitialized;
+    // lock protects structural state changes: initialization, termination
+    // and current-binding updates. It is not taken to validate objects.
     mutable std::mutex                  lock;
     mutable std::mutex                  refLock;
     mutable std::condition_variable     refCond;
+    // objectsLock protects the object table only. Every EGL call that
+    // takes a surface or context validates it against this table, so the
+    // table gets its own lock instead of contending with the driver calls
+    // made under lock (eglMakeCurrent in particular).
+    mutable std::mutex                  objectsLock;
             std::unordered_set<egl_object_t*> objects;
             std::string mVendorString;
             std::string mVersionString;
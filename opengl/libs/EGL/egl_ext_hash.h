@@ -0,0 +1,50 @@
+/*
+ ** Copyright 2018, The Android Open Source Project
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **     http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+
+// Generated by opengl/libs/tools/genprochash from the sExtensionMap table
+// in eglApi.cpp. Do not edit; rerun tools/genfiles after changing the map.
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Minimal perfect hash for the 34 entry points in sExtensionMap. Every
+// name hashes to at most one candidate index; the caller must confirm the
+// match with strcmp before using it.
+
+static const size_t kExtensionHashCount = 34;
+static const size_t kExtensionHashSize = 128;
+static const uint32_t kExtensionHashSeed = 30;
+
+// Index into sExtensionMap, or 255 for an empty slot.
+static const uint8_t kExtensionHashTable[128] = {
+     22, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255,  17, 255, 255, 255, 255, 255, 255, 255, 255,
+     27, 255, 255, 255,  13, 255, 255, 255, 255, 255, 255, 255,   4,   7, 255, 255,
+    255, 255, 255,  24,  20, 255,   9,  25, 255, 255, 255, 255, 255, 255,  33,  16,
+     12,   2, 255, 255,  14, 255, 255, 255,  19,  15,  26,   3, 255, 255,  30, 255,
+     11, 255, 255, 255,  18, 255, 255, 255, 255, 255,  31, 255, 255, 255,   5, 255,
+    255, 255, 255,   8, 255, 255,  21,   6, 255,  32,  29, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255,  28,  23, 255, 255, 255,   1, 255, 255, 255,   0,  10,
+};
+
+// Returns the slot in kExtensionHashTable for an entry point name.
+static inline size_t extensionHashSlot(const char* name) {
+    uint32_t hash = kExtensionHashSeed;
+    while (*name) {
+        hash = (hash ^ uint8_t(*name++)) * 16777619u;
+    }
+    return ((hash >> 16) ^ hash) & (kExtensionHashSize - 1);
+}
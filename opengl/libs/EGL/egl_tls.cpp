@@ -27,6 +27,12 @@ namespace android {
 pthread_key_t egl_tls_t::sKey = TLS_KEY_NOT_INITIALIZED;
 pthread_once_t egl_tls_t::sOnceKey = PTHREAD_ONCE_INIT;
 
+// The per-thread state is reached through an ELF TLS pointer, which makes
+// getError/getContext a direct load instead of a pthread_getspecific call
+// on every EGL entry point. The pthread key is still created, but only so
+// that eglReleaseThread runs when a thread exits.
+static __thread egl_tls_t* gTls = nullptr;
+
 egl_tls_t::egl_tls_t()
     : error(EGL_SUCCESS), ctx(0), logCallWithNoContext(true) {
 }
@@ -64,7 +70,6 @@ void egl_tls_t::validateTLSKey()
 
 void egl_tls_t::setErrorEtcImpl(
         const char* caller, int line, EGLint error, bool quiet) {
-    validateTLSKey();
     egl_tls_t* tls = getTLS();
     if (tls->error != error) {
         if (!quiet) {
@@ -91,21 +96,26 @@ bool egl_tls_t::logNoContextCall() {
 }
 
 egl_tls_t* egl_tls_t::getTLS() {
-    egl_tls_t* tls = (egl_tls_t*)pthread_getspecific(sKey);
-    if (tls == 0) {
+    egl_tls_t* tls = gTls;
+    if (tls == nullptr) {
+        validateTLSKey();
         tls = new egl_tls_t;
+        gTls = tls;
+        // the key's value is never read back; it exists so the destructor
+        // registered by validateTLSKey runs at thread exit.
         pthread_setspecific(sKey, tls);
     }
     return tls;
 }
 
 void egl_tls_t::clearTLS() {
-    if (sKey != TLS_KEY_NOT_INITIALIZED) {
-        egl_tls_t* tls = (egl_tls_t*)pthread_getspecific(sKey);
-        if (tls) {
-            pthread_setspecific(sKey, 0);
-            delete tls;
+    egl_tls_t* tls = gTls;
+    if (tls) {
+        gTls = nullptr;
+        if (sKey != TLS_KEY_NOT_INITIALIZED) {
+            pthread_setspecific(sKey, nullptr);
         }
+        delete tls;
     }
 }
 
@@ -116,10 +126,7 @@ void egl_tls_t::clearError() {
 }
 
 EGLint egl_tls_t::getError() {
-    if (sKey == TLS_KEY_NOT_INITIALIZED) {
-        return EGL_SUCCESS;
-    }
-    egl_tls_t* tls = (egl_tls_t*)pthread_getspecific(sKey);
+    egl_tls_t* tls = gTls;
     if (!tls) {
         return EGL_SUCCESS;
     }
@@ -129,15 +136,11 @@ EGLint egl_tls_t::getError() {
 }
 
 void egl_tls_t::setContext(EGLContext ctx) {
-    validateTLSKey();
     getTLS()->ctx = ctx;
 }
 
 EGLContext egl_tls_t::getContext() {
-    if (sKey == TLS_KEY_NOT_INITIALIZED) {
-        return EGL_NO_CONTEXT;
-    }
-    egl_tls_t* tls = (egl_tls_t *)pthread_getspecific(sKey);
+    egl_tls_t* tls = gTls;
     if (!tls) return EGL_NO_CONTEXT;
     return tls->ctx;
 }
@@ -29,6 +29,8 @@ class DbgContext;
 
 class egl_tls_t {
     enum { TLS_KEY_NOT_INITIALIZED = -1 };
+    // sKey is only used to run eglReleaseThread at thread exit; the state
+    // itself is reached through an ELF TLS pointer in egl_tls.cpp.
     static pthread_key_t sKey;
     static pthread_once_t sOnceKey;
 
@@ -0,0 +1,232 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define ATRACE_TAG ATRACE_TAG_GRAPHICS
+
+#include "egl_trace.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <cutils/properties.h>
+#include <log/log.h>
+
+#include "egldefs.h"
+
+namespace android {
+
+// ----------------------------------------------------------------------------
+// Per-thread lock-free rings
+// ----------------------------------------------------------------------------
+
+namespace {
+
+// Single-producer (the GL thread) single-consumer (the drain thread) ring.
+// head is only written by the producer, tail only by the consumer; an entry
+// is published by the release store of head after the slot is filled.
+struct TraceRing {
+    enum { SIZE = 4096 }; // must be a power of two; 64KiB per traced thread
+
+    struct Entry {
+        uint32_t id; // index into gl_names[] / gl_hooks_t::gl
+        int64_t ts;  // CLOCK_MONOTONIC, nanoseconds
+    };
+
+    Entry entries[SIZE];
+    std::atomic<uint32_t> head{0};
+    std::atomic<uint32_t> tail{0};
+    std::atomic<uint32_t> dropped{0};
+};
+
+// Rings are created on a GL thread's first traced call and are never freed:
+// the drain thread may be reading one at any time, and tracing is a debug
+// mode where a ring per exited GL thread is an acceptable cost.
+std::mutex gRingListLock;
+std::vector<TraceRing*> gRings;
+
+// Where the wrappers forward to; set by GLTrace::installHooks before the
+// trace table is made current, so it is always valid inside a wrapper.
+thread_local gl_hooks_t const* gTraceUnderlying = nullptr;
+
+thread_local TraceRing* gTraceRing = nullptr;
+
+TraceRing* registerRing() {
+    TraceRing* ring = new TraceRing;
+    {
+        std::lock_guard<std::mutex> lock(gRingListLock);
+        gRings.push_back(ring);
+    }
+    gTraceRing = ring;
+    return ring;
+}
+
+inline void recordCall(uint32_t id) {
+    TraceRing* ring = gTraceRing;
+    if (ring == nullptr) {
+        ring = registerRing();
+    }
+    uint32_t head = ring->head.load(std::memory_order_relaxed);
+    if (head - ring->tail.load(std::memory_order_acquire) >= TraceRing::SIZE) {
+        ring->dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    TraceRing::Entry& e = ring->entries[head & (TraceRing::SIZE - 1)];
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    e.id = id;
+    e.ts = t.tv_sec * 1000000000LL + t.tv_nsec;
+    ring->head.store(head + 1, std::memory_order_release);
+}
+
+// ----------------------------------------------------------------------------
+// Drain thread
+// ----------------------------------------------------------------------------
+
+// How often the rings are flushed to atrace. At 10ms a ring only overflows
+// above ~400k calls per second per thread, and overflow just drops events.
+constexpr int kDrainIntervalUs = 10000;
+
+void drainLoop() {
+    size_t numNames = 0;
+    while (gl_names[numNames]) {
+        numNames++;
+    }
+    // Cumulative per-call counts, emitted as systrace counters so call rates
+    // are visible on the timeline without an event write per call.
+    std::vector<uint32_t> totals(numNames, 0);
+    std::vector<bool> seen(numNames, false);
+    std::vector<TraceRing*> rings;
+
+    while (true) {
+        usleep(kDrainIntervalUs);
+
+        { // scope for gRingListLock
+            std::lock_guard<std::mutex> lock(gRingListLock);
+            rings = gRings;
+        }
+
+        uint32_t batch = 0;
+        uint32_t droppedTotal = 0;
+        int64_t tsFirst = 0;
+        int64_t tsLast = 0;
+        std::fill(seen.begin(), seen.end(), false);
+
+        for (TraceRing* ring : rings) {
+            uint32_t tail = ring->tail.load(std::memory_order_relaxed);
+            uint32_t head = ring->head.load(std::memory_order_acquire);
+            for (uint32_t i = tail; i != head; i++) {
+                TraceRing::Entry& e =
+                        ring->entries[i & (TraceRing::SIZE - 1)];
+                if (e.id < numNames) {
+                    totals[e.id]++;
+                    seen[e.id] = true;
+                }
+                if (tsFirst == 0 || e.ts < tsFirst) {
+                    tsFirst = e.ts;
+                }
+                if (e.ts > tsLast) {
+                    tsLast = e.ts;
+                }
+                batch++;
+            }
+            ring->tail.store(head, std::memory_order_release);
+            droppedTotal += ring->dropped.load(std::memory_order_relaxed);
+        }
+
+        if (batch == 0) {
+            continue;
+        }
+
+        char marker[64];
+        snprintf(marker, sizeof(marker),
+                "gl ring drain: %" PRIu32 " calls, %" PRId64 "us span",
+                batch, (tsLast - tsFirst) / 1000);
+        atrace_begin(ATRACE_TAG, marker);
+        for (size_t id = 0; id < numNames; id++) {
+            if (seen[id]) {
+                atrace_int(ATRACE_TAG, gl_names[id],
+                        static_cast<int32_t>(totals[id]));
+            }
+        }
+        if (droppedTotal) {
+            atrace_int(ATRACE_TAG, "GL trace dropped",
+                    static_cast<int32_t>(droppedTotal));
+        }
+        atrace_end(ATRACE_TAG);
+    }
+}
+
+} // anonymous namespace
+
+// ----------------------------------------------------------------------------
+// Generated trace wrappers and their hook table
+// ----------------------------------------------------------------------------
+
+#undef TRACE_GL_ENTRY
+#define TRACE_GL_ENTRY(_id, _r, _api, _proto, _args)  \
+    static _r Trace_ ## _api _proto {                 \
+        recordCall(_id);                              \
+        return gTraceUnderlying->gl._api _args;       \
+    }
+#include "gl_trace_entries.in"
+#undef TRACE_GL_ENTRY
+
+#define TRACE_GL_ENTRY(_id, _r, _api, _proto, _args) Trace_ ## _api,
+
+gl_hooks_t gHooksTrace = {
+    {
+        #include "gl_trace_entries.in"
+    },
+    { { nullptr } }
+};
+#undef TRACE_GL_ENTRY
+
+// ----------------------------------------------------------------------------
+// GLTrace
+// ----------------------------------------------------------------------------
+
+bool GLTrace::isEnabled() {
+    static bool enabled = []() {
+        char value[PROPERTY_VALUE_MAX];
+        property_get("debug.egl.trace", value, "");
+        if (strcmp(value, "ring") != 0) {
+            return false;
+        }
+        ALOGD("GL call ring tracing enabled");
+        std::thread drainThread(drainLoop);
+        pthread_setname_np(drainThread.native_handle(), "GLTraceDrain");
+        drainThread.detach();
+        return true;
+    }();
+    return enabled;
+}
+
+gl_hooks_t const* GLTrace::installHooks(gl_hooks_t const* underlying) {
+    if (!isEnabled()) {
+        return underlying;
+    }
+    gTraceUnderlying = underlying;
+    return &gHooksTrace;
+}
+
+}; // namespace android
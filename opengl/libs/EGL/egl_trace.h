@@ -32,6 +32,8 @@
 // ATRACE_CALL is an ATRACE_NAME that uses the current function name.
 #define ATRACE_CALL() ATRACE_NAME(__FUNCTION__)
 
+#include "../hooks.h"
+
 namespace android {
 
 class EglScopedTrace {
@@ -48,6 +50,27 @@ private:
     uint64_t mTag;
 };
 
+// Batched GL call tracing, enabled with debug.egl.trace=ring. Instead of a
+// trace write per call, the generated wrappers in egl_trace.cpp record the
+// call ID and a timestamp into a per-thread lock-free ring buffer, which a
+// background thread drains to atrace. When the ring is full events are
+// dropped (and counted) rather than ever blocking the GL thread.
+class GLTrace {
+public:
+    // True when debug.egl.trace is "ring"; checked once per process. The
+    // first true result also starts the drain thread.
+    static bool isEnabled();
+
+    // Returns the trace wrapper hook table, recording into the calling
+    // thread's ring before forwarding each call to |underlying|. Returns
+    // |underlying| unchanged when tracing is disabled.
+    static gl_hooks_t const* installHooks(gl_hooks_t const* underlying);
+};
+
+// The trace wrapper hook table. eglApi.cpp installs GL extension forwarders
+// into its ext slots alongside the regular gHooks tables.
+extern gl_hooks_t gHooksTrace;
+
 }; // namespace android
 
 #else // !__ANDROID__
@@ -16,6 +16,17 @@
 
 #include <string.h>
 
+#include <thread>
+#include <vector>
+
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define ETC1_HAS_NEON 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define ETC1_HAS_SSE2 1
+#endif
+
 /* From http://www.khronos.org/registry/gles/extensions/OES/OES_compressed_ETC1_RGB8_texture.txt
 
  The number of bits that represent a 4x4 texel block is 64 bits if
@@ -163,6 +174,7 @@ inline int convertDiff(int base, int diff) {
     return convert5To8((0x1f & base) + kLookup[0x7 & diff]);
 }
 
+#if !defined(ETC1_HAS_NEON)
 static
 void decode_subblock(etc1_byte* pOut, int r, int g, int b, const int* table,
         etc1_uint32 low, bool second, bool flipped) {
@@ -193,6 +205,41 @@ void decode_subblock(etc1_byte* pOut, int r, int g, int b, const int* table,
         *q++ = clamp(b + delta);
     }
 }
+#endif
+
+#if defined(ETC1_HAS_NEON)
+// Decodes both sub-blocks at once. The modifier and base color for each
+// pixel still have to be picked scalar (they depend on the pixel's index
+// bits), but the 48 clamped adds become six saturating vector ops plus two
+// interleaved stores. clamp() is exactly unsigned 8-bit saturation, so the
+// output matches decode_subblock bit for bit.
+static
+void decode_subblocks_simd(etc1_byte* pOut, int r1, int g1, int b1,
+        const int* tableA, int r2, int g2, int b2, const int* tableB,
+        etc1_uint32 low, bool flipped) {
+    int16_t base[3][16];
+    int16_t mod[16];
+    for (int p = 0; p < 16; p++) {
+        int x = p & 3;
+        int y = p >> 2;
+        bool second = flipped ? (y >= 2) : (x >= 2);
+        int k = y + (x * 4);
+        int offset = ((low >> k) & 1) | ((low >> (k + 15)) & 2);
+        mod[p] = (int16_t) (second ? tableB : tableA)[offset];
+        base[0][p] = (int16_t) (second ? r2 : r1);
+        base[1][p] = (int16_t) (second ? g2 : g1);
+        base[2][p] = (int16_t) (second ? b2 : b1);
+    }
+    for (int half = 0; half < 2; half++) {
+        int16x8_t m = vld1q_s16(mod + half * 8);
+        uint8x8x3_t rgb;
+        rgb.val[0] = vqmovun_s16(vaddq_s16(vld1q_s16(base[0] + half * 8), m));
+        rgb.val[1] = vqmovun_s16(vaddq_s16(vld1q_s16(base[1] + half * 8), m));
+        rgb.val[2] = vqmovun_s16(vaddq_s16(vld1q_s16(base[2] + half * 8), m));
+        vst3_u8(pOut + half * 24, rgb);
+    }
+}
+#endif
 
 // Input is an ETC1 compressed version of the data.
 // Output is a 4 x 4 square of 3-byte pixels in form R, G, B
@@ -226,8 +273,13 @@ void etc1_decode_block(const etc1_byte* pIn, etc1_byte* pOut) {
     const int* tableA = kModifierTable + tableIndexA * 4;
     const int* tableB = kModifierTable + tableIndexB * 4;
     bool flipped = (high & 1) != 0;
+#if defined(ETC1_HAS_NEON)
+    decode_subblocks_simd(pOut, r1, g1, b1, tableA, r2, g2, b2, tableB, low,
+            flipped);
+#else
     decode_subblock(pOut, r1, g1, b1, tableA, low, false, flipped);
     decode_subblock(pOut, r2, g2, b2, tableB, low, true, flipped);
+#endif
 }
 
 typedef struct {
@@ -306,6 +358,76 @@ static etc1_uint32 chooseModifier(const etc1_byte* pBaseColors,
     int r = pBaseColors[0];
     int g = pBaseColors[1];
     int b = pBaseColors[2];
+#if defined(ETC1_HAS_NEON)
+    // Score all four modifier candidates at once, one per 32-bit lane. The
+    // scalar loop's early-outs only skip work, so computing every candidate
+    // and keeping the first minimum produces identical output.
+    int32x4_t mod = vld1q_s32(pModifierTable);
+    int32x4_t lo = vdupq_n_s32(0);
+    int32x4_t hi = vdupq_n_s32(255);
+    int32x4_t dr = vsubq_s32(
+            vminq_s32(vmaxq_s32(vaddq_s32(vdupq_n_s32(r), mod), lo), hi),
+            vdupq_n_s32(pixelR));
+    int32x4_t dg = vsubq_s32(
+            vminq_s32(vmaxq_s32(vaddq_s32(vdupq_n_s32(g), mod), lo), hi),
+            vdupq_n_s32(pixelG));
+    int32x4_t db = vsubq_s32(
+            vminq_s32(vmaxq_s32(vaddq_s32(vdupq_n_s32(b), mod), lo), hi),
+            vdupq_n_s32(pixelB));
+    int32x4_t score = vmulq_s32(db, db);
+    score = vmlaq_n_s32(score, vmulq_s32(dr, dr), 3);
+    score = vmlaq_n_s32(score, vmulq_s32(dg, dg), 6);
+    etc1_uint32 scores[4];
+    vst1q_u32(scores, vreinterpretq_u32_s32(score));
+    for (int i = 0; i < 4; i++) {
+        if (scores[i] < bestScore) {
+            bestScore = scores[i];
+            bestIndex = i;
+        }
+    }
+#elif defined(ETC1_HAS_SSE2)
+    // Same four-lane scoring as the NEON path, done in 16-bit lanes because
+    // SSE2 has no 32-bit min/max or multiply. Everything fits: clamped colors
+    // are in [0, 255], differences in [-255, 255], and interleaving each
+    // difference with zero makes _mm_madd_epi16 produce one 32-bit square
+    // per lane.
+    __m128i mod = _mm_set_epi16(0, 0, 0, 0,
+            (short) pModifierTable[3], (short) pModifierTable[2],
+            (short) pModifierTable[1], (short) pModifierTable[0]);
+    __m128i lo = _mm_setzero_si128();
+    __m128i hi = _mm_set1_epi16(255);
+    __m128i dr = _mm_sub_epi16(
+            _mm_min_epi16(_mm_max_epi16(
+                    _mm_add_epi16(_mm_set1_epi16((short) r), mod), lo), hi),
+            _mm_set1_epi16((short) pixelR));
+    __m128i dg = _mm_sub_epi16(
+            _mm_min_epi16(_mm_max_epi16(
+                    _mm_add_epi16(_mm_set1_epi16((short) g), mod), lo), hi),
+            _mm_set1_epi16((short) pixelG));
+    __m128i db = _mm_sub_epi16(
+            _mm_min_epi16(_mm_max_epi16(
+                    _mm_add_epi16(_mm_set1_epi16((short) b), mod), lo), hi),
+            _mm_set1_epi16((short) pixelB));
+    dr = _mm_unpacklo_epi16(dr, lo);
+    dg = _mm_unpacklo_epi16(dg, lo);
+    db = _mm_unpacklo_epi16(db, lo);
+    __m128i sqr = _mm_madd_epi16(dr, dr);
+    __m128i sqg = _mm_madd_epi16(dg, dg);
+    __m128i sqb = _mm_madd_epi16(db, db);
+    __m128i score = _mm_add_epi32(sqb,
+            _mm_add_epi32(
+                    _mm_add_epi32(sqr, _mm_slli_epi32(sqr, 1)),
+                    _mm_add_epi32(_mm_slli_epi32(sqg, 1),
+                            _mm_slli_epi32(sqg, 2))));
+    etc1_uint32 scores[4];
+    _mm_storeu_si128((__m128i*) scores, score);
+    for (int i = 0; i < 4; i++) {
+        if (scores[i] < bestScore) {
+            bestScore = scores[i];
+            bestIndex = i;
+        }
+    }
+#else
     for (int i = 0; i < 4; i++) {
         int modifier = pModifierTable[i];
         int decodedG = clamp(g + modifier);
@@ -325,6 +447,7 @@ static etc1_uint32 chooseModifier(const etc1_byte* pBaseColors,
             bestIndex = i;
         }
     }
+#endif
     etc1_uint32 lowMask = (((bestIndex >> 1) << 16) | (bestIndex & 1))
             << bitIndex;
     *pLow |= lowMask;
@@ -504,16 +627,12 @@ etc1_uint32 etc1_get_encoded_data_size(etc1_uint32 width, etc1_uint32 height) {
     return (((width + 3) & ~3) * ((height + 3) & ~3)) >> 1;
 }
 
-// Encode an entire image.
-// pIn - pointer to the image data. Formatted such that the Red component of
-//       pixel (x,y) is at pIn + pixelSize * x + stride * y + redOffset;
-// pOut - pointer to encoded data. Must be large enough to store entire encoded image.
+// Encode the horizontal band of blocks covering pixel rows [yStart, yBandEnd).
+// Both bounds must be multiples of 4; pOut points at the band's first block.
 
-int etc1_encode_image(const etc1_byte* pIn, etc1_uint32 width, etc1_uint32 height,
-        etc1_uint32 pixelSize, etc1_uint32 stride, etc1_byte* pOut) {
-    if (pixelSize < 2 || pixelSize > 3) {
-        return -1;
-    }
+static void etc1_encode_rows(const etc1_byte* pIn, etc1_uint32 width,
+        etc1_uint32 height, etc1_uint32 pixelSize, etc1_uint32 stride,
+        etc1_byte* pOut, etc1_uint32 yStart, etc1_uint32 yBandEnd) {
     static const unsigned short kYMask[] = { 0x0, 0xf, 0xff, 0xfff, 0xffff };
     static const unsigned short kXMask[] = { 0x0, 0x1111, 0x3333, 0x7777,
             0xffff };
@@ -521,9 +640,8 @@ int etc1_encode_image(const etc1_byte* pIn, etc1_uint32 width, etc1_uint32 heigh
     etc1_byte encoded[ETC1_ENCODED_BLOCK_SIZE];
 
     etc1_uint32 encodedWidth = (width + 3) & ~3;
-    etc1_uint32 encodedHeight = (height + 3) & ~3;
 
-    for (etc1_uint32 y = 0; y < encodedHeight; y += 4) {
+    for (etc1_uint32 y = yStart; y < yBandEnd; y += 4) {
         etc1_uint32 yEnd = height - y;
         if (yEnd > 4) {
             yEnd = 4;
@@ -555,6 +673,53 @@ int etc1_encode_image(const etc1_byte* pIn, etc1_uint32 width, etc1_uint32 heigh
             pOut += sizeof(encoded);
         }
     }
+}
+
+// Encode an entire image.
+// pIn - pointer to the image data. Formatted such that the Red component of
+//       pixel (x,y) is at pIn + pixelSize * x + stride * y + redOffset;
+// pOut - pointer to encoded data. Must be large enough to store entire encoded image.
+
+int etc1_encode_image(const etc1_byte* pIn, etc1_uint32 width, etc1_uint32 height,
+        etc1_uint32 pixelSize, etc1_uint32 stride, etc1_byte* pOut) {
+    if (pixelSize < 2 || pixelSize > 3) {
+        return -1;
+    }
+    etc1_uint32 encodedWidth = (width + 3) & ~3;
+    etc1_uint32 encodedHeight = (height + 3) & ~3;
+
+    // Blocks are encoded independently, so large images are split into bands
+    // of block rows with one thread per band. Small images aren't worth the
+    // cost of spawning threads.
+    static const etc1_uint32 kMinParallelPixels = 256 * 256;
+    etc1_uint32 blockRows = encodedHeight >> 2;
+    etc1_uint32 bandBytes = (encodedWidth >> 2) * ETC1_ENCODED_BLOCK_SIZE;
+    unsigned int numThreads = std::thread::hardware_concurrency();
+    if (numThreads > 8) {
+        numThreads = 8;
+    }
+    if (numThreads > blockRows) {
+        numThreads = (unsigned int) blockRows;
+    }
+    if (numThreads < 2 || encodedWidth * encodedHeight < kMinParallelPixels) {
+        etc1_encode_rows(pIn, width, height, pixelSize, stride, pOut, 0,
+                encodedHeight);
+        return 0;
+    }
+
+    std::vector<std::thread> threads;
+    threads.reserve(numThreads - 1);
+    for (unsigned int t = 1; t < numThreads; t++) {
+        etc1_uint32 firstRow = blockRows * t / numThreads;
+        etc1_uint32 endRow = blockRows * (t + 1) / numThreads;
+        threads.emplace_back(etc1_encode_rows, pIn, width, height, pixelSize,
+                stride, pOut + firstRow * bandBytes, firstRow * 4, endRow * 4);
+    }
+    etc1_encode_rows(pIn, width, height, pixelSize, stride, pOut, 0,
+            (blockRows / numThreads) * 4);
+    for (std::thread& t : threads) {
+        t.join();
+    }
     return 0;
 }
 
@@ -0,0 +1,169 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_BATTERYPROPERTIES_PAGE_H
+#define ANDROID_BATTERYPROPERTIES_PAGE_H
+
+#include <atomic>
+#include <stdint.h>
+#include <string.h>
+
+#include <batteryservice/BatteryService.h>
+
+namespace android {
+
+/*
+ * Layout of a shared-memory snapshot of BatteryProperties, for native
+ * daemons that sample battery state periodically and should not pay a
+ * binder getProperty() round trip per read.
+ *
+ * The battery service owns the region: it maps it writable, restricts the
+ * ashmem protection to PROT_READ, hands the fd to interested clients, and
+ * calls writeBatteryPropertiesPage() on every healthd update. Clients map
+ * the region read-only and call readBatteryPropertiesPage(). The page is
+ * guarded by a seqlock - mSeq is odd while an update is in flight - and
+ * there is exactly one writer, so a reader retries at most one update.
+ * The listener path remains the way to learn that something changed; the
+ * page is for cheap polling of current values.
+ *
+ * This header is shared between the service implementation and readers so
+ * there is a single definition of the layout; bump kVersion on any change.
+ */
+struct BatteryPropertiesPage {
+    static constexpr uint32_t kMagic = 0x50544142; // 'BATP'
+    static constexpr uint32_t kVersion = 1;
+    static constexpr size_t kTechnologyMaxLen = 32;
+
+    uint32_t mMagic;
+    uint32_t mVersion;
+    std::atomic<uint32_t> mSeq;
+
+    // Snapshot of BatteryProperties, flattened to fixed-size fields.
+    int32_t mChargerAcOnline;
+    int32_t mChargerUsbOnline;
+    int32_t mChargerWirelessOnline;
+    int32_t mMaxChargingCurrent;
+    int32_t mMaxChargingVoltage;
+    int32_t mBatteryStatus;
+    int32_t mBatteryHealth;
+    int32_t mBatteryPresent;
+    int32_t mBatteryLevel;
+    int32_t mBatteryVoltage;
+    int32_t mBatteryTemperature;
+    int32_t mBatteryCurrent;
+    int32_t mBatteryCycleCount;
+    int32_t mBatteryFullCharge;
+    int32_t mBatteryChargeCounter;
+    char mBatteryTechnology[kTechnologyMaxLen]; // always NUL-terminated
+};
+
+static_assert(sizeof(BatteryPropertiesPage) <= 4096,
+              "BatteryPropertiesPage must fit in a single page");
+
+/*
+ * Initializes an empty page. The service calls this once after mapping,
+ * before publishing the fd; the magic is written last so a client racing
+ * initialization sees an invalid page rather than a half-initialized one.
+ */
+inline void initBatteryPropertiesPage(BatteryPropertiesPage* page) {
+    memset(page->mBatteryTechnology, 0, sizeof(page->mBatteryTechnology));
+    page->mSeq.store(0, std::memory_order_relaxed);
+    page->mVersion = BatteryPropertiesPage::kVersion;
+    std::atomic_thread_fence(std::memory_order_release);
+    page->mMagic = BatteryPropertiesPage::kMagic;
+}
+
+/*
+ * Publishes |props| into |page|. Must only ever be called from one thread
+ * at a time - the seqlock assumes a single writer.
+ */
+inline void writeBatteryPropertiesPage(BatteryPropertiesPage* page,
+                                       const BatteryProperties& props) {
+    const uint32_t seq = page->mSeq.load(std::memory_order_relaxed);
+    page->mSeq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    page->mChargerAcOnline = props.chargerAcOnline ? 1 : 0;
+    page->mChargerUsbOnline = props.chargerUsbOnline ? 1 : 0;
+    page->mChargerWirelessOnline = props.chargerWirelessOnline ? 1 : 0;
+    page->mMaxChargingCurrent = props.maxChargingCurrent;
+    page->mMaxChargingVoltage = props.maxChargingVoltage;
+    page->mBatteryStatus = props.batteryStatus;
+    page->mBatteryHealth = props.batteryHealth;
+    page->mBatteryPresent = props.batteryPresent ? 1 : 0;
+    page->mBatteryLevel = props.batteryLevel;
+    page->mBatteryVoltage = props.batteryVoltage;
+    page->mBatteryTemperature = props.batteryTemperature;
+    page->mBatteryCurrent = props.batteryCurrent;
+    page->mBatteryCycleCount = props.batteryCycleCount;
+    page->mBatteryFullCharge = props.batteryFullCharge;
+    page->mBatteryChargeCounter = props.batteryChargeCounter;
+    strlcpy(page->mBatteryTechnology, props.batteryTechnology.string(),
+            sizeof(page->mBatteryTechnology));
+
+    page->mSeq.store(seq + 2, std::memory_order_release);
+}
+
+/*
+ * Copies a consistent snapshot of |page| into |props|. Returns false if the
+ * page is not valid (wrong magic or an unknown version) or if a consistent
+ * snapshot could not be obtained after a bounded number of retries.
+ */
+inline bool readBatteryPropertiesPage(const BatteryPropertiesPage* page,
+                                      BatteryProperties* props) {
+    if (page->mMagic != BatteryPropertiesPage::kMagic ||
+            page->mVersion != BatteryPropertiesPage::kVersion) {
+        return false;
+    }
+    for (int retries = 0; retries < 100; retries++) {
+        const uint32_t seq = page->mSeq.load(std::memory_order_acquire);
+        if (seq & 1) {
+            continue; // write in progress
+        }
+
+        BatteryProperties snapshot;
+        char technology[BatteryPropertiesPage::kTechnologyMaxLen];
+        snapshot.chargerAcOnline = page->mChargerAcOnline != 0;
+        snapshot.chargerUsbOnline = page->mChargerUsbOnline != 0;
+        snapshot.chargerWirelessOnline = page->mChargerWirelessOnline != 0;
+        snapshot.maxChargingCurrent = page->mMaxChargingCurrent;
+        snapshot.maxChargingVoltage = page->mMaxChargingVoltage;
+        snapshot.batteryStatus = page->mBatteryStatus;
+        snapshot.batteryHealth = page->mBatteryHealth;
+        snapshot.batteryPresent = page->mBatteryPresent != 0;
+        snapshot.batteryLevel = page->mBatteryLevel;
+        snapshot.batteryVoltage = page->mBatteryVoltage;
+        snapshot.batteryTemperature = page->mBatteryTemperature;
+        snapshot.batteryCurrent = page->mBatteryCurrent;
+        snapshot.batteryCycleCount = page->mBatteryCycleCount;
+        snapshot.batteryFullCharge = page->mBatteryFullCharge;
+        snapshot.batteryChargeCounter = page->mBatteryChargeCounter;
+        memcpy(technology, page->mBatteryTechnology, sizeof(technology));
+        technology[sizeof(technology) - 1] = '\0';
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (page->mSeq.load(std::memory_order_relaxed) == seq) {
+            *props = snapshot;
+            props->batteryTechnology = String8(technology);
+            return true;
+        }
+    }
+    return false;
+}
+
+}; // namespace android
+
+#endif // ANDROID_BATTERYPROPERTIES_PAGE_H
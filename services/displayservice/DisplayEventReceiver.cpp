@@ -76,6 +76,10 @@ DisplayEventReceiver::FwkReceiver &DisplayEventReceiver::AttachedEvent::receiver
     return mFwkReceiver;
 }
 
+void DisplayEventReceiver::AttachedEvent::setVsyncRate(int32_t count) {
+    mVsyncRate.store(count, std::memory_order_relaxed);
+}
+
 int DisplayEventReceiver::AttachedEvent::handleEvent(int fd, int events, void* /* data */) {
     CHECK(fd == mFwkReceiver.getFd());
 
@@ -89,10 +93,19 @@ int DisplayEventReceiver::AttachedEvent::handleEvent(int fd, int events, void* /
         return 1; // keep the callback
     }
 
-    constexpr size_t SIZE = 1;
+    // Drain everything that queued since the last wakeup in as few reads as
+    // possible. Hotplug events are forwarded in order, but vsyncs are
+    // coalesced down to the most recent one: a stale vsync carries no
+    // information a vendor client can act on, and forwarding it would cost a
+    // full HIDL transaction. This keeps a slow client at one onVsync call
+    // per wakeup no matter how many ticks piled up.
+    constexpr size_t SIZE = 64;
+    const int32_t vsyncRate = mVsyncRate.load(std::memory_order_relaxed);
 
     ssize_t n;
     FwkReceiver::Event buf[SIZE];
+    bool vsyncPending = false;
+    FwkReceiver::Event lastVsync = {};
     while ((n = mFwkReceiver.getEvents(buf, SIZE)) > 0) {
         for (size_t i = 0; i < static_cast<size_t>(n); ++i) {
             const FwkReceiver::Event &event = buf[i];
@@ -102,12 +115,14 @@ int DisplayEventReceiver::AttachedEvent::handleEvent(int fd, int events, void* /
 
             switch(buf[i].header.type) {
                 case FwkReceiver::DISPLAY_EVENT_VSYNC: {
-                    auto ret = mCallback->onVsync(timestamp, event.vsync.count);
-                    if (!ret.isOk()) {
-                        LOG(ERROR) << "AttachedEvent handleEvent fails on onVsync callback"
-                                   << " because of " << ret.description();
-                        return 0;  // remove the callback
+                    // Events queued before a setVsyncRate() took effect may
+                    // not match the divisor; drop them here rather than
+                    // paying an IPC to deliver an off-beat tick.
+                    if (vsyncRate > 1 && (event.vsync.count % vsyncRate) != 0) {
+                        break;
                     }
+                    lastVsync = event;
+                    vsyncPending = true;
                 } break;
                 case FwkReceiver::DISPLAY_EVENT_HOTPLUG: {
                     auto ret = mCallback->onHotplug(timestamp, event.hotplug.connected);
@@ -124,6 +139,15 @@ int DisplayEventReceiver::AttachedEvent::handleEvent(int fd, int events, void* /
         }
     }
 
+    if (vsyncPending) {
+        auto ret = mCallback->onVsync(lastVsync.header.timestamp, lastVsync.vsync.count);
+        if (!ret.isOk()) {
+            LOG(ERROR) << "AttachedEvent handleEvent fails on onVsync callback"
+                       << " because of " << ret.description();
+            return 0;  // remove the callback
+        }
+    }
+
     return 1; // keep on going
 }
 
@@ -147,6 +171,9 @@ Return<Status> DisplayEventReceiver::setVsyncRate(int32_t count) {
     }
 
     bool success = OK == mAttached->receiver().setVsyncRate(count);
+    if (success) {
+        mAttached->setVsyncRate(count);
+    }
     return success ? Status::SUCCESS : Status::UNKNOWN;
 }
 
@@ -23,6 +23,7 @@
 #include <gui/DisplayEventReceiver.h>
 #include <utils/Looper.h>
 
+#include <atomic>
 #include <mutex>
 
 namespace android {
@@ -51,12 +52,19 @@ private:
         bool detach();
         bool valid() const;
         FwkReceiver &receiver();
+        // Remembers the client's requested vsync divisor so events queued
+        // before a rate change can be filtered out on this side of the HIDL
+        // boundary.
+        void setVsyncRate(int32_t count);
         virtual int handleEvent(int fd, int events, void* /* data */) override;
 
     private:
         FwkReceiver mFwkReceiver;
         sp<IEventCallback> mCallback;
         bool mLooperAttached;
+        // Matches the rate last handed to mFwkReceiver; written under the
+        // outer mMutex, read from the looper thread.
+        std::atomic<int32_t> mVsyncRate{0};
     };
 
     sp<AttachedEvent> mAttached;
@@ -31,6 +31,10 @@
 #include <sys/utsname.h>
 #include <unistd.h>
 
+#include <atomic>
+#include <thread>
+#include <vector>
+
 #define LOG_TAG "EventHub"
 
 // #define LOG_NDEBUG 0
@@ -147,6 +151,7 @@ EventHub::Device::Device(int fd, int32_t id, const String8& path,
         fd(fd), id(id), path(path), identifier(identifier),
         classes(0), configuration(NULL), virtualKeyMap(NULL),
         ffEffectPlaying(false), ffEffectId(-1), controllerNumber(0),
+        eligibleForBuiltInKeyboard(false),
         timestampOverrideSec(0), timestampOverrideUsec(0), enabled(true),
         isVirtual(fd < 0) {
     memset(keyBitmask, 0, sizeof(keyBitmask));
@@ -745,6 +750,7 @@ size_t EventHub::getEvents(int timeoutMillis, RawEvent* buffer, size_t bufferSiz
     RawEvent* event = buffer;
     size_t capacity = bufferSize;
     bool awoken = false;
+    bool polledForStragglers = false;
     for (;;) {
         nsecs_t now = systemTime(SYSTEM_TIME_MONOTONIC);
 
@@ -845,121 +851,133 @@ size_t EventHub::getEvents(int timeoutMillis, RawEvent* buffer, size_t bufferSiz
 
             Device* device = mDevices.valueAt(deviceIndex);
             if (eventItem.events & EPOLLIN) {
-                int32_t readSize = read(device->fd, readBuffer,
-                        sizeof(struct input_event) * capacity);
-                if (readSize == 0 || (readSize < 0 && errno == ENODEV)) {
-                    // Device was removed before INotify noticed.
-                    ALOGW("could not get event, removed? (fd: %d size: %" PRId32
-                            " bufferSize: %zu capacity: %zu errno: %d)\n",
-                            device->fd, readSize, bufferSize, capacity, errno);
-                    deviceChanged = true;
-                    closeDeviceLocked(device);
-                } else if (readSize < 0) {
-                    if (errno != EAGAIN && errno != EINTR) {
-                        ALOGW("could not get event (errno=%d)", errno);
-                    }
-                } else if ((readSize % sizeof(struct input_event)) != 0) {
-                    ALOGE("could not get event (wrong size: %d)", readSize);
-                } else {
-                    int32_t deviceId = device->id == mBuiltInKeyboardId ? 0 : device->id;
-
-                    size_t count = size_t(readSize) / sizeof(struct input_event);
-                    for (size_t i = 0; i < count; i++) {
-                        struct input_event& iev = readBuffer[i];
-                        ALOGV("%s got: time=%d.%06d, type=%d, code=%d, value=%d",
-                                device->path.string(),
-                                (int) iev.time.tv_sec, (int) iev.time.tv_usec,
-                                iev.type, iev.code, iev.value);
-
-                        // Some input devices may have a better concept of the time
-                        // when an input event was actually generated than the kernel
-                        // which simply timestamps all events on entry to evdev.
-                        // This is a custom Android extension of the input protocol
-                        // mainly intended for use with uinput based device drivers.
-                        if (iev.type == EV_MSC) {
-                            if (iev.code == MSC_ANDROID_TIME_SEC) {
-                                device->timestampOverrideSec = iev.value;
-                                continue;
-                            } else if (iev.code == MSC_ANDROID_TIME_USEC) {
-                                device->timestampOverrideUsec = iev.value;
-                                continue;
-                            }
+                // Drain the device until its evdev client buffer is empty or we run
+                // out of capacity.  The device fd is non-blocking, so a short read
+                // means there is nothing left and the next read would return EAGAIN.
+                bool deviceDrained = false;
+                while (!deviceDrained && capacity > 0) {
+                    const size_t wantSize = sizeof(struct input_event) * capacity;
+                    int32_t readSize = read(device->fd, readBuffer, wantSize);
+                    if (readSize == 0 || (readSize < 0 && errno == ENODEV)) {
+                        // Device was removed before INotify noticed.
+                        ALOGW("could not get event, removed? (fd: %d size: %" PRId32
+                                " bufferSize: %zu capacity: %zu errno: %d)\n",
+                                device->fd, readSize, bufferSize, capacity, errno);
+                        deviceChanged = true;
+                        closeDeviceLocked(device);
+                        break;
+                    } else if (readSize < 0) {
+                        if (errno != EAGAIN && errno != EINTR) {
+                            ALOGW("could not get event (errno=%d)", errno);
                         }
-                        if (device->timestampOverrideSec || device->timestampOverrideUsec) {
-                            iev.time.tv_sec = device->timestampOverrideSec;
-                            iev.time.tv_usec = device->timestampOverrideUsec;
-                            if (iev.type == EV_SYN && iev.code == SYN_REPORT) {
-                                device->timestampOverrideSec = 0;
-                                device->timestampOverrideUsec = 0;
+                        break;
+                    } else if ((readSize % sizeof(struct input_event)) != 0) {
+                        ALOGE("could not get event (wrong size: %d)", readSize);
+                        break;
+                    } else {
+                        deviceDrained = size_t(readSize) < wantSize;
+
+                        int32_t deviceId = device->id == mBuiltInKeyboardId ? 0 : device->id;
+
+                        size_t count = size_t(readSize) / sizeof(struct input_event);
+                        for (size_t i = 0; i < count; i++) {
+                            struct input_event& iev = readBuffer[i];
+                            ALOGV("%s got: time=%d.%06d, type=%d, code=%d, value=%d",
+                                    device->path.string(),
+                                    (int) iev.time.tv_sec, (int) iev.time.tv_usec,
+                                    iev.type, iev.code, iev.value);
+
+                            // Some input devices may have a better concept of the time
+                            // when an input event was actually generated than the kernel
+                            // which simply timestamps all events on entry to evdev.
+                            // This is a custom Android extension of the input protocol
+                            // mainly intended for use with uinput based device drivers.
+                            if (iev.type == EV_MSC) {
+                                if (iev.code == MSC_ANDROID_TIME_SEC) {
+                                    device->timestampOverrideSec = iev.value;
+                                    continue;
+                                } else if (iev.code == MSC_ANDROID_TIME_USEC) {
+                                    device->timestampOverrideUsec = iev.value;
+                                    continue;
+                                }
+                            }
+                            if (device->timestampOverrideSec || device->timestampOverrideUsec) {
+                                iev.time.tv_sec = device->timestampOverrideSec;
+                                iev.time.tv_usec = device->timestampOverrideUsec;
+                                if (iev.type == EV_SYN && iev.code == SYN_REPORT) {
+                                    device->timestampOverrideSec = 0;
+                                    device->timestampOverrideUsec = 0;
+                                }
+                                ALOGV("applied override time %d.%06d",
+                                        int(iev.time.tv_sec), int(iev.time.tv_usec));
                             }
-                            ALOGV("applied override time %d.%06d",
-                                    int(iev.time.tv_sec), int(iev.time.tv_usec));
-                        }
 
-                        // Use the time specified in the event instead of the current time
-                        // so that downstream code can get more accurate estimates of
-                        // event dispatch latency from the time the event is enqueued onto
-                        // the evdev client buffer.
-                        //
-                        // The event's timestamp fortuitously uses the same monotonic clock
-                        // time base as the rest of Android.  The kernel event device driver
-                        // (drivers/input/evdev.c) obtains timestamps using ktime_get_ts().
-                        // The systemTime(SYSTEM_TIME_MONOTONIC) function we use everywhere
-                        // calls clock_gettime(CLOCK_MONOTONIC) which is implemented as a
-                        // system call that also queries ktime_get_ts().
-                        event->when = nsecs_t(iev.time.tv_sec) * 1000000000LL
-                                + nsecs_t(iev.time.tv_usec) * 1000LL;
-                        ALOGV("event time %" PRId64 ", now %" PRId64, event->when, now);
-
-                        // Bug 7291243: Add a guard in case the kernel generates timestamps
-                        // that appear to be far into the future because they were generated
-                        // using the wrong clock source.
-                        //
-                        // This can happen because when the input device is initially opened
-                        // it has a default clock source of CLOCK_REALTIME.  Any input events
-                        // enqueued right after the device is opened will have timestamps
-                        // generated using CLOCK_REALTIME.  We later set the clock source
-                        // to CLOCK_MONOTONIC but it is already too late.
-                        //
-                        // Invalid input event timestamps can result in ANRs, crashes and
-                        // and other issues that are hard to track down.  We must not let them
-                        // propagate through the system.
-                        //
-                        // Log a warning so that we notice the problem and recover gracefully.
-                        if (event->when >= now + 10 * 1000000000LL) {
-                            // Double-check.  Time may have moved on.
-                            nsecs_t time = systemTime(SYSTEM_TIME_MONOTONIC);
-                            if (event->when > time) {
-                                ALOGW("An input event from %s has a timestamp that appears to "
-                                        "have been generated using the wrong clock source "
-                                        "(expected CLOCK_MONOTONIC): "
-                                        "event time %" PRId64 ", current time %" PRId64
-                                        ", call time %" PRId64 ".  "
-                                        "Using current time instead.",
-                                        device->path.string(), event->when, time, now);
-                                event->when = time;
-                            } else {
-                                ALOGV("Event time is ok but failed the fast path and required "
-                                        "an extra call to systemTime: "
-                                        "event time %" PRId64 ", current time %" PRId64
-                                        ", call time %" PRId64 ".",
-                                        event->when, time, now);
+                            // Use the time specified in the event instead of the current time
+                            // so that downstream code can get more accurate estimates of
+                            // event dispatch latency from the time the event is enqueued onto
+                            // the evdev client buffer.
+                            //
+                            // The event's timestamp fortuitously uses the same monotonic clock
+                            // time base as the rest of Android.  The kernel event device driver
+                            // (drivers/input/evdev.c) obtains timestamps using ktime_get_ts().
+                            // The systemTime(SYSTEM_TIME_MONOTONIC) function we use everywhere
+                            // calls clock_gettime(CLOCK_MONOTONIC) which is implemented as a
+                            // system call that also queries ktime_get_ts().
+                            event->when = nsecs_t(iev.time.tv_sec) * 1000000000LL
+                                    + nsecs_t(iev.time.tv_usec) * 1000LL;
+                            ALOGV("event time %" PRId64 ", now %" PRId64, event->when, now);
+
+                            // Bug 7291243: Add a guard in case the kernel generates timestamps
+                            // that appear to be far into the future because they were generated
+                            // using the wrong clock source.
+                            //
+                            // This can happen because when the input device is initially opened
+                            // it has a default clock source of CLOCK_REALTIME.  Any input events
+                            // enqueued right after the device is opened will have timestamps
+                            // generated using CLOCK_REALTIME.  We later set the clock source
+                            // to CLOCK_MONOTONIC but it is already too late.
+                            //
+                            // Invalid input event timestamps can result in ANRs, crashes and
+                            // and other issues that are hard to track down.  We must not let them
+                            // propagate through the system.
+                            //
+                            // Log a warning so that we notice the problem and recover gracefully.
+                            if (event->when >= now + 10 * 1000000000LL) {
+                                // Double-check.  Time may have moved on.
+                                nsecs_t time = systemTime(SYSTEM_TIME_MONOTONIC);
+                                if (event->when > time) {
+                                    ALOGW("An input event from %s has a timestamp that appears to "
+                                            "have been generated using the wrong clock source "
+                                            "(expected CLOCK_MONOTONIC): "
+                                            "event time %" PRId64 ", current time %" PRId64
+                                            ", call time %" PRId64 ".  "
+                                            "Using current time instead.",
+                                            device->path.string(), event->when, time, now);
+                                    event->when = time;
+                                } else {
+                                    ALOGV("Event time is ok but failed the fast path and required "
+                                            "an extra call to systemTime: "
+                                            "event time %" PRId64 ", current time %" PRId64
+                                            ", call time %" PRId64 ".",
+                                            event->when, time, now);
+                                }
                             }
+                            event->deviceId = deviceId;
+                            event->type = iev.type;
+                            event->code = iev.code;
+                            event->value = iev.value;
+                            event += 1;
+                            capacity -= 1;
                         }
-                        event->deviceId = deviceId;
-                        event->type = iev.type;
-                        event->code = iev.code;
-                        event->value = iev.value;
-                        event += 1;
-                        capacity -= 1;
-                    }
-                    if (capacity == 0) {
-                        // The result buffer is full.  Reset the pending event index
-                        // so we will try to read the device again on the next iteration.
-                        mPendingEventIndex -= 1;
-                        break;
                     }
                 }
+                if (capacity == 0 && !deviceDrained) {
+                    // The result buffer is full and the device may still have
+                    // events pending.  Reset the pending event index so we will
+                    // try to read the device again on the next iteration.
+                    mPendingEventIndex -= 1;
+                    break;
+                }
             } else if (eventItem.events & EPOLLHUP) {
                 ALOGI("Removing device %s due to epoll hang-up event.",
                         device->identifier.name.string());
@@ -987,6 +1005,22 @@ size_t EventHub::getEvents(int timeoutMillis, RawEvent* buffer, size_t bufferSiz
 
         // Return now if we have collected any events or if we were explicitly awoken.
         if (event != buffer || awoken) {
+            // Before returning, poll once with a zero timeout to pick up events that
+            // arrived while we were processing the previous batch.  This lets a single
+            // getEvents() call drain everything that is already pending instead of
+            // waking the reader thread again for it.  We only do this once per call
+            // so a busy device cannot keep us looping here indefinitely.
+            if (!awoken && capacity > 0 && !polledForStragglers
+                    && mPendingEventIndex >= mPendingEventCount) {
+                polledForStragglers = true;
+                int pollResult = epoll_wait(mEpollFd, mPendingEventItems, EPOLL_MAX_EVENTS, 0);
+                if (pollResult > 0) {
+                    mPendingEventIndex = 0;
+                    mPendingEventCount = size_t(pollResult);
+                    continue;
+                }
+                mPendingEventCount = 0;
+            }
             break;
         }
 
@@ -1108,6 +1142,14 @@ status_t EventHub::unregisterDeviceFromEpollLocked(Device* device) {
 }
 
 status_t EventHub::openDeviceLocked(const char *devicePath) {
+    Device* device = probeDevice(devicePath, mNextDeviceId++);
+    if (device == NULL) {
+        return -1;
+    }
+    return finalizeDeviceLocked(device);
+}
+
+EventHub::Device* EventHub::probeDevice(const char *devicePath, int32_t deviceId) {
     char buffer[80];
 
     ALOGV("Opening device: %s", devicePath);
@@ -1115,7 +1157,7 @@ status_t EventHub::openDeviceLocked(const char *devicePath) {
     int fd = open(devicePath, O_RDWR | O_CLOEXEC | O_NONBLOCK);
     if(fd < 0) {
         ALOGE("could not open %s, %s\n", devicePath, strerror(errno));
-        return -1;
+        return NULL;
     }
 
     InputDeviceIdentifier identifier;
@@ -1128,13 +1170,15 @@ status_t EventHub::openDeviceLocked(const char *devicePath) {
         identifier.name.setTo(buffer);
     }
 
-    // Check to see if the device is on our excluded list
+    // Check to see if the device is on our excluded list.
+    // The list cannot change while the scanning thread holds the lock, so it
+    // is safe to read from a concurrent probe.
     for (size_t i = 0; i < mExcludedDevices.size(); i++) {
         const String8& item = mExcludedDevices.itemAt(i);
         if (identifier.name == item) {
             ALOGI("ignoring event id %s driver %s\n", devicePath, item.string());
             close(fd);
-            return -1;
+            return NULL;
         }
     }
 
@@ -1143,7 +1187,7 @@ status_t EventHub::openDeviceLocked(const char *devicePath) {
     if(ioctl(fd, EVIOCGVERSION, &driverVersion)) {
         ALOGE("could not get driver version for %s, %s\n", devicePath, strerror(errno));
         close(fd);
-        return -1;
+        return NULL;
     }
 
     // Get device identifier.
@@ -1151,7 +1195,7 @@ status_t EventHub::openDeviceLocked(const char *devicePath) {
     if(ioctl(fd, EVIOCGID, &inputId)) {
         ALOGE("could not get device input id for %s, %s\n", devicePath, strerror(errno));
         close(fd);
-        return -1;
+        return NULL;
     }
     identifier.bus = inputId.bustype;
     identifier.product = inputId.product;
@@ -1174,11 +1218,9 @@ status_t EventHub::openDeviceLocked(const char *devicePath) {
         identifier.uniqueId.setTo(buffer);
     }
 
-    // Fill in the descriptor.
-    assignDescriptorLocked(identifier);
-
     // Allocate device.  (The device object takes ownership of the fd at this point.)
-    int32_t deviceId = mNextDeviceId++;
+    // The descriptor is assigned later, when the device is finalized under the
+    // lock, so that conflicts with concurrently probed devices are resolved.
     Device* device = new Device(fd, deviceId, String8(devicePath), identifier);
 
     ALOGV("add device %d: %s\n", deviceId, devicePath);
@@ -1190,12 +1232,11 @@ status_t EventHub::openDeviceLocked(const char *devicePath) {
     ALOGV("  name:       \"%s\"\n", identifier.name.string());
     ALOGV("  location:   \"%s\"\n", identifier.location.string());
     ALOGV("  unique id:  \"%s\"\n", identifier.uniqueId.string());
-    ALOGV("  descriptor: \"%s\"\n", identifier.descriptor.string());
     ALOGV("  driver:     v%d.%d.%d\n",
         driverVersion >> 16, (driverVersion >> 8) & 0xff, driverVersion & 0xff);
 
     // Load the configuration file for the device.
-    loadConfigurationLocked(device);
+    loadConfiguration(device);
 
     // Figure out the kinds of events the device reports.
     ioctl(fd, EVIOCGBIT(EV_KEY, sizeof(device->keyBitmask)), device->keyBitmask);
@@ -1293,7 +1334,7 @@ status_t EventHub::openDeviceLocked(const char *devicePath) {
     if ((device->classes & INPUT_DEVICE_CLASS_TOUCH)) {
         // Load the virtual keys for the touch screen, if any.
         // We do this now so that we can make sure to load the keymap if necessary.
-        status_t status = loadVirtualKeyMapLocked(device);
+        status_t status = loadVirtualKeyMap(device);
         if (!status) {
             device->classes |= INPUT_DEVICE_CLASS_KEYBOARD;
         }
@@ -1304,36 +1345,35 @@ status_t EventHub::openDeviceLocked(const char *devicePath) {
     status_t keyMapStatus = NAME_NOT_FOUND;
     if (device->classes & (INPUT_DEVICE_CLASS_KEYBOARD | INPUT_DEVICE_CLASS_JOYSTICK)) {
         // Load the keymap for the device.
-        keyMapStatus = loadKeyMapLocked(device);
+        keyMapStatus = loadKeyMap(device);
     }
 
     // Configure the keyboard, gamepad or virtual keyboard.
     if (device->classes & INPUT_DEVICE_CLASS_KEYBOARD) {
-        // Register the keyboard as a built-in keyboard if it is eligible.
-        if (!keyMapStatus
-                && mBuiltInKeyboardId == NO_BUILT_IN_KEYBOARD
+        // Remember whether the keyboard could serve as the built-in keyboard;
+        // the role is claimed when the device is finalized, once earlier
+        // devices have had their chance.
+        device->eligibleForBuiltInKeyboard = !keyMapStatus
                 && isEligibleBuiltInKeyboard(device->identifier,
-                        device->configuration, &device->keyMap)) {
-            mBuiltInKeyboardId = device->id;
-        }
+                        device->configuration, &device->keyMap);
 
         // 'Q' key support = cheap test of whether this is an alpha-capable kbd
-        if (hasKeycodeLocked(device, AKEYCODE_Q)) {
+        if (hasKeycode(device, AKEYCODE_Q)) {
             device->classes |= INPUT_DEVICE_CLASS_ALPHAKEY;
         }
 
         // See if this device has a DPAD.
-        if (hasKeycodeLocked(device, AKEYCODE_DPAD_UP) &&
-                hasKeycodeLocked(device, AKEYCODE_DPAD_DOWN) &&
-                hasKeycodeLocked(device, AKEYCODE_DPAD_LEFT) &&
-                hasKeycodeLocked(device, AKEYCODE_DPAD_RIGHT) &&
-                hasKeycodeLocked(device, AKEYCODE_DPAD_CENTER)) {
+        if (hasKeycode(device, AKEYCODE_DPAD_UP) &&
+                hasKeycode(device, AKEYCODE_DPAD_DOWN) &&
+                hasKeycode(device, AKEYCODE_DPAD_LEFT) &&
+                hasKeycode(device, AKEYCODE_DPAD_RIGHT) &&
+                hasKeycode(device, AKEYCODE_DPAD_CENTER)) {
             device->classes |= INPUT_DEVICE_CLASS_DPAD;
         }
 
         // See if this device has a gamepad.
         for (size_t i = 0; i < sizeof(GAMEPAD_KEYCODES)/sizeof(GAMEPAD_KEYCODES[0]); i++) {
-            if (hasKeycodeLocked(device, GAMEPAD_KEYCODES[i])) {
+            if (hasKeycode(device, GAMEPAD_KEYCODES[i])) {
                 device->classes |= INPUT_DEVICE_CLASS_GAMEPAD;
                 break;
             }
@@ -1345,19 +1385,33 @@ status_t EventHub::openDeviceLocked(const char *devicePath) {
         ALOGV("Dropping device: id=%d, path='%s', name='%s'",
                 deviceId, devicePath, device->identifier.name.string());
         delete device;
-        return -1;
+        return NULL;
     }
 
     // Determine whether the device has a mic.
-    if (deviceHasMicLocked(device)) {
+    if (deviceHasMic(device)) {
         device->classes |= INPUT_DEVICE_CLASS_MIC;
     }
 
     // Determine whether the device is external or internal.
-    if (isExternalDeviceLocked(device)) {
+    if (isExternalDevice(device)) {
         device->classes |= INPUT_DEVICE_CLASS_EXTERNAL;
     }
 
+    return device;
+}
+
+status_t EventHub::finalizeDeviceLocked(Device* device) {
+    // Fill in the descriptor now that conflicts with every other device,
+    // including ones probed concurrently, are visible.
+    assignDescriptorLocked(device->identifier);
+
+    // Register the keyboard as a built-in keyboard if it is eligible.
+    if (device->eligibleForBuiltInKeyboard
+            && mBuiltInKeyboardId == NO_BUILT_IN_KEYBOARD) {
+        mBuiltInKeyboardId = device->id;
+    }
+
     if (device->classes & (INPUT_DEVICE_CLASS_JOYSTICK | INPUT_DEVICE_CLASS_DPAD)
             && device->classes & INPUT_DEVICE_CLASS_GAMEPAD) {
         device->controllerNumber = getNextControllerNumberLocked(device);
@@ -1374,12 +1428,12 @@ status_t EventHub::openDeviceLocked(const char *devicePath) {
 
     ALOGI("New device: id=%d, fd=%d, path='%s', name='%s', classes=0x%x, "
             "configuration='%s', keyLayout='%s', keyCharacterMap='%s', builtinKeyboard=%s, ",
-         deviceId, fd, devicePath, device->identifier.name.string(),
+         device->id, device->fd, device->path.string(), device->identifier.name.string(),
          device->classes,
          device->configurationFile.string(),
          device->keyMap.keyLayoutFile.string(),
          device->keyMap.keyCharacterMapFile.string(),
-         toString(mBuiltInKeyboardId == deviceId));
+         toString(mBuiltInKeyboardId == device->id));
 
     addDeviceLocked(device);
     return OK;
@@ -1478,7 +1532,7 @@ void EventHub::createVirtualKeyboardLocked() {
             | INPUT_DEVICE_CLASS_ALPHAKEY
             | INPUT_DEVICE_CLASS_DPAD
             | INPUT_DEVICE_CLASS_VIRTUAL;
-    loadKeyMapLocked(device);
+    loadKeyMap(device);
     addDeviceLocked(device);
 }
 
@@ -1488,7 +1542,7 @@ void EventHub::addDeviceLocked(Device* device) {
     mOpeningDevices = device;
 }
 
-void EventHub::loadConfigurationLocked(Device* device) {
+void EventHub::loadConfiguration(Device* device) {
     device->configurationFile = getInputDeviceConfigurationFilePathByDeviceIdentifier(
             device->identifier, INPUT_DEVICE_CONFIGURATION_FILE_TYPE_CONFIGURATION);
     if (device->configurationFile.isEmpty()) {
@@ -1505,7 +1559,7 @@ void EventHub::loadConfigurationLocked(Device* device) {
     }
 }
 
-status_t EventHub::loadVirtualKeyMapLocked(Device* device) {
+status_t EventHub::loadVirtualKeyMap(Device* device) {
     // The virtual key map is supplied by the kernel as a system board property file.
     String8 path;
     path.append("/sys/board_properties/virtualkeys.");
@@ -1516,11 +1570,11 @@ status_t EventHub::loadVirtualKeyMapLocked(Device* device) {
     return VirtualKeyMap::load(path, &device->virtualKeyMap);
 }
 
-status_t EventHub::loadKeyMapLocked(Device* device) {
+status_t EventHub::loadKeyMap(Device* device) {
     return device->keyMap.load(device->identifier, device->configuration);
 }
 
-bool EventHub::isExternalDeviceLocked(Device* device) {
+bool EventHub::isExternalDevice(Device* device) {
     if (device->configuration) {
         bool value;
         if (device->configuration->tryGetProperty(String8("device.internal"), value)) {
@@ -1530,7 +1584,7 @@ bool EventHub::isExternalDeviceLocked(Device* device) {
     return device->identifier.bus == BUS_USB || device->identifier.bus == BUS_BLUETOOTH;
 }
 
-bool EventHub::deviceHasMicLocked(Device* device) {
+bool EventHub::deviceHasMic(Device* device) {
     if (device->configuration) {
         bool value;
         if (device->configuration->tryGetProperty(String8("audio.mic"), value)) {
@@ -1566,7 +1620,7 @@ void EventHub::setLedForControllerLocked(Device* device) {
     }
 }
 
-bool EventHub::hasKeycodeLocked(Device* device, int keycode) const {
+bool EventHub::hasKeycode(Device* device, int keycode) const {
     if (!device->keyMap.haveKeyLayout()) {
         return false;
     }
@@ -1717,15 +1771,65 @@ status_t EventHub::scanDirLocked(const char *dirname)
     strcpy(devname, dirname);
     filename = devname + strlen(devname);
     *filename++ = '/';
+    Vector<String8> devicePaths;
     while((de = readdir(dir))) {
         if(de->d_name[0] == '.' &&
            (de->d_name[1] == '\0' ||
             (de->d_name[1] == '.' && de->d_name[2] == '\0')))
             continue;
         strcpy(filename, de->d_name);
-        openDeviceLocked(devname);
+        devicePaths.add(String8(devname));
     }
     closedir(dir);
+
+    const size_t count = devicePaths.size();
+    if (count <= 1) {
+        for (size_t i = 0; i < count; i++) {
+            openDeviceLocked(devicePaths[i].string());
+        }
+        return 0;
+    }
+
+    // Probing a device issues a long string of blocking ioctls and parses its
+    // configuration and key map files, so the initial scan fans the probes
+    // out over a few worker threads instead of paying that cost once per
+    // device in sequence.  Device ids are assigned up front in directory
+    // order and the probed devices are finalized on this thread, also in
+    // directory order, so ids, descriptors, the built-in keyboard and
+    // controller numbers come out the same as a serial scan.  The workers
+    // only touch the device being probed and read mExcludedDevices, which
+    // cannot change while this thread holds the lock.
+    Vector<int32_t> deviceIds;
+    for (size_t i = 0; i < count; i++) {
+        deviceIds.add(mNextDeviceId++);
+    }
+
+    std::vector<Device*> probedDevices(count);
+    std::atomic<size_t> nextIndex(0);
+    size_t threadCount = std::thread::hardware_concurrency();
+    if (threadCount == 0) {
+        threadCount = 2;
+    }
+    if (threadCount > count) {
+        threadCount = count;
+    }
+    std::vector<std::thread> workers;
+    for (size_t t = 0; t < threadCount; t++) {
+        workers.emplace_back([&] {
+            for (size_t i; (i = nextIndex.fetch_add(1)) < count;) {
+                probedDevices[i] = probeDevice(devicePaths[i].string(), deviceIds[i]);
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        if (probedDevices[i] != NULL) {
+            finalizeDeviceLocked(probedDevices[i]);
+        }
+    }
     return 0;
 }
 
@@ -345,7 +345,10 @@ private:
         int fd; // may be -1 if device is closed
         const int32_t id;
         const String8 path;
-        const InputDeviceIdentifier identifier;
+        // Not const: the descriptor is assigned when the device is finalized,
+        // after the probe phase, so conflicts with concurrently probed
+        // devices can be resolved.
+        InputDeviceIdentifier identifier;
 
         uint32_t classes;
 
@@ -370,6 +373,11 @@ private:
 
         int32_t controllerNumber;
 
+        // Set while probing a keyboard-class device whose key map makes it a
+        // candidate for the built-in keyboard; the role is claimed when the
+        // device is finalized, once earlier devices have had their chance.
+        bool eligibleForBuiltInKeyboard;
+
         int32_t timestampOverrideSec;
         int32_t timestampOverrideUsec;
 
@@ -393,6 +401,15 @@ private:
     };
 
     status_t openDeviceLocked(const char *devicePath);
+    // Opens and interrogates a device node, producing a fully probed Device
+    // that has not yet been published.  Only touches the device being probed
+    // (plus a read of mExcludedDevices), so multiple probes may run
+    // concurrently while the scanning thread holds the lock.
+    Device* probeDevice(const char* devicePath, int32_t deviceId);
+    // Publishes a probed device: assigns its descriptor, claims the built-in
+    // keyboard role and a controller number if applicable, registers it for
+    // epoll and adds it to mDevices.  Takes ownership of the device.
+    status_t finalizeDeviceLocked(Device* device);
     void createVirtualKeyboardLocked();
     void addDeviceLocked(Device* device);
     void assignDescriptorLocked(InputDeviceIdentifier& identifier);
@@ -417,14 +434,16 @@ private:
     Device* getDeviceLocked(int32_t deviceId) const;
     Device* getDeviceByPathLocked(const char* devicePath) const;
 
-    bool hasKeycodeLocked(Device* device, int keycode) const;
+    // These only examine the given device, so like configureFd they may be
+    // called without the lock held, including from a concurrent probe.
+    bool hasKeycode(Device* device, int keycode) const;
 
-    void loadConfigurationLocked(Device* device);
-    status_t loadVirtualKeyMapLocked(Device* device);
-    status_t loadKeyMapLocked(Device* device);
+    void loadConfiguration(Device* device);
+    status_t loadVirtualKeyMap(Device* device);
+    status_t loadKeyMap(Device* device);
 
-    bool isExternalDeviceLocked(Device* device);
-    bool deviceHasMicLocked(Device* device);
+    bool isExternalDevice(Device* device);
+    bool deviceHasMic(Device* device);
 
     int32_t getNextControllerNumberLocked(Device* device);
     void releaseControllerNumberLocked(Device* device);
@@ -471,8 +490,10 @@ private:
     // Epoll FD list size hint.
     static const int EPOLL_SIZE_HINT = 8;
 
-    // Maximum number of signalled FDs to handle at a time.
-    static const int EPOLL_MAX_EVENTS = 16;
+    // Maximum number of signalled FDs to handle at a time.  Sized so that a
+    // multitouch panel plus several external controllers can all be serviced
+    // from a single epoll_wait() wakeup.
+    static const int EPOLL_MAX_EVENTS = 32;
 
     // The array of pending epoll events and the index of the next event to be handled.
     struct epoll_event mPendingEventItems[EPOLL_MAX_EVENTS];
@@ -244,7 +244,9 @@ InputDispatcher::InputDispatcher(const sp<InputDispatcherPolicyInterface>& polic
     mAppSwitchSawKeyDown(false), mAppSwitchDueTime(LONG_LONG_MAX),
     mNextUnblockedEvent(NULL),
     mDispatchEnabled(false), mDispatchFrozen(false), mInputFilterEnabled(false),
-    mInputTargetWaitCause(INPUT_TARGET_WAIT_CAUSE_NONE) {
+    mInputTargetWaitCause(INPUT_TARGET_WAIT_CAUSE_NONE),
+    mInputTargetWaitEventSeq(0), mInputTargetWaitEvaluatedGeneration(0),
+    mTargetReadinessGeneration(1) {
     mLooper = new Looper(false);
 
     mKeyRepeatState.lastKeyEntry = NULL;
@@ -514,27 +516,55 @@ void InputDispatcher::addRecentEventLocked(EventEntry* entry) {
 
 sp<InputWindowHandle> InputDispatcher::findTouchedWindowAtLocked(int32_t displayId,
         int32_t x, int32_t y) {
-    // Traverse windows from front to back to find touched window.
-    size_t numWindows = mWindowHandles.size();
+    // Traverse touchable windows from front to back to find touched window.
+    // mTouchableWindowsByDisplay already excludes windows on other displays and
+    // windows that are invisible or not touchable, and the cached bounds let us
+    // skip the Region containment test for windows that cannot contain the point.
+    ssize_t index = mTouchableWindowsByDisplay.indexOfKey(displayId);
+    if (index < 0) {
+        return NULL;
+    }
+    const Vector<TouchableWindow>& windows = mTouchableWindowsByDisplay.valueAt(index);
+    size_t numWindows = windows.size();
     for (size_t i = 0; i < numWindows; i++) {
-        sp<InputWindowHandle> windowHandle = mWindowHandles.itemAt(i);
+        const TouchableWindow& window = windows.itemAt(i);
+        if (window.isTouchModal) {
+            // Found window.
+            return window.windowHandle;
+        }
+        if (x >= window.touchableBounds.left && x < window.touchableBounds.right
+                && y >= window.touchableBounds.top && y < window.touchableBounds.bottom
+                && window.windowHandle->getInfo()->touchableRegionContainsPoint(x, y)) {
+            // Found window.
+            return window.windowHandle;
+        }
+    }
+    return NULL;
+}
+
+void InputDispatcher::rebuildTouchableWindowsLocked() {
+    mTouchableWindowsByDisplay.clear();
+    for (size_t i = 0; i < mWindowHandles.size(); i++) {
+        const sp<InputWindowHandle>& windowHandle = mWindowHandles.itemAt(i);
         const InputWindowInfo* windowInfo = windowHandle->getInfo();
-        if (windowInfo->displayId == displayId) {
-            int32_t flags = windowInfo->layoutParamsFlags;
+        int32_t flags = windowInfo->layoutParamsFlags;
+        if (!windowInfo->visible || (flags & InputWindowInfo::FLAG_NOT_TOUCHABLE)) {
+            continue;
+        }
 
-            if (windowInfo->visible) {
-                if (!(flags & InputWindowInfo::FLAG_NOT_TOUCHABLE)) {
-                    bool isTouchModal = (flags & (InputWindowInfo::FLAG_NOT_FOCUSABLE
-                            | InputWindowInfo::FLAG_NOT_TOUCH_MODAL)) == 0;
-                    if (isTouchModal || windowInfo->touchableRegionContainsPoint(x, y)) {
-                        // Found window.
-                        return windowHandle;
-                    }
-                }
-            }
+        TouchableWindow window;
+        window.windowHandle = windowHandle;
+        window.touchableBounds = windowInfo->touchableRegion.getBounds();
+        window.isTouchModal = (flags & (InputWindowInfo::FLAG_NOT_FOCUSABLE
+                | InputWindowInfo::FLAG_NOT_TOUCH_MODAL)) == 0;
+
+        ssize_t index = mTouchableWindowsByDisplay.indexOfKey(windowInfo->displayId);
+        if (index < 0) {
+            index = mTouchableWindowsByDisplay.add(windowInfo->displayId,
+                    Vector<TouchableWindow>());
         }
+        mTouchableWindowsByDisplay.editValueAt(index).add(window);
     }
-    return NULL;
 }
 
 void InputDispatcher::dropInboundEventLocked(EventEntry* entry, DropReason dropReason) {
@@ -829,6 +859,13 @@ bool InputDispatcher::dispatchKeyLocked(nsecs_t currentTime, KeyEntry* entry,
         return true;
     }
 
+    // While we are already waiting for this event's target and nothing
+    // affecting readiness has changed, skip re-running target discovery
+    // and keep waiting.
+    if (isStillWaitingForTargetsLocked(currentTime, entry, nextWakeupTime)) {
+        return false;
+    }
+
     // Identify targets.
     Vector<InputTarget> inputTargets;
     int32_t injectionResult = findFocusedWindowTargetsLocked(currentTime,
@@ -879,6 +916,13 @@ bool InputDispatcher::dispatchMotionLocked(
 
     bool isPointerEvent = entry->source & AINPUT_SOURCE_CLASS_POINTER;
 
+    // While we are already waiting for this event's target and nothing
+    // affecting readiness has changed, skip re-running target discovery
+    // and keep waiting.
+    if (isStillWaitingForTargetsLocked(currentTime, entry, nextWakeupTime)) {
+        return false;
+    }
+
     // Identify targets.
     Vector<InputTarget> inputTargets;
 
@@ -1030,6 +1074,12 @@ int32_t InputDispatcher::handleTargetsNotReadyLocked(nsecs_t currentTime,
         }
     }
 
+    // Remember which event this verdict was computed for and against which
+    // readiness generation, so retries can skip target discovery until
+    // something that could unblock dispatch actually changes.
+    mInputTargetWaitEventSeq = entry->seq;
+    mInputTargetWaitEvaluatedGeneration = mTargetReadinessGeneration;
+
     if (mInputTargetWaitTimeoutExpired) {
         return INPUT_EVENT_INJECTION_TIMED_OUT;
     }
@@ -1106,6 +1156,29 @@ void InputDispatcher::resetANRTimeoutsLocked() {
     mInputTargetWaitApplicationHandle.clear();
 }
 
+bool InputDispatcher::isStillWaitingForTargetsLocked(nsecs_t currentTime,
+        const EventEntry* entry, nsecs_t* nextWakeupTime) {
+    if (mInputTargetWaitCause == INPUT_TARGET_WAIT_CAUSE_NONE
+            || mInputTargetWaitTimeoutExpired
+            || mInputTargetWaitEventSeq != entry->seq
+            || mInputTargetWaitEvaluatedGeneration != mTargetReadinessGeneration
+            || currentTime >= mInputTargetWaitTimeoutTime) {
+        return false;
+    }
+
+    // Nothing that could change the not-ready verdict has happened since the
+    // last full evaluation, so keep waiting without re-running target
+    // discovery over the window list.
+    if (mInputTargetWaitTimeoutTime < *nextWakeupTime) {
+        *nextWakeupTime = mInputTargetWaitTimeoutTime;
+    }
+    return true;
+}
+
+void InputDispatcher::bumpTargetReadinessGenerationLocked() {
+    mTargetReadinessGeneration += 1;
+}
+
 int32_t InputDispatcher::findFocusedWindowTargetsLocked(nsecs_t currentTime,
         const EventEntry* entry, Vector<InputTarget>& inputTargets, nsecs_t* nextWakeupTime) {
     int32_t injectionResult;
@@ -2143,6 +2216,8 @@ void InputDispatcher::abortBrokenDispatchCycleLocked(nsecs_t currentTime,
     drainDispatchQueueLocked(&connection->waitQueue);
     traceWaitQueueLengthLocked(connection);
 
+    bumpTargetReadinessGenerationLocked();
+
     // The connection appears to be unrecoverably broken.
     // Ignore already broken or zombie connections.
     if (connection->status == Connection::STATUS_NORMAL) {
@@ -2490,29 +2565,33 @@ void InputDispatcher::notifyKey(const NotifyKeyArgs* args) {
                 std::to_string(t.duration().count()).c_str());
     }
 
-    bool needWake;
+    // Check the filter flag under the lock, but run the filter and allocate the
+    // new entry without holding it.  The lock was already released around the
+    // filter callback before, so this does not weaken any ordering guarantee; it
+    // just keeps allocation and filtering off the dispatch loop's critical path.
+    bool shouldFilter;
     { // acquire lock
-        mLock.lock();
-
-        if (shouldSendKeyToInputFilterLocked(args)) {
-            mLock.unlock();
-
-            policyFlags |= POLICY_FLAG_FILTERED;
-            if (!mPolicy->filterInputEvent(&event, policyFlags)) {
-                return; // event was consumed by the filter
-            }
+        AutoMutex _l(mLock);
+        shouldFilter = shouldSendKeyToInputFilterLocked(args);
+    } // release lock
 
-            mLock.lock();
+    if (shouldFilter) {
+        policyFlags |= POLICY_FLAG_FILTERED;
+        if (!mPolicy->filterInputEvent(&event, policyFlags)) {
+            return; // event was consumed by the filter
         }
+    }
 
-        int32_t repeatCount = 0;
-        KeyEntry* newEntry = new KeyEntry(args->eventTime,
-                args->deviceId, args->source, policyFlags,
-                args->action, flags, keyCode, args->scanCode,
-                metaState, repeatCount, args->downTime);
+    int32_t repeatCount = 0;
+    KeyEntry* newEntry = new KeyEntry(args->eventTime,
+            args->deviceId, args->source, policyFlags,
+            args->action, flags, keyCode, args->scanCode,
+            metaState, repeatCount, args->downTime);
 
+    bool needWake;
+    { // acquire lock
+        AutoMutex _l(mLock);
         needWake = enqueueInboundEventLocked(newEntry);
-        mLock.unlock();
     } // release lock
 
     if (needWake) {
@@ -2565,39 +2644,41 @@ void InputDispatcher::notifyMotion(const NotifyMotionArgs* args) {
                 std::to_string(t.duration().count()).c_str());
     }
 
-    bool needWake;
+    // As in notifyKey, only the filter flag check and the enqueue itself need the
+    // lock; the filter callback and the entry allocation run without it.
+    bool shouldFilter;
     { // acquire lock
-        mLock.lock();
-
-        if (shouldSendMotionToInputFilterLocked(args)) {
-            mLock.unlock();
-
-            MotionEvent event;
-            event.initialize(args->deviceId, args->source, args->action, args->actionButton,
-                    args->flags, args->edgeFlags, args->metaState, args->buttonState,
-                    0, 0, args->xPrecision, args->yPrecision,
-                    args->downTime, args->eventTime,
-                    args->pointerCount, args->pointerProperties, args->pointerCoords);
+        AutoMutex _l(mLock);
+        shouldFilter = shouldSendMotionToInputFilterLocked(args);
+    } // release lock
 
-            policyFlags |= POLICY_FLAG_FILTERED;
-            if (!mPolicy->filterInputEvent(&event, policyFlags)) {
-                return; // event was consumed by the filter
-            }
+    if (shouldFilter) {
+        MotionEvent event;
+        event.initialize(args->deviceId, args->source, args->action, args->actionButton,
+                args->flags, args->edgeFlags, args->metaState, args->buttonState,
+                0, 0, args->xPrecision, args->yPrecision,
+                args->downTime, args->eventTime,
+                args->pointerCount, args->pointerProperties, args->pointerCoords);
 
-            mLock.lock();
+        policyFlags |= POLICY_FLAG_FILTERED;
+        if (!mPolicy->filterInputEvent(&event, policyFlags)) {
+            return; // event was consumed by the filter
         }
+    }
 
-        // Just enqueue a new motion event.
-        MotionEntry* newEntry = new MotionEntry(args->eventTime,
-                args->deviceId, args->source, policyFlags,
-                args->action, args->actionButton, args->flags,
-                args->metaState, args->buttonState,
-                args->edgeFlags, args->xPrecision, args->yPrecision, args->downTime,
-                args->displayId,
-                args->pointerCount, args->pointerProperties, args->pointerCoords, 0, 0);
+    // Just enqueue a new motion event.
+    MotionEntry* newEntry = new MotionEntry(args->eventTime,
+            args->deviceId, args->source, policyFlags,
+            args->action, args->actionButton, args->flags,
+            args->metaState, args->buttonState,
+            args->edgeFlags, args->xPrecision, args->yPrecision, args->downTime,
+            args->displayId,
+            args->pointerCount, args->pointerProperties, args->pointerCoords, 0, 0);
 
+    bool needWake;
+    { // acquire lock
+        AutoMutex _l(mLock);
         needWake = enqueueInboundEventLocked(newEntry);
-        mLock.unlock();
     } // release lock
 
     if (needWake) {
@@ -2683,7 +2764,6 @@ int32_t InputDispatcher::injectInputEvent(const InputEvent* event, int32_t displ
             }
         }
 
-        mLock.lock();
         firstInjectedEntry = new KeyEntry(keyEvent->getEventTime(),
                 keyEvent->getDeviceId(), keyEvent->getSource(),
                 policyFlags, action, flags,
@@ -2713,7 +2793,6 @@ int32_t InputDispatcher::injectInputEvent(const InputEvent* event, int32_t displ
             }
         }
 
-        mLock.lock();
         const nsecs_t* sampleEventTimes = motionEvent->getSampleEventTimes();
         const PointerCoords* samplePointerCoords = motionEvent->getSamplePointerCoords();
         firstInjectedEntry = new MotionEntry(*sampleEventTimes,
@@ -2757,6 +2836,10 @@ int32_t InputDispatcher::injectInputEvent(const InputEvent* event, int32_t displ
     injectionState->refCount += 1;
     lastInjectedEntry->injectionState = injectionState;
 
+    // The entries and injection state above are private until enqueued, so the
+    // lock is only needed from here on.
+    mLock.lock();
+
     bool needWake = false;
     for (EventEntry* entry = firstInjectedEntry; entry != NULL; ) {
         EventEntry* nextEntry = entry->next;
@@ -2898,17 +2981,6 @@ sp<InputWindowHandle> InputDispatcher::getWindowHandleLocked(
     return NULL;
 }
 
-bool InputDispatcher::hasWindowHandleLocked(
-        const sp<InputWindowHandle>& windowHandle) const {
-    size_t numWindows = mWindowHandles.size();
-    for (size_t i = 0; i < numWindows; i++) {
-        if (mWindowHandles.itemAt(i) == windowHandle) {
-            return true;
-        }
-    }
-    return false;
-}
-
 void InputDispatcher::setInputWindows(const Vector<sp<InputWindowHandle> >& inputWindowHandles) {
 #if DEBUG_FOCUS
     ALOGD("setInputWindows");
@@ -2916,6 +2988,8 @@ void InputDispatcher::setInputWindows(const Vector<sp<InputWindowHandle> >& inpu
     { // acquire lock
         AutoMutex _l(mLock);
 
+        bumpTargetReadinessGenerationLocked();
+
         Vector<sp<InputWindowHandle> > oldWindowHandles = mWindowHandles;
         mWindowHandles = inputWindowHandles;
 
@@ -2935,6 +3009,16 @@ void InputDispatcher::setInputWindows(const Vector<sp<InputWindowHandle> >& inpu
             }
         }
 
+        rebuildTouchableWindowsLocked();
+
+        // Index the surviving handles once so the membership checks below
+        // don't rescan mWindowHandles for every touched and departed window,
+        // which made each update quadratic in the window count.
+        SortedVector<InputWindowHandle*> windowSet;
+        for (size_t i = 0; i < mWindowHandles.size(); i++) {
+            windowSet.add(mWindowHandles.itemAt(i).get());
+        }
+
         if (!foundHoveredWindow) {
             mLastHoverWindowHandle = NULL;
         }
@@ -2966,7 +3050,7 @@ void InputDispatcher::setInputWindows(const Vector<sp<InputWindowHandle> >& inpu
             TouchState& state = mTouchStatesByDisplay.editValueAt(d);
             for (size_t i = 0; i < state.windows.size(); ) {
                 TouchedWindow& touchedWindow = state.windows.editItemAt(i);
-                if (!hasWindowHandleLocked(touchedWindow.windowHandle)) {
+                if (windowSet.indexOf(touchedWindow.windowHandle.get()) < 0) {
 #if DEBUG_FOCUS
                     ALOGD("Touched window was removed: %s",
                             touchedWindow.windowHandle->getName().c_str());
@@ -2992,7 +3076,7 @@ void InputDispatcher::setInputWindows(const Vector<sp<InputWindowHandle> >& inpu
         // which might not happen until the next GC.
         for (size_t i = 0; i < oldWindowHandles.size(); i++) {
             const sp<InputWindowHandle>& oldWindowHandle = oldWindowHandles.itemAt(i);
-            if (!hasWindowHandleLocked(oldWindowHandle)) {
+            if (windowSet.indexOf(oldWindowHandle.get()) < 0) {
 #if DEBUG_FOCUS
                 ALOGD("Window went away: %s", oldWindowHandle->getName().c_str());
 #endif
@@ -3013,6 +3097,8 @@ void InputDispatcher::setFocusedApplication(
     { // acquire lock
         AutoMutex _l(mLock);
 
+        bumpTargetReadinessGenerationLocked();
+
         if (inputApplicationHandle != NULL && inputApplicationHandle->updateInfo()) {
             if (mFocusedApplicationHandle != inputApplicationHandle) {
                 if (mFocusedApplicationHandle != NULL) {
@@ -3057,6 +3143,7 @@ void InputDispatcher::setInputDispatchMode(bool enabled, bool frozen) {
             mDispatchEnabled = enabled;
             mDispatchFrozen = frozen;
             changed = true;
+            bumpTargetReadinessGenerationLocked();
         } else {
             changed = false;
         }
@@ -3086,6 +3173,7 @@ void InputDispatcher::setInputFilterEnabled(bool enabled) {
 
         mInputFilterEnabled = enabled;
         resetAndDropEverythingLocked("input filter is being enabled or disabled");
+        bumpTargetReadinessGenerationLocked();
     } // release lock
 
     // Wake up poll loop since there might be work to do to drop everything.
@@ -3101,6 +3189,8 @@ bool InputDispatcher::transferTouchFocus(const sp<InputChannel>& fromChannel,
     { // acquire lock
         AutoMutex _l(mLock);
 
+        bumpTargetReadinessGenerationLocked();
+
         sp<InputWindowHandle> fromWindowHandle = getWindowHandleLocked(fromChannel);
         sp<InputWindowHandle> toWindowHandle = getWindowHandleLocked(toChannel);
         if (fromWindowHandle == NULL || toWindowHandle == NULL) {
@@ -3423,6 +3513,7 @@ status_t InputDispatcher::registerInputChannel(const sp<InputChannel>& inputChan
         }
 
         mLooper->addFd(fd, 0, ALOOPER_EVENT_INPUT, handleReceiveCallback, this);
+        bumpTargetReadinessGenerationLocked();
     } // release lock
 
     // Wake the looper because some connections have changed.
@@ -3472,6 +3563,7 @@ status_t InputDispatcher::unregisterInputChannelLocked(const sp<InputChannel>& i
     abortBrokenDispatchCycleLocked(currentTime, connection, notify);
 
     connection->status = Connection::STATUS_ZOMBIE;
+    bumpTargetReadinessGenerationLocked();
     return OK;
 }
 
@@ -3624,6 +3716,10 @@ void InputDispatcher::doDispatchCycleFinishedLockedInterruptible(
     uint32_t seq = commandEntry->seq;
     bool handled = commandEntry->handled;
 
+    // The connection's queues are about to shrink, which can unblock a
+    // pending target wait.
+    bumpTargetReadinessGenerationLocked();
+
     // Handle post-event policy actions.
     DispatchEntry* dispatchEntry = connection->findWaitQueueEntry(seq);
     if (dispatchEntry) {
@@ -3888,6 +3984,12 @@ void InputDispatcher::traceWaitQueueLengthLocked(const sp<Connection>& connectio
 }
 
 void InputDispatcher::dump(std::string& dump) {
+    // Reserve room for the state dump before taking the lock.  Formatting the
+    // dispatch state produces tens of kilobytes of small appends; growing the
+    // string while holding mLock stalls the dispatch loop and shows up directly
+    // as input latency during bug reports.
+    dump.reserve(dump.size() + 65536);
+
     AutoMutex _l(mLock);
 
     dump += "Input Dispatcher State:\n";
@@ -3930,6 +4032,41 @@ void InputDispatcher::InjectionState::release() {
 }
 
 
+// --- InputDispatcher::EntryAllocator ---
+
+InputDispatcher::EntryAllocator::EntryAllocator(size_t blockSize) :
+        mBlockSize(blockSize), mFreeList(NULL), mFreeCount(0) {
+}
+
+void* InputDispatcher::EntryAllocator::alloc(size_t size) {
+    ALOG_ASSERT(size <= mBlockSize);
+    { // acquire lock
+        AutoMutex _l(mLock);
+        if (mFreeList) {
+            Block* block = mFreeList;
+            mFreeList = block->next;
+            mFreeCount -= 1;
+            return block;
+        }
+    } // release lock
+    return ::operator new(mBlockSize);
+}
+
+void InputDispatcher::EntryAllocator::dealloc(void* ptr) {
+    { // acquire lock
+        AutoMutex _l(mLock);
+        if (mFreeCount < MAX_FREE_BLOCKS) {
+            Block* block = static_cast<Block*>(ptr);
+            block->next = mFreeList;
+            mFreeList = block;
+            mFreeCount += 1;
+            return;
+        }
+    } // release lock
+    ::operator delete(ptr);
+}
+
+
 // --- InputDispatcher::EventEntry ---
 
 InputDispatcher::EventEntry::EventEntry(int32_t type, nsecs_t eventTime, uint32_t policyFlags) :
@@ -3990,6 +4127,17 @@ void InputDispatcher::DeviceResetEntry::appendDescription(std::string& msg) cons
 
 // --- InputDispatcher::KeyEntry ---
 
+InputDispatcher::EntryAllocator InputDispatcher::KeyEntry::sAllocator(
+        sizeof(InputDispatcher::KeyEntry));
+
+void* InputDispatcher::KeyEntry::operator new(size_t size) {
+    return sAllocator.alloc(size);
+}
+
+void InputDispatcher::KeyEntry::operator delete(void* ptr) {
+    sAllocator.dealloc(ptr);
+}
+
 InputDispatcher::KeyEntry::KeyEntry(nsecs_t eventTime,
         int32_t deviceId, uint32_t source, uint32_t policyFlags, int32_t action,
         int32_t flags, int32_t keyCode, int32_t scanCode, int32_t metaState,
@@ -4025,6 +4173,17 @@ void InputDispatcher::KeyEntry::recycle() {
 
 // --- InputDispatcher::MotionEntry ---
 
+InputDispatcher::EntryAllocator InputDispatcher::MotionEntry::sAllocator(
+        sizeof(InputDispatcher::MotionEntry));
+
+void* InputDispatcher::MotionEntry::operator new(size_t size) {
+    return sAllocator.alloc(size);
+}
+
+void InputDispatcher::MotionEntry::operator delete(void* ptr) {
+    sAllocator.dealloc(ptr);
+}
+
 InputDispatcher::MotionEntry::MotionEntry(nsecs_t eventTime, int32_t deviceId,
         uint32_t source, uint32_t policyFlags, int32_t action, int32_t actionButton,
         int32_t flags, int32_t metaState, int32_t buttonState, int32_t edgeFlags,
@@ -4071,6 +4230,17 @@ void InputDispatcher::MotionEntry::appendDescription(std::string& msg) const {
 
 volatile int32_t InputDispatcher::DispatchEntry::sNextSeqAtomic;
 
+InputDispatcher::EntryAllocator InputDispatcher::DispatchEntry::sAllocator(
+        sizeof(InputDispatcher::DispatchEntry));
+
+void* InputDispatcher::DispatchEntry::operator new(size_t size) {
+    return sAllocator.alloc(size);
+}
+
+void InputDispatcher::DispatchEntry::operator delete(void* ptr) {
+    sAllocator.dealloc(ptr);
+}
+
 InputDispatcher::DispatchEntry::DispatchEntry(EventEntry* eventEntry,
         int32_t targetFlags, float xOffset, float yOffset, float scaleFactor) :
         seq(nextSeq()),
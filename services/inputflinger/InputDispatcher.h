@@ -20,6 +20,7 @@
 #include <input/Input.h>
 #include <input/InputTransport.h>
 #include <utils/KeyedVector.h>
+#include <utils/SortedVector.h>
 #include <utils/Vector.h>
 #include <utils/threads.h>
 #include <utils/Timers.h>
@@ -409,6 +410,33 @@ private:
         inline Link() : next(NULL), prev(NULL) { }
     };
 
+    // Recycling allocator for hot-path entry objects.  A MotionEntry is created
+    // per notifyMotion and a DispatchEntry per target connection, then released
+    // moments later -- thousands of heap round trips per second while dragging.
+    // Freed blocks go onto a bounded freelist and are handed back to the next
+    // allocation, so a warmed-up dispatcher stops touching malloc entirely.
+    // Thread-safe because entries are created on the InputReader thread and
+    // released on the dispatcher thread.
+    class EntryAllocator {
+    public:
+        explicit EntryAllocator(size_t blockSize);
+
+        void* alloc(size_t size);
+        void dealloc(void* ptr);
+
+    private:
+        struct Block {
+            Block* next;
+        };
+
+        static const size_t MAX_FREE_BLOCKS = 64;
+
+        const size_t mBlockSize;
+        Mutex mLock;
+        Block* mFreeList;
+        size_t mFreeCount;
+    };
+
     struct InjectionState {
         mutable int32_t refCount;
 
@@ -500,8 +528,14 @@ private:
         virtual void appendDescription(std::string& msg) const;
         void recycle();
 
+        static void* operator new(size_t size);
+        static void operator delete(void* ptr);
+
     protected:
         virtual ~KeyEntry();
+
+    private:
+        static EntryAllocator sAllocator;
     };
 
     struct MotionEntry : EventEntry {
@@ -532,8 +566,14 @@ private:
                 float xOffset, float yOffset);
         virtual void appendDescription(std::string& msg) const;
 
+        static void* operator new(size_t size);
+        static void operator delete(void* ptr);
+
     protected:
         virtual ~MotionEntry();
+
+    private:
+        static EntryAllocator sAllocator;
     };
 
     // Tracks the progress of dispatching a particular event to a particular connection.
@@ -563,8 +603,12 @@ private:
             return targetFlags & InputTarget::FLAG_SPLIT;
         }
 
+        static void* operator new(size_t size);
+        static void operator delete(void* ptr);
+
     private:
         static volatile int32_t sNextSeqAtomic;
+        static EntryAllocator sAllocator;
 
         static uint32_t nextSeq();
     };
@@ -954,8 +998,22 @@ private:
 
     Vector<sp<InputWindowHandle> > mWindowHandles;
 
+    // Per-display front-to-back list of the windows that can actually receive
+    // touches, with the bounds of each window's touchable region cached.
+    // Rebuilt by setInputWindows, which is the only place window info changes.
+    // findTouchedWindowAtLocked consults this instead of mWindowHandles so the
+    // per-sample hit test skips invisible and untouchable windows and only
+    // evaluates Region containment after a cheap bounding box hit.
+    struct TouchableWindow {
+        sp<InputWindowHandle> windowHandle;
+        Rect touchableBounds;
+        bool isTouchModal;
+    };
+    KeyedVector<int32_t, Vector<TouchableWindow> > mTouchableWindowsByDisplay;
+
+    void rebuildTouchableWindowsLocked();
+
     sp<InputWindowHandle> getWindowHandleLocked(const sp<InputChannel>& inputChannel) const;
-    bool hasWindowHandleLocked(const sp<InputWindowHandle>& windowHandle) const;
 
     // Focus tracking for keys, trackball, etc.
     sp<InputWindowHandle> mFocusedWindowHandle;
@@ -1025,6 +1083,20 @@ private:
     bool mInputTargetWaitTimeoutExpired;
     sp<InputApplicationHandle> mInputTargetWaitApplicationHandle;
 
+    // Sequence number of the event for which the current target wait was
+    // last evaluated, and the value of mTargetReadinessGeneration at that
+    // time.  While both still match and the wait timeout has not fired,
+    // re-running target discovery for the pending event cannot reach a
+    // different verdict, so dispatch skips the window scan and keeps
+    // waiting.
+    uint32_t mInputTargetWaitEventSeq;
+    uint32_t mInputTargetWaitEvaluatedGeneration;
+
+    // Incremented whenever state that can affect target readiness changes:
+    // window or focus updates, connection registration, dispatch mode, a
+    // dispatch cycle completing or aborting, or touch focus transfers.
+    uint32_t mTargetReadinessGeneration;
+
     // Contains the last window which received a hover event.
     sp<InputWindowHandle> mLastHoverWindowHandle;
 
@@ -1037,6 +1109,9 @@ private:
             const sp<InputChannel>& inputChannel);
     nsecs_t getTimeSpentWaitingForApplicationLocked(nsecs_t currentTime);
     void resetANRTimeoutsLocked();
+    bool isStillWaitingForTargetsLocked(nsecs_t currentTime, const EventEntry* entry,
+            nsecs_t* nextWakeupTime);
+    void bumpTargetReadinessGenerationLocked();
 
     int32_t findFocusedWindowTargetsLocked(nsecs_t currentTime, const EventEntry* entry,
             Vector<InputTarget>& inputTargets, nsecs_t* nextWakeupTime);
@@ -378,82 +378,99 @@ void InputReader::loopOnce() {
 
     size_t count = mEventHub->getEvents(timeoutMillis, mEventBuffer, EVENT_BUFFER_SIZE);
 
-    { // acquire lock
-        AutoMutex _l(mLock);
-        mReaderIsAliveCondition.broadcast();
+    // Process the events one device batch at a time, flushing the queued listener
+    // between batches.  This way a mapper pipeline that is expensive for one device
+    // (such as a busy touch screen) does not delay delivery of events that have
+    // already been decoded for other devices.  Batches are processed in arrival
+    // order so events still reach the listener in the order EventHub produced them.
+    size_t processedCount = 0;
+    bool more = true;
+    while (more) {
+        { // acquire lock
+            AutoMutex _l(mLock);
+            if (processedCount == 0) {
+                mReaderIsAliveCondition.broadcast();
+            }
 
-        if (count) {
-            processEventsLocked(mEventBuffer, count);
-        }
+            if (processedCount < count) {
+                processedCount += processEventsLocked(mEventBuffer + processedCount,
+                        count - processedCount);
+            }
+            more = processedCount < count;
 
-        if (mNextTimeout != LLONG_MAX) {
-            nsecs_t now = systemTime(SYSTEM_TIME_MONOTONIC);
-            if (now >= mNextTimeout) {
+            if (!more) {
+                if (mNextTimeout != LLONG_MAX) {
+                    nsecs_t now = systemTime(SYSTEM_TIME_MONOTONIC);
+                    if (now >= mNextTimeout) {
 #if DEBUG_RAW_EVENTS
-                ALOGD("Timeout expired, latency=%0.3fms", (now - mNextTimeout) * 0.000001f);
+                        ALOGD("Timeout expired, latency=%0.3fms",
+                                (now - mNextTimeout) * 0.000001f);
 #endif
-                mNextTimeout = LLONG_MAX;
-                timeoutExpiredLocked(now);
-            }
-        }
-
-        if (oldGeneration != mGeneration) {
-            inputDevicesChanged = true;
-            getInputDevicesLocked(inputDevices);
-        }
-    } // release lock
+                        mNextTimeout = LLONG_MAX;
+                        timeoutExpiredLocked(now);
+                    }
+                }
 
-    // Send out a message that the describes the changed input devices.
-    if (inputDevicesChanged) {
-        mPolicy->notifyInputDevicesChanged(inputDevices);
-    }
-
-    // Flush queued events out to the listener.
-    // This must happen outside of the lock because the listener could potentially call
-    // back into the InputReader's methods, such as getScanCodeState, or become blocked
-    // on another thread similarly waiting to acquire the InputReader lock thereby
-    // resulting in a deadlock.  This situation is actually quite plausible because the
-    // listener is actually the input dispatcher, which calls into the window manager,
-    // which occasionally calls into the input reader.
-    mQueuedListener->flush();
-}
-
-void InputReader::processEventsLocked(const RawEvent* rawEvents, size_t count) {
-    for (const RawEvent* rawEvent = rawEvents; count;) {
-        int32_t type = rawEvent->type;
-        size_t batchSize = 1;
-        if (type < EventHubInterface::FIRST_SYNTHETIC_EVENT) {
-            int32_t deviceId = rawEvent->deviceId;
-            while (batchSize < count) {
-                if (rawEvent[batchSize].type >= EventHubInterface::FIRST_SYNTHETIC_EVENT
-                        || rawEvent[batchSize].deviceId != deviceId) {
-                    break;
+                if (oldGeneration != mGeneration) {
+                    inputDevicesChanged = true;
+                    getInputDevicesLocked(inputDevices);
                 }
-                batchSize += 1;
             }
-#if DEBUG_RAW_EVENTS
-            ALOGD("BatchSize: %zu Count: %zu", batchSize, count);
-#endif
-            processEventsForDeviceLocked(deviceId, rawEvent, batchSize);
-        } else {
-            switch (rawEvent->type) {
-            case EventHubInterface::DEVICE_ADDED:
-                addDeviceLocked(rawEvent->when, rawEvent->deviceId);
-                break;
-            case EventHubInterface::DEVICE_REMOVED:
-                removeDeviceLocked(rawEvent->when, rawEvent->deviceId);
-                break;
-            case EventHubInterface::FINISHED_DEVICE_SCAN:
-                handleConfigurationChangedLocked(rawEvent->when);
-                break;
-            default:
-                ALOG_ASSERT(false); // can't happen
+        } // release lock
+
+        // Send out a message that the describes the changed input devices.
+        if (inputDevicesChanged) {
+            mPolicy->notifyInputDevicesChanged(inputDevices);
+        }
+
+        // Flush queued events out to the listener.
+        // This must happen outside of the lock because the listener could potentially call
+        // back into the InputReader's methods, such as getScanCodeState, or become blocked
+        // on another thread similarly waiting to acquire the InputReader lock thereby
+        // resulting in a deadlock.  This situation is actually quite plausible because the
+        // listener is actually the input dispatcher, which calls into the window manager,
+        // which occasionally calls into the input reader.
+        mQueuedListener->flush();
+    }
+}
+
+size_t InputReader::processEventsLocked(const RawEvent* rawEvents, size_t count) {
+    // Process a single contiguous batch of events belonging to one device (or one
+    // synthetic event) and return the number of events consumed.  The caller loops
+    // over the buffer and may release the lock between batches.
+    const RawEvent* rawEvent = rawEvents;
+    int32_t type = rawEvent->type;
+    size_t batchSize = 1;
+    if (type < EventHubInterface::FIRST_SYNTHETIC_EVENT) {
+        int32_t deviceId = rawEvent->deviceId;
+        while (batchSize < count) {
+            if (rawEvent[batchSize].type >= EventHubInterface::FIRST_SYNTHETIC_EVENT
+                    || rawEvent[batchSize].deviceId != deviceId) {
                 break;
             }
+            batchSize += 1;
+        }
+#if DEBUG_RAW_EVENTS
+        ALOGD("BatchSize: %zu Count: %zu", batchSize, count);
+#endif
+        processEventsForDeviceLocked(deviceId, rawEvent, batchSize);
+    } else {
+        switch (rawEvent->type) {
+        case EventHubInterface::DEVICE_ADDED:
+            addDeviceLocked(rawEvent->when, rawEvent->deviceId);
+            break;
+        case EventHubInterface::DEVICE_REMOVED:
+            removeDeviceLocked(rawEvent->when, rawEvent->deviceId);
+            break;
+        case EventHubInterface::FINISHED_DEVICE_SCAN:
+            handleConfigurationChangedLocked(rawEvent->when);
+            break;
+        default:
+            ALOG_ASSERT(false); // can't happen
+            break;
         }
-        count -= batchSize;
-        rawEvent += batchSize;
     }
+    return batchSize;
 }
 
 void InputReader::addDeviceLocked(nsecs_t when, int32_t deviceId) {
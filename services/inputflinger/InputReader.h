@@ -477,14 +477,16 @@ private:
 
     InputReaderConfiguration mConfig;
 
-    // The event queue.
-    static const int EVENT_BUFFER_SIZE = 256;
+    // The event queue.  Sized so that a single getEvents() call can absorb a
+    // burst of multitouch frames from a 10-point panel plus events from several
+    // external controllers without spilling into a second loop iteration.
+    static const int EVENT_BUFFER_SIZE = 512;
     RawEvent mEventBuffer[EVENT_BUFFER_SIZE];
 
     KeyedVector<int32_t, InputDevice*> mDevices;
 
     // low-level input event decoding and device management
-    void processEventsLocked(const RawEvent* rawEvents, size_t count);
+    size_t processEventsLocked(const RawEvent* rawEvents, size_t count);
 
     void addDeviceLocked(nsecs_t when, int32_t deviceId);
     void removeDeviceLocked(nsecs_t when, int32_t deviceId);
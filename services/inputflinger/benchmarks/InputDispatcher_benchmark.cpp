@@ -0,0 +1,381 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../InputDispatcher.h"
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+#include <poll.h>
+#include <unistd.h>
+
+#include <input/InputTransport.h>
+#include <utils/Timers.h>
+
+namespace android {
+
+// An arbitrary device id.
+static const int32_t DEVICE_ID = 1;
+
+// The default display id.
+static const int32_t DISPLAY_ID = 0;
+
+// Displayed area covered by the target window.
+static const int32_t DISPLAY_WIDTH = 1080;
+static const int32_t DISPLAY_HEIGHT = 1920;
+
+// Dispatching timeout, generous so that a loaded benchmark host does not trip ANRs.
+static const nsecs_t DISPATCHING_TIMEOUT = seconds_to_nanoseconds(5);
+
+
+// --- BenchmarkDispatcherPolicy ---
+
+// A policy implementation that does nothing, so that measurements reflect the
+// dispatcher itself rather than policy callbacks.
+class BenchmarkDispatcherPolicy : public InputDispatcherPolicyInterface {
+protected:
+    virtual ~BenchmarkDispatcherPolicy() {
+    }
+
+public:
+    BenchmarkDispatcherPolicy() {
+    }
+
+private:
+    virtual void notifyConfigurationChanged(nsecs_t) {
+    }
+
+    virtual nsecs_t notifyANR(const sp<InputApplicationHandle>&,
+            const sp<InputWindowHandle>&,
+            const std::string&) {
+        return 0;
+    }
+
+    virtual void notifyInputChannelBroken(const sp<InputWindowHandle>&) {
+    }
+
+    virtual void getDispatcherConfiguration(InputDispatcherConfiguration* outConfig) {
+        *outConfig = InputDispatcherConfiguration();
+    }
+
+    virtual bool filterInputEvent(const InputEvent*, uint32_t) {
+        return true;
+    }
+
+    virtual void interceptKeyBeforeQueueing(const KeyEvent*, uint32_t&) {
+    }
+
+    virtual void interceptMotionBeforeQueueing(nsecs_t, uint32_t&) {
+    }
+
+    virtual nsecs_t interceptKeyBeforeDispatching(const sp<InputWindowHandle>&,
+            const KeyEvent*, uint32_t) {
+        return 0;
+    }
+
+    virtual bool dispatchUnhandledKey(const sp<InputWindowHandle>&,
+            const KeyEvent*, uint32_t, KeyEvent*) {
+        return false;
+    }
+
+    virtual void notifySwitch(nsecs_t, uint32_t, uint32_t, uint32_t) {
+    }
+
+    virtual void pokeUserActivity(nsecs_t, int32_t) {
+    }
+
+    virtual bool checkInjectEventsPermissionNonReentrant(int32_t, int32_t) {
+        return false;
+    }
+};
+
+
+// --- BenchmarkApplicationHandle ---
+
+class BenchmarkApplicationHandle : public InputApplicationHandle {
+public:
+    virtual bool updateInfo() {
+        if (!mInfo) {
+            mInfo = new InputApplicationInfo();
+            mInfo->name = "BenchmarkApplication";
+            mInfo->dispatchingTimeout = DISPATCHING_TIMEOUT;
+        }
+        return true;
+    }
+};
+
+
+// --- BenchmarkWindowHandle ---
+
+class BenchmarkWindowHandle : public InputWindowHandle {
+public:
+    BenchmarkWindowHandle(const sp<InputApplicationHandle>& inputApplicationHandle,
+            const sp<InputChannel>& inputChannel, const std::string& name,
+            const Rect& frame, int32_t layoutParamsFlags) :
+            InputWindowHandle(inputApplicationHandle),
+            mInputChannel(inputChannel), mName(name), mFrame(frame),
+            mLayoutParamsFlags(layoutParamsFlags) {
+    }
+
+    virtual bool updateInfo() {
+        if (!mInfo) {
+            mInfo = new InputWindowInfo();
+        }
+        mInfo->inputChannel = mInputChannel;
+        mInfo->name = mName;
+        mInfo->layoutParamsFlags = mLayoutParamsFlags;
+        mInfo->layoutParamsType = InputWindowInfo::TYPE_BASE_APPLICATION;
+        mInfo->dispatchingTimeout = DISPATCHING_TIMEOUT;
+        mInfo->frameLeft = mFrame.left;
+        mInfo->frameTop = mFrame.top;
+        mInfo->frameRight = mFrame.right;
+        mInfo->frameBottom = mFrame.bottom;
+        mInfo->scaleFactor = 1.0f;
+        mInfo->touchableRegion.clear();
+        mInfo->addTouchableRegion(mFrame);
+        mInfo->visible = true;
+        mInfo->canReceiveKeys = true;
+        mInfo->hasFocus = true;
+        mInfo->hasWallpaper = false;
+        mInfo->paused = false;
+        mInfo->layer = 0;
+        mInfo->ownerPid = getpid();
+        mInfo->ownerUid = getuid();
+        mInfo->inputFeatures = 0;
+        mInfo->displayId = DISPLAY_ID;
+        return true;
+    }
+
+private:
+    sp<InputChannel> mInputChannel;
+    std::string mName;
+    Rect mFrame;
+    int32_t mLayoutParamsFlags;
+};
+
+
+// --- ConsumerThread ---
+
+// Consumes events from the client end of an input channel, acknowledges them,
+// and records the notify-to-consume latency of each move event.
+class ConsumerThread {
+public:
+    explicit ConsumerThread(const sp<InputChannel>& channel) :
+            mConsumer(channel), mExiting(false) {
+        mThread = std::thread(&ConsumerThread::loop, this);
+    }
+
+    void stopAndJoin() {
+        mExiting = true;
+        mThread.join();
+    }
+
+    const std::vector<nsecs_t>& getLatencySamples() const {
+        return mLatencySamples;
+    }
+
+private:
+    void loop() {
+        struct pollfd pfd;
+        pfd.fd = mConsumer.getChannel()->getFd();
+        pfd.events = POLLIN;
+        while (!mExiting) {
+            pfd.revents = 0;
+            poll(&pfd, 1, 10);
+
+            uint32_t seq;
+            InputEvent* event;
+            int32_t displayId;
+            while (mConsumer.consume(&mFactory, true /*consumeBatches*/, -1,
+                    &seq, &event, &displayId) == OK) {
+                nsecs_t now = systemTime(SYSTEM_TIME_MONOTONIC);
+                mConsumer.sendFinishedSignal(seq, true);
+                if (event->getType() == AINPUT_EVENT_TYPE_MOTION) {
+                    MotionEvent* motionEvent = static_cast<MotionEvent*>(event);
+                    if (motionEvent->getAction() == AMOTION_EVENT_ACTION_MOVE) {
+                        mLatencySamples.push_back(now - motionEvent->getEventTime());
+                    }
+                }
+            }
+        }
+    }
+
+    InputConsumer mConsumer;
+    PreallocatedInputEventFactory mFactory;
+    volatile bool mExiting;
+    std::thread mThread;
+    std::vector<nsecs_t> mLatencySamples;
+};
+
+
+static nsecs_t percentile(std::vector<nsecs_t> samples, int32_t p) {
+    if (samples.empty()) {
+        return 0;
+    }
+    std::sort(samples.begin(), samples.end());
+    return samples[(samples.size() - 1) * p / 100];
+}
+
+static NotifyMotionArgs makeMotionArgs(int32_t action, nsecs_t eventTime, nsecs_t downTime) {
+    PointerProperties pointerProperties[1];
+    PointerCoords pointerCoords[1];
+    pointerProperties[0].clear();
+    pointerProperties[0].id = 0;
+    pointerProperties[0].toolType = AMOTION_EVENT_TOOL_TYPE_FINGER;
+    pointerCoords[0].clear();
+    pointerCoords[0].setAxisValue(AMOTION_EVENT_AXIS_X, DISPLAY_WIDTH / 2);
+    pointerCoords[0].setAxisValue(AMOTION_EVENT_AXIS_Y, DISPLAY_HEIGHT / 2);
+
+    return NotifyMotionArgs(eventTime, DEVICE_ID, AINPUT_SOURCE_TOUCHSCREEN,
+            POLICY_FLAG_TRUSTED | POLICY_FLAG_PASS_TO_USER,
+            action, 0 /*actionButton*/, 0 /*flags*/, AMETA_NONE, 0 /*buttonState*/,
+            AMOTION_EVENT_EDGE_FLAG_NONE, DISPLAY_ID, 0 /*deviceTimestamp*/,
+            1 /*pointerCount*/, pointerProperties, pointerCoords,
+            0 /*xPrecision*/, 0 /*yPrecision*/, downTime);
+}
+
+/*
+ * Measures the latency from InputDispatcher::notifyMotion to consumption on the
+ * client end of the target window's input channel.  This covers the dispatcher's
+ * inbound queue, window hit testing, the dispatch cycle and the transport.
+ *
+ * Arguments: { window count, event rate in Hz }.  The extra windows are placed
+ * in front of the target window but away from the touch point, so hit testing
+ * has to walk past all of them.
+ */
+static void dispatchMotionLatency(benchmark::State& state) {
+    const size_t windowCount = size_t(state.range(0));
+    const nsecs_t eventPeriod = seconds_to_nanoseconds(1) / state.range(1);
+
+    sp<BenchmarkDispatcherPolicy> policy = new BenchmarkDispatcherPolicy();
+    sp<InputDispatcher> dispatcher = new InputDispatcher(policy);
+    dispatcher->setInputDispatchMode(true /*enabled*/, false /*frozen*/);
+    sp<InputDispatcherThread> dispatcherThread = new InputDispatcherThread(dispatcher);
+    dispatcherThread->run("InputDispatcher", PRIORITY_URGENT_DISPLAY);
+
+    sp<InputChannel> serverChannel, clientChannel;
+    InputChannel::openInputChannelPair("benchmark", serverChannel, clientChannel);
+
+    sp<BenchmarkApplicationHandle> application = new BenchmarkApplicationHandle();
+    Vector<sp<InputWindowHandle> > windowHandles;
+    for (size_t i = 1; i < windowCount; i++) {
+        // Decoy windows in front of the target, outside the touched area.
+        windowHandles.push(new BenchmarkWindowHandle(application, NULL,
+                "Decoy", Rect(0, 0, 10, 10),
+                InputWindowInfo::FLAG_NOT_FOCUSABLE
+                        | InputWindowInfo::FLAG_NOT_TOUCH_MODAL));
+    }
+    sp<BenchmarkWindowHandle> target = new BenchmarkWindowHandle(application, serverChannel,
+            "Target", Rect(0, 0, DISPLAY_WIDTH, DISPLAY_HEIGHT), 0);
+    windowHandles.push(target);
+
+    dispatcher->registerInputChannel(serverChannel, target, false /*monitor*/);
+    dispatcher->setInputWindows(windowHandles);
+
+    ConsumerThread consumer(clientChannel);
+
+    nsecs_t downTime = systemTime(SYSTEM_TIME_MONOTONIC);
+    NotifyMotionArgs downArgs = makeMotionArgs(AMOTION_EVENT_ACTION_DOWN, downTime, downTime);
+    dispatcher->notifyMotion(&downArgs);
+
+    nsecs_t nextEventTime = downTime + eventPeriod;
+    for (auto _ : state) {
+        nsecs_t now = systemTime(SYSTEM_TIME_MONOTONIC);
+        if (now < nextEventTime) {
+            usleep((nextEventTime - now) / 1000);
+            now = systemTime(SYSTEM_TIME_MONOTONIC);
+        }
+        NotifyMotionArgs moveArgs = makeMotionArgs(AMOTION_EVENT_ACTION_MOVE, now, downTime);
+        dispatcher->notifyMotion(&moveArgs);
+        nextEventTime += eventPeriod;
+    }
+
+    nsecs_t upTime = systemTime(SYSTEM_TIME_MONOTONIC);
+    NotifyMotionArgs upArgs = makeMotionArgs(AMOTION_EVENT_ACTION_UP, upTime, downTime);
+    dispatcher->notifyMotion(&upArgs);
+
+    // Give the dispatcher and consumer a moment to drain in-flight events.
+    usleep(50 * 1000);
+    consumer.stopAndJoin();
+
+    dispatcher->unregisterInputChannel(serverChannel);
+    dispatcherThread->requestExit();
+    dispatcher->setInputDispatchMode(false /*enabled*/, false /*frozen*/);
+    dispatcherThread->requestExitAndWait();
+
+    const std::vector<nsecs_t>& samples = consumer.getLatencySamples();
+    state.counters["samples"] = samples.size();
+    state.counters["latency_p50_us"] = percentile(samples, 50) / 1000.0;
+    state.counters["latency_p90_us"] = percentile(samples, 90) / 1000.0;
+    state.counters["latency_p99_us"] = percentile(samples, 99) / 1000.0;
+}
+
+BENCHMARK(dispatchMotionLatency)
+        ->Args({1, 120})
+        ->Args({8, 120})
+        ->Args({32, 120})
+        ->Args({8, 1000})
+        ->UseRealTime();
+
+
+/*
+ * Measures the transport stage in isolation: publishing a motion event on one
+ * end of an input channel and consuming it on the other, without a dispatcher.
+ */
+static void transportMotionRoundTrip(benchmark::State& state) {
+    sp<InputChannel> serverChannel, clientChannel;
+    InputChannel::openInputChannelPair("benchmark", serverChannel, clientChannel);
+
+    InputPublisher publisher(serverChannel);
+    InputConsumer consumer(clientChannel);
+    PreallocatedInputEventFactory factory;
+
+    PointerProperties pointerProperties[1];
+    PointerCoords pointerCoords[1];
+    pointerProperties[0].clear();
+    pointerProperties[0].id = 0;
+    pointerProperties[0].toolType = AMOTION_EVENT_TOOL_TYPE_FINGER;
+    pointerCoords[0].clear();
+
+    uint32_t publishedSeq = 0;
+    for (auto _ : state) {
+        nsecs_t now = systemTime(SYSTEM_TIME_MONOTONIC);
+        publisher.publishMotionEvent(++publishedSeq, DEVICE_ID, AINPUT_SOURCE_TOUCHSCREEN,
+                DISPLAY_ID, AMOTION_EVENT_ACTION_MOVE, 0, 0, AMOTION_EVENT_EDGE_FLAG_NONE,
+                AMETA_NONE, 0 /*buttonState*/, 0 /*xOffset*/, 0 /*yOffset*/,
+                0 /*xPrecision*/, 0 /*yPrecision*/, now, now, 1, pointerProperties,
+                pointerCoords);
+
+        uint32_t seq;
+        InputEvent* event;
+        int32_t displayId;
+        consumer.consume(&factory, true /*consumeBatches*/, -1, &seq, &event, &displayId);
+        consumer.sendFinishedSignal(seq, true);
+
+        uint32_t finishedSeq;
+        bool handled;
+        publisher.receiveFinishedSignal(&finishedSeq, &handled);
+    }
+}
+
+BENCHMARK(transportMotionRoundTrip);
+
+} // namespace android
+
+BENCHMARK_MAIN();
@@ -0,0 +1,139 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "WakeLockClient"
+//#define LOG_NDEBUG 0
+#include <utils/Log.h>
+
+#include <binder/Binder.h>
+#include <powermanager/WakeLockClient.h>
+#include <utils/String8.h>
+
+namespace android {
+
+WakeLockClient::WakeLockClient(const sp<IPowerManager>& powerManager, int flags,
+                               const String16& tag, const String16& packageName,
+                               nsecs_t lingerNs)
+      : mPowerManager(powerManager),
+        mToken(new BBinder()),
+        mFlags(flags),
+        mTag(tag),
+        mPackageName(packageName),
+        mLingerNs(lingerNs),
+        mCount(0),
+        mHeldRemotely(false),
+        mReleasePending(false),
+        mReleaseDeadline(0),
+        mExiting(false) {
+    mLingerThread = std::thread([this]() { lingerLoop(); });
+}
+
+WakeLockClient::~WakeLockClient() {
+    {
+        std::lock_guard<std::mutex> _l(mLock);
+        if (mHeldRemotely) {
+            releaseRemoteLocked();
+        }
+        mExiting = true;
+    }
+    mCondition.notify_all();
+    mLingerThread.join();
+}
+
+status_t WakeLockClient::acquire() {
+    std::lock_guard<std::mutex> _l(mLock);
+    if (mCount++ > 0 || mHeldRemotely) {
+        // Already held, or still held by a lingering release; the pending
+        // release is simply disarmed and no transaction is needed.
+        mReleasePending = false;
+        return NO_ERROR;
+    }
+
+    status_t err = mPowerManager->acquireWakeLock(mFlags, mToken, mTag, mPackageName);
+    if (err != NO_ERROR) {
+        ALOGW("acquireWakeLock() for tag '%s' failed: %d", String8(mTag).string(), err);
+        mCount--;
+        return err;
+    }
+    mHeldRemotely = true;
+    return NO_ERROR;
+}
+
+status_t WakeLockClient::release() {
+    std::lock_guard<std::mutex> _l(mLock);
+    if (mCount <= 0) {
+        ALOGW("release() for tag '%s' without matching acquire()", String8(mTag).string());
+        return BAD_VALUE;
+    }
+    if (--mCount > 0) {
+        return NO_ERROR;
+    }
+
+    // Last local reference: hold the service-side lock for the linger
+    // interval in case the caller re-acquires, and let the linger thread
+    // issue the real release.
+    mReleasePending = true;
+    mReleaseDeadline = systemTime(SYSTEM_TIME_MONOTONIC) + mLingerNs;
+    mCondition.notify_all();
+    return NO_ERROR;
+}
+
+status_t WakeLockClient::flush() {
+    std::lock_guard<std::mutex> _l(mLock);
+    if (mCount > 0 || !mHeldRemotely) {
+        return NO_ERROR;
+    }
+    mReleasePending = false;
+    return releaseRemoteLocked();
+}
+
+bool WakeLockClient::isHeldRemotely() const {
+    std::lock_guard<std::mutex> _l(mLock);
+    return mHeldRemotely;
+}
+
+status_t WakeLockClient::releaseRemoteLocked() {
+    status_t err = mPowerManager->releaseWakeLock(mToken, 0);
+    if (err != NO_ERROR) {
+        ALOGW("releaseWakeLock() for tag '%s' failed: %d", String8(mTag).string(), err);
+    }
+    // The token is dropped from our bookkeeping even on error; the service
+    // cleans up a client's locks via the token's death notification.
+    mHeldRemotely = false;
+    return err;
+}
+
+void WakeLockClient::lingerLoop() {
+    std::unique_lock<std::mutex> _l(mLock);
+    while (!mExiting) {
+        if (!mReleasePending) {
+            mCondition.wait(_l);
+            continue;
+        }
+        const nsecs_t now = systemTime(SYSTEM_TIME_MONOTONIC);
+        if (now < mReleaseDeadline) {
+            mCondition.wait_for(_l, std::chrono::nanoseconds(mReleaseDeadline - now));
+            continue;
+        }
+        // The deadline passed with no re-acquire; release for real. A racing
+        // acquire() blocked on mLock will see mHeldRemotely == false and
+        // issue a fresh transaction.
+        mReleasePending = false;
+        releaseRemoteLocked();
+    }
+}
+
+} // namespace android
@@ -17,6 +17,8 @@
 
 #include "SchedulingPolicyService.h"
 
+#include <stdlib.h> // for arc4random_buf
+
 #include <private/android_filesystem_config.h> // for AID_CAMERASERVER
 
 #include <log/log.h>
@@ -35,20 +37,62 @@ bool SchedulingPolicyService::isAllowed() {
     return IPCThreadState::self()->getCallingUid() == AID_CAMERASERVER;
 }
 
-Return<bool> SchedulingPolicyService::requestPriority(int32_t pid, int32_t tid, int32_t priority) {
-    if (priority < static_cast<int32_t>(Priority::MIN) ||
-            priority > static_cast<int32_t>(Priority::MAX)) {
+bool SchedulingPolicyService::isTokenValid(uint64_t token) {
+    using ::android::hardware::IPCThreadState;
+
+    if (token == 0) {
         return false;
     }
+    std::lock_guard<std::mutex> _l(mTokenLock);
+    auto it = mTokens.find(token);
+    return it != mTokens.end() && it->second == IPCThreadState::self()->getCallingUid();
+}
+
+uint64_t SchedulingPolicyService::acquireAuthorizationToken() {
+    using ::android::hardware::IPCThreadState;
 
     if (!isAllowed()) {
+        return 0;
+    }
+
+    std::lock_guard<std::mutex> _l(mTokenLock);
+    uint64_t token;
+    do {
+        arc4random_buf(&token, sizeof(token));
+    } while (token == 0 || mTokens.count(token) != 0);
+    mTokens[token] = IPCThreadState::self()->getCallingUid();
+    return token;
+}
+
+bool SchedulingPolicyService::requestPriorityBatch(
+        int32_t pid, const std::vector<std::pair<int32_t, int32_t>>& tidPriorities,
+        uint64_t token) {
+    // Validate every entry before touching anything so an out-of-range
+    // priority rejects the whole batch rather than half of it.
+    for (const auto& tidPriority : tidPriorities) {
+        if (tidPriority.second < static_cast<int32_t>(Priority::MIN) ||
+                tidPriority.second > static_cast<int32_t>(Priority::MAX)) {
+            return false;
+        }
+    }
+
+    // One policy evaluation for the whole batch; a valid token replaces it.
+    if (!isTokenValid(token) && !isAllowed()) {
         return false;
     }
 
-    // TODO(b/37226359): decouple from and remove AIDL service
-    // this should always be allowed since we are in system_server.
-    int value = ::android::requestPriority(pid, tid, priority, false /* isForApp */);
-    return value == 0 /* success */;
+    bool ok = true;
+    for (const auto& tidPriority : tidPriorities) {
+        // TODO(b/37226359): decouple from and remove AIDL service
+        // this should always be allowed since we are in system_server.
+        ok &= ::android::requestPriority(pid, tidPriority.first, tidPriority.second,
+                                         false /* isForApp */) == 0;
+    }
+    return ok;
+}
+
+Return<bool> SchedulingPolicyService::requestPriority(int32_t pid, int32_t tid, int32_t priority) {
+    return requestPriorityBatch(pid, {{tid, priority}});
 }
 
 Return<int32_t> SchedulingPolicyService::getMaxAllowedPriority() {
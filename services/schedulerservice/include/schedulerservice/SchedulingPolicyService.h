@@ -15,6 +15,11 @@
  */
 #pragma once
 
+#include <map>
+#include <mutex>
+#include <utility>
+#include <vector>
+
 #include <android/frameworks/schedulerservice/1.0/ISchedulingPolicyService.h>
 #include <hidl/MQDescriptor.h>
 #include <hidl/Status.h>
@@ -39,8 +44,33 @@ using ::android::sp;
 struct SchedulingPolicyService : public ISchedulingPolicyService {
     Return<bool> requestPriority(int32_t pid, int32_t tid, int32_t priority) override;
     Return<int32_t> getMaxAllowedPriority() override;
+
+    // Promotes a set of threads of |pid| with a single policy evaluation
+    // instead of one per tid. The whole batch is validated before anything
+    // is applied; application itself is best effort, since a tid can exit
+    // mid-batch. A nonzero |token| from acquireAuthorizationToken() stands
+    // in for the policy check, so re-promotions after a thread restart skip
+    // it entirely.
+    //
+    // ISchedulingPolicyService 1.0 is frozen in frameworks/hardware/
+    // interfaces, so these are not reachable over HIDL yet; they carry the
+    // batching logic for the interface uprev and for in-process callers.
+    bool requestPriorityBatch(int32_t pid,
+                              const std::vector<std::pair<int32_t, int32_t>>& tidPriorities,
+                              uint64_t token = 0);
+
+    // Returns a token bound to the calling uid's current authorization, or 0
+    // if the caller is not allowed. Tokens stay valid for the life of the
+    // service process.
+    uint64_t acquireAuthorizationToken();
+
 private:
     bool isAllowed();
+    bool isTokenValid(uint64_t token);
+
+    std::mutex mTokenLock;
+    // token -> uid it was granted to; checked against the caller on use.
+    std::map<uint64_t, uid_t> mTokens;
 };
 
 }  // namespace implementation
@@ -465,9 +465,10 @@ void Fusion::predict(const vec3_t& w, float dT) {
     const mat33_t I33dT(dT);
     const mat33_t wx(crossMatrix(we, 0));
     const mat33_t wx2(wx*wx);
-    const float lwedT = length(we)*dT;
+    const float lwe = length(we);
+    const float lwedT = lwe*dT;
     const float hlwedT = 0.5f*lwedT;
-    const float ilwe = 1.f/length(we);
+    const float ilwe = 1.f/lwe;
     const float k0 = (1-cosf(lwedT))*(ilwe*ilwe);
     const float k1 = sinf(lwedT);
     const float k2 = cosf(hlwedT);
@@ -487,7 +488,28 @@ void Fusion::predict(const vec3_t& w, float dT) {
     if (x0.w < 0)
         x0 = -x0;
 
-    P = Phi*P*transpose(Phi) + GQGt;
+    // P = Phi*P*transpose(Phi) + GQGt
+    //
+    // The zero and identity blocks of Phi make most of the generic 6x6 triple
+    // product redundant.  With Phi = | Phi00 Phi10 | expanding the blocks by
+    //                                |   0     1   |
+    // hand leaves six 3x3 multiplies instead of sixteen:
+    //
+    //  X    = Phi00*P01 + Phi10*P11
+    //  P00' = (Phi00*P00 + Phi10*P01')*Phi00' + X*Phi10'
+    //  P01' = X
+    //  P11' = P11
+    //
+    {
+        const mat33_t P00(P[0][0]);
+        const mat33_t P01(P[1][0]);
+        const mat33_t X(Phi[0][0]*P01 + Phi[1][0]*P[1][1]);
+        P[0][0] = (Phi[0][0]*P00 + Phi[1][0]*transpose(P01))*transpose(Phi[0][0])
+                + X*transpose(Phi[1][0]) + GQGt[0][0];
+        P[1][0] = X + GQGt[1][0];
+        P[0][1] = transpose(P[1][0]);
+        P[1][1] += GQGt[1][1];
+    }
 
     checkState();
 }
@@ -20,28 +20,53 @@
 #include <utils/Timers.h>
 
 #include <inttypes.h>
+#include <string.h>
 
 namespace android {
 namespace SensorServiceUtil {
 
 namespace {
-    constexpr size_t LOG_SIZE = 10;
-    constexpr size_t LOG_SIZE_LARGE = 50;  // larger samples for debugging
+    constexpr size_t LOG_SIZE = 20;
+    constexpr size_t LOG_SIZE_LARGE = 100;  // larger samples for debugging
 }// unnamed namespace
 
 RecentEventLogger::RecentEventLogger(int sensorType) :
         mSensorType(sensorType), mEventSize(eventSizeBySensorType(mSensorType)),
-        mRecentEvents(logSizeBySensorType(sensorType)), mMaskData(false) {
-    // blank
+        mLogSize(logSizeBySensorType(sensorType)),
+        mValuesPerEvent(valuesPerEventBySensorType(sensorType, mEventSize)),
+        mHistoryNext(0), mHistoryCount(0), mHasLastEvent(false), mMaskData(false) {
+    mHistoryHeaders.resize(mLogSize);
+    mHistoryValues.resize(mLogSize * mValuesPerEvent);
 }
 
 void RecentEventLogger::addEvent(const sensors_event_t& event) {
+    timespec wallTime;
+    clock_gettime(CLOCK_REALTIME, &wallTime);
+
     std::lock_guard<std::mutex> lk(mLock);
-    mRecentEvents.emplace(event);
+    CompactEventLog& log = mHistoryHeaders[mHistoryNext];
+    log.mTimestamp = event.timestamp;
+    log.mWallTimeSec = wallTime.tv_sec;
+    log.mWallTimeMs = int32_t(ns2ms(wallTime.tv_nsec));
+
+    float* values = &mHistoryValues[mHistoryNext * mValuesPerEvent];
+    if (mSensorType == SENSOR_TYPE_STEP_COUNTER) {
+        memcpy(values, &event.u64.step_counter, sizeof(uint64_t));
+    } else {
+        memcpy(values, event.data, mValuesPerEvent * sizeof(float));
+    }
+
+    mHistoryNext = (mHistoryNext + 1) % mLogSize;
+    if (mHistoryCount < mLogSize) {
+        mHistoryCount++;
+    }
+
+    mLastEvent = event;
+    mHasLastEvent = true;
 }
 
 bool RecentEventLogger::isEmpty() const {
-    return mRecentEvents.size() == 0;
+    return mHistoryCount == 0;
 }
 
 std::string RecentEventLogger::dump() const {
@@ -50,22 +75,28 @@ std::string RecentEventLogger::dump() const {
     //TODO: replace String8 with std::string completely in this function
     String8 buffer;
 
-    buffer.appendFormat("last %zu events\n", mRecentEvents.size());
-    int j = 0;
-    for (int i = mRecentEvents.size() - 1; i >= 0; --i) {
-        const auto& ev = mRecentEvents[i];
-        struct tm * timeinfo = localtime(&(ev.mWallTime.tv_sec));
+    buffer.appendFormat("last %zu events\n", mHistoryCount);
+    for (size_t j = 0; j < mHistoryCount; ++j) {
+        // walk the history from the most recent entry backwards
+        const size_t index = (mHistoryNext + mLogSize - 1 - j) % mLogSize;
+        const CompactEventLog& log = mHistoryHeaders[index];
+        const float* values = &mHistoryValues[index * mValuesPerEvent];
+
+        time_t wallTimeSec = log.mWallTimeSec;
+        struct tm * timeinfo = localtime(&wallTimeSec);
         buffer.appendFormat("\t%2d (ts=%.9f, wall=%02d:%02d:%02d.%03d) ",
-                ++j, ev.mEvent.timestamp/1e9, timeinfo->tm_hour, timeinfo->tm_min, timeinfo->tm_sec,
-                (int) ns2ms(ev.mWallTime.tv_nsec));
+                int(j + 1), log.mTimestamp/1e9, timeinfo->tm_hour, timeinfo->tm_min,
+                timeinfo->tm_sec, log.mWallTimeMs);
 
         // data
         if (!mMaskData) {
             if (mSensorType == SENSOR_TYPE_STEP_COUNTER) {
-                buffer.appendFormat("%" PRIu64 ", ", ev.mEvent.u64.step_counter);
+                uint64_t stepCounter;
+                memcpy(&stepCounter, values, sizeof(stepCounter));
+                buffer.appendFormat("%" PRIu64 ", ", stepCounter);
             } else {
                 for (size_t k = 0; k < mEventSize; ++k) {
-                    buffer.appendFormat("%.2f, ", ev.mEvent.data[k]);
+                    buffer.appendFormat("%.2f, ", values[k]);
                 }
             }
         } else {
@@ -87,9 +118,8 @@ void RecentEventLogger::setFormat(std::string format) {
 bool RecentEventLogger::populateLastEvent(sensors_event_t *event) const {
     std::lock_guard<std::mutex> lk(mLock);
 
-    if (mRecentEvents.size()) {
-        // Index 0 contains the latest event emplace()'ed
-        *event = mRecentEvents[0].mEvent;
+    if (mHasLastEvent) {
+        *event = mLastEvent;
         return true;
     } else {
         return false;
@@ -104,8 +134,12 @@ size_t RecentEventLogger::logSizeBySensorType(int sensorType) {
             sensorType == SENSOR_TYPE_LIGHT) ? LOG_SIZE_LARGE : LOG_SIZE;
 }
 
-RecentEventLogger::SensorEventLog::SensorEventLog(const sensors_event_t& e) : mEvent(e) {
-    clock_gettime(CLOCK_REALTIME, &mWallTime);
+size_t RecentEventLogger::valuesPerEventBySensorType(int sensorType, size_t eventSize) {
+    // The step counter value is a uint64_t, which needs two float slots.
+    if (sensorType == SENSOR_TYPE_STEP_COUNTER) {
+        return sizeof(uint64_t) / sizeof(float);
+    }
+    return eventSize;
 }
 
 } // namespace SensorServiceUtil
@@ -17,13 +17,13 @@
 #ifndef ANDROID_SENSOR_SERVICE_UTIL_RECENT_EVENT_LOGGER_H
 #define ANDROID_SENSOR_SERVICE_UTIL_RECENT_EVENT_LOGGER_H
 
-#include "RingBuffer.h"
 #include "SensorServiceUtils.h"
 
 #include <hardware/sensors.h>
 #include <utils/String8.h>
 
 #include <mutex>
+#include <vector>
 
 namespace android {
 namespace SensorServiceUtil {
@@ -33,6 +33,10 @@ namespace SensorServiceUtil {
 // generated from the sensor are stored in this buffer.  The buffer is NOT cleared when the sensor
 // unregisters and as a result very old data in the dumpsys output can be seen, which is an intended
 // behavior.
+//
+// History entries are stored compactly: a small fixed header plus only the values the sensor
+// actually reports, instead of a whole sensors_event_t per entry. The most recent event is
+// additionally kept in full so that it can be re-delivered to new clients of on-change sensors.
 class RecentEventLogger : public Dumpable {
 public:
     explicit RecentEventLogger(int sensorType);
@@ -46,26 +50,42 @@ public:
     virtual void setFormat(std::string format) override;
 
 protected:
-    struct SensorEventLog {
-        explicit SensorEventLog(const sensors_event_t& e);
-        timespec mWallTime;
-        sensors_event_t mEvent;
+    // Per-entry header; the entry's values live in mHistoryValues.
+    struct CompactEventLog {
+        int64_t mTimestamp;
+        time_t mWallTimeSec;
+        int32_t mWallTimeMs;
     };
 
     const int mSensorType;
     const size_t mEventSize;
+    const size_t mLogSize;
+
+    // Number of float slots each history entry occupies in mHistoryValues. This is the number
+    // of values the sensor reports, except for the step counter whose uint64_t value takes two
+    // slots.
+    const size_t mValuesPerEvent;
 
     mutable std::mutex mLock;
-    RingBuffer<SensorEventLog> mRecentEvents;
+
+    // Circular history used by dump(). mHistoryNext is the next slot to be overwritten.
+    std::vector<CompactEventLog> mHistoryHeaders;
+    std::vector<float> mHistoryValues;
+    size_t mHistoryNext;
+    size_t mHistoryCount;
+
+    // The last event in full, for populateLastEvent().
+    sensors_event_t mLastEvent;
+    bool mHasLastEvent;
 
     bool mMaskData;
 
 private:
     static size_t logSizeBySensorType(int sensorType);
+    static size_t valuesPerEventBySensorType(int sensorType, size_t eventSize);
 };
 
 } // namespace SensorServiceUtil
 } // namespace android;
 
 #endif // ANDROID_SENSOR_SERVICE_UTIL_RECENT_EVENT_LOGGER_H
-
@@ -154,7 +154,11 @@ std::string SensorDevice::dump() const {
             result.appendFormat("%.1f%s", params.mTBatch / 1e6f,
                     j < info.batchParams.size() - 1 ? ", " : "");
         }
-        result.appendFormat("}, selected = %.2f ms\n", info.bestBatchParams.mTBatch / 1e6f);
+        result.appendFormat("}, selected = %.2f ms", info.bestBatchParams.mTBatch / 1e6f);
+        if (info.actuatedTBatch >= 0 && info.actuatedTBatch != info.bestBatchParams.mTBatch) {
+            result.appendFormat(" (aligned to %.2f ms)", info.actuatedTBatch / 1e6f);
+        }
+        result.append("\n");
     }
 
     return result.string();
@@ -282,11 +286,13 @@ status_t SensorDevice::activate(void* ident, int handle, int enabled) {
                 // Call batch for this sensor with the previously calculated best effort
                 // batch_rate and timeout. One of the apps has unregistered for sensor
                 // events, and the best effort batch parameters might have changed.
+                const nsecs_t tBatch = alignedTBatch(info, computeWakeupSlotLocked());
                 ALOGD_IF(DEBUG_CONNECTIONS,
                          "\t>>> actuating h/w batch 0x%08x %" PRId64 " %" PRId64, handle,
-                         info.bestBatchParams.mTSample, info.bestBatchParams.mTBatch);
-                checkReturn(mSensors->batch(
-                        handle, info.bestBatchParams.mTSample, info.bestBatchParams.mTBatch));
+                         info.bestBatchParams.mTSample, tBatch);
+                checkReturn(mSensors->batch(handle, info.bestBatchParams.mTSample, tBatch));
+                info.actuatedTBatch = tBatch;
+                coalesceWakeupsLocked();
             }
         } else {
             // sensor wasn't enabled for this ident
@@ -307,6 +313,10 @@ status_t SensorDevice::activate(void* ident, int handle, int enabled) {
         if (err != NO_ERROR && enabled) {
             // Failure when enabling the sensor. Clean up on failure.
             info.removeBatchParamsForIdent(ident);
+        } else if (!enabled) {
+            // the sensor no longer batches; the shared wakeup slot may have lengthened
+            info.actuatedTBatch = -1;
+            coalesceWakeupsLocked();
         }
     }
 
@@ -361,21 +371,75 @@ status_t SensorDevice::batch(
     status_t err(NO_ERROR);
     // If the min period or min timeout has changed since the last batch call, call batch.
     if (prevBestBatchParams != info.bestBatchParams) {
+        const nsecs_t tBatch = alignedTBatch(info, computeWakeupSlotLocked());
         ALOGD_IF(DEBUG_CONNECTIONS, "\t>>> actuating h/w BATCH 0x%08x %" PRId64 " %" PRId64, handle,
-                 info.bestBatchParams.mTSample, info.bestBatchParams.mTBatch);
+                 info.bestBatchParams.mTSample, tBatch);
         err = StatusFromResult(
-                checkReturn(mSensors->batch(
-                    handle, info.bestBatchParams.mTSample, info.bestBatchParams.mTBatch)));
+                checkReturn(mSensors->batch(handle, info.bestBatchParams.mTSample, tBatch)));
         if (err != NO_ERROR) {
             ALOGE("sensor batch failed %p 0x%08x %" PRId64 " %" PRId64 " err=%s",
                   mSensors.get(), handle, info.bestBatchParams.mTSample,
-                  info.bestBatchParams.mTBatch, strerror(-err));
+                  tBatch, strerror(-err));
             info.removeBatchParamsForIdent(ident);
+        } else {
+            info.actuatedTBatch = tBatch;
+            // this sensor may have changed the shared wakeup slot; realign the others
+            coalesceWakeupsLocked();
         }
     }
     return err;
 }
 
+nsecs_t SensorDevice::computeWakeupSlotLocked() {
+    nsecs_t slot = INT64_MAX;
+    for (size_t i = 0; i < mActivationCount.size(); i++) {
+        Info& info = mActivationCount.editValueAt(i);
+        if (info.numActiveClients() == 0) {
+            continue;
+        }
+        const nsecs_t tBatch = info.bestBatchParams.mTBatch;
+        if (tBatch > 0 && tBatch < slot) {
+            slot = tBatch;
+        }
+    }
+    if (slot == INT64_MAX) {
+        return 0;
+    }
+    if (slot < MINIMUM_WAKEUP_SLOT) {
+        slot = MINIMUM_WAKEUP_SLOT;
+    }
+    return slot;
+}
+
+nsecs_t SensorDevice::alignedTBatch(const Info& info, nsecs_t slot) {
+    const nsecs_t tBatch = info.bestBatchParams.mTBatch;
+    if (tBatch <= 0 || slot <= 0 || tBatch < slot) {
+        // streaming mode, or a timeout shorter than the slot which must not be rounded to zero
+        return tBatch;
+    }
+    return tBatch - (tBatch % slot);
+}
+
+void SensorDevice::coalesceWakeupsLocked() {
+    const nsecs_t slot = computeWakeupSlotLocked();
+    for (size_t i = 0; i < mActivationCount.size(); i++) {
+        Info& info = mActivationCount.editValueAt(i);
+        if (info.numActiveClients() == 0 || info.bestBatchParams.mTBatch <= 0) {
+            continue;
+        }
+        const nsecs_t tBatch = alignedTBatch(info, slot);
+        if (tBatch == info.actuatedTBatch) {
+            continue;
+        }
+        const int handle = mActivationCount.keyAt(i);
+        ALOGD_IF(DEBUG_CONNECTIONS,
+                 "\t>>> realigning h/w BATCH 0x%08x %" PRId64 " %" PRId64 " (slot=%" PRId64 ")",
+                 handle, info.bestBatchParams.mTSample, tBatch, slot);
+        checkReturn(mSensors->batch(handle, info.bestBatchParams.mTSample, tBatch));
+        info.actuatedTBatch = tBatch;
+    }
+}
+
 status_t SensorDevice::setDelay(void* ident, int handle, int64_t samplingPeriodNs) {
     return batch(ident, handle, 0, samplingPeriodNs, 0);
 }
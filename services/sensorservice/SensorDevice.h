@@ -108,6 +108,9 @@ private:
     std::unordered_map<int32_t, sensor_t*> mConnectedDynamicSensors;
 
     static const nsecs_t MINIMUM_EVENTS_PERIOD =   1000000; // 1000 Hz
+    // Batch timeouts shorter than this do not define a wakeup slot: aligning other sensors to
+    // sub-100ms slots churns the HAL without saving AP wakeups.
+    static const nsecs_t MINIMUM_WAKEUP_SLOT   = 100000000; // 100ms
     mutable Mutex mLock; // protect mActivationCount[].batchParams
     // fixed-size array after construction
 
@@ -137,6 +140,9 @@ private:
     // has registered for this sensor.
     struct Info {
         BatchParams bestBatchParams;
+        // Batch timeout most recently sent to the HAL for this sensor, after wakeup-slot
+        // alignment. -1 if no batch call has been issued (or the sensor was deactivated).
+        nsecs_t actuatedTBatch = -1;
         // Key is the unique identifier(ident) for each client, value is the batch parameters
         // requested by the client.
         KeyedVector<void*, BatchParams> batchParams;
@@ -178,6 +184,17 @@ private:
     bool isClientDisabled(void* ident);
     bool isClientDisabledLocked(void* ident);
 
+    // Shortest batch timeout among active batched sensors, clamped up to MINIMUM_WAKEUP_SLOT.
+    // This defines the shared wakeup slot period. Returns 0 when no sensor is batching.
+    nsecs_t computeWakeupSlotLocked();
+    // Batch timeout of this sensor rounded down to a whole number of wakeup slots. Rounding
+    // down is always legal as maxBatchReportLatency is an upper bound.
+    static nsecs_t alignedTBatch(const Info& info, nsecs_t slot);
+    // Re-batch every active sensor whose slot-aligned timeout differs from what was last sent
+    // to the HAL. Re-issuing the batch calls together also restarts the HAL-side timeout
+    // clocks from a common origin, so flush deadlines across sensors coincide.
+    void coalesceWakeupsLocked();
+
     using Event = hardware::sensors::V1_0::Event;
     using SensorInfo = hardware::sensors::V1_0::SensorInfo;
 
@@ -16,8 +16,12 @@
 
 #include "SensorDevice.h"
 #include "SensorDirectConnection.h"
+#include <cutils/atomic.h>
 #include <hardware/sensors.h>
 
+#include <errno.h>
+#include <sys/mman.h>
+
 #define UNUSED(x) (void)(x)
 
 namespace android {
@@ -27,7 +31,9 @@ SensorService::SensorDirectConnection::SensorDirectConnection(const sp<SensorSer
         const String16& opPackageName)
         : mService(service), mUid(uid), mMem(*mem),
         mHalChannelHandle(halChannelHandle),
-        mOpPackageName(opPackageName), mDestroyed(false) {
+        mOpPackageName(opPackageName),
+        mVirtualBuffer(nullptr), mVirtualNumPackets(0), mVirtualNextPacket(0),
+        mVirtualWriteCounter(0), mDestroyed(false) {
     ALOGD_IF(DEBUG_CONNECTIONS, "Created SensorDirectConnection");
 }
 
@@ -45,6 +51,10 @@ void SensorService::SensorDirectConnection::destroy() {
 
     stopAll();
     mService->cleanupConnection(this);
+    if (mVirtualBuffer != nullptr) {
+        munmap(mVirtualBuffer, mMem.size);
+        mVirtualBuffer = nullptr;
+    }
     if (mMem.handle != nullptr) {
         native_handle_close(mMem.handle);
         native_handle_delete(const_cast<struct native_handle*>(mMem.handle));
@@ -62,6 +72,9 @@ void SensorService::SensorDirectConnection::dump(String8& result) const {
     for (auto &i : mActivated) {
         result.appendFormat("\t\tSensor %#08x, rate %d\n", i.first, i.second);
     }
+    for (auto &i : mActivatedVirtual) {
+        result.appendFormat("\t\tVirtual sensor %#08x, rate %d\n", i.first, i.second.rateLevel);
+    }
 }
 
 sp<BitTube> SensorService::SensorDirectConnection::getSensorChannel() const {
@@ -80,6 +93,13 @@ status_t SensorService::SensorDirectConnection::enableDisable(
     return INVALID_OPERATION;
 }
 
+status_t SensorService::SensorDirectConnection::enableDisableMultiple(
+        const Vector<SensorRequest>& requests) {
+    // SensorDirectConnection does not support enableDisableMultiple, parameters not used
+    UNUSED(requests);
+    return INVALID_OPERATION;
+}
+
 status_t SensorService::SensorDirectConnection::setEventRate(
         int handle, nsecs_t samplingPeriodNs) {
     // SensorDirectConnection does not support setEventRate, parameters not used
@@ -96,6 +116,7 @@ status_t SensorService::SensorDirectConnection::flush() {
 int32_t SensorService::SensorDirectConnection::configureChannel(int handle, int rateLevel) {
 
     if (handle == -1 && rateLevel == SENSOR_DIRECT_RATE_STOP) {
+        stopAllVirtual();
         stopAll();
         return NO_ERROR;
     }
@@ -114,6 +135,12 @@ int32_t SensorService::SensorDirectConnection::configureChannel(int handle, int
         return PERMISSION_DENIED;
     }
 
+    if (si->isVirtual()) {
+        // virtual sensors are computed in the service and written into the channel here
+        // rather than by the HAL
+        return configureVirtualChannel(handle, rateLevel);
+    }
+
     if (s.getHighestDirectReportRateLevel() == 0
             || rateLevel > s.getHighestDirectReportRateLevel()
             || !s.isDirectChannelTypeSupported(mMem.type)) {
@@ -125,6 +152,12 @@ int32_t SensorService::SensorDirectConnection::configureChannel(int handle, int
     };
 
     Mutex::Autolock _l(mConnectionLock);
+    if (rateLevel != SENSOR_DIRECT_RATE_STOP &&
+            (!mActivatedVirtual.empty() || !mActivatedVirtualBackup.empty())) {
+        // the direct report format permits only one writer per channel and this channel is
+        // currently written by the service for a virtual sensor
+        return INVALID_OPERATION;
+    }
     SensorDevice& dev(SensorDevice::getInstance());
     int ret = dev.configureDirectChannel(handle, getHalChannelHandle(), &config);
 
@@ -159,6 +192,13 @@ void SensorService::SensorDirectConnection::stopAll(bool backupRecord) {
         mActivatedBackup = mActivated;
     }
     mActivated.clear();
+
+    // Virtual sensor reports always move to the backup so that the fusion clients held in the
+    // service stay balanced; they are released by configureChannel(STOP) or cleanupConnection.
+    if (mActivatedVirtualBackup.empty()) {
+        mActivatedVirtualBackup = mActivatedVirtual;
+    }
+    mActivatedVirtual.clear();
 }
 
 void SensorService::SensorDirectConnection::recoverAll() {
@@ -178,6 +218,172 @@ void SensorService::SensorDirectConnection::recoverAll() {
         };
         dev.configureDirectChannel(i.first, getHalChannelHandle(), &config);
     }
+
+    // resume virtual sensor reports; the fusion clients were kept alive across stopAll
+    if (mActivatedVirtual.empty()) {
+        mActivatedVirtual = mActivatedVirtualBackup;
+        mActivatedVirtualBackup.clear();
+    }
+}
+
+int32_t SensorService::SensorDirectConnection::configureVirtualChannel(int handle, int rateLevel) {
+    if (mMem.type != SENSOR_DIRECT_MEM_TYPE_ASHMEM) {
+        // only memory the service itself can map and write is supported for virtual sensors
+        return INVALID_OPERATION;
+    }
+
+    if (rateLevel == SENSOR_DIRECT_RATE_STOP) {
+        bool wasActivated;
+        { // acquire lock
+            Mutex::Autolock _l(mConnectionLock);
+            const bool activated = mActivatedVirtual.erase(handle) > 0;
+            const bool backedUp = mActivatedVirtualBackup.erase(handle) > 0;
+            wasActivated = activated || backedUp;
+        }
+        if (wasActivated) {
+            mService->disableVirtualForDirectChannel(this, handle);
+        }
+        return NO_ERROR;
+    }
+
+    if (rateLevel > SENSOR_DIRECT_RATE_VERY_FAST) {
+        return BAD_VALUE;
+    }
+
+    { // acquire lock
+        Mutex::Autolock _l(mConnectionLock);
+        if (!mActivated.empty() || !mActivatedBackup.empty()) {
+            // the direct report format permits only one writer per channel and this channel
+            // is currently written by the HAL
+            return INVALID_OPERATION;
+        }
+        status_t err = mapVirtualBufferLocked();
+        if (err != NO_ERROR) {
+            return err;
+        }
+    }
+
+    // a rate change is a stop followed by a start so the fusion client bookkeeping in the
+    // service stays balanced
+    configureVirtualChannel(handle, SENSOR_DIRECT_RATE_STOP);
+
+    const nsecs_t interval = rateLevelToReportInterval(rateLevel);
+    status_t err = mService->enableVirtualForDirectChannel(this, handle, interval);
+    if (err != NO_ERROR) {
+        return err;
+    }
+
+    { // acquire lock
+        Mutex::Autolock _l(mConnectionLock);
+        VirtualSensorState state;
+        state.rateLevel = rateLevel;
+        state.minReportInterval = interval;
+        state.lastTimestamp = 0;
+        mActivatedVirtual[handle] = state;
+    }
+
+    // the sensor handle doubles as the report token of the packets written into the channel
+    return handle;
+}
+
+status_t SensorService::SensorDirectConnection::mapVirtualBufferLocked() {
+    if (mVirtualBuffer != nullptr) {
+        return NO_ERROR;
+    }
+    if (mMem.handle == nullptr || mMem.handle->numFds < 1) {
+        return NO_INIT;
+    }
+    if (mMem.size < sizeof(sensors_event_t)) {
+        return BAD_VALUE;
+    }
+    void* buffer = mmap(nullptr, mMem.size, PROT_READ | PROT_WRITE, MAP_SHARED,
+            mMem.handle->data[0], 0);
+    if (buffer == MAP_FAILED) {
+        ALOGE("cannot map direct channel memory for virtual sensor: %s", strerror(errno));
+        return NO_MEMORY;
+    }
+    mVirtualBuffer = buffer;
+    mVirtualNumPackets = mMem.size / sizeof(sensors_event_t);
+    mVirtualNextPacket = 0;
+    mVirtualWriteCounter = 0;
+    return NO_ERROR;
+}
+
+void SensorService::SensorDirectConnection::stopAllVirtual() {
+    for (int handle : drainVirtualActivations()) {
+        mService->disableVirtualForDirectChannel(this, handle);
+    }
+}
+
+std::vector<int> SensorService::SensorDirectConnection::drainVirtualActivations() {
+    Mutex::Autolock _l(mConnectionLock);
+    std::vector<int> handles;
+    for (auto &i : mActivatedVirtual) {
+        handles.push_back(i.first);
+    }
+    for (auto &i : mActivatedVirtualBackup) {
+        if (mActivatedVirtual.count(i.first) == 0) {
+            handles.push_back(i.first);
+        }
+    }
+    mActivatedVirtual.clear();
+    mActivatedVirtualBackup.clear();
+    return handles;
+}
+
+void SensorService::SensorDirectConnection::sendEvent(const sensors_event_t& event) {
+    Mutex::Autolock _l(mConnectionLock);
+    if (mVirtualBuffer == nullptr) {
+        return;
+    }
+    auto it = mActivatedVirtual.find(event.sensor);
+    if (it == mActivatedVirtual.end()) {
+        return;
+    }
+
+    // decimate to the configured rate level, with some tolerance for sampling jitter
+    VirtualSensorState& state = it->second;
+    if (state.lastTimestamp != 0 &&
+            event.timestamp - state.lastTimestamp <
+                    state.minReportInterval - state.minReportInterval / 5) {
+        return;
+    }
+    state.lastTimestamp = event.timestamp;
+
+    // Packets use the direct report layout, which matches sensors_event_t with the version
+    // field holding the packet size and reserved0 holding the monotonic packet counter. The
+    // counter is written last, with release semantics, so a reader polling it never observes
+    // a half-written packet; zero marks an invalid packet and is skipped on wrap-around.
+    sensors_event_t* packets = static_cast<sensors_event_t*>(mVirtualBuffer);
+    sensors_event_t& slot = packets[mVirtualNextPacket];
+    volatile int32_t* counterSlot = reinterpret_cast<volatile int32_t*>(&slot.reserved0);
+
+    if (++mVirtualWriteCounter == 0) {
+        ++mVirtualWriteCounter;
+    }
+
+    // acquire semantics order the invalidation before the payload stores below
+    android_atomic_acquire_store(0, counterSlot);
+    sensors_event_t packet = event;
+    packet.version = sizeof(sensors_event_t);
+    packet.reserved0 = 0;
+    slot = packet;
+    android_atomic_release_store(int32_t(mVirtualWriteCounter), counterSlot);
+
+    mVirtualNextPacket = (mVirtualNextPacket + 1) % mVirtualNumPackets;
+}
+
+nsecs_t SensorService::SensorDirectConnection::rateLevelToReportInterval(int rateLevel) {
+    switch (rateLevel) {
+        case SENSOR_DIRECT_RATE_NORMAL:
+            return ms2ns(20);       // 50 Hz nominal
+        case SENSOR_DIRECT_RATE_FAST:
+            return ms2ns(5);        // 200 Hz nominal
+        case SENSOR_DIRECT_RATE_VERY_FAST:
+            return 1250000;         // 800 Hz nominal
+        default:
+            return 0;
+    }
 }
 
 int32_t SensorService::SensorDirectConnection::getHalChannelHandle() const {
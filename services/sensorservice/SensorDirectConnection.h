@@ -20,6 +20,9 @@
 #include <stdint.h>
 #include <sys/types.h>
 
+#include <unordered_map>
+#include <vector>
+
 #include <binder/BinderService.h>
 
 #include <sensor/Sensor.h>
@@ -53,6 +56,16 @@ public:
     // called by SensorService when return to NORMAL mode.
     void recoverAll();
 
+    // write a service-generated virtual sensor event into the channel's shared memory if the
+    // sensor is activated on it. called on the sensor event poll thread with
+    // SensorService::mLock held.
+    void sendEvent(const sensors_event_t& event);
+
+    // remove all virtual sensor activation records and return the handles that were activated,
+    // so SensorService can release the corresponding fusion clients. called by
+    // SensorService::cleanupConnection with SensorService::mLock held.
+    std::vector<int> drainVirtualActivations();
+
 protected:
     virtual ~SensorDirectConnection();
     // ISensorEventConnection functions
@@ -60,11 +73,31 @@ protected:
     virtual sp<BitTube> getSensorChannel() const;
     virtual status_t enableDisable(int handle, bool enabled, nsecs_t samplingPeriodNs,
                                    nsecs_t maxBatchReportLatencyNs, int reservedFlags);
+    virtual status_t enableDisableMultiple(const Vector<SensorRequest>& requests);
     virtual status_t setEventRate(int handle, nsecs_t samplingPeriodNs);
     virtual status_t flush();
     virtual int32_t configureChannel(int handle, int rateLevel);
     virtual void destroy();
 private:
+    // Per-channel report state of a virtual sensor written by the service.
+    struct VirtualSensorState {
+        int rateLevel;
+        nsecs_t minReportInterval;
+        nsecs_t lastTimestamp;
+    };
+
+    // configure a virtual sensor on this channel; its events are written into the shared
+    // memory by the service rather than the HAL.
+    int32_t configureVirtualChannel(int handle, int rateLevel);
+
+    // map the channel's ashmem region so the service can write packets into it.
+    status_t mapVirtualBufferLocked();
+
+    // stop all virtual sensor reports and release their fusion clients.
+    void stopAllVirtual();
+
+    static nsecs_t rateLevelToReportInterval(int rateLevel);
+
     const sp<SensorService> mService;
     const uid_t mUid;
     const sensors_direct_mem_t mMem;
@@ -75,6 +108,16 @@ private:
     std::unordered_map<int, int> mActivated;
     std::unordered_map<int, int> mActivatedBackup;
 
+    // Virtual sensors activated on this channel and the channel's mapping, all protected by
+    // mConnectionLock. The service is the only writer of the shared memory while a virtual
+    // sensor is activated; mixing with HAL-written sensors on the same channel is rejected.
+    std::unordered_map<int, VirtualSensorState> mActivatedVirtual;
+    std::unordered_map<int, VirtualSensorState> mActivatedVirtualBackup;
+    void* mVirtualBuffer;
+    size_t mVirtualNumPackets;
+    size_t mVirtualNextPacket;
+    uint32_t mVirtualWriteCounter;
+
     mutable Mutex mDestroyLock;
     bool mDestroyed;
 };
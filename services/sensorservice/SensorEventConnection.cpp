@@ -32,7 +32,9 @@ SensorService::SensorEventConnection::SensorEventConnection(
         const String16& opPackageName, bool hasSensorAccess)
     : mService(service), mUid(uid), mWakeLockRefCount(0), mHasLooperCallbacks(false),
       mDead(false), mDataInjectionMode(isDataInjectionMode), mEventCache(NULL),
-      mCacheSize(0), mMaxCacheSize(0), mPackageName(packageName), mOpPackageName(opPackageName),
+      mCacheSize(0), mCacheHead(0), mMaxCacheSize(0), mSanitizedBuffer(NULL),
+      mSanitizedBufferSize(0),
+      mPackageName(packageName), mOpPackageName(opPackageName),
       mDestroyed(false), mHasSensorAccess(hasSensorAccess) {
     mChannel = new BitTube(mService->mSocketBufferSize);
 #if DEBUG_CONNECTIONS
@@ -58,6 +60,9 @@ void SensorService::SensorEventConnection::destroy() {
     if (mEventCache != NULL) {
         delete mEventCache;
     }
+    delete[] mSanitizedBuffer;
+    mSanitizedBuffer = NULL;
+    mSanitizedBufferSize = 0;
     mDestroyed = true;
 }
 
@@ -132,6 +137,16 @@ bool SensorService::SensorEventConnection::hasAnySensor() const {
     return mSensorInfo.size() ? true : false;
 }
 
+std::vector<int32_t> SensorService::SensorEventConnection::getActiveSensorHandles() const {
+    Mutex::Autolock _l(mConnectionLock);
+    std::vector<int32_t> handles;
+    handles.reserve(mSensorInfo.size());
+    for (size_t i = 0; i < mSensorInfo.size(); ++i) {
+        handles.push_back(mSensorInfo.keyAt(i));
+    }
+    return handles;
+}
+
 bool SensorService::SensorEventConnection::hasOneShotSensors() const {
     Mutex::Autolock _l(mConnectionLock);
     for (size_t i = 0; i < mSensorInfo.size(); ++i) {
@@ -224,8 +239,6 @@ status_t SensorService::SensorEventConnection::sendEvents(
         wp<const SensorEventConnection> const * mapFlushEventsToConnections) {
     // filter out events not for this connection
 
-    sensors_event_t* sanitizedBuffer = nullptr;
-
     int count = 0;
     Mutex::Autolock _l(mConnectionLock);
     if (scratch) {
@@ -293,7 +306,13 @@ status_t SensorService::SensorEventConnection::sendEvents(
             scratch = const_cast<sensors_event_t *>(buffer);
             count = numEvents;
         } else {
-            scratch = sanitizedBuffer = new sensors_event_t[numEvents];
+            // Reuse the connection's sanitized buffer rather than allocating one per batch.
+            if (mSanitizedBufferSize < numEvents) {
+                delete[] mSanitizedBuffer;
+                mSanitizedBuffer = new sensors_event_t[numEvents];
+                mSanitizedBufferSize = numEvents;
+            }
+            scratch = mSanitizedBuffer;
             for (size_t i = 0; i < numEvents; i++) {
                 if (buffer[i].type == SENSOR_TYPE_META_DATA) {
                     scratch[count++] = buffer[i++];
@@ -305,7 +324,6 @@ status_t SensorService::SensorEventConnection::sendEvents(
     sendPendingFlushEventsLocked();
     // Early return if there are no events for this connection.
     if (count == 0) {
-        delete sanitizedBuffer;
         return status_t(NO_ERROR);
     }
 
@@ -313,36 +331,16 @@ status_t SensorService::SensorEventConnection::sendEvents(
      mEventsReceived += count;
 #endif
     if (mCacheSize != 0) {
-        // There are some events in the cache which need to be sent first. Copy this buffer to
-        // the end of cache.
-        if (mCacheSize + count <= mMaxCacheSize) {
-            memcpy(&mEventCache[mCacheSize], scratch, count * sizeof(sensors_event_t));
-            mCacheSize += count;
-        } else {
-            // Check if any new sensors have registered on this connection which may have increased
-            // the max cache size that is desired.
-            if (mCacheSize + count < computeMaxCacheSizeLocked()) {
-                reAllocateCacheLocked(scratch, count);
-                delete sanitizedBuffer;
-                return status_t(NO_ERROR);
-            }
-            // Some events need to be dropped.
-            int remaningCacheSize = mMaxCacheSize - mCacheSize;
-            if (remaningCacheSize != 0) {
-                memcpy(&mEventCache[mCacheSize], scratch,
-                                                remaningCacheSize * sizeof(sensors_event_t));
-            }
-            int numEventsDropped = count - remaningCacheSize;
-            countFlushCompleteEventsLocked(mEventCache, numEventsDropped);
-            // Drop the first "numEventsDropped" in the cache.
-            memmove(mEventCache, &mEventCache[numEventsDropped],
-                    (mCacheSize - numEventsDropped) * sizeof(sensors_event_t));
-
-            // Copy the remainingEvents in scratch buffer to the end of cache.
-            memcpy(&mEventCache[mCacheSize - numEventsDropped], scratch + remaningCacheSize,
-                                            numEventsDropped * sizeof(sensors_event_t));
+        // There are some events in the cache which need to be sent first. Append this buffer to
+        // the cache.
+        if (mCacheSize + count > mMaxCacheSize &&
+                mCacheSize + count < computeMaxCacheSizeLocked()) {
+            // New sensors have registered on this connection and the desired cache size has
+            // grown; reallocate before events have to be dropped.
+            reAllocateCacheLocked(scratch, count);
+            return status_t(NO_ERROR);
         }
-        delete sanitizedBuffer;
+        appendEventsToCacheLocked(scratch, count);
         return status_t(NO_ERROR);
     }
 
@@ -377,14 +375,13 @@ status_t SensorService::SensorEventConnection::sendEvents(
             mMaxCacheSize = computeMaxCacheSizeLocked();
             mEventCache = new sensors_event_t[mMaxCacheSize];
             mCacheSize = 0;
+            mCacheHead = 0;
         }
-        memcpy(&mEventCache[mCacheSize], scratch, count * sizeof(sensors_event_t));
-        mCacheSize += count;
+        appendEventsToCacheLocked(scratch, count);
 
         // Add this file descriptor to the looper to get a callback when this fd is available for
         // writing.
         updateLooperRegistrationLocked(mService->getLooper());
-        delete sanitizedBuffer;
         return size;
     }
 
@@ -394,7 +391,6 @@ status_t SensorService::SensorEventConnection::sendEvents(
     }
 #endif
 
-    delete sanitizedBuffer;
     return size < 0 ? status_t(size) : status_t(NO_ERROR);
 }
 
@@ -407,9 +403,11 @@ void SensorService::SensorEventConnection::reAllocateCacheLocked(sensors_event_t
                                                                  int count) {
     sensors_event_t *eventCache_new;
     const int new_cache_size = computeMaxCacheSizeLocked();
-    // Allocate new cache, copy over events from the old cache & scratch, free up memory.
+    // Allocate new cache, linearize the circular cache and scratch into it, free up memory.
     eventCache_new = new sensors_event_t[new_cache_size];
-    memcpy(eventCache_new, mEventCache, mCacheSize * sizeof(sensors_event_t));
+    for (int i = 0; i < mCacheSize; ++i) {
+        eventCache_new[i] = mEventCache[(mCacheHead + i) % mMaxCacheSize];
+    }
     memcpy(&eventCache_new[mCacheSize], scratch, count * sizeof(sensors_event_t));
 
     ALOGD_IF(DEBUG_CONNECTIONS, "reAllocateCacheLocked maxCacheSize=%d %d", mMaxCacheSize,
@@ -418,9 +416,59 @@ void SensorService::SensorEventConnection::reAllocateCacheLocked(sensors_event_t
     delete mEventCache;
     mEventCache = eventCache_new;
     mCacheSize += count;
+    mCacheHead = 0;
     mMaxCacheSize = new_cache_size;
 }
 
+void SensorService::SensorEventConnection::appendEventsToCacheLocked(
+        sensors_event_t const* events, int count) {
+    if (count <= 0) {
+        return;
+    }
+    if (count > mMaxCacheSize) {
+        // The batch alone exceeds the cache capacity; only its newest mMaxCacheSize events can
+        // be kept. Count the flush complete events among the part that is skipped.
+        countFlushCompleteEventsLocked(events, count - mMaxCacheSize);
+        events += count - mMaxCacheSize;
+        count = mMaxCacheSize;
+    }
+    // Make room by dropping the oldest cached events.
+    const int overflow = mCacheSize + count - mMaxCacheSize;
+    if (overflow > 0) {
+        dropOldestEventsLocked(overflow);
+    }
+    // Copy in at most two contiguous chunks; the ring wraps at most once.
+    const int tail = (mCacheHead + mCacheSize) % mMaxCacheSize;
+    const int contiguous = helpers::min(count, mMaxCacheSize - tail);
+    memcpy(&mEventCache[tail], events, contiguous * sizeof(sensors_event_t));
+    if (count > contiguous) {
+        memcpy(mEventCache, events + contiguous, (count - contiguous) * sizeof(sensors_event_t));
+    }
+    mCacheSize += count;
+}
+
+void SensorService::SensorEventConnection::dropOldestEventsLocked(int count) {
+    ALOGD_IF(DEBUG_CONNECTIONS, "dropping %d cached events ", count);
+    for (int j = 0; j < count; ++j) {
+        const sensors_event_t& event = mEventCache[(mCacheHead + j) % mMaxCacheSize];
+        if (event.type == SENSOR_TYPE_META_DATA) {
+            ssize_t index = mSensorInfo.indexOfKey(event.meta_data.sensor);
+            if (index < 0) {
+                ALOGW("%s: sensor 0x%x is not found in connection",
+                      __func__, event.meta_data.sensor);
+                continue;
+            }
+
+            FlushInfo& flushInfo = mSensorInfo.editValueAt(index);
+            flushInfo.mPendingFlushEventsToSend++;
+            ALOGD_IF(DEBUG_CONNECTIONS, "increment pendingFlushCount %d",
+                     flushInfo.mPendingFlushEventsToSend);
+        }
+    }
+    mCacheHead = (mCacheHead + count) % mMaxCacheSize;
+    mCacheSize -= count;
+}
+
 void SensorService::SensorEventConnection::sendPendingFlushEventsLocked() {
     ASensorEvent flushCompleteEvent;
     memset(&flushCompleteEvent, 0, sizeof(flushCompleteEvent));
@@ -462,14 +510,17 @@ void SensorService::SensorEventConnection::writeToSocketFromCache() {
     Mutex::Autolock _l(mConnectionLock);
     // Send pending flush complete events (if any)
     sendPendingFlushEventsLocked();
-    for (int numEventsSent = 0; numEventsSent < mCacheSize;) {
-        const int numEventsToWrite = helpers::min(mCacheSize - numEventsSent, maxWriteSize);
+    while (mCacheSize > 0) {
+        // Write contiguous runs from the head of the circular cache; the ring wraps at most
+        // once, so at worst this costs one extra write per drain.
+        const int contiguous = helpers::min(mCacheSize, mMaxCacheSize - mCacheHead);
+        const int numEventsToWrite = helpers::min(contiguous, maxWriteSize);
         int index_wake_up_event = -1;
         if (mHasSensorAccess) {
             index_wake_up_event =
-                      findWakeUpSensorEventLocked(mEventCache + numEventsSent, numEventsToWrite);
+                      findWakeUpSensorEventLocked(mEventCache + mCacheHead, numEventsToWrite);
             if (index_wake_up_event >= 0) {
-                mEventCache[index_wake_up_event + numEventsSent].flags |=
+                mEventCache[mCacheHead + index_wake_up_event].flags |=
                         WAKE_UP_SENSOR_EVENT_NEEDS_ACK;
                 ++mWakeLockRefCount;
 #if DEBUG_CONNECTIONS
@@ -479,12 +530,12 @@ void SensorService::SensorEventConnection::writeToSocketFromCache() {
         }
 
         ssize_t size = SensorEventQueue::write(mChannel,
-                          reinterpret_cast<ASensorEvent const*>(mEventCache + numEventsSent),
+                          reinterpret_cast<ASensorEvent const*>(mEventCache + mCacheHead),
                           numEventsToWrite);
         if (size < 0) {
             if (index_wake_up_event >= 0) {
                 // If there was a wake_up sensor_event, reset the flag.
-                mEventCache[index_wake_up_event + numEventsSent].flags  &=
+                mEventCache[mCacheHead + index_wake_up_event].flags  &=
                         ~WAKE_UP_SENSOR_EVENT_NEEDS_ACK;
                 if (mWakeLockRefCount > 0) {
                     --mWakeLockRefCount;
@@ -493,21 +544,18 @@ void SensorService::SensorEventConnection::writeToSocketFromCache() {
                 --mTotalAcksNeeded;
 #endif
             }
-            memmove(mEventCache, &mEventCache[numEventsSent],
-                                 (mCacheSize - numEventsSent) * sizeof(sensors_event_t));
-            ALOGD_IF(DEBUG_CONNECTIONS, "wrote %d events from cache size==%d ",
-                    numEventsSent, mCacheSize);
-            mCacheSize -= numEventsSent;
+            ALOGD_IF(DEBUG_CONNECTIONS, "socket full again, cache size==%d ", mCacheSize);
             return;
         }
-        numEventsSent += numEventsToWrite;
+        mCacheHead = (mCacheHead + numEventsToWrite) % mMaxCacheSize;
+        mCacheSize -= numEventsToWrite;
 #if DEBUG_CONNECTIONS
         mEventsSentFromCache += numEventsToWrite;
 #endif
     }
-    ALOGD_IF(DEBUG_CONNECTIONS, "wrote all events from cache size=%d ", mCacheSize);
-    // All events from the cache have been sent. Reset cache size to zero.
-    mCacheSize = 0;
+    ALOGD_IF(DEBUG_CONNECTIONS, "wrote all events from cache");
+    // All events from the cache have been sent; reset the ring to its origin.
+    mCacheHead = 0;
     // There are no more events in the cache. We don't need to poll for write on the fd.
     // Update Looper registration.
     updateLooperRegistrationLocked(mService->getLooper());
@@ -566,6 +614,21 @@ status_t SensorService::SensorEventConnection::enableDisable(
     return err;
 }
 
+status_t SensorService::SensorEventConnection::enableDisableMultiple(
+        const Vector<SensorRequest>& requests)
+{
+    status_t err = NO_ERROR;
+    for (size_t i = 0; i < requests.size(); i++) {
+        const SensorRequest& req = requests[i];
+        status_t result = enableDisable(req.handle, req.enabled, req.samplingPeriodNs,
+                                        req.maxBatchReportLatencyNs, req.reservedFlags);
+        if (result != NO_ERROR && err == NO_ERROR) {
+            err = result;
+        }
+    }
+    return err;
+}
+
 status_t SensorService::SensorEventConnection::setEventRate(
         int handle, nsecs_t samplingPeriodNs)
 {
@@ -20,6 +20,8 @@
 #include <stdint.h>
 #include <sys/types.h>
 
+#include <vector>
+
 #include <utils/Vector.h>
 #include <utils/SortedVector.h>
 #include <utils/KeyedVector.h>
@@ -56,6 +58,8 @@ public:
                         wp<const SensorEventConnection> const * mapFlushEventsToConnections = NULL);
     bool hasSensor(int32_t handle) const;
     bool hasAnySensor() const;
+    // handles of all sensors currently registered on this connection
+    std::vector<int32_t> getActiveSensorHandles() const;
     bool hasOneShotSensors() const;
     bool addSensor(int32_t handle);
     bool removeSensor(int32_t handle);
@@ -75,6 +79,7 @@ private:
     virtual sp<BitTube> getSensorChannel() const;
     virtual status_t enableDisable(int handle, bool enabled, nsecs_t samplingPeriodNs,
                                    nsecs_t maxBatchReportLatencyNs, int reservedFlags);
+    virtual status_t enableDisableMultiple(const Vector<SensorRequest>& requests);
     virtual status_t setEventRate(int handle, nsecs_t samplingPeriodNs);
     virtual status_t flush();
     virtual int32_t configureChannel(int handle, int rateLevel);
@@ -85,6 +90,14 @@ private:
     // separately before the next batch of events.
     void countFlushCompleteEventsLocked(sensors_event_t const* scratch, int numEventsDropped);
 
+    // Append events to the circular cache, dropping the oldest cached events (counting their
+    // flush complete events) when the cache is full.
+    void appendEventsToCacheLocked(sensors_event_t const* events, int count);
+
+    // Drop the oldest count events from the circular cache, counting the flush complete events
+    // among them.
+    void dropOldestEventsLocked(int count);
+
     // Check if there are any wake up events in the buffer. If yes, return the index of the first
     // wake_up sensor event in the buffer else return -1.  This wake_up sensor event will have the
     // flag WAKE_UP_SENSOR_EVENT_NEEDS_ACK set. Exactly one event per packet will have the wake_up
@@ -159,8 +172,18 @@ private:
     // protected by SensorService::mLock. Key for this vector is the sensor handle.
     KeyedVector<int, FlushInfo> mSensorInfo;
 
+    // Circular cache of events that could not be written to the socket. mCacheHead is the
+    // index of the oldest cached event; appending when full drops the oldest events without
+    // moving the rest, so a persistently slow client costs no allocator or memmove churn.
     sensors_event_t *mEventCache;
-    int mCacheSize, mMaxCacheSize;
+    int mCacheSize, mCacheHead, mMaxCacheSize;
+
+    // Scratch buffer used to sanitize events when the client does not currently have sensor
+    // access. Retained across batches to avoid a heap allocation per batch. Protected by
+    // mConnectionLock.
+    sensors_event_t *mSanitizedBuffer;
+    size_t mSanitizedBufferSize;
+
     String8 mPackageName;
     const String16 mOpPackageName;
 #if DEBUG_CONNECTIONS
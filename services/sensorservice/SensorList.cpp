@@ -33,6 +33,7 @@ bool SensorList::add(
         mUsedHandle.insert(handle).second) {
         // will succeed as the mUsedHandle does not have this handle
         mHandleMap.emplace(handle, Entry(si, isForDebug, isVirtual));
+        rebuildInterfaceSnapshotLocked();
         return true;
     }
     // handle exist already or handle mismatch
@@ -44,11 +45,22 @@ bool SensorList::remove(int handle) {
     auto entry = mHandleMap.find(handle);
     if (entry != mHandleMap.end()) {
         mHandleMap.erase(entry);
+        rebuildInterfaceSnapshotLocked();
         return true;
     }
     return false;
 }
 
+void SensorList::rebuildInterfaceSnapshotLocked() {
+    auto snapshot = std::make_shared<InterfaceMap>();
+    snapshot->reserve(mHandleMap.size());
+    for (auto&& i : mHandleMap) {
+        snapshot->emplace(i.first, i.second.si);
+    }
+    std::atomic_store_explicit(&mInterfaceSnapshot,
+            std::shared_ptr<const InterfaceMap>(std::move(snapshot)), std::memory_order_release);
+}
+
 String8 SensorList::getName(int handle) const {
     return getOne<String8>(
             handle, [] (const Entry& e) -> String8 {return e.si->getSensor().getName();},
@@ -56,8 +68,11 @@ String8 SensorList::getName(int handle) const {
 }
 
 sp<SensorInterface> SensorList::getInterface(int handle) const {
-    return getOne<sp<SensorInterface>>(
-            handle, [] (const Entry& e) -> sp<SensorInterface> {return e.si;}, nullptr);
+    // lock-free: this runs on the poll thread for every event
+    std::shared_ptr<const InterfaceMap> snapshot =
+            std::atomic_load_explicit(&mInterfaceSnapshot, std::memory_order_acquire);
+    auto i = snapshot->find(handle);
+    return i != snapshot->end() ? i->second : nullptr;
 }
 
 
@@ -24,8 +24,11 @@
 #include <utils/String8.h>
 #include <utils/Vector.h>
 
+#include <atomic>
 #include <map>
+#include <memory>
 #include <mutex>
+#include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
@@ -99,9 +102,19 @@ private:
     template <typename T, typename TF>
     T getOne(int handle, const TF& accessor, T def = T()) const;
 
+    using InterfaceMap = std::unordered_map<int, sp<SensorInterface>>;
+
+    // Replace mInterfaceSnapshot with a fresh copy of the handle to interface mapping.
+    void rebuildInterfaceSnapshotLocked();
+
     mutable std::mutex mLock;
     std::map<int, Entry> mHandleMap;
     std::unordered_set<int> mUsedHandle;
+
+    // Read-mostly snapshot of the handle to interface mapping. getInterface is called for
+    // every polled event (wake-up classification) and must not contend on mLock; the snapshot
+    // is swapped wholesale under mLock whenever the list changes and read with an atomic load.
+    std::shared_ptr<const InterfaceMap> mInterfaceSnapshot = std::make_shared<InterfaceMap>();
 };
 
 template <typename TF>
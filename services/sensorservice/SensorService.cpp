@@ -17,6 +17,8 @@
 #include <binder/AppOpsManager.h>
 #include <binder/BinderService.h>
 #include <binder/IServiceManager.h>
+#include <binder/MemoryBase.h>
+#include <binder/MemoryHeapBase.h>
 #include <binder/PermissionCache.h>
 #include <binder/PermissionController.h>
 #include <cutils/ashmem.h>
@@ -51,6 +53,7 @@
 #include <math.h>
 #include <sched.h>
 #include <stdint.h>
+#include <sys/mman.h>
 #include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/types.h>
@@ -631,9 +634,14 @@ bool SensorService::threadLoop() {
             break;
         }
 
-        // Reset sensors_event_t.flags to zero for all events in the buffer.
+        // Reset sensors_event_t.flags to zero for all events in the buffer and check whether
+        // the batch contains an event from a wake up sensor, in a single pass.
+        bool bufferHasWakeUpEvent = false;
         for (int i = 0; i < count; i++) {
-             mSensorEventBuffer[i].flags = 0;
+            mSensorEventBuffer[i].flags = 0;
+            if (!bufferHasWakeUpEvent && isWakeUpSensorEvent(mSensorEventBuffer[i])) {
+                bufferHasWakeUpEvent = true;
+            }
         }
 
         // Make a copy of the connection vector as some connections may be removed during the course
@@ -645,159 +653,200 @@ bool SensorService::threadLoop() {
         SortedVector< sp<SensorEventConnection> > activeConnections;
         populateActiveConnections(&activeConnections);
 
-        Mutex::Autolock _l(mLock);
-        // Poll has returned. Hold a wakelock if one of the events is from a wake up sensor. The
-        // rest of this loop is under a critical section protected by mLock. Acquiring a wakeLock,
-        // sending events to clients (incrementing SensorEventConnection::mWakeLockRefCount) should
-        // not be interleaved with decrementing SensorEventConnection::mWakeLockRefCount and
-        // releasing the wakelock.
-        bool bufferHasWakeUpEvent = false;
-        for (int i = 0; i < count; i++) {
-            if (isWakeUpSensorEvent(mSensorEventBuffer[i])) {
-                bufferHasWakeUpEvent = true;
-                break;
+        // Acquiring a wakeLock, sending events to clients (incrementing
+        // SensorEventConnection::mWakeLockRefCount) should not be interleaved with decrementing
+        // SensorEventConnection::mWakeLockRefCount and releasing the wakelock, so batches that
+        // contain a wake up event are distributed with mLock held. Ordinary batches are
+        // distributed after dropping mLock so that binder calls into the service do not stall
+        // behind per-connection socket writes.
+        { // acquire lock
+            Mutex::Autolock _l(mLock);
+
+            if (bufferHasWakeUpEvent && !mWakeLockAcquired) {
+                setWakeLockAcquiredLocked(true);
             }
-        }
-
-        if (bufferHasWakeUpEvent && !mWakeLockAcquired) {
-            setWakeLockAcquiredLocked(true);
-        }
-        recordLastValueLocked(mSensorEventBuffer, count);
-
-        // handle virtual sensors
-        if (count && vcount) {
-            sensors_event_t const * const event = mSensorEventBuffer;
-            if (!mActiveVirtualSensors.empty()) {
-                size_t k = 0;
-                SensorFusion& fusion(SensorFusion::getInstance());
-                if (fusion.isEnabled()) {
-                    for (size_t i=0 ; i<size_t(count) ; i++) {
-                        fusion.process(event[i]);
-                    }
-                }
-                for (size_t i=0 ; i<size_t(count) && k<minBufferSize ; i++) {
-                    for (int handle : mActiveVirtualSensors) {
-                        if (count + k >= minBufferSize) {
-                            ALOGE("buffer too small to hold all events: "
-                                    "count=%zd, k=%zu, size=%zu",
-                                    count, k, minBufferSize);
-                            break;
-                        }
-                        sensors_event_t out;
-                        sp<SensorInterface> si = mSensors.getInterface(handle);
-                        if (si == nullptr) {
-                            ALOGE("handle %d is not an valid virtual sensor", handle);
-                            continue;
+            recordLastValueLocked(mSensorEventBuffer, count);
+
+            // handle virtual sensors
+            if (count && vcount) {
+                sensors_event_t const * const event = mSensorEventBuffer;
+                if (!mActiveVirtualSensors.empty()) {
+                    size_t k = 0;
+                    SensorFusion& fusion(SensorFusion::getInstance());
+                    if (fusion.isEnabled()) {
+                        for (size_t i=0 ; i<size_t(count) ; i++) {
+                            fusion.process(event[i]);
                         }
+                    }
+                    for (size_t i=0 ; i<size_t(count) && k<minBufferSize ; i++) {
+                        for (int handle : mActiveVirtualSensors) {
+                            if (count + k >= minBufferSize) {
+                                ALOGE("buffer too small to hold all events: "
+                                        "count=%zd, k=%zu, size=%zu",
+                                        count, k, minBufferSize);
+                                break;
+                            }
+                            sensors_event_t out;
+                            sp<SensorInterface> si = mSensors.getInterface(handle);
+                            if (si == nullptr) {
+                                ALOGE("handle %d is not an valid virtual sensor", handle);
+                                continue;
+                            }
 
-                        if (si->process(&out, event[i])) {
-                            mSensorEventBuffer[count + k] = out;
-                            k++;
+                            if (si->process(&out, event[i])) {
+                                mSensorEventBuffer[count + k] = out;
+                                k++;
+                            }
                         }
                     }
-                }
-                if (k) {
-                    // record the last synthesized values
-                    recordLastValueLocked(&mSensorEventBuffer[count], k);
-                    count += k;
-                    // sort the buffer by time-stamps
-                    sortEventBuffer(mSensorEventBuffer, count);
+                    if (k) {
+                        // record the last synthesized values
+                        recordLastValueLocked(&mSensorEventBuffer[count], k);
+                        // forward the synthesized events to direct channels that have
+                        // virtual sensors configured on them
+                        for (size_t c=0 ; c < mDirectConnections.size() ; c++) {
+                            sp<SensorDirectConnection> connection(
+                                    mDirectConnections[c].promote());
+                            if (connection != nullptr) {
+                                for (size_t j=0 ; j < k ; j++) {
+                                    connection->sendEvent(mSensorEventBuffer[count + j]);
+                                }
+                            }
+                        }
+                        count += k;
+                        // sort the buffer by time-stamps
+                        sortEventBuffer(mSensorEventBuffer, count);
+                    }
                 }
             }
-        }
 
-        // handle backward compatibility for RotationVector sensor
-        if (halVersion < SENSORS_DEVICE_API_VERSION_1_0) {
-            for (int i = 0; i < count; i++) {
-                if (mSensorEventBuffer[i].type == SENSOR_TYPE_ROTATION_VECTOR) {
-                    // All the 4 components of the quaternion should be available
-                    // No heading accuracy. Set it to -1
-                    mSensorEventBuffer[i].data[4] = -1;
+            // handle backward compatibility for RotationVector sensor
+            if (halVersion < SENSORS_DEVICE_API_VERSION_1_0) {
+                for (int i = 0; i < count; i++) {
+                    if (mSensorEventBuffer[i].type == SENSOR_TYPE_ROTATION_VECTOR) {
+                        // All the 4 components of the quaternion should be available
+                        // No heading accuracy. Set it to -1
+                        mSensorEventBuffer[i].data[4] = -1;
+                    }
                 }
             }
-        }
 
-        for (int i = 0; i < count; ++i) {
-            // Map flush_complete_events in the buffer to SensorEventConnections which called flush
-            // on the hardware sensor. mapFlushEventsToConnections[i] will be the
-            // SensorEventConnection mapped to the corresponding flush_complete_event in
-            // mSensorEventBuffer[i] if such a mapping exists (NULL otherwise).
-            mMapFlushEventsToConnections[i] = NULL;
-            if (mSensorEventBuffer[i].type == SENSOR_TYPE_META_DATA) {
-                const int sensor_handle = mSensorEventBuffer[i].meta_data.sensor;
-                SensorRecord* rec = mActiveSensors.valueFor(sensor_handle);
-                if (rec != NULL) {
-                    mMapFlushEventsToConnections[i] = rec->getFirstPendingFlushConnection();
-                    rec->removeFirstPendingFlushConnection();
+            for (int i = 0; i < count; ++i) {
+                // Map flush_complete_events in the buffer to SensorEventConnections which called flush
+                // on the hardware sensor. mapFlushEventsToConnections[i] will be the
+                // SensorEventConnection mapped to the corresponding flush_complete_event in
+                // mSensorEventBuffer[i] if such a mapping exists (NULL otherwise).
+                mMapFlushEventsToConnections[i] = NULL;
+                if (mSensorEventBuffer[i].type == SENSOR_TYPE_META_DATA) {
+                    const int sensor_handle = mSensorEventBuffer[i].meta_data.sensor;
+                    SensorRecord* rec = mActiveSensors.valueFor(sensor_handle);
+                    if (rec != NULL) {
+                        mMapFlushEventsToConnections[i] = rec->getFirstPendingFlushConnection();
+                        rec->removeFirstPendingFlushConnection();
+                    }
                 }
-            }
 
-            // handle dynamic sensor meta events, process registration and unregistration of dynamic
-            // sensor based on content of event.
-            if (mSensorEventBuffer[i].type == SENSOR_TYPE_DYNAMIC_SENSOR_META) {
-                if (mSensorEventBuffer[i].dynamic_sensor_meta.connected) {
-                    int handle = mSensorEventBuffer[i].dynamic_sensor_meta.handle;
-                    const sensor_t& dynamicSensor =
-                            *(mSensorEventBuffer[i].dynamic_sensor_meta.sensor);
-                    ALOGI("Dynamic sensor handle 0x%x connected, type %d, name %s",
-                          handle, dynamicSensor.type, dynamicSensor.name);
-
-                    if (mSensors.isNewHandle(handle)) {
-                        const auto& uuid = mSensorEventBuffer[i].dynamic_sensor_meta.uuid;
-                        sensor_t s = dynamicSensor;
-                        // make sure the dynamic sensor flag is set
-                        s.flags |= DYNAMIC_SENSOR_MASK;
-                        // force the handle to be consistent
-                        s.handle = handle;
-
-                        SensorInterface *si = new HardwareSensor(s, uuid);
-
-                        // This will release hold on dynamic sensor meta, so it should be called
-                        // after Sensor object is created.
-                        device.handleDynamicSensorConnection(handle, true /*connected*/);
-                        registerDynamicSensorLocked(si);
+                // handle dynamic sensor meta events, process registration and unregistration of dynamic
+                // sensor based on content of event.
+                if (mSensorEventBuffer[i].type == SENSOR_TYPE_DYNAMIC_SENSOR_META) {
+                    if (mSensorEventBuffer[i].dynamic_sensor_meta.connected) {
+                        int handle = mSensorEventBuffer[i].dynamic_sensor_meta.handle;
+                        const sensor_t& dynamicSensor =
+                                *(mSensorEventBuffer[i].dynamic_sensor_meta.sensor);
+                        ALOGI("Dynamic sensor handle 0x%x connected, type %d, name %s",
+                              handle, dynamicSensor.type, dynamicSensor.name);
+
+                        if (mSensors.isNewHandle(handle)) {
+                            const auto& uuid = mSensorEventBuffer[i].dynamic_sensor_meta.uuid;
+                            sensor_t s = dynamicSensor;
+                            // make sure the dynamic sensor flag is set
+                            s.flags |= DYNAMIC_SENSOR_MASK;
+                            // force the handle to be consistent
+                            s.handle = handle;
+
+                            SensorInterface *si = new HardwareSensor(s, uuid);
+
+                            // This will release hold on dynamic sensor meta, so it should be called
+                            // after Sensor object is created.
+                            device.handleDynamicSensorConnection(handle, true /*connected*/);
+                            registerDynamicSensorLocked(si);
+                        } else {
+                            ALOGE("Handle %d has been used, cannot use again before reboot.", handle);
+                        }
                     } else {
-                        ALOGE("Handle %d has been used, cannot use again before reboot.", handle);
-                    }
-                } else {
-                    int handle = mSensorEventBuffer[i].dynamic_sensor_meta.handle;
-                    ALOGI("Dynamic sensor handle 0x%x disconnected", handle);
+                        int handle = mSensorEventBuffer[i].dynamic_sensor_meta.handle;
+                        ALOGI("Dynamic sensor handle 0x%x disconnected", handle);
 
-                    device.handleDynamicSensorConnection(handle, false /*connected*/);
-                    if (!unregisterDynamicSensorLocked(handle)) {
-                        ALOGE("Dynamic sensor release error.");
-                    }
+                        device.handleDynamicSensorConnection(handle, false /*connected*/);
+                        if (!unregisterDynamicSensorLocked(handle)) {
+                            ALOGE("Dynamic sensor release error.");
+                        }
 
-                    size_t numConnections = activeConnections.size();
-                    for (size_t i=0 ; i < numConnections; ++i) {
-                        if (activeConnections[i] != NULL) {
-                            activeConnections[i]->removeSensor(handle);
+                        size_t numConnections = activeConnections.size();
+                        for (size_t i=0 ; i < numConnections; ++i) {
+                            if (activeConnections[i] != NULL) {
+                                activeConnections[i]->removeSensor(handle);
+                            }
                         }
                     }
                 }
             }
-        }
 
-        // Send our events to clients. Check the state of wake lock for each client and release the
-        // lock if none of the clients need it.
-        bool needsWakeLock = false;
-        size_t numConnections = activeConnections.size();
-        for (size_t i=0 ; i < numConnections; ++i) {
-            if (activeConnections[i] != 0) {
-                activeConnections[i]->sendEvents(mSensorEventBuffer, count, mSensorEventScratch,
-                        mMapFlushEventsToConnections);
-                needsWakeLock |= activeConnections[i]->needsWakeLock();
-                // If the connection has one-shot sensors, it may be cleaned up after first trigger.
-                // Early check for one-shot sensors.
-                if (activeConnections[i]->hasOneShotSensors()) {
-                    cleanupAutoDisabledSensorLocked(activeConnections[i], mSensorEventBuffer,
-                            count);
+            if (bufferHasWakeUpEvent) {
+                // Send our events to clients. Check the state of wake lock for each client and release
+                // the lock if none of the clients need it.
+                bool needsWakeLock = false;
+                size_t numConnections = activeConnections.size();
+                for (size_t i=0 ; i < numConnections; ++i) {
+                    if (activeConnections[i] != 0) {
+                        activeConnections[i]->sendEvents(mSensorEventBuffer, count,
+                                mSensorEventScratch, mMapFlushEventsToConnections);
+                        needsWakeLock |= activeConnections[i]->needsWakeLock();
+                        // If the connection has one-shot sensors, it may be cleaned up after first
+                        // trigger.  Early check for one-shot sensors.
+                        if (activeConnections[i]->hasOneShotSensors()) {
+                            cleanupAutoDisabledSensorLocked(activeConnections[i], mSensorEventBuffer,
+                                    count);
+                        }
+                    }
+                }
+
+                if (mWakeLockAcquired && !needsWakeLock) {
+                    setWakeLockAcquiredLocked(false);
+                }
+            }
+        } // release lock
+
+        if (!bufferHasWakeUpEvent) {
+            // Send our events to clients without holding mLock. The event buffers are written
+            // only by this thread and each connection serializes on its own mConnectionLock,
+            // so binder calls into the service can proceed while the batch is distributed.
+            size_t numConnections = activeConnections.size();
+            for (size_t i=0 ; i < numConnections; ++i) {
+                if (activeConnections[i] != 0) {
+                    activeConnections[i]->sendEvents(mSensorEventBuffer, count,
+                            mSensorEventScratch, mMapFlushEventsToConnections);
                 }
             }
-        }
 
-        if (mWakeLockAcquired && !needsWakeLock) {
-            setWakeLockAcquiredLocked(false);
+            // Check the state of wake lock for each client and release the lock if none of the
+            // clients need it.
+            Mutex::Autolock _l(mLock);
+            bool needsWakeLock = false;
+            for (size_t i=0 ; i < numConnections; ++i) {
+                if (activeConnections[i] != 0) {
+                    needsWakeLock |= activeConnections[i]->needsWakeLock();
+                    // If the connection has one-shot sensors, it may be cleaned up after first
+                    // trigger.  Early check for one-shot sensors.
+                    if (activeConnections[i]->hasOneShotSensors()) {
+                        cleanupAutoDisabledSensorLocked(activeConnections[i], mSensorEventBuffer,
+                                count);
+                    }
+                }
+            }
+            if (mWakeLockAcquired && !needsWakeLock) {
+                setWakeLockAcquiredLocked(false);
+            }
         }
     } while (!Thread::exitPending());
 
@@ -997,6 +1046,49 @@ Vector<Sensor> SensorService::getSensorList(const String16& /* opPackageName */)
     return accessibleSensorList;
 }
 
+sp<IMemory> SensorService::getSensorListMemory() {
+    Mutex::Autolock _l(mLock);
+    if (mSensorListMemory != NULL) {
+        return mSensorListMemory;
+    }
+
+    // Same list every getSensorList() caller gets; debug.sensors is
+    // sampled once, when the region is first built.
+    Vector<Sensor> sensorList = getSensorList(String16(""));
+    size_t totalSize = sizeof(uint32_t);
+    for (size_t i = 0; i < sensorList.size(); i++) {
+        totalSize += sizeof(uint32_t);
+        totalSize = (totalSize + sensorList[i].getFlattenedSize() + 3) & ~size_t(3);
+    }
+
+    sp<MemoryHeapBase> heap = new MemoryHeapBase(totalSize, MemoryHeapBase::READ_ONLY,
+            "SensorList");
+    void* base = heap->getBase();
+    if (base == NULL || base == MAP_FAILED) {
+        ALOGE("getSensorListMemory: cannot allocate %zu bytes", totalSize);
+        return NULL;
+    }
+
+    uint8_t* p = static_cast<uint8_t*>(base);
+    const uint32_t count = static_cast<uint32_t>(sensorList.size());
+    memcpy(p, &count, sizeof(count));
+    p += sizeof(count);
+    for (size_t i = 0; i < sensorList.size(); i++) {
+        const uint32_t size = static_cast<uint32_t>(sensorList[i].getFlattenedSize());
+        memcpy(p, &size, sizeof(size));
+        p += sizeof(size);
+        if (sensorList[i].flatten(p, size) != NO_ERROR) {
+            ALOGE("getSensorListMemory: cannot flatten sensor %s",
+                    sensorList[i].getName().string());
+            return NULL;
+        }
+        p += (size + 3) & ~size_t(3);
+    }
+
+    mSensorListMemory = new MemoryBase(heap, 0, totalSize);
+    return mSensorListMemory;
+}
+
 Vector<Sensor> SensorService::getDynamicSensorList(const String16& opPackageName) {
     Vector<Sensor> accessibleSensorList;
     mSensors.forEachSensor(
@@ -1253,34 +1345,36 @@ status_t SensorService::resetToNormalModeLocked() {
 void SensorService::cleanupConnection(SensorEventConnection* c) {
     Mutex::Autolock _l(mLock);
     const wp<SensorEventConnection> connection(c);
-    size_t size = mActiveSensors.size();
-    ALOGD_IF(DEBUG_CONNECTIONS, "%zu active sensors", size);
-    for (size_t i=0 ; i<size ; ) {
-        int handle = mActiveSensors.keyAt(i);
-        if (c->hasSensor(handle)) {
-            ALOGD_IF(DEBUG_CONNECTIONS, "%zu: disabling handle=0x%08x", i, handle);
-            sp<SensorInterface> sensor = getSensorInterfaceFromHandle(handle);
-            if (sensor != nullptr) {
-                sensor->activate(c, false);
-            } else {
-                ALOGE("sensor interface of handle=0x%08x is null!", handle);
-            }
-            c->removeSensor(handle);
+    ALOGD_IF(DEBUG_CONNECTIONS, "%zu active sensors", mActiveSensors.size());
+    // only visit the sensors registered on this connection instead of scanning the whole
+    // active sensor table; a consistent connection only appears in records of its own sensors.
+    for (int32_t handle : c->getActiveSensorHandles()) {
+        const ssize_t index = mActiveSensors.indexOfKey(handle);
+        if (index < 0) {
+            ALOGE("sensor 0x%08x on connection %p is not in the active list!", handle, c);
+            continue;
         }
-        SensorRecord* rec = mActiveSensors.valueAt(i);
-        ALOGE_IF(!rec, "mActiveSensors[%zu] is null (handle=0x%08x)!", i, handle);
+        ALOGD_IF(DEBUG_CONNECTIONS, "disabling handle=0x%08x", handle);
+        sp<SensorInterface> sensor = getSensorInterfaceFromHandle(handle);
+        if (sensor != nullptr) {
+            sensor->activate(c, false);
+        } else {
+            ALOGE("sensor interface of handle=0x%08x is null!", handle);
+        }
+        c->removeSensor(handle);
+
+        SensorRecord* rec = mActiveSensors.valueAt(index);
+        ALOGE_IF(!rec, "mActiveSensors[%zd] is null (handle=0x%08x)!", index, handle);
         ALOGD_IF(DEBUG_CONNECTIONS,
-                "removing connection %p for sensor[%zu].handle=0x%08x",
-                c, i, handle);
+                "removing connection %p for sensor handle=0x%08x", c, handle);
 
         if (rec && rec->removeConnection(connection)) {
             ALOGD_IF(DEBUG_CONNECTIONS, "... and it was the last connection");
-            mActiveSensors.removeItemsAt(i, 1);
-            mActiveVirtualSensors.erase(handle);
+            mActiveSensors.removeItemsAt(index, 1);
+            if (mDirectVirtualActivations.count(handle) == 0) {
+                mActiveVirtualSensors.erase(handle);
+            }
             delete rec;
-            size--;
-        } else {
-            i++;
         }
     }
     c->updateLooperRegistration(mLooper);
@@ -1297,11 +1391,64 @@ void SensorService::cleanupConnection(SensorEventConnection* c) {
 void SensorService::cleanupConnection(SensorDirectConnection* c) {
     Mutex::Autolock _l(mLock);
 
+    // release the fusion clients of any virtual sensors still activated on this channel
+    for (int handle : c->drainVirtualActivations()) {
+        disableVirtualForDirectChannelLocked(c, handle);
+    }
+
     SensorDevice& dev(SensorDevice::getInstance());
     dev.unregisterDirectChannel(c->getHalChannelHandle());
     mDirectConnections.remove(c);
 }
 
+status_t SensorService::enableVirtualForDirectChannel(SensorDirectConnection* conn, int handle,
+        nsecs_t samplingPeriodNs) {
+    Mutex::Autolock _l(mLock);
+
+    sp<SensorInterface> si = getSensorInterfaceFromHandle(handle);
+    if (si == nullptr || !si->isVirtual()) {
+        return NAME_NOT_FOUND;
+    }
+
+    status_t err = si->batch(conn, handle, 0, samplingPeriodNs, 0);
+    if (err == NO_ERROR) {
+        err = si->activate(conn, true);
+    }
+    if (err != NO_ERROR) {
+        return err;
+    }
+
+    mDirectVirtualActivations[handle]++;
+    mActiveVirtualSensors.emplace(handle);
+    return NO_ERROR;
+}
+
+void SensorService::disableVirtualForDirectChannel(SensorDirectConnection* conn, int handle) {
+    Mutex::Autolock _l(mLock);
+    disableVirtualForDirectChannelLocked(conn, handle);
+}
+
+void SensorService::disableVirtualForDirectChannelLocked(SensorDirectConnection* conn,
+        int handle) {
+    auto it = mDirectVirtualActivations.find(handle);
+    if (it == mDirectVirtualActivations.end()) {
+        return;
+    }
+
+    sp<SensorInterface> si = getSensorInterfaceFromHandle(handle);
+    if (si != nullptr) {
+        si->activate(conn, false);
+    }
+
+    if (--(it->second) == 0) {
+        mDirectVirtualActivations.erase(it);
+        // keep the virtual sensor running if event connections still use it
+        if (mActiveSensors.indexOfKey(handle) < 0) {
+            mActiveVirtualSensors.erase(handle);
+        }
+    }
+}
+
 sp<SensorInterface> SensorService::getSensorInterfaceFromHandle(int handle) const {
     return mSensors.getInterface(handle);
 }
@@ -1473,7 +1620,9 @@ status_t SensorService::cleanupWithoutDisableLocked(
         // see if this sensor becomes inactive
         if (rec->removeConnection(connection)) {
             mActiveSensors.removeItem(handle);
-            mActiveVirtualSensors.erase(handle);
+            if (mDirectVirtualActivations.count(handle) == 0) {
+                mActiveVirtualSensors.erase(handle);
+            }
             delete rec;
         }
         return NO_ERROR;
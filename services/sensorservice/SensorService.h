@@ -80,6 +80,12 @@ public:
 
     status_t disable(const sp<SensorEventConnection>& connection, int handle);
 
+    // Activate/deactivate a virtual sensor on behalf of a direct channel that the service
+    // writes into. Each enable must be balanced by exactly one disable per channel.
+    status_t enableVirtualForDirectChannel(SensorDirectConnection* conn, int handle,
+                                           nsecs_t samplingPeriodNs);
+    void disableVirtualForDirectChannel(SensorDirectConnection* conn, int handle);
+
     status_t setEventRate(const sp<SensorEventConnection>& connection, int handle, nsecs_t ns,
                           const String16& opPackageName);
 
@@ -190,6 +196,7 @@ private:
     // ISensorServer interface
     virtual Vector<Sensor> getSensorList(const String16& opPackageName);
     virtual Vector<Sensor> getDynamicSensorList(const String16& opPackageName);
+    virtual sp<IMemory> getSensorListMemory();
     virtual sp<ISensorEventConnection> createSensorEventConnection(
             const String8& packageName,
             int requestedMode, const String16& opPackageName);
@@ -210,6 +217,7 @@ private:
     const Sensor& registerVirtualSensor(SensorInterface* sensor, bool isDebug = false);
     const Sensor& registerDynamicSensorLocked(SensorInterface* sensor, bool isDebug = false);
     bool unregisterDynamicSensorLocked(int handle);
+    void disableVirtualForDirectChannelLocked(SensorDirectConnection* conn, int handle);
     status_t cleanupWithoutDisable(const sp<SensorEventConnection>& connection, int handle);
     status_t cleanupWithoutDisableLocked(const sp<SensorEventConnection>& connection, int handle);
     void cleanupAutoDisabledSensorLocked(const sp<SensorEventConnection>& connection,
@@ -290,12 +298,18 @@ private:
     mutable Mutex mLock;
     DefaultKeyedVector<int, SensorRecord*> mActiveSensors;
     std::unordered_set<int> mActiveVirtualSensors;
+    // Count of direct channels holding each virtual sensor active; keeps the handle in
+    // mActiveVirtualSensors while no SensorEventConnection uses it.
+    std::unordered_map<int, int> mDirectVirtualActivations;
     SortedVector< wp<SensorEventConnection> > mActiveConnections;
     bool mWakeLockAcquired;
     sensors_event_t *mSensorEventBuffer, *mSensorEventScratch;
     wp<const SensorEventConnection> * mMapFlushEventsToConnections;
     std::unordered_map<int, RecentEventLogger*> mRecentEvent;
     SortedVector< wp<SensorDirectConnection> > mDirectConnections;
+    // Read-only shared memory copy of the static sensor list, built on
+    // first use and handed to every SensorManager instance.
+    sp<IMemory> mSensorListMemory;
     Mode mCurrentOperatingMode;
 
     // This packagaName is set when SensorService is in RESTRICTED or DATA_INJECTION mode. Only
@@ -0,0 +1,259 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../RecentEventLogger.h"
+#include "../SensorList.h"
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+#include <poll.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <hardware/sensors.h>
+#include <sensor/BitTube.h>
+#include <utils/Timers.h>
+
+namespace android {
+
+using SensorServiceUtil::RecentEventLogger;
+using SensorServiceUtil::SensorList;
+
+// Socket buffer size used by SensorService for event connections.
+static const size_t SOCKET_BUFFER_SIZE = 100 * 1024;
+
+// Events sent per write on the fan-out path, sized like a typical HAL batch.
+static const size_t MAX_BATCH_SIZE = 256;
+
+
+// --- SyntheticSensor ---
+
+// A SensorInterface that touches no hardware, so SensorList can be populated
+// without a HAL.
+class SyntheticSensor : public SensorInterface {
+public:
+    explicit SyntheticSensor(int handle) {
+        sensor_t hwSensor;
+        memset(&hwSensor, 0, sizeof(hwSensor));
+        hwSensor.name = "Synthetic Sensor";
+        hwSensor.vendor = "benchmark";
+        hwSensor.version = 1;
+        hwSensor.handle = handle;
+        hwSensor.type = SENSOR_TYPE_ACCELEROMETER;
+        hwSensor.maxRange = 8.0f;
+        hwSensor.resolution = 0.01f;
+        hwSensor.minDelay = 2500;
+        mSensor = Sensor(&hwSensor, SENSORS_DEVICE_API_VERSION_1_3);
+    }
+
+    virtual bool process(sensors_event_t*, const sensors_event_t&) override {
+        return false;
+    }
+    virtual status_t activate(void*, bool) override { return NO_ERROR; }
+    virtual status_t setDelay(void*, int, int64_t) override { return NO_ERROR; }
+    virtual status_t batch(void*, int, int, int64_t, int64_t) override { return NO_ERROR; }
+    virtual status_t flush(void*, int) override { return NO_ERROR; }
+    virtual const Sensor& getSensor() const override { return mSensor; }
+    virtual bool isVirtual() const override { return false; }
+    virtual void autoDisable(void*, int) override { }
+
+private:
+    Sensor mSensor;
+};
+
+
+// --- ConsumerThread ---
+
+// Reads event batches from the receive end of a connection's BitTube and
+// records the send-to-receive latency of every event.
+class ConsumerThread {
+public:
+    explicit ConsumerThread(const sp<BitTube>& tube) : mTube(tube), mExiting(false) {
+        mThread = std::thread(&ConsumerThread::loop, this);
+    }
+
+    void stopAndJoin() {
+        mExiting = true;
+        mThread.join();
+    }
+
+    const std::vector<nsecs_t>& getLatencySamples() const {
+        return mLatencySamples;
+    }
+
+private:
+    void loop() {
+        sensors_event_t buffer[MAX_BATCH_SIZE];
+        struct pollfd pfd;
+        pfd.fd = mTube->getFd();
+        pfd.events = POLLIN;
+        while (!mExiting) {
+            pfd.revents = 0;
+            poll(&pfd, 1, 10);
+
+            ssize_t count;
+            while ((count = BitTube::recvObjects(mTube, buffer, MAX_BATCH_SIZE)) > 0) {
+                nsecs_t now = systemTime(SYSTEM_TIME_MONOTONIC);
+                for (ssize_t i = 0; i < count; i++) {
+                    mLatencySamples.push_back(now - buffer[i].timestamp);
+                }
+            }
+        }
+    }
+
+    sp<BitTube> mTube;
+    volatile bool mExiting;
+    std::thread mThread;
+    std::vector<nsecs_t> mLatencySamples;
+};
+
+
+static nsecs_t percentile(std::vector<nsecs_t> samples, int32_t p) {
+    if (samples.empty()) {
+        return 0;
+    }
+    std::sort(samples.begin(), samples.end());
+    return samples[(samples.size() - 1) * p / 100];
+}
+
+static sensors_event_t makeEvent(int handle) {
+    sensors_event_t event;
+    memset(&event, 0, sizeof(event));
+    event.version = sizeof(sensors_event_t);
+    event.sensor = handle;
+    event.type = SENSOR_TYPE_ACCELEROMETER;
+    event.acceleration.x = 0.0f;
+    event.acceleration.y = 0.0f;
+    event.acceleration.z = 9.8f;
+    return event;
+}
+
+/*
+ * Measures the transport stage of event distribution: writing a batch of
+ * events to the BitTube of every connection and receiving them on consumer
+ * threads, the same socket path SensorEventConnection::sendEvents uses.
+ * Reports per-event delivery latency percentiles.
+ *
+ * Arguments: { connection count, events per batch }.
+ */
+static void eventFanoutLatency(benchmark::State& state) {
+    const size_t connectionCount = size_t(state.range(0));
+    const size_t batchSize = size_t(state.range(1));
+
+    std::vector<sp<BitTube> > tubes;
+    std::vector<ConsumerThread*> consumers;
+    for (size_t i = 0; i < connectionCount; i++) {
+        sp<BitTube> tube = new BitTube(SOCKET_BUFFER_SIZE);
+        tubes.push_back(tube);
+        consumers.push_back(new ConsumerThread(tube));
+    }
+
+    sensors_event_t buffer[MAX_BATCH_SIZE];
+    for (size_t i = 0; i < batchSize; i++) {
+        buffer[i] = makeEvent(int(i + 1));
+    }
+
+    size_t eventsSent = 0;
+    for (auto _ : state) {
+        nsecs_t now = systemTime(SYSTEM_TIME_MONOTONIC);
+        for (size_t i = 0; i < batchSize; i++) {
+            buffer[i].timestamp = now;
+        }
+        for (size_t i = 0; i < connectionCount; i++) {
+            BitTube::sendObjects(tubes[i], buffer, batchSize);
+        }
+        eventsSent += batchSize * connectionCount;
+    }
+
+    // Give the consumers a moment to drain in-flight batches.
+    usleep(50 * 1000);
+
+    std::vector<nsecs_t> samples;
+    for (ConsumerThread* consumer : consumers) {
+        consumer->stopAndJoin();
+        samples.insert(samples.end(), consumer->getLatencySamples().begin(),
+                       consumer->getLatencySamples().end());
+        delete consumer;
+    }
+
+    state.counters["events_sent"] = eventsSent;
+    state.counters["events_received"] = samples.size();
+    state.counters["latency_p50_us"] = percentile(samples, 50) / 1000.0;
+    state.counters["latency_p90_us"] = percentile(samples, 90) / 1000.0;
+    state.counters["latency_p99_us"] = percentile(samples, 99) / 1000.0;
+    state.SetItemsProcessed(eventsSent);
+}
+
+BENCHMARK(eventFanoutLatency)
+        ->Args({1, 16})
+        ->Args({8, 16})
+        ->Args({32, 16})
+        ->Args({8, 256})
+        ->UseRealTime();
+
+
+/*
+ * Measures SensorList::getInterface, the per-event handle lookup performed on
+ * the poll thread, against a list populated with synthetic sensors.
+ *
+ * Argument: { sensor count }.
+ */
+static void sensorListGetInterface(benchmark::State& state) {
+    const int sensorCount = int(state.range(0));
+
+    SensorList list;
+    for (int handle = 1; handle <= sensorCount; handle++) {
+        list.add(handle, new SyntheticSensor(handle));
+    }
+
+    int handle = 1;
+    for (auto _ : state) {
+        sp<SensorInterface> si = list.getInterface(handle);
+        benchmark::DoNotOptimize(si);
+        handle = handle % sensorCount + 1;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(sensorListGetInterface)
+        ->Arg(8)
+        ->Arg(80);
+
+
+/*
+ * Measures RecentEventLogger::addEvent, which runs under SensorService::mLock
+ * for every event recorded on the poll thread.
+ */
+static void recentEventLoggerAdd(benchmark::State& state) {
+    RecentEventLogger logger(SENSOR_TYPE_ACCELEROMETER);
+    sensors_event_t event = makeEvent(1);
+
+    for (auto _ : state) {
+        event.timestamp = systemTime(SYSTEM_TIME_MONOTONIC);
+        logger.addEvent(event);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(recentEventLoggerAdd);
+
+} // namespace android
+
+BENCHMARK_MAIN();
@@ -25,6 +25,11 @@ namespace sensorservice {
 namespace V1_0 {
 namespace implementation {
 
+// Number of events pulled out of the SensorEventQueue per read.  The queue
+// buffers up to 256 events per receive internally, so this only bounds the
+// stack buffer, not how much a single socket syscall drains.
+static constexpr size_t kEventBatchSize = 16;
+
 class EventQueueLooperCallback : public ::android::LooperCallback {
 public:
     EventQueueLooperCallback(sp<::android::SensorEventQueue> queue,
@@ -34,7 +39,7 @@ public:
 
     int handleEvent(__unused int fd, __unused int events, __unused void* data) {
 
-        ASensorEvent event;
+        ASensorEvent eventBuffer[kEventBatchSize];
         ssize_t actual;
 
         auto internalQueue = mQueue.promote();
@@ -42,10 +47,15 @@ public:
             return 1;
         }
 
-        while ((actual = internalQueue->read(&event, 1 /* count */)) > 0) {
-            internalQueue->sendAck(&event, actual);
-            Return<void> ret = mCallback->onEvent(convertEvent(event));
-            (void)ret.isOk(); // ignored
+        // Drain the channel in batches so each burst costs one read and one
+        // wake-up ack instead of a read/ack pair per event.  The callback
+        // still receives one event at a time, as the interface requires.
+        while ((actual = internalQueue->read(eventBuffer, kEventBatchSize)) > 0) {
+            internalQueue->sendAck(eventBuffer, actual);
+            for (ssize_t i = 0; i < actual; i++) {
+                Return<void> ret = mCallback->onEvent(convertEvent(eventBuffer[i]));
+                (void)ret.isOk(); // ignored
+            }
         }
 
         return 1; // continue to receive callbacks
@@ -81,7 +81,7 @@ public:
      * isProtected - true if the layer may contain protected content in the
      * GRALLOC_USAGE_PROTECTED sense.
      */
-    bool isProtected() const;
+    bool isProtected() const override;
 
     /*
      * isVisible - true if this layer is visible, false otherwise
@@ -125,8 +125,10 @@ public:
      * operation, so this should be set only if needed). Typically this is used
      * to figure out if the content or size of a surface has changed.
      */
-    Region latchBuffer(bool& recomputeVisibleRegions, nsecs_t latchTime) override;
+    Region latchBuffer(bool& recomputeVisibleRegions, nsecs_t latchTime,
+                       const sp<Fence>& releaseFlushFence = nullptr) override;
     bool isBufferLatched() const override { return mRefreshPending; }
+    void prepareTextureImage() override;
     void setDefaultBufferSize(uint32_t w, uint32_t h) override;
 
     bool isHdrY410() const override;
@@ -76,7 +76,8 @@ BufferLayerConsumer::BufferLayerConsumer(const sp<IGraphicBufferConsumer>& bq,
         mRE(engine),
         mTexName(tex),
         mLayer(layer),
-        mCurrentTexture(BufferQueue::INVALID_BUFFER_SLOT) {
+        mCurrentTexture(BufferQueue::INVALID_BUFFER_SLOT),
+        mCurrentTexturePrepared(false) {
     BLC_LOGV("BufferLayerConsumer");
 
     memcpy(mCurrentTransformMatrix, mtxIdentity.asArray(), sizeof(mCurrentTransformMatrix));
@@ -150,7 +151,8 @@ nsecs_t BufferLayerConsumer::computeExpectedPresent(const DispSync& dispSync) {
 
 status_t BufferLayerConsumer::updateTexImage(BufferRejecter* rejecter, const DispSync& dispSync,
                                              bool* autoRefresh, bool* queuedBuffer,
-                                             uint64_t maxFrameNumber) {
+                                             uint64_t maxFrameNumber,
+                                             const sp<Fence>& releaseFlushFence) {
     ATRACE_CALL();
     BLC_LOGV("updateTexImage");
     Mutex::Autolock lock(mMutex);
@@ -160,8 +162,10 @@ status_t BufferLayerConsumer::updateTexImage(BufferRejecter* rejecter, const Dis
         return NO_INIT;
     }
 
-    // Make sure RenderEngine is current
-    if (!mRE.isCurrent()) {
+    // Make sure RenderEngine is current, unless the caller supplied the
+    // release fence itself, in which case no EGL work happens on this
+    // thread and the call may be made from a latch worker thread.
+    if (releaseFlushFence == nullptr && !mRE.isCurrent()) {
         BLC_LOGE("updateTexImage: RenderEngine is not current");
         return INVALID_OPERATION;
     }
@@ -201,7 +205,7 @@ status_t BufferLayerConsumer::updateTexImage(BufferRejecter* rejecter, const Dis
     }
 
     // Release the previous buffer.
-    err = updateAndReleaseLocked(item, &mPendingRelease);
+    err = updateAndReleaseLocked(item, &mPendingRelease, releaseFlushFence);
     if (err != NO_ERROR) {
         return err;
     }
@@ -289,14 +293,15 @@ bool BufferLayerConsumer::canUseImageCrop(const Rect& crop) const {
 }
 
 status_t BufferLayerConsumer::updateAndReleaseLocked(const BufferItem& item,
-                                                     PendingRelease* pendingRelease) {
+                                                     PendingRelease* pendingRelease,
+                                                     const sp<Fence>& releaseFlushFence) {
     status_t err = NO_ERROR;
 
     int slot = item.mSlot;
 
     // Do whatever sync ops we need to do before releasing the old slot.
     if (slot != mCurrentTexture) {
-        err = syncForReleaseLocked();
+        err = syncForReleaseLocked(releaseFlushFence);
         if (err != NO_ERROR) {
             // Release the buffer we just acquired.  It's not safe to
             // release the old buffer, so instead we just drop the new frame.
@@ -337,6 +342,7 @@ status_t BufferLayerConsumer::updateAndReleaseLocked(const BufferItem& item,
     // Update the BufferLayerConsumer state.
     mCurrentTexture = slot;
     mCurrentTextureImage = nextTextureImage;
+    mCurrentTexturePrepared = false;
     mCurrentCrop = item.mCrop;
     mCurrentTransform = item.mTransform;
     mCurrentScalingMode = item.mScalingMode;
@@ -375,21 +381,65 @@ status_t BufferLayerConsumer::bindTextureImageLocked() {
 
     mRE.bindExternalTextureImage(mTexName, mCurrentTextureImage->image());
 
+    if (mCurrentTexturePrepared) {
+        // prepareTextureImage already issued the wait on the acquire fence,
+        // before any RenderEngine command that could read this buffer.
+        return NO_ERROR;
+    }
+
     // Wait for the new buffer to be ready.
     return doFenceWaitLocked();
 }
 
-status_t BufferLayerConsumer::syncForReleaseLocked() {
+status_t BufferLayerConsumer::prepareTextureImage() {
+    ATRACE_CALL();
+    Mutex::Autolock lock(mMutex);
+
+    if (mAbandoned) {
+        BLC_LOGE("prepareTextureImage: BufferLayerConsumer is abandoned!");
+        return NO_INIT;
+    }
+
+    if (mCurrentTextureImage == nullptr || mCurrentTexturePrepared) {
+        return NO_ERROR;
+    }
+
+    if (!mRE.isCurrent()) {
+        // Not on the RenderEngine thread; bindTextureImage will do the work
+        // on the composition path as before.
+        return INVALID_OPERATION;
+    }
+
+    const Rect& imageCrop = canUseImageCrop(mCurrentCrop) ? mCurrentCrop : Rect::EMPTY_RECT;
+    status_t err = mCurrentTextureImage->createIfNeeded(imageCrop);
+    if (err != NO_ERROR) {
+        BLC_LOGW("prepareTextureImage: can't create image on slot=%d", mCurrentTexture);
+        return UNKNOWN_ERROR;
+    }
+
+    err = doFenceWaitLocked();
+    if (err != NO_ERROR) {
+        return err;
+    }
+
+    mCurrentTexturePrepared = true;
+    return NO_ERROR;
+}
+
+status_t BufferLayerConsumer::syncForReleaseLocked(const sp<Fence>& releaseFlushFence) {
     BLC_LOGV("syncForReleaseLocked");
 
     if (mCurrentTexture != BufferQueue::INVALID_BUFFER_SLOT) {
         if (SyncFeatures::getInstance().useNativeFenceSync()) {
-            base::unique_fd fenceFd = mRE.flush();
-            if (fenceFd == -1) {
-                BLC_LOGE("syncForReleaseLocked: failed to flush RenderEngine");
-                return UNKNOWN_ERROR;
+            sp<Fence> fence = releaseFlushFence;
+            if (fence == nullptr) {
+                base::unique_fd fenceFd = mRE.flush();
+                if (fenceFd == -1) {
+                    BLC_LOGE("syncForReleaseLocked: failed to flush RenderEngine");
+                    return UNKNOWN_ERROR;
+                }
+                fence = new Fence(std::move(fenceFd));
             }
-            sp<Fence> fence(new Fence(std::move(fenceFd)));
             status_t err = addReleaseFenceLocked(mCurrentTexture,
                                                  mCurrentTextureImage->graphicBuffer(), fence);
             if (err != OK) {
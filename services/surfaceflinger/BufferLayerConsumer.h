@@ -51,8 +51,10 @@ class Image;
  * previous contents are retained.  The texture is attached and updated after
  * bindTextureImage() is called.
  *
- * All calls to updateTexImage must be made with RenderEngine being current.
- * The texture is attached to the TEXTURE_EXTERNAL texture target.
+ * All calls to updateTexImage must be made with RenderEngine being current,
+ * unless the caller passes in a pre-created release flush fence (see
+ * updateTexImage). The texture is attached to the TEXTURE_EXTERNAL texture
+ * target.
  */
 class BufferLayerConsumer : public ConsumerBase {
 public:
@@ -93,12 +95,31 @@ public:
     // Unlike the GLConsumer version, this version takes a functor that may be
     // used to reject the newly acquired buffer.  It also does not bind the
     // RenderEngine texture until bindTextureImage is called.
+    //
+    // If releaseFlushFence is non-null it is used as the release fence for
+    // the outgoing buffer instead of flushing RenderEngine here. In that
+    // case no EGL work is performed on the calling thread, so the call may
+    // be made without RenderEngine being current (e.g. from a latch worker
+    // thread); the caller must have obtained the fence from
+    // RenderEngine::flush() on the main thread after the last read of the
+    // outgoing buffer, and native fence sync must be in use.
     status_t updateTexImage(BufferRejecter* rejecter, const DispSync& dispSync, bool* autoRefresh,
-                            bool* queuedBuffer, uint64_t maxFrameNumber);
+                            bool* queuedBuffer, uint64_t maxFrameNumber,
+                            const sp<Fence>& releaseFlushFence = nullptr);
 
     // See BufferLayerConsumer::bindTextureImageLocked().
     status_t bindTextureImage();
 
+    // prepareTextureImage creates the RE::Image for the current buffer if it
+    // does not exist yet and issues the GPU-side wait on its acquire fence,
+    // so that a later bindTextureImage on the composition path finds a
+    // ready-to-bind texture instead of stalling on EGLImage creation.
+    //
+    // This call may only be made while RenderEngine is current; when it is
+    // not, it returns INVALID_OPERATION and bindTextureImage does the work
+    // as before.
+    status_t prepareTextureImage();
+
     // setReleaseFence stores a fence that will signal when the current buffer
     // is no longer being read. This fence will be returned to the producer
     // when the current buffer is released by updateTexImage(). Multiple
@@ -208,7 +229,8 @@ protected:
     // completion of the method will instead be returned to the caller, so that
     // it may call releaseBufferLocked itself later.
     status_t updateAndReleaseLocked(const BufferItem& item,
-                                    PendingRelease* pendingRelease = nullptr);
+                                    PendingRelease* pendingRelease = nullptr,
+                                    const sp<Fence>& releaseFlushFence = nullptr);
 
     // Binds mTexName and the current buffer to TEXTURE_EXTERNAL target.  Uses
     // mCurrentTexture if it's set, mCurrentTextureImage if not.  If the
@@ -282,8 +304,10 @@ private:
     // syncForReleaseLocked performs the synchronization needed to release the
     // current slot from RenderEngine.  If needed it will set the current
     // slot's fence to guard against a producer accessing the buffer before
-    // the outstanding accesses have completed.
-    status_t syncForReleaseLocked();
+    // the outstanding accesses have completed. If releaseFlushFence is
+    // non-null it is used as that fence instead of flushing RenderEngine,
+    // which keeps this call free of EGL work.
+    status_t syncForReleaseLocked(const sp<Fence>& releaseFlushFence = nullptr);
 
     // The default consumer usage flags that BufferLayerConsumer always sets on its
     // BufferQueue instance; these will be OR:d with any additional flags passed
@@ -381,6 +405,11 @@ private:
     // reset mCurrentTexture to INVALID_BUFFER_SLOT.
     int mCurrentTexture;
 
+    // Whether prepareTextureImage has already created the image for the
+    // current buffer and issued the GPU-side wait on its acquire fence.
+    // Cleared whenever a new buffer becomes current.
+    bool mCurrentTexturePrepared;
+
     // A release that is pending on the receipt of a new release fence from
     // presentDisplay
     PendingRelease mPendingRelease;
@@ -174,6 +174,45 @@ status_t Client::createSurface(
                                  ownerUid, handle, gbp, &parent);
 }
 
+status_t Client::createSurfaces(
+        const std::vector<ISurfaceComposerClient::SurfaceDescriptor>& descriptors,
+        std::vector<ISurfaceComposerClient::CreatedSurface>* outResults)
+{
+    const size_t count = descriptors.size();
+    outResults->clear();
+    outResults->resize(count);
+
+    // Resolve each entry's parent up front, exactly as createSurface() does.
+    // Entries whose parent is gone fail individually with NAME_NOT_FOUND;
+    // the rest of the batch still proceeds.
+    std::vector<sp<Layer>> parents(count);
+    for (size_t i = 0; i < count; i++) {
+        const sp<IBinder>& parentHandle = descriptors[i].parent;
+        sp<Layer> parent = nullptr;
+        if (parentHandle != nullptr) {
+            auto layerHandle = reinterpret_cast<Layer::Handle*>(parentHandle.get());
+            parent = layerHandle->owner.promote();
+            if (parent == nullptr) {
+                (*outResults)[i].result = NAME_NOT_FOUND;
+                continue;
+            }
+        }
+        if (parent == nullptr) {
+            bool parentDied;
+            parent = getParentLayer(&parentDied);
+            // If we had a parent, but it died, we've lost all
+            // our capabilities.
+            if (parentDied) {
+                (*outResults)[i].result = NAME_NOT_FOUND;
+                continue;
+            }
+        }
+        parents[i] = parent;
+    }
+
+    return mFlinger->createLayers(this, descriptors, parents, outResults);
+}
+
 status_t Client::destroySurface(const sp<IBinder>& handle) {
     return mFlinger->onLayerRemoved(this, handle);
 }
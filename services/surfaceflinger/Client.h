@@ -62,6 +62,10 @@ private:
             sp<IBinder>* handle,
             sp<IGraphicBufferProducer>* gbp);
 
+    virtual status_t createSurfaces(
+            const std::vector<ISurfaceComposerClient::SurfaceDescriptor>& descriptors,
+            std::vector<ISurfaceComposerClient::CreatedSurface>* outResults);
+
     virtual status_t destroySurface(const sp<IBinder>& handle);
 
     virtual status_t clearLayerFrameStats(const sp<IBinder>& handle) const;
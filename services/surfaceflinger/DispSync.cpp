@@ -36,7 +36,6 @@
 #include "EventLog/EventLog.h"
 #include "SurfaceFlinger.h"
 
-using std::max;
 using std::min;
 
 namespace android {
@@ -442,7 +441,17 @@ bool DispSync::addPresentFence(const std::shared_ptr<FenceTime>& fenceTime) {
 
     updateErrorLocked();
 
-    return !mModelUpdated || mError > kErrorThreshold;
+    // Debounce transient error spikes: a single bad present time (e.g. a
+    // GPU-bound frame missing its window) shouldn't cost a hardware vsync
+    // re-enable.  Only fall back to hardware vsync when the error stays
+    // above threshold across consecutive present samples.
+    if (mModelUpdated && mError > kErrorThreshold) {
+        mHighErrSamplesCount++;
+    } else {
+        mHighErrSamplesCount = 0;
+    }
+
+    return !mModelUpdated || mHighErrSamplesCount >= NUM_HIGH_ERR_SAMPLES_FOR_RESYNC;
 }
 
 void DispSync::beginResync() {
@@ -538,21 +547,31 @@ void DispSync::updateModelLocked() {
     ALOGV("[%s] updateModelLocked %zu", mName, mNumResyncSamples);
     if (mNumResyncSamples >= MIN_RESYNC_SAMPLES_FOR_UPDATE) {
         ALOGV("[%s] Computing...", mName);
-        nsecs_t durationSum = 0;
-        nsecs_t minDuration = INT64_MAX;
-        nsecs_t maxDuration = 0;
-        for (size_t i = 1; i < mNumResyncSamples; i++) {
+        // Fit the period with a least-squares regression of the sample
+        // timestamps against their indices instead of averaging the
+        // durations.  On panels whose refresh rate drifts, the regression
+        // tracks the current rate rather than lagging half a window behind
+        // it, which keeps the prediction error under threshold for longer
+        // and lets hardware vsync stay off.  The sums comfortably fit in 64
+        // bits: timestamps are taken relative to the oldest sample, so they
+        // are bounded by the window duration.
+        nsecs_t sumX = 0;
+        nsecs_t sumXX = 0;
+        nsecs_t sumY = 0;
+        nsecs_t sumXY = 0;
+        const nsecs_t baseTime = mResyncSamples[mFirstResyncSample];
+        for (size_t i = 0; i < mNumResyncSamples; i++) {
             size_t idx = (mFirstResyncSample + i) % MAX_RESYNC_SAMPLES;
-            size_t prev = (idx + MAX_RESYNC_SAMPLES - 1) % MAX_RESYNC_SAMPLES;
-            nsecs_t duration = mResyncSamples[idx] - mResyncSamples[prev];
-            durationSum += duration;
-            minDuration = min(minDuration, duration);
-            maxDuration = max(maxDuration, duration);
+            const nsecs_t x = nsecs_t(i);
+            const nsecs_t y = mResyncSamples[idx] - baseTime;
+            sumX += x;
+            sumXX += x * x;
+            sumY += y;
+            sumXY += x * y;
         }
 
-        // Exclude the min and max from the average
-        durationSum -= minDuration + maxDuration;
-        mPeriod = durationSum / (mNumResyncSamples - 3);
+        const nsecs_t n = nsecs_t(mNumResyncSamples);
+        mPeriod = (n * sumXY - sumX * sumY) / (n * sumXX - sumX * sumX);
 
         ALOGV("[%s] mPeriod = %" PRId64, mName, ns2us(mPeriod));
 
@@ -648,11 +667,17 @@ void DispSync::resetErrorLocked() {
     mPresentSampleOffset = 0;
     mError = 0;
     mZeroErrSamplesCount = 0;
+    mHighErrSamplesCount = 0;
     for (size_t i = 0; i < NUM_PRESENT_SAMPLES; i++) {
         mPresentFences[i] = FenceTime::NO_FENCE;
     }
 }
 
+nsecs_t DispSync::expectedModelError() const {
+    Mutex::Autolock lock(mMutex);
+    return nsecs_t(sqrt(double(mError)));
+}
+
 nsecs_t DispSync::computeNextRefresh(int periodOffset) const {
     Mutex::Autolock lock(mMutex);
     nsecs_t now = systemTime(SYSTEM_TIME_MONOTONIC);
@@ -124,6 +124,13 @@ public:
     // the refresh after next. etc.
     nsecs_t computeNextRefresh(int periodOffset) const;
 
+    // expectedModelError returns the RMS difference in nanoseconds between
+    // the modeled vsync times and the present times observed so far.  It is a
+    // confidence measure for the predictions: callers such as the phase
+    // offset tuning can pad their offsets when prediction quality degrades
+    // rather than relying on a perfectly accurate model.
+    nsecs_t expectedModelError() const;
+
     // dump appends human-readable debug info to the result string.
     void dump(String8& result) const;
 
@@ -137,6 +144,7 @@ private:
     enum { NUM_PRESENT_SAMPLES = 8 };
     enum { MAX_RESYNC_SAMPLES_WITHOUT_PRESENT = 4 };
     enum { ACCEPTABLE_ZERO_ERR_SAMPLES_COUNT = 64 };
+    enum { NUM_HIGH_ERR_SAMPLES_FOR_RESYNC = 2 };
 
     const char* const mName;
 
@@ -162,6 +170,12 @@ private:
     // Used to sanity check that we are able to calculate the model error.
     size_t mZeroErrSamplesCount;
 
+    // mHighErrSamplesCount counts consecutive present samples for which
+    // mError exceeded the resync threshold.  Hardware vsync is only
+    // re-enabled once this reaches NUM_HIGH_ERR_SAMPLES_FOR_RESYNC, so a
+    // single outlier present time doesn't cost a hardware vsync re-enable.
+    size_t mHighErrSamplesCount;
+
     // Whether we have updated the vsync event model since the last resync.
     bool mModelUpdated;
 
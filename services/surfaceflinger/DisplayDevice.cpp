@@ -428,6 +428,44 @@ Region DisplayDevice::getDirtyRegion(bool repaintEverything) const {
     return dirty;
 }
 
+Region DisplayDevice::getPartialRepaintRegion(const Region& dirtyRegion,
+                                              uint64_t fingerprint) const {
+    bool fullRepaint = false;
+    if (fingerprint != mCompositionFingerprint) {
+        mCompositionFingerprint = fingerprint;
+        fullRepaint = true;
+    }
+
+    // The back buffer is bufferAge swaps old, so everything drawn since it
+    // was last presented must be drawn again on top of it. An age of 0 means
+    // the contents are unknown and cannot be reused.
+    const int32_t bufferAge = mSurface->queryBufferAge();
+    if (bufferAge <= 0 ||
+        static_cast<size_t>(bufferAge) - 1 > mDamageHistory.size()) {
+        fullRepaint = true;
+    }
+
+    Region repaint;
+    if (fullRepaint) {
+        repaint.set(getBounds());
+    } else {
+        repaint = dirtyRegion;
+        for (auto it = mDamageHistory.end() - (bufferAge - 1);
+             it != mDamageHistory.end(); ++it) {
+            repaint.orSelf(*it);
+        }
+        repaint.andSelf(getBounds());
+    }
+
+    mDamageHistory.push_back(repaint);
+    if (mDamageHistory.size() > kMaxDamageHistory) {
+        mDamageHistory.pop_front();
+    }
+
+    mSurface->setDamageRegion(repaint);
+    return repaint;
+}
+
 // ----------------------------------------------------------------------------
 void DisplayDevice::setPowerMode(int mode) {
     mPowerMode = mode;
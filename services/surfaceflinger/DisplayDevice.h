@@ -20,6 +20,7 @@
 #include "Transform.h"
 
 #include <stdlib.h>
+#include <deque>
 #include <unordered_map>
 
 #include <math/mat4.h>
@@ -118,6 +119,19 @@ public:
     const Vector< sp<Layer> >& getLayersNeedingFences() const;
     Region                  getDirtyRegion(bool repaintEverything) const;
 
+    // Returns the region of the client target that must be redrawn this
+    // frame. When the buffer age reported by EGL identifies which previous
+    // frame the current back buffer holds, this is the dirty region plus the
+    // damage of the frames drawn in between; otherwise the full display
+    // bounds. fingerprint captures the parts of the client composition
+    // configuration that the damage history cannot see (layer composition
+    // types, color transforms): when it changes the previous buffer contents
+    // are unusable and a full repaint is forced. Must be called exactly once
+    // per client-composited frame, after makeCurrent(); it also announces
+    // the damage to EGL when EGL_KHR_partial_update is available.
+    Region                  getPartialRepaintRegion(const Region& dirtyRegion,
+                                                    uint64_t fingerprint) const;
+
     void                    setLayerStack(uint32_t stack);
     void                    setDisplaySize(const int newWidth, const int newHeight);
     void                    setProjection(int orientation, const Rect& viewport, const Rect& frame);
@@ -248,6 +262,13 @@ private:
     // list of layers needing fences
     Vector< sp<Layer> > mLayersNeedingFences;
 
+    // Damage drawn into each of the last few client target buffers, most
+    // recent last. Combined with the EGL buffer age to limit client
+    // composition to the pixels that actually changed.
+    static constexpr size_t kMaxDamageHistory = 8;
+    mutable std::deque<Region> mDamageHistory;
+    mutable uint64_t mCompositionFingerprint = 0;
+
     /*
      * Transaction state
      */
@@ -61,6 +61,20 @@ inline bool hasMetadataKey(const std::set<Hwc2::PerFrameMetadataKey>& keys,
     return keys.find(key) != keys.end();
 }
 
+// Region has no operator==, so the shadow-state checks in the Layer
+// setters compare the underlying rect arrays directly.
+bool regionsEqual(const Region& lhs, const Region& rhs) {
+    size_t lhsRectCount = 0;
+    size_t rhsRectCount = 0;
+    auto lhsRects = lhs.getArray(&lhsRectCount);
+    auto rhsRects = rhs.getArray(&rhsRectCount);
+
+    if (lhsRectCount != rhsRectCount) {
+        return false;
+    }
+    return std::equal(lhsRects, lhsRects + lhsRectCount, rhsRects);
+}
+
 class ComposerCallbackBridge : public Hwc2::IComposerCallback {
 public:
     ComposerCallbackBridge(ComposerCallback* callback, int32_t sequenceId)
@@ -365,8 +379,7 @@ Error Display::getActiveConfigIndex(int* outIndex) const {
     return Error::None;
 }
 
-Error Display::getChangedCompositionTypes(
-        std::unordered_map<Layer*, Composition>* outTypes)
+Error Display::getChangedCompositionTypes(ChangedTypes* outTypes)
 {
     std::vector<Hwc2::Layer> layerIds;
     std::vector<Hwc2::IComposerClient::Composition> types;
@@ -387,12 +400,16 @@ Error Display::getChangedCompositionTypes(
             auto type = static_cast<Composition>(types[element]);
             ALOGV("getChangedCompositionTypes: adding %" PRIu64 " %s",
                     layer->getId(), to_string(type).c_str());
-            outTypes->emplace(layer, type);
+            outTypes->emplace_back(layer, type);
         } else {
             ALOGE("getChangedCompositionTypes: invalid layer %" PRIu64 " found"
                     " on display %" PRIu64, layerIds[element], mId);
         }
     }
+    std::sort(outTypes->begin(), outTypes->end(),
+            [](const auto& lhs, const auto& rhs) {
+                return lhs.first < rhs.first;
+            });
 
     return Error::None;
 }
@@ -536,8 +553,7 @@ Error Display::getHdrCapabilities(HdrCapabilities* outCapabilities) const
     return Error::None;
 }
 
-Error Display::getReleaseFences(
-        std::unordered_map<Layer*, sp<Fence>>* outFences) const
+Error Display::getReleaseFences(ReleaseFences* outFences) const
 {
     std::vector<Hwc2::Layer> layerIds;
     std::vector<int> fenceFds;
@@ -548,24 +564,28 @@ Error Display::getReleaseFences(
         return error;
     }
 
-    std::unordered_map<Layer*, sp<Fence>> releaseFences;
-    releaseFences.reserve(numElements);
+    outFences->clear();
+    outFences->reserve(numElements);
     for (uint32_t element = 0; element < numElements; ++element) {
         auto layer = getLayerById(layerIds[element]);
         if (layer) {
             sp<Fence> fence(new Fence(fenceFds[element]));
-            releaseFences.emplace(layer, fence);
+            outFences->emplace_back(layer, fence);
         } else {
             ALOGE("getReleaseFences: invalid layer %" PRIu64
                     " found on display %" PRIu64, layerIds[element], mId);
             for (; element < numElements; ++element) {
                 close(fenceFds[element]);
             }
+            outFences->clear();
             return Error::BadLayer;
         }
     }
+    std::sort(outFences->begin(), outFences->end(),
+            [](const auto& lhs, const auto& rhs) {
+                return lhs.first < rhs.first;
+            });
 
-    *outFences = std::move(releaseFences);
     return Error::None;
 }
 
@@ -813,13 +833,13 @@ Error Layer::setSurfaceDamage(const Region& damage)
                 mId, std::vector<Hwc2::IComposerClient::Rect>());
     } else {
         size_t rectCount = 0;
-        auto rectArray = damage.getArray(&rectCount);
+        damage.getArray(&rectCount);
 
         std::vector<Hwc2::IComposerClient::Rect> hwcRects;
-        for (size_t rect = 0; rect < rectCount; ++rect) {
-            hwcRects.push_back({rectArray[rect].left, rectArray[rect].top,
-                    rectArray[rect].right, rectArray[rect].bottom});
-        }
+        hwcRects.reserve(rectCount);
+        damage.forEachRect([&hwcRects](const Rect& rect) {
+            hwcRects.push_back({rect.left, rect.top, rect.right, rect.bottom});
+        });
 
         intError = mComposer.setLayerSurfaceDamage(mDisplayId, mId, hwcRects);
     }
@@ -829,6 +849,10 @@ Error Layer::setSurfaceDamage(const Region& damage)
 
 Error Layer::setBlendMode(BlendMode mode)
 {
+    if (mBlendMode == mode) {
+        return Error::None;
+    }
+    mBlendMode = mode;
     auto intMode = static_cast<Hwc2::IComposerClient::BlendMode>(mode);
     auto intError = mComposer.setLayerBlendMode(mDisplayId, mId, intMode);
     return static_cast<Error>(intError);
@@ -836,6 +860,12 @@ Error Layer::setBlendMode(BlendMode mode)
 
 Error Layer::setColor(hwc_color_t color)
 {
+    // hwc_color_t has no operator==, so compare the components directly
+    if (mColor && mColor->r == color.r && mColor->g == color.g &&
+            mColor->b == color.b && mColor->a == color.a) {
+        return Error::None;
+    }
+    mColor = color;
     Hwc2::IComposerClient::Color hwcColor{color.r, color.g, color.b, color.a};
     auto intError = mComposer.setLayerColor(mDisplayId, mId, hwcColor);
     return static_cast<Error>(intError);
@@ -843,6 +873,10 @@ Error Layer::setColor(hwc_color_t color)
 
 Error Layer::setCompositionType(Composition type)
 {
+    if (mCompositionType == type) {
+        return Error::None;
+    }
+    mCompositionType = type;
     auto intType = static_cast<Hwc2::IComposerClient::Composition>(type);
     auto intError = mComposer.setLayerCompositionType(
             mDisplayId, mId, intType);
@@ -907,6 +941,10 @@ Error Layer::setPerFrameMetadata(const int32_t supportedPerFrameMetadata,
 
 Error Layer::setDisplayFrame(const Rect& frame)
 {
+    if (mDisplayFrame == frame) {
+        return Error::None;
+    }
+    mDisplayFrame = frame;
     Hwc2::IComposerClient::Rect hwcRect{frame.left, frame.top,
         frame.right, frame.bottom};
     auto intError = mComposer.setLayerDisplayFrame(mDisplayId, mId, hwcRect);
@@ -915,6 +953,10 @@ Error Layer::setDisplayFrame(const Rect& frame)
 
 Error Layer::setPlaneAlpha(float alpha)
 {
+    if (mPlaneAlpha == alpha) {
+        return Error::None;
+    }
+    mPlaneAlpha = alpha;
     auto intError = mComposer.setLayerPlaneAlpha(mDisplayId, mId, alpha);
     return static_cast<Error>(intError);
 }
@@ -932,6 +974,10 @@ Error Layer::setSidebandStream(const native_handle_t* stream)
 
 Error Layer::setSourceCrop(const FloatRect& crop)
 {
+    if (mSourceCrop == crop) {
+        return Error::None;
+    }
+    mSourceCrop = crop;
     Hwc2::IComposerClient::FRect hwcRect{
         crop.left, crop.top, crop.right, crop.bottom};
     auto intError = mComposer.setLayerSourceCrop(mDisplayId, mId, hwcRect);
@@ -940,6 +986,10 @@ Error Layer::setSourceCrop(const FloatRect& crop)
 
 Error Layer::setTransform(Transform transform)
 {
+    if (mTransform == transform) {
+        return Error::None;
+    }
+    mTransform = transform;
     auto intTransform = static_cast<Hwc2::Transform>(transform);
     auto intError = mComposer.setLayerTransform(mDisplayId, mId, intTransform);
     return static_cast<Error>(intError);
@@ -947,14 +997,18 @@ Error Layer::setTransform(Transform transform)
 
 Error Layer::setVisibleRegion(const Region& region)
 {
+    if (mVisibleRegion && regionsEqual(*mVisibleRegion, region)) {
+        return Error::None;
+    }
+    mVisibleRegion = region;
     size_t rectCount = 0;
-    auto rectArray = region.getArray(&rectCount);
+    region.getArray(&rectCount);
 
     std::vector<Hwc2::IComposerClient::Rect> hwcRects;
-    for (size_t rect = 0; rect < rectCount; ++rect) {
-        hwcRects.push_back({rectArray[rect].left, rectArray[rect].top,
-                rectArray[rect].right, rectArray[rect].bottom});
-    }
+    hwcRects.reserve(rectCount);
+    region.forEachRect([&hwcRects](const Rect& rect) {
+        hwcRects.push_back({rect.left, rect.top, rect.right, rect.bottom});
+    });
 
     auto intError = mComposer.setLayerVisibleRegion(mDisplayId, mId, hwcRects);
     return static_cast<Error>(intError);
@@ -962,12 +1016,20 @@ Error Layer::setVisibleRegion(const Region& region)
 
 Error Layer::setZOrder(uint32_t z)
 {
+    if (mZOrder == z) {
+        return Error::None;
+    }
+    mZOrder = z;
     auto intError = mComposer.setLayerZOrder(mDisplayId, mId, z);
     return static_cast<Error>(intError);
 }
 
 Error Layer::setInfo(uint32_t type, uint32_t appId)
 {
+  if (mInfo == std::make_pair(type, appId)) {
+      return Error::None;
+  }
+  mInfo = std::make_pair(type, appId);
   auto intError = mComposer.setLayerInfo(mDisplayId, mId, type, appId);
   return static_cast<Error>(intError);
 }
@@ -25,26 +25,28 @@
 
 #include <gui/HdrMetadata.h>
 #include <math/mat4.h>
+#include <ui/FloatRect.h>
 #include <ui/GraphicTypes.h>
 #include <ui/HdrCapabilities.h>
+#include <ui/Rect.h>
+#include <ui/Region.h>
 #include <utils/Log.h>
 #include <utils/StrongPointer.h>
 #include <utils/Timers.h>
 
 #include <functional>
+#include <optional>
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
+#include <utility>
 #include <vector>
 
 #include "PowerAdvisor.h"
 
 namespace android {
     class Fence;
-    class FloatRect;
     class GraphicBuffer;
-    class Rect;
-    class Region;
     namespace Hwc2 {
         class Composer;
     }
@@ -107,6 +109,8 @@ public:
 
     android::Hwc2::Composer* getComposer() { return mComposer.get(); }
 
+    android::Hwc2::PowerAdvisor& getPowerAdvisor() { return mPowerAdvisor; }
+
     // We buffer most state changes and flush them implicitly with
     // Display::validate, Display::present, and Display::presentOrValidate.
     // This method provides an explicit way to flush state changes to HWC.
@@ -211,8 +215,17 @@ public:
     [[clang::warn_unused_result]] Error getActiveConfig(
             std::shared_ptr<const Config>* outConfig) const;
     [[clang::warn_unused_result]] Error getActiveConfigIndex(int* outIndex) const;
+    // Flat result containers meant to be owned and reused across frames by
+    // the caller: they are cleared and refilled in place so their capacity
+    // persists, and are sorted by layer pointer so consumers can look up
+    // entries with std::lower_bound instead of building a hash map per
+    // frame.
+    using ChangedTypes = std::vector<std::pair<Layer*, Composition>>;
+    using ReleaseFences =
+            std::vector<std::pair<Layer*, android::sp<android::Fence>>>;
+
     [[clang::warn_unused_result]] Error getChangedCompositionTypes(
-            std::unordered_map<Layer*, Composition>* outTypes);
+            ChangedTypes* outTypes);
     [[clang::warn_unused_result]] Error getColorModes(
             std::vector<android::ui::ColorMode>* outModes) const;
     // outSupportedPerFrameMetadata is an opaque bitmask to the callers
@@ -237,8 +250,7 @@ public:
     [[clang::warn_unused_result]] Error getHdrCapabilities(
             android::HdrCapabilities* outCapabilities) const;
     [[clang::warn_unused_result]] Error getReleaseFences(
-            std::unordered_map<Layer*,
-                    android::sp<android::Fence>>* outFences) const;
+            ReleaseFences* outFences) const;
     [[clang::warn_unused_result]] Error present(
             android::sp<android::Fence>* outPresentFence);
     [[clang::warn_unused_result]] Error setActiveConfig(
@@ -351,6 +363,25 @@ private:
     hwc2_layer_t mId;
     android::ui::Dataspace mDataSpace = android::ui::Dataspace::UNKNOWN;
     android::HdrMetadata mHdrMetadata;
+
+    // Shadow copies of the layer state most recently forwarded to the
+    // composer, serving the same purpose as mDataSpace above. Layer state
+    // is persistent in the HAL, so values that didn't change since the
+    // last frame don't have to be serialized into the command stream
+    // again; on mostly-static scenes these setters account for most of
+    // the per-frame composer traffic. Per-frame properties (buffer,
+    // acquire fence, surface damage) are deliberately not cached.
+    std::optional<BlendMode> mBlendMode;
+    std::optional<hwc_color_t> mColor;
+    std::optional<Composition> mCompositionType;
+    std::optional<android::Rect> mDisplayFrame;
+    std::optional<float> mPlaneAlpha;
+    std::optional<android::FloatRect> mSourceCrop;
+    std::optional<Transform> mTransform;
+    std::optional<android::Region> mVisibleRegion;
+    std::optional<uint32_t> mZOrder;
+    std::optional<std::pair<uint32_t, uint32_t>> mInfo;
+
     std::function<void(Layer*)> mLayerDestroyedListener;
 };
 
@@ -47,6 +47,8 @@
 #include <cutils/properties.h>
 #include <log/log.h>
 
+#include <algorithm>
+
 #include "HWComposer.h"
 #include "HWC2.h"
 #include "ComposerHal.h"
@@ -443,9 +445,7 @@ status_t HWComposer::prepare(DisplayDevice& displayDevice) {
             RETURN_IF_HWC_ERROR_FOR("presentOrValidate", error, displayId, UNKNOWN_ERROR);
         }
         if (state == 1) { //Present Succeeded.
-            std::unordered_map<HWC2::Layer*, sp<Fence>> releaseFences;
-            error = hwcDisplay->getReleaseFences(&releaseFences);
-            displayData.releaseFences = std::move(releaseFences);
+            error = hwcDisplay->getReleaseFences(&displayData.releaseFences);
             displayData.lastPresentFence = outPresentFence;
             displayData.validateWasSkipped = true;
             displayData.presentError = error;
@@ -460,8 +460,7 @@ status_t HWComposer::prepare(DisplayDevice& displayDevice) {
         RETURN_IF_HWC_ERROR_FOR("validate", error, displayId, BAD_INDEX);
     }
 
-    std::unordered_map<HWC2::Layer*, HWC2::Composition> changedTypes;
-    changedTypes.reserve(numTypes);
+    auto& changedTypes = displayData.changedTypes;
     error = hwcDisplay->getChangedCompositionTypes(&changedTypes);
     RETURN_IF_HWC_ERROR_FOR("getChangedCompositionTypes", error, displayId, BAD_INDEX);
 
@@ -477,12 +476,17 @@ status_t HWComposer::prepare(DisplayDevice& displayDevice) {
     for (auto& layer : displayDevice.getVisibleLayersSortedByZ()) {
         auto hwcLayer = layer->getHwcLayer(displayId);
 
-        if (changedTypes.count(hwcLayer) != 0) {
+        const auto changedIt = std::lower_bound(
+                changedTypes.begin(), changedTypes.end(), hwcLayer,
+                [](const auto& entry, HWC2::Layer* key) {
+                    return entry.first < key;
+                });
+        if (changedIt != changedTypes.end() && changedIt->first == hwcLayer) {
             // We pass false so we only update our state and don't call back
             // into the HWC device
             validateChange(layer->getCompositionType(displayId),
-                    changedTypes[hwcLayer]);
-            layer->setCompositionType(displayId, changedTypes[hwcLayer], false);
+                    changedIt->second);
+            layer->setCompositionType(displayId, changedIt->second, false);
         }
 
         switch (layer->getCompositionType(displayId)) {
@@ -561,12 +565,16 @@ sp<Fence> HWComposer::getPresentFence(int32_t displayId) const {
 sp<Fence> HWComposer::getLayerReleaseFence(int32_t displayId,
         HWC2::Layer* layer) const {
     RETURN_IF_INVALID_DISPLAY(displayId, Fence::NO_FENCE);
-    auto displayFences = mDisplayData[displayId].releaseFences;
-    if (displayFences.count(layer) == 0) {
+    const auto& displayFences = mDisplayData[displayId].releaseFences;
+    const auto it = std::lower_bound(displayFences.begin(), displayFences.end(),
+            layer, [](const auto& entry, HWC2::Layer* key) {
+                return entry.first < key;
+            });
+    if (it == displayFences.end() || it->first != layer) {
         ALOGV("getLayerReleaseFence: Release fence not found");
         return Fence::NO_FENCE;
     }
-    return displayFences[layer];
+    return it->second;
 }
 
 status_t HWComposer::presentAndGetReleaseFences(int32_t displayId) {
@@ -588,12 +596,9 @@ status_t HWComposer::presentAndGetReleaseFences(int32_t displayId) {
     auto error = hwcDisplay->present(&displayData.lastPresentFence);
     RETURN_IF_HWC_ERROR_FOR("present", error, displayId, UNKNOWN_ERROR);
 
-    std::unordered_map<HWC2::Layer*, sp<Fence>> releaseFences;
-    error = hwcDisplay->getReleaseFences(&releaseFences);
+    error = hwcDisplay->getReleaseFences(&displayData.releaseFences);
     RETURN_IF_HWC_ERROR_FOR("getReleaseFences", error, displayId, UNKNOWN_ERROR);
 
-    displayData.releaseFences = std::move(releaseFences);
-
     return NO_ERROR;
 }
 
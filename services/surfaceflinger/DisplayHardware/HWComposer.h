@@ -178,6 +178,8 @@ public:
 
     android::Hwc2::Composer* getComposer() const { return mHwcDevice->getComposer(); }
 
+    android::Hwc2::PowerAdvisor& getPowerAdvisor() const { return mHwcDevice->getPowerAdvisor(); }
+
     std::optional<hwc2_display_t> getHwcDisplayId(int32_t displayId) const;
 private:
     // For unit tests
@@ -200,7 +202,12 @@ private:
         HWC2::Display* hwcDisplay;
         HWC2::DisplayRequest displayRequests;
         sp<Fence> lastPresentFence;  // signals when the last set op retires
-        std::unordered_map<HWC2::Layer*, sp<Fence>> releaseFences;
+        // Sorted by layer pointer and refilled in place each frame, so the
+        // capacity persists across frames (see HWC2::Display::ReleaseFences).
+        HWC2::Display::ReleaseFences releaseFences;
+        // Frame-persistent scratch for prepare(); holds the composition type
+        // changes of the last validate.
+        HWC2::Display::ChangedTypes changedTypes;
         buffer_handle_t outbufHandle;
         sp<Fence> outbufAcquireFence;
         mutable std::unordered_map<int32_t,
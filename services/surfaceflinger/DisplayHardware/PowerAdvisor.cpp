@@ -21,6 +21,7 @@
 
 #include <utils/Log.h>
 #include <utils/Mutex.h>
+#include <utils/String8.h>
 
 #include "PowerAdvisor.h"
 
@@ -63,6 +64,69 @@ void PowerAdvisor::setExpensiveRenderingExpected(hwc2_display_t displayId, bool
     }
 }
 
+void PowerAdvisor::notifyFrameBegin(nsecs_t refreshPeriod) {
+    if (refreshPeriod <= 0 || mAvgFrameCpuTime <= 0 || mLastFrameEndTime <= 0) {
+        return;
+    }
+    const nsecs_t now = systemTime();
+    const bool afterIdleGap = now - mLastFrameEndTime >= kIdleGapFrames * refreshPeriod;
+    const bool heavyFramePredicted =
+            mAvgFrameCpuTime * 100 >= refreshPeriod * kHeavyFramePercent;
+    if (!afterIdleGap || !heavyFramePredicted || now - mLastBoostTime < kMinBoostIntervalNs) {
+        return;
+    }
+
+    const sp<V1_3::IPower> powerHal = getPowerHal();
+    if (powerHal == nullptr) {
+        return;
+    }
+    // There is no dedicated "upcoming expensive frame" hint in Power HAL
+    // 1.3; the interaction boost is the conventional way to ask the
+    // governor to ramp up ahead of time-critical work.
+    auto ret = powerHal->powerHintAsync_1_3(PowerHint::INTERACTION, kBoostDurationMs);
+    if (!ret.isOk()) {
+        mReconnectPowerHal = true;
+        return;
+    }
+    mLastBoostTime = now;
+    mBoostsFired++;
+    mBoostPendingEvaluation = true;
+}
+
+void PowerAdvisor::notifyFrameEnd(nsecs_t frameCpuTime, nsecs_t refreshPeriod) {
+    mLastFrameEndTime = systemTime();
+    if (frameCpuTime <= 0) {
+        return;
+    }
+    mAvgFrameCpuTime =
+            mAvgFrameCpuTime > 0 ? (3 * mAvgFrameCpuTime + frameCpuTime) / 4 : frameCpuTime;
+    if (refreshPeriod <= 0) {
+        return;
+    }
+
+    const bool heavyFrame = frameCpuTime * 100 >= refreshPeriod * kHeavyFramePercent;
+    if (mBoostPendingEvaluation) {
+        if (heavyFrame) {
+            mBoostsAccurate++;
+        } else {
+            mBoostsWasted++;
+        }
+        mBoostPendingEvaluation = false;
+    } else if (frameCpuTime > refreshPeriod) {
+        // The frame overran a full period and no boost had been fired for
+        // it: a missed prediction.
+        mUnboostedOverruns++;
+    }
+}
+
+void PowerAdvisor::dump(String8& result) const {
+    result.appendFormat("PowerAdvisor: predicted frame cpu time %.3f ms\n",
+                        mAvgFrameCpuTime / 1e6);
+    result.appendFormat("  ramp-up boosts fired: %u (accurate: %u, wasted: %u), "
+                        "overruns without boost: %u\n",
+                        mBoostsFired, mBoostsAccurate, mBoostsWasted, mUnboostedOverruns);
+}
+
 sp<V1_3::IPower> PowerAdvisor::getPowerHal() {
     static sp<V1_3::IPower> sPowerHal_1_3 = nullptr;
     static bool sHasPowerHal_1_3 = true;
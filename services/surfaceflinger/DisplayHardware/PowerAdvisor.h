@@ -24,10 +24,14 @@
 
 #include <android/hardware/power/1.3/IPower.h>
 #include <utils/StrongPointer.h>
+#include <utils/Timers.h>
 
 #include <unordered_set>
 
 namespace android {
+
+class String8;
+
 namespace Hwc2 {
 
 class PowerAdvisor {
@@ -35,6 +39,19 @@ public:
     virtual ~PowerAdvisor();
 
     virtual void setExpensiveRenderingExpected(hwc2_display_t displayId, bool expected) = 0;
+
+    // Called when the main thread starts working on a frame, before any
+    // heavy work has been done. Gives the advisor a chance to request a
+    // clock ramp-up when a frame predicted to be expensive follows an idle
+    // gap the governor has likely down-clocked through.
+    virtual void notifyFrameBegin(nsecs_t refreshPeriod) = 0;
+
+    // Called when the frame's main-thread work is done, with its measured
+    // CPU duration. Updates the work prediction and the hint accuracy
+    // accounting reported by dump().
+    virtual void notifyFrameEnd(nsecs_t frameCpuTime, nsecs_t refreshPeriod) = 0;
+
+    virtual void dump(String8& result) const = 0;
 };
 
 namespace impl {
@@ -49,13 +66,41 @@ public:
     ~PowerAdvisor() override;
 
     void setExpensiveRenderingExpected(hwc2_display_t displayId, bool expected) override;
+    void notifyFrameBegin(nsecs_t refreshPeriod) override;
+    void notifyFrameEnd(nsecs_t frameCpuTime, nsecs_t refreshPeriod) override;
+    void dump(String8& result) const override;
 
 private:
+    // A gap of at least this many refresh periods without frames counts as
+    // idle: long enough for the governor to have dropped the clocks.
+    static constexpr nsecs_t kIdleGapFrames = 4;
+    // Predicted frame CPU work above this percentage of the refresh period
+    // is considered heavy enough to warrant a ramp-up boost after idle.
+    static constexpr nsecs_t kHeavyFramePercent = 50;
+    // Hysteresis: minimum spacing between ramp-up boosts.
+    static constexpr nsecs_t kMinBoostIntervalNs = 500000000; // 500ms
+    // Expected interaction duration passed along with the boost hint.
+    static constexpr int32_t kBoostDurationMs = 100;
+
     sp<V1_3::IPower> getPowerHal();
 
     std::unordered_set<hwc2_display_t> mExpensiveDisplays;
     bool mNotifiedExpensiveRendering = false;
     bool mReconnectPowerHal = false;
+
+    // Exponential moving average of the measured frame CPU cost; the
+    // prediction for the next frame.
+    nsecs_t mAvgFrameCpuTime = 0;
+    nsecs_t mLastFrameEndTime = 0;
+    nsecs_t mLastBoostTime = 0;
+    // Whether the current frame was boosted and its outcome is still to be
+    // classified in notifyFrameEnd().
+    bool mBoostPendingEvaluation = false;
+    // Accuracy accounting for dump().
+    uint32_t mBoostsFired = 0;
+    uint32_t mBoostsAccurate = 0;
+    uint32_t mBoostsWasted = 0;
+    uint32_t mUnboostedOverruns = 0;
 };
 
 } // namespace impl
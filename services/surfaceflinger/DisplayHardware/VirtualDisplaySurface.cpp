@@ -66,6 +66,8 @@ VirtualDisplaySurface::VirtualDisplaySurface(HWComposer& hwc, int32_t dispId,
     mQueueBufferOutput(),
     mSinkBufferWidth(0),
     mSinkBufferHeight(0),
+    mHeldOutputProducerSlot(BufferQueue::INVALID_BUFFER_SLOT),
+    mHeldOutputFence(Fence::NO_FENCE),
     mCompositionType(COMPOSITION_UNKNOWN),
     mFbFence(Fence::NO_FENCE),
     mOutputFence(Fence::NO_FENCE),
@@ -112,6 +114,7 @@ VirtualDisplaySurface::VirtualDisplaySurface(HWComposer& hwc, int32_t dispId,
 }
 
 VirtualDisplaySurface::~VirtualDisplaySurface() {
+    cancelHeldOutputBuffer();
     mSource[SOURCE_SCRATCH]->disconnect(NATIVE_WINDOW_API_EGL);
 }
 
@@ -266,9 +269,16 @@ void VirtualDisplaySurface::onFrameCommitted() {
         } else {
             // If the surface hadn't actually been updated, then we only went
             // through the motions of updating the display to keep our state
-            // machine happy. We cancel the buffer to avoid triggering another
-            // re-composition and causing an infinite loop.
-            mSource[SOURCE_SINK]->cancelBuffer(sslot, retireFence);
+            // machine happy. Hold on to the buffer for the next frame rather
+            // than cancelling it; returning it would both risk triggering
+            // another re-composition (and an infinite loop) and cost an idle
+            // mirroring sink a dequeue/cancel round trip every frame. The
+            // retire fence guards HWC's read of the buffer from the present
+            // we just went through.
+            VDS_LOGV("onFrameCommitted: hold sink sslot=%d", sslot);
+            mHeldOutputProducerSlot = mOutputProducerSlot;
+            mHeldOutputFence = Fence::merge("VDS:held", mOutputFence,
+                    retireFence);
         }
     }
 
@@ -283,6 +293,8 @@ void VirtualDisplaySurface::resizeBuffers(const uint32_t w, const uint32_t h) {
     mQueueBufferOutput.height = h;
     mSinkBufferWidth = w;
     mSinkBufferHeight = h;
+    // A held output buffer has the old dimensions; give it back.
+    cancelHeldOutputBuffer();
 }
 
 const sp<Fence>& VirtualDisplaySurface::getClientTargetAcquireFence() const {
@@ -615,11 +627,34 @@ void VirtualDisplaySurface::resetPerFrameState() {
     mFbProducerSlot = -1;
 }
 
+void VirtualDisplaySurface::cancelHeldOutputBuffer() {
+    if (mHeldOutputProducerSlot >= 0) {
+        mSource[SOURCE_SINK]->cancelBuffer(
+                mapProducer2SourceSlot(SOURCE_SINK, mHeldOutputProducerSlot),
+                mHeldOutputFence);
+        mHeldOutputProducerSlot = BufferQueue::INVALID_BUFFER_SLOT;
+        mHeldOutputFence = Fence::NO_FENCE;
+    }
+}
+
 status_t VirtualDisplaySurface::refreshOutputBuffer() {
     if (mOutputProducerSlot >= 0) {
         mSource[SOURCE_SINK]->cancelBuffer(
                 mapProducer2SourceSlot(SOURCE_SINK, mOutputProducerSlot),
                 mOutputFence);
+    } else if (mHeldOutputProducerSlot >= 0) {
+        // Reuse the buffer held from a frame that wasn't recomposed instead
+        // of going back to the sink. If the format or usage turns out to be
+        // wrong for this frame, the checks in prepareFrame()/dequeueBuffer()
+        // will land back here with mOutputProducerSlot set and replace it.
+        VDS_LOGV("refreshOutputBuffer: reuse held pslot=%d",
+                mHeldOutputProducerSlot);
+        mOutputProducerSlot = mHeldOutputProducerSlot;
+        mOutputFence = mHeldOutputFence;
+        mHeldOutputProducerSlot = BufferQueue::INVALID_BUFFER_SLOT;
+        mHeldOutputFence = Fence::NO_FENCE;
+        return mHwc.setOutputBuffer(mDisplayId, Fence::NO_FENCE,
+                mProducerBuffers[mOutputProducerSlot]);
     }
 
     int sslot;
@@ -138,6 +138,7 @@ private:
     void updateQueueBufferOutput(QueueBufferOutput&& qbo);
     void resetPerFrameState();
     status_t refreshOutputBuffer();
+    void cancelHeldOutputBuffer();
 
     // Both the sink and scratch buffer pools have their own set of slots
     // ("source slots", or "sslot"). We have to merge these into the single
@@ -188,6 +189,15 @@ private:
     // dequeued from the sink, and are used when queueing the buffer.
     uint32_t mSinkBufferWidth, mSinkBufferHeight;
 
+    // When a frame is committed without the surface having been updated
+    // (mMustRecompose false), the output buffer is held here rather than
+    // cancelled back to the sink, and the next beginFrame() reuses it. An
+    // always-on mirroring sink otherwise pays a dequeue/cancel round trip
+    // to the sink process for every idle frame. The held buffer is returned
+    // to the sink if the output is resized or the display goes away.
+    int mHeldOutputProducerSlot;
+    sp<Fence> mHeldOutputFence;
+
     //
     // Intra-frame state
     //
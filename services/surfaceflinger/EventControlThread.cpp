@@ -40,34 +40,46 @@ EventControlThread::EventControlThread(EventControlThread::SetVSyncEnabledFuncti
 }
 
 EventControlThread::~EventControlThread() {
+    mKeepRunning = false;
     {
         std::lock_guard<std::mutex> lock(mMutex);
-        mKeepRunning = false;
         mCondition.notify_all();
     }
     mThread.join();
 }
 
 void EventControlThread::setVsyncEnabled(bool enabled) {
+    // The latest request wins. If this call doesn't change the requested
+    // state it returns without taking the lock or waking the thread, and a
+    // rapid enable/disable pair the thread hasn't seen yet coalesces to no
+    // HWC call at all: the thread only calls into HWC when the latest
+    // request differs from the state it last applied.
+    if (mVsyncEnabled.exchange(enabled) == enabled) {
+        return;
+    }
     std::lock_guard<std::mutex> lock(mMutex);
-    mVsyncEnabled = enabled;
     mCondition.notify_all();
 }
 
-// Unfortunately std::unique_lock gives warnings with -Wthread-safety
-void EventControlThread::threadMain() NO_THREAD_SAFETY_ANALYSIS {
-    auto keepRunning = true;
-    auto currentVsyncEnabled = false;
+void EventControlThread::threadMain() {
+    bool currentVsyncEnabled = false;
+    // Make the initial hardware state explicit.
+    mSetVSyncEnabled(currentVsyncEnabled);
 
-    while (keepRunning) {
-        mSetVSyncEnabled(currentVsyncEnabled);
+    while (mKeepRunning) {
+        const bool requestedVsyncEnabled = mVsyncEnabled;
+        if (requestedVsyncEnabled != currentVsyncEnabled) {
+            currentVsyncEnabled = requestedVsyncEnabled;
+            mSetVSyncEnabled(currentVsyncEnabled);
+            // A newer request may have arrived during the HWC call;
+            // re-check before going back to sleep.
+            continue;
+        }
 
         std::unique_lock<std::mutex> lock(mMutex);
-        mCondition.wait(lock, [this, currentVsyncEnabled, keepRunning]() NO_THREAD_SAFETY_ANALYSIS {
-            return currentVsyncEnabled != mVsyncEnabled || keepRunning != mKeepRunning;
+        mCondition.wait(lock, [this, currentVsyncEnabled] {
+            return mVsyncEnabled != currentVsyncEnabled || !mKeepRunning;
         });
-        currentVsyncEnabled = mVsyncEnabled;
-        keepRunning = mKeepRunning;
     }
 }
 
@@ -16,14 +16,13 @@
 
 #pragma once
 
+#include <atomic>
 #include <condition_variable>
 #include <cstddef>
 #include <functional>
 #include <mutex>
 #include <thread>
 
-#include <android-base/thread_annotations.h>
-
 namespace android {
 
 class EventControlThread {
@@ -48,12 +47,15 @@ public:
 private:
     void threadMain();
 
+    // The mutex only serializes sleeping and waking the thread; the
+    // requested state itself is atomic, so callers that don't change it
+    // never block or wake anything.
     std::mutex mMutex;
     std::condition_variable mCondition;
 
     const SetVSyncEnabledFunction mSetVSyncEnabled;
-    bool mVsyncEnabled GUARDED_BY(mMutex) = false;
-    bool mKeepRunning GUARDED_BY(mMutex) = true;
+    std::atomic<bool> mVsyncEnabled = false;
+    std::atomic<bool> mKeepRunning = true;
 
     // Must be last so that everything is initialized before the thread starts.
     std::thread mThread{&EventControlThread::threadMain, this};
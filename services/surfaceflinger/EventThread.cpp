@@ -88,8 +88,12 @@ void EventThread::setPhaseOffset(nsecs_t phaseOffset) {
     mVSyncSource->setPhaseOffset(phaseOffset);
 }
 
-sp<BnDisplayEventConnection> EventThread::createEventConnection() const {
-    return new Connection(const_cast<EventThread*>(this));
+sp<BnDisplayEventConnection> EventThread::createEventConnection(uint32_t vsyncRate,
+                                                                uint32_t vsyncPhase) const {
+    // Reject out-of-range rates the same way setVsyncRate() does.
+    const int32_t count = (int32_t(vsyncRate) <= 0) ? -1 : int32_t(vsyncRate);
+    const uint32_t phase = (vsyncRate > 1) ? (vsyncPhase % vsyncRate) : 0;
+    return new Connection(const_cast<EventThread*>(this), count, phase);
 }
 
 status_t EventThread::registerDisplayEventConnection(
@@ -110,6 +114,9 @@ void EventThread::setVsyncRate(uint32_t count, const sp<EventThread::Connection>
         const int32_t new_count = (count == 0) ? -1 : count;
         if (connection->count != new_count) {
             connection->count = new_count;
+            // Keep the phase invariant: always in [0, count) for
+            // continuous connections.
+            connection->phase = (new_count > 1) ? (connection->phase % new_count) : 0;
             mCondition.notify_all();
         }
     }
@@ -178,7 +185,14 @@ void EventThread::threadMain() NO_THREAD_SAFETY_ANALYSIS {
         Vector<sp<EventThread::Connection> > signalConnections;
         signalConnections = waitForEventLocked(&lock, &event);
 
-        // dispatch events to listeners...
+        // Dispatch events to listeners without holding the lock. The sends
+        // only touch each connection's own BitTube and are non-blocking, so
+        // nothing here needs mMutex; dropping it keeps a slow client's
+        // socket from serializing requestNextVsync and setVsyncRate calls
+        // for every other client.
+        lock.unlock();
+
+        Vector<sp<EventThread::Connection> > deadConnections;
         const size_t count = signalConnections.size();
         for (size_t i = 0; i < count; i++) {
             const sp<Connection>& conn(signalConnections[i]);
@@ -196,9 +210,14 @@ void EventThread::threadMain() NO_THREAD_SAFETY_ANALYSIS {
                 // handle any other error on the pipe as fatal. the only
                 // reasonable thing to do is to clean-up this connection.
                 // The most common error we'll get here is -EPIPE.
-                removeDisplayEventConnectionLocked(signalConnections[i]);
+                deadConnections.add(conn);
             }
         }
+
+        lock.lock();
+        for (size_t i = 0; i < deadConnections.size(); i++) {
+            removeDisplayEventConnectionLocked(deadConnections[i]);
+        }
     }
 }
 
@@ -257,7 +276,7 @@ Vector<sp<EventThread::Connection> > EventThread::waitForEventLocked(
                             signalConnections.add(connection);
                             added = true;
                         } else if (connection->count == 1 ||
-                                   (vsyncCount % connection->count) == 0) {
+                                   (vsyncCount % connection->count) == connection->phase) {
                             // continuous event, and time to report it
                             signalConnections.add(connection);
                             added = true;
@@ -368,15 +387,16 @@ void EventThread::dump(String8& result) const {
                         mVSyncEvent[DisplayDevice::DISPLAY_PRIMARY].vsync.count);
     for (size_t i = 0; i < mDisplayEventConnections.size(); i++) {
         sp<Connection> connection = mDisplayEventConnections.itemAt(i).promote();
-        result.appendFormat("    %p: count=%d\n", connection.get(),
-                            connection != nullptr ? connection->count : 0);
+        result.appendFormat("    %p: count=%d, phase=%u\n", connection.get(),
+                            connection != nullptr ? connection->count : 0,
+                            connection != nullptr ? connection->phase : 0);
     }
 }
 
 // ---------------------------------------------------------------------------
 
-EventThread::Connection::Connection(EventThread* eventThread)
-      : count(-1), mEventThread(eventThread), mChannel(gui::BitTube::DefaultSize) {}
+EventThread::Connection::Connection(EventThread* eventThread, int32_t count, uint32_t phase)
+      : count(count), phase(phase), mEventThread(eventThread), mChannel(gui::BitTube::DefaultSize) {}
 
 EventThread::Connection::~Connection() {
     // do nothing here -- clean-up will happen automatically
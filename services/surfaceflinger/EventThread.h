@@ -61,7 +61,11 @@ class EventThread {
 public:
     virtual ~EventThread();
 
-    virtual sp<BnDisplayEventConnection> createEventConnection() const = 0;
+    // vsyncRate 0 creates the connection with vsync delivery disabled (the
+    // historical default); a rate of N delivers every Nth vsync, firing on
+    // the beat selected by vsyncPhase (taken modulo the rate).
+    virtual sp<BnDisplayEventConnection> createEventConnection(uint32_t vsyncRate = 0,
+                                                               uint32_t vsyncPhase = 0) const = 0;
 
     // called before the screen is turned off from main thread
     virtual void onScreenReleased() = 0;
@@ -82,7 +86,7 @@ namespace impl {
 class EventThread : public android::EventThread, private VSyncSource::Callback {
     class Connection : public BnDisplayEventConnection {
     public:
-        explicit Connection(EventThread* eventThread);
+        explicit Connection(EventThread* eventThread, int32_t count = -1, uint32_t phase = 0);
         virtual ~Connection();
 
         virtual status_t postEvent(const DisplayEventReceiver::Event& event);
@@ -92,6 +96,10 @@ class EventThread : public android::EventThread, private VSyncSource::Callback {
         // count ==-1 : one-shot event that fired this round / disabled
         int32_t count;
 
+        // For continuous events, the beat within the divisor this connection
+        // fires on; always in [0, count). Zero for one-shot connections.
+        uint32_t phase;
+
     private:
         virtual void onFirstRef();
         status_t stealReceiveChannel(gui::BitTube* outChannel) override;
@@ -109,7 +117,8 @@ public:
                 InterceptVSyncsCallback interceptVSyncsCallback, const char* threadName);
     ~EventThread();
 
-    sp<BnDisplayEventConnection> createEventConnection() const override;
+    sp<BnDisplayEventConnection> createEventConnection(uint32_t vsyncRate = 0,
+                                                       uint32_t vsyncPhase = 0) const override;
     status_t registerDisplayEventConnection(const sp<Connection>& connection);
 
     void setVsyncRate(uint32_t count, const sp<Connection>& connection);
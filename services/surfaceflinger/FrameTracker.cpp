@@ -19,6 +19,8 @@
 
 #include <inttypes.h>
 
+#include <algorithm>
+
 #include <android/log.h>
 #include <utils/String8.h>
 
@@ -29,6 +31,108 @@
 
 namespace android {
 
+FrameTracker::P2QuantileEstimator::P2QuantileEstimator(double quantile) :
+        mQuantile(quantile) {
+    reset();
+}
+
+void FrameTracker::P2QuantileEstimator::reset() {
+    for (int i = 0; i < 5; i++) {
+        mHeights[i] = 0;
+        mDesiredPositions[i] = 0;
+        mPositionIncrements[i] = 0;
+        mPositions[i] = 0;
+    }
+    mCount = 0;
+}
+
+void FrameTracker::P2QuantileEstimator::addSample(double value) {
+    if (mCount < 5) {
+        // The first five samples seed the markers directly.
+        mHeights[mCount++] = value;
+        std::sort(mHeights, mHeights + mCount);
+        if (mCount == 5) {
+            for (int i = 0; i < 5; i++) {
+                mPositions[i] = i + 1;
+            }
+            mDesiredPositions[0] = 1;
+            mDesiredPositions[1] = 1 + 2 * mQuantile;
+            mDesiredPositions[2] = 1 + 4 * mQuantile;
+            mDesiredPositions[3] = 3 + 2 * mQuantile;
+            mDesiredPositions[4] = 5;
+            mPositionIncrements[0] = 0;
+            mPositionIncrements[1] = mQuantile / 2;
+            mPositionIncrements[2] = mQuantile;
+            mPositionIncrements[3] = (1 + mQuantile) / 2;
+            mPositionIncrements[4] = 1;
+        }
+        return;
+    }
+
+    // Find the marker cell the sample falls into, widening the extreme
+    // markers when it falls outside of them.
+    int cell;
+    if (value < mHeights[0]) {
+        mHeights[0] = value;
+        cell = 0;
+    } else if (value >= mHeights[4]) {
+        mHeights[4] = value;
+        cell = 3;
+    } else {
+        cell = 0;
+        while (value >= mHeights[cell+1]) {
+            cell++;
+        }
+    }
+
+    for (int i = cell+1; i < 5; i++) {
+        mPositions[i]++;
+    }
+    for (int i = 0; i < 5; i++) {
+        mDesiredPositions[i] += mPositionIncrements[i];
+    }
+
+    // Nudge the three middle markers towards their desired positions, using
+    // the piecewise-parabolic prediction and falling back to linear
+    // interpolation when it would leave the marker heights unordered.
+    for (int i = 1; i <= 3; i++) {
+        const double delta = mDesiredPositions[i] - mPositions[i];
+        if ((delta >= 1 && mPositions[i+1] - mPositions[i] > 1) ||
+                (delta <= -1 && mPositions[i-1] - mPositions[i] < -1)) {
+            const int direction = delta > 0 ? 1 : -1;
+            const double parabolic = mHeights[i] +
+                    direction / double(mPositions[i+1] - mPositions[i-1]) *
+                    ((mPositions[i] - mPositions[i-1] + direction) *
+                            (mHeights[i+1] - mHeights[i]) /
+                            (mPositions[i+1] - mPositions[i]) +
+                     (mPositions[i+1] - mPositions[i] - direction) *
+                            (mHeights[i] - mHeights[i-1]) /
+                            (mPositions[i] - mPositions[i-1]));
+            if (mHeights[i-1] < parabolic && parabolic < mHeights[i+1]) {
+                mHeights[i] = parabolic;
+            } else {
+                mHeights[i] += direction *
+                        (mHeights[i+direction] - mHeights[i]) /
+                        (mPositions[i+direction] - mPositions[i]);
+            }
+            mPositions[i] += direction;
+        }
+    }
+    mCount++;
+}
+
+double FrameTracker::P2QuantileEstimator::estimate() const {
+    if (mCount == 0) {
+        return 0;
+    }
+    if (mCount < 5) {
+        // Not enough samples for the marker invariants yet; the samples are
+        // still kept sorted, so index directly.
+        return mHeights[int(mQuantile * (mCount - 1) + 0.5)];
+    }
+    return mHeights[2];
+}
+
 FrameTracker::FrameTracker() :
         mOffset(0),
         mNumFences(0),
@@ -196,6 +300,10 @@ void FrameTracker::updateStatsLocked(size_t newFrameIdx) const {
             int numPeriods = int((duration + mDisplayPeriod/2) /
                     mDisplayPeriod);
 
+            mDurationP50.addSample(duration);
+            mDurationP90.addSample(duration);
+            mDurationP99.addSample(duration);
+
             for (int i = 0; i < NUM_FRAME_BUCKETS-1; i++) {
                 int nextBucket = 1 << (i+1);
                 if (numPeriods < nextBucket) {
@@ -214,6 +322,9 @@ void FrameTracker::resetFrameCountersLocked() {
     for (int i = 0; i < NUM_FRAME_BUCKETS; i++) {
         mNumFrames[i] = 0;
     }
+    mDurationP50.reset();
+    mDurationP90.reset();
+    mDurationP99.reset();
 }
 
 void FrameTracker::logStatsLocked(const String8& name) const {
@@ -242,6 +353,10 @@ void FrameTracker::dumpStats(String8& result) const {
             mFrameRecords[index].actualPresentTime,
             mFrameRecords[index].frameReadyTime);
     }
+    result.appendFormat("present duration percentiles (ns): "
+            "p50=%.0f p90=%.0f p99=%.0f over %" PRId64 " frames\n",
+            mDurationP50.estimate(), mDurationP90.estimate(),
+            mDurationP99.estimate(), mDurationP50.count());
     result.append("\n");
 }
 
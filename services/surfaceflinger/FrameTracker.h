@@ -93,6 +93,28 @@ public:
     void dumpStats(String8& result) const;
 
 private:
+    // Streaming estimate of a single quantile using the P^2 algorithm
+    // (Jain & Chlamtac, 1985). Updates and queries are O(1) and only five
+    // markers of state are kept, so percentiles over the whole run are
+    // available without walking the frame records.
+    class P2QuantileEstimator {
+    public:
+        explicit P2QuantileEstimator(double quantile);
+
+        void addSample(double value);
+        double estimate() const;
+        int64_t count() const { return mCount; }
+        void reset();
+
+    private:
+        const double mQuantile;
+        double mHeights[5];
+        double mDesiredPositions[5];
+        double mPositionIncrements[5];
+        int mPositions[5];
+        int64_t mCount;
+    };
+
     struct FrameRecord {
         FrameRecord() :
             desiredPresentTime(0),
@@ -152,6 +174,14 @@ private:
     // all frames with duration greater than 2^(NUM_FRAME_BUCKETS-1).
     int32_t mNumFrames[NUM_FRAME_BUCKETS];
 
+    // Streaming percentile estimates of the frame-to-frame present duration,
+    // in nanoseconds. Maintained incrementally by updateStatsLocked so that
+    // dump-time queries don't have to walk the frame records. Mutable for
+    // the same reason updateStatsLocked is const.
+    mutable P2QuantileEstimator mDurationP50{0.50};
+    mutable P2QuantileEstimator mDurationP90{0.90};
+    mutable P2QuantileEstimator mDurationP99{0.99};
+
     // mDisplayPeriod is the display refresh period of the display for which
     // this FrameTracker is gathering information.
     nsecs_t mDisplayPeriod;
@@ -70,6 +70,21 @@ LayerBE::LayerBE()
 
 int32_t Layer::sSequence = 1;
 
+// Starts at 1 so that the zero-initialized per-layer cache tags are never
+// considered valid before the first traversal builds them.
+std::atomic<uint64_t> Layer::sTraversalCacheGeneration{1};
+
+void Layer::invalidateTraversalCaches() {
+    sTraversalCacheGeneration.fetch_add(1, std::memory_order_release);
+}
+
+// Also starts at 1; see sTraversalCacheGeneration above.
+std::atomic<uint64_t> Layer::sGeometryCacheGeneration{1};
+
+void Layer::invalidateGeometryCaches() {
+    sGeometryCacheGeneration.fetch_add(1, std::memory_order_release);
+}
+
 Layer::Layer(SurfaceFlinger* flinger, const sp<Client>& client, const String8& name, uint32_t w,
              uint32_t h, uint32_t flags)
       : contentDirty(false),
@@ -133,6 +148,18 @@ Layer::Layer(SurfaceFlinger* flinger, const sp<Client>& client, const String8& n
     CompositorTiming compositorTiming;
     flinger->getCompositorTiming(&compositorTiming);
     mFrameEventHistory.initializeCompositorTiming(compositorTiming);
+
+    // Latency tools can ask for a deeper frame event history so they can
+    // poll getFrameTimestamps at a low rate without missing frames.
+    char value[PROPERTY_VALUE_MAX];
+    property_get("debug.sf.frame_event_history_size", value, "0");
+    int frameEventHistorySize = atoi(value);
+    if (frameEventHistorySize > 0) {
+        mFrameEventHistory.resizeFrameHistory(
+                static_cast<size_t>(frameEventHistorySize));
+    }
+
+    mTimeStatsRecord = mTimeStats.getLayerRecord(mName.c_str());
 }
 
 void Layer::onFirstRef() NO_THREAD_SAFETY_ANALYSIS {
@@ -164,6 +191,7 @@ Layer::~Layer() {
         point->setFrameAvailable();
     }
     mFrameTracker.logAndResetStats(mName);
+    mTimeStats.onDestroy(mTimeStatsRecord);
 }
 
 // ---------------------------------------------------------------------------
@@ -304,6 +332,18 @@ static FloatRect reduce(const FloatRect& win, const Region& exclude) {
 }
 
 Rect Layer::computeScreenBounds(bool reduceTransparentRegion) const {
+    const uint64_t tag = sGeometryCacheGeneration.load(std::memory_order_acquire);
+    {
+        Mutex::Autolock lock(mGeometryCacheLock);
+        if (reduceTransparentRegion) {
+            if (mGeometryCache.screenBoundsTag == tag) {
+                return mGeometryCache.screenBounds;
+            }
+        } else if (mGeometryCache.screenBoundsUnreducedTag == tag) {
+            return mGeometryCache.screenBoundsUnreduced;
+        }
+    }
+
     const Layer::State& s(getDrawingState());
     Rect win(s.active.w, s.active.h);
 
@@ -338,12 +378,53 @@ Rect Layer::computeScreenBounds(bool reduceTransparentRegion) const {
         win = reduce(win, screenTransparentRegion);
     }
 
+    {
+        Mutex::Autolock lock(mGeometryCacheLock);
+        if (reduceTransparentRegion) {
+            mGeometryCache.screenBounds = win;
+            mGeometryCache.screenBoundsTag = tag;
+        } else {
+            mGeometryCache.screenBoundsUnreduced = win;
+            mGeometryCache.screenBoundsUnreducedTag = tag;
+        }
+    }
+
     return win;
 }
 
 FloatRect Layer::computeBounds() const {
+    const uint64_t tag = sGeometryCacheGeneration.load(std::memory_order_acquire);
+    {
+        Mutex::Autolock lock(mGeometryCacheLock);
+        if (mGeometryCache.boundsTag == tag) {
+            return mGeometryCache.bounds;
+        }
+    }
+
     const Layer::State& s(getDrawingState());
-    return computeBounds(s.activeTransparentRegion);
+    const FloatRect bounds = computeBounds(s.activeTransparentRegion);
+
+    Mutex::Autolock lock(mGeometryCacheLock);
+    mGeometryCache.bounds = bounds;
+    mGeometryCache.boundsTag = tag;
+    return bounds;
+}
+
+FloatRect Layer::computeBoundsSansTransparentRegion() const {
+    const uint64_t tag = sGeometryCacheGeneration.load(std::memory_order_acquire);
+    {
+        Mutex::Autolock lock(mGeometryCacheLock);
+        if (mGeometryCache.boundsSansTransparentTag == tag) {
+            return mGeometryCache.boundsSansTransparent;
+        }
+    }
+
+    const FloatRect bounds = computeBounds(Region());
+
+    Mutex::Autolock lock(mGeometryCacheLock);
+    mGeometryCache.boundsSansTransparent = bounds;
+    mGeometryCache.boundsSansTransparentTag = tag;
+    return bounds;
 }
 
 FloatRect Layer::computeBounds(const Region& activeTransparentRegion) const {
@@ -358,9 +439,11 @@ FloatRect Layer::computeBounds(const Region& activeTransparentRegion) const {
     FloatRect floatWin = win.toFloatRect();
     FloatRect parentBounds = floatWin;
     if (p != nullptr) {
-        // We pass an empty Region here for reasons mirroring that of the case described in
-        // the computeScreenBounds reduceTransparentRegion=false case.
-        parentBounds = p->computeBounds(Region());
+        // The parent term ignores the transparent region for reasons
+        // mirroring those of the computeScreenBounds
+        // reduceTransparentRegion=false case; the memoized helper is
+        // equivalent to computeBounds(Region()).
+        parentBounds = p->computeBoundsSansTransparentRegion();
     }
 
     Transform t = s.active.transform;
@@ -427,9 +510,8 @@ FloatRect Layer::computeCrop(const sp<const DisplayDevice>& hw) const {
 
     // Screen space to make reduction to parent crop clearer.
     Rect activeCrop = computeInitialCrop(hw);
-    Transform t = getTransform();
     // Back to layer space to work with the content crop.
-    activeCrop = t.inverse().transform(activeCrop);
+    activeCrop = getInverseTransform().transform(activeCrop);
 
     // This needs to be here as transform.transform(Rect) computes the
     // transformed rect and then takes the bounding box of the result before
@@ -535,7 +617,7 @@ void Layer::setGeometry(const sp<const DisplayDevice>& displayDevice, uint32_t z
         if (!activeCrop.intersect(displayDevice->getViewport(), &activeCrop)) {
             activeCrop.clear();
         }
-        activeCrop = t.inverse().transform(activeCrop, true);
+        activeCrop = getInverseTransform().transform(activeCrop, true);
         // This needs to be here as transform.transform(Rect) computes the
         // transformed rect and then takes the bounding box of the result before
         // returning. This means
@@ -1109,6 +1191,7 @@ uint32_t Layer::doTransaction(uint32_t flags) {
 
 void Layer::commitTransaction(const State& stateToCommit) {
     mDrawingState = stateToCommit;
+    invalidateGeometryCaches();
 }
 
 uint32_t Layer::getTransactionFlags(uint32_t flags) {
@@ -1174,6 +1257,7 @@ bool Layer::setLayer(int32_t z) {
     mCurrentState.sequence++;
     mCurrentState.z = z;
     mCurrentState.modified = true;
+    invalidateTraversalCaches();
 
     // Discard all relative layering.
     if (mCurrentState.zOrderRelativeOf != nullptr) {
@@ -1191,6 +1275,7 @@ void Layer::removeZOrderRelative(const wp<Layer>& relative) {
     mCurrentState.zOrderRelatives.remove(relative);
     mCurrentState.sequence++;
     mCurrentState.modified = true;
+    invalidateTraversalCaches();
     setTransactionFlags(eTransactionNeeded);
 }
 
@@ -1198,6 +1283,7 @@ void Layer::addZOrderRelative(const wp<Layer>& relative) {
     mCurrentState.zOrderRelatives.add(relative);
     mCurrentState.modified = true;
     mCurrentState.sequence++;
+    invalidateTraversalCaches();
     setTransactionFlags(eTransactionNeeded);
 }
 
@@ -1219,6 +1305,7 @@ bool Layer::setRelativeLayer(const sp<IBinder>& relativeToHandle, int32_t relati
     mCurrentState.sequence++;
     mCurrentState.modified = true;
     mCurrentState.z = relativeZ;
+    invalidateTraversalCaches();
 
     auto oldZOrderRelativeOf = mCurrentState.zOrderRelativeOf.promote();
     if (oldZOrderRelativeOf != nullptr) {
@@ -1341,6 +1428,7 @@ bool Layer::setLayerStack(uint32_t layerStack) {
     mCurrentState.sequence++;
     mCurrentState.layerStack = layerStack;
     mCurrentState.modified = true;
+    invalidateTraversalCaches();
     setTransactionFlags(eTransactionNeeded);
     return true;
 }
@@ -1536,13 +1624,13 @@ void Layer::dumpFrameEvents(String8& result) {
 void Layer::onDisconnect() {
     Mutex::Autolock lock(mFrameEventHistoryMutex);
     mFrameEventHistory.onDisconnect();
-    mTimeStats.onDisconnect(getName().c_str());
+    mTimeStats.onDisconnect(mTimeStatsRecord);
 }
 
 void Layer::addAndGetFrameTimestamps(const NewFrameEventsEntry* newTimestamps,
                                      FrameEventHistoryDelta* outDelta) {
     if (newTimestamps) {
-        mTimeStats.setPostTime(getName().c_str(), newTimestamps->frameNumber,
+        mTimeStats.setPostTime(mTimeStatsRecord, newTimestamps->frameNumber,
                                newTimestamps->postedTime);
     }
 
@@ -1572,11 +1660,13 @@ size_t Layer::getChildrenCount() const {
 }
 
 void Layer::addChild(const sp<Layer>& layer) {
+    invalidateTraversalCaches();
     mCurrentChildren.add(layer);
     layer->setParent(this);
 }
 
 ssize_t Layer::removeChild(const sp<Layer>& layer) {
+    invalidateTraversalCaches();
     layer->setParent(nullptr);
     return mCurrentChildren.remove(layer);
 }
@@ -1611,6 +1701,7 @@ void Layer::setChildrenDrawingParent(const sp<Layer>& newParent) {
     for (const sp<Layer>& child : mDrawingChildren) {
         child->mDrawingParent = newParent;
     }
+    invalidateGeometryCaches();
 }
 
 bool Layer::reparent(const sp<IBinder>& newParentHandle) {
@@ -1699,6 +1790,16 @@ __attribute__((no_sanitize("unsigned-integer-overflow"))) LayerVector Layer::mak
         return children;
     }
 
+    // The merged list only changes when a z-order mutation bumps the global
+    // generation, so between mutations the list cached by the previous
+    // traversal can be returned directly.
+    LayerVector& cachedList = useDrawing ? mDrawingTraversalCache : mCurrentTraversalCache;
+    uint64_t& cachedTag = useDrawing ? mDrawingTraversalCacheTag : mCurrentTraversalCacheTag;
+    const uint64_t generation = sTraversalCacheGeneration.load(std::memory_order_acquire);
+    if (cachedTag == generation) {
+        return cachedList;
+    }
+
     LayerVector traverse(stateSet);
     for (const wp<Layer>& weakRelative : state.zOrderRelatives) {
         sp<Layer> strongRelative = weakRelative.promote();
@@ -1715,6 +1816,8 @@ __attribute__((no_sanitize("unsigned-integer-overflow"))) LayerVector Layer::mak
         traverse.add(child);
     }
 
+    cachedList = traverse;
+    cachedTag = generation;
     return traverse;
 }
 
@@ -1865,6 +1968,14 @@ void Layer::traverseChildrenInZOrder(LayerVector::StateSet stateSet,
 }
 
 Transform Layer::getTransform() const {
+    const uint64_t tag = sGeometryCacheGeneration.load(std::memory_order_acquire);
+    {
+        Mutex::Autolock lock(mGeometryCacheLock);
+        if (mGeometryCache.transformTag == tag) {
+            return mGeometryCache.transform;
+        }
+    }
+
     Transform t;
     const auto& p = mDrawingParent.promote();
     if (p != nullptr) {
@@ -1892,14 +2003,48 @@ Transform Layer::getTransform() const {
             t = t * extraParentScaling;
         }
     }
-    return t * getDrawingState().active.transform;
+    t = t * getDrawingState().active.transform;
+
+    Mutex::Autolock lock(mGeometryCacheLock);
+    mGeometryCache.transform = t;
+    mGeometryCache.inverseTransform = t.inverse();
+    mGeometryCache.transformTag = tag;
+    return t;
+}
+
+Transform Layer::getInverseTransform() const {
+    const uint64_t tag = sGeometryCacheGeneration.load(std::memory_order_acquire);
+    {
+        Mutex::Autolock lock(mGeometryCacheLock);
+        if (mGeometryCache.transformTag == tag) {
+            return mGeometryCache.inverseTransform;
+        }
+    }
+
+    // Fill the snapshot, then serve the inverse computed alongside it.
+    getTransform();
+
+    Mutex::Autolock lock(mGeometryCacheLock);
+    return mGeometryCache.inverseTransform;
 }
 
 half Layer::getAlpha() const {
-    const auto& p = mDrawingParent.promote();
+    const uint64_t tag = sGeometryCacheGeneration.load(std::memory_order_acquire);
+    {
+        Mutex::Autolock lock(mGeometryCacheLock);
+        if (mGeometryCache.alphaTag == tag) {
+            return mGeometryCache.alpha;
+        }
+    }
 
+    const auto& p = mDrawingParent.promote();
     half parentAlpha = (p != nullptr) ? p->getAlpha() : 1.0_hf;
-    return parentAlpha * getDrawingState().color.a;
+    const half alpha = parentAlpha * getDrawingState().color.a;
+
+    Mutex::Autolock lock(mGeometryCacheLock);
+    mGeometryCache.alpha = alpha;
+    mGeometryCache.alphaTag = tag;
+    return alpha;
 }
 
 half4 Layer::getColor() const {
@@ -1907,6 +2052,23 @@ half4 Layer::getColor() const {
     return half4(color.r, color.g, color.b, getAlpha());
 }
 
+uint64_t Layer::getStaticContentStamp() const {
+    // Same FNV-1a folding as the composition fingerprints built on top of
+    // this stamp. The active buffer pointer disambiguates buffers latched
+    // from different slots with equal frame numbers after a reconnect.
+    uint64_t stamp = 14695981039346656037ull;
+    auto mixIn = [&stamp](uint64_t value) { stamp = (stamp ^ value) * 1099511628211ull; };
+    mixIn(mCurrentFrameNumber);
+    mixIn(reinterpret_cast<uintptr_t>(mActiveBuffer.get()));
+    mixIn(static_cast<uint64_t>(mCurrentDataSpace));
+    mixIn(mCurrentTransform);
+    mixIn(mCurrentCrop.left);
+    mixIn(mCurrentCrop.top);
+    mixIn(mCurrentCrop.right);
+    mixIn(mCurrentCrop.bottom);
+    return stamp;
+}
+
 void Layer::commitChildList() {
     for (size_t i = 0; i < mCurrentChildren.size(); i++) {
         const auto& child = mCurrentChildren[i];
@@ -1914,6 +2076,7 @@ void Layer::commitChildList() {
     }
     mDrawingChildren = mCurrentChildren;
     mDrawingParent = mCurrentParent;
+    invalidateGeometryCaches();
 }
 
 void Layer::writeToProto(LayerProto* layerInfo, LayerVector::StateSet stateSet) {
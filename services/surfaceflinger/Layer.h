@@ -385,6 +385,12 @@ public:
 
     virtual bool isHdrY410() const { return false; }
 
+    /*
+     * isProtected - true if the layer may contain protected content in the
+     * GRALLOC_USAGE_PROTECTED sense.
+     */
+    virtual bool isProtected() const { return false; }
+
     void setGeometry(const sp<const DisplayDevice>& displayDevice, uint32_t z);
     void forceClientComposition(int32_t hwcId);
     bool getForceClientComposition(int32_t hwcId);
@@ -471,13 +477,26 @@ public:
      * the visible regions need to be recomputed (this is a fairly heavy
      * operation, so this should be set only if needed). Typically this is used
      * to figure out if the content or size of a surface has changed.
+     *
+     * If releaseFlushFence is non-null it is used as the release fence for
+     * the outgoing buffer, which keeps the latch free of EGL work and allows
+     * it to run off the main thread (see SurfaceFlinger::latchQueuedLayers).
      */
-    virtual Region latchBuffer(bool& /*recomputeVisibleRegions*/, nsecs_t /*latchTime*/) {
+    virtual Region latchBuffer(bool& /*recomputeVisibleRegions*/, nsecs_t /*latchTime*/,
+                               const sp<Fence>& /*releaseFlushFence*/ = nullptr) {
         return {};
     }
 
     virtual bool isBufferLatched() const { return false; }
 
+    /*
+     * prepareTextureImage - performs the EGL work needed before the latched
+     * buffer can be sampled (EGLImage creation and the GPU-side wait on the
+     * acquire fence), off the composition path. Must be called on the main
+     * thread with RenderEngine current.
+     */
+    virtual void prepareTextureImage() {}
+
     bool isPotentialCursor() const { return mPotentialCursor; }
     /*
      * called with the state lock from a binder thread when the layer is
@@ -560,6 +579,9 @@ public:
     virtual bool getTransformToDisplayInverse() const { return false; }
 
     Transform getTransform() const;
+    // Returns the cached inverse of getTransform(); cheaper than calling
+    // Transform::inverse() on the result when the snapshot is warm.
+    Transform getInverseTransform() const;
 
     // Returns the Alpha of the Surface, accounting for the Alpha
     // of parent Surfaces in the hierarchy (alpha's will be multiplied
@@ -567,6 +589,12 @@ public:
     half getAlpha() const;
     half4 getColor() const;
 
+    // Returns a stamp that changes whenever the content this layer would
+    // draw in client composition changes: the latched buffer and its
+    // interpretation for buffer layers. Geometry and color are part of the
+    // drawing state and are fingerprinted separately by StaticLayerCache.
+    uint64_t getStaticContentStamp() const;
+
     void traverseInReverseZOrder(LayerVector::StateSet stateSet,
                                  const LayerVector::Visitor& visitor);
     void traverseInZOrder(LayerVector::StateSet stateSet, const LayerVector::Visitor& visitor);
@@ -596,6 +624,18 @@ public:
     int32_t getZ() const;
     void pushPendingState();
 
+    // Invalidates the traversal lists cached by every layer. Called from the
+    // mutators that can affect z-order anywhere in the hierarchy, and by
+    // SurfaceFlinger once a transaction finishes committing the current
+    // hierarchy to the drawing state.
+    static void invalidateTraversalCaches();
+
+    // Invalidates the geometry snapshot memoized by every layer (see
+    // mGeometryCache). Called from the mutators feeding getTransform(),
+    // computeBounds(), computeScreenBounds() and getAlpha(): drawing-state
+    // commits, drawing-parent changes and buffer latches.
+    static void invalidateGeometryCaches();
+
 protected:
     // constant
     sp<SurfaceFlinger> mFlinger;
@@ -744,6 +784,11 @@ protected:
     FenceTimeline mReleaseTimeline;
 
     TimeStats& mTimeStats = TimeStats::getInstance();
+    // Stable TimeStats slot for this layer, resolved once at creation so
+    // per-frame events skip the string-keyed lookup. nullptr for layers
+    // whose names stats are not collected for; the TimeStats setters accept
+    // that and do nothing.
+    std::shared_ptr<TimeStats::LayerRecord> mTimeStatsRecord;
 
     // main thread
     int mActiveBufferSlot;
@@ -788,12 +833,58 @@ protected:
     // Child list used for rendering.
     LayerVector mDrawingChildren;
 
+    // makeTraversalList merges a layer's children with the layers ordered
+    // relative to it, and SurfaceFlinger traverses the hierarchy several
+    // times per frame, so the merged list is cached here and reused until a
+    // z-order mutation bumps the global generation. One coarse generation
+    // for the whole hierarchy keeps the bookkeeping trivial; mutations are
+    // rare compared to traversals.
+    static std::atomic<uint64_t> sTraversalCacheGeneration;
+    LayerVector mCurrentTraversalCache{LayerVector::StateSet::Current};
+    LayerVector mDrawingTraversalCache{LayerVector::StateSet::Drawing};
+    uint64_t mCurrentTraversalCacheTag = 0;
+    uint64_t mDrawingTraversalCacheTag = 0;
+
+    // Memoized geometry derived from the drawing state and the drawing
+    // parent chain. Visibility, HWC setup, input and drawing all ask for the
+    // same transform/bounds/alpha several times per frame, and each uncached
+    // call walks the parent chain; the snapshot makes the first call per
+    // frame pay that walk and every later call O(1). Entries are tagged with
+    // the global generation at computation time and recomputed lazily after
+    // any mutator bumps sGeometryCacheGeneration. One coarse generation for
+    // the whole hierarchy, like the traversal caches above. The snapshot is
+    // guarded by its own lock because the dump paths call these getters from
+    // binder threads.
+    static std::atomic<uint64_t> sGeometryCacheGeneration;
+    struct GeometrySnapshot {
+        uint64_t transformTag = 0;
+        Transform transform;
+        Transform inverseTransform;
+        uint64_t boundsTag = 0;
+        FloatRect bounds;
+        uint64_t boundsSansTransparentTag = 0;
+        FloatRect boundsSansTransparent;
+        uint64_t screenBoundsTag = 0;
+        Rect screenBounds;
+        uint64_t screenBoundsUnreducedTag = 0;
+        Rect screenBoundsUnreduced;
+        uint64_t alphaTag = 0;
+        half alpha = 1.0_hf;
+    };
+    mutable Mutex mGeometryCacheLock;
+    mutable GeometrySnapshot mGeometryCache;
+
     wp<Layer> mCurrentParent;
     wp<Layer> mDrawingParent;
 
     mutable LayerBE mBE;
 
 private:
+    // Memoized computeBounds(Region()) - the parent term of the
+    // computeBounds() recursion, which deliberately ignores the transparent
+    // region (see the comment in computeBounds(const Region&)).
+    FloatRect computeBoundsSansTransparentRegion() const;
+
     /**
      * Returns an unsorted vector of all layers that are part of this tree.
      * That includes the current layer and all its descendants.
@@ -26,13 +26,28 @@
 #include <utils/String8.h>
 #include <utils/Trace.h>
 
+#include <algorithm>
+#include <string.h>
+
 namespace android {
 
+// 64-bit FNV-1a
+static constexpr uint64_t kFnvOffsetBasis = 14695981039346656037ull;
+static constexpr uint64_t kFnvPrime = 1099511628211ull;
+
+static uint64_t fnvMix(uint64_t hash, const char* bytes, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        hash = (hash ^ static_cast<uint8_t>(bytes[i])) * kFnvPrime;
+    }
+    return hash;
+}
+
 void LayerStats::enable() {
     ATRACE_CALL();
     std::lock_guard<std::mutex> lock(mMutex);
     if (mEnabled) return;
     mLayerShapeStatsMap.clear();
+    mLayerShapeKeys.clear();
     mEnabled = true;
     ALOGD("Logging enabled");
 }
@@ -49,6 +64,8 @@ void LayerStats::clear() {
     ATRACE_CALL();
     std::lock_guard<std::mutex> lock(mMutex);
     mLayerShapeStatsMap.clear();
+    mLayerShapeKeys.clear();
+    mFrameCounter = 0;
     ALOGD("Cleared current layer stats");
 }
 
@@ -56,37 +73,68 @@ bool LayerStats::isEnabled() {
     return mEnabled;
 }
 
-void LayerStats::traverseLayerTreeStatsLocked(
+void LayerStats::setSampleInterval(uint32_t interval) {
+    mSampleInterval = std::max(interval, 1u);
+    ALOGD("Sampling every %u frames", mSampleInterval.load());
+}
+
+bool LayerStats::shouldSampleFrame() {
+    if (!mEnabled.load(std::memory_order_relaxed)) return false;
+    const uint32_t interval = mSampleInterval.load(std::memory_order_relaxed);
+    return mFrameCounter.fetch_add(1, std::memory_order_relaxed) % interval == 0;
+}
+
+LayerStats::LayerShapeDigest::LayerShapeDigest(std::string* outStr)
+      : hash(kFnvOffsetBasis), str(outStr) {}
+
+void LayerStats::LayerShapeDigest::add(const char* field) {
+    hash = fnvMix(hash, ",", 1);
+    hash = fnvMix(hash, field, strlen(field));
+    if (str) {
+        base::StringAppendF(str, ",%s", field);
+    }
+}
+
+void LayerStats::LayerShapeDigest::add(const std::string& field) {
+    hash = fnvMix(hash, ",", 1);
+    hash = fnvMix(hash, field.c_str(), field.size());
+    if (str) {
+        base::StringAppendF(str, ",%s", field.c_str());
+    }
+}
+
+void LayerStats::traverseLayerTreeStats(
         const std::vector<std::unique_ptr<LayerProtoParser::Layer>>& layerTree,
         const LayerProtoParser::LayerGlobal& layerGlobal,
-        std::vector<std::string>* const outLayerShapeVec) {
+        std::vector<uint64_t>* outLayerHashes,
+        std::vector<std::pair<uint64_t, std::string>>* outLayerShapes) {
     for (const auto& layer : layerTree) {
         if (!layer) continue;
-        traverseLayerTreeStatsLocked(layer->children, layerGlobal, outLayerShapeVec);
-        std::string key = "";
-        base::StringAppendF(&key, ",%s", layer->type.c_str());
-        base::StringAppendF(&key, ",%s", layerCompositionType(layer->hwcCompositionType));
-        base::StringAppendF(&key, ",%d", layer->isProtected);
-        base::StringAppendF(&key, ",%s", layerTransform(layer->hwcTransform));
-        base::StringAppendF(&key, ",%s", layerPixelFormat(layer->activeBuffer.format));
-        base::StringAppendF(&key, ",%s", layer->dataspace.c_str());
-        base::StringAppendF(&key, ",%s",
-                            destinationLocation(layer->hwcFrame.left, layerGlobal.resolution[0],
-                                                true));
-        base::StringAppendF(&key, ",%s",
-                            destinationLocation(layer->hwcFrame.top, layerGlobal.resolution[1],
-                                                false));
-        base::StringAppendF(&key, ",%s",
-                            destinationSize(layer->hwcFrame.right - layer->hwcFrame.left,
-                                            layerGlobal.resolution[0], true));
-        base::StringAppendF(&key, ",%s",
-                            destinationSize(layer->hwcFrame.bottom - layer->hwcFrame.top,
-                                            layerGlobal.resolution[1], false));
-        base::StringAppendF(&key, ",%s", scaleRatioWH(layer.get()).c_str());
-        base::StringAppendF(&key, ",%s", alpha(static_cast<float>(layer->color.a)));
-
-        outLayerShapeVec->push_back(key);
-        ALOGV("%s", key.c_str());
+        traverseLayerTreeStats(layer->children, layerGlobal, outLayerHashes, outLayerShapes);
+        std::string key;
+        LayerShapeDigest digest(outLayerShapes ? &key : nullptr);
+        digest.add(layer->type);
+        digest.add(layerCompositionType(layer->hwcCompositionType));
+        digest.add(layer->isProtected ? "1" : "0");
+        digest.add(layerTransform(layer->hwcTransform));
+        digest.add(layerPixelFormat(layer->activeBuffer.format));
+        digest.add(layer->dataspace);
+        digest.add(destinationLocation(layer->hwcFrame.left, layerGlobal.resolution[0], true));
+        digest.add(destinationLocation(layer->hwcFrame.top, layerGlobal.resolution[1], false));
+        digest.add(destinationSize(layer->hwcFrame.right - layer->hwcFrame.left,
+                                   layerGlobal.resolution[0], true));
+        digest.add(destinationSize(layer->hwcFrame.bottom - layer->hwcFrame.top,
+                                   layerGlobal.resolution[1], false));
+        digest.add(scaleRatioWH(layer.get()));
+        digest.add(alpha(static_cast<float>(layer->color.a)));
+
+        if (outLayerHashes) {
+            outLayerHashes->push_back(digest.hash);
+        }
+        if (outLayerShapes) {
+            ALOGV("%s", key.c_str());
+            outLayerShapes->emplace_back(digest.hash, std::move(key));
+        }
     }
 }
 
@@ -95,34 +143,55 @@ void LayerStats::logLayerStats(const LayersProto& layersProto) {
     ALOGV("Logging");
     auto layerGlobal = LayerProtoParser::generateLayerGlobalInfo(layersProto);
     auto layerTree = LayerProtoParser::generateLayerTree(layersProto);
-    std::vector<std::string> layerShapeVec;
 
-    std::lock_guard<std::mutex> lock(mMutex);
-    traverseLayerTreeStatsLocked(layerTree, layerGlobal, &layerShapeVec);
+    // First pass hashes the frame shape without building any strings; the
+    // readable key is only resolved below when this shape has never been
+    // seen before.
+    mFrameLayerHashes.clear();
+    traverseLayerTreeStats(layerTree, layerGlobal, &mFrameLayerHashes, nullptr);
 
-    std::string layerShapeKey =
-            base::StringPrintf("%d,%s,%s,%s", static_cast<int32_t>(layerShapeVec.size()),
+    std::string frameHeader =
+            base::StringPrintf("%d,%s,%s,%s", static_cast<int32_t>(mFrameLayerHashes.size()),
                                layerGlobal.colorMode.c_str(), layerGlobal.colorTransform.c_str(),
                                layerTransform(layerGlobal.globalTransform));
-    ALOGV("%s", layerShapeKey.c_str());
+    ALOGV("%s", frameHeader.c_str());
 
-    std::sort(layerShapeVec.begin(), layerShapeVec.end(), std::greater<std::string>());
-    for (auto const& s : layerShapeVec) {
-        layerShapeKey += s;
+    // Sorting makes the key independent of traversal order, like the string
+    // sort the concatenated keys used to get.
+    std::sort(mFrameLayerHashes.begin(), mFrameLayerHashes.end(), std::greater<uint64_t>());
+    uint64_t frameHash = fnvMix(kFnvOffsetBasis, frameHeader.c_str(), frameHeader.size());
+    for (uint64_t layerHash : mFrameLayerHashes) {
+        frameHash = fnvMix(frameHash, reinterpret_cast<const char*>(&layerHash),
+                           sizeof(layerHash));
     }
 
-    mLayerShapeStatsMap[layerShapeKey]++;
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (++mLayerShapeStatsMap[frameHash] == 1) {
+        // New shape: traverse again collecting the strings, and concatenate
+        // them in the same hash order used for the frame hash.
+        std::vector<std::pair<uint64_t, std::string>> layerShapes;
+        traverseLayerTreeStats(layerTree, layerGlobal, nullptr, &layerShapes);
+        std::sort(layerShapes.begin(), layerShapes.end(),
+                  [](const auto& lhs, const auto& rhs) { return lhs.first > rhs.first; });
+        for (auto& shape : layerShapes) {
+            frameHeader += shape.second;
+        }
+        mLayerShapeKeys.emplace(frameHash, std::move(frameHeader));
+    }
 }
 
 void LayerStats::dump(String8& result) {
     ATRACE_CALL();
     ALOGD("Dumping");
     std::lock_guard<std::mutex> lock(mMutex);
+    result.appendFormat("Sample interval: every %u frames\n", mSampleInterval.load());
     result.append("Frequency,LayerCount,ColorMode,ColorTransform,Orientation\n");
     result.append("LayerType,CompositionType,IsProtected,Transform,PixelFormat,Dataspace,");
     result.append("DstX,DstY,DstWidth,DstHeight,WScale,HScale,Alpha\n");
     for (auto& u : mLayerShapeStatsMap) {
-        result.appendFormat("%u,%s\n", u.second, u.first.c_str());
+        const auto key = mLayerShapeKeys.find(u.first);
+        result.appendFormat("%u,%s\n", u.second,
+                            key != mLayerShapeKeys.end() ? key->second.c_str() : "<unresolved>");
     }
 }
 
@@ -18,8 +18,10 @@
 
 #include <layerproto/LayerProtoHeader.h>
 #include <layerproto/LayerProtoParser.h>
+#include <atomic>
 #include <mutex>
 #include <unordered_map>
+#include <vector>
 
 using namespace android::surfaceflinger;
 
@@ -32,15 +34,39 @@ public:
     void disable();
     void clear();
     bool isEnabled();
+    // Sets how often frames are collected: every interval-th frame passed to
+    // shouldSampleFrame() is sampled. Values below 1 are clamped to 1.
+    void setSampleInterval(uint32_t interval);
+    // Returns whether stats are enabled and the current frame falls on the
+    // sampling interval. Lock-free; meant to gate the (expensive) proto
+    // generation on the caller's side as well as logLayerStats() itself.
+    bool shouldSampleFrame();
     void logLayerStats(const LayersProto& layersProto);
     void dump(String8& result);
 
 private:
-    // Traverse layer tree to get all visible layers' stats
-    void traverseLayerTreeStatsLocked(
+    // Sink for one layer's shape fields: always accumulates an FNV-1a hash
+    // over the fields, and optionally builds the human-readable
+    // comma-separated key alongside it. Hashing and formatting go through
+    // the same add() calls, so a hash computed without the string and the
+    // string built later for the same layer always correspond.
+    struct LayerShapeDigest {
+        uint64_t hash;
+        std::string* str;
+
+        explicit LayerShapeDigest(std::string* outStr);
+        void add(const char* field);
+        void add(const std::string& field);
+    };
+
+    // Traverse layer tree to get all visible layers' stats. Appends one hash
+    // per layer to outLayerHashes; when outLayerShapes is non-null, also
+    // collects each layer's readable key next to its hash.
+    void traverseLayerTreeStats(
             const std::vector<std::unique_ptr<LayerProtoParser::Layer>>& layerTree,
             const LayerProtoParser::LayerGlobal& layerGlobal,
-            std::vector<std::string>* const outLayerShapeVec);
+            std::vector<uint64_t>* outLayerHashes,
+            std::vector<std::pair<uint64_t, std::string>>* outLayerShapes);
     // Convert layer's top-left position into 8x8 percentage of the display
     static const char* destinationLocation(int32_t location, int32_t range, bool isHorizontal);
     // Convert layer's size into 8x8 percentage of the display
@@ -64,13 +90,25 @@ private:
     // Return whether the original buffer is H-flipped in final composition
     static bool isHFlipped(int32_t transform);
 
-    bool mEnabled = false;
-    // Protect mLayersStatsMap
+    std::atomic<bool> mEnabled = false;
+    // Sampling interval and frame counter, read/advanced without a lock on
+    // every frame. Only every mSampleInterval-th frame is collected, so the
+    // cost of proto generation and aggregation stays bounded when stats are
+    // left enabled in production.
+    std::atomic<uint32_t> mSampleInterval = 1;
+    std::atomic<uint32_t> mFrameCounter = 0;
+    // Protects the maps below
     std::mutex mMutex;
     // Hashmap for tracking the frame(layer shape) stats
-    // KEY is a concatenation of all layers' properties within a frame
+    // KEY is a 64-bit hash over all layers' properties within a frame
     // VALUE is the number of times this particular set has been scanned out
-    std::unordered_map<std::string, uint32_t> mLayerShapeStatsMap;
+    std::unordered_map<uint64_t, uint32_t> mLayerShapeStatsMap;
+    // The readable key for each hash, built only the first time a frame
+    // shape is seen and resolved again at dump time. Repeated frames with a
+    // known shape cost a hash-map increment and no string work.
+    std::unordered_map<uint64_t, std::string> mLayerShapeKeys;
+    // Reused between sampled frames to avoid per-frame allocation.
+    std::vector<uint64_t> mFrameLayerHashes;
 };
 
 }  // namespace android
@@ -35,6 +35,7 @@
 
 #include "Description.h"
 #include "GLES20RenderEngine.h"
+#include "GLExtensions.h"
 #include "Mesh.h"
 #include "Program.h"
 #include "ProgramCache.h"
@@ -131,6 +132,18 @@ GLES20RenderEngine::GLES20RenderEngine(uint32_t featureFlags)
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
     glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, 1, 1, 0, GL_RGB, GL_UNSIGNED_SHORT_5_6_5, protTexData);
 
+    glGenBuffers(NUM_MESH_VBOS, mMeshVbos);
+
+    mGpuTimerSupported =
+            GLExtensions::getInstance().hasExtension("GL_EXT_disjoint_timer_query");
+    if (mGpuTimerSupported) {
+        glGenQueriesEXT(NUM_GPU_TIMER_QUERIES, mGpuTimerQueries);
+        // Reading GL_GPU_DISJOINT_EXT clears it, so a disjoint event from
+        // before we started timing can't taint the first results.
+        GLint disjoint = 0;
+        glGetIntegerv(GL_GPU_DISJOINT_EXT, &disjoint);
+    }
+
     // mColorBlindnessCorrection = M;
 
     if (mPlatformHasWideColor) {
@@ -156,7 +169,69 @@ GLES20RenderEngine::GLES20RenderEngine(uint32_t featureFlags)
     }
 }
 
-GLES20RenderEngine::~GLES20RenderEngine() {}
+GLES20RenderEngine::~GLES20RenderEngine() {
+    glDeleteBuffers(NUM_MESH_VBOS, mMeshVbos);
+    if (mGpuTimerSupported) {
+        glDeleteQueriesEXT(NUM_GPU_TIMER_QUERIES, mGpuTimerQueries);
+    }
+}
+
+void GLES20RenderEngine::beginGpuFrameTimer() {
+    if (!mGpuTimerSupported || mGpuTimerActive ||
+        mGpuTimerInFlight >= NUM_GPU_TIMER_QUERIES) {
+        return;
+    }
+    const size_t slot = (mGpuTimerTail + mGpuTimerInFlight) % NUM_GPU_TIMER_QUERIES;
+    glBeginQueryEXT(GL_TIME_ELAPSED_EXT, mGpuTimerQueries[slot]);
+    mGpuTimerActive = true;
+}
+
+void GLES20RenderEngine::endGpuFrameTimer() {
+    if (!mGpuTimerActive) {
+        return;
+    }
+    glEndQueryEXT(GL_TIME_ELAPSED_EXT);
+    mGpuTimerActive = false;
+    mGpuTimerInFlight++;
+}
+
+nsecs_t GLES20RenderEngine::takeGpuFrameTime() {
+    if (!mGpuTimerSupported) {
+        return -1;
+    }
+    nsecs_t result = -1;
+    while (mGpuTimerInFlight > 0) {
+        GLuint available = 0;
+        glGetQueryObjectuivEXT(mGpuTimerQueries[mGpuTimerTail],
+                               GL_QUERY_RESULT_AVAILABLE_EXT, &available);
+        if (!available) {
+            break;
+        }
+        GLuint64 elapsed = 0;
+        glGetQueryObjectui64vEXT(mGpuTimerQueries[mGpuTimerTail], GL_QUERY_RESULT_EXT,
+                                 &elapsed);
+        mGpuTimerTail = (mGpuTimerTail + 1) % NUM_GPU_TIMER_QUERIES;
+        mGpuTimerInFlight--;
+
+        // A disjoint event (GPU clock change, reset, ...) between the begin
+        // and end of the scope makes the measurement meaningless.
+        GLint disjoint = 0;
+        glGetIntegerv(GL_GPU_DISJOINT_EXT, &disjoint);
+        if (disjoint) {
+            mGpuDisjointCount++;
+            continue;
+        }
+
+        result = static_cast<nsecs_t>(elapsed);
+        mGpuLastFrameTime = result;
+        mGpuTotalFrameTime += result;
+        if (result > mGpuMaxFrameTime) {
+            mGpuMaxFrameTime = result;
+        }
+        mGpuFrameCount++;
+    }
+    return result;
+}
 
 size_t GLES20RenderEngine::getMaxTextureSize() const {
     return mMaxTextureSize;
@@ -309,14 +384,26 @@ void GLES20RenderEngine::setupFillWithColor(float r, float g, float b, float a)
 
 void GLES20RenderEngine::drawMesh(const Mesh& mesh) {
     ATRACE_CALL();
+
+    // Stream the vertices into the next buffer of the ring and point the
+    // attrib pointers at it; the texture coordinates are interleaved after
+    // the position of each vertex.
+    const GLuint vbo = mMeshVbos[mNextMeshVbo];
+    mNextMeshVbo = (mNextMeshVbo + 1) % NUM_MESH_VBOS;
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferData(GL_ARRAY_BUFFER, mesh.getByteStride() * mesh.getVertexCount(),
+                 mesh.getPositions(), GL_STREAM_DRAW);
+
     if (mesh.getTexCoordsSize()) {
         glEnableVertexAttribArray(Program::texCoords);
         glVertexAttribPointer(Program::texCoords, mesh.getTexCoordsSize(), GL_FLOAT, GL_FALSE,
-                              mesh.getByteStride(), mesh.getTexCoords());
+                              mesh.getByteStride(),
+                              reinterpret_cast<const GLvoid*>(mesh.getVertexSize() *
+                                                              sizeof(float)));
     }
 
     glVertexAttribPointer(Program::position, mesh.getVertexSize(), GL_FLOAT, GL_FALSE,
-                          mesh.getByteStride(), mesh.getPositions());
+                          mesh.getByteStride(), nullptr);
 
     // By default, DISPLAY_P3 is the only supported wide color output. However,
     // when HDR content is present, hardware composer may be able to handle
@@ -430,6 +517,8 @@ void GLES20RenderEngine::drawMesh(const Mesh& mesh) {
     if (mesh.getTexCoordsSize()) {
         glDisableVertexAttribArray(Program::texCoords);
     }
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
 
 void GLES20RenderEngine::dump(String8& result) {
@@ -437,6 +526,15 @@ void GLES20RenderEngine::dump(String8& result) {
     result.appendFormat("RenderEngine last dataspace conversion: (%s) to (%s)\n",
                         dataspaceDetails(static_cast<android_dataspace>(mDataSpace)).c_str(),
                         dataspaceDetails(static_cast<android_dataspace>(mOutputDataSpace)).c_str());
+    if (mGpuTimerSupported) {
+        result.appendFormat("RenderEngine GPU frame time: last %.3f ms, avg %.3f ms, "
+                            "max %.3f ms over %u frames (%u disjoint)\n",
+                            mGpuLastFrameTime >= 0 ? mGpuLastFrameTime / 1e6 : 0.0,
+                            mGpuFrameCount > 0
+                                    ? mGpuTotalFrameTime / (1e6 * mGpuFrameCount)
+                                    : 0.0,
+                            mGpuMaxFrameTime / 1e6, mGpuFrameCount, mGpuDisjointCount);
+    }
 }
 
 bool GLES20RenderEngine::isHdrDataSpace(const Dataspace dataSpace) const {
@@ -45,6 +45,32 @@ class GLES20RenderEngine : public RenderEngine {
     GLuint mVpWidth;
     GLuint mVpHeight;
 
+    // Small ring of vertex buffer objects that drawMesh streams the mesh
+    // vertices through, so the driver never has to copy client arrays
+    // synchronously at draw time. Each draw orphans the next buffer's old
+    // storage with glBufferData, letting the upload overlap draws that are
+    // still reading the other buffers.
+    enum { NUM_MESH_VBOS = 4 };
+    GLuint mMeshVbos[NUM_MESH_VBOS];
+    size_t mNextMeshVbo = 0;
+
+    // Ring of EXT_disjoint_timer_query objects measuring the GPU time of
+    // each client composition pass. Queries are begun/ended around the pass
+    // and reaped lazily once their results become available, so no call here
+    // ever blocks on the GPU; if the ring fills up because the GPU is far
+    // behind, passes simply go unmeasured until it drains.
+    enum { NUM_GPU_TIMER_QUERIES = 8 };
+    GLuint mGpuTimerQueries[NUM_GPU_TIMER_QUERIES];
+    bool mGpuTimerSupported = false;
+    bool mGpuTimerActive = false;
+    size_t mGpuTimerTail = 0;
+    size_t mGpuTimerInFlight = 0;
+    nsecs_t mGpuLastFrameTime = -1;
+    nsecs_t mGpuTotalFrameTime = 0;
+    nsecs_t mGpuMaxFrameTime = 0;
+    uint32_t mGpuFrameCount = 0;
+    uint32_t mGpuDisjointCount = 0;
+
     struct Group {
         GLuint texture;
         GLuint fbo;
@@ -86,6 +112,10 @@ protected:
 
     virtual void drawMesh(const Mesh& mesh);
 
+    virtual void beginGpuFrameTimer();
+    virtual void endGpuFrameTimer();
+    virtual nsecs_t takeGpuFrameTime();
+
     virtual size_t getMaxTextureSize() const;
     virtual size_t getMaxViewportDims() const;
 
@@ -109,6 +109,15 @@ void GLExtensions::initWithEGLStrings(char const* eglVersion, char const* eglExt
     if (hasEGLExtension("EGL_IMG_context_priority")) {
         mHasContextPriority = true;
     }
+
+    // EGL_KHR_partial_update brings its own buffer age attribute, with the
+    // same token value as EGL_EXT_buffer_age.
+    if (hasEGLExtension("EGL_EXT_buffer_age") || hasEGLExtension("EGL_KHR_partial_update")) {
+        mHasBufferAge = true;
+    }
+    if (hasEGLExtension("EGL_KHR_partial_update")) {
+        mHasPartialUpdate = true;
+    }
 }
 
 char const* GLExtensions::getEGLVersion() const {
@@ -42,6 +42,8 @@ class GLExtensions : public Singleton<GLExtensions> {
     bool mHasImageCrop = false;
     bool mHasProtectedContent = false;
     bool mHasContextPriority = false;
+    bool mHasBufferAge = false;
+    bool mHasPartialUpdate = false;
 
     String8 mVendor;
     String8 mRenderer;
@@ -69,6 +71,8 @@ public:
     bool hasImageCrop() const { return mHasImageCrop; }
     bool hasProtectedContent() const { return mHasProtectedContent; }
     bool hasContextPriority() const { return mHasContextPriority; }
+    bool hasBufferAge() const { return mHasBufferAge; }
+    bool hasPartialUpdate() const { return mHasPartialUpdate; }
 
     void initWithGLStrings(GLubyte const* vendor, GLubyte const* renderer, GLubyte const* version,
                            GLubyte const* extensions);
@@ -16,6 +16,9 @@
 
 #include <stdint.h>
 
+#include <EGL/egl.h>
+#include <GLES2/gl2ext.h>
+
 #include <log/log.h>
 #include <utils/String8.h>
 
@@ -26,6 +29,20 @@
 
 namespace android {
 
+// The program binary entry points are extensions (GL_OES_get_program_binary),
+// so they have to be resolved at runtime.
+static PFNGLGETPROGRAMBINARYOESPROC getProgramBinaryOES() {
+    static const auto func = reinterpret_cast<PFNGLGETPROGRAMBINARYOESPROC>(
+            eglGetProcAddress("glGetProgramBinaryOES"));
+    return func;
+}
+
+static PFNGLPROGRAMBINARYOESPROC programBinaryOES() {
+    static const auto func = reinterpret_cast<PFNGLPROGRAMBINARYOESPROC>(
+            eglGetProcAddress("glProgramBinaryOES"));
+    return func;
+}
+
 Program::Program(const ProgramCache::Key& /*needs*/, const char* vertex, const char* fragment)
       : mInitialized(false) {
     GLuint vertexId = buildShader(vertex, GL_VERTEX_SHADER);
@@ -58,23 +75,78 @@ Program::Program(const ProgramCache::Key& /*needs*/, const char* vertex, const c
         mVertexShader = vertexId;
         mFragmentShader = fragmentId;
         mInitialized = true;
-        mProjectionMatrixLoc = glGetUniformLocation(programId, "projection");
-        mTextureMatrixLoc = glGetUniformLocation(programId, "texture");
-        mSamplerLoc = glGetUniformLocation(programId, "sampler");
-        mColorLoc = glGetUniformLocation(programId, "color");
-        mDisplayMaxLuminanceLoc = glGetUniformLocation(programId, "displayMaxLuminance");
-        mInputTransformMatrixLoc = glGetUniformLocation(programId, "inputTransformMatrix");
-        mOutputTransformMatrixLoc = glGetUniformLocation(programId, "outputTransformMatrix");
-
-        // set-up the default values for our uniforms
-        glUseProgram(programId);
-        glUniformMatrix4fv(mProjectionMatrixLoc, 1, GL_FALSE, mat4().asArray());
-        glEnableVertexAttribArray(0);
+        initAfterLink(programId);
+    }
+}
+
+Program::Program(const ProgramCache::Key& /*needs*/, GLenum binaryFormat, const void* binary,
+                 GLsizei length)
+      : mInitialized(false), mVertexShader(0), mFragmentShader(0) {
+    PFNGLPROGRAMBINARYOESPROC programBinary = programBinaryOES();
+    if (programBinary == nullptr) {
+        return;
+    }
+
+    GLuint programId = glCreateProgram();
+    programBinary(programId, binaryFormat, binary, length);
+
+    // A rejected binary is not an error; the driver may simply have been
+    // updated since the binary was saved. The caller falls back to compiling
+    // from source.
+    GLint status;
+    glGetProgramiv(programId, GL_LINK_STATUS, &status);
+    if (status != GL_TRUE) {
+        glDeleteProgram(programId);
+    } else {
+        mProgram = programId;
+        mInitialized = true;
+        initAfterLink(programId);
     }
 }
 
 Program::~Program() {}
 
+void Program::initAfterLink(GLuint programId) {
+    mProjectionMatrixLoc = glGetUniformLocation(programId, "projection");
+    mTextureMatrixLoc = glGetUniformLocation(programId, "texture");
+    mSamplerLoc = glGetUniformLocation(programId, "sampler");
+    mColorLoc = glGetUniformLocation(programId, "color");
+    mDisplayMaxLuminanceLoc = glGetUniformLocation(programId, "displayMaxLuminance");
+    mInputTransformMatrixLoc = glGetUniformLocation(programId, "inputTransformMatrix");
+    mOutputTransformMatrixLoc = glGetUniformLocation(programId, "outputTransformMatrix");
+
+    // set-up the default values for our uniforms
+    glUseProgram(programId);
+    glUniformMatrix4fv(mProjectionMatrixLoc, 1, GL_FALSE, mat4().asArray());
+    glEnableVertexAttribArray(0);
+}
+
+bool Program::getBinary(GLenum* outBinaryFormat, std::vector<uint8_t>* outBinary) const {
+    if (!mInitialized) {
+        return false;
+    }
+
+    PFNGLGETPROGRAMBINARYOESPROC getProgramBinary = getProgramBinaryOES();
+    if (getProgramBinary == nullptr) {
+        return false;
+    }
+
+    GLint length = 0;
+    glGetProgramiv(mProgram, GL_PROGRAM_BINARY_LENGTH_OES, &length);
+    if (length <= 0) {
+        return false;
+    }
+
+    outBinary->resize(length);
+    GLsizei written = 0;
+    getProgramBinary(mProgram, length, &written, outBinaryFormat, outBinary->data());
+    if (written <= 0 || written > length) {
+        return false;
+    }
+    outBinary->resize(written);
+    return true;
+}
+
 bool Program::isValid() const {
     return mInitialized;
 }
@@ -123,33 +195,61 @@ String8& Program::dumpShader(String8& result, GLenum /*type*/) {
 }
 
 void Program::setUniforms(const Description& desc) {
-    // TODO: we should have a mechanism here to not always reset uniforms that
-    // didn't change for this program.
+    // Skip the upload for any uniform still holding the wanted value from a
+    // previous draw with this program; uniforms are per-program GL state.
+    const bool cached = mUniformsCached;
 
     if (mSamplerLoc >= 0) {
-        glUniform1i(mSamplerLoc, 0);
-        glUniformMatrix4fv(mTextureMatrixLoc, 1, GL_FALSE, desc.mTexture.getMatrix().asArray());
+        if (!cached) {
+            // the sampler binding never changes
+            glUniform1i(mSamplerLoc, 0);
+        }
+        const mat4& textureMatrix = desc.mTexture.getMatrix();
+        if (!cached || mCachedTextureMatrix != textureMatrix) {
+            glUniformMatrix4fv(mTextureMatrixLoc, 1, GL_FALSE, textureMatrix.asArray());
+            mCachedTextureMatrix = textureMatrix;
+        }
     }
     if (mColorLoc >= 0) {
-        const float color[4] = {desc.mColor.r, desc.mColor.g, desc.mColor.b, desc.mColor.a};
-        glUniform4fv(mColorLoc, 1, color);
+        if (!cached || mCachedColor != desc.mColor) {
+            const float color[4] = {desc.mColor.r, desc.mColor.g, desc.mColor.b, desc.mColor.a};
+            glUniform4fv(mColorLoc, 1, color);
+            mCachedColor = desc.mColor;
+        }
     }
     if (mInputTransformMatrixLoc >= 0) {
-        mat4 inputTransformMatrix = mat4(desc.mInputTransformMatrix);
-        glUniformMatrix4fv(mInputTransformMatrixLoc, 1, GL_FALSE, inputTransformMatrix.asArray());
+        if (!cached || mCachedInputTransformMatrix != desc.mInputTransformMatrix) {
+            mat4 inputTransformMatrix = mat4(desc.mInputTransformMatrix);
+            glUniformMatrix4fv(mInputTransformMatrixLoc, 1, GL_FALSE,
+                               inputTransformMatrix.asArray());
+            mCachedInputTransformMatrix = desc.mInputTransformMatrix;
+        }
     }
     if (mOutputTransformMatrixLoc >= 0) {
         // The output transform matrix and color matrix can be combined as one matrix
-        // that is applied right before applying OETF.
-        mat4 outputTransformMatrix = desc.mColorMatrix * desc.mOutputTransformMatrix;
-        glUniformMatrix4fv(mOutputTransformMatrixLoc, 1, GL_FALSE,
-                           outputTransformMatrix.asArray());
+        // that is applied right before applying OETF. Comparing the factors
+        // saves the multiply as well as the upload when neither has changed.
+        if (!cached || mCachedColorMatrix != desc.mColorMatrix ||
+            mCachedOutputTransformMatrix != desc.mOutputTransformMatrix) {
+            mat4 outputTransformMatrix = desc.mColorMatrix * desc.mOutputTransformMatrix;
+            glUniformMatrix4fv(mOutputTransformMatrixLoc, 1, GL_FALSE,
+                               outputTransformMatrix.asArray());
+            mCachedColorMatrix = desc.mColorMatrix;
+            mCachedOutputTransformMatrix = desc.mOutputTransformMatrix;
+        }
     }
     if (mDisplayMaxLuminanceLoc >= 0) {
-        glUniform1f(mDisplayMaxLuminanceLoc, desc.mDisplayMaxLuminance);
+        if (!cached || mCachedDisplayMaxLuminance != desc.mDisplayMaxLuminance) {
+            glUniform1f(mDisplayMaxLuminanceLoc, desc.mDisplayMaxLuminance);
+            mCachedDisplayMaxLuminance = desc.mDisplayMaxLuminance;
+        }
+    }
+    // this uniform is always present
+    if (!cached || mCachedProjectionMatrix != desc.mProjectionMatrix) {
+        glUniformMatrix4fv(mProjectionMatrixLoc, 1, GL_FALSE, desc.mProjectionMatrix.asArray());
+        mCachedProjectionMatrix = desc.mProjectionMatrix;
     }
-    // these uniforms are always present
-    glUniformMatrix4fv(mProjectionMatrixLoc, 1, GL_FALSE, desc.mProjectionMatrix.asArray());
+    mUniformsCached = true;
 }
 
 } /* namespace android */
@@ -19,6 +19,8 @@
 
 #include <stdint.h>
 
+#include <vector>
+
 #include <GLES2/gl2.h>
 
 #include "Description.h"
@@ -37,11 +39,23 @@ public:
     enum { position = 0, texCoords = 1 };
 
     Program(const ProgramCache::Key& needs, const char* vertex, const char* fragment);
+
+    /* Rebuilds a program from a binary previously retrieved with getBinary().
+     * The program is left invalid if the driver rejects the binary (e.g.
+     * after a driver update), in which case the caller should fall back to
+     * compiling from source. */
+    Program(const ProgramCache::Key& needs, GLenum binaryFormat, const void* binary,
+            GLsizei length);
     ~Program();
 
     /* whether this object is usable */
     bool isValid() const;
 
+    /* Retrieves the driver-specific program binary via
+     * GL_OES_get_program_binary. Returns false if the extension is not
+     * supported or the program is invalid. */
+    bool getBinary(GLenum* outBinaryFormat, std::vector<uint8_t>* outBinary) const;
+
     /* Binds this program to the GLES context */
     void use();
 
@@ -58,6 +72,10 @@ private:
     GLuint buildShader(const char* source, GLenum type);
     String8& dumpShader(String8& result, GLenum type);
 
+    // looks up the uniform locations and sets the uniform defaults once the
+    // program has linked successfully
+    void initAfterLink(GLuint programId);
+
     // whether the initialization succeeded
     bool mInitialized;
 
@@ -84,6 +102,20 @@ private:
     /* location of transform matrix */
     GLint mInputTransformMatrixLoc;
     GLint mOutputTransformMatrixLoc;
+
+    // Last values uploaded to each uniform. Uniforms are per-program GL
+    // state, so a value that hasn't changed since the previous draw with
+    // this program doesn't need to be re-uploaded. Legacy drawing re-binds
+    // an identical description for every layer and hits this cache for
+    // everything but the texture matrix.
+    bool mUniformsCached = false;
+    mat4 mCachedProjectionMatrix;
+    mat4 mCachedTextureMatrix;
+    half4 mCachedColor;
+    mat3 mCachedInputTransformMatrix;
+    mat4 mCachedColorMatrix;
+    mat4 mCachedOutputTransformMatrix;
+    float mCachedDisplayMaxLuminance = 0.0f;
 };
 
 } /* namespace android */
@@ -16,9 +16,20 @@
 
 #define ATRACE_TAG ATRACE_TAG_GRAPHICS
 
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <vector>
+
 #include <GLES2/gl2.h>
 #include <GLES2/gl2ext.h>
 
+#include <cutils/properties.h>
 #include <utils/String8.h>
 #include <utils/Trace.h>
 
@@ -29,6 +40,50 @@
 namespace android {
 // -----------------------------------------------------------------------------------------------
 
+namespace {
+
+// On-disk layout of the program binary cache: a file header followed by the
+// entries back to back. Each entry's binary data is padded so the next entry
+// header stays 4-byte aligned.
+struct BinaryCacheHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t deviceId;
+    uint32_t count;
+};
+
+struct BinaryEntryHeader {
+    uint32_t key;
+    uint32_t format;
+    uint32_t length;
+};
+
+constexpr uint32_t kBinaryCacheMagic = 0x53465042; // 'SFPB'
+constexpr uint32_t kBinaryCacheVersion = 1;
+
+size_t alignedSize(size_t length) {
+    return (length + 3) & ~size_t(3);
+}
+
+// Program binaries are driver-specific blobs, so the cache is keyed on a
+// fingerprint of the GL implementation; a driver update invalidates it.
+uint32_t computeDeviceId() {
+    uint32_t hash = 2166136261u; // FNV-1a
+    for (GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION}) {
+        const char* s = reinterpret_cast<const char*>(glGetString(name));
+        if (s == nullptr) {
+            continue;
+        }
+        while (*s) {
+            hash ^= uint8_t(*s++);
+            hash *= 16777619u;
+        }
+    }
+    return hash;
+}
+
+} // anonymous namespace
+
 /*
  * A simple formatter class to automatically add the endl and
  * manage the indentation.
@@ -89,6 +144,11 @@ void ProgramCache::primeCache(bool hasWideColor) {
     // leaving off the experimental color matrix mask options.
 
     nsecs_t timeBefore = systemTime();
+
+    // Programs persisted by a previous boot are loaded as driver binaries,
+    // which is much cheaper than compiling them; the loops below then only
+    // compile whatever is missing.
+    const size_t loadedBinaries = loadBinaryCache();
     for (uint32_t keyVal = 0; keyVal <= keyMask; keyVal++) {
         Key shaderKey;
         shaderKey.set(keyMask, keyVal);
@@ -124,9 +184,152 @@ void ProgramCache::primeCache(bool hasWideColor) {
         }
     }
 
+    // Persist anything we had to compile so the next boot loads it as a
+    // binary instead.
+    if (mCache.size() > loadedBinaries) {
+        saveBinaryCache();
+    }
+
     nsecs_t timeAfter = systemTime();
     float compileTimeMs = static_cast<float>(timeAfter - timeBefore) / 1.0E6;
-    ALOGD("shader cache generated - %u shaders in %f ms\n", shaderCount, compileTimeMs);
+    ALOGD("shader cache generated - %u shaders in %f ms (%zu loaded from disk)\n", shaderCount,
+          compileTimeMs, loadedBinaries);
+}
+
+String8 ProgramCache::getBinaryCachePath() {
+    char value[PROPERTY_VALUE_MAX];
+    property_get("ro.sf.program_cache_dir", value, "");
+    if (value[0] == '\0') {
+        return String8();
+    }
+    return String8::format("%s/program_binaries", value);
+}
+
+size_t ProgramCache::loadBinaryCache() {
+    ATRACE_CALL();
+
+    const String8 path = getBinaryCachePath();
+    if (path.isEmpty()) {
+        return 0;
+    }
+
+    int fd = open(path.string(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return 0;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0 || size_t(st.st_size) < sizeof(BinaryCacheHeader)) {
+        close(fd);
+        return 0;
+    }
+    const size_t size = st.st_size;
+
+    void* base = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        return 0;
+    }
+
+    size_t loaded = 0;
+    const uint8_t* data = static_cast<const uint8_t*>(base);
+    const BinaryCacheHeader* header = reinterpret_cast<const BinaryCacheHeader*>(data);
+    if (header->magic == kBinaryCacheMagic && header->version == kBinaryCacheVersion &&
+        header->deviceId == computeDeviceId()) {
+        size_t offset = sizeof(BinaryCacheHeader);
+        for (uint32_t i = 0; i < header->count; i++) {
+            if (offset + sizeof(BinaryEntryHeader) > size) {
+                break;
+            }
+            const BinaryEntryHeader* entry =
+                    reinterpret_cast<const BinaryEntryHeader*>(data + offset);
+            offset += sizeof(BinaryEntryHeader);
+            if (entry->length == 0 || entry->length > size - offset) {
+                break;
+            }
+
+            Key shaderKey;
+            shaderKey.mKey = entry->key;
+            if (mCache.indexOfKey(shaderKey) < 0) {
+                Program* program = new Program(shaderKey, entry->format, data + offset,
+                                               entry->length);
+                if (program->isValid()) {
+                    mCache.add(shaderKey, program);
+                    loaded++;
+                } else {
+                    // the driver rejected the binary (e.g. after an update);
+                    // the program will be recompiled from source
+                    delete program;
+                }
+            }
+            offset += alignedSize(entry->length);
+        }
+    }
+
+    munmap(base, size);
+    return loaded;
+}
+
+void ProgramCache::saveBinaryCache() {
+    ATRACE_CALL();
+
+    const String8 path = getBinaryCachePath();
+    if (path.isEmpty()) {
+        return;
+    }
+
+    struct Entry {
+        uint32_t key;
+        GLenum format;
+        std::vector<uint8_t> binary;
+    };
+    std::vector<Entry> entries;
+    size_t fileSize = sizeof(BinaryCacheHeader);
+    for (size_t i = 0; i < mCache.size(); i++) {
+        Entry entry;
+        entry.key = mCache.keyAt(i).mKey;
+        if (mCache.valueAt(i)->getBinary(&entry.format, &entry.binary)) {
+            fileSize += sizeof(BinaryEntryHeader) + alignedSize(entry.binary.size());
+            entries.push_back(std::move(entry));
+        }
+    }
+    if (entries.empty()) {
+        return;
+    }
+
+    std::vector<uint8_t> buffer(fileSize, 0);
+    BinaryCacheHeader* header = reinterpret_cast<BinaryCacheHeader*>(buffer.data());
+    header->magic = kBinaryCacheMagic;
+    header->version = kBinaryCacheVersion;
+    header->deviceId = computeDeviceId();
+    header->count = entries.size();
+
+    size_t offset = sizeof(BinaryCacheHeader);
+    for (const Entry& entry : entries) {
+        BinaryEntryHeader* entryHeader =
+                reinterpret_cast<BinaryEntryHeader*>(buffer.data() + offset);
+        entryHeader->key = entry.key;
+        entryHeader->format = entry.format;
+        entryHeader->length = entry.binary.size();
+        offset += sizeof(BinaryEntryHeader);
+        memcpy(buffer.data() + offset, entry.binary.data(), entry.binary.size());
+        offset += alignedSize(entry.binary.size());
+    }
+
+    // Write to a temporary file and rename it so a partial write can never
+    // be picked up by the next boot.
+    const String8 tempPath = String8::format("%s.tmp", path.string());
+    int fd = open(tempPath.string(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        ALOGW("could not save program binary cache: %s", strerror(errno));
+        return;
+    }
+    const ssize_t written = write(fd, buffer.data(), buffer.size());
+    close(fd);
+    if (written != ssize_t(buffer.size()) || rename(tempPath.string(), path.string()) < 0) {
+        ALOGW("could not save program binary cache: %s", strerror(errno));
+        unlink(tempPath.string());
+    }
 }
 
 ProgramCache::Key ProgramCache::computeKey(const Description& description) {
@@ -677,6 +880,10 @@ void ProgramCache::useProgram(const Description& description) {
 
         ALOGV(">>> generated new program: needs=%08X, time=%u ms (%zu programs)", needs.mKey,
               uint32_t(ns2ms(time)), mCache.size());
+
+        // Persist the freshly compiled program so future boots load it as a
+        // binary and never pay this mid-frame compile again.
+        saveBinaryCache();
     }
 
     // here we have a suitable program for this description
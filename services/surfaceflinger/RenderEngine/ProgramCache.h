@@ -185,6 +185,19 @@ private:
     // generates the fragment shader from the Key
     static String8 generateFragmentShader(const Key& needs);
 
+    // Populates the cache with program binaries persisted by a previous
+    // boot, so priming doesn't have to compile them again. Returns the
+    // number of programs loaded. Binaries rejected by the driver (e.g.
+    // after a driver update) are silently skipped and recompiled.
+    size_t loadBinaryCache();
+    // Persists the binaries of all valid cached programs, so the next boot
+    // can load them instead of compiling. Writes to a temporary file and
+    // renames it, so a partial write can never be loaded.
+    void saveBinaryCache();
+    // Returns the path of the on-disk binary cache, or an empty string when
+    // the cache is disabled (no cache directory configured).
+    static String8 getBinaryCachePath();
+
     // Key/Value map used for caching Programs. Currently the cache
     // is never shrunk.
     DefaultKeyedVector<Key, Program*> mCache;
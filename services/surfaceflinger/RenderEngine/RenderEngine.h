@@ -28,6 +28,7 @@
 #include <android-base/unique_fd.h>
 #include <gui/SurfaceControl.h>
 #include <math/mat4.h>
+#include <utils/Timers.h>
 
 #define EGL_NO_CONFIG ((EGLConfig)0)
 
@@ -126,6 +127,17 @@ public:
     // drawing
     virtual void drawMesh(const Mesh& mesh) = 0;
 
+    // GPU frame timing. beginGpuFrameTimer/endGpuFrameTimer bracket the GL
+    // commands of one composition pass with a timer query scope when the
+    // driver supports it; all three must be called on the GL thread.
+    // takeGpuFrameTime reaps completed queries without blocking and returns
+    // the GPU duration of the most recently finished pass in nanoseconds, or
+    // -1 if no new result is available (including when timer queries are
+    // unsupported). Results trail the pass they measure by a few frames.
+    virtual void beginGpuFrameTimer() = 0;
+    virtual void endGpuFrameTimer() = 0;
+    virtual nsecs_t takeGpuFrameTime() = 0;
+
     // queries
     virtual size_t getMaxTextureSize() const = 0;
     virtual size_t getMaxViewportDims() const = 0;
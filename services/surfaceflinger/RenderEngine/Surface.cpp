@@ -16,9 +16,14 @@
 
 #include "Surface.h"
 
+#include "GLExtensions.h"
 #include "RenderEngine.h"
 
+#include <vector>
+
+#include <EGL/eglext.h>
 #include <log/log.h>
+#include <ui/Region.h>
 
 namespace android {
 namespace RE {
@@ -64,6 +69,46 @@ void Surface::swapBuffers() const {
     }
 }
 
+int32_t Surface::queryBufferAge() const {
+    if (!GLExtensions::getInstance().hasBufferAge() || mEGLSurface == EGL_NO_SURFACE) {
+        return 0;
+    }
+    return querySurface(EGL_BUFFER_AGE_EXT);
+}
+
+void Surface::setDamageRegion(const Region& damage) const {
+    if (!GLExtensions::getInstance().hasPartialUpdate() || mEGLSurface == EGL_NO_SURFACE) {
+        return;
+    }
+
+    static PFNEGLSETDAMAGEREGIONKHRPROC eglSetDamageRegionKHR =
+            reinterpret_cast<PFNEGLSETDAMAGEREGIONKHRPROC>(
+                    eglGetProcAddress("eglSetDamageRegionKHR"));
+    if (eglSetDamageRegionKHR == nullptr) {
+        return;
+    }
+
+    // EGL rects are in the GL convention, with the origin at the bottom left
+    // of the surface.
+    const int32_t height = queryHeight();
+    size_t count = 0;
+    const Rect* rects = damage.getArray(&count);
+    std::vector<EGLint> eglRects;
+    eglRects.reserve(count * 4);
+    for (size_t i = 0; i < count; i++) {
+        eglRects.push_back(rects[i].left);
+        eglRects.push_back(height - rects[i].bottom);
+        eglRects.push_back(rects[i].getWidth());
+        eglRects.push_back(rects[i].getHeight());
+    }
+
+    if (!eglSetDamageRegionKHR(mEGLDisplay, mEGLSurface, eglRects.data(),
+                               static_cast<EGLint>(count))) {
+        ALOGW("eglSetDamageRegionKHR(%p, %p) failed with 0x%08x", mEGLDisplay, mEGLSurface,
+              eglGetError());
+    }
+}
+
 EGLint Surface::queryConfig(EGLint attrib) const {
     EGLint value;
     if (!eglGetConfigAttrib(mEGLDisplay, mEGLConfig, attrib, &value)) {
@@ -23,6 +23,9 @@
 struct ANativeWindow;
 
 namespace android {
+
+class Region;
+
 namespace RE {
 
 class Surface {
@@ -35,6 +38,14 @@ public:
     virtual void setNativeWindow(ANativeWindow* window) = 0;
     virtual void swapBuffers() const = 0;
 
+    // Returns how many swaps ago the current back buffer was last presented,
+    // or 0 when unknown (first use, buffer age unsupported). A partial
+    // repaint is only valid when the age identifies the buffer contents.
+    virtual int32_t queryBufferAge() const = 0;
+    // Announces the region that will be redrawn this frame via
+    // EGL_KHR_partial_update; a no-op when the extension is unavailable.
+    virtual void setDamageRegion(const Region& damage) const = 0;
+
     virtual int32_t queryRedSize() const = 0;
     virtual int32_t queryGreenSize() const = 0;
     virtual int32_t queryBlueSize() const = 0;
@@ -63,6 +74,9 @@ public:
     void setNativeWindow(ANativeWindow* window) override;
     void swapBuffers() const override;
 
+    int32_t queryBufferAge() const override;
+    void setDamageRegion(const Region& damage) const override;
+
     int32_t queryRedSize() const override;
     int32_t queryGreenSize() const override;
     int32_t queryBlueSize() const override;
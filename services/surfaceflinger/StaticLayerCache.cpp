@@ -0,0 +1,313 @@
+/*
+ * Copyright 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#undef LOG_TAG
+#define LOG_TAG "StaticLayerCache"
+#define ATRACE_TAG ATRACE_TAG_GRAPHICS
+
+#include "StaticLayerCache.h"
+
+#include <string.h>
+
+#include <cutils/properties.h>
+#include <math/vec2.h>
+#include <ui/Rect.h>
+#include <ui/Region.h>
+#include <utils/Log.h>
+#include <utils/String8.h>
+#include <utils/Trace.h>
+
+#include "DisplayDevice.h"
+#include "DisplayHardware/HWC2.h"
+#include "Layer.h"
+#include "RenderEngine/Image.h"
+#include "RenderEngine/Mesh.h"
+#include "RenderEngine/RenderEngine.h"
+#include "RenderEngine/Texture.h"
+#include "Transform.h"
+
+namespace android {
+
+// Caching a single layer saves nothing over drawing it directly.
+static constexpr size_t kMinRunLayers = 2;
+
+StaticLayerCache::StaticLayerCache()
+      : mFramesToCache(property_get_int32("debug.sf.static_layer_cache", 0)) {
+    if (isEnabled()) {
+        ALOGI("Static layer cache enabled after %d unchanged frames", mFramesToCache);
+    }
+}
+
+StaticLayerCache::~StaticLayerCache() = default;
+
+size_t StaticLayerCache::update(RE::RenderEngine& engine,
+                                const sp<const DisplayDevice>& displayDevice, int32_t hwcId) {
+    if (!isEnabled()) {
+        return 0;
+    }
+
+    DisplayCache& cache = mCaches[hwcId];
+
+    const size_t runLength = findStaticRun(displayDevice, hwcId);
+    if (runLength < kMinRunLayers) {
+        cache.stableFrames = 0;
+        cache.rendered = false;
+        return 0;
+    }
+
+    const uint64_t fingerprint = fingerprintRun(displayDevice, runLength, hwcId);
+    if (fingerprint != cache.fingerprint || runLength != cache.runLength) {
+        cache.fingerprint = fingerprint;
+        cache.runLength = runLength;
+        cache.stableFrames = 1;
+        cache.rendered = false;
+        return 0;
+    }
+
+    if (cache.stableFrames < mFramesToCache) {
+        cache.stableFrames++;
+        return 0;
+    }
+
+    if (!cache.rendered) {
+        if (!renderRun(engine, displayDevice, runLength, cache)) {
+            return 0;
+        }
+        cache.rendered = true;
+        cache.renders++;
+    }
+
+    cache.quadFrames++;
+    return runLength;
+}
+
+size_t StaticLayerCache::findStaticRun(const sp<const DisplayDevice>& displayDevice,
+                                       int32_t hwcId) const {
+    size_t run = 0;
+    for (const sp<Layer>& layer : displayDevice->getVisibleLayersSortedByZ()) {
+        if (layer->getCompositionType(hwcId) != HWC2::Composition::Client) {
+            break;
+        }
+        // Secure and protected content must never land in the unprotected
+        // scratch buffer, and HDR layers would lose their tone mapping going
+        // through an RGBA8888 intermediate.
+        if (layer->isSecure() || layer->isProtected() || layer->isHdrY410()) {
+            break;
+        }
+        run++;
+    }
+    return run;
+}
+
+uint64_t StaticLayerCache::fingerprintRun(const sp<const DisplayDevice>& displayDevice,
+                                          size_t runLength, int32_t hwcId) const {
+    // The same FNV-1a folding the partial repaint logic uses for the client
+    // target. Every field that can alter what the cached run would draw must
+    // be mixed in here; a missed field means stale pixels on screen, not
+    // just a missed optimization.
+    uint64_t fingerprint = 14695981039346656037ull;
+    auto mixIn = [&fingerprint](uint64_t value) {
+        fingerprint = (fingerprint ^ value) * 1099511628211ull;
+    };
+    auto mixInFloat = [&mixIn](float value) {
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        mixIn(bits);
+    };
+    auto mixInRect = [&mixIn](const Rect& rect) {
+        mixIn(static_cast<uint64_t>(rect.left) << 32 | static_cast<uint32_t>(rect.top));
+        mixIn(static_cast<uint64_t>(rect.right) << 32 | static_cast<uint32_t>(rect.bottom));
+    };
+    auto mixInRegion = [&mixInRect](const Region& region) {
+        for (const Rect& rect : region) {
+            mixInRect(rect);
+        }
+    };
+
+    mixIn(displayDevice->getWidth());
+    mixIn(displayDevice->getHeight());
+    mixIn(displayDevice->getOrientation());
+    mixIn(static_cast<uint64_t>(displayDevice->getCompositionDataSpace()));
+
+    const auto& layers = displayDevice->getVisibleLayersSortedByZ();
+    for (size_t i = 0; i < runLength; i++) {
+        const sp<Layer>& layer = layers[i];
+        const Layer::State& s = layer->getDrawingState();
+
+        mixIn(static_cast<uint32_t>(layer->sequence));
+        mixIn(static_cast<uint64_t>(layer->getCompositionType(hwcId)));
+        mixIn(layer->getStaticContentStamp());
+
+        mixIn(s.active.w);
+        mixIn(s.active.h);
+        mixIn(s.flags);
+        mixInRect(s.crop);
+        mixInRect(s.finalCrop);
+        mixInRegion(s.activeTransparentRegion);
+
+        // getTransform() folds in the parent chain, so a moved or rescaled
+        // ancestor changes the fingerprint as well.
+        const Transform tr = layer->getTransform();
+        for (size_t col = 0; col < 3; col++) {
+            for (size_t row = 0; row < 3; row++) {
+                mixInFloat(tr[col][row]);
+            }
+        }
+
+        mixInFloat(static_cast<float>(layer->getAlpha()));
+        const half4 color = layer->getColor();
+        mixInFloat(static_cast<float>(color.r));
+        mixInFloat(static_cast<float>(color.g));
+        mixInFloat(static_cast<float>(color.b));
+
+        mixInRegion(layer->visibleRegion);
+    }
+    return fingerprint;
+}
+
+bool StaticLayerCache::renderRun(RE::RenderEngine& engine,
+                                 const sp<const DisplayDevice>& displayDevice, size_t runLength,
+                                 DisplayCache& cache) {
+    ATRACE_CALL();
+
+    const uint32_t width = displayDevice->getWidth();
+    const uint32_t height = displayDevice->getHeight();
+
+    if (cache.buffer == nullptr || cache.buffer->getWidth() != width ||
+        cache.buffer->getHeight() != height) {
+        if (cache.hasTexName) {
+            engine.deleteTextures(1, &cache.texName);
+            cache.hasTexName = false;
+        }
+        cache.image = nullptr;
+        cache.buffer = nullptr;
+
+        const uint32_t usage = GRALLOC_USAGE_HW_RENDER | GRALLOC_USAGE_HW_TEXTURE;
+        sp<GraphicBuffer> buffer = new GraphicBuffer(width, height, HAL_PIXEL_FORMAT_RGBA_8888, 1,
+                                                     usage, "StaticLayerCache");
+        if (buffer->initCheck() != NO_ERROR) {
+            ALOGE("Failed to allocate a %ux%u cache buffer", width, height);
+            return false;
+        }
+
+        std::unique_ptr<RE::Image> image = engine.createImage();
+        if (!image->setNativeWindowBuffer(buffer->getNativeBuffer(), false /* isProtected */,
+                                          width, height)) {
+            ALOGE("Failed to wrap the cache buffer in an image");
+            return false;
+        }
+
+        engine.genTextures(1, &cache.texName);
+        cache.hasTexName = true;
+        engine.bindExternalTextureImage(cache.texName, *image);
+        cache.buffer = buffer;
+        cache.image = std::move(image);
+    }
+
+    cache.dataSpace = displayDevice->hasWideColorGamut()
+            ? displayDevice->getCompositionDataSpace()
+            : ui::Dataspace::UNKNOWN;
+    engine.setOutputDataSpace(cache.dataSpace);
+    // The display's color transform is applied when the quad is composited,
+    // so the cached rendering itself must stay untransformed.
+    engine.setupColorTransform(mat4());
+    engine.checkErrors();
+
+    RE::BindNativeBufferAsFramebuffer bufferBond(engine, cache.buffer->getNativeBuffer());
+    if (bufferBond.getStatus() != NO_ERROR) {
+        ALOGE("Failed to bind the cache buffer as a framebuffer");
+        return false;
+    }
+
+    // Same orientation convention as the screenshot path: rendered with
+    // yswap into the buffer, sampled back with flipped texture coordinates.
+    engine.setViewportAndProjection(width, height, Rect(width, height), height, true,
+                                    Transform::ROT_0);
+    engine.disableTexturing();
+    engine.clearWithColor(0, 0, 0, 0);
+
+    const DisplayRenderArea renderArea(displayDevice);
+    const Transform& displayTransform = displayDevice->getTransform();
+    const auto& layers = displayDevice->getVisibleLayersSortedByZ();
+    for (size_t i = 0; i < runLength; i++) {
+        const Region clip(displayTransform.transform(layers[i]->visibleRegion));
+        layers[i]->draw(renderArea, clip);
+    }
+
+    // One-time cost per rebuild: the texture is sampled as soon as this
+    // frame's client composition runs, so the rendering must have completed
+    // before the framebuffer binding goes away.
+    engine.finish();
+
+    ALOGV("Cached %zu static layers for display %d", runLength, displayDevice->getHwcDisplayId());
+    return true;
+}
+
+void StaticLayerCache::draw(RE::RenderEngine& engine,
+                            const sp<const DisplayDevice>& displayDevice) {
+    const auto it = mCaches.find(displayDevice->getHwcDisplayId());
+    if (it == mCaches.end() || !it->second.rendered) {
+        return;
+    }
+    const DisplayCache& cache = it->second;
+
+    const float width = displayDevice->getWidth();
+    const float height = displayDevice->getHeight();
+
+    Texture texture(Texture::TEXTURE_EXTERNAL, cache.texName);
+    texture.setDimensions(cache.buffer->getWidth(), cache.buffer->getHeight());
+    texture.setFiltering(false);
+    engine.setupLayerTexturing(texture);
+    engine.setSourceDataSpace(cache.dataSpace);
+    // The cached pixels already carry the source layers' premultiplied
+    // alpha, so compositing the quad with premultiplied blending produces
+    // the same result as drawing the run layer by layer.
+    engine.setupLayerBlending(true /* premultipliedAlpha */, false /* opaque */,
+                              false /* disableTexture */, half4(1.0f, 1.0f, 1.0f, 1.0f));
+
+    Mesh mesh(Mesh::TRIANGLE_FAN, 4, 2, 2);
+    Mesh::VertexArray<vec2> position(mesh.getPositionArray<vec2>());
+    position[0] = vec2(0.0f, 0.0f);
+    position[1] = vec2(0.0f, height);
+    position[2] = vec2(width, height);
+    position[3] = vec2(width, 0.0f);
+    Mesh::VertexArray<vec2> texCoords(mesh.getTexCoordArray<vec2>());
+    texCoords[0] = vec2(0.0f, 1.0f);
+    texCoords[1] = vec2(0.0f, 0.0f);
+    texCoords[2] = vec2(1.0f, 0.0f);
+    texCoords[3] = vec2(1.0f, 1.0f);
+
+    engine.drawMesh(mesh);
+    engine.disableBlending();
+    engine.disableTexturing();
+}
+
+void StaticLayerCache::dump(String8& result) const {
+    if (!isEnabled()) {
+        return;
+    }
+    result.appendFormat("Static layer cache (cache after %d unchanged frames):\n", mFramesToCache);
+    for (const auto& entry : mCaches) {
+        const DisplayCache& cache = entry.second;
+        result.appendFormat("  display %d: %zu cached layers, stable for %d frames, "
+                            "%u cache renders, %u frames composited from the cache\n",
+                            entry.first, cache.rendered ? cache.runLength : 0, cache.stableFrames,
+                            cache.renders, cache.quadFrames);
+    }
+}
+
+}  // namespace android
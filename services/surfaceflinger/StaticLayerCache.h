@@ -0,0 +1,107 @@
+/*
+ * Copyright 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include <memory>
+#include <unordered_map>
+
+#include <ui/GraphicBuffer.h>
+#include <ui/GraphicTypes.h>
+#include <utils/StrongPointer.h>
+
+namespace android {
+
+class DisplayDevice;
+class String8;
+
+namespace RE {
+class Image;
+class RenderEngine;
+} // namespace RE
+
+/*
+ * StaticLayerCache caches the composition of the run of client-composited
+ * layers at the bottom of a display's z-order once they have been unchanged
+ * for several consecutive frames. The run is rendered once into a scratch
+ * buffer and composited as a single textured quad from then on, replacing
+ * the per-layer GL setup and draw calls on mostly-static screens (kiosks,
+ * always-on UIs). A new buffer latched by any cached layer, or a transaction
+ * that changes its drawing state, changes the run's fingerprint and drops
+ * the cached rendering.
+ *
+ * Enabled by setting debug.sf.static_layer_cache to the number of unchanged
+ * frames a run must survive before it is cached (0, the default, disables
+ * the cache).
+ */
+class StaticLayerCache {
+public:
+    StaticLayerCache();
+    ~StaticLayerCache();
+
+    bool isEnabled() const { return mFramesToCache > 0; }
+
+    // Called once per client-composited frame with the GL context current,
+    // before the display's projection is applied. Returns how many layers at
+    // the bottom of the z-order the cache stands in for this frame, rendering
+    // the run into the cache buffer first if it just became stable. Returns 0
+    // when nothing is cached and every layer must be composited as usual.
+    // May leave a different viewport and projection configured.
+    size_t update(RE::RenderEngine& engine, const sp<const DisplayDevice>& displayDevice,
+                  int32_t hwcId);
+
+    // Composites the cached run as a single quad. Only valid on a frame where
+    // update() returned non-zero, with the display's projection set.
+    void draw(RE::RenderEngine& engine, const sp<const DisplayDevice>& displayDevice);
+
+    void dump(String8& result) const;
+
+private:
+    struct DisplayCache {
+        // What the cache would stand in for, tracked every frame.
+        uint64_t fingerprint = 0;
+        size_t runLength = 0;
+        int32_t stableFrames = 0;
+
+        // The cached rendering, valid while rendered is true.
+        bool rendered = false;
+        sp<GraphicBuffer> buffer;
+        std::unique_ptr<RE::Image> image;
+        uint32_t texName = 0;
+        bool hasTexName = false;
+        ui::Dataspace dataSpace = ui::Dataspace::UNKNOWN;
+
+        uint32_t quadFrames = 0;
+        uint32_t renders = 0;
+    };
+
+    size_t findStaticRun(const sp<const DisplayDevice>& displayDevice, int32_t hwcId) const;
+    uint64_t fingerprintRun(const sp<const DisplayDevice>& displayDevice, size_t runLength,
+                            int32_t hwcId) const;
+    bool renderRun(RE::RenderEngine& engine, const sp<const DisplayDevice>& displayDevice,
+                   size_t runLength, DisplayCache& cache);
+
+    // Number of consecutive unchanged frames before a run is cached; 0
+    // disables the cache entirely.
+    const int32_t mFramesToCache;
+
+    // Keyed by hardware composer display id.
+    std::unordered_map<int32_t, DisplayCache> mCaches;
+};
+
+}  // namespace android
@@ -17,7 +17,10 @@
 // #define LOG_NDEBUG 0
 #define ATRACE_TAG ATRACE_TAG_GRAPHICS
 
+#include <pthread.h>
 #include <stdint.h>
+#include <string.h>
+#include <sys/resource.h>
 #include <sys/types.h>
 #include <algorithm>
 #include <errno.h>
@@ -27,6 +30,10 @@
 #include <inttypes.h>
 #include <stdatomic.h>
 #include <optional>
+#include <unordered_set>
+
+#include <cutils/sched_policy.h>
+#include <system/thread_defs.h>
 
 #include <cutils/properties.h>
 #include <log/log.h>
@@ -196,6 +203,10 @@ private:
 
     void preallocateBuffers() override { surface->allocateBuffers(); }
 
+    void enableDequeueBufferPrefetch() override {
+        surface->setDequeueBufferPrefetch(true);
+    }
+
     sp<Surface> surface;
 };
 
@@ -375,6 +386,14 @@ void SurfaceFlinger::onFirstRef()
 
 SurfaceFlinger::~SurfaceFlinger()
 {
+    {
+        std::lock_guard<std::mutex> lock(mLatchWorkMutex);
+        mLatchWorkersShutdown = true;
+    }
+    mLatchWorkCondition.notify_all();
+    for (auto& worker : mLatchWorkers) {
+        worker.join();
+    }
 }
 
 void SurfaceFlinger::binderDied(const wp<IBinder>& /* who */)
@@ -678,6 +697,29 @@ void SurfaceFlinger::init() {
 
     ALOGI("Phase offest NS: %" PRId64 "", vsyncPhaseOffsetNs);
 
+    // EGL/RenderEngine initialization and the composer HAL connection are
+    // the two slowest steps here and are independent of each other and of
+    // the event threads, so run both on worker threads while the event
+    // threads are created below. They are joined before the first step that
+    // needs them: processing the initial hotplug, which creates the primary
+    // display's render surface. RenderEngine::create releases its EGL
+    // context before returning, so the context can be made current on this
+    // thread afterwards, and HWComposer makes no callbacks into
+    // SurfaceFlinger until registerCallback.
+    std::unique_ptr<RE::RenderEngine> renderEngine;
+    std::thread renderEngineInitThread([this, &renderEngine] {
+        renderEngine =
+                RE::impl::RenderEngine::create(HAL_PIXEL_FORMAT_RGBA_8888,
+                                               hasWideColorDisplay
+                                                       ? RE::RenderEngine::WIDE_COLOR_SUPPORT
+                                                       : 0);
+    });
+    std::unique_ptr<HWComposer> hwc;
+    std::thread hwcInitThread([this, &hwc] {
+        hwc = std::make_unique<HWComposer>(
+                std::make_unique<Hwc2::impl::Composer>(getBE().mHwcServiceName));
+    });
+
     Mutex::Autolock _l(mStateLock);
 
     // start the EventThread
@@ -702,18 +744,15 @@ void SurfaceFlinger::init() {
     mEventQueue->setEventThread(mSFEventThread.get());
     mVsyncModulator.setEventThreads(mSFEventThread.get(), mEventThread.get());
 
-    // Get a RenderEngine for the given display / config (can't fail)
-    getBE().mRenderEngine =
-            RE::impl::RenderEngine::create(HAL_PIXEL_FORMAT_RGBA_8888,
-                                           hasWideColorDisplay
-                                                   ? RE::RenderEngine::WIDE_COLOR_SUPPORT
-                                                   : 0);
+    // Collect the RenderEngine for the given display / config (can't fail)
+    renderEngineInitThread.join();
+    getBE().mRenderEngine = std::move(renderEngine);
     LOG_ALWAYS_FATAL_IF(getBE().mRenderEngine == nullptr, "couldn't create RenderEngine");
 
     LOG_ALWAYS_FATAL_IF(mVrFlingerRequestsDisplay,
             "Starting with vr flinger active is not currently supported.");
-    getBE().mHwc.reset(
-            new HWComposer(std::make_unique<Hwc2::impl::Composer>(getBE().mHwcServiceName)));
+    hwcInitThread.join();
+    getBE().mHwc = std::move(hwc);
     getBE().mHwc->registerCallback(this, getBE().mComposerSequenceId);
     // Process any initial hotplug and resulting display changes.
     processDisplayHotplugEventsLocked();
@@ -756,7 +795,12 @@ void SurfaceFlinger::init() {
     // set initial conditions (e.g. unblank default device)
     initializeDisplays();
 
-    getBE().mRenderEngine->primeCache();
+    // Prime the shader cache off the readiness critical path: boot progress
+    // is gated on init() returning, and with the on-disk program binary
+    // cache a warm prime is cheap anyway. The message runs first thing on
+    // the main message loop, where the GL context is current, so priming
+    // still completes ahead of the first composited frame.
+    postMessageAsync(new LambdaMessage([this] { getBE().mRenderEngine->primeCache(); }));
 
     // Inform native graphics APIs whether the present timestamp is supported:
     if (getHwComposer().hasCapability(
@@ -1263,6 +1307,23 @@ status_t SurfaceFlinger::getLayerDebugInfo(std::vector<LayerDebugInfo>* outLayer
         return PERMISSION_DENIED;
     }
 
+    // Arm snapshot publication and serve the current snapshot when it is
+    // up to date with the latest refresh: tooling that polls repeatedly
+    // reads published immutable state and never contends on mStateLock
+    // after its first query. A snapshot published before the latest refresh
+    // may describe a hierarchy that has since changed, so it is only a hit
+    // while the refresh sequence still matches.
+    mLayerDebugSnapshotArmedUntil.store(systemTime() + s2ns(10), std::memory_order_relaxed);
+    {
+        const auto snapshot = std::atomic_load_explicit(&mLayerDebugSnapshot,
+                                                        std::memory_order_acquire);
+        if (snapshot != nullptr &&
+                snapshot->refreshSequence == mRefreshSequence.load(std::memory_order_relaxed)) {
+            *outLayers = snapshot->layers;
+            return NO_ERROR;
+        }
+    }
+
     // Try to acquire a lock for 1s, fail gracefully
     const status_t err = mStateLock.timedLock(s2ns(1));
     const bool locked = (err == NO_ERROR);
@@ -1283,11 +1344,11 @@ status_t SurfaceFlinger::getLayerDebugInfo(std::vector<LayerDebugInfo>* outLayer
 // ----------------------------------------------------------------------------
 
 sp<IDisplayEventConnection> SurfaceFlinger::createDisplayEventConnection(
-        ISurfaceComposer::VsyncSource vsyncSource) {
+        ISurfaceComposer::VsyncSource vsyncSource, uint32_t vsyncRate, uint32_t vsyncPhase) {
     if (vsyncSource == eVsyncSourceSurfaceFlinger) {
-        return mSFEventThread->createEventConnection();
+        return mSFEventThread->createEventConnection(vsyncRate, vsyncPhase);
     } else {
-        return mEventThread->createEventConnection();
+        return mEventThread->createEventConnection(vsyncRate, vsyncPhase);
     }
 }
 
@@ -1356,6 +1417,7 @@ void SurfaceFlinger::resyncToHardwareVsync(bool makeAvailable) {
 
     mPrimaryDispSync.reset();
     mPrimaryDispSync.setPeriod(period);
+    mVsyncModulator.setDisplayRefreshPeriod(period);
 
     if (!mPrimaryHWVsyncEnabled) {
         mPrimaryDispSync.beginResync();
@@ -1530,6 +1592,7 @@ void SurfaceFlinger::updateVrFlinger() {
     const auto& activeConfig = getBE().mHwc->getActiveConfig(HWC_DISPLAY_PRIMARY);
     const nsecs_t period = activeConfig->getVsyncPeriod();
     mAnimFrameTracker.setDisplayRefreshPeriod(period);
+    mVsyncModulator.setDisplayRefreshPeriod(period);
 
     // Use phase of 0 since phase is not known.
     // Use latency of 0, which will snap to the ideal latency.
@@ -1561,8 +1624,14 @@ void SurfaceFlinger::onMessageReceived(int32_t what) {
             // potentially trigger a display handoff.
             updateVrFlinger();
 
+            // Give the power advisor a chance to pre-boost before any of the
+            // frame's work starts, when we're coming out of an idle gap.
+            getHwComposer().getPowerAdvisor().notifyFrameBegin(mPrimaryDispSync.getPeriod());
+
+            const nsecs_t invalidateStart = systemTime();
             bool refreshNeeded = handleMessageTransaction();
             refreshNeeded |= handleMessageInvalidate();
+            mLastInvalidateDuration = systemTime() - invalidateStart;
             refreshNeeded |= mRepaintEverything;
             if (refreshNeeded && CC_LIKELY(mBootStage != BootStage::BOOTLOADER)) {
                 // Signal a refresh if a transaction modified the window state,
@@ -1573,7 +1642,17 @@ void SurfaceFlinger::onMessageReceived(int32_t what) {
             break;
         }
         case MessageQueue::REFRESH: {
+            const nsecs_t refreshStart = systemTime();
             handleMessageRefresh();
+            // Feed the frame's measured main-thread cost back into the
+            // offset selection, so persistent overruns move the wakeup
+            // earlier in the vsync interval instead of silently missing
+            // the HWC deadline.
+            const nsecs_t frameCpuDuration =
+                    mLastInvalidateDuration + (systemTime() - refreshStart);
+            mVsyncModulator.onFrameCpuDuration(frameCpuDuration);
+            getHwComposer().getPowerAdvisor().notifyFrameEnd(frameCpuDuration,
+                                                             mPrimaryDispSync.getPeriod());
             break;
         }
     }
@@ -1620,6 +1699,58 @@ void SurfaceFlinger::handleMessageRefresh() {
     mVsyncModulator.onRefreshed(mHadClientComposition);
 
     mLayersWithQueuedFrames.clear();
+
+    // Run any screenshot requests that were deferred because this refresh
+    // was pending. If a new invalidate has already arrived they will simply
+    // defer themselves again.
+    if (CC_UNLIKELY(!mDeferredScreenshots.empty())) {
+        for (const auto& screenshot : mDeferredScreenshots) {
+            postMessageAsync(screenshot);
+        }
+        mDeferredScreenshots.clear();
+    }
+
+    updateDumpSnapshot();
+}
+
+void SurfaceFlinger::updateDumpSnapshot() {
+    auto snapshot = std::make_shared<DumpSnapshot>();
+    const auto previous = std::atomic_load_explicit(&mDumpSnapshot, std::memory_order_relaxed);
+    if (mDumpLayerListDirty || previous == nullptr) {
+        mDrawingState.traverseInZOrder([&](Layer* layer) {
+            snapshot->layerList.appendFormat("%s\n", layer->getName().string());
+        });
+        mDumpLayerListDirty = false;
+    } else {
+        // String8 shares its buffer on copy, so reusing the previous list is
+        // cheap when the layer set hasn't changed.
+        snapshot->layerList = previous->layerList;
+    }
+    snapshot->numLayers = mNumLayers;
+    snapshot->lastSwapBufferTime = mLastSwapBufferTime;
+    snapshot->lastTransactionTime = mLastTransactionTime;
+    snapshot->lastFrameHadClientComposition = mHadClientComposition;
+    snapshot->publishTime = systemTime();
+    std::atomic_store_explicit(&mDumpSnapshot,
+                               std::shared_ptr<const DumpSnapshot>(std::move(snapshot)),
+                               std::memory_order_release);
+
+    const uint64_t refreshSequence = mRefreshSequence.fetch_add(1, std::memory_order_relaxed) + 1;
+    if (systemTime() < mLayerDebugSnapshotArmedUntil.load(std::memory_order_relaxed)) {
+        // A getLayerDebugInfo() caller polled recently: publish the per-layer
+        // debug state of the hierarchy committed this frame. The drawing
+        // state is owned by this thread, so no lock is needed to walk it.
+        auto layerSnapshot = std::make_shared<LayerDebugSnapshot>();
+        layerSnapshot->layers.reserve(mNumLayers);
+        mDrawingState.traverseInZOrder([&](Layer* layer) {
+            layerSnapshot->layers.push_back(layer->getLayerDebugInfo());
+        });
+        layerSnapshot->refreshSequence = refreshSequence;
+        std::atomic_store_explicit(&mLayerDebugSnapshot,
+                                   std::shared_ptr<const LayerDebugSnapshot>(
+                                           std::move(layerSnapshot)),
+                                   std::memory_order_release);
+    }
 }
 
 void SurfaceFlinger::doDebugFlashRegions()
@@ -1636,7 +1767,7 @@ void SurfaceFlinger::doDebugFlashRegions()
             const Region dirtyRegion(hw->getDirtyRegion(repaintEverything));
             if (!dirtyRegion.isEmpty()) {
                 // redraw the whole screen
-                doComposeSurfaces(hw);
+                doComposeSurfaces(hw, dirtyRegion);
 
                 // and draw the dirty region
                 const int32_t height = hw->getHeight();
@@ -1678,7 +1809,7 @@ void SurfaceFlinger::doTracing(const char* where) {
 
 void SurfaceFlinger::logLayerStats() {
     ATRACE_CALL();
-    if (CC_UNLIKELY(mLayerStats.isEnabled())) {
+    if (CC_UNLIKELY(mLayerStats.shouldSampleFrame())) {
         int32_t hwcId = -1;
         for (size_t dpy = 0; dpy < mDisplays.size(); ++dpy) {
             const sp<const DisplayDevice>& displayDevice(mDisplays[dpy]);
@@ -1858,6 +1989,14 @@ void SurfaceFlinger::postComposition(nsecs_t refreshStartTime)
         mTimeStats.incrementClientCompositionFrames();
     }
 
+    // Reap any timer query results that have become available. The duration
+    // belongs to a composition pass from a few frames ago, which is fine for
+    // the aggregate stats this feeds.
+    const nsecs_t gpuCompositionTime = getRenderEngine().takeGpuFrameTime();
+    if (gpuCompositionTime >= 0) {
+        mTimeStats.recordGpuCompositionTime(gpuCompositionTime);
+    }
+
     if (getBE().mHwc->isConnected(HWC_DISPLAY_PRIMARY) &&
             hw->getPowerMode() == HWC_POWER_MODE_OFF) {
         return;
@@ -1954,6 +2093,15 @@ void SurfaceFlinger::rebuildLayerStacks() {
                     tr.transform(opaqueRegion));
             displayDevice->dirtyRegion.orSelf(dirtyRegion);
         }
+
+        // Drop visible-region cache entries for displays that are gone
+        for (auto it = mVisibleRegionCache.begin(); it != mVisibleRegionCache.end();) {
+            if (mDisplays.indexOfKey(it->first) < 0) {
+                it = mVisibleRegionCache.erase(it);
+            } else {
+                ++it;
+            }
+        }
     }
 }
 
@@ -2183,6 +2331,11 @@ void SurfaceFlinger::postFramebuffer()
     const nsecs_t now = systemTime();
     mDebugInSwapBuffers = now;
 
+    // Issue the present for every display back to back before doing any
+    // CPU-side bookkeeping. The release fences are stored per-display in
+    // HWComposer and harvested below, so on multi-display devices a later
+    // display's scanout is not held up behind the fence distribution and
+    // EGL context switches for an earlier one.
     for (size_t displayId = 0; displayId < mDisplays.size(); ++displayId) {
         auto& displayDevice = mDisplays[displayId];
         if (!displayDevice->isDisplayOn()) {
@@ -2192,6 +2345,14 @@ void SurfaceFlinger::postFramebuffer()
         if (hwcId >= 0) {
             getBE().mHwc->presentAndGetReleaseFences(hwcId);
         }
+    }
+
+    for (size_t displayId = 0; displayId < mDisplays.size(); ++displayId) {
+        auto& displayDevice = mDisplays[displayId];
+        if (!displayDevice->isDisplayOn()) {
+            continue;
+        }
+        const auto hwcId = displayDevice->getHwcDisplayId();
         displayDevice->onSwapBuffersCompleted();
         displayDevice->makeCurrent();
         for (auto& layer : displayDevice->getVisibleLayersSortedByZ()) {
@@ -2259,6 +2420,10 @@ void SurfaceFlinger::handleTransaction(uint32_t transactionFlags)
     const nsecs_t now = systemTime();
     mDebugInTransaction = now;
 
+    // Frame boundary: move anything the binder threads staged since the
+    // last frame into mCurrentState before it is committed below.
+    flushStagedTransactionsLocked();
+
     // Here we're guaranteed that some transaction flags are set
     // so we can call handleTransactionLocked() unconditionally.
     // We call getTransactionFlags(), which will also clear the flags,
@@ -2415,6 +2580,14 @@ sp<DisplayDevice> SurfaceFlinger::setupNewDisplayDeviceInternal(
         nativeWindowSurface->preallocateBuffers();
     }
 
+    if (state.type < DisplayDevice::DISPLAY_VIRTUAL) {
+        // Pipeline framebuffer acquisition for GPU composition: after GLES
+        // queues a client target, the next slot is dequeued speculatively
+        // while the present is still in flight, so the next GPU-composited
+        // frame does not wait for a free framebuffer at its first draw call.
+        nativeWindowSurface->enableDequeueBufferPrefetch();
+    }
+
     ColorMode defaultColorMode = ColorMode::NATIVE;
     Dataspace defaultDataSpace = Dataspace::UNKNOWN;
     if (hasWideColorGamut) {
@@ -2678,6 +2851,7 @@ void SurfaceFlinger::handleTransactionLocked(uint32_t transactionFlags)
         mLayersAdded = false;
         // Layers have been added.
         mVisibleRegionsDirty = true;
+        mDumpLayerListDirty = true;
     }
 
     // some layers might have been removed, so
@@ -2685,6 +2859,7 @@ void SurfaceFlinger::handleTransactionLocked(uint32_t transactionFlags)
     if (mLayersRemoved) {
         mLayersRemoved = false;
         mVisibleRegionsDirty = true;
+        mDumpLayerListDirty = true;
         mDrawingState.traverseInZOrder([&](Layer* layer) {
             if (mLayersPendingRemoval.indexOf(layer) >= 0) {
                 // this layer is not visible anymore
@@ -2740,17 +2915,38 @@ void SurfaceFlinger::commitTransaction()
     mDrawingState.traverseInZOrder([](Layer* layer) {
         layer->commitChildList();
     });
+    // Traversal lists and geometry snapshots cached while the commit above
+    // was walking a partially updated drawing hierarchy must not outlive it.
+    Layer::invalidateTraversalCaches();
+    Layer::invalidateGeometryCaches();
     mTransactionPending = false;
     mAnimTransactionPending = false;
     mTransactionCV.broadcast();
 }
 
+// Returns whether two regions cover the exact same rects. Regions are kept
+// in canonical sorted-span form, so identical coverage means identical rect
+// arrays; a false negative here only costs a recomputation.
+static bool regionsIdentical(const Region& first, const Region& second) {
+    size_t firstCount = 0;
+    size_t secondCount = 0;
+    Rect const* firstRects = first.getArray(&firstCount);
+    Rect const* secondRects = second.getArray(&secondCount);
+    if (firstCount != secondCount) {
+        return false;
+    }
+    return memcmp(firstRects, secondRects, firstCount * sizeof(Rect)) == 0;
+}
+
 void SurfaceFlinger::computeVisibleRegions(const sp<const DisplayDevice>& displayDevice,
         Region& outDirtyRegion, Region& outOpaqueRegion)
 {
     ATRACE_CALL();
     ALOGV("computeVisibleRegions");
 
+    auto& displayCache = mVisibleRegionCache[displayDevice->getDisplayToken()];
+    std::unordered_set<int32_t> liveLayers;
+
     Region aboveOpaqueLayers;
     Region aboveCoveredLayers;
     Region dirty;
@@ -2765,6 +2961,9 @@ void SurfaceFlinger::computeVisibleRegions(const sp<const DisplayDevice>& displa
         if (!layer->belongsToDisplay(displayDevice->getLayerStack(), displayDevice->isPrimary()))
             return;
 
+        liveLayers.insert(layer->sequence);
+        VisibleRegionCacheEntry& cached = displayCache[layer->sequence];
+
         /*
          * opaqueRegion: area of a surface that is fully opaque.
          */
@@ -2794,38 +2993,82 @@ void SurfaceFlinger::computeVisibleRegions(const sp<const DisplayDevice>& displa
          */
         Region transparentRegion;
 
-
-        // handle hidden surfaces by setting the visible region to empty
-        if (CC_LIKELY(layer->isVisible())) {
+        // Gather the inputs this layer's coverage depends on. These are all
+        // cheap to compute; the expensive part is the Region arithmetic
+        // below, which the cache lets us skip.
+        const bool visible = CC_LIKELY(layer->isVisible());
+        Rect bounds(Rect::EMPTY_RECT);
+        bool opaque = false;
+        if (visible) {
             const bool translucent = !layer->isOpaque(s);
-            Rect bounds(layer->computeScreenBounds());
-            visibleRegion.set(bounds);
+            bounds = layer->computeScreenBounds();
             Transform tr = layer->getTransform();
-            if (!visibleRegion.isEmpty()) {
+            if (!bounds.isEmpty()) {
                 // Remove the transparent area from the visible region
-                if (translucent) {
-                    if (tr.preserveRects()) {
-                        // transform the transparent region
-                        transparentRegion = tr.transform(s.activeTransparentRegion);
-                    } else {
-                        // transformation too complex, can't do the
-                        // transparent region optimization.
-                        transparentRegion.clear();
-                    }
+                if (translucent && tr.preserveRects()) {
+                    // transform the transparent region
+                    transparentRegion = tr.transform(s.activeTransparentRegion);
                 }
+                // If the transformation is too complex, we can't do the
+                // transparent region optimization and leave it empty.
 
                 // compute the opaque region
                 const int32_t layerOrientation = tr.getOrientation();
                 if (layer->getAlpha() == 1.0f && !translucent &&
                         ((layerOrientation & Transform::ROT_INVALID) == false)) {
                     // the opaque region is the layer's footprint
-                    opaqueRegion = visibleRegion;
+                    opaque = true;
                 }
             }
         }
 
+        if (cached.valid && visible == cached.visible && bounds == cached.bounds &&
+                opaque == cached.opaque &&
+                regionsIdentical(transparentRegion, cached.transparentRegion) &&
+                regionsIdentical(aboveCoveredLayers, cached.aboveCovered) &&
+                regionsIdentical(aboveOpaqueLayers, cached.aboveOpaque)) {
+            // Neither this layer's coverage inputs nor the occlusion above
+            // it changed, so the regions stored on the layer are still
+            // exact; just replay its contribution to the accumulators. The
+            // layer dirties the screen only if its content changed, in
+            // which case its whole visible region is invalidated.
+            if (!visible || bounds.isEmpty()) {
+                return;
+            }
+            if (layer->contentDirty) {
+                outDirtyRegion.orSelf(cached.visibleRegion);
+                layer->contentDirty = false;
+            }
+            aboveCoveredLayers.orSelf(Region(bounds));
+            if (opaque) {
+                aboveOpaqueLayers.orSelf(Region(bounds));
+            }
+            return;
+        }
+
+        // Snapshot the inputs before the accumulators are updated, so the
+        // next pass can tell whether this layer's coverage could have
+        // changed.
+        cached.valid = true;
+        cached.visible = visible;
+        cached.bounds = bounds;
+        cached.opaque = opaque;
+        cached.transparentRegion = transparentRegion;
+        cached.aboveCovered = aboveCoveredLayers;
+        cached.aboveOpaque = aboveOpaqueLayers;
+
+        // handle hidden surfaces by setting the visible region to empty
+        if (visible) {
+            visibleRegion.set(bounds);
+            if (!visibleRegion.isEmpty() && opaque) {
+                // the opaque region is the layer's footprint
+                opaqueRegion = visibleRegion;
+            }
+        }
+
         if (visibleRegion.isEmpty()) {
             layer->clearVisibilityRegions();
+            cached.visibleRegion.clear();
             return;
         }
 
@@ -2877,8 +3120,18 @@ void SurfaceFlinger::computeVisibleRegions(const sp<const DisplayDevice>& displa
         layer->setCoveredRegion(coveredRegion);
         layer->setVisibleNonTransparentRegion(
                 visibleRegion.subtract(transparentRegion));
+        cached.visibleRegion = visibleRegion;
     });
 
+    // Drop cache entries for layers that left this display's stack
+    for (auto it = displayCache.begin(); it != displayCache.end();) {
+        if (liveLayers.count(it->first) == 0) {
+            it = displayCache.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
     outOpaqueRegion = aboveOpaqueLayers;
 }
 
@@ -2923,12 +3176,19 @@ bool SurfaceFlinger::handlePageFlip()
         }
     });
 
-    for (auto& layer : mLayersWithQueuedFrames) {
-        const Region dirty(layer->latchBuffer(visibleRegions, latchTime));
+    latchQueuedLayers(latchTime, &visibleRegions);
+
+    for (size_t i = 0; i < mLayersWithQueuedFrames.size(); i++) {
+        const auto& layer = mLayersWithQueuedFrames[i];
         layer->useSurfaceDamage();
-        invalidateLayerStack(layer, dirty);
+        invalidateLayerStack(layer, mLatchDirtyRegions[i]);
         if (layer->isBufferLatched()) {
             newDataLatched = true;
+            // Get the EGL work for the new buffer (EGLImage creation and the
+            // acquire-fence wait) out of the way here, rather than stalling
+            // bindTextureImage in the middle of client composition. For
+            // recycled buffer slots this is a no-op.
+            layer->prepareTextureImage();
         }
     }
 
@@ -2951,6 +3211,114 @@ bool SurfaceFlinger::handlePageFlip()
     return !mLayersWithQueuedFrames.empty() && newDataLatched;
 }
 
+void SurfaceFlinger::latchQueuedLayers(nsecs_t latchTime, bool* outVisibleRegions) {
+    ATRACE_CALL();
+
+    const size_t layerCount = mLayersWithQueuedFrames.size();
+    mLatchDirtyRegions.clear();
+    mLatchDirtyRegions.resize(layerCount);
+
+    // The latch path only sheds its EGL work when native fence sync lets
+    // the outgoing buffers' release fence be created up front, so fall back
+    // to latching serially otherwise, or when the batch is too small to be
+    // worth the handoff.
+    sp<Fence> flushFence;
+    if (layerCount >= kMinLayersForParallelLatch &&
+        SyncFeatures::getInstance().useNativeFenceSync()) {
+        // A single flush fences every outgoing buffer, since all reads of
+        // them were issued on this context before this point.
+        base::unique_fd fenceFd = getRenderEngine().flush();
+        if (fenceFd >= 0) {
+            flushFence = new Fence(std::move(fenceFd));
+        }
+    }
+
+    if (flushFence == nullptr) {
+        for (size_t i = 0; i < layerCount; i++) {
+            bool recomputeVisibleRegions = false;
+            mLatchDirtyRegions[i] =
+                    mLayersWithQueuedFrames[i]->latchBuffer(recomputeVisibleRegions, latchTime);
+            if (recomputeVisibleRegions) {
+                *outVisibleRegions = true;
+            }
+        }
+        return;
+    }
+
+    if (mLatchWorkers.empty()) {
+        const size_t maxWorkers = kMaxLatchWorkers;
+        size_t workerCount = std::thread::hardware_concurrency();
+        workerCount = workerCount > 1 ? std::min(workerCount - 1, maxWorkers) : 1;
+        for (size_t i = 0; i < workerCount; i++) {
+            mLatchWorkers.push_back(std::thread(&SurfaceFlinger::latchWorkerLoop, this, i + 1));
+            pthread_setname_np(mLatchWorkers.back().native_handle(), "LatchWorker");
+            pid_t tid = pthread_gettid_np(mLatchWorkers.back().native_handle());
+            setpriority(PRIO_PROCESS, tid, ANDROID_PRIORITY_URGENT_DISPLAY);
+            set_sched_policy(tid, SP_FOREGROUND);
+        }
+    }
+
+    mLatchWorkLatchTime = latchTime;
+    mLatchWorkFlushFence = flushFence;
+    mLatchWorkVisibleRegions = false;
+    {
+        std::lock_guard<std::mutex> lock(mLatchWorkMutex);
+        mLatchWorkRemaining = mLatchWorkers.size() + 1;
+        mLatchWorkGeneration++;
+    }
+    mLatchWorkCondition.notify_all();
+
+    // The main thread owns stripe 0 and drains it rather than just waiting
+    // for the workers.
+    runLatchWorkStripe(0);
+
+    {
+        std::unique_lock<std::mutex> lock(mLatchWorkMutex);
+        mLatchWorkCondition.wait(lock, [this] { return mLatchWorkRemaining == 0; });
+    }
+
+    mLatchWorkFlushFence.clear();
+    if (mLatchWorkVisibleRegions) {
+        *outVisibleRegions = true;
+    }
+}
+
+void SurfaceFlinger::latchWorkerLoop(size_t stripeIndex) {
+    uint64_t lastGeneration = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mLatchWorkMutex);
+            mLatchWorkCondition.wait(lock, [&] {
+                return mLatchWorkersShutdown || mLatchWorkGeneration != lastGeneration;
+            });
+            if (mLatchWorkersShutdown) {
+                return;
+            }
+            lastGeneration = mLatchWorkGeneration;
+        }
+        runLatchWorkStripe(stripeIndex);
+    }
+}
+
+void SurfaceFlinger::runLatchWorkStripe(size_t stripeIndex) {
+    const size_t stride = mLatchWorkers.size() + 1;
+    const size_t layerCount = mLayersWithQueuedFrames.size();
+    for (size_t i = stripeIndex; i < layerCount; i += stride) {
+        bool recomputeVisibleRegions = false;
+        mLatchDirtyRegions[i] = mLayersWithQueuedFrames[i]->latchBuffer(recomputeVisibleRegions,
+                                                                       mLatchWorkLatchTime,
+                                                                       mLatchWorkFlushFence);
+        if (recomputeVisibleRegions) {
+            mLatchWorkVisibleRegions = true;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mLatchWorkMutex);
+    if (--mLatchWorkRemaining == 0) {
+        mLatchWorkCondition.notify_all();
+    }
+}
+
 void SurfaceFlinger::invalidateHwcGeometry()
 {
     mGeometryInvalid = true;
@@ -2972,17 +3340,21 @@ void SurfaceFlinger::doDisplayComposition(
     }
 
     ALOGV("doDisplayComposition");
-    if (!doComposeSurfaces(displayDevice)) return;
+    if (!doComposeSurfaces(displayDevice, inDirtyRegion)) return;
 
     // swap buffers (presentation)
     displayDevice->swapBuffers(getHwComposer());
 }
 
-bool SurfaceFlinger::doComposeSurfaces(const sp<const DisplayDevice>& displayDevice)
+bool SurfaceFlinger::doComposeSurfaces(const sp<const DisplayDevice>& displayDevice,
+                                       const Region& dirtyRegion)
 {
     ALOGV("doComposeSurfaces");
 
     const Region bounds(displayDevice->bounds());
+    // Narrowed down to the accumulated damage when the buffer age allows a
+    // partial repaint; layers entirely outside of it are skipped below.
+    Region repaintRegion(bounds);
     const DisplayRenderArea renderArea(displayDevice);
     const auto hwcId = displayDevice->getHwcDisplayId();
     const bool hasClientComposition = getBE().mHwc->hasClientComposition(hwcId);
@@ -2991,6 +3363,10 @@ bool SurfaceFlinger::doComposeSurfaces(const sp<const DisplayDevice>& displayDev
     bool applyColorMatrix = false;
     bool needsEnhancedColorMatrix = false;
 
+    // Number of layers at the bottom of the z-order whose composition is
+    // replaced by StaticLayerCache's cached quad this frame.
+    size_t cachedLayers = 0;
+
     if (hasClientComposition) {
         ALOGV("hasClientComposition");
 
@@ -3024,6 +3400,28 @@ bool SurfaceFlinger::doComposeSurfaces(const sp<const DisplayDevice>& displayDev
 
         getRenderEngine().setupColorTransform(colorMatrix);
 
+        // Fingerprint everything that affects the client target outside of
+        // the tracked content damage: which layers are client composited and
+        // the color transform applied on top. When any of it changes, the
+        // contents of the previous buffers cannot be reused and
+        // getPartialRepaintRegion() falls back to a full repaint.
+        uint64_t fingerprint = 14695981039346656037ull;
+        auto mixIn = [&fingerprint](uint64_t value) {
+            fingerprint = (fingerprint ^ value) * 1099511628211ull;
+        };
+        mixIn(static_cast<uint64_t>(outputDataspace));
+        for (auto& layer : displayDevice->getVisibleLayersSortedByZ()) {
+            mixIn(static_cast<uint64_t>(layer->sequence));
+            mixIn(static_cast<uint64_t>(layer->getCompositionType(hwcId)));
+        }
+        for (size_t i = 0; i < 4; i++) {
+            for (size_t j = 0; j < 4; j++) {
+                uint32_t valueBits;
+                memcpy(&valueBits, &colorMatrix[i][j], sizeof(valueBits));
+                mixIn(valueBits);
+            }
+        }
+
         if (!displayDevice->makeCurrent()) {
             ALOGW("DisplayDevice::makeCurrent failed. Aborting surface composition for display %s",
                   displayDevice->getDisplayName().string());
@@ -3036,6 +3434,39 @@ bool SurfaceFlinger::doComposeSurfaces(const sp<const DisplayDevice>& displayDev
             return false;
         }
 
+        // Time the GPU work of this pass, including any cache update renders
+        // below; the result is reaped in postComposition a few frames later.
+        getRenderEngine().beginGpuFrameTimer();
+
+        if (mStaticLayerCache.isEnabled()) {
+            // May render the cached run offscreen with its own projection,
+            // output data space and (identity) color transform; restore all
+            // of them before anything is drawn to the framebuffer.
+            cachedLayers = mStaticLayerCache.update(getRenderEngine(), displayDevice, hwcId);
+            displayDevice->setViewportAndProjection();
+            getBE().mRenderEngine->setOutputDataSpace(outputDataspace);
+            getRenderEngine().setupColorTransform(colorMatrix);
+        }
+
+        repaintRegion = displayDevice->getPartialRepaintRegion(dirtyRegion, fingerprint);
+
+        // Set up the scissor before any clearing, so that a partial repaint
+        // never touches the pixels the buffer is carrying over from a
+        // previous frame. This also covers the legacy case where the display
+        // scissor doesn't match the screen's dimensions and everything
+        // outside of it must be left untouched.
+        const Rect& frameBounds(displayDevice->getBounds());
+        Rect scissorRect;
+        if (!displayDevice->getScissor().intersect(repaintRegion.getBounds(), &scissorRect)) {
+            scissorRect = Rect(0, 0);
+        }
+        if (scissorRect != frameBounds) {
+            // enable scissor for this frame
+            const uint32_t height = displayDevice->getHeight();
+            getBE().mRenderEngine->setScissor(scissorRect.left, height - scissorRect.bottom,
+                                              scissorRect.getWidth(), scissorRect.getHeight());
+        }
+
         // Never touch the framebuffer if we don't have any framebuffer layers
         if (hasDeviceComposition) {
             // when using overlays, we assume a fully transparent framebuffer
@@ -3059,19 +3490,6 @@ bool SurfaceFlinger::doComposeSurfaces(const sp<const DisplayDevice>& displayDev
                 drawWormhole(displayDevice, region);
             }
         }
-
-        const Rect& bounds(displayDevice->getBounds());
-        const Rect& scissor(displayDevice->getScissor());
-        if (scissor != bounds) {
-            // scissor doesn't match the screen's dimensions, so we
-            // need to clear everything outside of it and enable
-            // the GL scissor so we don't draw anything where we shouldn't
-
-            // enable scissor for this frame
-            const uint32_t height = displayDevice->getHeight();
-            getBE().mRenderEngine->setScissor(scissor.left, height - scissor.bottom,
-                                              scissor.getWidth(), scissor.getHeight());
-        }
     }
 
     /*
@@ -3081,8 +3499,19 @@ bool SurfaceFlinger::doComposeSurfaces(const sp<const DisplayDevice>& displayDev
     ALOGV("Rendering client layers");
     const Transform& displayTransform = displayDevice->getTransform();
     bool firstLayer = true;
+    size_t layerIndex = 0;
     for (auto& layer : displayDevice->getVisibleLayersSortedByZ()) {
-        const Region clip(bounds.intersect(
+        if (layerIndex++ < cachedLayers) {
+            // The bottom of the z-order is composited from the cache; the
+            // quad replaces the first cached layer and stands in for the
+            // rest. The scissor set up for a partial repaint still applies.
+            if (firstLayer) {
+                mStaticLayerCache.draw(getRenderEngine(), displayDevice);
+            }
+            firstLayer = false;
+            continue;
+        }
+        const Region clip(repaintRegion.intersect(
                 displayTransform.transform(layer->visibleRegion)));
         ALOGV("Layer: %s", layer->getName().string());
         ALOGV("  Composition type: %s",
@@ -3122,6 +3551,10 @@ bool SurfaceFlinger::doComposeSurfaces(const sp<const DisplayDevice>& displayDev
 
     // disable scissor at the end of the frame
     getBE().mRenderEngine->disableScissor();
+
+    if (hasClientComposition) {
+        getRenderEngine().endGpuFrameTimer();
+    }
     return true;
 }
 
@@ -3140,31 +3573,10 @@ status_t SurfaceFlinger::addClientLayer(const sp<Client>& client,
     // add this layer to the current state list
     {
         Mutex::Autolock _l(mStateLock);
-        if (mNumLayers >= MAX_LAYERS) {
-            ALOGE("AddClientLayer failed, mNumLayers (%zu) >= MAX_LAYERS (%zu)", mNumLayers,
-                  MAX_LAYERS);
-            return NO_MEMORY;
-        }
-        if (parent == nullptr) {
-            mCurrentState.layersSortedByZ.add(lbc);
-        } else {
-            if (parent->isPendingRemoval()) {
-                ALOGE("addClientLayer called with a removed parent");
-                return NAME_NOT_FOUND;
-            }
-            parent->addChild(lbc);
-        }
-
-        if (gbc != nullptr) {
-            mGraphicBufferProducerList.insert(IInterface::asBinder(gbc).get());
-            LOG_ALWAYS_FATAL_IF(mGraphicBufferProducerList.size() >
-                                        mMaxGraphicBufferProducerListSize,
-                                "Suspected IGBP leak: %zu IGBPs (%zu max), %zu Layers",
-                                mGraphicBufferProducerList.size(),
-                                mMaxGraphicBufferProducerListSize, mNumLayers);
+        status_t result = addClientLayerLocked(mStateLock, gbc, lbc, parent);
+        if (result != NO_ERROR) {
+            return result;
         }
-        mLayersAdded = true;
-        mNumLayers++;
     }
 
     // attach this layer to the client
@@ -3173,6 +3585,39 @@ status_t SurfaceFlinger::addClientLayer(const sp<Client>& client,
     return NO_ERROR;
 }
 
+status_t SurfaceFlinger::addClientLayerLocked(const Mutex&,
+        const sp<IGraphicBufferProducer>& gbc,
+        const sp<Layer>& lbc,
+        const sp<Layer>& parent)
+{
+    if (mNumLayers >= MAX_LAYERS) {
+        ALOGE("AddClientLayer failed, mNumLayers (%zu) >= MAX_LAYERS (%zu)", mNumLayers,
+              MAX_LAYERS);
+        return NO_MEMORY;
+    }
+    if (parent == nullptr) {
+        mCurrentState.layersSortedByZ.add(lbc);
+    } else {
+        if (parent->isPendingRemoval()) {
+            ALOGE("addClientLayer called with a removed parent");
+            return NAME_NOT_FOUND;
+        }
+        parent->addChild(lbc);
+    }
+
+    if (gbc != nullptr) {
+        mGraphicBufferProducerList.insert(IInterface::asBinder(gbc).get());
+        LOG_ALWAYS_FATAL_IF(mGraphicBufferProducerList.size() >
+                                    mMaxGraphicBufferProducerListSize,
+                            "Suspected IGBP leak: %zu IGBPs (%zu max), %zu Layers",
+                            mGraphicBufferProducerList.size(),
+                            mMaxGraphicBufferProducerListSize, mNumLayers);
+    }
+    mLayersAdded = true;
+    mNumLayers++;
+    return NO_ERROR;
+}
+
 status_t SurfaceFlinger::removeLayer(const sp<Layer>& layer, bool topLevelOnly) {
     Mutex::Autolock _l(mStateLock);
     return removeLayerLocked(mStateLock, layer, topLevelOnly);
@@ -3277,13 +3722,29 @@ void SurfaceFlinger::setTransactionState(
         uint32_t flags)
 {
     ATRACE_CALL();
-    Mutex::Autolock _l(mStateLock);
-    uint32_t transactionFlags = 0;
 
     if (containsAnyInvalidClientState(states)) {
         return;
     }
 
+    if (!(flags & (eSynchronous | eAnimation))) {
+        // Asynchronous transactions are only staged here, after the client
+        // validation above; they are applied on the main thread at the next
+        // frame boundary (see handleTransaction). The caller never takes
+        // mStateLock and so never blocks behind in-flight composition.
+        {
+            std::lock_guard<std::mutex> lock(mStagedTransactionLock);
+            mStagedTransactions.push_back({states, displays, flags});
+        }
+        const auto start = (flags & eEarlyWakeup)
+                ? VSyncModulator::TransactionStart::EARLY
+                : VSyncModulator::TransactionStart::NORMAL;
+        setTransactionFlags(eTransactionNeeded, start);
+        return;
+    }
+
+    Mutex::Autolock _l(mStateLock);
+
     if (flags & eAnimation) {
         // For window updates that are part of an animation we must wait for
         // previous animation "frames" to be handled.
@@ -3300,6 +3761,40 @@ void SurfaceFlinger::setTransactionState(
         }
     }
 
+    // Apply anything staged ahead of us first, so that a synchronous
+    // transaction cannot overtake earlier asynchronous ones from the same
+    // caller.
+    flushStagedTransactionsLocked();
+
+    uint32_t transactionFlags = applyTransactionLocked(states, displays, flags);
+
+    if (transactionFlags) {
+        // if this is a synchronous transaction, wait for it to take effect
+        // before returning.
+        if (flags & eSynchronous) {
+            mTransactionPending = true;
+        }
+        if (flags & eAnimation) {
+            mAnimTransactionPending = true;
+        }
+        while (mTransactionPending) {
+            status_t err = mTransactionCV.waitRelative(mStateLock, s2ns(5));
+            if (CC_UNLIKELY(err != NO_ERROR)) {
+                // just in case something goes wrong in SF, return to the
+                // called after a few seconds.
+                ALOGW_IF(err == TIMED_OUT, "setTransactionState timed out!");
+                mTransactionPending = false;
+                break;
+            }
+        }
+    }
+}
+
+uint32_t SurfaceFlinger::applyTransactionLocked(const Vector<ComposerState>& states,
+                                                const Vector<DisplayState>& displays,
+                                                uint32_t flags) {
+    uint32_t transactionFlags = 0;
+
     for (const DisplayState& display : displays) {
         transactionFlags |= setDisplayStateLocked(display);
     }
@@ -3335,25 +3830,19 @@ void SurfaceFlinger::setTransactionState(
                 ? VSyncModulator::TransactionStart::EARLY
                 : VSyncModulator::TransactionStart::NORMAL;
         setTransactionFlags(transactionFlags, start);
+    }
 
-        // if this is a synchronous transaction, wait for it to take effect
-        // before returning.
-        if (flags & eSynchronous) {
-            mTransactionPending = true;
-        }
-        if (flags & eAnimation) {
-            mAnimTransactionPending = true;
-        }
-        while (mTransactionPending) {
-            status_t err = mTransactionCV.waitRelative(mStateLock, s2ns(5));
-            if (CC_UNLIKELY(err != NO_ERROR)) {
-                // just in case something goes wrong in SF, return to the
-                // called after a few seconds.
-                ALOGW_IF(err == TIMED_OUT, "setTransactionState timed out!");
-                mTransactionPending = false;
-                break;
-            }
-        }
+    return transactionFlags;
+}
+
+void SurfaceFlinger::flushStagedTransactionsLocked() {
+    std::vector<StagedTransaction> staged;
+    {
+        std::lock_guard<std::mutex> lock(mStagedTransactionLock);
+        staged.swap(mStagedTransactions);
+    }
+    for (const StagedTransaction& transaction : staged) {
+        applyTransactionLocked(transaction.states, transaction.displays, transaction.flags);
     }
 }
 
@@ -3673,6 +4162,110 @@ status_t SurfaceFlinger::createLayer(
     return result;
 }
 
+status_t SurfaceFlinger::createLayers(const sp<Client>& client,
+        const std::vector<ISurfaceComposerClient::SurfaceDescriptor>& descriptors,
+        const std::vector<sp<Layer>>& parents,
+        std::vector<ISurfaceComposerClient::CreatedSurface>* outResults)
+{
+    struct PendingLayer {
+        size_t index;
+        sp<Layer> layer;
+    };
+    std::vector<PendingLayer> pending;
+
+    // Phase 1: construct each layer without holding mStateLock, exactly as
+    // createLayer() does (getUniqueLayerName takes the lock briefly). A
+    // failed entry only fails itself; the rest of the batch proceeds.
+    for (size_t i = 0; i < descriptors.size(); i++) {
+        ISurfaceComposerClient::CreatedSurface& out = (*outResults)[i];
+        if (out.result != NO_INIT) {
+            // The Client already failed this entry (e.g. dead parent).
+            continue;
+        }
+        const ISurfaceComposerClient::SurfaceDescriptor& d = descriptors[i];
+        if (int32_t(d.width | d.height) < 0) {
+            ALOGE("createLayers() failed, w or h is negative (w=%d, h=%d)",
+                    int(d.width), int(d.height));
+            out.result = BAD_VALUE;
+            continue;
+        }
+
+        status_t result = NO_ERROR;
+        sp<Layer> layer;
+        String8 uniqueName = getUniqueLayerName(d.name);
+        PixelFormat format = d.format;
+
+        switch (d.flags & ISurfaceComposerClient::eFXSurfaceMask) {
+            case ISurfaceComposerClient::eFXSurfaceNormal:
+                result = createBufferLayer(client,
+                        uniqueName, d.width, d.height, d.flags, format,
+                        &out.handle, &out.gbp, &layer);
+                break;
+            case ISurfaceComposerClient::eFXSurfaceColor:
+                result = createColorLayer(client,
+                        uniqueName, d.width, d.height, d.flags,
+                        &out.handle, &layer);
+                break;
+            default:
+                result = BAD_VALUE;
+                break;
+        }
+
+        if (result != NO_ERROR) {
+            out.result = result;
+            continue;
+        }
+
+        // window type is WINDOW_TYPE_DONT_SCREENSHOT from SurfaceControl.java
+        // TODO b/64227542
+        int32_t windowType = d.windowType;
+        if (windowType == 441731) {
+            windowType = 2024; // TYPE_NAVIGATION_BAR_PANEL
+            layer->setPrimaryDisplayOnly();
+        }
+
+        layer->setInfo(windowType, d.ownerUid);
+
+        out.result = NO_ERROR;
+        pending.push_back({i, layer});
+    }
+
+    // Phase 2: insert every constructed layer into the current state under a
+    // single mStateLock acquisition.
+    bool addedAny = false;
+    {
+        Mutex::Autolock _l(mStateLock);
+        for (auto& p : pending) {
+            ISurfaceComposerClient::CreatedSurface& out = (*outResults)[p.index];
+            status_t result = addClientLayerLocked(mStateLock, out.gbp, p.layer,
+                                                   parents[p.index]);
+            if (result != NO_ERROR) {
+                out.result = result;
+                out.handle = nullptr;
+                out.gbp = nullptr;
+                p.layer = nullptr;
+            } else {
+                addedAny = true;
+            }
+        }
+    }
+
+    // Phase 3: attach to the client and record the creations outside the
+    // lock, matching the ordering of addClientLayer().
+    for (const auto& p : pending) {
+        if (p.layer == nullptr) {
+            continue;
+        }
+        client->attachLayer((*outResults)[p.index].handle, p.layer);
+        mInterceptor->saveSurfaceCreation(p.layer);
+    }
+
+    if (addedAny) {
+        setTransactionFlags(eTransactionNeeded);
+    }
+    return NO_ERROR;
+}
+
 String8 SurfaceFlinger::getUniqueLayerName(const String8& name)
 {
     bool matchFound = true;
@@ -3787,6 +4380,7 @@ void SurfaceFlinger::onInitializeDisplays() {
     const auto& activeConfig = getBE().mHwc->getActiveConfig(HWC_DISPLAY_PRIMARY);
     const nsecs_t period = activeConfig->getVsyncPeriod();
     mAnimFrameTracker.setDisplayRefreshPeriod(period);
+    mVsyncModulator.setDisplayRefreshPeriod(period);
 
     // Use phase of 0 since phase is not known.
     // Use latency of 0, which will snap to the ideal latency.
@@ -3939,6 +4533,30 @@ status_t SurfaceFlinger::doDump(int fd, const Vector<String16>& args, bool asPro
         result.appendFormat("Permission Denial: "
                 "can't dump SurfaceFlinger from pid=%d, uid=%d\n", pid, uid);
     } else {
+        // Serve the telemetry-friendly requests from the published snapshot
+        // first: these never touch mStateLock, so scraping them cannot
+        // interfere with the main thread. Fall through to the locked path if
+        // nothing has been published yet (i.e. before the first refresh).
+        if (args.size() == 1 &&
+                (args[0] == String16("--list") || args[0] == String16("--summary"))) {
+            const auto snapshot =
+                    std::atomic_load_explicit(&mDumpSnapshot, std::memory_order_acquire);
+            if (snapshot != nullptr) {
+                if (args[0] == String16("--summary")) {
+                    result.appendFormat("layers=%zu lastSwapBufferTime=%" PRId64
+                                        " ns lastTransactionTime=%" PRId64
+                                        " ns clientComposition=%d snapshotAge=%" PRId64 " ns\n",
+                                        snapshot->numLayers, snapshot->lastSwapBufferTime,
+                                        snapshot->lastTransactionTime,
+                                        snapshot->lastFrameHadClientComposition,
+                                        systemTime() - snapshot->publishTime);
+                }
+                result.append(snapshot->layerList);
+                write(fd, result.string(), result.size());
+                return NO_ERROR;
+            }
+        }
+
         // Try to get the main lock, but give up after one second
         // (this would indicate SF is stuck, but we want to be able to
         // print something in dumpsys).
@@ -3976,6 +4594,15 @@ status_t SurfaceFlinger::doDump(int fd, const Vector<String16>& args, bool asPro
                 dumpAll = false;
             }
 
+            if ((index < numArgs) &&
+                    (args[index] == String16("--summary"))) {
+                // Only reached when no snapshot has been published yet; the
+                // lock-free path above handles the common case.
+                index++;
+                result.append("no snapshot published yet\n");
+                dumpAll = false;
+            }
+
             if ((index < numArgs) &&
                     (args[index] == String16("--dispsync"))) {
                 index++;
@@ -4031,6 +4658,17 @@ status_t SurfaceFlinger::doDump(int fd, const Vector<String16>& args, bool asPro
                 dumpAll = false;
             }
 
+            if ((index < numArgs) &&
+                (args[index] == String16("--layer-stats-interval"))) {
+                index++;
+                if (index < numArgs) {
+                    mLayerStats.setSampleInterval(
+                            atoi(String8(args[index]).string()));
+                    index++;
+                }
+                dumpAll = false;
+            }
+
             if ((index < numArgs) && (args[index] == String16("--timestats"))) {
                 index++;
                 mTimeStats.parseArgs(asProto, args, index, result);
@@ -4336,6 +4974,10 @@ void SurfaceFlinger::dumpAllLocked(const Vector<String16>& args, size_t& index,
         dispSyncPresentTimeOffset, activeConfig->getVsyncPeriod());
     result.append("\n");
 
+    mVsyncModulator.dump(result);
+
+    getHwComposer().getPowerAdvisor().dump(result);
+
     // Dump static screen stats
     result.append("\n");
     dumpStaticScreenStats(result);
@@ -4383,6 +5025,8 @@ void SurfaceFlinger::dumpAllLocked(const Vector<String16>& args, size_t& index,
 
     getBE().mRenderEngine->dump(result);
 
+    mStaticLayerCache.dump(result);
+
     if (hw) {
         hw->undefinedRegion.dump(result, "undefinedRegion");
         result.appendFormat("  orientation=%d, isDisplayOn=%d\n",
@@ -4905,7 +5549,7 @@ status_t SurfaceFlinger::captureLayers(const sp<IBinder>& layerHandleBinder,
 
         void render(std::function<void()> drawLayers) override {
             if (!mChildrenOnly) {
-                mTransform = mLayer->getTransform().inverse();
+                mTransform = mLayer->getInverseTransform();
                 drawLayers();
             } else {
                 Rect bounds = getBounds();
@@ -5000,13 +5644,14 @@ status_t SurfaceFlinger::captureScreenCommon(RenderArea& renderArea,
     const bool forSystem = uid == AID_GRAPHICS || uid == AID_SYSTEM;
 
     sp<LambdaMessage> message = new LambdaMessage([&]() {
-        // If there is a refresh pending, bug out early and tell the binder thread to try again
-        // after the refresh.
+        // If there is a refresh pending, defer the capture until right after it completes
+        // instead of bouncing back to the binder thread: handleMessageRefresh reposts the
+        // deferred message, so the render lands in the idle slot behind the frame rather
+        // than competing with it and waking the binder thread for nothing. The binder
+        // thread stays blocked on captureCondition, so the captured state remains valid.
         if (mRefreshPending) {
-            ATRACE_NAME("Skipping screenshot for now");
-            std::unique_lock<std::mutex> captureLock(captureMutex);
-            captureResult = std::make_optional<status_t>(EAGAIN);
-            captureCondition.notify_one();
+            ATRACE_NAME("Deferring screenshot");
+            mDeferredScreenshots.push_back(message);
             return;
         }
 
@@ -5031,14 +5676,6 @@ status_t SurfaceFlinger::captureScreenCommon(RenderArea& renderArea,
     status_t result = postMessageAsync(message);
     if (result == NO_ERROR) {
         captureCondition.wait(captureLock, [&]() { return captureResult; });
-        while (*captureResult == EAGAIN) {
-            captureResult.reset();
-            result = postMessageAsync(message);
-            if (result != NO_ERROR) {
-                return result;
-            }
-            captureCondition.wait(captureLock, [&]() { return captureResult; });
-        }
         result = *captureResult;
     }
 
@@ -60,6 +60,7 @@
 #include "LayerStats.h"
 #include "LayerVector.h"
 #include "MessageQueue.h"
+#include "StaticLayerCache.h"
 #include "SurfaceInterceptor.h"
 #include "SurfaceTracing.h"
 #include "StartPropertySetThread.h"
@@ -71,11 +72,14 @@
 
 #include "Effects/Daltonizer.h"
 
+#include <atomic>
+#include <condition_variable>
 #include <map>
 #include <mutex>
 #include <queue>
 #include <string>
 #include <thread>
+#include <unordered_map>
 #include <utility>
 #include "RenderArea.h"
 
@@ -141,6 +145,11 @@ public:
 
     // Indicates that the surface should allocate its buffers now.
     virtual void preallocateBuffers() = 0;
+
+    // Asks the surface to speculatively dequeue the next buffer slot each
+    // time one is queued, so the dequeue at the start of the next frame's
+    // rendering does not wait for a free buffer on the critical path.
+    virtual void enableDequeueBufferPrefetch() = 0;
 };
 
 class SurfaceFlingerBE
@@ -420,7 +429,8 @@ private:
     virtual status_t getSupportedFrameTimestamps(
             std::vector<FrameEvent>* outSupported) const;
     virtual sp<IDisplayEventConnection> createDisplayEventConnection(
-            ISurfaceComposer::VsyncSource vsyncSource = eVsyncSourceApp);
+            ISurfaceComposer::VsyncSource vsyncSource = eVsyncSourceApp, uint32_t vsyncRate = 0,
+            uint32_t vsyncPhase = 0);
     virtual status_t captureScreen(const sp<IBinder>& display, sp<GraphicBuffer>* outBuffer,
                                    Rect sourceCrop, uint32_t reqWidth, uint32_t reqHeight,
                                    int32_t minLayerZ, int32_t maxLayerZ, bool useIdentityTransform,
@@ -510,6 +520,24 @@ private:
      */
     bool handlePageFlip();
 
+    /* latchQueuedLayers - latch every layer in mLayersWithQueuedFrames,
+     * storing the per-layer dirty regions in mLatchDirtyRegions. With enough
+     * layers the latches are fanned out over the latch worker pool; the EGL
+     * work the latch path needs (flushing RenderEngine for the outgoing
+     * buffers' release fence) is performed once on the main thread before
+     * the workers start.
+     */
+    void latchQueuedLayers(nsecs_t latchTime, bool* outVisibleRegions);
+
+    // Main loop of a latch worker thread: wait for a new batch of work to be
+    // published, then drain the worker's stripe of it.
+    void latchWorkerLoop(size_t stripeIndex);
+
+    // Latches every layer of the current batch whose index falls in the
+    // given stripe. Called from both the worker threads and the main thread
+    // (which owns stripe 0).
+    void runLatchWorkStripe(size_t stripeIndex);
+
     /* ------------------------------------------------------------------------
      * Transactions
      */
@@ -523,6 +551,9 @@ private:
     uint32_t setClientStateLocked(const ComposerState& composerState);
     uint32_t setDisplayStateLocked(const DisplayState& s);
     void setDestroyStateLocked(const ComposerState& composerState);
+    uint32_t applyTransactionLocked(const Vector<ComposerState>& states,
+                                    const Vector<DisplayState>& displays, uint32_t flags);
+    void flushStagedTransactionsLocked();
 
     /* ------------------------------------------------------------------------
      * Layer management
@@ -532,6 +563,15 @@ private:
             int32_t windowType, int32_t ownerUid, sp<IBinder>* handle,
             sp<IGraphicBufferProducer>* gbp, sp<Layer>* parent);
 
+    // Batched variant of createLayer(). All layers are constructed first,
+    // then inserted into the current state under a single mStateLock
+    // acquisition. Entries whose result is already set are skipped; parents
+    // holds the resolved parent (or nullptr) for each descriptor.
+    status_t createLayers(const sp<Client>& client,
+            const std::vector<ISurfaceComposerClient::SurfaceDescriptor>& descriptors,
+            const std::vector<sp<Layer>>& parents,
+            std::vector<ISurfaceComposerClient::CreatedSurface>* outResults);
+
     status_t createBufferLayer(const sp<Client>& client, const String8& name,
             uint32_t w, uint32_t h, uint32_t flags, PixelFormat& format,
             sp<IBinder>* outHandle, sp<IGraphicBufferProducer>* outGbp,
@@ -562,6 +602,10 @@ private:
             const sp<IGraphicBufferProducer>& gbc,
             const sp<Layer>& lbc,
             const sp<Layer>& parent);
+    status_t addClientLayerLocked(const Mutex&,
+            const sp<IGraphicBufferProducer>& gbc,
+            const sp<Layer>& lbc,
+            const sp<Layer>& parent);
 
     /* ------------------------------------------------------------------------
      * Boot animation, on/off animations and screen capture
@@ -651,6 +695,28 @@ private:
     void computeVisibleRegions(const sp<const DisplayDevice>& displayDevice,
             Region& dirtyRegion, Region& opaqueRegion);
 
+    // Cached per-layer results of computeVisibleRegions. A layer whose
+    // coverage inputs (screen bounds, opaqueness, transparent region) and
+    // incoming occlusion accumulators are unchanged since the last pass
+    // keeps its stored visible region instead of redoing the Region
+    // arithmetic, so a single moved layer no longer costs a full
+    // O(layers^2) recomputation. Keyed by display token, then by layer
+    // sequence number; stale entries are pruned after each pass.
+    struct VisibleRegionCacheEntry {
+        bool valid = false;
+        // Inputs the layer's coverage depends on
+        Region aboveCovered;
+        Region aboveOpaque;
+        Rect bounds = Rect::EMPTY_RECT;
+        Region transparentRegion;
+        bool visible = false;
+        bool opaque = false;
+        // Output: the layer's visible region from the last pass
+        Region visibleRegion;
+    };
+    std::map<wp<IBinder>, std::unordered_map<int32_t, VisibleRegionCacheEntry>>
+            mVisibleRegionCache;
+
     void preComposition(nsecs_t refreshStartTime);
     void postComposition(nsecs_t refreshStartTime);
     void updateCompositorTiming(
@@ -681,7 +747,8 @@ private:
 
     // compose surfaces for display hw. this fails if using GL and the surface
     // has been destroyed and is no longer valid.
-    bool doComposeSurfaces(const sp<const DisplayDevice>& displayDevice);
+    bool doComposeSurfaces(const sp<const DisplayDevice>& displayDevice,
+                           const Region& dirtyRegion);
 
     void postFramebuffer();
     void drawWormhole(const sp<const DisplayDevice>& displayDevice, const Region& region) const;
@@ -750,6 +817,32 @@ private:
     }
     status_t doDump(int fd, const Vector<String16>& args, bool asProto);
 
+    // Immutable snapshot of the cheap dump state, republished by the main
+    // thread after every refresh and read lock-free by doDump. Telemetry that
+    // only needs this data (--list, --summary) never touches mStateLock and
+    // so can never delay a frame.
+    struct DumpSnapshot {
+        String8 layerList;
+        size_t numLayers = 0;
+        nsecs_t lastSwapBufferTime = 0;
+        nsecs_t lastTransactionTime = 0;
+        bool lastFrameHadClientComposition = false;
+        nsecs_t publishTime = 0;
+    };
+
+    // Immutable per-layer debug state published alongside DumpSnapshot while
+    // a getLayerDebugInfo() caller has polled recently. The refresh sequence
+    // lets readers tell "stale because the screen is idle" (state unchanged,
+    // snapshot still accurate) from "stale because publication was disarmed"
+    // (must fall back to the locked path).
+    struct LayerDebugSnapshot {
+        std::vector<LayerDebugInfo> layers;
+        uint64_t refreshSequence = 0;
+    };
+
+    // Called from the main thread at the end of every refresh.
+    void updateDumpSnapshot();
+
     /* ------------------------------------------------------------------------
      * VrFlinger
      */
@@ -773,6 +866,21 @@ private:
     bool mAnimTransactionPending;
     SortedVector< sp<Layer> > mLayersPendingRemoval;
 
+    // Asynchronous transactions are validated on the binder thread and then
+    // staged here rather than applied under mStateLock, so binder callers
+    // never contend with the main thread for the duration of a frame. The
+    // staged list is swapped out and applied at the next frame boundary, or
+    // by the next synchronous transaction so that one cannot overtake
+    // earlier asynchronous ones. mStagedTransactionLock is only ever held
+    // for the push or the swap, never across state application.
+    struct StagedTransaction {
+        Vector<ComposerState> states;
+        Vector<DisplayState> displays;
+        uint32_t flags;
+    };
+    std::mutex mStagedTransactionLock;
+    std::vector<StagedTransaction> mStagedTransactions;
+
     // global color transform states
     Daltonizer mDaltonizer;
     float mGlobalSaturationFactor = 1.0f;
@@ -813,6 +921,33 @@ private:
     sp<Fence> mPreviousPresentFence = Fence::NO_FENCE;
     bool mHadClientComposition = false;
 
+    // Latch worker pool, used by latchQueuedLayers to latch independent
+    // layers concurrently. The workers are started lazily the first time a
+    // frame has enough layers to fan out. Each participating thread owns a
+    // fixed stripe of mLayersWithQueuedFrames (stripe 0 belongs to the main
+    // thread), so no two threads ever touch the same layer. Batch state is
+    // published under mLatchWorkMutex before the workers are woken and is
+    // only read back once every stripe has drained.
+    static constexpr size_t kMinLayersForParallelLatch = 4;
+    static constexpr size_t kMaxLatchWorkers = 3;
+    std::vector<std::thread> mLatchWorkers;
+    std::mutex mLatchWorkMutex;
+    std::condition_variable mLatchWorkCondition;
+    // Incremented under mLatchWorkMutex to publish a new batch to the workers
+    uint64_t mLatchWorkGeneration = 0;
+    // Number of stripes of the current batch not yet drained, guarded by
+    // mLatchWorkMutex; the main thread waits for this to reach zero
+    size_t mLatchWorkRemaining = 0;
+    bool mLatchWorkersShutdown = false;
+    std::atomic<bool> mLatchWorkVisibleRegions{false};
+    // Inputs to the current batch: the latch timestamp and the release fence
+    // obtained from RenderEngine::flush() on the main thread
+    nsecs_t mLatchWorkLatchTime = 0;
+    sp<Fence> mLatchWorkFlushFence;
+    // Dirty region returned by each latched layer, indexed like
+    // mLayersWithQueuedFrames
+    std::vector<Region> mLatchDirtyRegions;
+
     enum class BootStage {
         BOOTLOADER,
         BOOTANIMATION,
@@ -840,12 +975,36 @@ private:
     nsecs_t mLastSwapBufferTime;
     volatile nsecs_t mDebugInTransaction;
     nsecs_t mLastTransactionTime;
+    // Main-thread cost of the last INVALIDATE (transaction handling plus
+    // latching); combined with the REFRESH cost and fed to the
+    // VSyncModulator for frame pacing.
+    nsecs_t mLastInvalidateDuration = 0;
     bool mForceFullDamage;
     bool mPropagateBackpressure = true;
+
+    // Published by the main thread in updateDumpSnapshot(), read with
+    // std::atomic_load from binder threads in doDump.
+    std::shared_ptr<const DumpSnapshot> mDumpSnapshot;
+    // Main thread only: set when the layer set changes so the next snapshot
+    // rebuilds its layer list.
+    bool mDumpLayerListDirty = true;
+
+    // Published by the main thread in updateDumpSnapshot() while armed, read
+    // with std::atomic_load from binder threads in getLayerDebugInfo().
+    // Publication is armed for a window after each query so that tooling
+    // polling layer state pays for snapshot construction instead of the main
+    // thread contending on mStateLock, and an idle system pays nothing.
+    std::shared_ptr<const LayerDebugSnapshot> mLayerDebugSnapshot;
+    mutable std::atomic<nsecs_t> mLayerDebugSnapshotArmedUntil{0};
+    // Incremented by the main thread at every refresh; snapshots record the
+    // value they were published under (see LayerDebugSnapshot).
+    std::atomic<uint64_t> mRefreshSequence{0};
+
     std::unique_ptr<SurfaceInterceptor> mInterceptor =
             std::make_unique<impl::SurfaceInterceptor>(this);
     SurfaceTracing mTracing;
     LayerStats mLayerStats;
+    StaticLayerCache mStaticLayerCache;
     TimeStats& mTimeStats = TimeStats::getInstance();
     bool mUseHwcVirtualDisplays = false;
 
@@ -869,6 +1028,12 @@ private:
 
     std::atomic<bool> mRefreshPending{false};
 
+    // Screenshot requests that arrived while a refresh was pending. They are
+    // reposted by handleMessageRefresh so the capture renders in the idle
+    // slot right behind the frame instead of competing with it. Only
+    // accessed from the main thread, so no lock is needed.
+    std::vector<sp<MessageBase>> mDeferredScreenshots;
+
     // We maintain a pool of pre-generated texture names to hand out to avoid
     // layer creation needing to run on the main thread (which it would
     // otherwise need to do to access RenderEngine).
@@ -21,6 +21,11 @@
 #include "SurfaceFlinger.h"
 #include "SurfaceInterceptor.h"
 
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
 #include <fstream>
 
 #include <android-base/file.h>
@@ -40,6 +45,20 @@ SurfaceInterceptor::SurfaceInterceptor(SurfaceFlinger* flinger)
 {
 }
 
+SurfaceInterceptor::~SurfaceInterceptor() {
+    {
+        std::lock_guard<std::mutex> writerGuard(mWriterMutex);
+        mWriterExit = true;
+        mWriterCondition.notify_all();
+    }
+    if (mWriterThread.joinable()) {
+        mWriterThread.join();
+    }
+    if (mTraceFd >= 0) {
+        close(mTraceFd);
+    }
+}
+
 void SurfaceInterceptor::enable(const SortedVector<sp<Layer>>& layers,
         const DefaultKeyedVector< wp<IBinder>, DisplayDeviceState>& displays)
 {
@@ -49,8 +68,18 @@ void SurfaceInterceptor::enable(const SortedVector<sp<Layer>>& layers,
     ATRACE_CALL();
     mEnabled = true;
     std::lock_guard<std::mutex> protoGuard(mTraceMutex);
+    {
+        std::lock_guard<std::mutex> writerGuard(mWriterMutex);
+        mTraceFd = open(mOutputFileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        ALOGE_IF(mTraceFd < 0, "Could not open the trace file %s! (%s)", mOutputFileName.c_str(),
+                strerror(errno));
+        if (!mWriterThread.joinable()) {
+            mWriterThread = std::thread(&SurfaceInterceptor::writerThreadLoop, this);
+        }
+    }
     saveExistingDisplaysLocked(displays);
     saveExistingSurfacesLocked(layers);
+    commitIncrementsLocked();
 }
 
 void SurfaceInterceptor::disable() {
@@ -60,10 +89,17 @@ void SurfaceInterceptor::disable() {
     ATRACE_CALL();
     std::lock_guard<std::mutex> protoGuard(mTraceMutex);
     mEnabled = false;
-    status_t err(writeProtoFileLocked());
-    ALOGE_IF(err == PERMISSION_DENIED, "Could not save the proto file! Permission denied");
-    ALOGE_IF(err == NOT_ENOUGH_DATA, "Could not save the proto file! There are missing fields");
-    mTrace.Clear();
+    commitIncrementsLocked();
+
+    // Wait for the writer thread to drain so the trace file is complete by
+    // the time disable returns, then close it.
+    std::unique_lock<std::mutex> writerLock(mWriterMutex);
+    mWriterIdleCondition.wait(writerLock,
+            [this] { return mPendingChunks.empty() && !mWriterBusy; });
+    if (mTraceFd >= 0) {
+        close(mTraceFd);
+        mTraceFd = -1;
+    }
 }
 
 bool SurfaceInterceptor::isEnabled() {
@@ -129,21 +165,47 @@ void SurfaceInterceptor::addInitialDisplayStateLocked(Increment* increment,
             display.viewport, display.frame);
 }
 
-status_t SurfaceInterceptor::writeProtoFileLocked() {
-    ATRACE_CALL();
-    std::string output;
-
-    if (!mTrace.IsInitialized()) {
-        return NOT_ENOUGH_DATA;
-    }
-    if (!mTrace.SerializeToString(&output)) {
-        return PERMISSION_DENIED;
-    }
-    if (!android::base::WriteStringToFile(output, mOutputFileName, true)) {
-        return PERMISSION_DENIED;
+void SurfaceInterceptor::commitIncrementsLocked() {
+    if (mTrace.increment_size() == 0) {
+        return;
     }
+    std::lock_guard<std::mutex> writerGuard(mWriterMutex);
+    mPendingChunks.emplace();
+    mPendingChunks.back().Swap(&mTrace);
+    mWriterCondition.notify_all();
+}
 
-    return NO_ERROR;
+void SurfaceInterceptor::writerThreadLoop() {
+    std::unique_lock<std::mutex> lock(mWriterMutex);
+    while (!mWriterExit) {
+        if (mPendingChunks.empty()) {
+            mWriterIdleCondition.notify_all();
+            mWriterCondition.wait(lock);
+            continue;
+        }
+
+        // Grab everything queued so far so bursts coalesce into one write.
+        std::string output;
+        mWriterBusy = true;
+        while (!mPendingChunks.empty()) {
+            Trace chunk;
+            chunk.Swap(&mPendingChunks.front());
+            mPendingChunks.pop();
+            lock.unlock();
+            if (!chunk.IsInitialized() || !chunk.AppendToString(&output)) {
+                ALOGE("Could not serialize trace increments! There are missing fields");
+            }
+            lock.lock();
+        }
+        const int fd = mTraceFd;
+        lock.unlock();
+        if (fd >= 0 && !output.empty() && !android::base::WriteStringToFd(output, fd)) {
+            ALOGE("Could not write to the trace file! (%s)", strerror(errno));
+        }
+        lock.lock();
+        mWriterBusy = false;
+        mWriterIdleCondition.notify_all();
+    }
 }
 
 const sp<const Layer> SurfaceInterceptor::getLayer(const wp<const IBinder>& weakHandle) {
@@ -531,6 +593,7 @@ void SurfaceInterceptor::saveTransaction(const Vector<ComposerState>& stateUpdat
     std::lock_guard<std::mutex> protoGuard(mTraceMutex);
     addTransactionLocked(createTraceIncrementLocked(), stateUpdates, displays, changedDisplays,
             flags);
+    commitIncrementsLocked();
 }
 
 void SurfaceInterceptor::saveSurfaceCreation(const sp<const Layer>& layer) {
@@ -540,6 +603,7 @@ void SurfaceInterceptor::saveSurfaceCreation(const sp<const Layer>& layer) {
     ATRACE_CALL();
     std::lock_guard<std::mutex> protoGuard(mTraceMutex);
     addSurfaceCreationLocked(createTraceIncrementLocked(), layer);
+    commitIncrementsLocked();
 }
 
 void SurfaceInterceptor::saveSurfaceDeletion(const sp<const Layer>& layer) {
@@ -549,6 +613,7 @@ void SurfaceInterceptor::saveSurfaceDeletion(const sp<const Layer>& layer) {
     ATRACE_CALL();
     std::lock_guard<std::mutex> protoGuard(mTraceMutex);
     addSurfaceDeletionLocked(createTraceIncrementLocked(), layer);
+    commitIncrementsLocked();
 }
 
 void SurfaceInterceptor::saveBufferUpdate(const sp<const Layer>& layer, uint32_t width,
@@ -560,6 +625,7 @@ void SurfaceInterceptor::saveBufferUpdate(const sp<const Layer>& layer, uint32_t
     ATRACE_CALL();
     std::lock_guard<std::mutex> protoGuard(mTraceMutex);
     addBufferUpdateLocked(createTraceIncrementLocked(), layer, width, height, frameNumber);
+    commitIncrementsLocked();
 }
 
 void SurfaceInterceptor::saveVSyncEvent(nsecs_t timestamp) {
@@ -568,6 +634,7 @@ void SurfaceInterceptor::saveVSyncEvent(nsecs_t timestamp) {
     }
     std::lock_guard<std::mutex> protoGuard(mTraceMutex);
     addVSyncUpdateLocked(createTraceIncrementLocked(), timestamp);
+    commitIncrementsLocked();
 }
 
 void SurfaceInterceptor::saveDisplayCreation(const DisplayDeviceState& info) {
@@ -577,6 +644,7 @@ void SurfaceInterceptor::saveDisplayCreation(const DisplayDeviceState& info) {
     ATRACE_CALL();
     std::lock_guard<std::mutex> protoGuard(mTraceMutex);
     addDisplayCreationLocked(createTraceIncrementLocked(), info);
+    commitIncrementsLocked();
 }
 
 void SurfaceInterceptor::saveDisplayDeletion(int32_t displayId) {
@@ -586,6 +654,7 @@ void SurfaceInterceptor::saveDisplayDeletion(int32_t displayId) {
     ATRACE_CALL();
     std::lock_guard<std::mutex> protoGuard(mTraceMutex);
     addDisplayDeletionLocked(createTraceIncrementLocked(), displayId);
+    commitIncrementsLocked();
 }
 
 void SurfaceInterceptor::savePowerModeUpdate(int32_t displayId, int32_t mode) {
@@ -595,6 +664,7 @@ void SurfaceInterceptor::savePowerModeUpdate(int32_t displayId, int32_t mode) {
     ATRACE_CALL();
     std::lock_guard<std::mutex> protoGuard(mTraceMutex);
     addPowerModeUpdateLocked(createTraceIncrementLocked(), displayId, mode);
+    commitIncrementsLocked();
 }
 
 } // namespace impl
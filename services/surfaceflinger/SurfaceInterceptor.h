@@ -19,7 +19,10 @@
 
 #include <frameworks/native/cmds/surfacereplayer/proto/src/trace.pb.h>
 
+#include <condition_variable>
 #include <mutex>
+#include <queue>
+#include <thread>
 
 #include <gui/LayerState.h>
 
@@ -80,7 +83,7 @@ namespace impl {
 class SurfaceInterceptor final : public android::SurfaceInterceptor {
 public:
     explicit SurfaceInterceptor(SurfaceFlinger* const flinger);
-    ~SurfaceInterceptor() override = default;
+    ~SurfaceInterceptor() override;
 
     // Both vectors are used to capture the current state of SF as the initial snapshot in the trace
     void enable(const SortedVector<sp<Layer>>& layers,
@@ -115,7 +118,12 @@ private:
     void addInitialSurfaceStateLocked(Increment* increment, const sp<const Layer>& layer);
     void addInitialDisplayStateLocked(Increment* increment, const DisplayDeviceState& display);
 
-    status_t writeProtoFileLocked();
+    // Hands the increments staged in mTrace to the writer thread. Called at
+    // the end of every save while the trace lock is held, so the transaction
+    // path never serializes protos or touches the disk itself.
+    void commitIncrementsLocked();
+    void writerThreadLoop();
+
     const sp<const Layer> getLayer(const wp<const IBinder>& weakHandle);
     const std::string getLayerName(const sp<const Layer>& layer);
     int32_t getLayerId(const sp<const Layer>& layer);
@@ -171,8 +179,24 @@ private:
     bool mEnabled {false};
     std::string mOutputFileName {DEFAULT_FILENAME};
     std::mutex mTraceMutex {};
+    // Staging area for the increments of the save currently in progress.
+    // Guarded by mTraceMutex; drained by commitIncrementsLocked.
     Trace mTrace {};
     SurfaceFlinger* const mFlinger;
+
+    // Committed increment chunks waiting to be serialized and appended to
+    // the trace file by the writer thread. A serialized Trace is just its
+    // concatenated increments, so appending each chunk in order yields the
+    // same file the old one-shot serialization produced. mWriterMutex is
+    // ordered after mTraceMutex and is never held while writing to disk.
+    std::mutex mWriterMutex {};
+    std::condition_variable mWriterCondition {};
+    std::condition_variable mWriterIdleCondition {};
+    std::queue<Trace> mPendingChunks;
+    std::thread mWriterThread;
+    bool mWriterBusy {false};
+    bool mWriterExit {false};
+    int mTraceFd {-1};
 };
 
 } // namespace impl
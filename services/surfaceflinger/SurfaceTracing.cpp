@@ -35,9 +35,8 @@ void SurfaceTracing::enable() {
     }
     mEnabled = true;
 
-    mTrace = std::make_unique<LayersTraceFileProto>();
-    mTrace->set_magic_number(uint64_t(LayersTraceFileProto_MagicNumber_MAGIC_NUMBER_H) << 32 |
-                             LayersTraceFileProto_MagicNumber_MAGIC_NUMBER_L);
+    mBuffer = {};
+    mBufferUsedBytes = 0;
 }
 
 status_t SurfaceTracing::disable() {
@@ -51,7 +50,8 @@ status_t SurfaceTracing::disable() {
     status_t err(writeProtoFileLocked());
     ALOGE_IF(err == PERMISSION_DENIED, "Could not save the proto file! Permission denied");
     ALOGE_IF(err == NOT_ENOUGH_DATA, "Could not save the proto file! There are missing fields");
-    mTrace.reset();
+    mBuffer = {};
+    mBufferUsedBytes = 0;
     return err;
 }
 
@@ -65,29 +65,44 @@ void SurfaceTracing::traceLayers(const char* where, LayersProto layers) {
     if (!mEnabled) {
         return;
     }
-    LayersTraceProto* entry = mTrace->add_entry();
-    entry->set_elapsed_realtime_nanos(elapsedRealtimeNano());
-    entry->set_where(where);
-    entry->mutable_layers()->Swap(&layers);
-
-    constexpr int maxBufferedEntryCount = 3600;
-    if (mTrace->entry_size() >= maxBufferedEntryCount) {
-        // TODO: flush buffered entries without disabling tracing
-        ALOGE("too many buffered frames; force disable tracing");
-        mEnabled = false;
-        writeProtoFileLocked();
-        mTrace.reset();
+    LayersTraceProto entry;
+    entry.set_elapsed_realtime_nanos(elapsedRealtimeNano());
+    entry.set_where(where);
+    entry.mutable_layers()->Swap(&layers);
+
+    std::string serializedEntry;
+    if (!entry.SerializeToString(&serializedEntry)) {
+        ALOGW("Could not serialize trace entry");
+        return;
+    }
+
+    mBufferUsedBytes += serializedEntry.size();
+    mBuffer.emplace(std::move(serializedEntry));
+
+    // Drop the oldest entries to stay within the cap, but always keep the
+    // entry just added even if it is larger than the cap by itself.
+    while (mBufferUsedBytes > mBufferCapBytes && mBuffer.size() > 1) {
+        mBufferUsedBytes -= mBuffer.front().size();
+        mBuffer.pop();
     }
 }
 
 status_t SurfaceTracing::writeProtoFileLocked() {
     ATRACE_CALL();
 
-    if (!mTrace->IsInitialized()) {
-        return NOT_ENOUGH_DATA;
+    LayersTraceFileProto fileProto;
+    fileProto.set_magic_number(uint64_t(LayersTraceFileProto_MagicNumber_MAGIC_NUMBER_H) << 32 |
+                               LayersTraceFileProto_MagicNumber_MAGIC_NUMBER_L);
+    while (!mBuffer.empty()) {
+        if (!fileProto.add_entry()->ParseFromString(mBuffer.front())) {
+            return NOT_ENOUGH_DATA;
+        }
+        mBufferUsedBytes -= mBuffer.front().size();
+        mBuffer.pop();
     }
+
     std::string output;
-    if (!mTrace->SerializeToString(&output)) {
+    if (!fileProto.SerializeToString(&output)) {
         return PERMISSION_DENIED;
     }
     if (!android::base::WriteStringToFile(output, mOutputFileName, true)) {
@@ -101,7 +116,9 @@ void SurfaceTracing::dump(String8& result) const {
     std::lock_guard<std::mutex> protoGuard(mTraceMutex);
 
     result.appendFormat("Tracing state: %s\n", mEnabled ? "enabled" : "disabled");
-    result.appendFormat("  number of entries: %d\n", mTrace ? mTrace->entry_size() : 0);
+    result.appendFormat("  number of entries: %zu (%.2fMB / %.2fMB)\n", mBuffer.size(),
+                        float(mBufferUsedBytes) / (1024.0f * 1024.0f),
+                        float(mBufferCapBytes) / (1024.0f * 1024.0f));
 }
 
 } // namespace android
@@ -22,13 +22,17 @@
 
 #include <memory>
 #include <mutex>
+#include <queue>
 
 using namespace android::surfaceflinger;
 
 namespace android {
 
 /*
- * SurfaceTracing records layer states during surface flinging.
+ * SurfaceTracing records layer states during surface flinging. Entries are
+ * kept in a bounded ring buffer of serialized protos, so tracing can stay
+ * enabled indefinitely: once the buffer is full the oldest frames are
+ * dropped to make room for new ones.
  */
 class SurfaceTracing {
 public:
@@ -41,13 +45,23 @@ public:
 
 private:
     static constexpr auto DEFAULT_FILENAME = "/data/misc/wmtrace/layers_trace.pb";
+    // Upper bound on the serialized entries buffered while tracing. Sized so
+    // a trace left enabled in production keeps minutes of history without
+    // the unbounded growth the old grow-until-disable buffer had.
+    static constexpr size_t DEFAULT_BUFFER_CAP_BYTES = 20 * 1024 * 1024;
 
     status_t writeProtoFileLocked();
 
     bool mEnabled = false;
     std::string mOutputFileName = DEFAULT_FILENAME;
     mutable std::mutex mTraceMutex;
-    std::unique_ptr<LayersTraceFileProto> mTrace;
+
+    // Ring buffer of serialized LayersTraceProto entries, oldest in front.
+    // Entries are stored serialized because a flat string is much smaller
+    // than the in-memory proto tree it was built from.
+    std::queue<std::string> mBuffer;
+    size_t mBufferUsedBytes = 0;
+    size_t mBufferCapBytes = DEFAULT_BUFFER_CAP_BYTES;
 };
 
 } // namespace android
@@ -106,7 +106,17 @@ void TimeStats::incrementClientCompositionFrames() {
     timeStats.clientCompositionFrames++;
 }
 
-bool TimeStats::recordReadyLocked(const std::string& layerName, TimeRecord* timeRecord) {
+void TimeStats::recordGpuCompositionTime(int64_t compositionTimeNs) {
+    if (!mEnabled.load()) return;
+
+    ATRACE_CALL();
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    timeStats.gpuCompositionFrames++;
+    timeStats.gpuCompositionTimeNs += compositionTimeNs;
+}
+
+bool TimeStats::recordReady(const std::string& layerName, TimeRecord* timeRecord) {
     if (!timeRecord->ready) {
         ALOGV("[%s]-[%" PRIu64 "]-presentFence is still not received", layerName.c_str(),
               timeRecord->frameNumber);
@@ -163,18 +173,21 @@ static std::string getPackageName(const std::string& layerName) {
     return "";
 }
 
-void TimeStats::flushAvailableRecordsToStatsLocked(const std::string& layerName) {
+void TimeStats::flushAvailableRecords(LayerRecord* layerRecord) {
     ATRACE_CALL();
 
-    LayerRecord& layerRecord = timeStatsTracker[layerName];
-    TimeRecord& prevTimeRecord = layerRecord.prevTimeRecord;
-    std::deque<TimeRecord>& timeRecords = layerRecord.timeRecords;
+    const std::string& layerName = layerRecord->layerName;
+    TimeRecord& prevTimeRecord = layerRecord->prevTimeRecord;
+    std::deque<TimeRecord>& timeRecords = layerRecord->timeRecords;
     while (!timeRecords.empty()) {
-        if (!recordReadyLocked(layerName, &timeRecords[0])) break;
+        if (!recordReady(layerName, &timeRecords[0])) break;
         ALOGV("[%s]-[%" PRIu64 "]-presentFenceTime[%" PRId64 "]", layerName.c_str(),
               timeRecords[0].frameNumber, timeRecords[0].presentTime);
 
         if (prevTimeRecord.ready) {
+            // The global stats are only touched when a frame completes, so
+            // the per-event setters never contend on this lock.
+            std::lock_guard<std::mutex> lock(mMutex);
             if (!timeStats.stats.count(layerName)) {
                 timeStats.stats[layerName].layerName = layerName;
                 timeStats.stats[layerName].packageName = getPackageName(layerName);
@@ -217,7 +230,7 @@ void TimeStats::flushAvailableRecordsToStatsLocked(const std::string& layerName)
         }
         prevTimeRecord = timeRecords[0];
         timeRecords.pop_front();
-        layerRecord.waitData--;
+        layerRecord->waitData--;
     }
 }
 
@@ -234,19 +247,34 @@ static bool layerNameIsValid(const std::string& layerName) {
     return std::regex_match(layerName.begin(), layerName.end(), re);
 }
 
-void TimeStats::setPostTime(const std::string& layerName, uint64_t frameNumber, nsecs_t postTime) {
-    if (!mEnabled.load()) return;
-
+std::shared_ptr<TimeStats::LayerRecord> TimeStats::getLayerRecord(const std::string& layerName) {
     ATRACE_CALL();
-    ALOGV("[%s]-[%" PRIu64 "]-PostTime[%" PRId64 "]", layerName.c_str(), frameNumber, postTime);
 
     std::lock_guard<std::mutex> lock(mMutex);
-    if (!timeStatsTracker.count(layerName) && !layerNameIsValid(layerName)) {
-        return;
+    auto iter = timeStatsTracker.find(layerName);
+    if (iter != timeStatsTracker.end()) {
+        return iter->second;
     }
-    LayerRecord& layerRecord = timeStatsTracker[layerName];
-    if (layerRecord.timeRecords.size() == MAX_NUM_TIME_RECORDS) {
-        ALOGV("[%s]-timeRecords is already at its maximum size[%zu]", layerName.c_str(),
+    if (!layerNameIsValid(layerName)) {
+        return nullptr;
+    }
+    auto record = std::make_shared<LayerRecord>();
+    record->layerName = layerName;
+    timeStatsTracker[layerName] = record;
+    return record;
+}
+
+void TimeStats::setPostTime(const std::shared_ptr<LayerRecord>& record, uint64_t frameNumber,
+                            nsecs_t postTime) {
+    if (record == nullptr || !mEnabled.load()) return;
+
+    ATRACE_CALL();
+    ALOGV("[%s]-[%" PRIu64 "]-PostTime[%" PRId64 "]", record->layerName.c_str(), frameNumber,
+          postTime);
+
+    std::lock_guard<std::mutex> lock(record->mutex);
+    if (record->timeRecords.size() == MAX_NUM_TIME_RECORDS) {
+        ALOGV("[%s]-timeRecords is already at its maximum size[%zu]", record->layerName.c_str(),
               MAX_NUM_TIME_RECORDS);
         // TODO(zzyiwei): if this happens, there must be a present fence missing
         // or waitData is not in the correct position. Need to think out a
@@ -261,165 +289,188 @@ void TimeStats::setPostTime(const std::string& layerName, uint64_t frameNumber,
             .postTime = postTime,
             .acquireTime = postTime,
     };
-    layerRecord.timeRecords.push_back(timeRecord);
-    if (layerRecord.waitData < 0 ||
-        layerRecord.waitData >= static_cast<int32_t>(layerRecord.timeRecords.size()))
-        layerRecord.waitData = layerRecord.timeRecords.size() - 1;
+    record->timeRecords.push_back(timeRecord);
+    if (record->waitData < 0 ||
+        record->waitData >= static_cast<int32_t>(record->timeRecords.size()))
+        record->waitData = record->timeRecords.size() - 1;
 }
 
-void TimeStats::setLatchTime(const std::string& layerName, uint64_t frameNumber,
+void TimeStats::setLatchTime(const std::shared_ptr<LayerRecord>& record, uint64_t frameNumber,
                              nsecs_t latchTime) {
-    if (!mEnabled.load()) return;
+    if (record == nullptr || !mEnabled.load()) return;
 
     ATRACE_CALL();
-    ALOGV("[%s]-[%" PRIu64 "]-LatchTime[%" PRId64 "]", layerName.c_str(), frameNumber, latchTime);
+    ALOGV("[%s]-[%" PRIu64 "]-LatchTime[%" PRId64 "]", record->layerName.c_str(), frameNumber,
+          latchTime);
 
-    std::lock_guard<std::mutex> lock(mMutex);
-    if (!timeStatsTracker.count(layerName)) return;
-    LayerRecord& layerRecord = timeStatsTracker[layerName];
-    TimeRecord& timeRecord = layerRecord.timeRecords[layerRecord.waitData];
+    std::lock_guard<std::mutex> lock(record->mutex);
+    if (record->waitData < 0 ||
+        record->waitData >= static_cast<int32_t>(record->timeRecords.size()))
+        return;
+    TimeRecord& timeRecord = record->timeRecords[record->waitData];
     if (timeRecord.frameNumber == frameNumber) {
         timeRecord.latchTime = latchTime;
     }
 }
 
-void TimeStats::setDesiredTime(const std::string& layerName, uint64_t frameNumber,
+void TimeStats::setDesiredTime(const std::shared_ptr<LayerRecord>& record, uint64_t frameNumber,
                                nsecs_t desiredTime) {
-    if (!mEnabled.load()) return;
+    if (record == nullptr || !mEnabled.load()) return;
 
     ATRACE_CALL();
-    ALOGV("[%s]-[%" PRIu64 "]-DesiredTime[%" PRId64 "]", layerName.c_str(), frameNumber,
+    ALOGV("[%s]-[%" PRIu64 "]-DesiredTime[%" PRId64 "]", record->layerName.c_str(), frameNumber,
           desiredTime);
 
-    std::lock_guard<std::mutex> lock(mMutex);
-    if (!timeStatsTracker.count(layerName)) return;
-    LayerRecord& layerRecord = timeStatsTracker[layerName];
-    TimeRecord& timeRecord = layerRecord.timeRecords[layerRecord.waitData];
+    std::lock_guard<std::mutex> lock(record->mutex);
+    if (record->waitData < 0 ||
+        record->waitData >= static_cast<int32_t>(record->timeRecords.size()))
+        return;
+    TimeRecord& timeRecord = record->timeRecords[record->waitData];
     if (timeRecord.frameNumber == frameNumber) {
         timeRecord.desiredTime = desiredTime;
     }
 }
 
-void TimeStats::setAcquireTime(const std::string& layerName, uint64_t frameNumber,
+void TimeStats::setAcquireTime(const std::shared_ptr<LayerRecord>& record, uint64_t frameNumber,
                                nsecs_t acquireTime) {
-    if (!mEnabled.load()) return;
+    if (record == nullptr || !mEnabled.load()) return;
 
     ATRACE_CALL();
-    ALOGV("[%s]-[%" PRIu64 "]-AcquireTime[%" PRId64 "]", layerName.c_str(), frameNumber,
+    ALOGV("[%s]-[%" PRIu64 "]-AcquireTime[%" PRId64 "]", record->layerName.c_str(), frameNumber,
           acquireTime);
 
-    std::lock_guard<std::mutex> lock(mMutex);
-    if (!timeStatsTracker.count(layerName)) return;
-    LayerRecord& layerRecord = timeStatsTracker[layerName];
-    TimeRecord& timeRecord = layerRecord.timeRecords[layerRecord.waitData];
+    std::lock_guard<std::mutex> lock(record->mutex);
+    if (record->waitData < 0 ||
+        record->waitData >= static_cast<int32_t>(record->timeRecords.size()))
+        return;
+    TimeRecord& timeRecord = record->timeRecords[record->waitData];
     if (timeRecord.frameNumber == frameNumber) {
         timeRecord.acquireTime = acquireTime;
     }
 }
 
-void TimeStats::setAcquireFence(const std::string& layerName, uint64_t frameNumber,
+void TimeStats::setAcquireFence(const std::shared_ptr<LayerRecord>& record, uint64_t frameNumber,
                                 const std::shared_ptr<FenceTime>& acquireFence) {
-    if (!mEnabled.load()) return;
+    if (record == nullptr || !mEnabled.load()) return;
 
     ATRACE_CALL();
-    ALOGV("[%s]-[%" PRIu64 "]-AcquireFenceTime[%" PRId64 "]", layerName.c_str(), frameNumber,
-          acquireFence->getSignalTime());
+    ALOGV("[%s]-[%" PRIu64 "]-AcquireFenceTime[%" PRId64 "]", record->layerName.c_str(),
+          frameNumber, acquireFence->getSignalTime());
 
-    std::lock_guard<std::mutex> lock(mMutex);
-    if (!timeStatsTracker.count(layerName)) return;
-    LayerRecord& layerRecord = timeStatsTracker[layerName];
-    TimeRecord& timeRecord = layerRecord.timeRecords[layerRecord.waitData];
+    std::lock_guard<std::mutex> lock(record->mutex);
+    if (record->waitData < 0 ||
+        record->waitData >= static_cast<int32_t>(record->timeRecords.size()))
+        return;
+    TimeRecord& timeRecord = record->timeRecords[record->waitData];
     if (timeRecord.frameNumber == frameNumber) {
         timeRecord.acquireFence = acquireFence;
     }
 }
 
-void TimeStats::setPresentTime(const std::string& layerName, uint64_t frameNumber,
+void TimeStats::setPresentTime(const std::shared_ptr<LayerRecord>& record, uint64_t frameNumber,
                                nsecs_t presentTime) {
-    if (!mEnabled.load()) return;
+    if (record == nullptr || !mEnabled.load()) return;
 
     ATRACE_CALL();
-    ALOGV("[%s]-[%" PRIu64 "]-PresentTime[%" PRId64 "]", layerName.c_str(), frameNumber,
+    ALOGV("[%s]-[%" PRIu64 "]-PresentTime[%" PRId64 "]", record->layerName.c_str(), frameNumber,
           presentTime);
 
-    std::lock_guard<std::mutex> lock(mMutex);
-    if (!timeStatsTracker.count(layerName)) return;
-    LayerRecord& layerRecord = timeStatsTracker[layerName];
-    TimeRecord& timeRecord = layerRecord.timeRecords[layerRecord.waitData];
-    if (timeRecord.frameNumber == frameNumber) {
-        timeRecord.presentTime = presentTime;
-        timeRecord.ready = true;
-        layerRecord.waitData++;
+    std::lock_guard<std::mutex> lock(record->mutex);
+    if (record->waitData >= 0 &&
+        record->waitData < static_cast<int32_t>(record->timeRecords.size())) {
+        TimeRecord& timeRecord = record->timeRecords[record->waitData];
+        if (timeRecord.frameNumber == frameNumber) {
+            timeRecord.presentTime = presentTime;
+            timeRecord.ready = true;
+            record->waitData++;
+        }
     }
 
-    flushAvailableRecordsToStatsLocked(layerName);
+    flushAvailableRecords(record.get());
 }
 
-void TimeStats::setPresentFence(const std::string& layerName, uint64_t frameNumber,
+void TimeStats::setPresentFence(const std::shared_ptr<LayerRecord>& record, uint64_t frameNumber,
                                 const std::shared_ptr<FenceTime>& presentFence) {
-    if (!mEnabled.load()) return;
+    if (record == nullptr || !mEnabled.load()) return;
 
     ATRACE_CALL();
-    ALOGV("[%s]-[%" PRIu64 "]-PresentFenceTime[%" PRId64 "]", layerName.c_str(), frameNumber,
-          presentFence->getSignalTime());
-
-    std::lock_guard<std::mutex> lock(mMutex);
-    if (!timeStatsTracker.count(layerName)) return;
-    LayerRecord& layerRecord = timeStatsTracker[layerName];
-    TimeRecord& timeRecord = layerRecord.timeRecords[layerRecord.waitData];
-    if (timeRecord.frameNumber == frameNumber) {
-        timeRecord.presentFence = presentFence;
-        timeRecord.ready = true;
-        layerRecord.waitData++;
+    ALOGV("[%s]-[%" PRIu64 "]-PresentFenceTime[%" PRId64 "]", record->layerName.c_str(),
+          frameNumber, presentFence->getSignalTime());
+
+    std::lock_guard<std::mutex> lock(record->mutex);
+    if (record->waitData >= 0 &&
+        record->waitData < static_cast<int32_t>(record->timeRecords.size())) {
+        TimeRecord& timeRecord = record->timeRecords[record->waitData];
+        if (timeRecord.frameNumber == frameNumber) {
+            timeRecord.presentFence = presentFence;
+            timeRecord.ready = true;
+            record->waitData++;
+        }
     }
 
-    flushAvailableRecordsToStatsLocked(layerName);
+    flushAvailableRecords(record.get());
 }
 
-void TimeStats::onDisconnect(const std::string& layerName) {
-    if (!mEnabled.load()) return;
+void TimeStats::onDisconnect(const std::shared_ptr<LayerRecord>& record) {
+    if (record == nullptr || !mEnabled.load()) return;
 
     ATRACE_CALL();
-    ALOGV("[%s]-onDisconnect", layerName.c_str());
+    ALOGV("[%s]-onDisconnect", record->layerName.c_str());
 
-    std::lock_guard<std::mutex> lock(mMutex);
-    if (!timeStatsTracker.count(layerName)) return;
-    flushAvailableRecordsToStatsLocked(layerName);
-    timeStatsTracker.erase(layerName);
+    std::lock_guard<std::mutex> lock(record->mutex);
+    flushAvailableRecords(record.get());
+    record->timeRecords.clear();
+    record->prevTimeRecord.ready = false;
+    record->waitData = -1;
 }
 
-void TimeStats::clearLayerRecord(const std::string& layerName) {
-    if (!mEnabled.load()) return;
+void TimeStats::onDestroy(const std::shared_ptr<LayerRecord>& record) {
+    if (record == nullptr) return;
 
     ATRACE_CALL();
-    ALOGV("[%s]-clearLayerRecord", layerName.c_str());
+    ALOGV("[%s]-onDestroy", record->layerName.c_str());
+
+    if (mEnabled.load()) {
+        std::lock_guard<std::mutex> lock(record->mutex);
+        flushAvailableRecords(record.get());
+    }
 
     std::lock_guard<std::mutex> lock(mMutex);
-    if (!timeStatsTracker.count(layerName)) return;
-    LayerRecord& layerRecord = timeStatsTracker[layerName];
-    layerRecord.timeRecords.clear();
-    layerRecord.prevTimeRecord.ready = false;
-    layerRecord.waitData = -1;
+    auto iter = timeStatsTracker.find(record->layerName);
+    if (iter != timeStatsTracker.end() && iter->second == record) {
+        timeStatsTracker.erase(iter);
+    }
 }
 
-void TimeStats::removeTimeRecord(const std::string& layerName, uint64_t frameNumber) {
-    if (!mEnabled.load()) return;
+void TimeStats::clearLayerRecord(const std::shared_ptr<LayerRecord>& record) {
+    if (record == nullptr || !mEnabled.load()) return;
 
     ATRACE_CALL();
-    ALOGV("[%s]-[%" PRIu64 "]-removeTimeRecord", layerName.c_str(), frameNumber);
+    ALOGV("[%s]-clearLayerRecord", record->layerName.c_str());
 
-    std::lock_guard<std::mutex> lock(mMutex);
-    if (!timeStatsTracker.count(layerName)) return;
-    LayerRecord& layerRecord = timeStatsTracker[layerName];
+    std::lock_guard<std::mutex> lock(record->mutex);
+    record->timeRecords.clear();
+    record->prevTimeRecord.ready = false;
+    record->waitData = -1;
+}
+
+void TimeStats::removeTimeRecord(const std::shared_ptr<LayerRecord>& record,
+                                 uint64_t frameNumber) {
+    if (record == nullptr || !mEnabled.load()) return;
+
+    ATRACE_CALL();
+    ALOGV("[%s]-[%" PRIu64 "]-removeTimeRecord", record->layerName.c_str(), frameNumber);
+
+    std::lock_guard<std::mutex> lock(record->mutex);
     size_t removeAt = 0;
-    for (const TimeRecord& record : layerRecord.timeRecords) {
-        if (record.frameNumber == frameNumber) break;
+    for (const TimeRecord& timeRecord : record->timeRecords) {
+        if (timeRecord.frameNumber == frameNumber) break;
         removeAt++;
     }
-    if (removeAt == layerRecord.timeRecords.size()) return;
-    layerRecord.timeRecords.erase(layerRecord.timeRecords.begin() + removeAt);
-    if (layerRecord.waitData > static_cast<int32_t>(removeAt)) {
-        --layerRecord.waitData;
+    if (removeAt == record->timeRecords.size()) return;
+    record->timeRecords.erase(record->timeRecords.begin() + removeAt);
+    if (record->waitData > static_cast<int32_t>(removeAt)) {
+        --record->waitData;
     }
 }
 
@@ -456,6 +507,8 @@ void TimeStats::clear() {
     timeStats.totalFrames = 0;
     timeStats.missedFrames = 0;
     timeStats.clientCompositionFrames = 0;
+    timeStats.gpuCompositionFrames = 0;
+    timeStats.gpuCompositionTimeNs = 0;
 }
 
 bool TimeStats::isEnabled() {
@@ -26,6 +26,7 @@
 #include <utils/Vector.h>
 
 #include <deque>
+#include <memory>
 #include <mutex>
 #include <optional>
 #include <unordered_map>
@@ -52,7 +53,16 @@ class TimeStats {
         std::shared_ptr<FenceTime> presentFence;
     };
 
+public:
+    // One layer's in-flight frame records. Layers resolve their record once
+    // at creation and cache the handle, so recording an event is a pointer
+    // dereference plus a per-record lock instead of a string-keyed map
+    // lookup under the global lock. The per-record mutex shards contention
+    // between the binder thread posting frames and the main thread
+    // latching/presenting them.
     struct LayerRecord {
+        std::mutex mutex;
+        std::string layerName;
         // This is the index in timeRecords, at which the timestamps for that
         // specific frame are still not fully received. This is not waiting for
         // fences to signal, but rather waiting to receive those fences/timestamps.
@@ -61,31 +71,47 @@ class TimeStats {
         std::deque<TimeRecord> timeRecords;
     };
 
-public:
     static TimeStats& getInstance();
     void parseArgs(bool asProto, const Vector<String16>& args, size_t& index, String8& result);
     void incrementTotalFrames();
     void incrementMissedFrames();
     void incrementClientCompositionFrames();
-
-    void setPostTime(const std::string& layerName, uint64_t frameNumber, nsecs_t postTime);
-    void setLatchTime(const std::string& layerName, uint64_t frameNumber, nsecs_t latchTime);
-    void setDesiredTime(const std::string& layerName, uint64_t frameNumber, nsecs_t desiredTime);
-    void setAcquireTime(const std::string& layerName, uint64_t frameNumber, nsecs_t acquireTime);
-    void setAcquireFence(const std::string& layerName, uint64_t frameNumber,
+    // Accumulates the measured GPU duration of one client composition pass.
+    void recordGpuCompositionTime(int64_t compositionTimeNs);
+
+    // Returns the stable record slot for layerName, creating it on first use,
+    // or nullptr if the layer name is not one stats are collected for. The
+    // setters below all accept nullptr and do nothing with it.
+    std::shared_ptr<LayerRecord> getLayerRecord(const std::string& layerName);
+
+    void setPostTime(const std::shared_ptr<LayerRecord>& record, uint64_t frameNumber,
+                     nsecs_t postTime);
+    void setLatchTime(const std::shared_ptr<LayerRecord>& record, uint64_t frameNumber,
+                      nsecs_t latchTime);
+    void setDesiredTime(const std::shared_ptr<LayerRecord>& record, uint64_t frameNumber,
+                        nsecs_t desiredTime);
+    void setAcquireTime(const std::shared_ptr<LayerRecord>& record, uint64_t frameNumber,
+                        nsecs_t acquireTime);
+    void setAcquireFence(const std::shared_ptr<LayerRecord>& record, uint64_t frameNumber,
                          const std::shared_ptr<FenceTime>& acquireFence);
-    void setPresentTime(const std::string& layerName, uint64_t frameNumber, nsecs_t presentTime);
-    void setPresentFence(const std::string& layerName, uint64_t frameNumber,
+    void setPresentTime(const std::shared_ptr<LayerRecord>& record, uint64_t frameNumber,
+                        nsecs_t presentTime);
+    void setPresentFence(const std::shared_ptr<LayerRecord>& record, uint64_t frameNumber,
                          const std::shared_ptr<FenceTime>& presentFence);
-    void onDisconnect(const std::string& layerName);
-    void clearLayerRecord(const std::string& layerName);
-    void removeTimeRecord(const std::string& layerName, uint64_t frameNumber);
+    void onDisconnect(const std::shared_ptr<LayerRecord>& record);
+    // Flushes whatever the record has accumulated and drops it from the
+    // tracker. Called when the owning layer is destroyed.
+    void onDestroy(const std::shared_ptr<LayerRecord>& record);
+    void clearLayerRecord(const std::shared_ptr<LayerRecord>& record);
+    void removeTimeRecord(const std::shared_ptr<LayerRecord>& record, uint64_t frameNumber);
 
 private:
     TimeStats() = default;
 
-    bool recordReadyLocked(const std::string& layerName, TimeRecord* timeRecord);
-    void flushAvailableRecordsToStatsLocked(const std::string& layerName);
+    // Requires record->mutex to be held; takes mMutex internally while
+    // folding completed frames into the global stats.
+    bool recordReady(const std::string& layerName, TimeRecord* timeRecord);
+    void flushAvailableRecords(LayerRecord* record);
 
     void enable();
     void disable();
@@ -96,7 +122,7 @@ private:
     std::atomic<bool> mEnabled = false;
     std::mutex mMutex;
     TimeStatsHelper::TimeStatsGlobal timeStats;
-    std::unordered_map<std::string, LayerRecord> timeStatsTracker;
+    std::unordered_map<std::string, std::shared_ptr<LayerRecord>> timeStatsTracker;
 };
 
 } // namespace android
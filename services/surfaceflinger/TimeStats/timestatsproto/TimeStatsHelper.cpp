@@ -93,6 +93,11 @@ std::string TimeStatsHelper::TimeStatsGlobal::toString(std::optional<uint32_t> m
     StringAppendF(&result, "totalFrames= %d\n", totalFrames);
     StringAppendF(&result, "missedFrames= %d\n", missedFrames);
     StringAppendF(&result, "clientCompositionFrames= %d\n", clientCompositionFrames);
+    StringAppendF(&result, "gpuCompositionFrames= %d\n", gpuCompositionFrames);
+    if (gpuCompositionFrames > 0) {
+        StringAppendF(&result, "averageGpuCompositionMillis= %.3f\n",
+                      gpuCompositionTimeNs / (1e6 * gpuCompositionFrames));
+    }
     StringAppendF(&result, "TimeStats for each layer is as below:\n");
     const auto dumpStats = generateDumpStats(maxLayers);
     for (auto& ele : dumpStats) {
@@ -129,6 +134,8 @@ SFTimeStatsGlobalProto TimeStatsHelper::TimeStatsGlobal::toProto(
     globalProto.set_total_frames(totalFrames);
     globalProto.set_missed_frames(missedFrames);
     globalProto.set_client_composition_frames(clientCompositionFrames);
+    globalProto.set_gpu_composition_frames(gpuCompositionFrames);
+    globalProto.set_gpu_composition_time_nanos(gpuCompositionTimeNs);
     const auto dumpStats = generateDumpStats(maxLayers);
     for (auto& ele : dumpStats) {
         SFTimeStatsLayerProto* layerProto = globalProto.add_stats();
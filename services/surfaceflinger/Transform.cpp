@@ -34,7 +34,9 @@ Transform::Transform() {
 }
 
 Transform::Transform(const Transform&  other)
-    : mMatrix(other.mMatrix), mType(other.mType) {
+    : mMatrix(other.mMatrix), mType(other.mType),
+      mInverseMatrix(other.mInverseMatrix), mInverseType(other.mInverseType),
+      mInverseCached(other.mInverseCached) {
 }
 
 Transform::Transform(uint32_t orientation) {
@@ -63,10 +65,35 @@ Transform Transform::operator * (const Transform& rhs) const
     if (rhs.mType == IDENTITY)
         return r;
 
-    // TODO: we could use mType to optimize the matrix multiply
+    r.mInverseCached = false;
+
+    // Pure translations compose by adding the translation vectors, and the
+    // resulting type is exact without re-deriving it from the floats.
+    if (mType <= TRANSLATE && rhs.mType <= TRANSLATE) {
+        const float tx = mMatrix[2][0] + rhs.mMatrix[2][0];
+        const float ty = mMatrix[2][1] + rhs.mMatrix[2][1];
+        r.mMatrix[2][0] = tx;
+        r.mMatrix[2][1] = ty;
+        r.mType = (isZero(tx) && isZero(ty)) ? IDENTITY : TRANSLATE;
+        return r;
+    }
+
     const mat33& A(mMatrix);
     const mat33& B(rhs.mMatrix);
           mat33& D(r.mMatrix);
+
+    // Axis-aligned transforms (translate, scale, flips and 180 degree
+    // rotations) have a diagonal 2x2 part, so the full multiply reduces to
+    // two scales and a scaled translation.
+    if (isZero(A[1][0]) && isZero(A[0][1]) && isZero(B[1][0]) && isZero(B[0][1])) {
+        D[0][0] = A[0][0]*B[0][0];
+        D[1][1] = A[1][1]*B[1][1];
+        D[2][0] = A[0][0]*B[2][0] + A[2][0];
+        D[2][1] = A[1][1]*B[2][1] + A[2][1];
+        r.mType = UNKNOWN_TYPE;
+        return r;
+    }
+
     for (int i=0 ; i<3 ; i++) {
         const float v0 = A[0][i];
         const float v1 = A[1][i];
@@ -97,6 +124,7 @@ float Transform::ty() const {
 
 void Transform::reset() {
     mType = IDENTITY;
+    mInverseCached = false;
     for(int i=0 ; i<3 ; i++) {
         vec3& v(mMatrix[i]);
         for (int j=0 ; j<3 ; j++)
@@ -106,6 +134,7 @@ void Transform::reset() {
 
 void Transform::set(float tx, float ty)
 {
+    mInverseCached = false;
     mMatrix[2][0] = tx;
     mMatrix[2][1] = ty;
     mMatrix[2][2] = 1.0f;
@@ -119,6 +148,7 @@ void Transform::set(float tx, float ty)
 
 void Transform::set(float a, float b, float c, float d)
 {
+    mInverseCached = false;
     mat33& M(mMatrix);
     M[0][0] = a;    M[1][0] = b;
     M[0][1] = c;    M[1][1] = d;
@@ -199,6 +229,28 @@ Rect Transform::makeBounds(int w, int h) const
 Rect Transform::transform(const Rect& bounds, bool roundOutwards) const
 {
     Rect r;
+
+    // Axis-aligned transforms map opposite corners to opposite corners, so
+    // two point transforms bound the result and the other two can be
+    // skipped. This is the common case for layer and screen bounds.
+    const mat33& M(mMatrix);
+    if (CC_LIKELY(isZero(M[1][0]) && isZero(M[0][1]))) {
+        const vec2 lt = transform(vec2(bounds.left, bounds.top));
+        const vec2 rb = transform(vec2(bounds.right, bounds.bottom));
+        if (roundOutwards) {
+            r.left   = floorf(min(lt[0], rb[0]));
+            r.top    = floorf(min(lt[1], rb[1]));
+            r.right  = ceilf(max(lt[0], rb[0]));
+            r.bottom = ceilf(max(lt[1], rb[1]));
+        } else {
+            r.left   = floorf(min(lt[0], rb[0]) + 0.5f);
+            r.top    = floorf(min(lt[1], rb[1]) + 0.5f);
+            r.right  = floorf(max(lt[0], rb[0]) + 0.5f);
+            r.bottom = floorf(max(lt[1], rb[1]) + 0.5f);
+        }
+        return r;
+    }
+
     vec2 lt( bounds.left,  bounds.top    );
     vec2 rt( bounds.right, bounds.top    );
     vec2 lb( bounds.left,  bounds.bottom );
@@ -226,6 +278,19 @@ Rect Transform::transform(const Rect& bounds, bool roundOutwards) const
 
 FloatRect Transform::transform(const FloatRect& bounds) const
 {
+    const mat33& M(mMatrix);
+    if (CC_LIKELY(isZero(M[1][0]) && isZero(M[0][1]))) {
+        const vec2 lt = transform(vec2(bounds.left, bounds.top));
+        const vec2 rb = transform(vec2(bounds.right, bounds.bottom));
+
+        FloatRect r;
+        r.left = min(lt[0], rb[0]);
+        r.top = min(lt[1], rb[1]);
+        r.right = max(lt[0], rb[0]);
+        r.bottom = max(lt[1], rb[1]);
+        return r;
+    }
+
     vec2 lt(bounds.left, bounds.top);
     vec2 rt(bounds.right, bounds.top);
     vec2 lb(bounds.left, bounds.bottom);
@@ -335,6 +400,12 @@ Transform Transform::inverse() const {
         // a c 0
         // b d 0
         // x y 1
+        if (mInverseCached) {
+            result.mMatrix = mInverseMatrix;
+            result.mType = mInverseType;
+            return result;
+        }
+
         const mat33& M(mMatrix);
         const float a = M[0][0];
         const float b = M[1][0];
@@ -354,6 +425,10 @@ Transform Transform::inverse() const {
         T = result.transform(T);
         result.mMatrix[2][0] = T[0];
         result.mMatrix[2][1] = T[1];
+
+        mInverseMatrix = result.mMatrix;
+        mInverseType = result.mType;
+        mInverseCached = true;
     }
     return result;
 }
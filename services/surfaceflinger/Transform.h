@@ -17,11 +17,13 @@
 #ifndef ANDROID_TRANSFORM_H
 #define ANDROID_TRANSFORM_H
 
+#include <math.h>
 #include <stdint.h>
 #include <sys/types.h>
 
 #include <ui/Point.h>
 #include <ui/Rect.h>
+#include <ui/Region.h>
 #include <math/vec2.h>
 #include <math/vec3.h>
 
@@ -31,8 +33,6 @@
 
 namespace android {
 
-class Region;
-
 // ---------------------------------------------------------------------------
 
 class Transform
@@ -82,6 +82,33 @@ public:
             Rect    makeBounds(int w, int h) const;
             vec2    transform(int x, int y) const;
             Region  transform(const Region& reg) const;
+
+            // Applies this transform to every rect of the region, calling
+            // visitor(const Rect&) for each transformed rect without building
+            // a temporary Region. The visited rects cover the same area as
+            // transform(reg) but are not merged or re-sorted, so this is only
+            // suitable for consumers that do not rely on Region invariants,
+            // such as scissor setup, HWC rect lists or mesh building.
+            template <typename F>
+            void transformVisit(const Region& reg, F&& visitor) const {
+                if (type() > TRANSLATE) {
+                    if (preserveRects()) {
+                        reg.forEachRect([&](const Rect& r) {
+                            visitor(transform(r));
+                        });
+                    } else {
+                        visitor(transform(reg.bounds()));
+                    }
+                } else {
+                    const int xpos = int(floorf(tx() + 0.5f));
+                    const int ypos = int(floorf(ty() + 0.5f));
+                    reg.forEachRect([&](const Rect& r) {
+                        visitor(Rect(r.left + xpos, r.top + ypos,
+                                     r.right + xpos, r.bottom + ypos));
+                    });
+                }
+            }
+
             Rect    transform(const Rect& bounds,
                     bool roundOutwards = false) const;
             FloatRect transform(const FloatRect& bounds) const;
@@ -110,6 +137,13 @@ private:
 
     mat33               mMatrix;
     mutable uint32_t    mType;
+
+    // Cached result of inverse() for non-trivial transforms, invalidated
+    // whenever the matrix is mutated. Layer::getTransform and the input
+    // window code invert the same transform every frame.
+    mutable mat33       mInverseMatrix = {};
+    mutable uint32_t    mInverseType = 0;
+    mutable bool        mInverseCached = false;
 };
 
 // ---------------------------------------------------------------------------
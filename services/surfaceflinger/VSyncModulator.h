@@ -16,7 +16,10 @@
 
 #pragma once
 
+#include <inttypes.h>
+
 #include <utils/Errors.h>
+#include <utils/String8.h>
 
 #include <mutex>
 
@@ -34,6 +37,28 @@ private:
     // low-pass filter in case the client isn't quick enough in sending new transactions.
     const int MIN_EARLY_FRAME_COUNT = 2;
 
+    // Number of consecutive refreshes with incoming transactions after which we predict the
+    // traffic will continue and hold the early offsets proactively, instead of paying for a
+    // missed frame at the start of every burst.
+    const int BUSY_FRAME_STREAK_TO_PREDICT = 3;
+
+    // Number of consecutive transaction-free refreshes before a predicted-early period ends.
+    // Acts as hysteresis so a single quiet frame in the middle of a burst doesn't bounce the
+    // offsets back and forth.
+    const int QUIET_FRAME_STREAK_TO_EXIT = 8;
+
+    // Number of consecutive frames whose measured main-thread duration overran the budget left
+    // by the late offsets before SF's wakeup is shifted earlier in the vsync interval.
+    const int OVERRUN_STREAK_TO_SHIFT = 2;
+
+    // Number of consecutive frames that fit comfortably at the late offsets before a
+    // duration-driven shift is undone.
+    const int FIT_STREAK_TO_RELAX = 30;
+
+    // Slack subtracted from the frame budget so the shift happens before deadlines start being
+    // missed rather than after.
+    const nsecs_t DEADLINE_MARGIN_NS = 1000000;
+
 public:
 
     struct Offsets {
@@ -77,8 +102,10 @@ public:
     }
 
     void setTransactionStart(TransactionStart transactionStart) {
+        mFrameTransactionCount++;
 
         if (transactionStart == TransactionStart::EARLY) {
+            mEarlyTransactionCount++;
             mRemainingEarlyFrameCount = MIN_EARLY_FRAME_COUNT;
         }
 
@@ -96,6 +123,44 @@ public:
         updateOffsets();
     }
 
+    // Called whenever the active config's vsync period is (re)learned. The period defines the
+    // CPU budget a frame has between SF's wakeup and the next deadline.
+    void setDisplayRefreshPeriod(nsecs_t period) {
+        mRefreshPeriod = period;
+    }
+
+    // Feeds the measured main-thread cost of the last frame (invalidate plus refresh work).
+    // When frames repeatedly overrun the budget the late offsets leave before the next vsync,
+    // SF's wakeup is moved earlier in the interval by switching to the early offsets; once
+    // frames fit comfortably again the wakeup moves back.
+    void onFrameCpuDuration(nsecs_t duration) {
+        const nsecs_t period = mRefreshPeriod;
+        if (period <= 0) {
+            return;
+        }
+        const nsecs_t budget = period - mLateOffsets.sf - DEADLINE_MARGIN_NS;
+        if (duration > budget) {
+            mFitStreak = 0;
+            if (mOverrunStreak < OVERRUN_STREAK_TO_SHIFT) {
+                mOverrunStreak++;
+            }
+            if (!mDurationPressure && mOverrunStreak >= OVERRUN_STREAK_TO_SHIFT) {
+                mDurationPressure = true;
+                mDurationShiftCount++;
+                updateOffsets();
+            }
+        } else {
+            mOverrunStreak = 0;
+            if (mFitStreak < FIT_STREAK_TO_RELAX) {
+                mFitStreak++;
+            }
+            if (mDurationPressure && mFitStreak >= FIT_STREAK_TO_RELAX) {
+                mDurationPressure = false;
+                updateOffsets();
+            }
+        }
+    }
+
     void onRefreshed(bool usedRenderEngine) {
         bool updateOffsetsNeeded = false;
         if (mRemainingEarlyFrameCount > 0) {
@@ -106,11 +171,52 @@ public:
             mLastFrameUsedRenderEngine = usedRenderEngine;
             updateOffsetsNeeded = true;
         }
+
+        // Update the transaction-traffic prediction with what arrived since the last refresh.
+        if (mFrameTransactionCount.exchange(0) > 0) {
+            if (mBusyFrameStreak < BUSY_FRAME_STREAK_TO_PREDICT) {
+                mBusyFrameStreak++;
+            }
+            mQuietFrameStreak = 0;
+        } else {
+            mBusyFrameStreak = 0;
+            if (mQuietFrameStreak < QUIET_FRAME_STREAK_TO_EXIT) {
+                mQuietFrameStreak++;
+            }
+        }
+        if (!mPredictedEarly && mBusyFrameStreak >= BUSY_FRAME_STREAK_TO_PREDICT) {
+            mPredictedEarly = true;
+            mPredictedEarlyPeriods++;
+            updateOffsetsNeeded = true;
+        } else if (mPredictedEarly && mQuietFrameStreak >= QUIET_FRAME_STREAK_TO_EXIT) {
+            mPredictedEarly = false;
+            updateOffsetsNeeded = true;
+        }
+
         if (updateOffsetsNeeded) {
             updateOffsets();
         }
     }
 
+    void dump(String8& result) const {
+        const Offsets offsets = mOffsets;
+        result.appendFormat("VSyncModulator: sf phase %" PRId64 " ns, app phase %" PRId64 " ns, "
+                            "transactionStart=%s, predictedEarly=%s\n",
+                            offsets.sf, offsets.app,
+                            mTransactionStart == TransactionStart::EARLY ? "early" : "normal",
+                            mPredictedEarly ? "true" : "false");
+        result.appendFormat("  busy frame streak: %d, quiet frame streak: %d\n",
+                            mBusyFrameStreak.load(), mQuietFrameStreak.load());
+        result.appendFormat("  early transactions: %u, predicted early periods: %u, "
+                            "offset switches: %u\n",
+                            mEarlyTransactionCount.load(), mPredictedEarlyPeriods.load(),
+                            mOffsetSwitchCount.load());
+        result.appendFormat("  duration pressure: %s, overrun streak: %d, "
+                            "duration-driven shifts: %u\n",
+                            mDurationPressure ? "true" : "false", mOverrunStreak.load(),
+                            mDurationShiftCount.load());
+    }
+
 private:
 
     void updateOffsets() {
@@ -129,11 +235,13 @@ private:
 
         if (changed) {
             mOffsets = desired;
+            mOffsetSwitchCount++;
         }
     }
 
     Offsets getOffsets() {
-        if (mTransactionStart == TransactionStart::EARLY || mRemainingEarlyFrameCount > 0) {
+        if (mTransactionStart == TransactionStart::EARLY || mRemainingEarlyFrameCount > 0 ||
+            mPredictedEarly || mDurationPressure) {
             return mEarlyOffsets;
         } else if (mLastFrameUsedRenderEngine) {
             return mEarlyGlOffsets;
@@ -154,6 +262,26 @@ private:
     std::atomic<TransactionStart> mTransactionStart = TransactionStart::NORMAL;
     std::atomic<bool> mLastFrameUsedRenderEngine = false;
     std::atomic<int> mRemainingEarlyFrameCount = 0;
+
+    // Transaction-traffic prediction state: transactions that arrived since the last refresh,
+    // and how many consecutive refreshes have (or haven't) seen transactions.
+    std::atomic<int> mFrameTransactionCount = 0;
+    std::atomic<int> mBusyFrameStreak = 0;
+    std::atomic<int> mQuietFrameStreak = 0;
+    std::atomic<bool> mPredictedEarly = false;
+
+    // Frame-pacing state: the vsync period, how many consecutive frames overran (or fit) the
+    // late-offset budget, and whether that pressure currently holds the early offsets.
+    std::atomic<nsecs_t> mRefreshPeriod = 0;
+    std::atomic<int> mOverrunStreak = 0;
+    std::atomic<int> mFitStreak = 0;
+    std::atomic<bool> mDurationPressure = false;
+
+    // Offset-decision statistics surfaced in dumpsys.
+    std::atomic<uint32_t> mEarlyTransactionCount = 0;
+    std::atomic<uint32_t> mPredictedEarlyPeriods = 0;
+    std::atomic<uint32_t> mOffsetSwitchCount = 0;
+    std::atomic<uint32_t> mDurationShiftCount = 0;
 };
 
 } // namespace android
@@ -49,8 +49,9 @@ class EventThreadTest : public testing::Test {
 protected:
     class MockEventThreadConnection : public android::impl::EventThread::Connection {
     public:
-        explicit MockEventThreadConnection(android::impl::EventThread* eventThread)
-              : android::impl::EventThread::Connection(eventThread) {}
+        explicit MockEventThreadConnection(android::impl::EventThread* eventThread,
+                                           int32_t count = -1, uint32_t phase = 0)
+              : android::impl::EventThread::Connection(eventThread, count, phase) {}
         MOCK_METHOD1(postEvent, status_t(const DisplayEventReceiver::Event& event));
     };
 
@@ -61,7 +62,8 @@ protected:
     ~EventThreadTest() override;
 
     void createThread();
-    sp<MockEventThreadConnection> createConnection(ConnectionEventRecorder& recorder);
+    sp<MockEventThreadConnection> createConnection(ConnectionEventRecorder& recorder,
+                                                   int32_t count = -1, uint32_t phase = 0);
 
     void expectVSyncSetEnabledCallReceived(bool expectedState);
     void expectVSyncSetPhaseOffsetCallReceived(nsecs_t expectedPhaseOffset);
@@ -118,8 +120,9 @@ void EventThreadTest::createThread() {
 }
 
 sp<EventThreadTest::MockEventThreadConnection> EventThreadTest::createConnection(
-        ConnectionEventRecorder& recorder) {
-    sp<MockEventThreadConnection> connection = new MockEventThreadConnection(mThread.get());
+        ConnectionEventRecorder& recorder, int32_t count, uint32_t phase) {
+    sp<MockEventThreadConnection> connection =
+            new MockEventThreadConnection(mThread.get(), count, phase);
     EXPECT_CALL(*connection, postEvent(_)).WillRepeatedly(Invoke(recorder.getInvocable()));
     return connection;
 }
@@ -313,6 +316,33 @@ TEST_F(EventThreadTest, setVsyncRateTwoPostsEveryOtherEventToThatConnection) {
     expectVsyncEventReceivedByConnection(101112, 4u);
 }
 
+TEST_F(EventThreadTest, vsyncRateTwoWithPhaseOnePostsOddEventsToThatConnection) {
+    ConnectionEventRecorder phaseConnectionEventRecorder{0};
+    sp<MockEventThreadConnection> phaseConnection =
+            createConnection(phaseConnectionEventRecorder, 2, 1);
+
+    // EventThread should enable vsync callbacks, and set a callback interface
+    // pointer to use them with the VSync source.
+    expectVSyncSetEnabledCallReceived(true);
+    auto callback = expectVSyncSetCallbackCallReceived();
+    ASSERT_TRUE(callback);
+
+    // With rate 2 and phase 1, the first event lands on the connection's beat.
+    callback->onVSyncEvent(123);
+    expectInterceptCallReceived(123);
+    expectVsyncEventReceivedByConnection("phaseConnection", phaseConnectionEventRecorder, 123, 1u);
+
+    // The second event is the off beat, and is only seen by the interceptor.
+    callback->onVSyncEvent(456);
+    expectInterceptCallReceived(456);
+    EXPECT_FALSE(phaseConnectionEventRecorder.waitForUnexpectedCall().has_value());
+
+    // The third event lands on the connection's beat again.
+    callback->onVSyncEvent(789);
+    expectInterceptCallReceived(789);
+    expectVsyncEventReceivedByConnection("phaseConnection", phaseConnectionEventRecorder, 789, 3u);
+}
+
 TEST_F(EventThreadTest, connectionsRemovedIfInstanceDestroyed) {
     mThread->setVsyncRate(1, mConnection);
 
@@ -154,6 +154,9 @@ public:
         FakePowerAdvisor() = default;
         ~FakePowerAdvisor() override = default;
         void setExpensiveRenderingExpected(hwc2_display_t, bool) override { }
+        void notifyFrameBegin(nsecs_t) override { }
+        void notifyFrameEnd(nsecs_t, nsecs_t) override { }
+        void dump(String8&) const override { }
     };
 
     struct HWC2Display : public HWC2::Display {
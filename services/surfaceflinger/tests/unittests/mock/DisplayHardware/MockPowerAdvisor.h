@@ -30,6 +30,9 @@ public:
     ~PowerAdvisor() override;
 
     MOCK_METHOD2(setExpensiveRenderingExpected, void(hwc2_display_t displayId, bool expected));
+    MOCK_METHOD1(notifyFrameBegin, void(nsecs_t refreshPeriod));
+    MOCK_METHOD2(notifyFrameEnd, void(nsecs_t frameCpuTime, nsecs_t refreshPeriod));
+    MOCK_CONST_METHOD1(dump, void(String8& result));
 };
 
 } // namespace mock
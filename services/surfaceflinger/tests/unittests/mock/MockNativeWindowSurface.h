@@ -32,6 +32,7 @@ public:
 
     MOCK_CONST_METHOD0(getNativeWindow, sp<ANativeWindow>());
     MOCK_METHOD0(preallocateBuffers, void());
+    MOCK_METHOD0(enableDequeueBufferPrefetch, void());
 };
 
 } // namespace mock
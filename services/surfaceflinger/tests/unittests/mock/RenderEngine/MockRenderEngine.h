@@ -72,6 +72,9 @@ public:
                  void(ANativeWindowBuffer*, RE::BindNativeBufferAsFramebuffer*));
     MOCK_METHOD1(unbindNativeBufferAsFrameBuffer, void(RE::BindNativeBufferAsFramebuffer*));
     MOCK_METHOD1(drawMesh, void(const Mesh&));
+    MOCK_METHOD0(beginGpuFrameTimer, void());
+    MOCK_METHOD0(endGpuFrameTimer, void());
+    MOCK_METHOD0(takeGpuFrameTime, nsecs_t());
     MOCK_CONST_METHOD0(getMaxTextureSize, size_t());
     MOCK_CONST_METHOD0(getMaxViewportDims, size_t());
 };
@@ -85,6 +88,8 @@ public:
     MOCK_METHOD1(setAsync, void(bool));
     MOCK_METHOD1(setNativeWindow, void(ANativeWindow*));
     MOCK_CONST_METHOD0(swapBuffers, void());
+    MOCK_CONST_METHOD0(queryBufferAge, int32_t());
+    MOCK_CONST_METHOD1(setDamageRegion, void(const Region&));
     MOCK_CONST_METHOD0(queryRedSize, int32_t());
     MOCK_CONST_METHOD0(queryGreenSize, int32_t());
     MOCK_CONST_METHOD0(queryBlueSize, int32_t());
@@ -14,12 +14,22 @@
  * limitations under the License.
  */
 
+#define LOG_TAG "ThermalService"
+
 #include "ThermalService.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
 #include <android/os/IThermalService.h>
 #include <android/os/IThermalEventListener.h>
 #include <android/os/Temperature.h>
 #include <binder/IPCThreadState.h>
 #include <binder/IServiceManager.h>
+#include <cutils/ashmem.h>
+#include <log/log.h>
 #include <utils/Errors.h>
 #include <utils/Mutex.h>
 #include <utils/String16.h>
@@ -27,6 +37,82 @@
 namespace android {
 namespace os {
 
+ThermalService::ThermalService() : mThrottled(false), mStatePage(nullptr) {
+    initStatePage();
+}
+
+/**
+ * Create the ashmem region backing the shared thermal state page, keep a
+ * private writable mapping, then drop write permission from the region so
+ * clients can only ever map it read-only.
+ */
+void ThermalService::initStatePage() {
+    int fd = ashmem_create_region("thermal_state", sizeof(ThermalStatePage));
+    if (fd < 0) {
+        ALOGE("unable to create thermal state region");
+        return;
+    }
+    mStateFd.reset(fd);
+
+    void* page = mmap(NULL, sizeof(ThermalStatePage), PROT_READ | PROT_WRITE, MAP_SHARED,
+                      mStateFd.get(), 0);
+    if (page == MAP_FAILED) {
+        ALOGE("unable to map thermal state region: %s", strerror(errno));
+        mStateFd.reset();
+        return;
+    }
+
+    if (ashmem_set_prot_region(mStateFd.get(), PROT_READ) < 0) {
+        ALOGE("unable to make thermal state region read-only: %s", strerror(errno));
+        munmap(page, sizeof(ThermalStatePage));
+        mStateFd.reset();
+        return;
+    }
+
+    mStatePage = new (page) ThermalStatePage();
+    mStatePage->mSeq.store(0, std::memory_order_relaxed);
+    mStatePage->mThrottling = 0;
+    mStatePage->mZoneCount = 0;
+    mStatePage->mVersion = ThermalStatePage::kVersion;
+    // Write the magic last so a client that races initialization sees an
+    // invalid page rather than a half-initialized one.
+    mStatePage->mMagic = ThermalStatePage::kMagic;
+}
+
+/**
+ * Mirror a throttling event into the shared state page using the seqlock
+ * protocol: readers retry while the sequence number is odd.
+ */
+void ThermalService::publishStateLocked(bool isThrottling,
+                                        const Temperature& temperature) {
+    if (mStatePage == nullptr) {
+        return;
+    }
+
+    const uint32_t seq = mStatePage->mSeq.load(std::memory_order_relaxed);
+    mStatePage->mSeq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    mStatePage->mThrottling = isThrottling ? 1 : 0;
+
+    const int32_t type = static_cast<int32_t>(temperature.getType());
+    uint32_t i;
+    for (i = 0; i < mStatePage->mZoneCount; i++) {
+        if (mStatePage->mZones[i].type == type) {
+            break;
+        }
+    }
+    if (i < ThermalStatePage::kMaxZones) {
+        mStatePage->mZones[i].type = type;
+        mStatePage->mZones[i].value = temperature.getValue();
+        if (i == mStatePage->mZoneCount) {
+            mStatePage->mZoneCount = i + 1;
+        }
+    }
+
+    mStatePage->mSeq.store(seq + 2, std::memory_order_release);
+}
+
 /**
  * Notify registered listeners of a thermal throttling start/stop event.
  * @param temperature the temperature at which the event was generated
@@ -37,6 +123,7 @@ binder::Status ThermalService::notifyThrottling(
 
     mThrottled = isThrottling;
     mThrottleTemperature = temperature;
+    publishStateLocked(isThrottling, temperature);
 
     for (size_t i = 0; i < mListeners.size(); i++) {
       mListeners[i]->notifyThrottling(isThrottling, temperature);
@@ -54,6 +141,24 @@ binder::Status ThermalService::isThrottling(bool* _aidl_return) {
     return binder::Status::ok();
 }
 
+/**
+ * Return a dup of the shared thermal state region for the client to map
+ * read-only; see ThermalStatePage.h for the layout and read protocol.
+ */
+binder::Status ThermalService::getThermalStateRegion(
+    base::unique_fd* _aidl_return) {
+    if (mStateFd.get() < 0) {
+        return binder::Status::fromExceptionCode(
+            binder::Status::EX_ILLEGAL_STATE, "thermal state region unavailable");
+    }
+    _aidl_return->reset(fcntl(mStateFd.get(), F_DUPFD_CLOEXEC, 0));
+    if (_aidl_return->get() < 0) {
+        return binder::Status::fromExceptionCode(
+            binder::Status::EX_ILLEGAL_STATE, "unable to dup thermal state region");
+    }
+    return binder::Status::ok();
+}
+
 /**
  * Register a new thermal event listener.
  * @param listener the client's IThermalEventListener instance to which
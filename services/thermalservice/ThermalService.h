@@ -17,9 +17,11 @@
 #ifndef ANDROID_THERMALSERVICE_THERMALSERVICE_H
 #define ANDROID_THERMALSERVICE_THERMALSERVICE_H
 
+#include <android-base/unique_fd.h>
 #include <android/os/BnThermalService.h>
 #include <android/os/IThermalEventListener.h>
 #include <android/os/Temperature.h>
+#include <thermalservice/ThermalStatePage.h>
 #include <utils/Mutex.h>
 #include <utils/String16.h>
 #include <utils/Vector.h>
@@ -30,7 +32,7 @@ namespace os {
 class ThermalService : public BnThermalService,
                        public IBinder::DeathRecipient {
 public:
-  ThermalService() : mThrottled(false) {};
+    ThermalService();
     void publish(const sp<ThermalService>& service);
     binder::Status notifyThrottling(
         const bool isThrottling, const Temperature& temperature);
@@ -40,13 +42,24 @@ private:
     Vector<sp<IThermalEventListener> > mListeners;
     bool mThrottled;
     Temperature mThrottleTemperature;
+    // Read-only-mappable ashmem region mirroring the current thermal state,
+    // handed out by getThermalStateRegion(). mStatePage is our private
+    // writable mapping; both stay null if the region could not be created.
+    base::unique_fd mStateFd;
+    ThermalStatePage* mStatePage;
 
     binder::Status registerThermalEventListener(
         const sp<IThermalEventListener>& listener);
     binder::Status unregisterThermalEventListener(
         const sp<IThermalEventListener>& listener);
     binder::Status isThrottling(bool* _aidl_return);
+    binder::Status getThermalStateRegion(base::unique_fd* _aidl_return);
     void binderDied(const wp<IBinder>& who);
+
+    // Creates and maps the shared state page. Called once at construction.
+    void initStatePage();
+    // Mirrors the latest event into the state page under mListenersLock.
+    void publishStateLocked(bool isThrottling, const Temperature& temperature);
 };
 
 };  // namespace os
@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_THERMALSERVICE_THERMAL_STATE_PAGE_H
+#define ANDROID_THERMALSERVICE_THERMAL_STATE_PAGE_H
+
+#include <atomic>
+#include <stdint.h>
+
+namespace android {
+namespace os {
+
+/*
+ * Layout of the shared-memory page thermalservice publishes its current
+ * thermal state into. Clients obtain the region with
+ * IThermalService::getThermalStateRegion(), map it read-only, and read it
+ * with readThermalState() below; after that, polling the thermal state is a
+ * few loads instead of a binder round trip.
+ *
+ * The page is guarded by a seqlock: mSeq is odd while the service is writing
+ * and bumped to the next even value when the write completes. thermalservice
+ * is the only writer, so readers never spin for longer than one update.
+ */
+
+struct ThermalStateZone {
+    // An enum temperature_type from hardware/thermal.h.
+    int32_t type;
+    // Current temperature in degrees Celsius, or NAN if unknown.
+    float value;
+};
+
+struct ThermalStatePage {
+    static constexpr uint32_t kMagic = 0x4c4d5254; // 'TRML'
+    static constexpr uint32_t kVersion = 1;
+    // One slot per temperature type; hardware/thermal.h defines six.
+    static constexpr uint32_t kMaxZones = 16;
+
+    uint32_t mMagic;
+    uint32_t mVersion;
+    std::atomic<uint32_t> mSeq;
+    // Nonzero while the device is thermally throttling.
+    uint32_t mThrottling;
+    // Zone slots in first-seen order; slots are added but never removed.
+    uint32_t mZoneCount;
+    ThermalStateZone mZones[kMaxZones];
+};
+
+static_assert(sizeof(ThermalStatePage) <= 4096,
+              "ThermalStatePage must fit in a single page");
+
+/*
+ * Copies a consistent snapshot of the page into |throttling|, |zones| and
+ * |zoneCount|. |zones| must have room for ThermalStatePage::kMaxZones
+ * entries. Returns false if the page is not valid (wrong magic or a version
+ * this reader does not understand) or if a consistent snapshot could not be
+ * obtained after a bounded number of retries.
+ */
+inline bool readThermalState(const ThermalStatePage* page, bool* throttling,
+                             ThermalStateZone* zones, uint32_t* zoneCount) {
+    if (page->mMagic != ThermalStatePage::kMagic ||
+            page->mVersion != ThermalStatePage::kVersion) {
+        return false;
+    }
+    for (int retries = 0; retries < 100; retries++) {
+        const uint32_t seq = page->mSeq.load(std::memory_order_acquire);
+        if (seq & 1) {
+            continue; // write in progress
+        }
+        const uint32_t count =
+                (page->mZoneCount <= ThermalStatePage::kMaxZones) ? page->mZoneCount
+                                                                  : ThermalStatePage::kMaxZones;
+        const bool isThrottling = page->mThrottling != 0;
+        for (uint32_t i = 0; i < count; i++) {
+            zones[i] = page->mZones[i];
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (page->mSeq.load(std::memory_order_relaxed) == seq) {
+            *throttling = isThrottling;
+            *zoneCount = count;
+            return true;
+        }
+    }
+    return false;
+}
+
+}  // namespace os
+}  // namespace android
+
+#endif  // ANDROID_THERMALSERVICE_THERMAL_STATE_PAGE_H
@@ -19,11 +19,15 @@
 #include <alloca.h>
 #include <dirent.h>
 #include <dlfcn.h>
+#include <fcntl.h>
 #include <string.h>
 #include <sys/prctl.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include <mutex>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include <android/dlext.h>
@@ -66,6 +70,303 @@ namespace {
 
 const char kSystemLayerLibraryDir[] = "/data/local/debug/vulkan";
 
+// ----------------------------------------------------------------------------
+
+// LayerDiscoveryCache persists the result of probing layer libraries across
+// application launches. Probing a candidate costs a dlopen, several
+// enumeration calls into the library and a dlclose; with a handful of layer
+// libraries that adds tens of milliseconds to every launch. A record is
+// keyed by the library path and validated against the size and mtime of the
+// backing file (the APK, for libraries loaded out of one), so an app or
+// system update invalidates it automatically.
+//
+// The cache file path is provided by the platform via
+// GraphicsEnv::setLayerDiscoveryCachePath; when no path is set (the
+// default), discovery behaves as before.
+class LayerDiscoveryCache {
+   public:
+    struct Library {
+        uint64_t file_size;
+        int64_t file_mtime;
+        // the probed layers; empty if the library opened but enumeration
+        // failed, so known-bad candidates aren't re-probed either.
+        std::vector<Layer> layers;
+    };
+
+    // Load reads the cache file. Called once at the start of discovery.
+    void Load(const std::string& path);
+
+    // Lookup returns the record for a library if its backing file is
+    // unchanged, or nullptr if the library must be probed.
+    const Library* Lookup(const std::string& library_path);
+
+    // Record remembers the layers that probing library_path appended to
+    // g_instance_layers starting at first_layer.
+    void Record(const std::string& library_path,
+                const std::vector<Layer>& instance_layers,
+                size_t first_layer);
+
+    // Save writes the cache file back if any record changed. Called once
+    // at the end of discovery.
+    void Save();
+
+   private:
+    static bool StatBackingFile(const std::string& library_path,
+                                uint64_t* file_size,
+                                int64_t* file_mtime);
+
+    std::string path_;
+    bool dirty_ = false;
+    std::unordered_map<std::string, Library> libraries_;
+};
+
+LayerDiscoveryCache g_discovery_cache;
+
+// Cache file layout: CacheFileHeader, then per library a CacheLibraryHeader
+// followed by the path bytes and CacheLayer records, each of those followed
+// by its raw VkExtensionProperties arrays. Values are host-endian; the file
+// never leaves the device. The CRC covers everything after the header.
+constexpr uint32_t kCacheFileMagic = 0x566b4c43;  // 'VkLC'
+constexpr uint32_t kCacheFileVersion = 1;
+
+struct CacheFileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t crc;
+    uint32_t library_count;
+};
+
+struct CacheLibraryHeader {
+    uint64_t file_size;
+    int64_t file_mtime;
+    uint32_t path_len;
+    uint32_t layer_count;
+};
+
+struct CacheLayer {
+    VkLayerProperties properties;
+    uint32_t is_global;
+    uint32_t num_instance_extensions;
+    uint32_t num_device_extensions;
+};
+
+uint32_t CacheCrc(const uint8_t* buf, size_t len) {
+    const uint32_t poly_bits = 0x82F63B78;
+    uint32_t r = 0;
+    for (size_t i = 0; i < len; i++) {
+        r ^= buf[i];
+        for (int j = 0; j < 8; j++)
+            r = (r & 1) ? (r >> 1) ^ poly_bits : r >> 1;
+    }
+    return r;
+}
+
+void CacheAppend(std::vector<uint8_t>& buf, const void* data, size_t size) {
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    buf.insert(buf.end(), p, p + size);
+}
+
+bool CacheRead(const uint8_t*& p, const uint8_t* end, void* out, size_t size) {
+    if (size > static_cast<size_t>(end - p))
+        return false;
+    memcpy(out, p, size);
+    p += size;
+    return true;
+}
+
+bool LayerDiscoveryCache::StatBackingFile(const std::string& library_path,
+                                          uint64_t* file_size,
+                                          int64_t* file_mtime) {
+    // For a library inside an APK ("....apk!/lib/<abi>/libVkLayer*.so") the
+    // APK is the file that changes when the app updates.
+    std::string file_path = library_path;
+    size_t zip_pos = file_path.find("!/");
+    if (zip_pos != std::string::npos)
+        file_path.resize(zip_pos);
+    struct stat st;
+    if (stat(file_path.c_str(), &st) != 0)
+        return false;
+    *file_size = static_cast<uint64_t>(st.st_size);
+    *file_mtime =
+        int64_t(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+    return true;
+}
+
+void LayerDiscoveryCache::Load(const std::string& path) {
+    path_ = path;
+    if (path_.empty())
+        return;
+
+    int fd = open(path_.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        ALOGW_IF(errno != ENOENT,
+                 "failed to open layer discovery cache '%s': %s", path_.c_str(),
+                 strerror(errno));
+        return;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < off_t(sizeof(CacheFileHeader))) {
+        close(fd);
+        return;
+    }
+    std::vector<uint8_t> buf(static_cast<size_t>(st.st_size));
+    ssize_t nread = read(fd, buf.data(), buf.size());
+    close(fd);
+    if (nread != static_cast<ssize_t>(buf.size()))
+        return;
+
+    const uint8_t* p = buf.data();
+    const uint8_t* end = p + buf.size();
+    CacheFileHeader header;
+    CacheRead(p, end, &header, sizeof(header));
+    if (header.magic != kCacheFileMagic ||
+        header.version != kCacheFileVersion ||
+        header.crc != CacheCrc(p, static_cast<size_t>(end - p))) {
+        ALOGW("ignoring invalid layer discovery cache '%s'", path_.c_str());
+        return;
+    }
+
+    for (uint32_t i = 0; i < header.library_count; i++) {
+        CacheLibraryHeader lib_header;
+        if (!CacheRead(p, end, &lib_header, sizeof(lib_header)) ||
+            lib_header.path_len > static_cast<size_t>(end - p)) {
+            libraries_.clear();
+            return;
+        }
+        std::string library_path(reinterpret_cast<const char*>(p),
+                                 lib_header.path_len);
+        p += lib_header.path_len;
+
+        Library library;
+        library.file_size = lib_header.file_size;
+        library.file_mtime = lib_header.file_mtime;
+        library.layers.reserve(lib_header.layer_count);
+        for (uint32_t j = 0; j < lib_header.layer_count; j++) {
+            CacheLayer cache_layer;
+            if (!CacheRead(p, end, &cache_layer, sizeof(cache_layer))) {
+                libraries_.clear();
+                return;
+            }
+            Layer layer;
+            layer.properties = cache_layer.properties;
+            layer.library_idx = 0;  // rewritten when the record is used
+            layer.is_global = (cache_layer.is_global != 0);
+            layer.instance_extensions.resize(
+                cache_layer.num_instance_extensions);
+            layer.device_extensions.resize(cache_layer.num_device_extensions);
+            if (!CacheRead(p, end, layer.instance_extensions.data(),
+                           layer.instance_extensions.size() *
+                               sizeof(VkExtensionProperties)) ||
+                !CacheRead(p, end, layer.device_extensions.data(),
+                           layer.device_extensions.size() *
+                               sizeof(VkExtensionProperties))) {
+                libraries_.clear();
+                return;
+            }
+            library.layers.push_back(std::move(layer));
+        }
+        libraries_.emplace(std::move(library_path), std::move(library));
+    }
+}
+
+const LayerDiscoveryCache::Library* LayerDiscoveryCache::Lookup(
+    const std::string& library_path) {
+    if (path_.empty())
+        return nullptr;
+    auto it = libraries_.find(library_path);
+    if (it == libraries_.end())
+        return nullptr;
+    uint64_t file_size;
+    int64_t file_mtime;
+    if (!StatBackingFile(library_path, &file_size, &file_mtime))
+        return nullptr;
+    if (it->second.file_size != file_size ||
+        it->second.file_mtime != file_mtime) {
+        ALOGV("layer library '%s' changed, re-probing", library_path.c_str());
+        libraries_.erase(it);
+        dirty_ = true;
+        return nullptr;
+    }
+    return &it->second;
+}
+
+void LayerDiscoveryCache::Record(const std::string& library_path,
+                                 const std::vector<Layer>& instance_layers,
+                                 size_t first_layer) {
+    if (path_.empty())
+        return;
+    uint64_t file_size;
+    int64_t file_mtime;
+    if (!StatBackingFile(library_path, &file_size, &file_mtime))
+        return;
+    Library& library = libraries_[library_path];
+    library.file_size = file_size;
+    library.file_mtime = file_mtime;
+    library.layers.assign(instance_layers.begin() + ssize_t(first_layer),
+                          instance_layers.end());
+    dirty_ = true;
+}
+
+void LayerDiscoveryCache::Save() {
+    if (path_.empty() || !dirty_)
+        return;
+    dirty_ = false;
+
+    std::vector<uint8_t> buf(sizeof(CacheFileHeader));
+    for (const auto& entry : libraries_) {
+        CacheLibraryHeader lib_header;
+        lib_header.file_size = entry.second.file_size;
+        lib_header.file_mtime = entry.second.file_mtime;
+        lib_header.path_len = static_cast<uint32_t>(entry.first.size());
+        lib_header.layer_count =
+            static_cast<uint32_t>(entry.second.layers.size());
+        CacheAppend(buf, &lib_header, sizeof(lib_header));
+        CacheAppend(buf, entry.first.data(), entry.first.size());
+        for (const Layer& layer : entry.second.layers) {
+            CacheLayer cache_layer;
+            cache_layer.properties = layer.properties;
+            cache_layer.is_global = layer.is_global ? 1 : 0;
+            cache_layer.num_instance_extensions =
+                static_cast<uint32_t>(layer.instance_extensions.size());
+            cache_layer.num_device_extensions =
+                static_cast<uint32_t>(layer.device_extensions.size());
+            CacheAppend(buf, &cache_layer, sizeof(cache_layer));
+            CacheAppend(buf, layer.instance_extensions.data(),
+                        layer.instance_extensions.size() *
+                            sizeof(VkExtensionProperties));
+            CacheAppend(buf, layer.device_extensions.data(),
+                        layer.device_extensions.size() *
+                            sizeof(VkExtensionProperties));
+        }
+    }
+
+    CacheFileHeader* header = reinterpret_cast<CacheFileHeader*>(buf.data());
+    header->magic = kCacheFileMagic;
+    header->version = kCacheFileVersion;
+    header->library_count = static_cast<uint32_t>(libraries_.size());
+    header->crc = CacheCrc(buf.data() + sizeof(CacheFileHeader),
+                           buf.size() - sizeof(CacheFileHeader));
+
+    // Write to a temporary and rename so a crash can't leave a torn file.
+    std::string tmp_path = path_ + ".tmp";
+    int fd = open(tmp_path.c_str(), O_CREAT | O_TRUNC | O_WRONLY | O_CLOEXEC,
+                  S_IRUSR | S_IWUSR);
+    if (fd < 0) {
+        ALOGW("failed to create layer discovery cache '%s': %s",
+              tmp_path.c_str(), strerror(errno));
+        return;
+    }
+    if (write(fd, buf.data(), buf.size()) != static_cast<ssize_t>(buf.size()) ||
+        rename(tmp_path.c_str(), path_.c_str()) != 0) {
+        ALOGW("failed to write layer discovery cache '%s': %s", path_.c_str(),
+              strerror(errno));
+        unlink(tmp_path.c_str());
+    }
+    close(fd);
+}
+
+// ----------------------------------------------------------------------------
+
 class LayerLibrary {
    public:
     explicit LayerLibrary(const std::string& path,
@@ -315,17 +616,43 @@ std::vector<LayerLibrary> g_layer_libraries;
 std::vector<Layer> g_instance_layers;
 
 void AddLayerLibrary(const std::string& path, const std::string& filename) {
-    LayerLibrary library(path + "/" + filename, filename);
+    std::string library_path = path + "/" + filename;
+
+    if (const LayerDiscoveryCache::Library* cached =
+            g_discovery_cache.Lookup(library_path)) {
+        // The library is unchanged since it was last probed; reuse its
+        // layers without dlopening it. An empty record means probing
+        // failed, so the candidate is skipped entirely.
+        if (cached->layers.empty())
+            return;
+        size_t library_idx = g_layer_libraries.size();
+        for (const Layer& cached_layer : cached->layers) {
+            Layer layer = cached_layer;
+            layer.library_idx = library_idx;
+            ALOGD("added %s layer '%s' from library '%s' (cached)",
+                  (layer.is_global) ? "global" : "instance",
+                  layer.properties.layerName, library_path.c_str());
+            g_instance_layers.push_back(std::move(layer));
+        }
+        g_layer_libraries.emplace_back(LayerLibrary(library_path, filename));
+        return;
+    }
+
+    LayerLibrary library(library_path, filename);
     if (!library.Open())
         return;
 
+    size_t first_layer = g_instance_layers.size();
     if (!library.EnumerateLayers(g_layer_libraries.size(), g_instance_layers)) {
         library.Close();
+        // remember the failure so the library isn't re-probed next launch
+        g_discovery_cache.Record(library_path, g_instance_layers, first_layer);
         return;
     }
 
     library.Close();
 
+    g_discovery_cache.Record(library_path, g_instance_layers, first_layer);
     g_layer_libraries.emplace_back(std::move(library));
 }
 
@@ -451,12 +778,15 @@ void* GetLayerGetProcAddr(const Layer& layer,
 }  // anonymous namespace
 
 void DiscoverLayers() {
+    g_discovery_cache.Load(
+        android::GraphicsEnv::getInstance().getLayerDiscoveryCachePath());
     if (property_get_bool("ro.debuggable", false) &&
         prctl(PR_GET_DUMPABLE, 0, 0, 0, 0)) {
         DiscoverLayersInPathList(kSystemLayerLibraryDir);
     }
     if (!android::GraphicsEnv::getInstance().getLayerPaths().empty())
         DiscoverLayersInPathList(android::GraphicsEnv::getInstance().getLayerPaths());
+    g_discovery_cache.Save();
 }
 
 uint32_t GetLayerCount() {
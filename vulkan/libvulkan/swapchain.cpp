@@ -186,6 +186,16 @@ struct Surface {
     android::sp<ANativeWindow> window;
     VkSwapchainKHR swapchain_handle;
     uint64_t consumer_usage;
+    // The buffer format and buffer count limit are fixed for the life of the
+    // surface, but querying them goes through the buffer queue producer -- a
+    // binder round trip for Surface-backed windows. Applications poll
+    // vkGetPhysicalDeviceSurfaceCapabilitiesKHR every frame to detect
+    // rotation, so cache these at surface creation instead of re-querying.
+    // The window's geometry and transform hint are not cached here: the
+    // window answers those queries from local state that the consumer pushes
+    // back on every queueBuffer, so they're cheap and may change per frame.
+    android_pixel_format native_format;
+    int max_buffer_count;
 };
 
 VkSurfaceKHR HandleFromSurface(Surface* surface) {
@@ -507,6 +517,28 @@ VkResult CreateAndroidSurfaceKHR(
         return VK_ERROR_INITIALIZATION_FAILED;
     }
 
+    ANativeWindow* window = surface->window.get();
+    int query_value;
+    err = window->query(window, NATIVE_WINDOW_FORMAT, &query_value);
+    if (err != 0 || query_value < 0) {
+        ALOGE("NATIVE_WINDOW_FORMAT query failed: %s (%d) value=%d",
+              strerror(-err), err, query_value);
+        surface->~Surface();
+        allocator->pfnFree(allocator->pUserData, surface);
+        return VK_ERROR_INITIALIZATION_FAILED;
+    }
+    surface->native_format = static_cast<android_pixel_format>(query_value);
+
+    err = window->query(window, NATIVE_WINDOW_MAX_BUFFER_COUNT, &query_value);
+    if (err != 0) {
+        ALOGE("NATIVE_WINDOW_MAX_BUFFER_COUNT query failed: %s (%d)",
+              strerror(-err), err);
+        surface->~Surface();
+        allocator->pfnFree(allocator->pUserData, surface);
+        return VK_ERROR_INITIALIZATION_FAILED;
+    }
+    surface->max_buffer_count = query_value;
+
     // TODO(jessehall): Create and use NATIVE_WINDOW_API_VULKAN.
     err =
         native_window_api_connect(surface->window.get(), NATIVE_WINDOW_API_EGL);
@@ -552,21 +584,9 @@ VkResult GetPhysicalDeviceSurfaceSupportKHR(VkPhysicalDevice /*pdev*/,
     if (!surface) {
         return VK_ERROR_SURFACE_LOST_KHR;
     }
-    const ANativeWindow* window = surface->window.get();
-
-    int query_value;
-    int err = window->query(window, NATIVE_WINDOW_FORMAT, &query_value);
-    if (err != 0 || query_value < 0) {
-        ALOGE("NATIVE_WINDOW_FORMAT query failed: %s (%d) value=%d",
-              strerror(-err), err, query_value);
-        return VK_ERROR_SURFACE_LOST_KHR;
-    }
-
-    android_pixel_format native_format =
-        static_cast<android_pixel_format>(query_value);
 
     bool format_supported = false;
-    switch (native_format) {
+    switch (surface->native_format) {
         case HAL_PIXEL_FORMAT_RGBA_8888:
         case HAL_PIXEL_FORMAT_RGB_565:
             format_supported = true;
@@ -591,10 +611,11 @@ VkResult GetPhysicalDeviceSurfaceSupportKHR(VkPhysicalDevice /*pdev*/,
 VKAPI_ATTR
 VkResult GetPhysicalDeviceSurfaceCapabilitiesKHR(
     VkPhysicalDevice /*pdev*/,
-    VkSurfaceKHR surface,
+    VkSurfaceKHR surface_handle,
     VkSurfaceCapabilitiesKHR* capabilities) {
     int err;
-    ANativeWindow* window = SurfaceFromHandle(surface)->window.get();
+    const Surface* surface = SurfaceFromHandle(surface_handle);
+    ANativeWindow* window = surface->window.get();
 
     int width, height;
     err = window->query(window, NATIVE_WINDOW_DEFAULT_WIDTH, &width);
@@ -619,13 +640,7 @@ VkResult GetPhysicalDeviceSurfaceCapabilitiesKHR(
     }
 
     // TODO(jessehall): Figure out what the min/max values should be.
-    int max_buffer_count;
-    err = window->query(window, NATIVE_WINDOW_MAX_BUFFER_COUNT, &max_buffer_count);
-    if (err != 0) {
-        ALOGE("NATIVE_WINDOW_MAX_BUFFER_COUNT query failed: %s (%d)",
-              strerror(-err), err);
-        return VK_ERROR_SURFACE_LOST_KHR;
-    }
+    int max_buffer_count = surface->max_buffer_count;
     capabilities->minImageCount = max_buffer_count == 1 ? 1 : 2;
     capabilities->maxImageCount = static_cast<uint32_t>(max_buffer_count);
 
@@ -29,7 +29,9 @@
 #include <cstdio>
 #include <limits>
 #include <memory>
+#include <ostream>
 #include <sstream>
+#include <streambuf>
 #include <type_traits>
 #include <utility>
 
@@ -829,7 +831,12 @@ inline Json::Value ToJsonValue(const T& value) {
 template <typename T>
 inline Json::Value ArrayToJsonValue(uint32_t count, const T* values) {
   Json::Value array(Json::arrayValue);
-  for (unsigned int i = 0; i < count; ++i) array.append(ToJsonValue(values[i]));
+  for (unsigned int i = 0; i < count; ++i) {
+    // Build each element standalone and swap it in; append() would deep-copy
+    // the whole subtree.
+    Json::Value element = ToJsonValue(values[i]);
+    array.append(Json::Value()).swap(element);
+  }
   return array;
 }
 
@@ -853,15 +860,20 @@ inline Json::Value ToJsonValue(const std::vector<T>& value) {
 template <typename F, typename S>
 inline Json::Value ToJsonValue(const std::pair<F, S>& value) {
   Json::Value array(Json::arrayValue);
-  array.append(ToJsonValue(value.first));
-  array.append(ToJsonValue(value.second));
+  Json::Value first = ToJsonValue(value.first);
+  Json::Value second = ToJsonValue(value.second);
+  array.append(Json::Value()).swap(first);
+  array.append(Json::Value()).swap(second);
   return array;
 }
 
 template <typename F, typename S>
 inline Json::Value ToJsonValue(const std::map<F, S>& value) {
   Json::Value array(Json::arrayValue);
-  for (auto& kv : value) array.append(ToJsonValue(kv));
+  for (auto& kv : value) {
+    Json::Value element = ToJsonValue(kv);
+    array.append(Json::Value()).swap(element);
+  }
   return array;
 }
 
@@ -872,18 +884,25 @@ class JsonWriterVisitor {
   ~JsonWriterVisitor() {}
 
   template <typename T> bool Visit(const char* key, const T* value) {
-    object_[key] = ToJsonValue(*value);
+    Json::Value json_value = ToJsonValue(*value);
+    object_[key].swap(json_value);
     return true;
   }
 
   template <typename T, uint32_t N>
   bool VisitArray(const char* key, uint32_t count, const T (*value)[N]) {
     assert(count <= N);
-    object_[key] = ArrayToJsonValue(count, *value);
+    Json::Value json_value = ArrayToJsonValue(count, *value);
+    object_[key].swap(json_value);
     return true;
   }
 
-  Json::Value get_object() const { return object_; }
+  // Steals the built tree; the visitor is left empty and must not be reused.
+  Json::Value take_object() {
+    Json::Value object(Json::objectValue);
+    object.swap(object_);
+    return object;
+  }
 
  private:
   Json::Value object_;
@@ -898,7 +917,7 @@ template <typename T, typename /*= EnableForStruct<T>*/, typename /*= void*/>
 Json::Value ToJsonValue(const T& value) {
   JsonWriterVisitor visitor;
   VisitForWrite(&visitor, value);
-  return visitor.get_object();
+  return visitor.take_object();
 }
 
 template <typename T, typename = EnableForStruct<T>>
@@ -1071,10 +1090,39 @@ bool AsValue(Json::Value* json_value, T* t) {
 }
 
 
+// Streams styled JSON straight into a std::string so serialization appends
+// to one growing buffer instead of concatenating a temporary per node the
+// way Value::toStyledString() does.
+class StringStreambuf : public std::streambuf {
+ public:
+  explicit StringStreambuf(std::string* out) : out_(out) {}
+
+  std::streamsize xsputn(const char* s, std::streamsize n) override {
+    out_->append(s, static_cast<size_t>(n));
+    return n;
+  }
+
+  int overflow(int c) override {
+    if (c != EOF)
+      out_->push_back(static_cast<char>(c));
+    return c;
+  }
+
+ private:
+  std::string* out_;
+};
+
 template <typename T> std::string VkTypeToJson(const T& t) {
   JsonWriterVisitor visitor;
   VisitForWrite(&visitor, t);
-  return visitor.get_object().toStyledString();
+
+  std::string result;
+  result.reserve(1 << 16);
+  StringStreambuf streambuf(&result);
+  std::ostream stream(&streambuf);
+  Json::StyledStreamWriter writer;
+  writer.write(stream, visitor.take_object());
+  return result;
 }
 
 template <typename T> bool VkTypeFromJson(const std::string& json,
@@ -25,7 +25,9 @@
 #include "vkjson.h"
 
 #include <algorithm>
+#include <thread>
 #include <utility>
+#include <vector>
 
 namespace {
 const char* kSupportedInstanceExtensions[] = {
@@ -55,6 +57,51 @@ bool HasExtension(const char* extension_name,
                       }) != extensions + count;
 }
 
+// Queries format properties for [first_format, last_format], striped across
+// a few worker threads. vkGetPhysicalDeviceFormatProperties has no
+// externally synchronized parameters, so independent formats may be queried
+// concurrently; results are merged into the sorted map, so the output is
+// identical to a sequential walk.
+void GetFormatProperties(VkPhysicalDevice physical_device,
+                         VkFormat first_format,
+                         VkFormat last_format,
+                         std::map<VkFormat, VkFormatProperties>* formats) {
+  const uint32_t count = static_cast<uint32_t>(last_format) -
+                         static_cast<uint32_t>(first_format) + 1;
+  const uint32_t num_threads =
+      std::max(1u, std::min({std::thread::hardware_concurrency(), 4u, count}));
+
+  std::vector<std::vector<std::pair<VkFormat, VkFormatProperties>>> results(
+      num_threads);
+  auto query_stripe = [physical_device, first_format, count, num_threads,
+                       &results](uint32_t stripe) {
+    for (uint32_t i = stripe; i < count; i += num_threads) {
+      const VkFormat format =
+          static_cast<VkFormat>(static_cast<uint32_t>(first_format) + i);
+      VkFormatProperties properties = {};
+      vkGetPhysicalDeviceFormatProperties(physical_device, format,
+                                          &properties);
+      if (properties.linearTilingFeatures ||
+          properties.optimalTilingFeatures || properties.bufferFeatures) {
+        results[stripe].emplace_back(format, properties);
+      }
+    }
+  };
+
+  if (num_threads == 1) {
+    query_stripe(0);
+  } else {
+    std::vector<std::thread> workers;
+    for (uint32_t t = 0; t < num_threads; ++t)
+      workers.emplace_back(query_stripe, t);
+    for (auto& worker : workers)
+      worker.join();
+  }
+
+  for (const auto& stripe_results : results)
+    formats->insert(stripe_results.begin(), stripe_results.end());
+}
+
 bool HasExtension(const char* extension_name,
                   const std::vector<VkExtensionProperties>& extensions) {
   return std::find_if(extensions.cbegin(), extensions.cend(),
@@ -130,31 +177,13 @@ VkJsonDevice VkJsonGetDevice(VkInstance instance,
         physical_device, &queue_family_count, device.queues.data());
   }
 
-  VkFormatProperties format_properties = {};
-  for (VkFormat format = VK_FORMAT_R4G4_UNORM_PACK8;
-       format <= VK_FORMAT_END_RANGE;
-       format = static_cast<VkFormat>(format + 1)) {
-    vkGetPhysicalDeviceFormatProperties(physical_device, format,
-                                        &format_properties);
-    if (format_properties.linearTilingFeatures ||
-        format_properties.optimalTilingFeatures ||
-        format_properties.bufferFeatures) {
-      device.formats.insert(std::make_pair(format, format_properties));
-    }
-  }
+  GetFormatProperties(physical_device, VK_FORMAT_R4G4_UNORM_PACK8,
+                      VK_FORMAT_END_RANGE, &device.formats);
 
   if (device.properties.apiVersion >= VK_API_VERSION_1_1) {
-    for (VkFormat format = VK_FORMAT_G8B8G8R8_422_UNORM;
-         format <= VK_FORMAT_G16_B16_R16_3PLANE_444_UNORM;
-         format = static_cast<VkFormat>(format + 1)) {
-      vkGetPhysicalDeviceFormatProperties(physical_device, format,
-                                          &format_properties);
-      if (format_properties.linearTilingFeatures ||
-          format_properties.optimalTilingFeatures ||
-          format_properties.bufferFeatures) {
-        device.formats.insert(std::make_pair(format, format_properties));
-      }
-    }
+    GetFormatProperties(physical_device, VK_FORMAT_G8B8G8R8_422_UNORM,
+                        VK_FORMAT_G16_B16_R16_3PLANE_444_UNORM,
+                        &device.formats);
 
     PFN_vkGetPhysicalDeviceProperties2 vkpGetPhysicalDeviceProperties2 =
         reinterpret_cast<PFN_vkGetPhysicalDeviceProperties2>(